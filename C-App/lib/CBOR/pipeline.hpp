@@ -7,6 +7,7 @@
 #include "PIPELINE_GLOBAL.hpp"
 #include "STEP_GNSS.hpp"
 #include "RECEIVE.hpp"
+#include "SESSION_RESEAU.hpp"
 #include <vector>
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
@@ -30,6 +31,8 @@ enum PipelineCBOR
     STEP_RECEIVE,
     STEP_RECEIVE_PIPELINE, // Pour recevoir les messages CBOR
     STEP_CLOSE_CONNEXION,
+    STEP_ENVOI_COAP, // Envoi et réponse en un échange CoAP (TRANSPORT_COAP)
+    STEP_ENVOI_MQTT, // Publication par le client MQTT du modem (TRANSPORT_MQTT)
     STEP_END
 
 };
@@ -55,8 +58,13 @@ void STEP_WRITE_FUNCTION();
 void STEP_RECEIVE_FUNCTION();
 void STEP_RECEIVE_PIPELINE_FUNCTION();
 void STEP_CLOSE_CONNEXION_FUNCTION();
+void STEP_ENVOI_COAP_FUNCTION();
+void STEP_ENVOI_MQTT_FUNCTION();
 void STEP_END_FUNCTION();
 
+// Options d'un message CBOR du serveur (réponse à un envoi ou commande reçue en écoute)
+void appliquerOptionsRecues(const json &options);
+
 extern ATCommandTask taskCBOR_CLOSE;
 
 // DEFINITION DE VARIABLES GLOBALES
@@ -0,0 +1,121 @@
+#ifndef ENERGIE_HPP
+#define ENERGIE_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "SIM7080G_POWER.hpp"
+
+// Etats de l'ESP32-C3
+enum EtatCpu
+{
+    CPU_ACTIF,
+    CPU_IDLE, // light sleep
+    CPU_DEEP_SLEEP,
+    NB_ETATS_CPU
+};
+
+// Etats du récepteur GNSS du SIM7080G
+enum EtatGnss
+{
+    GNSS_ETEINT,
+    GNSS_ALLUME,
+    NB_ETATS_GNSS
+};
+
+// Etats de la partie LTE (CAT-M1) du SIM7080G
+enum EtatLte
+{
+    LTE_ETEINT,
+    LTE_IDLE,     // enregistré, DRX / eDRX
+    LTE_CONNECTE, // connexion RRC active
+    LTE_PSM,
+    LTE_TX,
+    NB_ETATS_LTE
+};
+
+// Courant moyen consommé dans chaque état, en microampères
+struct ProfilCourant
+{
+    uint32_t cpu_uA[NB_ETATS_CPU] = {22000, 350, 5};
+    uint32_t gnss_uA[NB_ETATS_GNSS] = {0, 31000};
+    uint32_t lte_uA[NB_ETATS_LTE] = {10, 1200, 60000, 4, 220000};
+    uint32_t capaciteBatterie_mAh = 2000;
+};
+
+struct RapportEnergie
+{
+    unsigned long dureeMs = 0;
+    uint32_t nbFix = 0;
+    uint32_t nbCycles = 0;
+    float mAhTotal = 0;
+    float mAhParFix = 0;
+    float mAhParCycle = 0;
+    float mAhParJour = 0;
+    float autonomieJours = 0;
+    float courantMoyen_mA = 0;
+};
+
+// Comptabilise le temps passé dans chaque état, pour chaque composant
+class ComptabiliteEnergie
+{
+public:
+    ComptabiliteEnergie();
+    void reinitialiser(unsigned long maintenant);
+    void setEtatCpu(EtatCpu etat, unsigned long maintenant);
+    void setEtatGnss(EtatGnss etat, unsigned long maintenant);
+    void setEtatLte(EtatLte etat, unsigned long maintenant);
+    void enregistrerFix();
+    void enregistrerCycle();
+    void enregistrerTensionBatterie(int mV);
+    void cloturer(unsigned long maintenant);
+    void reprendre(unsigned long dureeSommeilMs, unsigned long maintenant);
+
+    unsigned long tempsCpu(EtatCpu etat, unsigned long maintenant) const;
+    unsigned long tempsGnss(EtatGnss etat, unsigned long maintenant) const;
+    unsigned long tempsLte(EtatLte etat, unsigned long maintenant) const;
+    EtatCpu etatCpu() const { return cpu; }
+    EtatGnss etatGnss() const { return gnss; }
+    EtatLte etatLte() const { return lte; }
+    int tensionBatterie() const { return tensionMv; }
+    uint32_t cycles() const { return nbCycles; }
+
+    RapportEnergie rapport(unsigned long maintenant, const ProfilCourant &profil) const;
+
+private:
+    unsigned long debut;
+    unsigned long dureeAnterieure; // durée mesurée avant le dernier deep sleep
+    EtatCpu cpu;
+    EtatGnss gnss;
+    EtatLte lte;
+    unsigned long depuisCpu, depuisGnss, depuisLte;
+    unsigned long dureesCpu[NB_ETATS_CPU];
+    unsigned long dureesGnss[NB_ETATS_GNSS];
+    unsigned long dureesLte[NB_ETATS_LTE];
+    uint32_t nbFix;
+    uint32_t nbCycles;
+    int tensionMv;
+};
+
+// Déroulé type d'un cycle du pipeline, utilisé pour la simulation à horloge virtuelle
+struct ScenarioCycle
+{
+    unsigned long periodeMs = 30000;      // attente entre deux cycles (periodeAjustement)
+    unsigned long ttffMs = 30000;         // temps jusqu'au premier fix
+    unsigned long intervalleFixMs = 3000; // periodGNSS
+    uint8_t nbFixParCycle = MAX_COORDS;
+    unsigned long lteConnexionMs = 4000;  // CEREG + CAOPEN
+    unsigned long lteTxMs = 1000;
+    unsigned long lteReceptionMs = 9000;  // receive() + fermeture
+    EtatLte lteEntreCycles = LTE_IDLE;
+    EtatCpu cpuEntreCycles = CPU_ACTIF;
+};
+
+extern ComptabiliteEnergie energie;
+extern ProfilCourant profilCourant;
+
+RapportEnergie simulerEnergie(const ScenarioCycle &scenario, const ProfilCourant &profil, unsigned long dureeMs = 86400000UL);
+int parseBatteryVoltage(const String &reponseCBC);
+void mesurerBatterie();
+void afficherRapportEnergie(const RapportEnergie &rapport);
+
+#endif // ENERGIE_HPP
@@ -0,0 +1,91 @@
+#ifndef GESTION_PSM_HPP
+#define GESTION_PSM_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "ENERGIE.hpp"
+
+// Seuils de choix du mode d'économie en fonction de periodeAjustement
+#define SEUIL_PERIODE_PSM_MS 120000UL
+#define SEUIL_PERIODE_EDRX_MS 20000UL
+
+enum ModeEconomie
+{
+    ECONOMIE_AUCUNE,
+    ECONOMIE_EDRX,
+    ECONOMIE_PSM
+};
+
+enum ModeSommeil
+{
+    SOMMEIL_AUCUN,
+    SOMMEIL_LEGER,
+    SOMMEIL_PROFOND
+};
+
+// Timers demandés au réseau (valeurs codées 3GPP TS 24.008)
+struct ConfigPSM
+{
+    ModeEconomie mode = ECONOMIE_AUCUNE;
+    String tauBits = "";   // T3412 étendu (TAU périodique)
+    String actifBits = ""; // T3324 (temps actif)
+    uint32_t tauS = 0;
+    uint32_t actifS = 0;
+    String edrxBits = ""; // cycle eDRX (WB-S1)
+    uint32_t edrxMs = 0;
+};
+
+// Timers réellement accordés par le réseau
+struct EtatPSMReseau
+{
+    bool psmAccorde = false;
+    uint32_t tauS = 0;
+    uint32_t actifS = 0;
+    bool edrxAccorde = false;
+    uint32_t edrxMs = 0;
+    uint32_t ptwMs = 0;
+};
+
+struct PlanSommeil
+{
+    ModeSommeil mode = SOMMEIL_AUCUN;
+    unsigned long dureeMs = 0;
+};
+
+struct GestionPSM
+{
+    ConfigPSM demande;
+    EtatPSMReseau accorde;
+    bool deepSleepAutorise = true;           // l'état est conservé en mémoire RTC (ETAT_RTC)
+    unsigned long seuilSommeilLegerMs = 1000;
+    unsigned long seuilSommeilProfondMs = 60000;
+    unsigned long margeReveilMs = 200;
+    uint32_t nbSommeilsLegers = 0;
+    uint32_t nbSommeilsProfonds = 0;
+    uint32_t nbVeillesUart = 0;
+    PlanSommeil dernierPlan;
+    bool reveilModem = false; // dernier sommeil léger interrompu par une émission du modem (URC)
+    bool veilleUart = false;  // une URC attendue ne peut pas être relue (+SMSUB) : attente UART active, pas de light sleep
+};
+
+extern GestionPSM gestionPSM;
+
+String encoderT3412(uint32_t secondes);
+uint32_t decoderT3412(const String &bits);
+String encoderT3324(uint32_t secondes);
+uint32_t decoderT3324(const String &bits);
+String encoderCycleEdrx(uint32_t maxMs);
+uint32_t decoderCycleEdrx(const String &bits);
+
+ConfigPSM calculerConfigPSM(unsigned long periodeMs);
+void negocierPSM(const ConfigPSM &config);
+void parserTimersCEREG(const String &reponse, EtatPSMReseau &etat);
+void parserCEDRXRDP(const String &reponse, EtatPSMReseau &etat);
+
+PlanSommeil planifierSommeil(unsigned long maintenant, unsigned long reveilMs);
+void appliquerSommeil(const PlanSommeil &plan);
+void dormirJusqua(unsigned long reveilMs);
+void reveillerModemSiPSM();
+
+#endif // GESTION_PSM_HPP
@@ -0,0 +1,26 @@
+#ifndef AIGUILLAGE_URC_HPP
+#define AIGUILLAGE_URC_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "TRANSPORT_MQTT.hpp"
+
+// Lecteur unique de l'UART du modem entre deux envois : chaque URC est remise au module qui la suit.
+class AiguillageUrc
+{
+public:
+    AiguillageUrc();
+    void reinitialiser();
+
+    int lire(unsigned long maintenant);
+    void traiter(const char *donnees, size_t n, unsigned long maintenant);
+    void traiterLigne(const char *ligne, unsigned long maintenant);
+
+private:
+    char ligne[TAILLE_LIGNE_URC];
+    uint16_t longueur;
+};
+
+extern AiguillageUrc aiguillageUrc;
+
+#endif // AIGUILLAGE_URC_HPP
@@ -0,0 +1,138 @@
+#ifndef ARBITRE_RADIO_HPP
+#define ARBITRE_RADIO_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "SIM7080G_GNSS.hpp"
+#include "QUALITE_LIEN.hpp"
+
+// Le SIM7080G n'a qu'une chaîne radio : elle sert soit au GNSS, soit au LTE
+enum ProprietaireRadio : uint8_t
+{
+    RADIO_LIBRE,
+    RADIO_GNSS,
+    RADIO_LTE
+};
+
+// Suite donnée à une fenêtre GNSS terminée
+enum DecisionRadio : uint8_t
+{
+    RADIO_DIFFERER,       // pas d'envoi, GNSS éteint jusqu'au prochain cycle
+    RADIO_MAINTENIR_GNSS, // pas d'envoi, GNSS laissé allumé (prochaine fenêtre GNSS proche)
+    RADIO_FENETRE_LTE     // GNSS éteint, envoi du lot
+};
+
+struct ConfigArbitre
+{
+    bool actif = true;                         // false : comportement historique (envoi à chaque cycle)
+    unsigned long latenceMaxMs = 300000;       // délai maximal entre un fix et son arrivée au serveur
+    unsigned long intervalleLteMaxMs = 900000; // au moins une fenêtre LTE par intervalle (options descendantes)
+    unsigned long gnssChaudMaxMs = 60000;      // GNSS gardé allumé si la prochaine fenêtre GNSS commence avant ce délai
+    unsigned long dureeLteEstimeeMs = 10000;   // durée d'une fenêtre LTE, prise sur la latence maximale
+};
+
+struct StatsArbitre
+{
+    uint32_t nbBasculements = 0;      // chaîne radio passée du GNSS au LTE ou l'inverse
+    uint32_t nbAllumagesGnss = 0;     // AT+CGNSPWR=1
+    uint32_t nbExtinctionsGnss = 0;   // AT+CGNSPWR=0
+    uint32_t nbMaintiensGnss = 0;     // fins de fenêtre GNSS sans extinction
+    uint32_t nbFenetresLte = 0;
+    uint32_t nbEnvoisDifferes = 0;
+    uint32_t nbReportsLienFaible = 0; // envois différés parce que le lien était faible
+    uint32_t nbFinsAnticipees = 0;    // acquisitions écourtées par la latence maximale
+    uint32_t nbPointsLivres = 0;
+    uint64_t latenceCumuleeMs = 0;    // du fix à la fin de l'envoi
+    uint32_t latenceMaxMs = 0;
+    uint32_t nbFragmentsPrets = 0;    // points déjà composés pendant l'acquisition
+    uint32_t nbFragmentsComposes = 0; // points composés à l'étape STEP_COMPOSE_JSON
+};
+
+// Arbitre de la chaîne radio : planifie fenêtres GNSS et fenêtres LTE comme un seul calendrier
+class ArbitreRadio
+{
+public:
+    ConfigArbitre config;
+    StatsArbitre stats;
+
+    ArbitreRadio();
+    void reinitialiser();
+
+    void gnssAllume(unsigned long maintenant);
+    void gnssEteint(unsigned long maintenant);
+    void ouvrirFenetreLte(unsigned long maintenant, int nbPoints);
+    void envoiTermine(DataGNSS *donnees, int &nb, unsigned long maintenant);
+
+    bool envoiUrgent(unsigned long ageAncienMs) const;
+    DecisionRadio decider(bool lotPret, bool evenement, unsigned long ageAncienMs, unsigned long prochainGnssMs, unsigned long maintenant,
+                          NiveauLien lien = LIEN_INCONNU);
+    DecisionRadio derniereDecision() const { return decision; }
+    bool estGnssAllume() const { return gnssActif; }
+    ProprietaireRadio proprietaire() const { return radio; }
+
+    // Etat conservé en mémoire RTC
+    unsigned long derniereFenetreLteMs;
+    bool fenetreLteFaite;
+    void restaurerGnssAllume(bool allume);
+
+private:
+    void attribuer(ProprietaireRadio nouveau);
+
+    ProprietaireRadio radio;
+    bool gnssActif;
+    DecisionRadio decision;
+    int nbMessage;
+};
+
+// Calendrier simulé : cycles d'acquisition réguliers, phases de déplacement et d'arrêt alternées
+struct ScenarioRadio
+{
+    unsigned long dureeS = 6UL * 3600;
+    unsigned long periodeCycleS = 30;
+    unsigned long deplacementS = 1200; // phase de déplacement, puis arretS à l'arrêt
+    unsigned long arretS = 1200;
+    uint8_t fixesDeplacement = MAX_COORDS; // fixes par cycle en déplacement (1 Hz)
+    uint8_t fixesArret = 1;                // un seul point "toujours là" à l'arrêt (ECHANTILLONNAGE)
+    unsigned long ttffTiedeS = 20;         // GNSS rallumé après une extinction
+    unsigned long ttffChaudS = 1;          // GNSS resté allumé
+    unsigned long dureeLteS = 8;
+    // Couverture : phases de bon lien et de lien faible alternées (lienFaibleS = 0 : toujours bon)
+    unsigned long lienBonS = 1800;
+    unsigned long lienFaibleS = 0;
+    int16_t rsrpBonDbm = -95;
+    int16_t rsrpFaibleDbm = -122;
+    // Bilan d'antenne d'un envoi : en-tête CBOR, octets par point, échanges de connexion (RRC, TCP), débit à une répétition
+    uint16_t octetsEntete = 120;
+    uint16_t octetsParPoint = 40;
+    uint16_t octetsSignalisation = 800;
+    uint32_t debitBps = 300000;
+};
+
+struct RapportRadio
+{
+    float basculementsParHeure = 0;
+    float commandesGnssParHeure = 0; // AT+CGNSPWR=1 et AT+CGNSPWR=0
+    float fenetresLteParHeure = 0;
+    uint32_t latenceMoyenneS = 0;    // du fix à son arrivée au serveur
+    uint32_t latenceMaxS = 0;
+    uint32_t gnssAllumePourMille = 0; // part du temps GNSS allumé
+    uint32_t nbPointsLivres = 0;
+    uint32_t nbPointsDecimes = 0;     // fusionnés par le tampon pendant un envoi différé
+    uint32_t nbEnvoisLienFaible = 0;
+    uint64_t octetsEnvoyes = 0;
+    uint64_t tempsAntenneMs = 0;      // émission, répétitions CE comprises
+    float energieLte_uAh = 0;         // émission et connexion des fenêtres LTE
+    float tempsAntenneMsParOctet = 0;
+    float energie_uAhParOctet = 0;
+};
+
+extern ArbitreRadio arbitreRadio;
+
+unsigned long ageAncienFix(const DataGNSS *donnees, int nb, unsigned long maintenant);
+RapportRadio simulerOrdonnancement(const ScenarioRadio &scenario, const ConfigArbitre &config,
+                                   const ConfigQualiteLien &configLien = ConfigQualiteLien());
+void chargerOptionsArbitre(const json &options);
+void afficherRapportRadio(const char *nom, const RapportRadio &rapport);
+void afficherStatsArbitre();
+
+#endif // ARBITRE_RADIO_HPP
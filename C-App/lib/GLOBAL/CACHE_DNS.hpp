@@ -0,0 +1,132 @@
+#ifndef CACHE_DNS_HPP
+#define CACHE_DNS_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include <vector>
+
+#define NB_POINTS_ACCES 3
+#define TAILLE_HOTE 48
+#define TAILLE_IP 40                  // IPv6 compris
+#define CACHE_DNS_MAGIC 0x444E5343UL // "DNSC"
+
+struct ConfigDns
+{
+    bool actif = false;                   // true : AT+CAOPEN vers l'adresse IP résolue et mise en cache
+    bool persistant = true;               // cache écrit en EEPROM à chaque résolution
+    uint32_t ttlS = 3600;                 // AT+CDNSGIP ne donne pas le TTL de l'enregistrement
+    uint32_t nouvelEssaiS = 300;          // résolution échouée : AT+CAOPEN par nom d'hôte pendant ce délai
+    uint8_t echecsBascule = 2;            // connexions échouées d'affilée avant de passer au point d'accès suivant
+    uint32_t retourS = 1800;              // point d'accès écarté : de nouveau candidat après ce délai
+    unsigned long delaiResolutionMs = 10000; // attente de l'URC +CDNSGIP
+};
+
+// Serveur joignable, mémorisé en EEPROM avec sa dernière résolution et sa latence de connexion
+struct PointAcces
+{
+    char hote[TAILLE_HOTE];
+    uint16_t port;
+    char ip[TAILLE_IP];          // vide : pas de résolution valide
+    uint32_t expirationEpochS;   // 0 : heure inconnue à la résolution
+    uint32_t latenceMoyenneMs;   // moyenne glissante (1/4) des connexions réussies, 0 : jamais mesurée
+    uint32_t latenceMaxMs;
+    uint16_t nbConnexions;
+    uint16_t nbEchecs;           // connexions échouées depuis la dernière réussie
+};
+
+struct CacheDnsPersistant
+{
+    uint32_t magic;
+    uint8_t nbPoints;
+    PointAcces points[NB_POINTS_ACCES];
+    uint32_t crc;
+};
+
+struct StatsDns
+{
+    uint32_t nbResolutions = 0;        // AT+CDNSGIP envoyés
+    uint32_t nbEchecsResolution = 0;
+    uint32_t nbResolutionsEvitees = 0; // adresse en cache encore valide avant une ouverture
+    uint32_t nbConnexions = 0;         // AT+CAOPEN TCP réussis
+    uint32_t nbEchecsConnexion = 0;
+    uint32_t nbBasculements = 0;       // changements de point d'accès après des échecs
+    uint64_t latenceCumuleeMs = 0;     // de AT+CAOPEN au résultat
+    uint32_t latenceMaxMs = 0;
+};
+
+// Résolution des serveurs par AT+CDNSGIP, mise en cache (TTL, EEPROM) et choix du point d'accès le plus rapide.
+class CacheDns
+{
+public:
+    ConfigDns config;
+    StatsDns stats;
+    bool (*resoudre)(const char *hote, String &ip, unsigned long maintenant) = nullptr; // nullptr : AT+CDNSGIP
+
+    CacheDns();
+    void reinitialiser();
+    void definirPoints(const std::vector<std::pair<String, uint16_t>> &points);
+
+    bool entretenir(unsigned long maintenant);
+    String adresse() const;
+    uint16_t port() const;
+    const char *hote() const;
+
+    void debutConnexion(unsigned long maintenant);
+    void connexionReussie(unsigned long maintenant);
+    void connexionEchouee(unsigned long maintenant);
+
+    uint8_t nbPoints() const { return nb; }
+    uint8_t pointCourant() const { return courant; }
+    const PointAcces &point(uint8_t i) const { return points[i]; }
+    bool estValide(unsigned long maintenant) const;
+
+    bool charger();
+    void sauvegarder();
+
+private:
+    bool resoudreAT(const char *hote, String &ip);
+    uint32_t epochS(unsigned long maintenant) const;
+    uint8_t choisir(unsigned long maintenant) const;
+    void selectionner(unsigned long maintenant);
+
+    PointAcces points[NB_POINTS_ACCES];
+    uint8_t nb;
+    uint8_t courant;
+    bool charge;                   // EEPROM lue (au premier usage)
+    unsigned long resoluMs[NB_POINTS_ACCES]; // résolution de ce démarrage, pour le TTL sans heure UTC
+    bool resoluIci[NB_POINTS_ACCES];
+    unsigned long dernierEchecMs[NB_POINTS_ACCES];
+    unsigned long echecResolutionMs;
+    bool echecResolution;
+    unsigned long debutMs;
+};
+
+// Connexions périodiques à des points d'accès dont la latence diffère, le premier en panne un temps
+struct ScenarioDns
+{
+    uint16_t nbConnexions = 200;
+    unsigned long periodeS = 60;     // entre deux ouvertures de socket
+    unsigned long rttDnsMs = 600;    // aller-retour d'une résolution sur le réseau
+    unsigned long latences[2] = {500, 900}; // établissement TCP vers chaque point d'accès
+    uint16_t panneDebut = 50;        // connexions pendant lesquelles le premier point d'accès ne répond pas
+    uint16_t panneFin = 80;
+    unsigned long delaiEchecMs = 8000; // AT+CAOPEN sans réponse
+    uint16_t changementIpA = 120;    // le nom du premier point d'accès change d'adresse à cette connexion
+};
+
+struct RapportDns
+{
+    uint32_t nbResolutions = 0;
+    uint32_t nbEchecs = 0;
+    uint32_t nbBasculements = 0;
+    uint32_t latenceMoyenneMs = 0;   // résolution comprise, de la décision d'ouvrir au socket ouvert
+    uint32_t latenceMaxMs = 0;
+};
+
+extern CacheDns cacheDns;
+
+RapportDns simulerDns(const ScenarioDns &scenario, const ConfigDns &config, bool parNom);
+void chargerOptionsDns(const json &options);
+void afficherStatsDns();
+
+#endif // CACHE_DNS_HPP
@@ -0,0 +1,112 @@
+#ifndef ENVOI_FRAGMENTE_HPP
+#define ENVOI_FRAGMENTE_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+
+#define TAILLE_MAX_CASEND 1460 // AT+CASEND accepte de 1 à 1460 octets par commande
+#define TAILLE_LIGNE_ENVOI TAILLE_LIGNE_URC // une URC +SMSUB peut arriver entre deux fragments
+
+enum EtatEnvoi : uint8_t
+{
+    ENVOI_INACTIF,
+    ENVOI_EN_COURS,
+    ENVOI_TERMINE,
+    ENVOI_ECHEC
+};
+
+struct ConfigEnvoi
+{
+    bool actif = true;            // false : comportement historique (un seul AT+CASEND par message, précédé de AT+CACFG?)
+    uint16_t tailleCible = 1360;  // octets max par AT+CASEND : sous la limite du modem et d'un segment TCP (MTU CAT-M1 courante : 1400)
+    unsigned long delaiMs = 5000; // ni prompt ni OK pendant ce délai : envoi abandonné
+    uint16_t octetsEntete = 120;  // partie du message CBOR indépendante du nombre de fixes (estimation)
+    uint16_t octetsParFix = 40;   // taille CBOR estimée d'un fix tant qu'aucun lot n'a été mesuré (mesurerLot)
+};
+
+struct StatsEnvoi
+{
+    uint32_t nbMessages = 0;
+    uint32_t nbFragments = 0; // AT+CASEND écrits
+    uint64_t octets = 0;
+    uint32_t nbEchecs = 0;
+    uint64_t dureeCumuleeMs = 0; // du premier AT+CASEND au dernier OK
+    uint32_t dureeMaxMs = 0;
+};
+
+// Envoi d'un message sur le socket ouvert en fragments de tailleCible : l'en-tête AT+CASEND du fragment suivant part
+// au OK du précédent, les prompts ">" et les OK sont lus au fil du flux.
+class EnvoiFragmente
+{
+public:
+    ConfigEnvoi config;
+    StatsEnvoi stats;
+    size_t (*sortie)(const uint8_t *donnees, size_t taille) = nullptr; // nullptr : UART du modem
+    uint8_t cid = 0;                                                   // connexion AT+CA* (0 : socket de l'envoi)
+
+    EnvoiFragmente();
+    void reinitialiser();
+
+    int nbFragments(size_t taille) const;
+    size_t tailleFragment(size_t taille, int index) const;
+    void mesurerLot(size_t taille, int nbFixes);
+    size_t tailleEstimee(int nbFixes) const;
+    bool lotRempli(int nbFixes) const;
+
+    void commencer(const uint8_t *donnees, size_t taille, unsigned long maintenant);
+    size_t traiter(const char *donnees, size_t n, unsigned long maintenant);
+    EtatEnvoi pomper(unsigned long maintenant);
+    EtatEnvoi etat() const { return etatEnvoi; }
+    int fragmentsAcquittes() const { return nbAcquittes; }
+
+private:
+    uint16_t taillePleine() const;
+    void ecrire(const uint8_t *donnees, size_t n);
+    void envoyerEntete(int index);
+    void traiterLigne(unsigned long maintenant);
+    void terminer(EtatEnvoi fin, unsigned long maintenant);
+
+    EtatEnvoi etatEnvoi;
+    const uint8_t *message;
+    size_t tailleMessage;
+    int nbTotal;
+    int nbEcrits;   // fragments dont les données sont écrites
+    int nbEntetes;  // AT+CASEND écrits
+    int nbAcquittes;
+    unsigned long debutMs;
+    unsigned long evenementMs; // dernier prompt ou OK
+    uint16_t octetsParFixMesure; // dernier lot envoyé, hors en-tête (0 : config.octetsParFix)
+
+    char ligne[TAILLE_LIGNE_ENVOI];
+    uint16_t longueur;
+};
+
+// Un message de nbPoints fixes envoyé sur un socket déjà ouvert
+struct ScenarioEnvoi
+{
+    uint16_t nbPoints = MAX_COORDS;
+    uint16_t octetsEntete = 120;
+    uint16_t octetsParPoint = 40;
+    uint32_t baudsUart = 115200;
+    unsigned long delaiPromptMs = 20;      // de la fin de l'en-tête au prompt ">"
+    unsigned long delaiAcquittementMs = 60; // de la fin des données au OK (données remises à la pile TCP)
+    unsigned long delaiCacfgMs = 40;        // aller-retour AT+CACFG? du mode historique
+};
+
+struct RapportEnvoi
+{
+    uint32_t octets = 0;
+    uint32_t nbCasend = 0;
+    float casendParFix = 0;
+    uint32_t dureeMs = 0;
+    uint32_t debitOctetsParS = 0;
+    bool echec = false; // message refusé par le modem (historique au-delà de TAILLE_MAX_CASEND)
+};
+
+extern EnvoiFragmente envoiFragmente;
+
+RapportEnvoi simulerEnvoi(const ScenarioEnvoi &scenario, const ConfigEnvoi &config);
+void chargerOptionsEnvoi(const json &options);
+void afficherStatsEnvoi();
+
+#endif // ENVOI_FRAGMENTE_HPP
@@ -3,11 +3,17 @@
 
 // Définition des constantes
 #define PIN_PWRKEY 7
+#define PIN_RX_SIM7080G 20 // RX de l'ESP32, relié au TX du modem
 #define Sim7080G Serial1
 #define Sim7080G_BAUDRATE 57600
 #define PINGGY_LINK "rnbxx-92-184-123-236.a.free.pinggy.link"
 #define PINGGY_PORT 41533
+#define APN_RESEAU "iot.1nce.net"
 #define MAX_COORDS 10
+#define TAILLE_LIGNE_URC 640 // +SMSUB: "<topic>","<commande CBOR en hexadécimal>", la plus longue des URC
+#ifndef CYCLES_RAPPORT_STATS
+#define CYCLES_RAPPORT_STATS 12 // statistiques des modules affichées un cycle sur N (1 : à chaque cycle, mise au point)
+#endif
 #include <Arduino.h>
 #include <vector>
 #include <nlohmann/json.hpp>
@@ -37,6 +43,7 @@ extern unsigned long periodeAjustement;
 extern bool oneRun;
 extern bool receiveMessage;
 extern bool stepReceiveFunctionBoolean;
+extern bool reponseServeur;
 extern json lastReceivedCBOR;
 
 struct GnssOptions
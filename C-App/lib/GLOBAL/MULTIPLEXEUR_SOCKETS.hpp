@@ -0,0 +1,90 @@
+#ifndef MULTIPLEXEUR_SOCKETS_HPP
+#define MULTIPLEXEUR_SOCKETS_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+
+#define CID_ENVOI 0    // socket des envois (AT+CASEND=0,... dans STEP_WRITE)
+#define CID_CONTROLE 1 // socket de contrôle, gardé ouvert entre les envois
+#define CID_COAP 2     // socket UDP des envois CoAP (TRANSPORT_COAP)
+
+enum CanalSocket : uint8_t
+{
+    CANAL_ENVOI,
+    CANAL_CONTROLE,
+    CANAL_COAP,
+    NB_CANAUX
+};
+
+struct ConfigSockets
+{
+    bool actif = true; // false : un seul socket (cid 0) pour les envois et les commandes du serveur
+};
+
+struct StatsSocket
+{
+    uint32_t nbOuvertures = 0;          // AT+CAOPEN réussis
+    uint32_t nbOuverturesEvitees = 0;   // socket déjà ouvert : pas de AT+CAOPEN
+    uint32_t nbEchecsOuverture = 0;     // AT+CAOPEN refusé, ou identification du canal de contrôle sans OK
+    uint32_t nbFermetures = 0;          // AT+CACLOSE
+    uint32_t nbFermeturesDistantes = 0; // +CASTATE: <cid>,0
+};
+
+// Connexions AT+CA* du SIM7080G : l'envoi et le contrôle ont chacun leur cid et leur cycle de vie.
+class MultiplexeurSockets
+{
+public:
+    ConfigSockets config;
+    StatsSocket stats[NB_CANAUX];
+
+    MultiplexeurSockets();
+    void reinitialiser();
+
+    uint8_t cid(CanalSocket canal) const;
+    bool estOuvert(CanalSocket canal) const;
+
+    bool ouvrir(CanalSocket canal);
+    void fermer(CanalSocket canal);
+    void marquer(CanalSocket canal, bool ouvert);
+    void traiterLigne(const char *ligne);
+
+private:
+    uint8_t index(CanalSocket canal) const;
+    bool identifier(CanalSocket canal);
+
+    bool ouverts[NB_CANAUX];
+};
+
+// Envois volumineux et commandes du serveur pendant une heure
+struct ScenarioMultiplexage
+{
+    unsigned long dureeS = 3600;
+    unsigned long periodeEnvoiS = 60;
+    uint32_t tailleEnvoi = 24000;           // tampon GNSS vidé d'un coup
+    uint32_t debitMontantOctetsParS = 8000; // CAT-M1, voie montante
+    uint8_t echecTousLes = 5;               // un envoi sur 5 échoue à mi-parcours (0 : aucun)
+    unsigned long intervalleControleMs = 7000;
+    unsigned long rttMs = 600;
+    unsigned long lectureControleMs = 40;   // AT+CARECV d'une commande sur l'UART
+    uint32_t baudsUart = 115200;
+};
+
+struct RapportMultiplexage
+{
+    uint32_t nbEnvois = 0;
+    uint32_t nbEnvoisEchoues = 0;
+    uint32_t debitEnvoiOctetsParS = 0; // octets livrés / durée des envois
+    uint32_t nbControles = 0;
+    uint32_t nbControlesRetardes = 0;  // attente d'un envoi ou d'une réouverture
+    uint32_t nbControlesEnAttente = 0; // non lues à la fin du scénario (socket partagé fermé après un échec)
+    uint32_t latenceControleMoyenneMs = 0;
+    uint32_t latenceControleMaxMs = 0;
+};
+
+extern MultiplexeurSockets multiplexeurSockets;
+
+RapportMultiplexage simulerMultiplexage(const ScenarioMultiplexage &scenario, const ConfigSockets &config);
+void chargerOptionsSockets(const json &options);
+void afficherStatsSockets();
+
+#endif // MULTIPLEXEUR_SOCKETS_HPP
@@ -0,0 +1,80 @@
+#ifndef QUALITE_LIEN_HPP
+#define QUALITE_LIEN_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+
+// Classement de la cellule servante, avec hystérésis sur le RSRP
+enum NiveauLien : uint8_t
+{
+    LIEN_INCONNU, // aucune mesure récente : les règles d'envoi habituelles s'appliquent
+    LIEN_BON,
+    LIEN_MOYEN,
+    LIEN_FAIBLE, // répétitions de couverture étendue (CE) : chaque octet coûte plusieurs fois plus d'antenne
+    NB_NIVEAUX_LIEN
+};
+
+struct MesureLien
+{
+    int16_t rsrpDbm = 0;
+    int16_t rsrqDb = 0;
+    int16_t rssiDbm = 0;
+    int16_t snrDb = 0;
+    bool valide = false;
+};
+
+struct ConfigQualiteLien
+{
+    bool actif = true;                 // false : comportement historique (AT+CSQ ignoré, aucun envoi différé)
+    int16_t seuilBonDbm = -105;        // RSRP au-dessus duquel le lien est bon
+    int16_t seuilFaibleDbm = -115;     // RSRP sous lequel le lien est faible
+    uint8_t hysteresisDb = 5;          // un lien faible le reste tant que le RSRP n'a pas dépassé seuilFaibleDbm + hysteresisDb
+    unsigned long validiteMs = 180000; // une mesure plus ancienne est ignorée (la radio a pu changer de cellule)
+};
+
+struct StatsQualiteLien
+{
+    uint32_t nbMesures = 0;                      // réponses AT+CPSI? / AT+CSQ exploitées
+    uint32_t nbRequetes = 0;                     // AT+CPSI? envoyés par mesurer()
+    uint32_t nbEnvois[NB_NIVEAUX_LIEN] = {};     // envois, par niveau du lien au moment de l'envoi
+    uint64_t octetsEnvoyes[NB_NIVEAUX_LIEN] = {};
+    int32_t rsrpCumuleDbm = 0;                   // sur les envois dont le RSRP est connu
+    uint32_t nbEnvoisMesures = 0;
+    int16_t rsrpMinDbm = 0;
+};
+
+// Qualité du lien montant : dernière mesure de la cellule servante, niveau avec hystérésis, bilan par envoi
+class QualiteLien
+{
+public:
+    ConfigQualiteLien config;
+    StatsQualiteLien stats;
+
+    QualiteLien();
+    void reinitialiser();
+
+    bool observer(const String &reponse, unsigned long maintenant);
+    void noter(const MesureLien &mesure, unsigned long maintenant);
+    NiveauLien mesurer(unsigned long maintenant);
+    NiveauLien niveau(unsigned long maintenant) const;
+    void enregistrerEnvoi(size_t octets, unsigned long maintenant);
+    const MesureLien &derniereMesure() const { return mesure; }
+
+private:
+    NiveauLien classer(int16_t rsrpDbm) const;
+
+    MesureLien mesure;
+    NiveauLien niveauMesure;
+    unsigned long mesureMs;
+};
+
+extern QualiteLien qualiteLien;
+
+bool parserQualiteCPSI(const String &reponse, MesureLien &mesure);
+bool parserCSQ(const String &reponse, MesureLien &mesure);
+uint16_t repetitionsCE(int16_t rsrpDbm);
+const char *nomNiveauLien(NiveauLien niveau);
+void chargerOptionsQualiteLien(const json &options);
+void afficherStatsQualiteLien();
+
+#endif // QUALITE_LIEN_HPP
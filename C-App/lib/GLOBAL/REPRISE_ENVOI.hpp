@@ -0,0 +1,90 @@
+#ifndef REPRISE_ENVOI_HPP
+#define REPRISE_ENVOI_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+
+#define TENTATIVES_MAX_REPRISE 10 // borne de l'option tentativesMax
+
+// Suite donnée à l'échec d'une étape du pipeline CBOR
+enum SuiteEchec : uint8_t
+{
+    SUITE_REPRENDRE, // lot gardé, retour à STEP_VERIFIER_CONNEXION (socket rouvert, AT+CASEND renvoyé)
+    SUITE_ESCALADER  // échecs répétés : pipeline global relancé, les fixes attendent dans le tampon (TAMPON_GNSS)
+};
+
+struct ConfigReprise
+{
+    bool actif = true;                    // false : comportement historique (pipeline global relancé au premier échec)
+    uint8_t tentativesMax = 3;            // reprises d'un même lot avant l'escalade
+    unsigned long delaiRepriseMs = 2000;  // attente avant la première reprise, doublée à chaque échec suivant
+    unsigned long delaiMaxMs = 30000;
+    unsigned long attenteReponseMs = 8000; // sans réponse du serveur après l'envoi (STEP_RECEIVE) : échec repris
+};
+
+struct StatsReprise
+{
+    uint32_t nbEchecs = 0;
+    uint32_t nbReprises = 0;
+    uint32_t nbEscalades = 0;
+    uint32_t nbLivresApresReprise = 0; // lots livrés après au moins un échec
+    uint64_t delaiLivraisonCumuleMs = 0; // du premier échec d'un lot à sa livraison
+    uint32_t delaiLivraisonMaxMs = 0;
+};
+
+// Reprise d'un envoi échoué à l'étape qui a échoué : le message CBOR déjà encodé est gardé et renvoyé sur un
+// socket rouvert ; le pipeline global n'est relancé qu'après config.tentativesMax reprises sans succès.
+class RepriseEnvoi
+{
+public:
+    ConfigReprise config;
+    StatsReprise stats;
+
+    RepriseEnvoi();
+    void reinitialiser();
+
+    SuiteEchec echec(unsigned long maintenant);
+    bool enAttente(unsigned long maintenant) const;
+    void envoiReussi(unsigned long maintenant);
+
+    uint8_t echecsConsecutifs() const { return echecs; }
+
+private:
+    uint8_t echecs;               // échecs du lot en cours
+    unsigned long premierEchecMs;
+    unsigned long repriseMs;      // reprise autorisée à partir de cet instant
+};
+
+// Envois périodiques d'un lot de fixes sur un lien qui échoue par intermittence
+struct ScenarioReprise
+{
+    unsigned long dureeS = 6UL * 3600;
+    unsigned long periodeS = 300;         // attente entre deux cycles après un envoi réussi
+    unsigned long intervalleFixS = 3;
+    unsigned long demarrageGnssMs = 5000; // démarrage à chaud et premier fix d'une fenêtre GNSS
+    unsigned long envoiMs = 4000;         // AT+CEREG?, AT+CAOPEN, AT+CASEND, réponse, AT+CACLOSE
+    unsigned long detectionEchecMs = 20000; // échec constaté : tentatives de la commande épuisées
+    uint8_t tauxEchecPct = 30;            // part des tentatives d'envoi qui échouent
+    uint32_t graine = 1;
+};
+
+struct RapportReprise
+{
+    uint32_t nbFixes = 0;
+    uint32_t nbLivres = 0;
+    uint32_t nbPerdus = 0;          // fusionnés par la décimation du tampon avant leur envoi
+    uint32_t nbFenetresGnss = 0;
+    uint32_t nbEchecs = 0;
+    uint32_t nbEscalades = 0;
+    uint32_t delaiLivraisonMoyenMs = 0; // de la première composition d'un lot à son acquittement
+    uint32_t delaiLivraisonMaxMs = 0;
+    float donneesGardees = 0;       // fixes livrés ou encore en attente, sur les fixes acquis
+};
+
+extern RepriseEnvoi repriseEnvoi;
+
+RapportReprise simulerReprise(const ScenarioReprise &scenario, const ConfigReprise &config);
+void chargerOptionsReprise(const json &options);
+void afficherStatsReprise();
+
+#endif // REPRISE_ENVOI_HPP
@@ -0,0 +1,111 @@
+#ifndef SESSION_RESEAU_HPP
+#define SESSION_RESEAU_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "SIM7080G_SERIAL.hpp"
+
+#define TAILLE_LIGNE_RESEAU 80
+
+// <stat> de +CEREG (3GPP TS 27.007)
+enum EtatEnregistrement : uint8_t
+{
+    ENREG_NON = 0,       // non enregistré, pas de recherche
+    ENREG_MAISON = 1,    // enregistré, réseau nominal
+    ENREG_RECHERCHE = 2, // non enregistré, recherche d'une cellule
+    ENREG_REFUSE = 3,
+    ENREG_INCONNU = 4,
+    ENREG_ITINERANCE = 5 // enregistré, itinérance
+};
+
+// Marches de la reprise, de la moins coûteuse à la plus coûteuse
+enum EtapeReprise : uint8_t
+{
+    REPRISE_AUCUNE,         // le modem a retrouvé seul la session (resélection de cellule)
+    REPRISE_PDP,            // AT+CNACT=0,1
+    REPRISE_ENREGISTREMENT, // AT+CFUN=0 / AT+CFUN=1 : ré-attachement sans toucher au profil
+    REPRISE_CONFIGURATION,  // step_catm1_function() depuis CATM1_POWER_ON
+    NB_ETAPES_REPRISE
+};
+
+struct ConfigSessionReseau
+{
+    bool actif = true;                          // false : comportement historique (AT+CEREG? à chaque envoi, aucune reprise)
+    unsigned long validiteEtatMs = 120000;      // état suivi par URC tenu pour sûr ; au-delà (URC manquée ?), il est relu
+    unsigned long attenteReselectionMs = 20000; // perte de cellule : le modem cherche seul avant toute action
+    unsigned long attenteActionMs = 10000;      // délai laissé à une action avant de relire l'état et de monter d'une marche
+    uint8_t tentativesPdp = 2;
+    uint8_t tentativesEnregistrement = 1;
+};
+
+struct StatsSessionReseau
+{
+    uint32_t nbUrc = 0;                          // +CEREG / +APP PDP reçues
+    uint32_t nbRequetes = 0;                     // AT+CEREG? / AT+CNACT? envoyés
+    uint32_t nbVerificationsSansAT = 0;          // session vérifiée sur l'état suivi, sans commande
+    uint32_t nbPertesEnregistrement = 0;
+    uint32_t nbPertesPdp = 0;
+    uint32_t nbActions[NB_ETAPES_REPRISE] = {};  // actions de reprise lancées, par marche
+    uint32_t nbReprises[NB_ETAPES_REPRISE] = {}; // sessions rétablies, par marche la plus haute utilisée
+    uint64_t repriseCumuleeMs = 0;               // de la détection de la perte au retour de la session
+    uint32_t repriseMaxMs = 0;
+};
+
+// Etat de la session réseau (enregistrement, contexte PDP, adresse IP) suivi par URC, et reprise graduée
+class SessionReseau
+{
+public:
+    ConfigSessionReseau config;
+    StatsSessionReseau stats;
+
+    SessionReseau();
+    void reinitialiser();
+    void invalider();
+
+    void traiterLigne(const char *ligne, unsigned long maintenant);
+    void traiter(const char *donnees, size_t taille, unsigned long maintenant);
+    void traiter(const String &reponse, unsigned long maintenant);
+    int pomper(unsigned long maintenant);
+
+    bool verifier(unsigned long maintenant);
+    EtapeReprise reprendre(unsigned long maintenant);
+    void configurationTerminee(unsigned long maintenant);
+
+    EtatEnregistrement enregistrement() const { return etat; }
+    bool estEnregistre() const { return etat == ENREG_MAISON || etat == ENREG_ITINERANCE; }
+    bool estPdpActif() const { return pdp; }
+    bool estPrete() const { return connu && estEnregistre() && pdp; }
+    bool estEnPanne() const { return enPanne; }
+    const char *ip() const { return adresse; }
+    EtapeReprise marcheAtteinte() const { return marche; }
+
+private:
+    void rafraichir(unsigned long maintenant);
+    void signalerPerte(unsigned long maintenant);
+    void retablir(unsigned long maintenant);
+    EtapeReprise agir(EtapeReprise action, unsigned long maintenant);
+
+    EtatEnregistrement etat;
+    bool pdp;
+    bool connu;
+    char adresse[16];
+    unsigned long majMs; // dernière information (URC ou réponse)
+
+    bool enPanne;
+    unsigned long perteMs;
+    EtapeReprise marche;  // marche la plus haute de la reprise en cours
+    EtapeReprise enCours; // dernière action lancée
+    unsigned long actionMs;
+    uint8_t nbPdp;
+    uint8_t nbEnregistrements;
+
+    char ligne[TAILLE_LIGNE_RESEAU];
+    uint8_t longueur;
+};
+
+extern SessionReseau sessionReseau;
+
+const char *nomEtapeReprise(EtapeReprise etape);
+void afficherStatsSessionReseau();
+
+#endif // SESSION_RESEAU_HPP
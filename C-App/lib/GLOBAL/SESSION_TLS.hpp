@@ -0,0 +1,124 @@
+#ifndef SESSION_TLS_HPP
+#define SESSION_TLS_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+
+#define NB_CIDS_TLS 4 // cid 0 à 3 : envoi, contrôle (MULTIPLEXEUR_SOCKETS)
+
+enum PoigneeTls : uint8_t
+{
+    POIGNEE_AUCUNE,  // socket gardé ouvert : pas de poignée de main
+    POIGNEE_COMPLETE // certificat et échange de clés : deux allers-retours
+};
+
+struct ConfigTls
+{
+    bool actif = false;            // true : sockets TCP chiffrés par le moteur SSL du modem
+    uint8_t contexte = 1;          // ctxindex de AT+CSSLCFG
+    uint8_t versionTls = 3;        // AT+CSSLCFG="sslversion" : 3 = TLS 1.2
+    bool authentification = true; // false : serveur non authentifié (banc de test uniquement)
+    String certificatCa = "ca.crt"; // CA du serveur, fichier déjà chargé dans le modem (AT+CFSWFILE) ; requis si authentification
+    uint32_t garderOuvertS = 600;  // socket de l'envoi gardé ouvert si l'envoi suivant arrive avant (0 : fermé)
+};
+
+struct StatsTls
+{
+    uint32_t nbConfigurations = 0;    // contexte SSL écrit (AT+CSSLCFG)
+    uint32_t nbPoignees = 0;          // AT+CAOPEN réussis sur un cid SSL
+    uint32_t nbConnexionsGardees = 0; // envois sur le socket resté ouvert
+    uint32_t nbSocketsPerdus = 0;     // socket gardé mais fermé d'après AT+CASTATE?
+    uint32_t nbEchecs = 0;
+    uint32_t transactionsAT = 0;      // AT+CSSLCFG, AT+CASSLCFG et AT+CASTATE?
+    uint64_t latenceCumuleeMs = 0;
+};
+
+// TLS des sockets AT+CA* par le moteur SSL du SIM7080G : contexte configuré une fois, serveur authentifié par sa
+// CA, socket de l'envoi gardé ouvert d'un envoi à l'autre.
+class SessionTls
+{
+public:
+    ConfigTls config;
+    StatsTls stats;
+    String (*commande)(const String &commande, long delai) = nullptr; // nullptr : Send_AT
+
+    SessionTls();
+    void reinitialiser();
+
+    bool verifierCa();
+    bool preparer(uint8_t cid, unsigned long maintenant);
+    void connexionOuverte(unsigned long debut, unsigned long maintenant);
+    void connexionEchouee();
+    void reconfigurer();
+    bool reutiliser(unsigned long maintenant);
+    bool terminerEnvoi(unsigned long maintenant);
+
+    PoigneeTls dernierePoignee() const { return poignee; }
+    bool estConfigure() const { return configure; }
+    uint8_t cidsPrepares() const { return prepares; }
+    void restaurer(bool configureModem, uint8_t cids);
+
+private:
+    String repondre(const String &texte);
+    bool envoyer(const String &texte);
+
+    bool configure;   // AT+CSSLCFG appliqués au contexte
+    uint8_t prepares; // cids dont AT+CASSLCFG est appliqué (bit par cid)
+    unsigned long dernierEnvoiMs;
+    bool socketGarde; // socket de l'envoi laissé ouvert par terminerEnvoi()
+    PoigneeTls poignee;
+    String hoteSni;
+};
+
+// Serveur TLS local de substitution, vu à travers le moteur SSL du modem : chaque AT+CAOPEN sur un cid SSL refait
+// une poignée complète (le SIM7080G n'expose aucune reprise de session), AT+CASTATE? rend l'état des sockets.
+class ServeurTlsLocal
+{
+public:
+    uint32_t nbPoigneesCompletes = 0;
+    uint32_t nbConnexionsClaires = 0;        // AT+CAOPEN sans SSL
+    uint32_t nbConnexionsNonAuthentifiees = 0; // SSL sans CACERT sur le cid
+    bool caChargee = true;                   // fichier de la CA présent : "convert" accepté
+    PoigneeTls derniere = POIGNEE_AUCUNE;
+
+    String traiter(const String &commande, unsigned long maintenant);
+    void redemarrer();
+    void couper(uint8_t cid);
+    bool estOuvert(uint8_t cid) const { return cid < NB_CIDS_TLS && ouverts[cid]; }
+
+private:
+    bool ssl[NB_CIDS_TLS] = {false};
+    bool ca[NB_CIDS_TLS] = {false};
+    bool ouverts[NB_CIDS_TLS] = {false};
+};
+
+// Envois périodiques vers un serveur TLS, socket coupé de temps en temps par le réseau
+struct ScenarioTls
+{
+    uint16_t nbEnvois = 100;
+    unsigned long periodeS = 60;
+    unsigned long rttMs = 600;
+    unsigned long commandeAtMs = 40;     // aller-retour d'une commande AT sur l'UART
+    uint32_t debitOctetsParS = 8000;     // CAT-M1
+    uint16_t tailleEnvoi = 300;          // message CBOR d'un lot
+    uint16_t octetsPoigneeComplete = 4800; // chaîne de certificats comprise
+    uint16_t surcoutEnregistrement = 29; // en-tête, IV et tag d'un enregistrement TLS
+    uint16_t coupureTous = 10;           // socket fermé par le réseau un envoi sur N (0 : jamais)
+    uint16_t redemarrageServeurA = 50;   // le serveur ferme ses connexions avant cet envoi (0 : jamais)
+};
+
+struct RapportTls
+{
+    uint32_t nbPoignees = 0;
+    uint32_t octetsParEnvoi = 0;  // poignées et enregistrements, aller et retour
+    uint32_t tempsParEnvoiMs = 0; // de la décision d'envoyer à l'acquittement
+    float transactionsParEnvoi = 0;
+};
+
+extern SessionTls sessionTls;
+
+RapportTls simulerTls(const ScenarioTls &scenario, const ConfigTls &config);
+void chargerOptionsTls(const json &options);
+void afficherStatsTls();
+
+#endif // SESSION_TLS_HPP
@@ -0,0 +1,44 @@
+#ifndef SIM7080G_DEMARRAGE_HPP
+#define SIM7080G_DEMARRAGE_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "SIM7080G_POWER.hpp"
+#include "ROM.hpp"
+
+// Etat du modem relevé au démarrage
+struct SondeModem
+{
+    bool vivant = false;   // répond à AT
+    bool cfunActif = false; // +CFUN: 1
+    bool pdpActif = false; // +CNACT: 0,1,"<ip>"
+    String ip = "";
+};
+
+// Décomposition du temps de démarrage, en millisecondes depuis le reset
+struct TempsDemarrage
+{
+    unsigned long sondeMs = 0;        // AT, CFUN?, CNACT?
+    unsigned long redemarrageMs = 0;  // reboot_SIM7080G() si nécessaire
+    unsigned long identiteMs = 0;     // IMEI / CCID (cache ou modem), contrôle du CCID de la SIM en place
+    unsigned long totalMs = 0;        // fin de setup()
+    unsigned long premierEnvoiMs = 0; // fin du premier cycle d'envoi
+    bool redemarrage = false;
+    bool identiteEnCache = false;
+    bool simChangee = false;  // CCID différent de celui du cache : profil réseau refait
+    bool reseauPret = false;
+    bool configConnue = false;
+};
+
+extern TempsDemarrage tempsDemarrage;
+
+SondeModem sonderModem();
+String parseCCID(const String &reponse);
+String parseIpCNACT(const String &reponse);
+void demarrerModem();
+void memoriserConfigReseau();
+void enregistrerPremierEnvoi();
+void afficherTempsDemarrage();
+
+#endif // SIM7080G_DEMARRAGE_HPP
@@ -6,12 +6,16 @@
 #include "SIM7080G_POWER.hpp"
 
 // Declaration of external variables (if used in several files)
+extern uint32_t octetsUartEmis;
+extern uint32_t octetsUartRecus;
+extern uint32_t nbTransactionsAT;
 
 // Declaration of functions
 String Send_AT(String message, long delay = 1000);
 
 #ifdef UNIT_TEST
 extern void (*SendATTestHook)(const String &, long);
+extern String (*SendATResponseHook)(const String &, long);
 #endif
 
 #endif // SIM7080G_SERIAL_HPP
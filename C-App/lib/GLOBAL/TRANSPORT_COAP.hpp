@@ -0,0 +1,160 @@
+#ifndef TRANSPORT_COAP_HPP
+#define TRANSPORT_COAP_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "ENVOI_FRAGMENTE.hpp"
+#include <vector>
+
+#define COAP_PORT 5683 // port par défaut de ConfigCoap
+#define COAP_URI "gps"
+#define TAILLE_MAX_COAP 1152 // RFC 7252 §4.6 : un datagramme sans fragmentation IP
+#define TAILLE_LIGNE_COAP TAILLE_LIGNE_URC
+
+// En-tête CoAP (RFC 7252)
+#define COAP_CON 0
+#define COAP_NON 1
+#define COAP_ACK 2
+#define COAP_RST 3
+#define COAP_POST 0x02
+#define COAP_CHANGED 0x44 // 2.04
+#define COAP_FORMAT_CBOR 60
+
+enum EtatCoap : uint8_t
+{
+    COAP_INACTIF,
+    COAP_EN_COURS,
+    COAP_TERMINE,
+    COAP_ECHEC
+};
+
+struct ConfigCoap
+{
+    bool actif = false;                // true : envois en CoAP confirmable sur UDP à la place du pipeline TCP
+    String hote;                       // serveur CoAP (vide : aucun, les envois restent sur TCP)
+    uint16_t port = COAP_PORT;
+    unsigned long ackTimeoutMs = 4000; // RFC 7252 : 2 s ; CAT-M1 : RTT jusqu'à 2 s en couverture étendue
+    uint8_t facteurAleatoirePct = 50;  // ACK_RANDOM_FACTOR 1,5
+    uint8_t maxRetransmissions = 3;    // RFC 7252 : 4 ; au-delà, le lot est repris au cycle suivant
+};
+
+struct StatsCoap
+{
+    uint32_t nbMessages = 0;
+    uint32_t nbRetransmissions = 0;
+    uint32_t nbEchecs = 0;
+    uint32_t nbReset = 0;         // RST du serveur
+    uint64_t octetsEmis = 0;      // datagrammes CoAP, retransmissions comprises
+    uint64_t octetsRecus = 0;
+    uint64_t rttCumuleMs = 0;     // du premier envoi à l'acquittement
+    uint32_t rttMaxMs = 0;
+};
+
+struct MessageCoap
+{
+    uint8_t type = COAP_CON;
+    uint8_t code = 0;
+    uint16_t messageId = 0;
+    uint8_t tkl = 0;
+    uint8_t token[8] = {0};
+    std::vector<uint8_t> charge;
+};
+
+void encoderCoap(const MessageCoap &message, const char *uriPath, std::vector<uint8_t> &datagramme);
+bool decoderCoap(const uint8_t *donnees, size_t n, MessageCoap &message);
+
+// Requête POST confirmable portant le message CBOR ; l'acquittement du serveur porte sa réponse (options).
+class TransportCoap
+{
+public:
+    ConfigCoap config;
+    StatsCoap stats;
+    size_t (*sortie)(const uint8_t *donnees, size_t taille) = nullptr; // nullptr : UART du modem
+
+    TransportCoap();
+    void reinitialiser();
+
+    bool accepte(size_t taille) const;
+    unsigned long tirerDelaiInitial() const;
+    unsigned long delaiAcquittement(uint8_t tentative) const { return delaiInitialMs << tentative; }
+
+    void commencer(const uint8_t *cbor, size_t taille, unsigned long maintenant);
+    void traiter(const char *donnees, size_t n, unsigned long maintenant);
+    bool recevoir(const String &reponse, unsigned long maintenant);
+    EtatCoap pomper(unsigned long maintenant);
+    EtatCoap etat() const { return etatCoap; }
+    const json &reponse() const { return reponseServeur; }
+    void liberer();
+
+    uint16_t prochainMessageId() const { return prochainId; }
+    void restaurerMessageId(uint16_t messageId) { prochainId = messageId; }
+
+private:
+    void emettre(unsigned long maintenant);
+    void lire(unsigned long maintenant);
+    void terminer(EtatCoap fin, unsigned long maintenant);
+
+    EnvoiFragmente envoi; // un seul fragment : le datagramme entier
+    std::vector<uint8_t> datagramme;
+    EtatCoap etatCoap;
+    bool enEcriture;
+    bool annonce;
+    uint16_t messageId;
+    uint16_t prochainId;
+    uint8_t tentative;
+    unsigned long debutMs;
+    unsigned long delaiInitialMs; // tiré une fois par message, doublé à chaque retransmission
+    unsigned long echeanceMs;
+    json reponseServeur;
+
+    char ligne[TAILLE_LIGNE_COAP];
+    uint16_t longueur;
+};
+
+// Serveur CoAP local de substitution : acquitte chaque POST, reconnaît les retransmissions, perd un datagramme sur N
+class ServeurCoapLocal
+{
+public:
+    uint8_t perteTous = 0; // 0 : aucune perte
+    json options;          // charge de l'acquittement (null : sans charge)
+    uint32_t nbRequetes = 0;
+    uint32_t nbDoublons = 0;
+    uint32_t nbPertes = 0;
+
+    bool perdu();
+    bool repondre(const uint8_t *requete, size_t n, std::vector<uint8_t> &acquittement);
+
+private:
+    uint32_t nbDatagrammes = 0;
+    bool dejaVu = false;
+    uint16_t dernierId = 0;
+};
+
+// Envois réguliers d'un message CBOR, par le pipeline TCP ou par CoAP
+struct ScenarioTransport
+{
+    uint16_t nbEnvois = 100;
+    uint16_t tailleCharge = 300;   // message CBOR d'un lot de fixes
+    uint16_t tailleReponse = 12;   // options renvoyées par le serveur
+    unsigned long rttMs = 600;
+    unsigned long rtoTcpMs = 1000; // retransmission TCP (RTO minimal)
+    uint8_t perteTous = 0;         // un paquet sur N perdu (0 : aucun)
+    unsigned long commandeAtMs = 40; // aller-retour d'une commande AT sur l'UART
+};
+
+struct RapportTransport
+{
+    float allersRetours = 0;   // par envoi
+    uint32_t octetsRadio = 0;  // par envoi : en-têtes IP/TCP ou IP/UDP, poignées de main et retransmissions comprises
+    uint32_t tempsRadioMs = 0; // par envoi : échanges réseau et commandes AT, radio connectée
+    uint32_t nbRetransmissions = 0;
+    uint32_t nbEchecs = 0;
+};
+
+extern TransportCoap transportCoap;
+
+RapportTransport simulerTransport(const ScenarioTransport &scenario, const ConfigCoap &config);
+void chargerOptionsCoap(const json &options);
+void afficherStatsCoap();
+
+#endif // TRANSPORT_COAP_HPP
@@ -0,0 +1,158 @@
+#ifndef TRANSPORT_MQTT_HPP
+#define TRANSPORT_MQTT_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include <vector>
+
+#define MQTT_PORT 1883          // port par défaut de ConfigMqtt
+#define MQTT_RACINE_TOPIC "gps/" // publication : gps/<imei>, commandes : gps/<imei>/cmd
+#define TAILLE_MAX_MQTT 1024     // AT+SMPUB : contenu de 1 à 1024 octets
+#define TAILLE_LIGNE_MQTT TAILLE_LIGNE_URC
+
+enum EtatMqtt : uint8_t
+{
+    MQTT_INACTIF,
+    MQTT_EN_COURS,
+    MQTT_TERMINE,
+    MQTT_ECHEC
+};
+
+struct ConfigMqtt
+{
+    bool actif = false;             // true : envois publiés par le client MQTT du modem à la place du pipeline TCP
+    String hote;                    // broker MQTT (vide : aucun, les envois restent sur TCP)
+    uint16_t port = MQTT_PORT;
+    bool sessionPersistante = true; // CLEANSS 0 : abonnement et commandes QoS 1 gardés par le broker hors connexion
+    uint16_t keepAliveS = 1200;     // au-delà de la période d'envoi : la connexion survit au sommeil du modem
+    unsigned long delaiMs = 10000;  // ni prompt ni OK (PUBACK) pendant ce délai : publication abandonnée
+    unsigned long trancheMs = 1000; // sommeil maximal de l'ESP32 entre deux lectures des URC +SMSUB
+};
+
+struct StatsMqtt
+{
+    uint32_t nbConnexions = 0;      // AT+SMCONN réussis
+    uint32_t nbConnexionsReprises = 0; // connexion trouvée ouverte au réveil (AT+SMSTATE?)
+    uint32_t nbAbonnements = 0;     // AT+SMSUB
+    uint32_t nbPublications = 0;
+    uint32_t nbFixesPublies = 0;
+    uint32_t nbEchecs = 0;
+    uint32_t nbDeconnexions = 0;    // +SMSTATE: 0
+    uint32_t nbCommandes = 0;       // messages CBOR reçus sur le topic de commandes et appliqués
+    uint32_t transactionsAT = 0;    // commandes AT des connexions et des publications
+    uint64_t latenceCumuleeMs = 0;  // de la connexion (ou de AT+SMPUB) au OK de la publication
+    uint32_t latenceMaxMs = 0;
+};
+
+// Publication QoS 1 des lots de fixes par le client MQTT du SIM7080G (AT+SM*), connexion gardée d'un cycle à l'autre ;
+// les commandes du serveur arrivent par l'URC +SMSUB du topic de commandes.
+class TransportMqtt
+{
+public:
+    ConfigMqtt config;
+    StatsMqtt stats;
+    size_t (*sortie)(const uint8_t *donnees, size_t taille) = nullptr; // nullptr : UART du modem
+    void (*appliquer)(const json &message) = nullptr;                 // nullptr : appliquerOptionsRecues()
+
+    TransportMqtt();
+    void reinitialiser();
+    void reconfigurer() { configure = false; }
+
+    bool accepte(size_t taille) const;
+    bool connecter(unsigned long maintenant);
+    void deconnecter();
+
+    void commencer(const uint8_t *cbor, size_t taille, uint16_t nbFixes, unsigned long maintenant);
+    void traiter(const char *donnees, size_t n, unsigned long maintenant);
+    EtatMqtt pomper(unsigned long maintenant);
+    EtatMqtt etat() const { return etatMqtt; }
+    void liberer();
+
+    bool traiterUrc(const char *ligne, unsigned long maintenant);
+    bool servir(unsigned long maintenant);
+    unsigned long reveil(unsigned long maintenant, unsigned long echeance) const;
+    bool ecouteUart() const { return config.actif && connecte && abonne; }
+
+    bool estConfigure() const { return configure; }
+    bool estConnecte() const { return connecte; }
+    bool estAbonne() const { return abonne; }
+    void restaurerSession(bool configureModem, bool abonnement);
+    String topicPublication() const;
+    String topicCommandes() const;
+
+private:
+    bool envoyer(const String &commande, long delai = 1000);
+    void ecrire(const uint8_t *donnees, size_t n);
+    void traiterLigne(unsigned long maintenant);
+    void traiterCommande(const char *ligne, unsigned long maintenant);
+    void terminer(EtatMqtt fin, unsigned long maintenant);
+
+    EtatMqtt etatMqtt;
+    bool configure; // AT+SMCONF appliqués au modem
+    bool connecte;
+    bool abonne;    // abonnement connu du broker (session persistante)
+    bool invite;    // AT+SMPUB écrit, prompt ">" attendu
+    bool ecrit;     // contenu écrit, OK attendu
+    const uint8_t *message;
+    size_t tailleMessage;
+    uint16_t nbFixesMessage;
+    unsigned long debutMs;
+    unsigned long evenementMs;
+
+    char ligne[TAILLE_LIGNE_MQTT];
+    uint16_t longueur;
+};
+
+// Broker local de substitution, vu à travers le client MQTT du modem : réponses aux commandes AT+SM*,
+// session persistante (abonnements et commandes QoS 1 gardés hors connexion) ou propre.
+class BrokerMqttLocal
+{
+public:
+    bool connecte = false;
+    std::vector<String> abonnements;
+    std::vector<std::vector<uint8_t>> publications; // contenus reçus, dans l'ordre
+    uint32_t nbConnexions = 0;
+    uint32_t nbCommandesLivrees = 0;
+    uint32_t nbCommandesPerdues = 0; // client non abonné ou session propre fermée
+
+    String traiter(const String &commande);
+    bool publier(const String &topic, const uint8_t *contenu, size_t taille);
+    String commander(const String &topic, const json &options);
+    void couper();
+
+private:
+    String urc(const String &topic, const std::vector<uint8_t> &contenu) const;
+    bool abonne(const String &topic) const;
+
+    bool sessionPropre = false;
+    std::vector<std::pair<String, std::vector<uint8_t>>> enAttente; // commandes reçues hors connexion
+};
+
+// Envois périodiques d'un lot de fixes et commandes du serveur, connexion coupée de temps en temps
+struct ScenarioMqtt
+{
+    uint16_t nbCycles = 100;
+    uint8_t fixesParLot = MAX_COORDS;
+    unsigned long rttMs = 600;
+    unsigned long commandeAtMs = 40; // aller-retour d'une commande AT sur l'UART
+    uint16_t coupureTous = 10;       // connexion perdue un cycle sur N, après l'envoi (0 : jamais)
+    uint16_t commandeTous = 3;       // une commande du serveur un cycle sur N, après la coupure éventuelle
+};
+
+struct RapportMqtt
+{
+    float transactionsParFix = 0;
+    uint32_t latencePublicationMoyenneMs = 0; // de la première commande AT de l'envoi à sa confirmation
+    uint32_t latencePublicationMaxMs = 0;
+    uint32_t nbConnexions = 0;
+    uint32_t nbCommandesLivrees = 0;
+    uint32_t nbCommandesPerdues = 0;
+};
+
+extern TransportMqtt transportMqtt;
+
+RapportMqtt simulerMqtt(const ScenarioMqtt &scenario, const ConfigMqtt &config);
+void chargerOptionsMqtt(const json &options);
+void afficherStatsMqtt();
+
+#endif // TRANSPORT_MQTT_HPP
@@ -0,0 +1,86 @@
+#ifndef ACCEPTATION_FIX_HPP
+#define ACCEPTATION_FIX_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "GEODESIE.hpp"
+#include "ECHANTILLONNAGE.hpp"
+
+enum RaisonRejet
+{
+    FIX_ACCEPTE,
+    REJET_POSITION,   // latitude / longitude absentes ou nulles
+    REJET_HDOP,
+    REJET_SATELLITES,
+    REJET_CN0,
+    REJET_SAUT,       // déplacement impossible depuis le dernier fix accepté
+    NB_RAISONS_REJET
+};
+
+struct ConfigAcceptation
+{
+    bool actif = true;
+    int16_t hdopMaxDixiemes = 100;   // remplacé par gnssOptions.precision quand l'option est active
+    int8_t satellitesMin = 4;
+    int8_t cn0Min = 20;              // dB-Hz
+    uint16_t vitesseMaxKmh = 200;    // au-delà, le saut est jugé impossible
+    uint32_t margeSautM = 50;        // tolérance ajoutée à la distance atteignable
+    uint8_t sautsAvantReprise = 3;   // sauts consécutifs et concordants acceptés comme nouvelle position
+    bool lissage = false;            // filtre alpha-beta sur les fixes acceptés
+    uint8_t alphaQ8 = 128;           // gain de position (x 1/256)
+    uint8_t betaQ8 = 32;             // gain de vitesse (x 1/256)
+};
+
+struct StatsAcceptation
+{
+    uint32_t nbEvalues = 0;
+    uint32_t nbAcceptes = 0;
+    uint32_t nbReprises = 0; // sauts finalement acceptés (le récepteur avait raison)
+    uint32_t rejets[NB_RAISONS_REJET] = {0};
+};
+
+// Filtre alpha-beta en virgule fixe, dans le plan tangent d'un point de référence (mm, mm/s)
+class FiltreAlphaBeta
+{
+public:
+    FiltreAlphaBeta();
+    void reinitialiser();
+    void filtrer(Echantillon &e, uint8_t alphaQ8, uint8_t betaQ8);
+
+private:
+    bool initialise;
+    int32_t latRefE6, lonRefE6;
+    int32_t xMm, yMm;
+    int32_t vxMmS, vyMmS;
+    unsigned long tMs;
+};
+
+class AcceptationFix
+{
+public:
+    ConfigAcceptation config;
+    StatsAcceptation stats;
+
+    AcceptationFix();
+    void reinitialiser();
+    RaisonRejet evaluer(Echantillon &e);
+    int16_t hdopMaxDixiemes() const;
+
+private:
+    RaisonRejet verifier(const Echantillon &e);
+    bool atteignable(const Echantillon &depuis, const Echantillon &e) const;
+
+    bool aDernier;
+    Echantillon dernier; // dernier fix accepté (position mesurée, avant lissage)
+    Echantillon saut;    // dernier saut rejeté : les suivants doivent en être proches pour le confirmer
+    uint8_t nbSauts;
+    FiltreAlphaBeta filtre;
+};
+
+extern AcceptationFix acceptationFix;
+
+bool accepterFix(Gnss &gnss, unsigned long tMs);
+const char *nomRaisonRejet(RaisonRejet raison);
+void afficherStatsAcceptation();
+
+#endif // ACCEPTATION_FIX_HPP
@@ -0,0 +1,111 @@
+#ifndef ASSISTANCE_GNSS_HPP
+#define ASSISTANCE_GNSS_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "SIM7080G_SERIAL.hpp"
+
+#define URL_XTRA "http://iot2.xtracloud.net/xtra3gr_72h.bin"
+#define FICHIER_XTRA "/customer/Xtra3.bin"
+#define NB_CLASSES_TTFF 7
+
+// Constellations utilisées par le récepteur (AT+CGNSMOD=<gps>,<glonass>,<beidou>,<galileo>,<qzss>)
+struct Constellations
+{
+    bool gps = true;
+    bool glonass = false;
+    bool beidou = false;
+    bool galileo = true;
+    bool qzss = false;
+};
+
+// Type de démarrage attendu selon les données disponibles dans le récepteur
+enum TypeDemarrageGnss
+{
+    DEMARRAGE_HOT,     // éphémérides encore valides
+    DEMARRAGE_ASSISTE, // éphémérides périmées, XTRA valide
+    DEMARRAGE_COLD,    // aucune donnée d'assistance
+    NB_TYPES_DEMARRAGE
+};
+
+struct StatsAcquisition
+{
+    uint32_t histogrammeTtff[NB_CLASSES_TTFF] = {}; // voir BORNES_TTFF_MS
+    uint32_t nbAcquisitions[NB_TYPES_DEMARRAGE] = {};
+    uint32_t ttffCumuleMs[NB_TYPES_DEMARRAGE] = {};
+    uint32_t nbSansFix = 0;
+    uint32_t dernierTtffMs = 0;
+    uint32_t nbFix = 0;
+    unsigned long tempsAllumeMs = 0; // acquisitions et fenêtres d'entretien
+    uint32_t nbFenetresEntretien = 0;
+    uint32_t nbEchecsAllumage = 0;       // AT+CGNSPWR=1 refusé à l'ouverture d'une fenêtre
+    uint32_t nbEntretiensAbandonnes = 0;
+    uint32_t nbTelechargementsXtra = 0;
+    uint32_t nbEchecsXtra = 0;
+};
+
+struct AssistanceGNSS
+{
+    Constellations constellations;
+    String constellationsAppliquees = "";
+
+    // XTRA (éphémérides prédites téléchargées en LTE)
+    String urlXtra = URL_XTRA;
+    String fichierXtra = FICHIER_XTRA;
+    unsigned long validiteXtraMs = 72UL * 3600000UL;
+    unsigned long rafraichissementXtraMs = 24UL * 3600000UL;
+    bool xtraDisponible = false;
+    unsigned long xtraTelechargeMs = 0;
+
+    // Ephémérides diffusées, conservées par le récepteur tant que le modem reste alimenté
+    bool ephemeridesConnues = false;
+    unsigned long derniereFixMs = 0;
+    unsigned long validiteEphemeridesMs = 2UL * 3600000UL;
+
+    // Fenêtres d'entretien : rallumer brièvement le GNSS avant l'expiration des éphémérides
+    bool fenetresEntretien = true;
+    unsigned long dureeFenetreMs = 35000;
+    bool entretienEnCours = false;
+    bool entretienFix = false;
+    unsigned long debutEntretienMs = 0;
+    unsigned long dernierSondageMs = 0;
+    unsigned long delaiReessaiMs = 2000;   // après un AT+CGNSPWR=1 refusé, doublé à chaque échec suivant
+    uint8_t maxEchecsAllumage = 4;         // au-delà, la fenêtre est abandonnée jusqu'au prochain cycle
+    uint8_t echecsAllumage = 0;
+    unsigned long prochainEssaiMs = 0;
+
+    // Acquisition en cours (STEP_GNSS)
+    bool acquisitionEnCours = false;
+    bool premierFixRecu = false;
+    TypeDemarrageGnss typeAcquisition = DEMARRAGE_COLD;
+    unsigned long debutAcquisitionMs = 0;
+
+    StatsAcquisition stats;
+};
+
+extern AssistanceGNSS assistanceGnss;
+extern const unsigned long BORNES_TTFF_MS[NB_CLASSES_TTFF - 1];
+
+String commandeConstellations(const Constellations &c);
+void appliquerConstellations();
+
+bool xtraValide(unsigned long maintenant);
+bool xtraAMettreAJour(unsigned long maintenant);
+bool parseHttpToFs(const String &reponse, int &statut, long &taille);
+bool telechargerXtra(unsigned long maintenant);
+void mettreAJourXtraSiNecessaire(unsigned long maintenant);
+
+TypeDemarrageGnss typeDemarrageAttendu(unsigned long maintenant);
+void debutAcquisition(unsigned long maintenant);
+void enregistrerFixAcquisition(unsigned long maintenant);
+void finAcquisition(unsigned long maintenant);
+void oublierEphemerides();
+int classeTtff(unsigned long ttffMs);
+unsigned long tempsGnssParFixMs();
+
+unsigned long echeanceEntretien(unsigned long maintenant, unsigned long reveilCycleMs);
+bool entretenirEphemerides(unsigned long maintenant, unsigned long reveilCycleMs);
+
+void afficherStatsAcquisition();
+
+#endif // ASSISTANCE_GNSS_HPP
@@ -0,0 +1,223 @@
+#ifndef BASE_TEMPS_HPP
+#define BASE_TEMPS_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+
+// Calendrier grégorien proleptique, en jours depuis le 01/01/1970 (epoch Unix).
+// Fonctions constexpr à une seule expression : vérifiables par static_assert sur l'hôte comme sur la cible.
+
+#define EPOCH_2000_MS 946684800000LL // 01/01/2000 00:00:00 UTC
+#define EPOCH_MIN_MS 1577836800000LL // 01/01/2020 : en deçà, l'heure n'a pas été réglée (modem : "80/01/06")
+#define MS_PAR_JOUR 86400000LL
+
+struct DateUTC
+{
+    int32_t annee;
+    uint8_t mois;
+    uint8_t jour;
+    uint8_t heure;
+    uint8_t minute;
+    uint8_t seconde;
+    uint16_t milli;
+};
+
+constexpr bool estBissextile(int32_t annee)
+{
+    return (annee % 4 == 0 && annee % 100 != 0) || annee % 400 == 0;
+}
+
+constexpr uint8_t joursDansMois(int32_t annee, uint32_t mois)
+{
+    return mois == 2 ? (estBissextile(annee) ? 29 : 28) : (mois == 4 || mois == 6 || mois == 9 || mois == 11) ? 30 : 31;
+}
+
+// L'année calendaire commence au 1er mars : le jour intercalaire tombe en fin d'année
+constexpr int32_t ereCalendrier(int32_t anneeMars)
+{
+    return (anneeMars >= 0 ? anneeMars : anneeMars - 399) / 400;
+}
+
+constexpr int32_t jourAnneeMars(uint32_t mois, uint32_t jour)
+{
+    return (int32_t)((153 * (mois > 2 ? mois - 3 : mois + 9) + 2) / 5 + jour) - 1;
+}
+
+constexpr int32_t joursDepuisEpoqueMars(int32_t anneeEre, int32_t ere, int32_t jourAnnee)
+{
+    return ere * 146097 + anneeEre * 365 + anneeEre / 4 - anneeEre / 100 + jourAnnee - 719468;
+}
+
+constexpr int32_t joursDepuisEpoque(int32_t annee, uint32_t mois, uint32_t jour)
+{
+    return joursDepuisEpoqueMars(annee - (mois <= 2) - ereCalendrier(annee - (mois <= 2)) * 400,
+                                 ereCalendrier(annee - (mois <= 2)), jourAnneeMars(mois, jour));
+}
+
+// Opération inverse : jours depuis l'epoch -> année, mois, jour
+constexpr int32_t ereDepuisJours(int32_t jours)
+{
+    return (jours + 719468 >= 0 ? jours + 719468 : jours + 719468 - 146096) / 146097;
+}
+
+constexpr int32_t jourDansEre(int32_t jours)
+{
+    return jours + 719468 - ereDepuisJours(jours) * 146097;
+}
+
+constexpr int32_t anneeDansEre(int32_t jourEre)
+{
+    return (jourEre - jourEre / 1460 + jourEre / 36524 - jourEre / 146096) / 365;
+}
+
+constexpr int32_t jourDansAnneeMars(int32_t jourEre)
+{
+    return jourEre - (365 * anneeDansEre(jourEre) + anneeDansEre(jourEre) / 4 - anneeDansEre(jourEre) / 100);
+}
+
+constexpr uint8_t moisDepuisJourMars(int32_t jourAnnee)
+{
+    return (5 * jourAnnee + 2) / 153 < 10 ? (5 * jourAnnee + 2) / 153 + 3 : (5 * jourAnnee + 2) / 153 - 9;
+}
+
+constexpr uint8_t jourDepuisJourMars(int32_t jourAnnee)
+{
+    return jourAnnee - (153 * ((5 * jourAnnee + 2) / 153) + 2) / 5 + 1;
+}
+
+constexpr uint8_t moisDepuisJours(int32_t jours)
+{
+    return moisDepuisJourMars(jourDansAnneeMars(jourDansEre(jours)));
+}
+
+constexpr uint8_t jourDepuisJours(int32_t jours)
+{
+    return jourDepuisJourMars(jourDansAnneeMars(jourDansEre(jours)));
+}
+
+constexpr int32_t anneeDepuisJours(int32_t jours)
+{
+    return anneeDansEre(jourDansEre(jours)) + ereDepuisJours(jours) * 400 + (moisDepuisJours(jours) <= 2);
+}
+
+// Jour de la semaine, 0 = dimanche (convention de struct tm)
+constexpr uint8_t jourSemaine(int32_t jours)
+{
+    return jours >= -4 ? (jours + 4) % 7 : (jours + 5) % 7 + 6;
+}
+
+constexpr int64_t epochMs(int32_t annee, uint32_t mois, uint32_t jour, uint32_t heure, uint32_t minute, uint32_t seconde, uint32_t milli)
+{
+    return ((int64_t)joursDepuisEpoque(annee, mois, jour) * 86400 + heure * 3600 + minute * 60 + seconde) * 1000 + milli;
+}
+
+constexpr int32_t joursDepuisEpochMs(int64_t ms)
+{
+    return (int32_t)((ms >= 0 ? ms : ms - (MS_PAR_JOUR - 1)) / MS_PAR_JOUR);
+}
+
+constexpr DateUTC dateDepuisJours(int32_t jours, int64_t msDuJour)
+{
+    return DateUTC{anneeDepuisJours(jours), moisDepuisJours(jours), jourDepuisJours(jours),
+                   (uint8_t)(msDuJour / 3600000), (uint8_t)(msDuJour / 60000 % 60), (uint8_t)(msDuJour / 1000 % 60),
+                   (uint16_t)(msDuJour % 1000)};
+}
+
+constexpr DateUTC dateDepuisEpochMs(int64_t ms)
+{
+    return dateDepuisJours(joursDepuisEpochMs(ms), ms - (int64_t)joursDepuisEpochMs(ms) * MS_PAR_JOUR);
+}
+
+// Analyse et formatage sans allocation
+int64_t horodatageVersEpochMs(const char *texte, size_t longueur);
+int64_t horodatageVersEpochMs(const String &texte);
+void formaterHorodatage(int64_t epochMs, char *sortie, size_t taille);
+String epochVersHorodatage(int64_t epochMs);
+String champHorodatageJSON(int64_t epochMs);
+int64_t epochDepuisCCLK(const char *reponse);
+
+// Source de la dernière synchronisation, de la moins à la plus précise
+enum SourceTemps : uint8_t
+{
+    TEMPS_AUCUN,
+    TEMPS_SOMMEIL, // heure conservée en mémoire RTC, vieillie de la durée du deep sleep
+    TEMPS_RESEAU,  // AT+CCLK? (NITZ) ou AT+CLBS
+    TEMPS_GNSS
+};
+
+struct ConfigBaseTemps
+{
+    uint32_t incertitudeGnssMs = 500;          // CGNSINF : dernier fix à 1 Hz, lu par scrutation
+    uint32_t incertitudeReseauMs = 2000;       // AT+CCLK? : résolution d'une seconde, heure NITZ
+    uint32_t deriveEveilPpm = 30;              // quartz 40 MHz de l'ESP32-C3 (millis)
+    uint32_t deriveSommeilPpm = 20000;         // oscillateur RC de la RTC pendant le deep sleep, non calibré
+    uint32_t deriveSommeilCalibreePpm = 2000;  // ... après calibration contre le GNSS
+    int32_t correctionSommeilMaxPpm = 50000;
+    uint32_t sommeilMinCalibrationMs = 600000; // sommeil cumulé minimal pour mesurer la dérive de la RTC
+};
+
+struct StatsBaseTemps
+{
+    uint32_t nbSynchroGnss = 0;
+    uint32_t nbSynchroReseau = 0;
+    uint32_t nbIgnorees = 0;        // source moins précise que l'horloge disciplinée
+    uint32_t nbRejets = 0;          // heure absente ou antérieure à 2020
+    uint32_t nbCalibrations = 0;    // dérive de la RTC mesurée au réveil
+    uint32_t ecartMaxMs = 0;        // plus grande correction appliquée
+    uint32_t nbRetenues = 0;        // lectures maintenues pour que l'heure ne recule pas
+    uint32_t nbRequetesCclk = 0;
+    uint32_t nbRequetesEvitees = 0; // horodatages servis par l'horloge, sans AT+CCLK?
+};
+
+// Etat conservé en mémoire RTC (POD)
+struct EtatBaseTemps
+{
+    int64_t epochMs;        // heure UTC à l'endormissement (0 : non synchronisée)
+    uint32_t incertitudeMs; // hors dérive de la RTC
+    uint32_t sommeilMs;     // deep sleep cumulé depuis la dernière synchronisation
+    int32_t correctionPpm;  // dérive mesurée de la RTC
+    uint8_t source;
+    bool calibree;
+};
+
+// Horloge UTC monotone : millis() recalé par l'heure GNSS et l'heure réseau
+class BaseTemps
+{
+public:
+    ConfigBaseTemps config;
+    StatsBaseTemps stats;
+
+    BaseTemps();
+    void reinitialiser();
+
+    bool synchroniser(int64_t epochMs, unsigned long t, SourceTemps origine);
+    int64_t versEpochMs(unsigned long t) const;
+    int64_t maintenantMs(unsigned long t);
+    uint32_t incertitudeMs(unsigned long t) const;
+    bool estSynchronisee() const { return source != TEMPS_AUCUN; }
+    bool estPrecise(unsigned long t) const { return estSynchronisee() && incertitudeMs(t) <= config.incertitudeReseauMs; }
+    SourceTemps sourceCourante() const { return source; }
+    int32_t correctionSommeilPpm() const { return correctionPpm; }
+
+    EtatBaseTemps sauvegarder(unsigned long t) const;
+    void restaurer(const EtatBaseTemps &etat, uint32_t dureeSommeilMs, unsigned long t);
+
+private:
+    uint32_t incertitudeEveilMs(unsigned long t) const;
+
+    SourceTemps source;
+    int64_t ancreEpochMs;
+    unsigned long ancreMillis;
+    uint32_t incertitudeAncreMs;
+    uint32_t sommeilMs;
+    int32_t correctionPpm;
+    bool calibree;
+    int64_t dernierRenduMs;
+};
+
+extern BaseTemps baseTemps;
+
+int64_t horodatageCourantMs();
+void afficherStatsBaseTemps();
+
+#endif // BASE_TEMPS_HPP
@@ -0,0 +1,49 @@
+#ifndef CACHE_FIX_HPP
+#define CACHE_FIX_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+
+struct ConfigCacheFix
+{
+    bool actif = true;                  // false : comportement historique (chaque lecture interroge le modem)
+    unsigned long dureeEpoqueMs = 1000; // le récepteur produit un fix par seconde : une réponse plus jeune est resservie
+};
+
+struct StatsCacheFix
+{
+    uint32_t nbRequetes = 0;        // AT+CGNSINF envoyés
+    uint32_t nbRequetesEvitees = 0; // lectures servies depuis la mémoire
+    uint32_t nbEpoques = 0;         // fixes d'une nouvelle époque GNSS
+    uint32_t nbDoublons = 0;        // fixes d'une époque déjà lue, écartés avant le tampon
+};
+
+// Cache de la dernière réponse AT+CGNSINF, indexé sur l'horodatage UTC du fix
+class CacheFix
+{
+public:
+    ConfigCacheFix config;
+    StatsCacheFix stats;
+
+    CacheFix();
+    void reinitialiser();
+    void invalider();
+
+    String lire(unsigned long maintenant, long delai = 2000);
+    bool nouvelleEpoque(const String &horodatage);
+    const char *epoque() const { return epoqueLue; }
+
+private:
+    String reponse;
+    unsigned long lectureMs;
+    bool valide;
+    char epoqueLue[20];     // horodatage de la réponse en cache
+    char derniereEpoque[20]; // horodatage du dernier fix retenu
+};
+
+extern CacheFix cacheFix;
+
+bool horodatageCGNSINF(const String &reponse, char *sortie, size_t taille);
+void afficherStatsCacheFix();
+
+#endif // CACHE_FIX_HPP
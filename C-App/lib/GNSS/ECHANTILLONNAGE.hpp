@@ -0,0 +1,120 @@
+#ifndef ECHANTILLONNAGE_HPP
+#define ECHANTILLONNAGE_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "GEODESIE.hpp"
+#include "SIM7080G_GNSS.hpp"
+
+enum EtatMouvement
+{
+    MOUVEMENT_INCONNU,
+    MOUVEMENT_ARRET,
+    MOUVEMENT_DEPLACEMENT
+};
+
+enum DecisionEchantillon
+{
+    ECHANTILLON_IGNORE,
+    ECHANTILLON_GARDE,
+    ECHANTILLON_HEARTBEAT // unique point "toujours là" pendant l'arrêt
+};
+
+// Fix réduit aux champs utiles à l'échantillonnage (vitesse, cap et HDOP de CGNSINF)
+struct Echantillon
+{
+    int32_t latE6 = COORD_INVALIDE;
+    int32_t lonE6 = COORD_INVALIDE;
+    int16_t vitesseDixiemes = -1; // km/h x 10, -1 si absente
+    int16_t capDegres = -1;
+    int16_t hdopDixiemes = -1;
+    int8_t satellites = -1; // satellites utilisés
+    int8_t cn0 = -1;        // C/N0 du meilleur satellite (dB-Hz)
+    unsigned long tMs = 0;
+};
+
+struct ConfigEchantillonnage
+{
+    bool actif = true;
+    int16_t seuilArretDixiemes = 20;          // < 2 km/h : candidat à l'arrêt
+    int16_t seuilDepartDixiemes = 60;         // > 6 km/h : candidat au départ (hystérésis)
+    uint32_t rayonArretM = 25;                // dérive tolérée autour du point d'arrêt
+    unsigned long confirmationArretMs = 20000; // arrêt confirmé après ce délai sous le seuil
+    uint8_t confirmationsDepart = 2;          // échantillons rapides consécutifs pour repartir
+    int16_t hdopMaxDixiemes = 50;             // au-delà, l'échantillon ne fait pas changer d'état
+    uint32_t distanceCibleM = 40;             // espacement visé entre deux points en déplacement
+    unsigned long intervalleMinMs = 1000;
+    unsigned long intervalleMaxMs = 3000;     // intervalle historique (periodGNSS)
+    int16_t seuilVirageDegres = 30;           // changement de cap gardé immédiatement
+};
+
+struct StatsEchantillonnage
+{
+    uint32_t nbEvalues = 0;
+    uint32_t nbGardes = 0;
+    uint32_t nbHeartbeats = 0;
+    uint32_t nbIgnores = 0;
+    uint32_t nbArrets = 0;
+    uint32_t nbDeparts = 0;
+};
+
+class EchantillonneurAdaptatif
+{
+public:
+    ConfigEchantillonnage config;
+    StatsEchantillonnage stats;
+
+    EchantillonneurAdaptatif();
+    void reinitialiser();
+    void debutCycle();
+    DecisionEchantillon evaluer(const Echantillon &e);
+    unsigned long intervalleMs() const;
+    bool acquisitionTerminee() const;
+    EtatMouvement etat() const { return etatCourant; }
+
+private:
+    DecisionEchantillon garder(const Echantillon &e, DecisionEchantillon decision);
+    int16_t vitesseEstimee(const Echantillon &e) const;
+
+    EtatMouvement etatCourant;
+    Echantillon ancre;         // point d'arrêt (candidat ou confirmé)
+    bool candidatArret;
+    uint8_t nbRapides;
+    Echantillon dernier;       // dernier échantillon évalué
+    Echantillon dernierGarde;  // dernier échantillon gardé
+    bool premierDuCycle;
+    bool heartbeatEmis;
+    int16_t vitesseCourante;
+};
+
+// Paramètres d'une simulation sur trace : cycles du pipeline, avec le GNSS allumé au début de chaque cycle
+struct ScenarioTrace
+{
+    unsigned long dureeMs = 3600000UL;
+    unsigned long periodeCycleMs = 60000;
+    unsigned long ttffMs = 2000;           // hot start
+    unsigned long intervalleBaseMs = 3000; // échantillonnage historique
+    uint8_t pointsParCycle = MAX_COORDS;
+    uint16_t octetsParPoint = 64;          // taille d'un point dans le message envoyé
+};
+
+struct RapportEchantillonnage
+{
+    uint32_t fixesReference = 0;
+    uint32_t fixesAdaptatif = 0;
+    uint32_t octetsEconomises = 0;
+    unsigned long gnssReferenceMs = 0;
+    unsigned long gnssAdaptatifMs = 0;
+    uint32_t erreurMaxM = 0;   // écart entre les points de référence et la trajectoire reconstruite
+    uint32_t erreurMoyenneM = 0;
+};
+
+typedef Echantillon (*SourceTrace)(unsigned long tMs);
+
+extern EchantillonneurAdaptatif echantillonneur;
+
+Echantillon echantillonDepuisGnss(const Gnss &gnss, unsigned long tMs);
+RapportEchantillonnage simulerEchantillonnage(SourceTrace source, const ScenarioTrace &scenario, const ConfigEchantillonnage &config);
+void afficherRapportEchantillonnage(const RapportEchantillonnage &rapport);
+
+#endif // ECHANTILLONNAGE_HPP
@@ -0,0 +1,95 @@
+#ifndef FLUX_GNSS_HPP
+#define FLUX_GNSS_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "SIM7080G_GNSS.hpp"
+
+#define TAILLE_LIGNE_FLUX 160
+
+enum ModeAcquisitionGnss
+{
+    GNSS_MODE_SONDAGE, // AT+CGNSINF à chaque échantillon
+    GNSS_MODE_FLUX     // URC +UGNSINF (AT+CGNSURC) ou NMEA, lues au fil de l'eau
+};
+
+// Fix extrait d'une phrase du flux, sans allocation
+struct FixFlux
+{
+    bool valide = false;
+    char horodatage[20] = ""; // yyyyMMddhhmmss.sss
+    char latitude[16] = "";   // degrés décimaux
+    char longitude[16] = "";
+    int16_t hdopDixiemes = -1; // HDOP x 10, -1 si absent
+    int16_t vitesseKmhDixiemes = -1;
+    int16_t capDegres = -1;
+    int8_t satellites = -1;
+    int8_t cn0 = -1; // C/N0 max (dB-Hz)
+};
+
+// Parseur incrémental : reçoit les octets un par un et traite chaque ligne complète
+class ParseurFluxGnss
+{
+public:
+    ParseurFluxGnss();
+    void reinitialiser();
+    bool consommer(char c);      // true si un fix a été produit par cette ligne
+    const FixFlux &fix() const { return dernierFix; }
+
+    uint32_t nbLignes;
+    uint32_t nbPhrasesGnss;
+    uint32_t nbErreursChecksum;
+    uint32_t nbLignesTropLongues;
+
+private:
+    bool traiterLigne();
+    bool traiterUGNSINF(char *champs);
+    bool traiterRMC(char *champs);
+
+    char ligne[TAILLE_LIGNE_FLUX];
+    uint16_t longueur;
+    bool debordement;
+    FixFlux dernierFix;
+};
+
+// Compteurs d'un mode d'acquisition, pour comparer sondage et flux
+struct StatsModeGnss
+{
+    uint32_t octets = 0;       // octets UART échangés (commandes + réponses ou URC)
+    uint32_t transactions = 0; // allers-retours AT
+    uint32_t nbFix = 0;
+    unsigned long dureeMs = 0; // temps passé dans GNSS_INFO
+};
+
+struct FluxGnss
+{
+    ModeAcquisitionGnss mode = GNSS_MODE_FLUX;
+    uint8_t periodeUrc = 1;              // AT+CGNSURC=<n> : une URC tous les n fixes (1 Hz)
+    unsigned long intervalleFixMs = 0;   // écart minimal entre deux fixes gardés (0 = chaque URC)
+    bool actif = false;
+    bool premierFix = true;
+    unsigned long dernierFixMs = 0;
+    unsigned long debutInfoMs = 0;
+    StatsModeGnss statsSondage;
+    StatsModeGnss statsFlux;
+};
+
+extern FluxGnss fluxGnss;
+extern ParseurFluxGnss parseurFluxGnss;
+
+bool convertirNmeaEnDegres(const char *valeur, char hemisphere, char *sortie, size_t taille);
+Gnss gnssDepuisFix(const FixFlux &fix);
+
+bool activerFluxGnss();
+void desactiverFluxGnss();
+int traiterFluxGnss(const char *donnees, size_t taille, unsigned long maintenant);
+int pomperFluxGnss(unsigned long maintenant);
+void debutInfoGnss(unsigned long maintenant);
+void finInfoGnss(unsigned long maintenant);
+
+float echantillonsParSeconde(const StatsModeGnss &stats);
+float octetsParFix(const StatsModeGnss &stats);
+void afficherStatsFluxGnss();
+
+#endif // FLUX_GNSS_HPP
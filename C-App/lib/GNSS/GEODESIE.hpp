@@ -0,0 +1,23 @@
+#ifndef GEODESIE_HPP
+#define GEODESIE_HPP
+
+#include <Arduino.h>
+
+// Géodésie en virgule fixe (l'ESP32-C3 n'a pas d'unité flottante).
+// Les coordonnées sont en micro-degrés (1e-6°), les distances en millimètres ou en mètres.
+
+#define COORD_INVALIDE INT32_MIN
+
+int32_t degresVersE6(const char *texte);
+int32_t degresVersE6(const String &texte);
+int16_t cosQ15(int32_t latE6);
+void projeterMm(int32_t latRefE6, int32_t lonRefE6, int32_t latE6, int32_t lonE6, int32_t &xMm, int32_t &yMm);
+void deprojeterE6(int32_t latRefE6, int32_t lonRefE6, int32_t xMm, int32_t yMm, int32_t &latE6, int32_t &lonE6);
+String e6VersDegres(int32_t e6);
+uint32_t racineEntiere(uint64_t valeur);
+uint32_t distanceMm(int32_t latAE6, int32_t lonAE6, int32_t latBE6, int32_t lonBE6);
+uint32_t distanceM(int32_t latAE6, int32_t lonAE6, int32_t latBE6, int32_t lonBE6);
+int16_t ecartCapDegres(int16_t capA, int16_t capB);
+uint32_t compteurCycles();
+
+#endif // GEODESIE_HPP
@@ -0,0 +1,135 @@
+#ifndef GEOFENCE_HPP
+#define GEOFENCE_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "GEODESIE.hpp"
+
+#define MAX_GEOFENCES 256
+#define MAX_SOMMETS_GEOFENCES 1024   // sommets de polygones, tous polygones confondus
+#define MAX_SOMMETS_POLYGONE 32
+#define MAX_ENTREES_INDEX 1024
+#define NB_SEAUX_INDEX 128           // puissance de 2
+#define MAX_CELLULES_PAR_GEOFENCE 16 // au-delà, la zone est testée à chaque fix
+#define TAILLE_CELLULE_E6 10000      // 0.01° (~1.1 km en latitude)
+#define MAX_EVENEMENTS_GEOFENCE 16
+#define AUCUNE_ENTREE 0xFFFF
+
+enum TypeGeofence
+{
+    GEOFENCE_CERCLE,
+    GEOFENCE_POLYGONE
+};
+
+struct Geofence
+{
+    uint16_t id = 0;
+    uint8_t type = GEOFENCE_CERCLE;
+    uint8_t nbSommets = 0;
+    uint16_t premierSommet = 0;
+    int32_t latE6 = 0; // centre du cercle
+    int32_t lonE6 = 0;
+    uint32_t rayonM = 0;
+    int32_t latMinE6 = 0, latMaxE6 = 0, lonMinE6 = 0, lonMaxE6 = 0; // boîte englobante
+};
+
+// Entrée de l'index spatial : une zone présente dans une cellule de la grille
+struct EntreeIndex
+{
+    int16_t latCellule;
+    int16_t lonCellule;
+    uint16_t geofence;
+    uint16_t suivante; // chaînage dans le seau
+};
+
+struct EvenementGeofence
+{
+    uint16_t id = 0;
+    bool entree = true;
+    int32_t latE6 = 0;
+    int32_t lonE6 = 0;
+    unsigned long tMs = 0;
+};
+
+struct ConfigGeofence
+{
+    bool envoiSurEvenement = false;           // n'envoyer que sur entrée / sortie ...
+    unsigned long periodeHeartbeatMs = 3600000UL; // ... ou au plus tard après cette durée
+};
+
+struct StatsGeofence
+{
+    uint32_t nbEvaluations = 0;
+    uint32_t nbTests = 0;     // tests d'appartenance exacts
+    uint16_t nbTestsMax = 0;  // maximum par fix
+    uint32_t nbEntrees = 0;
+    uint32_t nbSorties = 0;
+    uint32_t nbEnvoisEvites = 0;
+};
+
+class MoteurGeofence
+{
+public:
+    ConfigGeofence config;
+    StatsGeofence stats;
+
+    MoteurGeofence();
+    void vider();
+    bool ajouterCercle(uint16_t id, int32_t latE6, int32_t lonE6, uint32_t rayonM);
+    bool ajouterPolygone(uint16_t id, const int32_t sommets[][2], uint8_t nb);
+    uint16_t nbGeofences() const { return nb; }
+    const Geofence &geofence(uint16_t indice) const { return zones[indice]; }
+
+    uint8_t evaluer(int32_t latE6, int32_t lonE6, unsigned long tMs); // nombre d'événements produits
+    bool estDedans(uint16_t indice) const { return (dedans[indice / 8] >> (indice % 8)) & 1; }
+
+    uint8_t nbEvenements() const { return nbEv; }
+    const EvenementGeofence &evenement(uint8_t i) const { return evenements[i]; }
+    void acquitterEvenements() { nbEv = 0; }
+    void noterEvenementsEnvoyes(uint8_t n) { nbEvEnvoi = n; } // les n premiers sont dans le message composé
+
+    bool envoiNecessaire(unsigned long maintenant) const;
+    void enregistrerEnvoi(unsigned long maintenant);
+    void envoiLivre(unsigned long maintenant);
+
+    // Persistance : les zones sont écrites en flash, l'état dedans / dehors suit ETAT_RTC
+    void sauvegarder() const;
+    void restaurer();
+    const uint8_t *etatDedans() const { return dedans; }
+    void restaurerDedans(const uint8_t *bits);
+
+    bool envoiFait;
+    unsigned long dernierEnvoiMs;
+
+private:
+    bool contient(const Geofence &g, int32_t latE6, int32_t lonE6) const;
+    bool indexer(uint16_t indice);
+    void reconstruireIndex();
+    void emettre(uint16_t indice, bool entree, int32_t latE6, int32_t lonE6, unsigned long tMs);
+
+    Geofence zones[MAX_GEOFENCES];
+    uint16_t nb;
+    int32_t sommets[MAX_SOMMETS_GEOFENCES][2];
+    uint16_t nbSommets;
+
+    EntreeIndex entrees[MAX_ENTREES_INDEX];
+    uint16_t nbEntrees;
+    uint16_t seaux[NB_SEAUX_INDEX];
+    uint16_t grandes[MAX_GEOFENCES]; // zones trop étendues pour l'index
+    uint16_t nbGrandes;
+
+    uint8_t dedans[MAX_GEOFENCES / 8];
+    EvenementGeofence evenements[MAX_EVENEMENTS_GEOFENCE];
+    uint8_t nbEv;
+    uint8_t nbEvEnvoi; // événements du message en cours d'envoi, acquittés à sa livraison
+};
+
+extern MoteurGeofence geofences;
+
+int32_t degresJsonVersE6(const json &valeur);
+bool chargerGeofences(const json &liste);
+void chargerOptionsGeofence(const json &options);
+String evenementsGeofenceJSON();
+void afficherStatsGeofence();
+
+#endif // GEOFENCE_HPP
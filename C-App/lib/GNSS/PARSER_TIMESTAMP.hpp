@@ -6,4 +6,6 @@ convertTimestampToLocalTime(String utcTimestamp, int timeOffset);
 
 tm convertTimestampToLocalTimeTm(String utcTimestamp, int timeOffset);
 
-tm parserTimeStamp(String utcTimestamp);
\ No newline at end of file
+tm parserTimeStamp(String utcTimestamp);
+uint32_t horodatageVersSecondes(const String &utcTimestamp);
+String secondesVersHorodatage(uint32_t secondes);
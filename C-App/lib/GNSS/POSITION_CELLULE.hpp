@@ -0,0 +1,109 @@
+#ifndef POSITION_CELLULE_HPP
+#define POSITION_CELLULE_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "GEODESIE.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "SIM7080G_GNSS.hpp"
+#include "PARSER_TIMESTAMP.hpp"
+#include "machineEtat.hpp"
+
+#define NB_CELLULES_CACHE 8
+#define TIMEOUT_CLBS_MS 30000 // AT+CLBS : réponse après l'échange avec le serveur de localisation
+
+// Cellule servante lue par AT+CPSI?
+struct IdentiteCellule
+{
+    uint32_t plmn = 0; // MCC x 1000 + MNC
+    uint32_t tac = 0;
+    uint32_t cellId = 0;
+    bool valide = false;
+};
+
+// Position associée à une cellule déjà rencontrée (POD : conservée en mémoire RTC)
+struct CelluleConnue
+{
+    uint32_t plmn;
+    uint32_t tac;
+    uint32_t cellId;
+    int32_t latE6;
+    int32_t lonE6;
+    uint32_t precisionM;
+    uint32_t utilisation; // pour remplacer la moins récemment utilisée
+};
+
+struct ConfigRepli
+{
+    bool actif = true;
+    unsigned long delaiGnssMs = 90000; // sans fix GNSS après ce délai, position réseau
+    unsigned long delaiMaxMs = 600000; // le délai double à chaque cycle sans fix GNSS, jusqu'à cette borne
+    bool clbs = true;                  // AT+CLBS (localisation par le réseau, contexte PDP requis)
+    bool cacheCellules = true;         // cellule servante (AT+CPSI?) associée aux positions déjà obtenues
+    uint32_t precisionCelluleM = 1000; // rayon attribué à une cellule apprise depuis un fix GNSS
+};
+
+struct StatsPosition
+{
+    uint32_t nbCycles = 0;
+    uint32_t nbSansPosition = 0;
+    uint32_t nbParSource[NB_SOURCES_POSITION] = {0};  // source de la première position de chaque cycle
+    uint32_t ttfpCumuleMs[NB_SOURCES_POSITION] = {0}; // temps jusqu'à la première position, par source
+    uint32_t dernierTtfpMs = 0;
+    uint32_t nbReplis = 0;
+    uint32_t nbEchecsClbs = 0;
+    uint32_t nbClbsSansPdp = 0; // AT+CLBS non tenté : contexte PDP inactif
+    uint32_t nbCellulesTrouvees = 0;
+};
+
+// Stratégie de positionnement : GNSS d'abord, position réseau grossière si le GNSS tarde
+class StrategiePosition
+{
+public:
+    ConfigRepli config;
+    StatsPosition stats;
+    CelluleConnue cellules[NB_CELLULES_CACHE];
+
+    StrategiePosition();
+    void reinitialiser();
+    void debutCycle(unsigned long maintenant);
+    void finCycle();
+    void enregistrerPosition(SourcePosition source, unsigned long maintenant);
+    bool repliNecessaire(unsigned long maintenant) const;
+    bool positionDeRepli(Gnss &sortie, unsigned long maintenant);
+    bool poursuivreClbs(Gnss &sortie, unsigned long maintenant);
+    bool repliEnCours() const { return clbsEnCours; }
+    void apprendreCellule(const IdentiteCellule &id, int32_t latE6, int32_t lonE6, uint32_t precisionM);
+    const CelluleConnue *chercherCellule(const IdentiteCellule &id);
+    unsigned long delaiCourantMs() const;
+    bool fixGnssCycle() const { return gnssCycle; }
+    uint8_t niveauDelai() const { return niveau; }
+    void restaurerNiveauDelai(uint8_t n) { niveau = n; }
+
+private:
+    void synchroniserHorloge();
+
+    bool cycleEnCours;
+    bool positionCycle;
+    bool gnssCycle;
+    bool repliTente;
+    bool clbsEnCours; // AT+CLBS lancé, GNSS éteint (STEP_GNSS, GNSS_REPLI_RESEAU)
+    IdentiteCellule celluleClbs;
+    unsigned long debutCycleMs;
+    uint8_t niveau; // nombre de doublements du délai (cycles consécutifs sans fix GNSS)
+    uint32_t horloge;
+};
+
+extern StrategiePosition strategiePosition;
+extern ATCommandTask taskCLBS;
+
+bool parserCPSI(const String &reponse, IdentiteCellule &id);
+bool parserCLBS(const String &reponse, int32_t &latE6, int32_t &lonE6, uint32_t &precisionM, String &horodatage);
+String horodatageDepuisCCLK(const String &reponse);
+IdentiteCellule lireCelluleServante();
+void memoriserCelluleServante();
+void chargerOptionsRepli(const json &options);
+const char *nomSourcePosition(SourcePosition source);
+void afficherStatsPosition();
+
+#endif // POSITION_CELLULE_HPP
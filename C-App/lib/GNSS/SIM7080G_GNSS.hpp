@@ -30,6 +30,15 @@ struct Coord
     Float_gnss latitude;
     Float_gnss longitude;
 };
+// Origine d'une position : récepteur GNSS, localisation réseau (AT+CLBS) ou cellule servante déjà connue
+enum SourcePosition : uint8_t
+{
+    SOURCE_GNSS,
+    SOURCE_CLBS,
+    SOURCE_CELLULE,
+    NB_SOURCES_POSITION
+};
+
 struct Gnss
 {
     String runStatus;
@@ -37,12 +46,20 @@ struct Gnss
     String timeStamp;
     Coord coordonnees;
     String altitude;
+    String vitesse; // km/h
+    String cap;     // degrés
+    String satellites; // satellites utilisés
+    String cn0;        // C/N0 max (dB-Hz)
     Float_gnss hdop;
+    SourcePosition source = SOURCE_GNSS;
+    uint32_t precisionM = 0; // rayon d'incertitude des positions réseau (0 : non renseigné)
     bool isValid = false;
 };
 struct DataGNSS
 {
     Gnss gnss;
+    String fragment;          // point déjà composé en JSON pendant l'acquisition (vide : à composer)
+    unsigned long tFixMs = 0; // millis() à l'ajout, pour la latence jusqu'au serveur (0 : inconnu)
 };
 
 extern DataGNSS dataGNSS[MAX_COORDS];
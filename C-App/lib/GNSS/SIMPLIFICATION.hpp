@@ -0,0 +1,75 @@
+#ifndef SIMPLIFICATION_HPP
+#define SIMPLIFICATION_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "GEODESIE.hpp"
+#include "ECHANTILLONNAGE.hpp"
+
+#define TAILLE_FENETRE_SIMPLIFICATION 32
+
+struct ConfigSimplification
+{
+    bool actif = true;
+    uint32_t toleranceM = 10;           // écart maximal d'un point supprimé au tracé simplifié
+    int16_t seuilVirageDegres = 45;     // changement de cap toujours gardé
+    int16_t seuilArretDixiemes = 20;    // < 2 km/h : à l'arrêt (début et fin d'arrêt toujours gardés)
+    uint8_t fenetreMax = TAILLE_FENETRE_SIMPLIFICATION;
+};
+
+struct StatsSimplification
+{
+    uint32_t nbEntrees = 0;
+    uint32_t nbSorties = 0;
+    uint32_t nbVirages = 0;
+    uint32_t nbArrets = 0;
+};
+
+// Point en attente dans la fenêtre, avec sa position dans le tableau d'origine
+struct PointTrajectoire
+{
+    Echantillon e;
+    uint16_t indice = 0;
+};
+
+// Simplification en ligne par fenêtre glissante (opening window) : mémoire bornée à la fenêtre,
+// chaque point est décidé au plus tard fenetreMax points après son arrivée.
+class SimplificateurTrajectoire
+{
+public:
+    ConfigSimplification config;
+    StatsSimplification stats;
+
+    SimplificateurTrajectoire();
+    void reinitialiser();
+    uint8_t ajouter(const Echantillon &e, uint16_t indice, uint16_t sortie[2]); // indices des points gardés
+    uint8_t terminer(uint16_t sortie[1]);
+
+private:
+    bool depasseTolerance(const Echantillon &e) const;
+    void emettre(const PointTrajectoire &p, uint16_t *sortie, uint8_t &n);
+
+    bool aAncre;
+    PointTrajectoire ancre;
+    PointTrajectoire fenetre[TAILLE_FENETRE_SIMPLIFICATION];
+    uint8_t nbFenetre;
+    bool arretPrecedent;
+};
+
+struct RapportSimplification
+{
+    uint32_t nbEntrees = 0;
+    uint32_t nbSorties = 0;
+    uint32_t ratioCentiemes = 0; // entrées / sorties x 100
+    uint32_t cyclesParPoint = 0;
+    uint32_t erreurMaxM = 0;     // écart maximal d'un point d'origine au tracé simplifié
+};
+
+extern SimplificateurTrajectoire simplificateur;
+
+int simplifierDataGNSS(DataGNSS *donnees, int nb);
+int simplifierTrace(const Echantillon *trace, int nb, const ConfigSimplification &config, uint16_t *gardes);
+RapportSimplification mesurerSimplification(const Echantillon *trace, int nb, const ConfigSimplification &config, uint16_t *gardes);
+void afficherRapportSimplification(const RapportSimplification &rapport);
+
+#endif // SIMPLIFICATION_HPP
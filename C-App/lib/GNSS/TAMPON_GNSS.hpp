@@ -0,0 +1,75 @@
+#ifndef TAMPON_GNSS_HPP
+#define TAMPON_GNSS_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "GEODESIE.hpp"
+#include "SIM7080G_GNSS.hpp"
+#include "PARSER_TIMESTAMP.hpp"
+
+struct ConfigTampon
+{
+    bool decimation = true;              // false : comportement historique (le plus ancien point est écrasé)
+    uint8_t maxPoints = MAX_COORDS;      // borné par MAX_COORDS
+    uint8_t placeCycle = MAX_COORDS / 2; // places libérées au début d'un cycle quand des fixes attendent encore
+    uint32_t espacementMinS = 0;         // 0 : pas de contrôle sur le temps
+    uint32_t espacementMinM = 0;         // 0 : pas de contrôle sur la distance
+};
+
+struct StatsTampon
+{
+    uint32_t nbAjouts = 0;
+    uint32_t nbFusionnes = 0;   // trop proches du point précédent (temps et distance)
+    uint32_t nbDecimations = 0; // cycles commencés avec un tampon à décimer
+    uint32_t nbSupprimes = 0;   // points fusionnés avec leurs voisins par décimation
+    uint32_t nbEcrases = 0;     // points perdus en mode historique
+};
+
+// Tampon des fixes en attente d'envoi : une fois plein, les points les plus rapprochés dans le temps sont fusionnés,
+// de sorte qu'une longue coupure reste couverte sur toute sa durée, à résolution réduite.
+class TamponGnss
+{
+public:
+    ConfigTampon config;
+    StatsTampon stats;
+
+    TamponGnss();
+    void reinitialiser();
+    bool ajouter(DataGNSS *donnees, int &nb, const Gnss &gnss);
+    void preparerCycle(DataGNSS *donnees, int &nb);
+    bool plein(int nb) const { return nb >= capacite(); }
+    bool lotPret(int nb) const;
+    int capacite() const;
+
+private:
+    int cibleCycle() const;
+    bool tropProche(const Gnss &precedent, const Gnss &gnss) const;
+    void decimer(DataGNSS *donnees, int &nb);
+};
+
+// Coupure du lien montant : un cycle d'acquisition par période, aucun envoi
+struct ScenarioPanne
+{
+    unsigned long dureePanneS = 6UL * 3600;
+    unsigned long periodeCycleS = 60;
+    unsigned long intervalleFixS = 3;
+    uint8_t pointsParCycle = MAX_COORDS;
+};
+
+struct RapportPanne
+{
+    uint32_t nbAjouts = 0;
+    uint32_t nbPoints = 0;        // points encore en attente à la fin de la coupure
+    uint32_t couvertureS = 0;     // du plus ancien au plus récent point gardé
+    uint32_t ecartMaxS = 0;       // plus grand trou sans point gardé (début et fin de coupure compris)
+    uint32_t cyclesParAjout = 0;
+};
+
+extern TamponGnss tamponGnss;
+
+RapportPanne simulerPanne(const ScenarioPanne &scenario, const ConfigTampon &config);
+void chargerOptionsTampon(const json &options);
+void afficherRapportPanne(const RapportPanne &rapport);
+void afficherStatsTampon();
+
+#endif // TAMPON_GNSS_HPP
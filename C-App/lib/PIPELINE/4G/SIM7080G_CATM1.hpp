@@ -7,5 +7,7 @@
 #include "PIPELINE_GLOBAL.hpp"
 
 void step_catm1_function();
+void catm1DemarrageRapide(bool pdpActif);
+void catm1Reconfigurer();
 String findSelect(String data, String nameStart, int numberPassAfterNameStart, String symbolToSelectStart, String symbolToEnd);
 #endif
@@ -1 +1,6 @@
-void step_compose_json_function();
\ No newline at end of file
+#pragma once
+
+#include "SIM7080G_GNSS.hpp"
+
+void step_compose_json_function();
+String fragmentJSON(const Gnss &gnss);
@@ -9,7 +9,8 @@ enum StepGNSSState
     GNSS_POWER_ON,
     GNSS_INFO,
     GNSS_POWER_OFF,
-    GNSS_DONE
+    GNSS_DONE,
+    GNSS_REPLI_RESEAU // GNSS éteint, réponse à AT+CLBS attendue (POSITION_CELLULE)
 };
 
 extern StepGNSSState gnssStepState;
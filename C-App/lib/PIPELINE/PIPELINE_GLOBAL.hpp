@@ -11,6 +11,32 @@
 #include "STEP_SEND_4G.hpp"
 #include "COMPOSE_JSON/STEP_COMPOSE_JSON.hpp"
 #include "SIM7080G_GNSS.hpp"
+#include "ENERGIE.hpp"
+#include "GESTION_PSM.hpp"
+#include "ETAT_RTC.hpp"
+#include "SIM7080G_DEMARRAGE.hpp"
+#include "ASSISTANCE_GNSS.hpp"
+#include "FLUX_GNSS.hpp"
+#include "ECHANTILLONNAGE.hpp"
+#include "SIMPLIFICATION.hpp"
+#include "GEOFENCE.hpp"
+#include "ACCEPTATION_FIX.hpp"
+#include "TAMPON_GNSS.hpp"
+#include "POSITION_CELLULE.hpp"
+#include "ARBITRE_RADIO.hpp"
+#include "BASE_TEMPS.hpp"
+#include "CACHE_FIX.hpp"
+#include "SESSION_RESEAU.hpp"
+#include "QUALITE_LIEN.hpp"
+#include "ENVOI_FRAGMENTE.hpp"
+#include "ECOUTE_DESCENDANTE.hpp"
+#include "MULTIPLEXEUR_SOCKETS.hpp"
+#include "TRANSPORT_COAP.hpp"
+#include "TRANSPORT_MQTT.hpp"
+#include "CACHE_DNS.hpp"
+#include "SESSION_TLS.hpp"
+#include "REPRISE_ENVOI.hpp"
+#include "AIGUILLAGE_URC.hpp"
 
 enum PipelineGLOBAL
 {
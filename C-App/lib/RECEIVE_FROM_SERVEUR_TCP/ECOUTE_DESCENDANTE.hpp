@@ -0,0 +1,94 @@
+#ifndef ECOUTE_DESCENDANTE_HPP
+#define ECOUTE_DESCENDANTE_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+
+#define TAILLE_LIGNE_ECOUTE 48
+
+struct ConfigEcoute
+{
+    bool actif = true;               // false : comportement historique (receive() après l'envoi, sans écoute)
+    unsigned long trancheMs = 1000;  // sommeil maximal de l'ESP32 entre deux lectures des URC
+    uint16_t tailleLecture = 256;    // octets demandés par AT+CARECV
+    unsigned long attenteMinMs = 4000; // modem en PSM : écoute limitée au temps actif (T3324), au moins ce délai
+    unsigned long lectureMaxMs = 30000; // AT+CARECV au moins à cet intervalle, même sans annonce lue (0 : jamais)
+};
+
+struct StatsEcoute
+{
+    uint32_t nbSessions = 0;
+    uint32_t nbAnnonces = 0;      // URC +CADATAIND reçues
+    uint32_t nbLectures = 0;      // AT+CARECV envoyés
+    uint32_t nbLecturesSansAnnonce = 0; // réveil par le modem ou lectureMaxMs écoulé : l'URC a pu être perdue
+    uint32_t nbCommandes = 0;     // messages CBOR décodés et appliqués
+    uint32_t nbFermeturesDistantes = 0; // +CASTATE: 0,0 (serveur ou réseau)
+    uint64_t latenceCumuleeMs = 0; // de l'URC à l'application de la commande
+    uint32_t latenceMaxMs = 0;
+};
+
+// Session d'écoute descendante sur le socket de contrôle (MULTIPLEXEUR_SOCKETS) pendant l'attente du cycle suivant :
+// le modem joignable dans ses fenêtres de paging eDRX annonce les données reçues par +CADATAIND.
+class EcouteDescendante
+{
+public:
+    ConfigEcoute config;
+    StatsEcoute stats;
+    void (*appliquer)(const json &message) = nullptr; // nullptr : appliquerOptionsRecues()
+
+    EcouteDescendante();
+    void reinitialiser();
+
+    void ouvrir(unsigned long maintenant, unsigned long dureeMaxMs = 0);
+    void fermer();
+    void terminer(unsigned long maintenant);
+    void traiterLigne(const char *ligne, unsigned long maintenant);
+    void traiter(const char *donnees, size_t n, unsigned long maintenant);
+    bool recevoir(const String &reponse, unsigned long maintenant);
+    bool servir(unsigned long maintenant);
+    unsigned long reveil(unsigned long maintenant, unsigned long echeance) const;
+
+    bool estOuverte() const { return ouverte; }
+    uint8_t socket() const { return cid; }
+    bool donneesAnnoncees() const { return annonce; }
+
+private:
+    bool ouverte;
+    uint8_t cid;
+    bool annonce;
+    unsigned long annonceMs;
+    unsigned long finMs; // 0 : jusqu'au prochain envoi
+    unsigned long lectureMs; // dernier AT+CARECV
+    char ligne[TAILLE_LIGNE_ECOUTE];
+    uint8_t longueur;
+};
+
+// Commandes émises par un serveur local pendant une journée de cycles réguliers
+struct ScenarioDescendant
+{
+    unsigned long dureeS = 24UL * 3600;
+    unsigned long periodeS = 30;             // periodeAjustement
+    unsigned long dureeCycleS = 40;          // fenêtre GNSS et envoi : la radio n'est pas joignable
+    unsigned long intervalleCommandeS = 997; // une commande toutes les ~17 min, sans lien avec la période
+    unsigned long cycleEdrxMs = 10240;       // cycle eDRX accordé pour une période de 30 s
+    unsigned long rttMs = 600;               // aller-retour CAT-M1 (données puis AT+CARECV)
+    unsigned long lectureHistoriqueMs = 6000; // receive() : deux lectures séparées de delay(3000)
+};
+
+struct RapportDescendant
+{
+    uint32_t nbCommandes = 0;
+    uint32_t latenceMoyenneMs = 0; // de l'émission par le serveur à l'application
+    uint32_t latenceMaxMs = 0;
+    uint32_t nbCommandesEcoute = 0;     // commandes annoncées par +CADATAIND pendant l'écoute
+    uint32_t latenceEcouteMoyenneMs = 0;
+    float reveilsParHeure = 0;     // tranches de sommeil de l'ESP32 pendant l'écoute
+};
+
+extern EcouteDescendante ecouteDescendante;
+
+RapportDescendant simulerCommandes(const ScenarioDescendant &scenario, const ConfigEcoute &config);
+void chargerOptionsEcoute(const json &options);
+void afficherStatsEcoute();
+
+#endif // ECOUTE_DESCENDANTE_HPP
@@ -4,6 +4,7 @@
 #include "SIM7080G_CATM1.hpp"
 #include "RECEIVE_FROM_SERVEUR_TCP/receiveCBOR.hpp"
 #include "GLOBALS.hpp"
+#include "MULTIPLEXEUR_SOCKETS.hpp"
 void receive();
 
 #endif
\ No newline at end of file
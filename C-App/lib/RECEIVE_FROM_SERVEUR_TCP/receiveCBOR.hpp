@@ -8,7 +8,11 @@
 
 extern bool START_PIPELINE;
 
-// Function to read CBOR data from SIM7080G and activate flags if necessary
+// Function to read CBOR data from SIM7080G and activate flags if necessary (reponseServeur : envoi acquitté)
 void lireEtDecoderCBOR();
 
+// Octets et message CBOR de la dernière ligne "+CARECV: <longueur>,<données>" d'une réponse à AT+CARECV
+bool extraireCARECV(const String &reponse, std::vector<uint8_t> &octets);
+bool decoderCARECV(const String &reponse, nlohmann::json &message);
+
 #endif // CBOR_RECEIVER_HPP
@@ -0,0 +1,115 @@
+#ifndef ETAT_RTC_HPP
+#define ETAT_RTC_HPP
+
+#include <Arduino.h>
+#include "GLOBALS.hpp"
+#include "ENERGIE.hpp"
+#include "ASSISTANCE_GNSS.hpp"
+#include "GEOFENCE.hpp"
+#include "POSITION_CELLULE.hpp"
+#include "ARBITRE_RADIO.hpp"
+#include "BASE_TEMPS.hpp"
+
+#define ETAT_RTC_MAGIC 0x41525457UL // "ARTW"
+#define ETAT_RTC_VERSION 11
+
+// Fix compact (pas de String : le tas n'est pas conservé en deep sleep)
+struct FixRetenu
+{
+    char latitude[16];
+    char longitude[16];
+    char timeStamp[20];
+    uint8_t source; // SourcePosition
+    uint32_t precisionM;
+    uint32_t ageMs; // âge du fix à l'endormissement (0 : inconnu)
+};
+
+// Etat conservé en mémoire RTC pendant le deep sleep.
+// Structure POD sans constructeur : une initialisation dynamique l'écraserait à chaque réveil.
+struct EtatRetenu
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t taille;
+    uint32_t nbReveils;
+
+    // Curseur du pipeline
+    uint8_t stepGlobal;
+    uint8_t stepGnss;
+    uint8_t step4G;
+    uint8_t stepCBOR;
+
+    // Lot de fixes en attente d'envoi
+    uint8_t nbFix;
+    FixRetenu fixes[MAX_COORDS];
+
+    // Session réseau
+    char imei[16];
+    bool psmAccorde;
+    uint32_t tauS;
+    uint32_t actifS;
+    bool edrxAccorde;
+    uint32_t edrxMs;
+
+    // Timers : âge de chaque timer au moment de l'endormissement
+    uint32_t periodeAjustement;
+    uint32_t agePeriod10min;
+    uint32_t agePeriodGNSS;
+    uint32_t dureeSommeilMs;
+
+    // Options reçues du serveur
+    bool precisionActive;
+    int32_t precision;
+
+    // Assistance GNSS : âge des données conservées par le récepteur
+    bool xtraDisponible;
+    bool ephemeridesConnues;
+    uint32_t ageXtraMs;
+    uint32_t ageDerniereFixMs;
+    char constellationsAppliquees[24];
+    uint8_t statsGnss[sizeof(StatsAcquisition)];
+
+    // Géofences : état dedans / dehors et dernier envoi (les zones sont en flash)
+    uint8_t geofencesDedans[MAX_GEOFENCES / 8];
+    bool envoiGeofenceFait;
+    uint32_t ageEnvoiGeofenceMs;
+
+    // Repli réseau : cellules associées à une position et délai accordé au GNSS
+    CelluleConnue cellules[NB_CELLULES_CACHE];
+    uint8_t niveauDelaiRepli;
+
+    // Arbitre radio : GNSS laissé allumé pendant le sommeil, âge de la dernière fenêtre LTE
+    bool gnssMaintenuAllume;
+    bool fenetreLteFaite;
+    uint32_t ageFenetreLteMs;
+
+    // CoAP : prochain Message ID (un identifiant réutilisé serait pris pour une retransmission)
+    uint16_t coapMessageId;
+
+    // MQTT : configuration écrite au modem, abonnement connu du broker (session persistante)
+    bool mqttConfigure;
+    bool mqttAbonne;
+
+    // TLS : contexte SSL et cid configurés dans le modem
+    bool tlsConfigure;
+    uint8_t tlsCids;
+
+    // Heure UTC à l'endormissement et dérive mesurée de la RTC
+    EtatBaseTemps temps;
+
+    // Comptabilité énergétique (copie binaire)
+    uint8_t energie[sizeof(ComptabiliteEnergie)];
+
+    uint32_t crc;
+};
+
+extern unsigned long latenceRepriseUs;
+
+void sauvegarderEtatRTC(unsigned long dureeSommeilMs);
+bool etatRTCValide();
+void appliquerEtatRTC();
+bool restaurerEtatRTC();
+void invaliderEtatRTC();
+uint32_t crc32Etat(const uint8_t *data, size_t taille);
+
+#endif // ETAT_RTC_HPP
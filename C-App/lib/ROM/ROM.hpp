@@ -6,13 +6,28 @@
 #include "SIM7080G_GNSS.hpp"
 
 // Size of EEPROM used
-#define EEPROM_SIZE 256
+#define EEPROM_SIZE 1024
 
 // Fixed addresses for data
 #define ADDR_SIM_ID 0
 #define ADDR_LATITUDE 10
 #define ADDR_LONGITUDE 20
 #define ADDR_TIMESTAMP 30
+#define ADDR_CACHE_DEMARRAGE 128
+#define ADDR_CACHE_DNS 256 // CacheDnsPersistant (CACHE_DNS)
+
+#define CACHE_DEMARRAGE_MAGIC 0x424F4F54UL // "BOOT"
+
+// Identité et configuration réseau mémorisées pour accélérer le démarrage
+struct CacheDemarrage
+{
+    uint32_t magic;
+    char imei[16];
+    char ccid[24];
+    char apn[32];
+    bool configReseau; // profil CAT-M1 (CNMP, CMNB, CGDCONT, CNCFG) déjà appliqué au modem
+    uint32_t crc;
+};
 
 // Function to write a uint32_t to EEPROM
 void writeUInt32(int addr, uint32_t val);
@@ -49,4 +64,10 @@ void writeSimIdToEEPROM(const String &simId);
 
 String readSimIdFromEEPROM();
 
+bool lireCacheDemarrage(CacheDemarrage &cache);
+
+void ecrireCacheDemarrage(CacheDemarrage &cache);
+
+void effacerCacheDemarrage();
+
 #endif
@@ -7,9 +7,24 @@
  * Cette fonction envoie la commande AT+CACLOSE pour fermer la connexion TCP avec le serveur.
  * Elle utilise la machine d'état pour vérifier que la fermeture est bien prise en compte.
  * Une fois la connexion fermée, elle réinitialise l'état de la tâche et passe à l'étape finale du pipeline (STEP_END).
+ * Un socket de l'envoi partagé avec l'écoute descendante n'est pas fermé : STEP_OPEN_CONNEXION le fermera avant
+ * l'envoi suivant. Le socket de contrôle séparé (MULTIPLEXEUR_SOCKETS) n'est jamais fermé ici.
+ * Un socket TLS (SESSION_TLS) reste ouvert pour l'envoi suivant : sa poignée de main n'est pas refaite.
  */
 void STEP_CLOSE_CONNEXION_FUNCTION()
 {
+    if (ecouteDescendante.estOuverte() && ecouteDescendante.socket() == multiplexeurSockets.cid(CANAL_ENVOI))
+    {
+        energie.setEtatLte(LTE_IDLE, millis());
+        currentStepCBOR = STEP_END;
+        return;
+    }
+    if (sessionTls.terminerEnvoi(millis()))
+    {
+        energie.setEtatLte(LTE_IDLE, millis());
+        currentStepCBOR = STEP_END;
+        return;
+    }
     if (chrono(100))
     {
         Serial.println("[STEP_CLOSE_CONNEXION] init");
@@ -19,6 +34,8 @@ void STEP_CLOSE_CONNEXION_FUNCTION()
             Serial.println("[STEP_CLOSE_CONNEXION] success");
             taskCBOR_CLOSE.state = IDLE;
             taskCBOR_CLOSE.isFinished = false;
+            multiplexeurSockets.marquer(CANAL_ENVOI, false);
+            energie.setEtatLte(LTE_IDLE, millis());
             currentStepCBOR = STEP_END;
         }
     }
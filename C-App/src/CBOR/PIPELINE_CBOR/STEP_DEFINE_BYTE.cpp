@@ -8,9 +8,20 @@
  * Elle utilise la machine d'état pour surveiller la réponse à cette commande.
  * Si la commande est validée, elle passe à l'étape suivante du pipeline (STEP_WRITE) et réinitialise le timer du pipeline CBOR.
  * Cette étape est essentielle pour s'assurer que le module est prêt à recevoir les données CBOR.
+ *
+ * Avec l'envoi fragmenté (ENVOI_FRAGMENTE), elle écrit l'en-tête AT+CASEND du premier fragment sans attendre le chrono :
+ * STEP_WRITE lit ensuite les prompts au fil du flux. La taille du lot sert à estimer quand le suivant remplira un fragment.
  */
 void STEP_DEFINE_BYTE_FUNCTION()
 {
+    if (envoiFragmente.config.actif)
+    {
+        energie.setEtatLte(LTE_TX, millis());
+        envoiFragmente.mesurerLot(cborDataPipeline.size(), nbCoordonnees);
+        envoiFragmente.commencer(cborDataPipeline.data(), cborDataPipeline.size(), millis());
+        currentStepCBOR = STEP_WRITE;
+        return;
+    }
     if (chrono(1000))
     {
         Serial.println("[STEP_DEFINE_BYTE] init [STEP_DEFINE_BYTE] init [STEP_DEFINE_BYTE] init [STEP_DEFINE_BYTE] init [STEP_DEFINE_BYTE] init ");
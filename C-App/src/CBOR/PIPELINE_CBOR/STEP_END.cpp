@@ -6,7 +6,9 @@
  *
  * Cette fonction marque la fin du pipeline CBOR : elle affiche un message de fin, réinitialise l'étape courante à STEP_INIT_CBOR,
  * remet à zéro les variables et buffers utilisés pour l'envoi CBOR, et prépare la liste des coordonnées pour un nouvel envoi.
- * Si des coordonnées restent à envoyer, elle marque la première comme terminée et décale la liste.
+ * Les coordonnées contenues dans le message envoyé sont retirées du lot (ARBITRE_RADIO, qui mesure leur latence
+ * depuis leur acquisition) ; celles ajoutées après la composition du message restent en attente.
+ * Le compte des échecs du lot (REPRISE_ENVOI) repart de zéro, les événements de géofence du message sont acquittés.
  */
 void STEP_END_FUNCTION()
 {
@@ -20,14 +22,8 @@ void STEP_END_FUNCTION()
         command = "";
         cborDataPipeline.clear();
 
-        if (nbCoordonnees > 0)
-        {
-            listeCoordonnees[0].endCBOR = true;
-            for (int i = 1; i < nbCoordonnees; ++i)
-            {
-                listeCoordonnees[i - 1] = listeCoordonnees[i];
-            }
-            nbCoordonnees--;
-        }
+        arbitreRadio.envoiTermine(dataGNSS, nbCoordonnees, millis());
+        repriseEnvoi.envoiReussi(millis());
+        geofences.envoiLivre(millis());
     }
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "pipeline.hpp"
+
+/**
+ * @file STEP_ENVOI_COAP.cpp
+ * @brief Envoie les données CBOR en une requête CoAP confirmable et applique la réponse du serveur.
+ *
+ * Remplace, pour un message qui tient dans un datagramme, les étapes STEP_OPEN_CONNEXION à STEP_CLOSE_CONNEXION :
+ * le socket UDP (MULTIPLEXEUR_SOCKETS) est ouvert s'il ne l'est pas déjà, puis le transport CoAP (TRANSPORT_COAP)
+ * écrit la requête, attend l'acquittement et retransmet si besoin. Les options du serveur, portées par
+ * l'acquittement, sont appliquées comme celles de STEP_RECEIVE_PIPELINE.
+ * Un socket UDP refusé renvoie le message au pipeline TCP ; un échange sans acquittement reprend le traitement
+ * d'erreur de la commande AT+CASEND.
+ */
+void STEP_ENVOI_COAP_FUNCTION()
+{
+    if (transportCoap.etat() == COAP_INACTIF)
+    {
+        if (!multiplexeurSockets.ouvrir(CANAL_COAP))
+        {
+            currentStepCBOR = STEP_OPEN_CONNEXION;
+            PERIODE_CBOR = millis();
+            return;
+        }
+        Serial.println("[STEP_ENVOI_COAP] Sending CBOR...");
+        energie.setEtatLte(LTE_TX, millis());
+        transportCoap.commencer(cborDataPipeline.data(), cborDataPipeline.size(), millis());
+    }
+
+    EtatCoap etat = transportCoap.pomper(millis());
+    if (etat == COAP_EN_COURS)
+        return;
+    transportCoap.liberer();
+    if (etat == COAP_ECHEC)
+    {
+        if (taskCBOR_CASEND != nullptr && taskCBOR_CASEND->onErrorCallback != nullptr)
+            taskCBOR_CASEND->onErrorCallback(*taskCBOR_CASEND);
+        return;
+    }
+
+    Serial.println("[STEP_ENVOI_COAP] CBOR sent");
+    Serial.print("Bytes: ");
+    Serial.println(cborDataPipeline.size());
+    qualiteLien.enregistrerEnvoi(cborDataPipeline.size(), millis());
+    if (!transportCoap.reponse().is_null())
+    {
+        lastReceivedCBOR = transportCoap.reponse();
+        Serial.print("lastReceivedCBOR = ");
+        Serial.println(lastReceivedCBOR.dump().c_str());
+        appliquerOptionsRecues(lastReceivedCBOR);
+    }
+    energie.setEtatLte(LTE_IDLE, millis());
+    currentStepCBOR = STEP_END;
+    PERIODE_CBOR = millis();
+}
@@ -0,0 +1,47 @@
+#include "pipeline.hpp"
+
+/**
+ * @file STEP_ENVOI_MQTT.cpp
+ * @brief Publie les données CBOR par le client MQTT du SIM7080G.
+ *
+ * Remplace les étapes STEP_OPEN_CONNEXION à STEP_CLOSE_CONNEXION quand la publication MQTT est active
+ * (TRANSPORT_MQTT) : la connexion au broker n'est ouverte que si elle ne l'est pas déjà, puis le lot de fixes est
+ * publié en QoS 1. Il n'y a pas de réponse à lire : les commandes du serveur arrivent par l'abonnement, pendant la
+ * publication ou entre deux envois.
+ * Une connexion refusée renvoie le message au pipeline TCP ; une publication sans PUBACK reprend le traitement
+ * d'erreur de la commande AT+CASEND.
+ */
+void STEP_ENVOI_MQTT_FUNCTION()
+{
+    if (transportMqtt.etat() == MQTT_INACTIF)
+    {
+        if (!transportMqtt.connecter(millis()))
+        {
+            currentStepCBOR = STEP_OPEN_CONNEXION;
+            PERIODE_CBOR = millis();
+            return;
+        }
+        Serial.println("[STEP_ENVOI_MQTT] Publishing CBOR...");
+        energie.setEtatLte(LTE_TX, millis());
+        transportMqtt.commencer(cborDataPipeline.data(), cborDataPipeline.size(), nbCoordonnees, millis());
+    }
+
+    EtatMqtt etat = transportMqtt.pomper(millis());
+    if (etat == MQTT_EN_COURS)
+        return;
+    transportMqtt.liberer();
+    if (etat == MQTT_ECHEC)
+    {
+        if (taskCBOR_CASEND != nullptr && taskCBOR_CASEND->onErrorCallback != nullptr)
+            taskCBOR_CASEND->onErrorCallback(*taskCBOR_CASEND);
+        return;
+    }
+
+    Serial.println("[STEP_ENVOI_MQTT] CBOR published");
+    Serial.print("Bytes: ");
+    Serial.println(cborDataPipeline.size());
+    qualiteLien.enregistrerEnvoi(cborDataPipeline.size(), millis());
+    energie.setEtatLte(LTE_IDLE, millis());
+    currentStepCBOR = STEP_END;
+    PERIODE_CBOR = millis();
+}
@@ -7,9 +7,12 @@
  *
  * Cette fonction prend un message JSON, le parse et le convertit en format binaire CBOR.
  * Elle affiche le contenu CBOR en hexadécimal sur le port série pour vérification.
- * Ensuite, elle prépare la commande AT+CASEND pour envoyer la taille des données CBOR au module SIM7080G.
- * Une tâche ATCommandTask est créée pour gérer l’envoi de cette commande, avec une gestion d’erreur personnalisée :
- * en cas d’échec, l’état du pipeline est réinitialisé et on revient à l’étape d’initialisation globale.
+ * Ensuite, elle prépare la commande AT+CASEND pour envoyer la taille des données CBOR au module SIM7080G
+ * (avec l'envoi fragmenté, ENVOI_FRAGMENTE, cette tâche ne sert plus qu'à son callback d'erreur).
+ * Une tâche ATCommandTask est créée pour gérer l’envoi de cette commande, avec une gestion d’erreur personnalisée,
+ * commune à toutes les étapes de l’envoi : en cas d’échec, le message encodé est gardé et le pipeline repart de
+ * STEP_VERIFIER_CONNEXION (REPRISE_ENVOI) ; après des échecs répétés, l’état du pipeline est réinitialisé et on
+ * revient à l’étape d’initialisation globale.
  * Enfin, la fonction passe à l’étape suivante du pipeline (STEP_VERIFIER_CONNEXION) et réinitialise le timer du pipeline CBOR.
  *
  * @param dataMessage Message JSON à convertir et envoyer.
@@ -33,7 +36,8 @@ void STEP_INIT_CBOR_FUNCTION(const char *dataMessage)
         }
         Serial.println();
         Serial.println(cborDataPipeline.size());
-        Send_AT("AT+CACFG?", 500);
+        if (!envoiFragmente.config.actif)
+            Send_AT("AT+CACFG?", 500);
         String newCommand = String("AT+CASEND=0,") + String(cborDataPipeline.size());
         Serial.println(newCommand);
 
@@ -54,11 +58,26 @@ void STEP_INIT_CBOR_FUNCTION(const char *dataMessage)
             taskCBOR_CASEND->state = IDLE;        // Reset the state of the task
             taskCBOR_CASEND->retryCount = 0;      // Reset the retry count
             taskCBOR_CASEND->isFinished = false;  // Reset the finished state
+            // Seul le socket de l'envoi est fermé : le socket de contrôle garde l'écoute
+            if (multiplexeurSockets.estOuvert(CANAL_ENVOI))
+                multiplexeurSockets.fermer(CANAL_ENVOI);
+            if (repriseEnvoi.echec(millis()) == SUITE_REPRENDRE)
+            {
+                // Message gardé : socket rouvert et AT+CASEND renvoyé, sans nouvelle fenêtre GNSS
+                Serial.println("[STEP_INIT_CBOR] reprise " + String(repriseEnvoi.echecsConsecutifs()) + "/" + String(repriseEnvoi.config.tentativesMax));
+                currentStepCBOR = STEP_VERIFIER_CONNEXION;
+                PERIODE_CBOR = millis();
+                return;
+            }
             endCBOR = true;
             currentStepGLOBAL = PipelineGLOBAL::STEP_INIT_GLOBAL;
             tableauJSONString = "";
+            // Le lot sera recomposé avec les fixes en attente : le pipeline CBOR repart de l'encodage
+            currentStepCBOR = STEP_INIT_CBOR;
+            cborDataPipeline.clear();
         };
 
+        energie.setEtatLte(LTE_CONNECTE, millis());
         currentStepCBOR = STEP_VERIFIER_CONNEXION;
         PERIODE_CBOR = millis();
     }
@@ -9,9 +9,30 @@ ATCommandTask taskCBOR_OPEN_CONNEXION("AT+CAOPEN=0,0,\"TCP\"," + (String)PINGGY_
  * Elle attend la réponse "OK" pour valider l'ouverture de la connexion.
  * Si la connexion n'est pas encore ouverte, elle met à jour l'état de la machine d'état et attend la fin de la commande.
  * Une fois la connexion ouverte, elle passe à l'étape suivante du pipeline (STEP_DEFINE_BYTE) et réinitialise les états nécessaires.
+ * Un socket de l'envoi encore en écoute (ECOUTE_DESCENDANTE, socket partagé) est d'abord lu une dernière fois puis
+ * fermé ; le socket de contrôle séparé reste ouvert pendant l'envoi.
+ * La commande vise l'adresse en cache du point d'accès choisi (CACHE_DNS) ; une tentative sans réponse est signalée
+ * au cache, qui efface l'adresse et peut passer à un autre point d'accès avant la tentative suivante ; cette tentative
+ * vise le nom d'hôte, la résolution (AT+CDNSGIP) reste hors du chemin de connexion.
+ * Avec TLS (SESSION_TLS), le cid est configuré avant l'ouverture si ce n'est déjà fait (un cid refusé, ou sans CA,
+ * n'est pas ouvert en clair : l'envoi échoue), et un socket de l'envoi laissé ouvert par l'envoi précédent est repris
+ * sans AT+CAOPEN ni poignée de main si AT+CASTATE? le donne encore connecté.
+ * Une ouverture échouée après toutes ses tentatives reprend le traitement d'erreur de la commande AT+CASEND
+ * (REPRISE_ENVOI) au lieu de poursuivre vers STEP_DEFINE_BYTE.
  */
+static unsigned long debutOuverture = 0;
+
+static String commandeOuverture()
+{
+    return "AT+CAOPEN=0,0,\"TCP\"," + cacheDns.adresse() + "," + String(cacheDns.port());
+}
+
 void STEP_OPEN_CONNEXION_FUNCTION()
 {
+    if (ecouteDescendante.estOuverte() && ecouteDescendante.socket() == multiplexeurSockets.cid(CANAL_ENVOI))
+    {
+        ecouteDescendante.terminer(millis());
+    }
 
     if (chrono(100))
     {
@@ -22,13 +43,62 @@ void STEP_OPEN_CONNEXION_FUNCTION()
         }
         if (!taskCBOR_OPEN_CONNEXION.isFinished)
         {
+            if (taskCBOR_OPEN_CONNEXION.state == IDLE && sessionTls.config.actif && multiplexeurSockets.estOuvert(CANAL_ENVOI))
+            {
+                if (sessionTls.reutiliser(millis()))
+                {
+                    Serial.println("[STEP_OPEN_CONNEXION] TLS socket kept open");
+                    currentStepCBOR = STEP_DEFINE_BYTE;
+                    PERIODE_CBOR = millis();
+                    return;
+                }
+                multiplexeurSockets.fermer(CANAL_ENVOI);
+            }
+            if (taskCBOR_OPEN_CONNEXION.state == RETRY)
+            {
+                // Pas de AT+CDNSGIP ici (jusqu'à 10 s) : la tentative suivante vise le nom d'hôte, résolu par le
+                // modem, et STEP_VERIFIER_CONNEXION remplit le cache avant l'envoi suivant
+                cacheDns.connexionEchouee(millis());
+                sessionTls.connexionEchouee();
+            }
+            if (taskCBOR_OPEN_CONNEXION.state == IDLE || taskCBOR_OPEN_CONNEXION.state == RETRY)
+            {
+                if (!sessionTls.preparer(CID_ENVOI, millis()))
+                {
+                    Serial.println("[STEP_OPEN_CONNEXION] TLS not ready, no clear-text AT+CAOPEN");
+                    taskCBOR_OPEN_CONNEXION.state = IDLE;
+                    if (taskCBOR_CASEND != nullptr && taskCBOR_CASEND->onErrorCallback != nullptr)
+                        taskCBOR_CASEND->onErrorCallback(*taskCBOR_CASEND);
+                    return;
+                }
+                taskCBOR_OPEN_CONNEXION.command = commandeOuverture();
+            }
+            if (taskCBOR_OPEN_CONNEXION.state == SENDING)
+            {
+                cacheDns.debutConnexion(millis());
+                debutOuverture = millis();
+            }
             machineCBOR.updateATState(taskCBOR_OPEN_CONNEXION);
             currentTaskCBOR = &taskCBOR_OPEN_CONNEXION;
             PERIODE_CBOR = millis();
         }
+        else if (taskCBOR_OPEN_CONNEXION.state != END)
+        {
+            Serial.println("[STEP_OPEN_CONNEXION] failed");
+            cacheDns.connexionEchouee(millis());
+            sessionTls.connexionEchouee();
+            taskCBOR_OPEN_CONNEXION.state = IDLE;
+            taskCBOR_OPEN_CONNEXION.isFinished = false;
+            resetCommandOPEN_CONNEXION = false;
+            if (taskCBOR_CASEND != nullptr && taskCBOR_CASEND->onErrorCallback != nullptr)
+                taskCBOR_CASEND->onErrorCallback(*taskCBOR_CASEND);
+        }
         else
         {
             Serial.println("[STEP_OPEN_CONNEXION] success");
+            cacheDns.connexionReussie(millis());
+            sessionTls.connexionOuverte(debutOuverture, millis());
+            multiplexeurSockets.marquer(CANAL_ENVOI, true);
             currentStepCBOR = STEP_DEFINE_BYTE;
             PERIODE_CBOR = millis();
             taskCBOR_OPEN_CONNEXION.state = IDLE;
@@ -7,12 +7,53 @@
  * Cette fonction appelle la fonction receive() pour traiter la réponse du module SIM7080G après l'envoi des données CBOR.
  * Elle utilise des indicateurs pour savoir si la réception est terminée ou si elle doit rester dans cette étape.
  * Une fois la réception terminée, elle passe à l'étape suivante du pipeline (STEP_CLOSE_CONNEXION).
+ * Avec l'écoute descendante (ECOUTE_DESCENDANTE), le socket de contrôle (MULTIPLEXEUR_SOCKETS) est ouvert s'il ne
+ * l'est pas déjà et reste ouvert pour les commandes du serveur : la réponse à l'envoi est lue une fois, sans rouvrir
+ * le socket ni attendre, les données suivantes sont annoncées par +CADATAIND. Modem en PSM, l'écoute est limitée au
+ * temps actif accordé.
+ * Avec la reprise des envois (REPRISE_ENVOI), la réponse du serveur acquitte le lot : tant qu'elle manque, AT+CARECV
+ * est relu toutes les 500 ms ; sans réponse après attenteReponseMs (ou refusé par le serveur), l'envoi échoue et
+ * passe par le traitement d'erreur de AT+CASEND au lieu d'être compté comme livré par STEP_END.
  */
+static unsigned long debutReponse = 0;
+
+static void echecReponse()
+{
+    Serial.println("[STEP_RECEIVE] no reply from the server, batch not acknowledged");
+    stepReceiveFunctionBoolean = true; // la reprise relira la réponse depuis le début
+    if (taskCBOR_CASEND != nullptr && taskCBOR_CASEND->onErrorCallback != nullptr)
+        taskCBOR_CASEND->onErrorCallback(*taskCBOR_CASEND);
+    else
+        currentStepCBOR = STEP_CLOSE_CONNEXION;
+}
+
 void STEP_RECEIVE_FUNCTION()
 {
     if (stepReceiveFunctionBoolean)
     {
-        receive();
+        reponseServeur = false;
+        debutReponse = millis();
+        energie.setEtatLte(LTE_CONNECTE, millis());
+        if (ecouteDescendante.config.actif)
+        {
+            unsigned long dureeMaxMs = 0;
+            if (gestionPSM.accorde.psmAccorde)
+            {
+                dureeMaxMs = gestionPSM.accorde.actifS * 1000UL;
+                if (dureeMaxMs < ecouteDescendante.config.attenteMinMs)
+                    dureeMaxMs = ecouteDescendante.config.attenteMinMs;
+            }
+            // Fermeture du socket de contrôle lue par un autre lecteur d'URC pendant le cycle
+            if (ecouteDescendante.estOuverte() && !multiplexeurSockets.estOuvert(CANAL_CONTROLE))
+                ecouteDescendante.fermer();
+            if (multiplexeurSockets.ouvrir(CANAL_CONTROLE))
+                ecouteDescendante.ouvrir(millis(), dureeMaxMs);
+            lireEtDecoderCBOR();
+        }
+        else
+        {
+            receive();
+        }
         stepReceiveFunctionBoolean = false;
     }
     else if (receiveMessage)
@@ -20,6 +61,16 @@ void STEP_RECEIVE_FUNCTION()
         currentStepCBOR = STEP_RECEIVE_PIPELINE;
         receiveMessage = false;
     }
+    else if (!reponseServeur && repriseEnvoi.config.actif)
+    {
+        if (millis() - debutReponse >= repriseEnvoi.config.attenteReponseMs)
+            echecReponse();
+        else if (chrono(500))
+        {
+            lireEtDecoderCBOR();
+            PERIODE_CBOR = millis();
+        }
+    }
     else
     {
         currentStepCBOR = STEP_CLOSE_CONNEXION;
@@ -5,9 +5,21 @@
  * @brief Traite les messages CBOR reçus après l'envoi des données.
  *
  * Cette fonction analyse le contenu du dernier message CBOR reçu (lastReceivedCBOR) et adapte dynamiquement les options du pipeline :
- * - ajuste la période d'envoi si l'option "periode" est reçue,
+ * - ajuste la période d'envoi si l'option "periode" est reçue (et renégocie les timers PSM / eDRX),
  * - démarre le pipeline si l'option "start" est reçue,
- * - met à jour la précision GNSS si l'option "precision" est reçue.
+ * - met à jour la précision GNSS si l'option "precision" est reçue,
+ * - remplace les géofences si l'option "geofences" est reçue, et leurs options d'envoi avec "geofenceOptions",
+ * - règle le repli de positionnement par le réseau (délai accordé au GNSS, AT+CLBS, cache de cellules) avec l'option "repli",
+ * - règle l'arbitre radio (latence maximale d'un fix, maintien du GNSS entre deux fenêtres) avec l'option "radio",
+ * - règle les seuils de qualité du lien qui diffèrent les envois avec l'option "lien",
+ * - règle la taille des fragments AT+CASEND avec l'option "envoi",
+ * - règle l'écoute des commandes entre deux envois avec l'option "ecoute",
+ * - sépare ou non le socket de contrôle de celui des envois avec l'option "sockets",
+ * - active et règle le transport CoAP des envois avec l'option "coap",
+ * - active et règle la publication MQTT des envois avec l'option "mqtt",
+ * - active le cache DNS et règle les points d'accès du serveur avec l'option "dns",
+ * - active et règle TLS sur les sockets du serveur avec l'option "tls",
+ * - règle la reprise des envois échoués (tentatives avant de relancer le pipeline global) avec l'option "reprise".
  *
  * Elle affiche les informations reçues sur le port série pour le débogage.
  * À la fin du traitement, elle prépare la fermeture de la connexion en passant à l'étape STEP_CLOSE_CONNEXION.
@@ -19,32 +31,106 @@ void STEP_RECEIVE_PIPELINE_FUNCTION()
     Serial.print("lastReceivedCBOR = ");
     Serial.println(lastReceivedCBOR.dump().c_str());
 
+    appliquerOptionsRecues(lastReceivedCBOR);
+
+    stepReceiveFunctionBoolean = true;
+    currentStepCBOR = STEP_CLOSE_CONNEXION;
+}
+
+/**
+ * @brief Applique les options d'un message CBOR du serveur.
+ *
+ * Appelée par STEP_RECEIVE_PIPELINE pour la réponse à un envoi, et par l'écoute descendante (ECOUTE_DESCENDANTE)
+ * pour une commande reçue entre deux envois.
+ */
+void appliquerOptionsRecues(const json &options)
+{
     // Gestion dynamique des options reçues
-    if (lastReceivedCBOR.contains("periode"))
+    if (options.contains("periode"))
     {
-        periodeAjustement = lastReceivedCBOR["periode"];
+        periodeAjustement = options["periode"];
         Serial.print("[CBOR] Nouvelle periodeAjustement = ");
         Serial.println(periodeAjustement);
+        negocierPSM(calculerConfigPSM(periodeAjustement));
     }
-    if (lastReceivedCBOR.contains("start"))
+    if (options.contains("start"))
     {
-        if (lastReceivedCBOR["start"] == true)
+        if (options["start"] == true)
         {
             Serial.println("[CBOR] Option start reçue : démarrage pipeline !");
             START_PIPELINE = true;
         }
     }
-    if (lastReceivedCBOR.contains("precision"))
+    if (options.contains("precision"))
     {
-        gnssOptions.precision = lastReceivedCBOR["precision"]["valeur"];
-        gnssOptions.precisionActive = lastReceivedCBOR["precision"]["active"];
+        gnssOptions.precision = options["precision"]["valeur"];
+        gnssOptions.precisionActive = options["precision"]["active"];
         Serial.print("[CBOR] Nouvelle précision GNSS = ");
         Serial.println(gnssOptions.precision);
         Serial.print("[CBOR] Précision GNSS active = ");
         Serial.println(gnssOptions.precisionActive ? "true" : "false");
     }
+    if (options.contains("lissage"))
+    {
+        acceptationFix.config.lissage = options["lissage"].get<bool>();
+        Serial.print("[CBOR] Lissage GNSS = ");
+        Serial.println(acceptationFix.config.lissage ? "true" : "false");
+    }
+    if (options.contains("tampon"))
+    {
+        chargerOptionsTampon(options["tampon"]);
+    }
+    if (options.contains("repli"))
+    {
+        chargerOptionsRepli(options["repli"]);
+    }
+    if (options.contains("radio"))
+    {
+        chargerOptionsArbitre(options["radio"]);
+    }
+    if (options.contains("lien"))
+    {
+        chargerOptionsQualiteLien(options["lien"]);
+    }
+    if (options.contains("envoi"))
+    {
+        chargerOptionsEnvoi(options["envoi"]);
+    }
+    if (options.contains("geofences"))
+    {
+        chargerGeofences(options["geofences"]);
+    }
+    if (options.contains("geofenceOptions"))
+    {
+        chargerOptionsGeofence(options["geofenceOptions"]);
+    }
+    if (options.contains("ecoute"))
+    {
+        chargerOptionsEcoute(options["ecoute"]);
+    }
+    if (options.contains("sockets"))
+    {
+        chargerOptionsSockets(options["sockets"]);
+    }
+    if (options.contains("coap"))
+    {
+        chargerOptionsCoap(options["coap"]);
+    }
+    if (options.contains("mqtt"))
+    {
+        chargerOptionsMqtt(options["mqtt"]);
+    }
+    if (options.contains("dns"))
+    {
+        chargerOptionsDns(options["dns"]);
+    }
+    if (options.contains("tls"))
+    {
+        chargerOptionsTls(options["tls"]);
+    }
+    if (options.contains("reprise"))
+    {
+        chargerOptionsReprise(options["reprise"]);
+    }
     // Ajoute ici d'autres options à gérer selon tes besoins
-
-    stepReceiveFunctionBoolean = true;
-    currentStepCBOR = STEP_CLOSE_CONNEXION;
 }
\ No newline at end of file
@@ -8,13 +8,54 @@ ATCommandTask taskCBOR_CEREG("AT+CEREG?", "+CEREG: 0,5", 15, 100);
  * Cette fonction envoie la commande AT+CEREG? pour s’assurer que le module est bien enregistré sur le réseau (attend la réponse "+CEREG: 0,5").
  * Si la connexion n’est pas encore validée, elle met à jour l’état de la machine d’état et attend la fin de la commande.
  * Une fois la connexion confirmée, elle passe à l’étape suivante du pipeline (STEP_OPEN_CONNEXION) et réinitialise les états nécessaires.
+ *
+ * Avec le suivi de session (SESSION_RESEAU), l'état est connu par les URC : aucune commande n'est envoyée s'il est récent.
+ * Une session perdue est reprise en commençant par l'action la moins coûteuse ; la dernière marche relance
+ * la configuration complète (step_catm1_function()).
+ *
+ * La connexion confirmée, la qualité du lien est relevée (AT+CPSI?) si la dernière mesure a expiré (QUALITE_LIEN).
+ * Un message qui tient dans un datagramme part en CoAP (STEP_ENVOI_COAP) si le transport CoAP est actif, et tout
+ * message publiable part par le client MQTT du modem (STEP_ENVOI_MQTT) si celui-ci est actif.
+ * L'adresse du serveur est résolue ici si celle en cache a expiré (CACHE_DNS), avant toute ouverture de connexion.
+ * Un envoi échoué repart de cette étape (REPRISE_ENVOI) après le délai de reprise.
  */
+static PipelineCBOR etapeEnvoi()
+{
+    cacheDns.entretenir(millis());
+    if (transportMqtt.accepte(cborDataPipeline.size()))
+        return STEP_ENVOI_MQTT;
+    if (transportCoap.accepte(cborDataPipeline.size()))
+        return STEP_ENVOI_COAP;
+    return STEP_OPEN_CONNEXION;
+}
+
+static void verifierSession()
+{
+    PERIODE_CBOR = millis();
+    if (sessionReseau.verifier(millis()))
+    {
+        Serial.println("[STEP_VERIFIER_CONNEXION] success");
+        qualiteLien.mesurer(millis());
+        currentStepCBOR = etapeEnvoi();
+        return;
+    }
+    if (sessionReseau.reprendre(millis()) == REPRISE_CONFIGURATION)
+        catm1Reconfigurer(); // le pipeline CBOR reprend ici une fois CATM1_DONE atteint
+}
+
 void STEP_VERIFIER_CONNEXION_FUNCTION()
 {
 
+    if (repriseEnvoi.enAttente(millis()))
+        return;
     if (chrono(100))
     {
         Serial.println("[STEP_VERIFIER_CONNEXION] init iiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiiii");
+        if (sessionReseau.config.actif)
+        {
+            verifierSession();
+            return;
+        }
         if (resetCommandCEREG)
         {
         }
@@ -27,7 +68,8 @@ void STEP_VERIFIER_CONNEXION_FUNCTION()
         else
         {
             Serial.println("[STEP_VERIFIER_CONNEXION] success");
-            currentStepCBOR = STEP_OPEN_CONNEXION;
+            qualiteLien.mesurer(millis());
+            currentStepCBOR = etapeEnvoi();
             PERIODE_CBOR = millis();
             taskCBOR_CEREG.state = IDLE;
             taskCBOR_CEREG.isFinished = false;
@@ -5,22 +5,51 @@
  * @brief Envoie les données CBOR au module SIM7080G.
  *
  * Cette fonction envoie le buffer binaire CBOR via la liaison série au module SIM7080G.
- * Elle affiche sur le port série le nombre d'octets envoyés pour vérification.
+ * Elle affiche sur le port série le nombre d'octets envoyés pour vérification, et compte l'envoi selon la qualité du lien.
  * Une fois l'envoi terminé, elle passe à l'étape suivante du pipeline (STEP_RECEIVE) et réinitialise le timer du pipeline CBOR.
+ * Avec l'envoi fragmenté (ENVOI_FRAGMENTE), elle fait avancer les fragments jusqu'au dernier OK ; un échec reprend
+ * le traitement d'erreur de la commande AT+CASEND historique.
  */
+static void finEnvoi()
+{
+    Serial.println("[STEP_WRITE] CBOR sent");
+    Serial.print("Bytes: ");
+    Serial.println(cborDataPipeline.size());
+    qualiteLien.enregistrerEnvoi(cborDataPipeline.size(), millis());
+
+    currentStepCBOR = STEP_RECEIVE;
+    PERIODE_CBOR = millis();
+}
+
+// Envoi fragmenté : le flux est lu à chaque passage, un prompt ">" n'attend pas le chrono du pipeline
+static void ecrireFragments()
+{
+    EtatEnvoi etat = envoiFragmente.pomper(millis());
+    if (etat == ENVOI_EN_COURS)
+        return;
+    if (etat == ENVOI_ECHEC)
+    {
+        Serial.println("[STEP_WRITE] envoi abandonne apres " + String(envoiFragmente.fragmentsAcquittes()) + " fragment(s)");
+        if (taskCBOR_CASEND != nullptr && taskCBOR_CASEND->onErrorCallback != nullptr)
+            taskCBOR_CASEND->onErrorCallback(*taskCBOR_CASEND);
+        return;
+    }
+    finEnvoi();
+}
+
 void STEP_WRITE_FUNCTION()
 {
+    if (envoiFragmente.config.actif)
+    {
+        ecrireFragments();
+        return;
+    }
     if (chrono(100))
     {
         Serial.println("[STEP_WRITE] Sending CBOR...");
+        energie.setEtatLte(LTE_TX, millis());
 
         Sim7080G.write(cborDataPipeline.data(), cborDataPipeline.size());
-
-        Serial.println("[STEP_WRITE] CBOR sent");
-        Serial.print("Bytes: ");
-        Serial.println(cborDataPipeline.size());
-
-        currentStepCBOR = STEP_RECEIVE;
-        PERIODE_CBOR = millis();
+        finEnvoi();
     }
 }
@@ -102,6 +102,14 @@ void pipelineSwitchCBOR(const char *dataMessage)
         STEP_CLOSE_CONNEXION_FUNCTION();
         break;
 
+    case STEP_ENVOI_COAP:
+        STEP_ENVOI_COAP_FUNCTION();
+        break;
+
+    case STEP_ENVOI_MQTT:
+        STEP_ENVOI_MQTT_FUNCTION();
+        break;
+
     case STEP_END:
         STEP_END_FUNCTION();
         break;
@@ -0,0 +1,286 @@
+/**
+ * @file ENERGIE.cpp
+ * @brief Comptabilité énergétique de l'ESP32-C3 et du SIM7080G.
+ *
+ * Ce fichier mesure le temps passé par chaque composant dans chacun de ses états :
+ * - ESP32-C3 : actif, light sleep, deep sleep,
+ * - GNSS : éteint ou allumé,
+ * - LTE : éteint, idle, connecté, PSM, émission.
+ *
+ * Sur la cible, les changements d'état sont signalés par les étapes du pipeline (allumage GNSS, ouverture du socket,
+ * envoi CBOR, fermeture...). Sur l'hôte, simulerEnergie() rejoue un cycle type avec une horloge virtuelle.
+ *
+ * Un ProfilCourant (courant moyen par état, configurable) permet ensuite de convertir ces durées en charge consommée :
+ * mAh par fix, par cycle et par jour, afin de juger chaque changement d'ordonnancement sur l'autonomie de la batterie.
+ */
+
+#include "ENERGIE.hpp"
+
+ComptabiliteEnergie energie;  ///< Comptabilité alimentée par les événements du pipeline.
+ProfilCourant profilCourant;  ///< Profil de courant utilisé pour les rapports (valeurs typiques, à ajuster).
+
+ComptabiliteEnergie::ComptabiliteEnergie()
+{
+    reinitialiser(0);
+}
+
+/**
+ * @brief Remet tous les compteurs à zéro et démarre une nouvelle période de mesure.
+ * @param maintenant Instant de départ (ms).
+ */
+void ComptabiliteEnergie::reinitialiser(unsigned long maintenant)
+{
+    debut = maintenant;
+    dureeAnterieure = 0;
+    cpu = CPU_ACTIF;
+    gnss = GNSS_ETEINT;
+    lte = LTE_ETEINT;
+    depuisCpu = depuisGnss = depuisLte = maintenant;
+    for (int i = 0; i < NB_ETATS_CPU; ++i)
+        dureesCpu[i] = 0;
+    for (int i = 0; i < NB_ETATS_GNSS; ++i)
+        dureesGnss[i] = 0;
+    for (int i = 0; i < NB_ETATS_LTE; ++i)
+        dureesLte[i] = 0;
+    nbFix = 0;
+    nbCycles = 0;
+    tensionMv = -1;
+}
+
+void ComptabiliteEnergie::setEtatCpu(EtatCpu etat, unsigned long maintenant)
+{
+    dureesCpu[cpu] += maintenant - depuisCpu;
+    depuisCpu = maintenant;
+    cpu = etat;
+}
+
+void ComptabiliteEnergie::setEtatGnss(EtatGnss etat, unsigned long maintenant)
+{
+    dureesGnss[gnss] += maintenant - depuisGnss;
+    depuisGnss = maintenant;
+    gnss = etat;
+}
+
+void ComptabiliteEnergie::setEtatLte(EtatLte etat, unsigned long maintenant)
+{
+    dureesLte[lte] += maintenant - depuisLte;
+    depuisLte = maintenant;
+    lte = etat;
+}
+
+void ComptabiliteEnergie::enregistrerFix()
+{
+    nbFix++;
+}
+
+void ComptabiliteEnergie::enregistrerCycle()
+{
+    nbCycles++;
+}
+
+void ComptabiliteEnergie::enregistrerTensionBatterie(int mV)
+{
+    if (mV > 0)
+        tensionMv = mV;
+}
+
+/**
+ * @brief Ferme les intervalles en cours avant un deep sleep (millis() repart de zéro au réveil).
+ * @param maintenant Instant de l'endormissement (ms).
+ */
+void ComptabiliteEnergie::cloturer(unsigned long maintenant)
+{
+    dureesCpu[cpu] += maintenant - depuisCpu;
+    dureesGnss[gnss] += maintenant - depuisGnss;
+    dureesLte[lte] += maintenant - depuisLte;
+    dureeAnterieure += maintenant - debut;
+    debut = depuisCpu = depuisGnss = depuisLte = maintenant;
+}
+
+/**
+ * @brief Reprend la mesure au réveil d'un deep sleep.
+ *
+ * La durée du sommeil est attribuée aux états courants (deep sleep pour l'ESP32, PSM pour le modem en général),
+ * puis la mesure repart de l'instant courant.
+ *
+ * @param dureeSommeilMs Durée passée en deep sleep (ms).
+ * @param maintenant Instant courant après le réveil (ms).
+ */
+void ComptabiliteEnergie::reprendre(unsigned long dureeSommeilMs, unsigned long maintenant)
+{
+    dureesCpu[cpu] += dureeSommeilMs;
+    dureesGnss[gnss] += dureeSommeilMs;
+    dureesLte[lte] += dureeSommeilMs;
+    dureeAnterieure += dureeSommeilMs;
+    debut = depuisCpu = depuisGnss = depuisLte = maintenant;
+}
+
+unsigned long ComptabiliteEnergie::tempsCpu(EtatCpu etat, unsigned long maintenant) const
+{
+    return dureesCpu[etat] + (cpu == etat ? maintenant - depuisCpu : 0);
+}
+
+unsigned long ComptabiliteEnergie::tempsGnss(EtatGnss etat, unsigned long maintenant) const
+{
+    return dureesGnss[etat] + (gnss == etat ? maintenant - depuisGnss : 0);
+}
+
+unsigned long ComptabiliteEnergie::tempsLte(EtatLte etat, unsigned long maintenant) const
+{
+    return dureesLte[etat] + (lte == etat ? maintenant - depuisLte : 0);
+}
+
+/**
+ * @brief Convertit les durées mesurées en charge consommée.
+ *
+ * La charge est accumulée en µA·ms sur 64 bits, puis convertie en mAh (1 mAh = 3,6e9 µA·ms).
+ * La consommation journalière est extrapolée à partir de la durée mesurée.
+ *
+ * @param maintenant Instant de fin de la mesure (ms).
+ * @param profil Courant moyen de chaque état.
+ * @return Le rapport énergétique.
+ */
+RapportEnergie ComptabiliteEnergie::rapport(unsigned long maintenant, const ProfilCourant &profil) const
+{
+    RapportEnergie r;
+    uint64_t charge_uAms = 0;
+
+    for (int i = 0; i < NB_ETATS_CPU; ++i)
+        charge_uAms += (uint64_t)tempsCpu((EtatCpu)i, maintenant) * profil.cpu_uA[i];
+    for (int i = 0; i < NB_ETATS_GNSS; ++i)
+        charge_uAms += (uint64_t)tempsGnss((EtatGnss)i, maintenant) * profil.gnss_uA[i];
+    for (int i = 0; i < NB_ETATS_LTE; ++i)
+        charge_uAms += (uint64_t)tempsLte((EtatLte)i, maintenant) * profil.lte_uA[i];
+
+    r.dureeMs = dureeAnterieure + (maintenant - debut);
+    r.nbFix = nbFix;
+    r.nbCycles = nbCycles;
+    r.mAhTotal = (float)((double)charge_uAms / 3.6e9);
+    if (nbFix > 0)
+        r.mAhParFix = r.mAhTotal / nbFix;
+    if (nbCycles > 0)
+        r.mAhParCycle = r.mAhTotal / nbCycles;
+    if (r.dureeMs > 0)
+    {
+        r.courantMoyen_mA = (float)((double)charge_uAms / r.dureeMs / 1000.0);
+        r.mAhParJour = r.courantMoyen_mA * 24.0f;
+    }
+    if (r.mAhParJour > 0)
+        r.autonomieJours = profil.capaciteBatterie_mAh / r.mAhParJour;
+    return r;
+}
+
+/**
+ * @brief Simule le pipeline sur une durée donnée avec une horloge virtuelle.
+ *
+ * Chaque cycle reproduit l'enchaînement du pipeline global : GNSS allumé jusqu'au dernier fix,
+ * connexion LTE, émission, réception, puis attente de la période dans l'état choisi pour l'ESP32 et le modem.
+ * Aucune attente réelle n'est faite : l'horloge avance directement de la durée de chaque phase.
+ *
+ * @param scenario Durées de chaque phase du cycle.
+ * @param profil Profil de courant à appliquer.
+ * @param dureeMs Durée simulée (24 h par défaut).
+ * @return Le rapport énergétique de la simulation.
+ */
+RapportEnergie simulerEnergie(const ScenarioCycle &scenario, const ProfilCourant &profil, unsigned long dureeMs)
+{
+    ComptabiliteEnergie compta;
+    unsigned long t = 0;
+    compta.reinitialiser(t);
+    compta.setEtatLte(scenario.lteEntreCycles, t);
+
+    // Avance l'horloge virtuelle sans dépasser la fin de la simulation
+    auto avancer = [&](unsigned long ms)
+    {
+        t = (dureeMs - t > ms) ? t + ms : dureeMs;
+        return t < dureeMs;
+    };
+
+    while (t < dureeMs)
+    {
+        compta.setEtatCpu(CPU_ACTIF, t);
+        compta.setEtatGnss(GNSS_ALLUME, t);
+        if (!avancer(scenario.ttffMs))
+            break;
+        compta.enregistrerFix();
+        bool fini = false;
+        for (int i = 1; i < scenario.nbFixParCycle; ++i)
+        {
+            if (!avancer(scenario.intervalleFixMs))
+            {
+                fini = true;
+                break;
+            }
+            compta.enregistrerFix();
+        }
+        if (fini)
+            break;
+
+        compta.setEtatGnss(GNSS_ETEINT, t);
+        compta.setEtatLte(LTE_CONNECTE, t);
+        if (!avancer(scenario.lteConnexionMs))
+            break;
+        compta.setEtatLte(LTE_TX, t);
+        if (!avancer(scenario.lteTxMs))
+            break;
+        compta.setEtatLte(LTE_CONNECTE, t);
+        if (!avancer(scenario.lteReceptionMs))
+            break;
+
+        compta.setEtatLte(scenario.lteEntreCycles, t);
+        compta.setEtatCpu(scenario.cpuEntreCycles, t);
+        compta.enregistrerCycle();
+        avancer(scenario.periodeMs);
+    }
+
+    return compta.rapport(dureeMs, profil);
+}
+
+/**
+ * @brief Extrait la tension batterie (mV) de la réponse à AT+CBC.
+ * @param reponseCBC Réponse brute, ex : "+CBC: 0,85,3999".
+ * @return La tension en mV, ou -1 si la réponse est invalide.
+ */
+int parseBatteryVoltage(const String &reponseCBC)
+{
+    int index = reponseCBC.indexOf("+CBC:");
+    if (index == -1)
+        return -1;
+    int fin = reponseCBC.indexOf('\n', index);
+    String ligne = (fin == -1) ? reponseCBC.substring(index) : reponseCBC.substring(index, fin);
+    int virgule = ligne.lastIndexOf(',');
+    if (virgule == -1)
+        return -1;
+    String valeur = ligne.substring(virgule + 1);
+    valeur.trim();
+    int mV = valeur.toInt();
+    return mV > 0 ? mV : -1;
+}
+
+/**
+ * @brief Lit la tension batterie via getBatteryLevel() (AT+CBC) et l'enregistre dans la comptabilité.
+ *
+ * AT+CBC occupe l'UART du modem jusqu'à sa réponse : la tension, qui ne sert qu'au rapport énergétique et varie
+ * lentement, n'est lue qu'avec ce rapport, un cycle sur CYCLES_RAPPORT_STATS.
+ */
+void mesurerBatterie()
+{
+    energie.enregistrerTensionBatterie(parseBatteryVoltage(getBatteryLevel()));
+}
+
+/**
+ * @brief Affiche un rapport énergétique sur le port série.
+ * @param rapport Rapport à afficher.
+ */
+void afficherRapportEnergie(const RapportEnergie &rapport)
+{
+    Serial.println("[ENERGIE] duree (ms) : " + String(rapport.dureeMs));
+    Serial.println("[ENERGIE] fix : " + String(rapport.nbFix) + " / cycles : " + String(rapport.nbCycles));
+    Serial.println("[ENERGIE] courant moyen (mA) : " + String(rapport.courantMoyen_mA, 3));
+    Serial.println("[ENERGIE] mAh par fix : " + String(rapport.mAhParFix, 4));
+    Serial.println("[ENERGIE] mAh par cycle : " + String(rapport.mAhParCycle, 4));
+    Serial.println("[ENERGIE] mAh par jour : " + String(rapport.mAhParJour, 1));
+    Serial.println("[ENERGIE] autonomie estimee (jours) : " + String(rapport.autonomieJours, 1));
+    if (energie.tensionBatterie() > 0)
+        Serial.println("[ENERGIE] batterie (mV) : " + String(energie.tensionBatterie()));
+}
@@ -0,0 +1,372 @@
+/**
+ * @file GESTION_PSM.cpp
+ * @brief Gestion des modes d'économie d'énergie du SIM7080G (PSM / eDRX) et du sommeil de l'ESP32-C3.
+ *
+ * Ce fichier choisit, en fonction de periodeAjustement, le mode d'économie le plus adapté :
+ * - PSM (AT+CPSMS) quand la période est longue : le modem s'endort entre deux envois,
+ * - eDRX (AT+CEDRXS) pour des périodes moyennes : le modem reste joignable dans des fenêtres de paging,
+ * - aucun mode pour des périodes courtes.
+ *
+ * Les timers sont codés au format 3GPP (TS 24.008), demandés au réseau puis relus (AT+CEREG=4, AT+CEDRXRDP)
+ * car le réseau est libre d'accorder d'autres valeurs que celles demandées.
+ *
+ * Enfin, planifierSommeil() calcule le sommeil de l'ESP32-C3 (light ou deep sleep) jusqu'au prochain échantillon GNSS
+ * ou au prochain envoi, en accord avec l'état du modem. Avant un deep sleep, l'état du firmware est sauvegardé
+ * en mémoire RTC (ETAT_RTC) pour reprendre le cycle au réveil.
+ * L'UART ne reçoit rien pendant le light sleep : la ligne RX du modem est armée comme source de réveil, de sorte
+ * qu'une URC (+CADATAIND, +CEREG) réveille l'ESP32. Les caractères reçus avant la reprise de l'UART sont perdus :
+ * gestionPSM.reveilModem le signale aux lecteurs d'URC (ECOUTE_DESCENDANTE), qui relisent alors le modem.
+ * Une commande MQTT (+SMSUB) n'a pas de relecture : tant que gestionPSM.veilleUart est posé, le sommeil léger est
+ * remplacé par une attente qui garde l'UART active et rend la main dès le premier octet du modem.
+ */
+
+#include "GESTION_PSM.hpp"
+#include "ETAT_RTC.hpp"
+#include "SESSION_RESEAU.hpp"
+#include <esp_sleep.h>
+#ifndef UNIT_TEST
+#include <driver/gpio.h>
+#endif
+
+GestionPSM gestionPSM; ///< Timers demandés / accordés et options de sommeil.
+
+// Unités du timer T3412 étendu, de la plus fine à la plus grossière : {code, secondes}
+static const uint32_t UNITES_T3412[][2] = {{0b011, 2}, {0b100, 30}, {0b101, 60}, {0b000, 600}, {0b001, 3600}, {0b010, 36000}, {0b110, 1152000}};
+// Unités du timer T3324
+static const uint32_t UNITES_T3324[][2] = {{0b000, 2}, {0b001, 60}, {0b010, 360}};
+// Cycles eDRX en mode WB-S1 (CAT-M1), en ms, indexés par le code sur 4 bits
+static const uint32_t CYCLES_EDRX_MS[16] = {5120, 10240, 20480, 40960, 61440, 81920, 102400, 122880,
+                                            143360, 163840, 327680, 655360, 1310720, 2621440, 5242880, 10485760};
+
+static String bitsVersString(uint8_t valeur, int nbBits)
+{
+    String bits = "";
+    for (int i = nbBits - 1; i >= 0; --i)
+        bits += ((valeur >> i) & 1) ? '1' : '0';
+    return bits;
+}
+
+static uint8_t stringVersBits(const String &bits)
+{
+    uint8_t valeur = 0;
+    for (unsigned int i = 0; i < bits.length(); ++i)
+        valeur = (valeur << 1) | (bits[i] == '1' ? 1 : 0);
+    return valeur;
+}
+
+// Encode une durée avec la plus petite unité possible (arrondi supérieur)
+static String encoderTimer(uint32_t secondes, const uint32_t unites[][2], int nbUnites)
+{
+    if (secondes == 0)
+        return "11100000"; // désactivé
+    for (int i = 0; i < nbUnites; ++i)
+    {
+        if (secondes <= 31 * unites[i][1])
+        {
+            uint32_t valeur = (secondes + unites[i][1] - 1) / unites[i][1];
+            return bitsVersString(unites[i][0], 3) + bitsVersString(valeur, 5);
+        }
+    }
+    return bitsVersString(unites[nbUnites - 1][0], 3) + "11111";
+}
+
+static uint32_t decoderTimer(const String &bits, const uint32_t unites[][2], int nbUnites)
+{
+    if (bits.length() != 8)
+        return 0;
+    uint8_t octet = stringVersBits(bits);
+    uint8_t unite = octet >> 5;
+    for (int i = 0; i < nbUnites; ++i)
+    {
+        if (unites[i][0] == unite)
+            return (octet & 0x1F) * unites[i][1];
+    }
+    return 0; // 111 = timer désactivé
+}
+
+String encoderT3412(uint32_t secondes)
+{
+    return encoderTimer(secondes, UNITES_T3412, 7);
+}
+
+uint32_t decoderT3412(const String &bits)
+{
+    return decoderTimer(bits, UNITES_T3412, 7);
+}
+
+String encoderT3324(uint32_t secondes)
+{
+    return encoderTimer(secondes, UNITES_T3324, 3);
+}
+
+uint32_t decoderT3324(const String &bits)
+{
+    return decoderTimer(bits, UNITES_T3324, 3);
+}
+
+/**
+ * @brief Choisit le plus long cycle eDRX inférieur ou égal à maxMs.
+ * @return Le code sur 4 bits, ou une chaîne vide si aucun cycle ne convient.
+ */
+String encoderCycleEdrx(uint32_t maxMs)
+{
+    for (int i = 15; i >= 0; --i)
+    {
+        if (CYCLES_EDRX_MS[i] <= maxMs)
+            return bitsVersString(i, 4);
+    }
+    return "";
+}
+
+uint32_t decoderCycleEdrx(const String &bits)
+{
+    if (bits.length() != 4)
+        return 0;
+    return CYCLES_EDRX_MS[stringVersBits(bits) & 0x0F];
+}
+
+/**
+ * @brief Calcule les timers à demander au réseau pour une période d'envoi donnée.
+ *
+ * - Période >= SEUIL_PERIODE_PSM_MS : PSM, TAU d'au moins 3 périodes (le réveil est piloté par l'ESP32)
+ *   et un temps actif court pour recevoir une éventuelle commande après l'envoi.
+ * - Période >= SEUIL_PERIODE_EDRX_MS : eDRX, cycle d'au plus une demi-période.
+ * - Sinon : aucun mode d'économie.
+ *
+ * @param periodeMs Période d'envoi (periodeAjustement).
+ */
+ConfigPSM calculerConfigPSM(unsigned long periodeMs)
+{
+    ConfigPSM config;
+    if (periodeMs >= SEUIL_PERIODE_PSM_MS)
+    {
+        uint32_t tau = 3 * (periodeMs / 1000);
+        if (tau < 3600)
+            tau = 3600;
+        config.mode = ECONOMIE_PSM;
+        config.tauBits = encoderT3412(tau);
+        config.actifBits = encoderT3324(10);
+        config.tauS = decoderT3412(config.tauBits);
+        config.actifS = decoderT3324(config.actifBits);
+    }
+    else if (periodeMs >= SEUIL_PERIODE_EDRX_MS)
+    {
+        config.mode = ECONOMIE_EDRX;
+        config.edrxBits = encoderCycleEdrx(periodeMs / 2);
+        config.edrxMs = decoderCycleEdrx(config.edrxBits);
+    }
+    return config;
+}
+
+// Retourne le champ d'index donné d'une ligne "+XXX: a,b,"c",..." (sans guillemets)
+static String champReponse(const String &reponse, const String &entete, int index)
+{
+    int debut = reponse.indexOf(entete);
+    if (debut == -1)
+        return "";
+    debut += entete.length();
+    int fin = reponse.indexOf('\n', debut);
+    String ligne = (fin == -1) ? reponse.substring(debut) : reponse.substring(debut, fin);
+
+    int courant = 0;
+    int start = 0;
+    while (courant < index)
+    {
+        start = ligne.indexOf(',', start);
+        if (start == -1)
+            return "";
+        start++;
+        courant++;
+    }
+    int end = ligne.indexOf(',', start);
+    String champ = (end == -1) ? ligne.substring(start) : ligne.substring(start, end);
+    champ.trim();
+    champ.replace("\"", "");
+    return champ;
+}
+
+/**
+ * @brief Lit les timers PSM accordés dans une réponse AT+CEREG? au format n=4.
+ *
+ * Format : +CEREG: 4,<stat>,<tac>,<ci>,<AcT>,,,<Active-Time>,<Periodic-TAU>
+ */
+void parserTimersCEREG(const String &reponse, EtatPSMReseau &etat)
+{
+    String actif = champReponse(reponse, "+CEREG:", 7);
+    String tau = champReponse(reponse, "+CEREG:", 8);
+    if (actif.length() == 8 && !actif.startsWith("111"))
+    {
+        etat.psmAccorde = true;
+        etat.actifS = decoderT3324(actif);
+        etat.tauS = decoderT3412(tau);
+    }
+    else
+    {
+        etat.psmAccorde = false;
+        etat.actifS = 0;
+        etat.tauS = 0;
+    }
+}
+
+/**
+ * @brief Lit le cycle eDRX et la fenêtre de paging (PTW) accordés.
+ *
+ * Format : +CEDRXRDP: <AcT>,<cycle demandé>,<cycle accordé>,<PTW>
+ */
+void parserCEDRXRDP(const String &reponse, EtatPSMReseau &etat)
+{
+    String act = champReponse(reponse, "+CEDRXRDP:", 0);
+    String cycle = champReponse(reponse, "+CEDRXRDP:", 2);
+    String ptw = champReponse(reponse, "+CEDRXRDP:", 3);
+    if (act.length() == 0 || act == "0" || cycle.length() != 4)
+    {
+        etat.edrxAccorde = false;
+        etat.edrxMs = 0;
+        etat.ptwMs = 0;
+        return;
+    }
+    etat.edrxAccorde = true;
+    etat.edrxMs = decoderCycleEdrx(cycle);
+    etat.ptwMs = (stringVersBits(ptw) + 1) * 1280UL;
+}
+
+/**
+ * @brief Demande les timers PSM / eDRX au réseau puis relit les valeurs accordées.
+ *
+ * Le format étendu de +CEREG (n=4) n'est activé que le temps de la lecture. Le format rétabli ensuite est celui
+ * qu'attend STEP_VERIFIER_CONNEXION : URC +CEREG (n=1) pour le suivi de session (SESSION_RESEAU),
+ * sinon "+CEREG: 0,5".
+ */
+void negocierPSM(const ConfigPSM &config)
+{
+    gestionPSM.demande = config;
+
+    if (config.mode == ECONOMIE_PSM)
+        Send_AT("AT+CPSMS=1,,,\"" + config.tauBits + "\",\"" + config.actifBits + "\"");
+    else
+        Send_AT("AT+CPSMS=0");
+
+    if (config.mode == ECONOMIE_EDRX)
+        Send_AT("AT+CEDRXS=1,4,\"" + config.edrxBits + "\"");
+    else
+        Send_AT("AT+CEDRXS=0");
+
+    EtatPSMReseau etat;
+    Send_AT("AT+CEREG=4");
+    parserTimersCEREG(Send_AT("AT+CEREG?"), etat);
+    Send_AT(sessionReseau.config.actif ? "AT+CEREG=1" : "AT+CEREG=0");
+    if (config.mode == ECONOMIE_EDRX)
+        parserCEDRXRDP(Send_AT("AT+CEDRXRDP"), etat);
+    gestionPSM.accorde = etat;
+
+    Serial.println("[PSM] PSM accorde : " + String(etat.psmAccorde ? "oui" : "non") +
+                   " TAU=" + String(etat.tauS) + "s actif=" + String(etat.actifS) + "s");
+    Serial.println("[PSM] eDRX accorde : " + String(etat.edrxAccorde ? "oui" : "non") +
+                   " cycle=" + String(etat.edrxMs) + "ms PTW=" + String(etat.ptwMs) + "ms");
+}
+
+/**
+ * @brief Calcule le sommeil possible de l'ESP32-C3 jusqu'au prochain réveil.
+ *
+ * - Écart trop court : pas de sommeil.
+ * - Modem en PSM, deep sleep autorisé et écart long : deep sleep.
+ * - Sinon : light sleep (la RAM et l'état du pipeline sont conservés).
+ *
+ * @param maintenant Instant courant (ms).
+ * @param reveilMs Instant du prochain échantillon GNSS ou du prochain envoi (ms).
+ */
+PlanSommeil planifierSommeil(unsigned long maintenant, unsigned long reveilMs)
+{
+    PlanSommeil plan;
+    long ecart = (long)(reveilMs - maintenant);
+    if (ecart <= (long)gestionPSM.seuilSommeilLegerMs)
+        return plan;
+
+    plan.dureeMs = ecart - gestionPSM.margeReveilMs;
+    if (gestionPSM.deepSleepAutorise && gestionPSM.accorde.psmAccorde && ecart >= (long)gestionPSM.seuilSommeilProfondMs)
+        plan.mode = SOMMEIL_PROFOND;
+    else
+        plan.mode = SOMMEIL_LEGER;
+    return plan;
+}
+
+/**
+ * @brief Endort l'ESP32-C3 selon le plan calculé et met à jour la comptabilité énergétique.
+ */
+void appliquerSommeil(const PlanSommeil &plan)
+{
+    gestionPSM.dernierPlan = plan;
+    if (plan.mode == SOMMEIL_AUCUN)
+        return;
+
+    if (gestionPSM.accorde.psmAccorde && energie.etatLte() == LTE_IDLE)
+        energie.setEtatLte(LTE_PSM, millis());
+
+    if (plan.mode == SOMMEIL_LEGER && gestionPSM.veilleUart)
+    {
+        gestionPSM.nbVeillesUart++;
+        energie.setEtatCpu(CPU_IDLE, millis());
+        unsigned long debut = millis();
+        while (millis() - debut < plan.dureeMs && !Sim7080G.available())
+            delay(10);
+        gestionPSM.reveilModem = Sim7080G.available() > 0;
+        energie.setEtatCpu(CPU_ACTIF, millis());
+    }
+    else if (plan.mode == SOMMEIL_LEGER)
+    {
+        gestionPSM.nbSommeilsLegers++;
+        energie.setEtatCpu(CPU_IDLE, millis());
+        gestionPSM.reveilModem = false;
+#ifndef UNIT_TEST
+        Serial.flush();
+        esp_sleep_enable_timer_wakeup((uint64_t)plan.dureeMs * 1000ULL);
+        // Bit de start d'une émission du modem : niveau bas sur RX
+        gpio_wakeup_enable((gpio_num_t)PIN_RX_SIM7080G, GPIO_INTR_LOW_LEVEL);
+        esp_sleep_enable_gpio_wakeup();
+        esp_light_sleep_start();
+        gpio_wakeup_disable((gpio_num_t)PIN_RX_SIM7080G);
+        gestionPSM.reveilModem = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO;
+#endif
+        energie.setEtatCpu(CPU_ACTIF, millis());
+    }
+    else
+    {
+        gestionPSM.nbSommeilsProfonds++;
+        energie.setEtatCpu(CPU_DEEP_SLEEP, millis());
+        Serial.println("[PSM] deep sleep " + String(plan.dureeMs) + " ms");
+        sauvegarderEtatRTC(plan.dureeMs);
+#ifndef UNIT_TEST
+        Serial.flush();
+        gpio_hold_en((gpio_num_t)PIN_PWRKEY); // PWRKEY reste relâché pendant le sommeil
+        gpio_deep_sleep_hold_en();
+        esp_sleep_enable_timer_wakeup((uint64_t)plan.dureeMs * 1000ULL);
+        esp_deep_sleep_start();
+#endif
+    }
+}
+
+void dormirJusqua(unsigned long reveilMs)
+{
+    appliquerSommeil(planifierSommeil(millis(), reveilMs));
+}
+
+/**
+ * @brief Réveille le modem s'il a été laissé en PSM, avant de lui envoyer de nouvelles commandes.
+ *
+ * Un simple "AT" sert de sonde : une impulsion sur PWRKEY alors que le modem est déjà réveillé risquerait de l'éteindre.
+ */
+void reveillerModemSiPSM()
+{
+    if (energie.etatLte() != LTE_PSM)
+        return;
+
+    if (Send_AT("AT", 300).indexOf("OK") == -1)
+    {
+        Serial.println("[PSM] Reveil du modem par PWRKEY");
+        digitalWrite(PIN_PWRKEY, LOW);
+        delay(200);
+        digitalWrite(PIN_PWRKEY, OUTPUT_OPEN_DRAIN);
+        Send_AT("AT", 1000);
+    }
+    energie.setEtatLte(LTE_IDLE, millis());
+}
@@ -0,0 +1,78 @@
+/**
+ * @file AIGUILLAGE_URC.cpp
+ * @brief Aiguillage des URC du modem vers leurs destinataires, quel que soit le lecteur de l'UART.
+ *
+ * L'écoute descendante (ECOUTE_DESCENDANTE) et le client MQTT (TRANSPORT_MQTT) vidaient chacun l'UART au réveil de
+ * STEP_END_GLOBAL et passaient les lignes qui ne les concernaient pas à la session réseau : l'écoute, servie la
+ * première, consommait les +SMSUB et les commandes MQTT n'étaient jamais appliquées.
+ *
+ * - +CADATAIND et +CASTATE : écoute descendante (et multiplexeur de sockets).
+ * - +SMSUB et +SMSTATE : client MQTT.
+ * - Les autres lignes (+CEREG, +APP PDP...) : session réseau.
+ *
+ * Les deux servir() et la session réseau (pomper) lisent l'UART par lire(). Les lecteurs qui suivent une commande en
+ * cours (ENVOI_FRAGMENTE, TRANSPORT_COAP, TRANSPORT_MQTT, ECOUTE_DESCENDANTE) et le flux GNSS (FLUX_GNSS) repassent
+ * par traiterLigne() les lignes qu'ils ne reconnaissent pas : une commande +SMSUB, déjà acquittée au broker par le
+ * modem, ne peut pas être relue.
+ */
+
+#include "AIGUILLAGE_URC.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "SESSION_RESEAU.hpp"
+#include "ECOUTE_DESCENDANTE.hpp"
+
+AiguillageUrc aiguillageUrc; ///< Lecteur des URC de STEP_END_GLOBAL.
+
+AiguillageUrc::AiguillageUrc()
+{
+    reinitialiser();
+}
+
+void AiguillageUrc::reinitialiser()
+{
+    longueur = 0;
+}
+
+/**
+ * @brief Vide l'UART du modem et aiguille chaque ligne complète.
+ * @return Le nombre d'octets lus.
+ */
+int AiguillageUrc::lire(unsigned long maintenant)
+{
+    char tampon[64];
+    int lus = 0;
+    while (Sim7080G.available())
+    {
+        size_t n = 0;
+        while (n < sizeof(tampon) && Sim7080G.available())
+            tampon[n++] = (char)Sim7080G.read();
+        traiter(tampon, n, maintenant);
+        lus += n;
+    }
+    return lus;
+}
+
+void AiguillageUrc::traiter(const char *donnees, size_t n, unsigned long maintenant)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        char c = donnees[i];
+        if (c == '\n')
+        {
+            ligne[longueur] = '\0';
+            if (longueur > 0)
+                traiterLigne(ligne, maintenant);
+            longueur = 0;
+        }
+        else if (c != '\r' && !(c == ' ' && longueur == 0) && longueur < TAILLE_LIGNE_URC - 1)
+            ligne[longueur++] = c;
+    }
+}
+
+void AiguillageUrc::traiterLigne(const char *texte, unsigned long maintenant)
+{
+    if (strncmp(texte, "+CADATAIND:", 11) == 0 || strncmp(texte, "+CASTATE:", 9) == 0)
+        ecouteDescendante.traiterLigne(texte, maintenant);
+    else if (!transportMqtt.traiterUrc(texte, maintenant))
+        sessionReseau.traiterLigne(texte, maintenant);
+}
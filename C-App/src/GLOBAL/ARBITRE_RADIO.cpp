@@ -0,0 +1,323 @@
+/**
+ * @file ARBITRE_RADIO.cpp
+ * @brief Partage de la chaîne radio du SIM7080G entre les fenêtres GNSS et les fenêtres LTE.
+ *
+ * Le SIM7080G ne peut pas faire fonctionner le GNSS et le LTE en même temps. Historiquement, chaque cycle enchaînait
+ * strictement : allumage GNSS, collecte du lot, extinction GNSS, connexion LTE, envoi. Chaque cycle coûtait donc
+ * deux AT+CGNSPWR et deux basculements de la radio, même pour un seul point "toujours là" à l'arrêt.
+ *
+ * L'arbitre décide, à la fin de chaque fenêtre GNSS (decider) :
+ * - fenêtre LTE si le lot est prêt (le prochain cycle forcerait une décimation du tampon), si un événement de géofence
+ *   attend, si attendre la prochaine fenêtre GNSS ferait dépasser latenceMaxMs au plus ancien fix, ou si aucune fenêtre
+ *   LTE n'a eu lieu depuis intervalleLteMaxMs (les options du serveur n'arrivent qu'après un envoi).
+ *   L'envoi a lieu juste après la fenêtre GNSS, pendant que le récepteur est encore chaud ;
+ * - quand le lien mesuré à la dernière fenêtre LTE est faible (QUALITE_LIEN), seuls un événement et la latence
+ *   maximale déclenchent l'envoi : le lot grossit (le tampon décime pour couvrir toute l'attente) et part en une fois,
+ *   à la première fenêtre où le lien est meilleur ou quand la mesure a expiré ;
+ * - sinon l'envoi est différé, et le GNSS reste allumé si la prochaine fenêtre GNSS commence dans moins de
+ *   gnssChaudMaxMs : ni AT+CGNSPWR=0, ni AT+CGNSPWR=1, et la fenêtre suivante démarre sans temps de fix.
+ * Pendant une fenêtre GNSS, envoiUrgent() écourte l'acquisition quand le plus ancien fix atteint sa latence maximale.
+ *
+ * Chaque fix est composé en JSON dès son ajout (pendant l'acquisition, la radio est au GNSS et le CPU attend) :
+ * STEP_COMPOSE_JSON n'a plus qu'à assembler les fragments.
+ *
+ * simulerOrdonnancement() rejoue sur l'hôte plusieurs heures de cycles et mesure les basculements de la radio par heure
+ * et la latence entre chaque fix et son arrivée au serveur ; avec des phases de couverture faible, il compte aussi le
+ * temps d'antenne et l'énergie LTE par octet envoyé.
+ */
+
+#include "ARBITRE_RADIO.hpp"
+#include "TAMPON_GNSS.hpp"
+#include "ENERGIE.hpp"
+
+ArbitreRadio arbitreRadio; ///< Arbitre utilisé par STEP_GNSS et le pipeline d'envoi.
+
+ArbitreRadio::ArbitreRadio()
+{
+    reinitialiser();
+}
+
+void ArbitreRadio::reinitialiser()
+{
+    stats = StatsArbitre();
+    radio = RADIO_LIBRE;
+    gnssActif = false;
+    decision = RADIO_FENETRE_LTE;
+    nbMessage = 0;
+    derniereFenetreLteMs = 0;
+    fenetreLteFaite = false;
+}
+
+void ArbitreRadio::attribuer(ProprietaireRadio nouveau)
+{
+    if (radio != RADIO_LIBRE && radio != nouveau)
+        stats.nbBasculements++;
+    radio = nouveau;
+}
+
+/**
+ * @brief Le GNSS prend la radio (AT+CGNSPWR=1 accepté, ou GNSS resté allumé depuis la fenêtre précédente).
+ */
+void ArbitreRadio::gnssAllume(unsigned long maintenant)
+{
+    (void)maintenant;
+    if (!gnssActif)
+    {
+        gnssActif = true;
+        stats.nbAllumagesGnss++;
+    }
+    attribuer(RADIO_GNSS);
+}
+
+void ArbitreRadio::gnssEteint(unsigned long maintenant)
+{
+    (void)maintenant;
+    if (!gnssActif)
+        return;
+    gnssActif = false;
+    stats.nbExtinctionsGnss++;
+}
+
+void ArbitreRadio::restaurerGnssAllume(bool allume)
+{
+    gnssActif = allume;
+    if (allume)
+        radio = RADIO_GNSS;
+}
+
+/**
+ * @brief Le LTE prend la radio pour envoyer les nbPoints premiers points du lot.
+ */
+void ArbitreRadio::ouvrirFenetreLte(unsigned long maintenant, int nbPoints)
+{
+    attribuer(RADIO_LTE);
+    stats.nbFenetresLte++;
+    nbMessage = nbPoints;
+    derniereFenetreLteMs = maintenant;
+    fenetreLteFaite = true;
+}
+
+/**
+ * @brief Envoi confirmé : les points du message sont retirés du lot et leur latence est comptée.
+ *
+ * Les points ajoutés après la composition du message restent en attente.
+ */
+void ArbitreRadio::envoiTermine(DataGNSS *donnees, int &nb, unsigned long maintenant)
+{
+    int n = nbMessage < nb ? nbMessage : nb;
+    for (int i = 0; i < n; ++i)
+    {
+        if (donnees[i].tFixMs == 0)
+            continue; // point restauré sans âge connu
+        uint32_t latence = maintenant - donnees[i].tFixMs;
+        stats.nbPointsLivres++;
+        stats.latenceCumuleeMs += latence;
+        if (latence > stats.latenceMaxMs)
+            stats.latenceMaxMs = latence;
+    }
+    for (int i = n; i < nb; ++i)
+        donnees[i - n] = donnees[i];
+    nb -= n;
+    nbMessage = 0;
+}
+
+/**
+ * @brief Vrai quand le plus ancien fix en attente doit partir maintenant pour respecter latenceMaxMs.
+ */
+bool ArbitreRadio::envoiUrgent(unsigned long ageAncienMs) const
+{
+    return config.actif && ageAncienMs > 0 && ageAncienMs + config.dureeLteEstimeeMs >= config.latenceMaxMs;
+}
+
+/**
+ * @brief Fin d'une fenêtre GNSS : envoi maintenant, ou envoi différé avec ou sans maintien du GNSS.
+ * @param lotPret         Le tampon devrait être décimé au prochain cycle.
+ * @param evenement       Un événement de géofence attend son envoi.
+ * @param ageAncienMs     Âge du plus ancien fix en attente (0 : aucun).
+ * @param prochainGnssMs  Délai avant la prochaine fenêtre GNSS.
+ * @param lien            Niveau du lien à la dernière fenêtre LTE (inconnu : pas de report pour lien faible).
+ */
+DecisionRadio ArbitreRadio::decider(bool lotPret, bool evenement, unsigned long ageAncienMs, unsigned long prochainGnssMs, unsigned long maintenant,
+                                   NiveauLien lien)
+{
+    bool lte = !config.actif || evenement || !fenetreLteFaite;
+    if (!lte && ageAncienMs > 0)
+        lte = ageAncienMs + prochainGnssMs + config.dureeLteEstimeeMs >= config.latenceMaxMs;
+    // Lien faible : le lot prêt et l'intervalle des options attendent un meilleur lien, le tampon décime en attendant
+    if (!lte && (lotPret || (maintenant - derniereFenetreLteMs) + prochainGnssMs >= config.intervalleLteMaxMs))
+    {
+        if (lien == LIEN_FAIBLE)
+            stats.nbReportsLienFaible++;
+        else
+            lte = true;
+    }
+
+    if (lte)
+        decision = RADIO_FENETRE_LTE;
+    else
+    {
+        decision = prochainGnssMs <= config.gnssChaudMaxMs ? RADIO_MAINTENIR_GNSS : RADIO_DIFFERER;
+        stats.nbEnvoisDifferes++;
+        if (decision == RADIO_MAINTENIR_GNSS)
+            stats.nbMaintiensGnss++;
+    }
+    return decision;
+}
+
+/**
+ * @brief Âge du plus ancien point en attente dont l'heure d'acquisition est connue (0 si aucun).
+ */
+unsigned long ageAncienFix(const DataGNSS *donnees, int nb, unsigned long maintenant)
+{
+    unsigned long age = 0;
+    for (int i = 0; i < nb; ++i)
+        if (donnees[i].tFixMs != 0 && maintenant - donnees[i].tFixMs > age)
+            age = maintenant - donnees[i].tFixMs;
+    return age;
+}
+
+/**
+ * @brief Rejoue un calendrier de cycles avec la politique donnée (config.actif = false : enchaînement historique).
+ *
+ * Chaque cycle : fenêtre GNSS (temps de fix tiède ou chaud, puis un fix par seconde), décision de l'arbitre,
+ * puis fenêtre LTE éventuelle. Le cycle suivant commence periodeCycleS après la fin du précédent, comme STEP_END_GLOBAL.
+ * Chaque fenêtre LTE mesure le lien (RSRP de la phase de couverture en cours) ; son temps d'antenne est multiplié
+ * par les répétitions CE et s'ajoute à la durée de la fenêtre.
+ */
+RapportRadio simulerOrdonnancement(const ScenarioRadio &scenario, const ConfigArbitre &config, const ConfigQualiteLien &configLien)
+{
+    RapportRadio rapport;
+    ArbitreRadio arbitre;
+    arbitre.config = config;
+    QualiteLien qualite;
+    qualite.config = configLien;
+    TamponGnss tampon;
+    DataGNSS donnees[MAX_COORDS];
+    int nb = 0;
+    ProfilCourant profil;
+
+    const unsigned long debut = 1000; // tFixMs = 0 est réservé aux points sans âge connu
+    const unsigned long fin = debut + scenario.dureeS * 1000UL;
+    const unsigned long periodeMs = scenario.periodeCycleS * 1000UL;
+    uint64_t gnssAllumeMs = 0;
+    unsigned long debutAllumage = debut;
+    double energie_uAms = 0;
+
+    unsigned long t = debut;
+    while (t < fin)
+    {
+        bool chaud = arbitre.estGnssAllume();
+        if (!chaud)
+            debutAllumage = t;
+        arbitre.gnssAllume(t);
+        tampon.preparerCycle(donnees, nb);
+
+        unsigned long phase = ((t - debut) / 1000UL) % (scenario.deplacementS + scenario.arretS);
+        uint8_t nbFixes = phase < scenario.deplacementS ? scenario.fixesDeplacement : scenario.fixesArret;
+        unsigned long tFix = t + (chaud ? scenario.ttffChaudS : scenario.ttffTiedeS) * 1000UL;
+        for (uint8_t k = 0; k < nbFixes && !tampon.plein(nb); ++k)
+        {
+            if (arbitre.envoiUrgent(ageAncienFix(donnees, nb, tFix)))
+            {
+                arbitre.stats.nbFinsAnticipees++;
+                break;
+            }
+            donnees[nb] = DataGNSS();
+            donnees[nb].tFixMs = tFix;
+            nb++;
+            tFix += 1000UL;
+        }
+
+        unsigned long finFenetre = tFix;
+        DecisionRadio decision = arbitre.decider(tampon.lotPret(nb), false, ageAncienFix(donnees, nb, finFenetre), periodeMs, finFenetre,
+                                                 qualite.niveau(finFenetre));
+        if (decision != RADIO_MAINTENIR_GNSS)
+        {
+            arbitre.gnssEteint(finFenetre);
+            gnssAllumeMs += finFenetre - debutAllumage;
+        }
+        if (decision == RADIO_FENETRE_LTE)
+        {
+            unsigned long cycleLien = ((finFenetre - debut) / 1000UL) % (scenario.lienBonS + scenario.lienFaibleS);
+            MesureLien mesure;
+            mesure.rsrpDbm = cycleLien < scenario.lienBonS ? scenario.rsrpBonDbm : scenario.rsrpFaibleDbm;
+            mesure.valide = true;
+            qualite.noter(mesure, finFenetre);
+            if (mesure.rsrpDbm < configLien.seuilFaibleDbm)
+                rapport.nbEnvoisLienFaible++;
+
+            uint32_t octets = scenario.octetsEntete + (uint32_t)nb * scenario.octetsParPoint;
+            uint32_t antenneMs = (uint32_t)((uint64_t)(octets + scenario.octetsSignalisation) * 8000UL / scenario.debitBps) *
+                                 repetitionsCE(mesure.rsrpDbm);
+            rapport.octetsEnvoyes += octets;
+            rapport.tempsAntenneMs += antenneMs;
+            energie_uAms += (double)antenneMs * profil.lte_uA[LTE_TX] + scenario.dureeLteS * 1000.0 * profil.lte_uA[LTE_CONNECTE];
+
+            arbitre.ouvrirFenetreLte(finFenetre, nb);
+            finFenetre += scenario.dureeLteS * 1000UL + antenneMs;
+            arbitre.envoiTermine(donnees, nb, finFenetre);
+        }
+        t = finFenetre + periodeMs;
+    }
+    if (arbitre.estGnssAllume())
+        gnssAllumeMs += fin - debutAllumage;
+
+    const StatsArbitre &s = arbitre.stats;
+    float heures = scenario.dureeS / 3600.0f;
+    rapport.basculementsParHeure = s.nbBasculements / heures;
+    rapport.commandesGnssParHeure = (s.nbAllumagesGnss + s.nbExtinctionsGnss) / heures;
+    rapport.fenetresLteParHeure = s.nbFenetresLte / heures;
+    rapport.nbPointsLivres = s.nbPointsLivres;
+    rapport.nbPointsDecimes = tampon.stats.nbSupprimes;
+    if (s.nbPointsLivres > 0)
+        rapport.latenceMoyenneS = (uint32_t)(s.latenceCumuleeMs / s.nbPointsLivres / 1000);
+    rapport.latenceMaxS = s.latenceMaxMs / 1000;
+    rapport.gnssAllumePourMille = (uint32_t)(gnssAllumeMs * 1000 / (scenario.dureeS * 1000UL));
+    rapport.energieLte_uAh = (float)(energie_uAms / 3600000.0);
+    if (rapport.octetsEnvoyes > 0)
+    {
+        rapport.tempsAntenneMsParOctet = (float)rapport.tempsAntenneMs / rapport.octetsEnvoyes;
+        rapport.energie_uAhParOctet = rapport.energieLte_uAh / rapport.octetsEnvoyes;
+    }
+    return rapport;
+}
+
+/**
+ * @brief Options reçues du serveur : {"actif": bool, "latenceMaxMs": ms, "intervalleLteMaxMs": ms, "gnssChaudMaxMs": ms}.
+ */
+void chargerOptionsArbitre(const json &options)
+{
+    ConfigArbitre &config = arbitreRadio.config;
+    if (options.contains("actif"))
+        config.actif = options["actif"].get<bool>();
+    if (options.contains("latenceMaxMs"))
+        config.latenceMaxMs = options["latenceMaxMs"].get<unsigned long>();
+    if (options.contains("intervalleLteMaxMs"))
+        config.intervalleLteMaxMs = options["intervalleLteMaxMs"].get<unsigned long>();
+    if (options.contains("gnssChaudMaxMs"))
+        config.gnssChaudMaxMs = options["gnssChaudMaxMs"].get<unsigned long>();
+}
+
+void afficherRapportRadio(const char *nom, const RapportRadio &rapport)
+{
+    Serial.println(String("[RADIO] ") + nom + " : " + String(rapport.basculementsParHeure, 1) + " basculements/h, " +
+                   String(rapport.commandesGnssParHeure, 1) + " CGNSPWR/h, " + String(rapport.fenetresLteParHeure, 1) + " fenetres LTE/h");
+    Serial.println(String("[RADIO] ") + nom + " : latence fix -> serveur moyenne " + String(rapport.latenceMoyenneS) + " s, max " +
+                   String(rapport.latenceMaxS) + " s, GNSS allume " + String(rapport.gnssAllumePourMille / 10.0f, 1) + " %");
+    Serial.println(String("[RADIO] ") + nom + " : " + String((unsigned long)rapport.octetsEnvoyes) + " octets, antenne " +
+                   String(rapport.tempsAntenneMsParOctet, 3) + " ms/octet, LTE " + String(rapport.energie_uAhParOctet, 4) +
+                   " uAh/octet (" + String(rapport.nbEnvoisLienFaible) + " envois sur lien faible)");
+}
+
+void afficherStatsArbitre()
+{
+    const StatsArbitre &s = arbitreRadio.stats;
+    uint32_t moyenne = s.nbPointsLivres ? (uint32_t)(s.latenceCumuleeMs / s.nbPointsLivres) : 0;
+    Serial.println("[RADIO] basculements : " + String(s.nbBasculements) + " / CGNSPWR : " + String(s.nbAllumagesGnss + s.nbExtinctionsGnss) +
+                   " / fenetres LTE : " + String(s.nbFenetresLte) + " / envois differes : " + String(s.nbEnvoisDifferes) +
+                   " (lien faible : " + String(s.nbReportsLienFaible) + ")" +
+                   " (GNSS maintenu : " + String(s.nbMaintiensGnss) + ", fins anticipees : " + String(s.nbFinsAnticipees) + ")");
+    Serial.println("[RADIO] latence fix -> serveur (ms) : moyenne " + String(moyenne) + " / max " + String(s.latenceMaxMs) +
+                   " (" + String(s.nbPointsLivres) + " points) / fragments JSON prets : " + String(s.nbFragmentsPrets) +
+                   " / composes a l'envoi : " + String(s.nbFragmentsComposes));
+}
@@ -0,0 +1,432 @@
+/**
+ * @file CACHE_DNS.cpp
+ * @brief Résolution des serveurs par AT+CDNSGIP, cache de l'adresse IP et choix du point d'accès.
+ *
+ * Chaque AT+CAOPEN passait le nom d'hôte (PINGGY_LINK) : le modem refait une requête DNS sur le réseau CAT-M1 avant
+ * l'établissement TCP, soit un aller-retour de plus à chaque ouverture de socket.
+ *
+ * - Le nom est résolu une fois par AT+CDNSGIP, hors du chemin de connexion (STEP_VERIFIER_CONNEXION) ; AT+CAOPEN
+ *   reçoit ensuite l'adresse IP. AT+CDNSGIP ne donne pas le TTL de l'enregistrement : la durée de validité est
+ *   config.ttlS.
+ * - Le cache est écrit en EEPROM (ADDR_CACHE_DNS) : il survit au deep sleep et au redémarrage. Sans heure UTC
+ *   (BASE_TEMPS), une adresse relue est gardée jusqu'au premier échec de connexion.
+ * - Une connexion refusée efface l'adresse du point d'accès : la suivante repart d'une résolution. Une résolution
+ *   échouée laisse AT+CAOPEN au nom d'hôte pendant config.nouvelEssaiS.
+ * - Plusieurs points d'accès peuvent être configurés (option "dns") : le plus rapide à la connexion (moyenne
+ *   glissante de la latence de AT+CAOPEN) est choisi, un point jamais mesuré étant essayé d'abord. Après
+ *   config.echecsBascule échecs d'affilée, un point est écarté pendant config.retourS.
+ *
+ * simulerDns() compare sur l'hôte les résolutions, les échecs et le temps d'ouverture des sockets avec et sans cache.
+ */
+
+#include "CACHE_DNS.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "BASE_TEMPS.hpp"
+#include "ROM.hpp"
+#include "ETAT_RTC.hpp"
+#include <stddef.h>
+
+static_assert(ADDR_CACHE_DNS + sizeof(CacheDnsPersistant) <= EEPROM_SIZE, "cache DNS hors de l'EEPROM");
+
+CacheDns cacheDns; ///< Adresses des serveurs utilisées par AT+CAOPEN et AT+SMCONF.
+
+static void copier(char *destination, const char *source, size_t taille)
+{
+    strncpy(destination, source, taille - 1);
+    destination[taille - 1] = '\0';
+}
+
+CacheDns::CacheDns()
+{
+    reinitialiser();
+}
+
+void CacheDns::reinitialiser()
+{
+    stats = StatsDns();
+    definirPoints({{String(PINGGY_LINK), (uint16_t)PINGGY_PORT}});
+}
+
+/**
+ * @brief Remplace les points d'accès ; les résolutions et mesures en EEPROM des mêmes serveurs sont reprises.
+ */
+void CacheDns::definirPoints(const std::vector<std::pair<String, uint16_t>> &liste)
+{
+    nb = 0;
+    for (const auto &p : liste)
+    {
+        if (nb == NB_POINTS_ACCES || p.first.length() == 0 || p.first.length() >= TAILLE_HOTE)
+            continue;
+        points[nb] = PointAcces();
+        copier(points[nb].hote, p.first.c_str(), TAILLE_HOTE);
+        points[nb].port = p.second;
+        nb++;
+    }
+    if (nb == 0)
+    {
+        points[0] = PointAcces();
+        copier(points[0].hote, PINGGY_LINK, TAILLE_HOTE);
+        points[0].port = PINGGY_PORT;
+        nb = 1;
+    }
+    for (int i = 0; i < NB_POINTS_ACCES; ++i)
+    {
+        resoluMs[i] = 0;
+        resoluIci[i] = false;
+        dernierEchecMs[i] = 0;
+    }
+    courant = 0;
+    charge = false;
+    echecResolution = false;
+    echecResolutionMs = 0;
+    debutMs = 0;
+}
+
+const char *CacheDns::hote() const
+{
+    return points[courant].hote;
+}
+
+uint16_t CacheDns::port() const
+{
+    return points[courant].port;
+}
+
+/**
+ * @brief Adresse à passer à AT+CAOPEN : IP en cache, sinon nom d'hôte (résolu par le modem).
+ */
+String CacheDns::adresse() const
+{
+    if (config.actif && points[courant].ip[0] != '\0')
+        return String(points[courant].ip);
+    return String(points[courant].hote);
+}
+
+uint32_t CacheDns::epochS(unsigned long maintenant) const
+{
+    return baseTemps.estSynchronisee() ? (uint32_t)(baseTemps.versEpochMs(maintenant) / 1000) : 0;
+}
+
+/**
+ * @brief Adresse en cache du point d'accès courant utilisable sans nouvelle résolution.
+ */
+bool CacheDns::estValide(unsigned long maintenant) const
+{
+    const PointAcces &p = points[courant];
+    if (p.ip[0] == '\0')
+        return false;
+    if (resoluIci[courant])
+        return maintenant - resoluMs[courant] < config.ttlS * 1000UL;
+    uint32_t epoch = epochS(maintenant);
+    if (p.expirationEpochS != 0 && epoch != 0)
+        return epoch < p.expirationEpochS;
+    return true; // relue de l'EEPROM sans heure : gardée jusqu'au premier échec
+}
+
+// Point d'accès le plus rapide parmi ceux qui ne sont pas écartés ; tous écartés : le plus ancien échec
+uint8_t CacheDns::choisir(unsigned long maintenant) const
+{
+    int meilleur = -1;
+    for (uint8_t k = 0; k < nb; ++k)
+    {
+        uint8_t i = (courant + k) % nb; // à égalité, le point courant est gardé
+        const PointAcces &p = points[i];
+        if (p.nbEchecs >= config.echecsBascule && maintenant - dernierEchecMs[i] < config.retourS * 1000UL)
+            continue;
+        if (meilleur == -1 || p.latenceMoyenneMs < points[meilleur].latenceMoyenneMs)
+            meilleur = i;
+    }
+    if (meilleur != -1)
+        return meilleur;
+    uint8_t ancien = courant;
+    for (uint8_t i = 0; i < nb; ++i)
+        if (maintenant - dernierEchecMs[i] > maintenant - dernierEchecMs[ancien])
+            ancien = i;
+    return ancien;
+}
+
+void CacheDns::selectionner(unsigned long maintenant)
+{
+    uint8_t choix = choisir(maintenant);
+    if (choix == courant)
+        return;
+    if (points[courant].nbEchecs >= config.echecsBascule)
+    {
+        stats.nbBasculements++;
+        Serial.println("[DNS] bascule de " + String(points[courant].hote) + " vers " + String(points[choix].hote));
+    }
+    courant = choix;
+    echecResolution = false;
+}
+
+/**
+ * @brief Choisit le point d'accès et le résout si son adresse en cache a expiré ou a été effacée.
+ * @return true si AT+CAOPEN peut partir vers une adresse IP.
+ */
+bool CacheDns::entretenir(unsigned long maintenant)
+{
+    if (!config.actif)
+        return false;
+    if (!charge && config.persistant)
+        charger();
+    charge = true;
+    selectionner(maintenant);
+    if (estValide(maintenant))
+    {
+        stats.nbResolutionsEvitees++;
+        return true;
+    }
+    if (echecResolution && maintenant - echecResolutionMs < config.nouvelEssaiS * 1000UL)
+        return points[courant].ip[0] != '\0';
+
+    PointAcces &p = points[courant];
+    String ip;
+    stats.nbResolutions++;
+    bool ok = resoudre != nullptr ? resoudre(p.hote, ip, maintenant) : resoudreAT(p.hote, ip);
+    if (!ok || ip.length() == 0 || ip.length() >= TAILLE_IP)
+    {
+        stats.nbEchecsResolution++;
+        echecResolution = true;
+        echecResolutionMs = maintenant;
+        Serial.println("[DNS] resolution de " + String(p.hote) + " refusee");
+        return p.ip[0] != '\0'; // adresse expirée gardée, plus probable que rien
+    }
+    copier(p.ip, ip.c_str(), TAILLE_IP);
+    uint32_t epoch = epochS(maintenant);
+    p.expirationEpochS = epoch != 0 ? epoch + config.ttlS : 0;
+    resoluMs[courant] = maintenant;
+    resoluIci[courant] = true;
+    echecResolution = false;
+    if (config.persistant)
+        sauvegarder();
+    return true;
+}
+
+/**
+ * @brief AT+CDNSGIP : OK immédiat, puis l'URC +CDNSGIP: 1,"<hote>","<ip>"[,"<ip2>"] ou +CDNSGIP: 0,<erreur>.
+ */
+bool CacheDns::resoudreAT(const char *nom, String &ip)
+{
+    String reponse = Send_AT("AT+CDNSGIP=\"" + String(nom) + "\",1," + String(config.delaiResolutionMs), 2000);
+    unsigned long debut = millis();
+    int urc = reponse.indexOf("+CDNSGIP: ");
+    while (urc == -1 || reponse.indexOf('\n', urc) == -1)
+    {
+        if (reponse.indexOf("ERROR") != -1 || millis() - debut > config.delaiResolutionMs)
+            return false;
+        if (Sim7080G.available())
+            reponse += (char)Sim7080G.read();
+        urc = reponse.indexOf("+CDNSGIP: ");
+    }
+    if (reponse.charAt(urc + 10) != '1')
+        return false;
+    int nomDebut = reponse.indexOf('"', urc);
+    int nomFin = nomDebut == -1 ? -1 : reponse.indexOf('"', nomDebut + 1);
+    int ipDebut = nomFin == -1 ? -1 : reponse.indexOf('"', nomFin + 1);
+    int ipFin = ipDebut == -1 ? -1 : reponse.indexOf('"', ipDebut + 1);
+    if (ipFin == -1)
+        return false;
+    ip = reponse.substring(ipDebut + 1, ipFin);
+    return true;
+}
+
+void CacheDns::debutConnexion(unsigned long maintenant)
+{
+    debutMs = maintenant;
+}
+
+/**
+ * @brief AT+CAOPEN TCP réussi : latence du point d'accès courant et fin de ses échecs.
+ */
+void CacheDns::connexionReussie(unsigned long maintenant)
+{
+    uint32_t latence = maintenant - debutMs;
+    PointAcces &p = points[courant];
+    p.latenceMoyenneMs = p.latenceMoyenneMs == 0 ? latence : (3 * p.latenceMoyenneMs + latence) / 4;
+    if (p.latenceMoyenneMs == 0)
+        p.latenceMoyenneMs = 1; // 0 est réservé au point jamais mesuré
+    if (latence > p.latenceMaxMs)
+        p.latenceMaxMs = latence;
+    p.nbConnexions++;
+    p.nbEchecs = 0;
+    stats.nbConnexions++;
+    stats.latenceCumuleeMs += latence;
+    if (latence > stats.latenceMaxMs)
+        stats.latenceMaxMs = latence;
+}
+
+/**
+ * @brief AT+CAOPEN refusé ou sans réponse : l'adresse est effacée et un autre point d'accès peut prendre le relais.
+ */
+void CacheDns::connexionEchouee(unsigned long maintenant)
+{
+    PointAcces &p = points[courant];
+    stats.nbEchecsConnexion++;
+    p.nbEchecs++;
+    dernierEchecMs[courant] = maintenant;
+    if (!config.actif)
+        return;
+    p.ip[0] = '\0';
+    resoluIci[courant] = false;
+    echecResolution = false;
+    selectionner(maintenant);
+}
+
+/**
+ * @brief Reprend en EEPROM les adresses et mesures des points d'accès configurés.
+ * @return true si le cache est présent et intègre (magic et CRC).
+ */
+bool CacheDns::charger()
+{
+    CacheDnsPersistant cache;
+    EEPROM.get(ADDR_CACHE_DNS, cache);
+    if (cache.magic != CACHE_DNS_MAGIC || cache.nbPoints > NB_POINTS_ACCES ||
+        cache.crc != crc32Etat((const uint8_t *)&cache, offsetof(CacheDnsPersistant, crc)))
+        return false;
+    for (uint8_t i = 0; i < nb; ++i)
+        for (uint8_t j = 0; j < cache.nbPoints; ++j)
+            if (cache.points[j].port == points[i].port && strncmp(cache.points[j].hote, points[i].hote, TAILLE_HOTE) == 0)
+            {
+                points[i] = cache.points[j];
+                points[i].ip[TAILLE_IP - 1] = '\0';
+            }
+    return true;
+}
+
+void CacheDns::sauvegarder()
+{
+    CacheDnsPersistant cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.magic = CACHE_DNS_MAGIC;
+    cache.nbPoints = nb;
+    for (uint8_t i = 0; i < nb; ++i)
+        cache.points[i] = points[i];
+    cache.crc = crc32Etat((const uint8_t *)&cache, offsetof(CacheDnsPersistant, crc));
+    EEPROM.put(ADDR_CACHE_DNS, cache);
+    EEPROM.commit();
+}
+
+// Résolveur du banc d'essai : le premier serveur change d'adresse à scenario.changementIpA
+static uint16_t generationSimulee = 1;
+
+static String ipSimulee(const char *hote)
+{
+    return strcmp(hote, "serveur-a.local") == 0 ? "10.0.0." + String(generationSimulee) : "10.0.1.1";
+}
+
+static bool resoudreSimule(const char *hote, String &ip, unsigned long)
+{
+    ip = ipSimulee(hote);
+    return true;
+}
+
+/**
+ * @brief Banc d'essai : ouvertures de socket périodiques vers deux points d'accès (latences différentes, premier
+ * en panne un temps puis changeant d'adresse).
+ *
+ * parNom : comportement précédent, AT+CAOPEN au nom d'hôte (une résolution par le modem à chaque tentative),
+ * toujours vers le premier serveur. Sinon, CacheDns avec config. Une ouverture est tentée trois fois au plus.
+ */
+RapportDns simulerDns(const ScenarioDns &scenario, const ConfigDns &config, bool parNom)
+{
+    RapportDns rapport;
+    CacheDns cache;
+    cache.config = config;
+    cache.config.actif = !parNom;
+    cache.config.persistant = false;
+    cache.resoudre = resoudreSimule;
+    cache.definirPoints({{"serveur-a.local", 1}, {"serveur-b.local", 2}});
+
+    uint64_t latenceCumulee = 0;
+    uint32_t nbOuvertures = 0;
+    unsigned long t = 0;
+    for (uint16_t k = 0; k < scenario.nbConnexions; ++k)
+    {
+        unsigned long periode = (unsigned long)k * scenario.periodeS * 1000UL;
+        if (t < periode)
+            t = periode;
+        generationSimulee = k >= scenario.changementIpA ? 2 : 1;
+        unsigned long debut = t;
+        bool ouvert = false;
+        for (int tentative = 0; tentative < 3 && !ouvert; ++tentative)
+        {
+            uint32_t avant = cache.stats.nbResolutions;
+            if (parNom)
+                rapport.nbResolutions++;
+            else
+                cache.entretenir(t);
+            t += (parNom ? 1 : cache.stats.nbResolutions - avant) * scenario.rttDnsMs;
+
+            uint8_t i = cache.pointCourant();
+            bool enPanne = i == 0 && k >= scenario.panneDebut && k < scenario.panneFin;
+            bool bonneAdresse = parNom || cache.adresse() == ipSimulee(cache.hote());
+            cache.debutConnexion(t);
+            if (!enPanne && bonneAdresse)
+            {
+                t += scenario.latences[i];
+                cache.connexionReussie(t);
+                ouvert = true;
+            }
+            else
+            {
+                t += scenario.delaiEchecMs;
+                cache.connexionEchouee(t);
+                rapport.nbEchecs++;
+            }
+        }
+        if (!ouvert)
+            continue;
+        uint32_t latence = t - debut;
+        latenceCumulee += latence;
+        nbOuvertures++;
+        if (latence > rapport.latenceMaxMs)
+            rapport.latenceMaxMs = latence;
+    }
+    if (!parNom)
+        rapport.nbResolutions = cache.stats.nbResolutions;
+    rapport.nbBasculements = cache.stats.nbBasculements;
+    rapport.latenceMoyenneMs = nbOuvertures ? (uint32_t)(latenceCumulee / nbOuvertures) : 0;
+    return rapport;
+}
+
+/**
+ * @brief Options "dns" : {"actif":true,"ttlS":3600,"echecsBascule":2,"points":[{"hote":"...","port":41533}]}.
+ */
+void chargerOptionsDns(const json &options)
+{
+    ConfigDns &config = cacheDns.config;
+    if (options.contains("actif"))
+        config.actif = options["actif"].get<bool>();
+    if (options.contains("ttlS"))
+        config.ttlS = options["ttlS"].get<uint32_t>();
+    if (options.contains("echecsBascule"))
+        config.echecsBascule = options["echecsBascule"].get<uint8_t>();
+    if (options.contains("points") && options["points"].is_array())
+    {
+        std::vector<std::pair<String, uint16_t>> points;
+        for (const auto &p : options["points"])
+            if (p.contains("hote") && p.contains("port"))
+                points.push_back({String(p["hote"].get<std::string>().c_str()), p["port"].get<uint16_t>()});
+        if (!points.empty())
+            cacheDns.definirPoints(points);
+    }
+}
+
+void afficherStatsDns()
+{
+    const StatsDns &s = cacheDns.stats;
+    if (s.nbConnexions == 0 && s.nbEchecsConnexion == 0 && s.nbResolutions == 0)
+        return;
+    uint32_t moyenne = s.nbConnexions ? (uint32_t)(s.latenceCumuleeMs / s.nbConnexions) : 0;
+    Serial.println("[DNS] resolutions : " + String(s.nbResolutions) + " (" + String(s.nbEchecsResolution) +
+                   " echecs, " + String(s.nbResolutionsEvitees) + " evitees) / connexions " + String(s.nbConnexions) +
+                   " (" + String(s.nbEchecsConnexion) + " echecs, " + String(s.nbBasculements) +
+                   " basculements) / latence (ms) moyenne " + String(moyenne) + ", max " + String(s.latenceMaxMs));
+    for (uint8_t i = 0; i < cacheDns.nbPoints(); ++i)
+    {
+        const PointAcces &p = cacheDns.point(i);
+        Serial.println("[DNS]   " + String(p.hote) + ":" + String(p.port) + " -> " + String(p.ip[0] ? p.ip : "-") +
+                       " / connexions " + String(p.nbConnexions) + " / latence (ms) moyenne " +
+                       String(p.latenceMoyenneMs) + ", max " + String(p.latenceMaxMs));
+    }
+}
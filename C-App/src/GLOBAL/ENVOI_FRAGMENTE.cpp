@@ -0,0 +1,305 @@
+/**
+ * @file ENVOI_FRAGMENTE.cpp
+ * @brief Envoi d'un message CBOR en fragments AT+CASEND enchaînés sur le socket déjà ouvert.
+ *
+ * STEP_INIT_CBOR préparait un seul AT+CASEND=0,<taille> pour tout le message, précédé à chaque envoi d'un AT+CACFG? :
+ * au-delà de 1460 octets le modem refuse la commande, et chaque message, même de quelques dizaines d'octets,
+ * attendait le prompt ">" puis le OK au rythme des étapes du pipeline (chrono(1000) puis chrono(100)).
+ *
+ * - Le message est découpé en fragments pleins de tailleCible octets (le dernier prend le reste), sous la limite du
+ *   modem et d'un segment TCP.
+ * - Le lot est regroupé jusqu'à tailleCible : lotRempli() termine l'acquisition et ouvre la fenêtre LTE (STEP_GNSS,
+ *   ARBITRE_RADIO) dès que la taille CBOR estimée du lot remplit un fragment, même si le tampon de fixes n'est pas
+ *   plein. La taille par fix vient du dernier lot envoyé (mesurerLot), au-delà de l'en-tête estimé octetsEntete.
+ *   Avec tailleCible par défaut, le tampon (MAX_COORDS) est plein avant : le regroupement sert aux fragments réduits.
+ * - Les prompts ">" et les OK sont lus au fil du flux UART (pomper / traiter), sans le rythme des étapes du pipeline :
+ *   l'en-tête AT+CASEND du fragment suivant part dès le OK du fragment écrit (le modem n'accepte pas de commande
+ *   avant d'avoir rendu ce OK).
+ * - pomper() lit l'UART octet par octet et s'arrête au dernier OK : ce qui suit (+CADATAIND, réponse du serveur)
+ *   reste dans l'UART pour STEP_RECEIVE. traiter() rend le nombre d'octets consommés, l'appelant garde le reste.
+ * - Un ERROR ou l'absence de prompt et de OK pendant delaiMs abandonne l'envoi ; les autres lignes du flux (URC)
+ *   vont à leur destinataire par AIGUILLAGE_URC (session réseau, commande MQTT +SMSUB, annonce d'un autre socket).
+ *
+ * simulerEnvoi() compare sur l'hôte le nombre d'AT+CASEND par fix et le débit du socket selon la taille du message.
+ */
+
+#include "ENVOI_FRAGMENTE.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "AIGUILLAGE_URC.hpp"
+
+EnvoiFragmente envoiFragmente; ///< Envoi utilisé par STEP_DEFINE_BYTE et STEP_WRITE.
+
+EnvoiFragmente::EnvoiFragmente()
+{
+    reinitialiser();
+}
+
+void EnvoiFragmente::reinitialiser()
+{
+    stats = StatsEnvoi();
+    etatEnvoi = ENVOI_INACTIF;
+    message = nullptr;
+    tailleMessage = 0;
+    nbTotal = 0;
+    nbEcrits = 0;
+    nbEntetes = 0;
+    nbAcquittes = 0;
+    debutMs = 0;
+    evenementMs = 0;
+    octetsParFixMesure = 0;
+    longueur = 0;
+}
+
+uint16_t EnvoiFragmente::taillePleine() const
+{
+    if (config.tailleCible == 0)
+        return 1;
+    return config.tailleCible > TAILLE_MAX_CASEND ? TAILLE_MAX_CASEND : config.tailleCible;
+}
+
+/**
+ * @brief Taille par fix d'un lot encodé, hors en-tête et arrondie au-dessus : sert à estimer les lots suivants.
+ */
+void EnvoiFragmente::mesurerLot(size_t taille, int nbFixes)
+{
+    if (nbFixes <= 0 || taille <= config.octetsEntete)
+        return;
+    size_t parFix = (taille - config.octetsEntete + nbFixes - 1) / nbFixes;
+    octetsParFixMesure = parFix > UINT16_MAX ? UINT16_MAX : (uint16_t)parFix;
+}
+
+size_t EnvoiFragmente::tailleEstimee(int nbFixes) const
+{
+    if (nbFixes <= 0)
+        return 0;
+    return config.octetsEntete + (size_t)nbFixes * (octetsParFixMesure ? octetsParFixMesure : config.octetsParFix);
+}
+
+/**
+ * @brief Vrai si le lot de nbFixes remplit un fragment : l'attendre davantage ajouterait un AT+CASEND à l'envoi.
+ */
+bool EnvoiFragmente::lotRempli(int nbFixes) const
+{
+    return config.actif && nbFixes > 0 && tailleEstimee(nbFixes) >= taillePleine();
+}
+
+int EnvoiFragmente::nbFragments(size_t taille) const
+{
+    return (int)((taille + taillePleine() - 1) / taillePleine());
+}
+
+size_t EnvoiFragmente::tailleFragment(size_t taille, int index) const
+{
+    size_t debut = (size_t)index * taillePleine();
+    if (debut >= taille)
+        return 0;
+    return taille - debut < taillePleine() ? taille - debut : taillePleine();
+}
+
+void EnvoiFragmente::ecrire(const uint8_t *donnees, size_t n)
+{
+    if (sortie != nullptr)
+        sortie(donnees, n);
+    else
+        Sim7080G.write(donnees, n);
+    octetsUartEmis += n;
+}
+
+void EnvoiFragmente::envoyerEntete(int index)
+{
+    String entete = "AT+CASEND=" + String(cid) + "," + String((unsigned long)tailleFragment(tailleMessage, index)) + "\r\n";
+    ecrire((const uint8_t *)entete.c_str(), entete.length());
+    nbTransactionsAT++;
+    nbEntetes++;
+    stats.nbFragments++;
+}
+
+/**
+ * @brief Ecrit l'en-tête du premier fragment ; la suite avance avec les prompts lus par pomper() ou traiter().
+ */
+void EnvoiFragmente::commencer(const uint8_t *donnees, size_t taille, unsigned long maintenant)
+{
+    message = donnees;
+    tailleMessage = taille;
+    nbTotal = nbFragments(taille);
+    nbEcrits = 0;
+    nbEntetes = 0;
+    nbAcquittes = 0;
+    longueur = 0;
+    debutMs = maintenant;
+    evenementMs = maintenant;
+    stats.nbMessages++;
+    if (nbTotal == 0)
+    {
+        terminer(ENVOI_TERMINE, maintenant);
+        return;
+    }
+    etatEnvoi = ENVOI_EN_COURS;
+    envoyerEntete(0);
+}
+
+void EnvoiFragmente::terminer(EtatEnvoi fin, unsigned long maintenant)
+{
+    etatEnvoi = fin;
+    if (fin == ENVOI_ECHEC)
+    {
+        stats.nbEchecs++;
+        return;
+    }
+    uint32_t duree = maintenant - debutMs;
+    stats.octets += tailleMessage;
+    stats.dureeCumuleeMs += duree;
+    if (duree > stats.dureeMaxMs)
+        stats.dureeMaxMs = duree;
+}
+
+void EnvoiFragmente::traiterLigne(unsigned long maintenant)
+{
+    ligne[longueur] = '\0';
+    if (strcmp(ligne, "OK") == 0)
+    {
+        // Un OK hors fragment écrit (réponse d'une commande précédente) est ignoré
+        if (nbAcquittes < nbEcrits)
+        {
+            nbAcquittes++;
+            evenementMs = maintenant;
+            if (nbAcquittes == nbTotal)
+                terminer(ENVOI_TERMINE, maintenant);
+            else if (nbEntetes < nbTotal)
+                envoyerEntete(nbEntetes);
+        }
+    }
+    else if (strstr(ligne, "ERROR") != nullptr)
+        terminer(ENVOI_ECHEC, maintenant);
+    else if (longueur > 0)
+        aiguillageUrc.traiterLigne(ligne, maintenant);
+}
+
+/**
+ * @brief Lit le flux du modem : un prompt ">" fait écrire le fragment attendu, son OK l'en-tête du suivant.
+ * @return Octets consommés : la lecture s'arrête à la fin de l'envoi, le reste du bloc revient à l'appelant.
+ */
+size_t EnvoiFragmente::traiter(const char *donnees, size_t n, unsigned long maintenant)
+{
+    size_t i = 0;
+    for (; i < n && etatEnvoi == ENVOI_EN_COURS; ++i)
+    {
+        char c = donnees[i];
+        if (c == '>' && longueur == 0)
+        {
+            if (nbEcrits >= nbEntetes)
+                continue; // prompt sans en-tête en attente
+            size_t debut = (size_t)nbEcrits * taillePleine();
+            ecrire(message + debut, tailleFragment(tailleMessage, nbEcrits));
+            nbEcrits++;
+            evenementMs = maintenant;
+        }
+        else if (c == '\n')
+        {
+            traiterLigne(maintenant);
+            longueur = 0;
+        }
+        else if (c != '\r' && !(c == ' ' && longueur == 0) && longueur < TAILLE_LIGNE_ENVOI - 1)
+            ligne[longueur++] = c;
+    }
+    return i;
+}
+
+EtatEnvoi EnvoiFragmente::pomper(unsigned long maintenant)
+{
+    // Octet par octet : rien n'est lu au-delà du dernier OK
+    while (etatEnvoi == ENVOI_EN_COURS && Sim7080G.available())
+    {
+        char c = (char)Sim7080G.read();
+        traiter(&c, 1, maintenant);
+    }
+    if (etatEnvoi == ENVOI_EN_COURS && maintenant - evenementMs > config.delaiMs)
+    {
+        Serial.println("[ENVOI] pas de reponse du modem, fragment " + String(nbAcquittes + 1) + "/" + String(nbTotal));
+        terminer(ENVOI_ECHEC, maintenant);
+    }
+    return etatEnvoi;
+}
+
+// Longueur de "AT+CASEND=0,<taille>\r\n"
+static uint32_t octetsEntete(size_t taille)
+{
+    return 12 + String((unsigned long)taille).length() + 2;
+}
+
+/**
+ * @brief Durée d'envoi d'un message de scenario.nbPoints fixes sur le socket ouvert, et nombre d'AT+CASEND.
+ *
+ * Historique : AT+CACFG?, puis AT+CASEND attendu par STEP_DEFINE_BYTE (chrono(1000)) et données écrites par
+ * STEP_WRITE (chrono(100)). Fragmenté : l'en-tête suivant part au OK du fragment écrit, puis le modem rend son prompt.
+ */
+RapportEnvoi simulerEnvoi(const ScenarioEnvoi &scenario, const ConfigEnvoi &config)
+{
+    RapportEnvoi rapport;
+    const float msParOctet = 10000.0f / scenario.baudsUart; // 10 bits par octet sur l'UART
+    size_t taille = scenario.octetsEntete + (size_t)scenario.nbPoints * scenario.octetsParPoint;
+    rapport.octets = taille;
+    float t = 0;
+
+    if (!config.actif)
+    {
+        rapport.nbCasend = 1;
+        rapport.echec = taille > TAILLE_MAX_CASEND;
+        t = scenario.delaiCacfgMs + 1000 + 100 + octetsEntete(taille) * msParOctet + scenario.delaiPromptMs +
+            taille * msParOctet + scenario.delaiAcquittementMs;
+    }
+    else
+    {
+        EnvoiFragmente envoi;
+        envoi.config = config;
+        int n = envoi.nbFragments(taille);
+        rapport.nbCasend = n;
+        float entete = octetsEntete(envoi.tailleFragment(taille, 0)) * msParOctet;
+        float prompt = entete + scenario.delaiPromptMs; // prompt du fragment courant
+        for (int k = 0; k < n; ++k)
+        {
+            float finDonnees = prompt + envoi.tailleFragment(taille, k) * msParOctet;
+            float acquittement = finDonnees + scenario.delaiAcquittementMs;
+            t = acquittement;
+            if (k + 1 < n)
+                prompt = acquittement + octetsEntete(envoi.tailleFragment(taille, k + 1)) * msParOctet + scenario.delaiPromptMs;
+        }
+    }
+    rapport.dureeMs = (uint32_t)(t + 0.5f);
+    if (scenario.nbPoints > 0)
+        rapport.casendParFix = (float)rapport.nbCasend / scenario.nbPoints;
+    if (!rapport.echec && rapport.dureeMs > 0)
+        rapport.debitOctetsParS = (uint32_t)((uint64_t)taille * 1000 / rapport.dureeMs);
+    return rapport;
+}
+
+/**
+ * @brief Options reçues du serveur : {"actif": bool, "tailleCible": octets, "delaiMs": ms, "octetsEntete": octets,
+ *        "octetsParFix": octets}.
+ */
+void chargerOptionsEnvoi(const json &options)
+{
+    ConfigEnvoi &config = envoiFragmente.config;
+    if (options.contains("actif"))
+        config.actif = options["actif"].get<bool>();
+    if (options.contains("tailleCible"))
+        config.tailleCible = options["tailleCible"].get<uint16_t>();
+    if (options.contains("delaiMs"))
+        config.delaiMs = options["delaiMs"].get<unsigned long>();
+    if (options.contains("octetsEntete"))
+        config.octetsEntete = options["octetsEntete"].get<uint16_t>();
+    if (options.contains("octetsParFix"))
+        config.octetsParFix = options["octetsParFix"].get<uint16_t>();
+}
+
+void afficherStatsEnvoi()
+{
+    const StatsEnvoi &s = envoiFragmente.stats;
+    if (s.nbMessages == 0)
+        return;
+    uint32_t envoyes = s.nbMessages - s.nbEchecs;
+    uint32_t moyenne = envoyes ? (uint32_t)(s.dureeCumuleeMs / envoyes) : 0;
+    Serial.println("[ENVOI] messages : " + String(s.nbMessages) + " / AT+CASEND : " + String(s.nbFragments) + " / octets : " +
+                   String((unsigned long)s.octets) + " / echecs : " + String(s.nbEchecs) + " / duree (ms) moyenne " +
+                   String(moyenne) + ", max " + String(s.dureeMaxMs));
+}
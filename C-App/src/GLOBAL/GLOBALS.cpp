@@ -18,6 +18,7 @@ unsigned long periodeAjustement = 30000UL;         ///< Période d'ajustement dy
 bool oneRun = true;                                ///< Indique si une seule exécution doit avoir lieu.
 bool receiveMessage = false;                       ///< Indique si un message a été reçu.
 bool stepReceiveFunctionBoolean = true;            ///< Indicateur pour la fonction de réception CBOR.
+bool reponseServeur = false;                       ///< Le serveur a répondu à l'envoi en cours (STEP_RECEIVE).
 
 MessageCoord listeCoordonnees[MAX_COORDS];         ///< Tableau des coordonnées à envoyer.
 int nbCoordonnees = 0;                             ///< Nombre de coordonnées dans le tableau.
@@ -0,0 +1,287 @@
+/**
+ * @file MULTIPLEXEUR_SOCKETS.cpp
+ * @brief Sockets séparés pour les envois et le contrôle, sur les connexions AT+CA* du SIM7080G.
+ *
+ * Tout passait par la connexion 0 : l'écoute des commandes du serveur (ECOUTE_DESCENDANTE) était fermée avant chaque
+ * envoi, une commande arrivée pendant un envoi volumineux attendait sa fin, un envoi échoué coupait aussi l'écoute,
+ * et receive() envoyait un second AT+CAOPEN=0 sur un socket déjà ouvert.
+ *
+ * - Le canal d'envoi (cid 0) est ouvert et fermé à chaque envoi par le pipeline CBOR, qui signale son état (marquer).
+ * - Le canal de contrôle (cid 1) reste ouvert d'un cycle à l'autre ; il n'est rouvert qu'après une fermeture par le
+ *   serveur ou le réseau (+CASTATE: 1,0) ou la fin du temps actif PSM. A chaque ouverture, il s'identifie auprès du
+ *   serveur par une trame {"name": imei, "controle": true}, sans quoi le serveur ne saurait où adresser ses commandes.
+ * - ouvrir() n'envoie pas de AT+CAOPEN sur un canal déjà ouvert ; un envoi échoué ne ferme que le canal d'envoi.
+ * - config.actif à false : les deux canaux partagent le cid 0 (comportement précédent).
+ * - Le canal CoAP (cid 2, UDP) sert les envois de TRANSPORT_COAP ; il n'a pas d'état de connexion côté réseau.
+ * - L'adresse et le port du serveur viennent de CACHE_DNS, qui mesure la latence des ouvertures TCP ; ceux du canal
+ *   CoAP, de la configuration de TRANSPORT_COAP (le tunnel TCP du serveur ne porte pas d'UDP).
+ * - Les canaux TCP passent en TLS quand SESSION_TLS est actif (cid configuré avant son premier AT+CAOPEN).
+ *
+ * simulerMultiplexage() mesure sur l'hôte le débit des envois et la latence des commandes sous une charge mixte.
+ */
+
+#include "MULTIPLEXEUR_SOCKETS.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "ENVOI_FRAGMENTE.hpp"
+#include "TRANSPORT_COAP.hpp"
+#include "CACHE_DNS.hpp"
+#include "SESSION_TLS.hpp"
+#include <vector>
+
+MultiplexeurSockets multiplexeurSockets; ///< Sockets du pipeline CBOR et de l'écoute descendante.
+
+static const char *NOMS_CANAUX[NB_CANAUX] = {"envoi", "controle", "coap"};
+
+MultiplexeurSockets::MultiplexeurSockets()
+{
+    reinitialiser();
+}
+
+void MultiplexeurSockets::reinitialiser()
+{
+    for (int i = 0; i < NB_CANAUX; ++i)
+    {
+        stats[i] = StatsSocket();
+        ouverts[i] = false;
+    }
+}
+
+// Socket partagé : le canal de contrôle se confond avec celui de l'envoi
+uint8_t MultiplexeurSockets::index(CanalSocket canal) const
+{
+    return !config.actif && canal == CANAL_CONTROLE ? CANAL_ENVOI : canal;
+}
+
+uint8_t MultiplexeurSockets::cid(CanalSocket canal) const
+{
+    static const uint8_t CIDS[NB_CANAUX] = {CID_ENVOI, CID_CONTROLE, CID_COAP};
+    return CIDS[index(canal)];
+}
+
+bool MultiplexeurSockets::estOuvert(CanalSocket canal) const
+{
+    return ouverts[index(canal)];
+}
+
+/**
+ * @brief Ouvre la connexion TCP du canal vers le serveur, sauf si elle est déjà ouverte.
+ * @return true si le canal est ouvert.
+ */
+bool MultiplexeurSockets::ouvrir(CanalSocket canal)
+{
+    uint8_t i = index(canal);
+    if (ouverts[i])
+    {
+        stats[i].nbOuverturesEvitees++;
+        return true;
+    }
+    String numero = String(cid(canal));
+    if (canal != CANAL_COAP && !sessionTls.preparer(cid(canal), millis()))
+    {
+        stats[i].nbEchecsOuverture++;
+        return false;
+    }
+    String commande = canal == CANAL_COAP
+                          ? "AT+CAOPEN=" + numero + ",0,\"UDP\"," + transportCoap.config.hote + "," + String(transportCoap.config.port)
+                          : "AT+CAOPEN=" + numero + ",0,\"TCP\"," + cacheDns.adresse() + "," + String(cacheDns.port());
+    unsigned long debut = millis();
+    cacheDns.debutConnexion(debut);
+    String reponse = Send_AT(commande, 8000);
+    // +CAOPEN: <cid>,<résultat> : 0 = connexion établie
+    int resultat = reponse.indexOf("+CAOPEN: " + numero + ",");
+    bool ouvert = resultat != -1 ? reponse.substring(resultat + 9 + numero.length() + 1).toInt() == 0
+                                 : reponse.indexOf("OK") != -1 && reponse.indexOf("ERROR") == -1;
+    if (canal != CANAL_COAP) // AT+CAOPEN en UDP ne fait aucun échange réseau
+    {
+        if (ouvert)
+        {
+            cacheDns.connexionReussie(millis());
+            sessionTls.connexionOuverte(debut, millis());
+        }
+        else
+        {
+            cacheDns.connexionEchouee(millis());
+            sessionTls.connexionEchouee();
+        }
+    }
+    if (!ouvert)
+    {
+        stats[i].nbEchecsOuverture++;
+        Serial.println("[SOCKETS] ouverture du canal " + String(NOMS_CANAUX[i]) + " refusee");
+        return false;
+    }
+    marquer(canal, true);
+    if (canal == CANAL_CONTROLE && config.actif && !identifier(canal))
+    {
+        Serial.println("[SOCKETS] identification du canal controle refusee");
+        fermer(canal);
+        stats[i].nbEchecsOuverture++;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Trame d'identification {"name": imei, "controle": true} écrite à l'ouverture du canal de contrôle : le
+ *        serveur y adresse ensuite ses commandes (server.ts).
+ *
+ * La trame CBOR ne contient que des textes courts et un booléen, donc aucun octet nul : elle passe par Send_AT ; le
+ * retour à la ligne ajouté après les octets annoncés est ignoré par le modem.
+ */
+bool MultiplexeurSockets::identifier(CanalSocket canal)
+{
+    std::vector<uint8_t> trame = json::to_cbor(json{{"name", imei.c_str()}, {"controle", true}});
+    String invite = Send_AT("AT+CASEND=" + String(cid(canal)) + "," + String((unsigned long)trame.size()), 2000);
+    if (invite.indexOf('>') == -1)
+        return false;
+    String contenu;
+    for (uint8_t o : trame)
+        contenu += (char)o;
+    String reponse = Send_AT(contenu, 2000);
+    return reponse.indexOf("OK") != -1 && reponse.indexOf("ERROR") == -1;
+}
+
+void MultiplexeurSockets::fermer(CanalSocket canal)
+{
+    Send_AT("AT+CACLOSE=" + String(cid(canal)));
+    marquer(canal, false);
+}
+
+/**
+ * @brief Etat d'un canal ouvert ou fermé par une autre voie (machine d'état du pipeline CBOR).
+ */
+void MultiplexeurSockets::marquer(CanalSocket canal, bool ouvert)
+{
+    uint8_t i = index(canal);
+    if (ouvert && !ouverts[i])
+        stats[i].nbOuvertures++;
+    else if (!ouvert && ouverts[i])
+        stats[i].nbFermetures++;
+    ouverts[i] = ouvert;
+}
+
+/**
+ * @brief URC "+CASTATE: <cid>,<état>" : état 0, connexion fermée par le serveur ou le réseau.
+ */
+void MultiplexeurSockets::traiterLigne(const char *ligne)
+{
+    if (strncmp(ligne, "+CASTATE:", 9) != 0)
+        return;
+    const char *virgule = strchr(ligne, ',');
+    if (virgule == nullptr || atoi(virgule + 1) != 0)
+        return;
+    int numero = atoi(ligne + 9);
+    for (int c = 0; c < NB_CANAUX; ++c)
+    {
+        uint8_t i = index((CanalSocket)c);
+        if (i != c || cid((CanalSocket)c) != numero || !ouverts[i])
+            continue;
+        ouverts[i] = false;
+        stats[i].nbFermeturesDistantes++;
+    }
+}
+
+/**
+ * @brief Débit des envois et latence des commandes du serveur pendant scenario.dureeS.
+ *
+ * Un envoi de tailleEnvoi octets part toutes les periodeEnvoiS secondes (AT+CAOPEN puis fragments AT+CASEND au débit
+ * de la voie montante) ; un envoi sur echecTousLes s'interrompt à mi-parcours. Une commande arrive toutes les
+ * intervalleControleMs.
+ * Socket partagé : une commande arrivée pendant un envoi est lue avec la réponse à l'envoi ; après un échec, le
+ * socket est fermé jusqu'au prochain envoi réussi. Sockets séparés : la commande est lue dès la fin du fragment en
+ * cours d'écriture sur l'UART, la lecture retarde d'autant l'envoi.
+ */
+RapportMultiplexage simulerMultiplexage(const ScenarioMultiplexage &scenario, const ConfigSockets &config)
+{
+    RapportMultiplexage rapport;
+    EnvoiFragmente decoupe;
+    const float msFragment = decoupe.tailleFragment(scenario.tailleEnvoi, 0) * 10000.0f / scenario.baudsUart;
+    const unsigned long dureeEnvoiMs = (unsigned long)((uint64_t)scenario.tailleEnvoi * 1000 / scenario.debitMontantOctetsParS);
+    const unsigned long periodeMs = scenario.periodeEnvoiS * 1000UL;
+    const unsigned long directMs = scenario.rttMs + scenario.lectureControleMs;
+
+    uint64_t octets = 0;
+    uint64_t tempsEnvoiMs = 0;
+    uint64_t cumul = 0;
+    std::vector<unsigned long> enAttente; // commandes du socket partagé fermé ou occupé
+    unsigned long controle = scenario.intervalleControleMs;
+
+    auto livrer = [&](unsigned long emission, unsigned long lecture) {
+        uint32_t latence = lecture - emission;
+        rapport.nbControles++;
+        cumul += latence;
+        if (latence > rapport.latenceControleMaxMs)
+            rapport.latenceControleMaxMs = latence;
+        if (latence > directMs + (uint32_t)msFragment)
+            rapport.nbControlesRetardes++;
+    };
+
+    for (unsigned long debut = 0; debut + periodeMs <= scenario.dureeS * 1000UL; debut += periodeMs)
+    {
+        rapport.nbEnvois++;
+        bool echec = scenario.echecTousLes != 0 && rapport.nbEnvois % scenario.echecTousLes == 0;
+        unsigned long fin = debut + scenario.rttMs + (echec ? dureeEnvoiMs / 2 : dureeEnvoiMs);
+        unsigned long suivant = debut + periodeMs;
+
+        for (; controle < suivant; controle += scenario.intervalleControleMs)
+        {
+            if (config.actif)
+            {
+                if (controle < fin)
+                {
+                    livrer(controle, controle + (unsigned long)(msFragment / 2) + directMs);
+                    fin += scenario.lectureControleMs; // UART partagé avec l'envoi
+                }
+                else
+                    livrer(controle, controle + directMs);
+            }
+            else if (controle < fin || echec)
+                enAttente.push_back(controle);
+            else
+                livrer(controle, controle + directMs);
+        }
+
+        if (!config.actif && !echec)
+        {
+            // Lues avec la réponse à l'envoi, puis écoute sur le socket partagé jusqu'à l'envoi suivant
+            for (unsigned long emission : enAttente)
+                livrer(emission, fin + directMs);
+            enAttente.clear();
+        }
+
+        tempsEnvoiMs += fin - debut;
+        if (echec)
+            rapport.nbEnvoisEchoues++;
+        else
+            octets += scenario.tailleEnvoi;
+    }
+
+    rapport.nbControlesEnAttente = enAttente.size();
+    if (tempsEnvoiMs > 0)
+        rapport.debitEnvoiOctetsParS = (uint32_t)(octets * 1000 / tempsEnvoiMs);
+    if (rapport.nbControles > 0)
+        rapport.latenceControleMoyenneMs = (uint32_t)(cumul / rapport.nbControles);
+    return rapport;
+}
+
+/**
+ * @brief Options reçues du serveur : {"actif": bool}.
+ */
+void chargerOptionsSockets(const json &options)
+{
+    if (options.contains("actif"))
+        multiplexeurSockets.config.actif = options["actif"].get<bool>();
+}
+
+void afficherStatsSockets()
+{
+    for (int i = 0; i < NB_CANAUX; ++i)
+    {
+        const StatsSocket &s = multiplexeurSockets.stats[i];
+        if (s.nbOuvertures == 0 && s.nbEchecsOuverture == 0)
+            continue;
+        Serial.println("[SOCKETS] " + String(NOMS_CANAUX[i]) + " : ouvertures " + String(s.nbOuvertures) + " (evitees " +
+                       String(s.nbOuverturesEvitees) + ", echecs " + String(s.nbEchecsOuverture) + ") / fermetures " +
+                       String(s.nbFermetures) + " (distantes " + String(s.nbFermeturesDistantes) + ")");
+    }
+}
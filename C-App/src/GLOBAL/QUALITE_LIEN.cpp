@@ -0,0 +1,236 @@
+/**
+ * @file QUALITE_LIEN.cpp
+ * @brief Mesure de la qualité du lien montant et bilan de chaque envoi selon cette qualité.
+ *
+ * AT+CSQ était envoyé une fois pendant la configuration et sa réponse jetée : l'envoi partait quelle que soit la
+ * couverture. Or en CAT-M1, sous environ -115 dBm de RSRP, la cellule impose des répétitions de couverture étendue
+ * (CE) : le même lot occupe l'antenne plusieurs fois plus longtemps, au courant d'émission.
+ *
+ * - La mesure vient des réponses déjà lues (AT+CPSI? du repli réseau, AT+CSQ de la configuration) ou d'un seul
+ *   AT+CPSI? pendant la fenêtre LTE quand la dernière mesure a plus de validiteMs. Le SIM7080G n'émet pas d'URC de
+ *   qualité, et pendant une fenêtre GNSS la radio ne mesure pas la cellule : la décision de fin de fenêtre GNSS
+ *   s'appuie sur la mesure de la fenêtre LTE précédente.
+ * - niveau() classe le RSRP en bon / moyen / faible, avec une hystérésis pour ne pas osciller autour du seuil.
+ *   Sans mesure récente, ou réponse illisible, le niveau est inconnu : l'arbitre radio applique ses règles habituelles.
+ * - enregistrerEnvoi() compte chaque envoi et ses octets par niveau du lien, et le RSRP moyen et minimal des envois.
+ *
+ * repetitionsCE() donne l'ordre de grandeur des répétitions selon le RSRP, pour la simulation de l'arbitre radio.
+ */
+
+#include "QUALITE_LIEN.hpp"
+#include "SIM7080G_SERIAL.hpp"
+
+QualiteLien qualiteLien; ///< Qualité du lien utilisée par l'arbitre radio et le pipeline d'envoi.
+
+static const char *NOMS_NIVEAUX[NB_NIVEAUX_LIEN] = {"inconnu", "bon", "moyen", "faible"};
+
+const char *nomNiveauLien(NiveauLien niveau)
+{
+    return niveau < NB_NIVEAUX_LIEN ? NOMS_NIVEAUX[niveau] : "?";
+}
+
+/**
+ * @brief Lit l'entier du champ numéro index (à partir de 0) de la ligne qui suit prefixe, sans allocation.
+ * @return false si le préfixe ou le champ est absent, ou si le champ n'est pas un entier.
+ */
+static bool champEntier(const String &reponse, const char *prefixe, int index, int16_t &valeur)
+{
+    const char *p = strstr(reponse.c_str(), prefixe);
+    if (p == nullptr)
+        return false;
+    p += strlen(prefixe);
+    for (int virgules = 0; virgules < index; ++p)
+    {
+        if (*p == '\0' || *p == '\r' || *p == '\n')
+            return false;
+        if (*p == ',')
+            virgules++;
+    }
+    while (*p == ' ')
+        p++;
+    char *fin = nullptr;
+    long v = strtol(p, &fin, 10);
+    if (fin == p || (*fin != ',' && *fin != '\0' && *fin != '\r' && *fin != '\n' && *fin != ' '))
+        return false;
+    valeur = (int16_t)v;
+    return true;
+}
+
+/**
+ * @brief Lit la qualité de la cellule servante dans la réponse à AT+CPSI?.
+ *
+ * Ex : "+CPSI: LTE CAT-M1,Online,208-01,0x1A2B,12345678,262,EUTRAN-BAND20,6300,3,3,-10,-95,-65,15"
+ * (après la bande passante montante : RSRQ, RSRP, RSSI, SNR).
+ * @return false hors service ou si la réponse est incomplète.
+ */
+bool parserQualiteCPSI(const String &reponse, MesureLien &mesure)
+{
+    mesure = MesureLien();
+    if (reponse.indexOf(",Online,") == -1)
+        return false;
+    MesureLien m;
+    if (!champEntier(reponse, "+CPSI:", 10, m.rsrqDb) || !champEntier(reponse, "+CPSI:", 11, m.rsrpDbm) ||
+        !champEntier(reponse, "+CPSI:", 12, m.rssiDbm) || !champEntier(reponse, "+CPSI:", 13, m.snrDb))
+        return false;
+    if (m.rsrpDbm >= 0) // champ vide ou 0 : modem pas encore synchronisé
+        return false;
+    m.valide = true;
+    mesure = m;
+    return true;
+}
+
+/**
+ * @brief Lit la réponse à AT+CSQ ("+CSQ: <rssi>,<ber>", rssi = -113 + 2 x n dBm, 99 : inconnu).
+ *
+ * AT+CSQ ne donne que le RSSI : le RSRP est estimé en retirant 19 dB (RSSI réparti sur les 72 sous-porteuses
+ * des 6 blocs de ressources d'une porteuse CAT-M1).
+ */
+bool parserCSQ(const String &reponse, MesureLien &mesure)
+{
+    mesure = MesureLien();
+    int16_t n = 0;
+    if (!champEntier(reponse, "+CSQ:", 0, n) || n < 0 || n > 31)
+        return false;
+    mesure.rssiDbm = -113 + 2 * n;
+    mesure.rsrpDbm = mesure.rssiDbm - 19;
+    mesure.valide = true;
+    return true;
+}
+
+/**
+ * @brief Ordre de grandeur des répétitions imposées par la cellule selon le RSRP (CE mode A jusqu'à 32, mode B au-delà).
+ */
+uint16_t repetitionsCE(int16_t rsrpDbm)
+{
+    if (rsrpDbm >= -105)
+        return 1;
+    if (rsrpDbm >= -110)
+        return 2;
+    if (rsrpDbm >= -115)
+        return 8;
+    if (rsrpDbm >= -120)
+        return 32;
+    return 128;
+}
+
+QualiteLien::QualiteLien()
+{
+    reinitialiser();
+}
+
+void QualiteLien::reinitialiser()
+{
+    stats = StatsQualiteLien();
+    mesure = MesureLien();
+    niveauMesure = LIEN_INCONNU;
+    mesureMs = 0;
+}
+
+NiveauLien QualiteLien::classer(int16_t rsrpDbm) const
+{
+    if (rsrpDbm < config.seuilFaibleDbm)
+        return LIEN_FAIBLE;
+    if (niveauMesure == LIEN_FAIBLE && rsrpDbm < config.seuilFaibleDbm + config.hysteresisDb)
+        return LIEN_FAIBLE;
+    return rsrpDbm >= config.seuilBonDbm ? LIEN_BON : LIEN_MOYEN;
+}
+
+void QualiteLien::noter(const MesureLien &nouvelle, unsigned long maintenant)
+{
+    if (!nouvelle.valide)
+        return;
+    mesure = nouvelle;
+    niveauMesure = classer(nouvelle.rsrpDbm);
+    mesureMs = maintenant;
+    stats.nbMesures++;
+}
+
+/**
+ * @brief Exploite une réponse déjà lue (AT+CPSI? ou AT+CSQ).
+ * @return false si la réponse ne contient pas de mesure.
+ */
+bool QualiteLien::observer(const String &reponse, unsigned long maintenant)
+{
+    if (!config.actif)
+        return false;
+    MesureLien m;
+    if (!parserQualiteCPSI(reponse, m) && !parserCSQ(reponse, m))
+        return false;
+    noter(m, maintenant);
+    return true;
+}
+
+/**
+ * @brief Fenêtre LTE ouverte : un AT+CPSI? seulement si la dernière mesure n'est plus valide.
+ */
+NiveauLien QualiteLien::mesurer(unsigned long maintenant)
+{
+    if (!config.actif)
+        return LIEN_INCONNU;
+    if (niveau(maintenant) == LIEN_INCONNU)
+    {
+        stats.nbRequetes++;
+        observer(Send_AT("AT+CPSI?", 1000), maintenant);
+    }
+    return niveau(maintenant);
+}
+
+/**
+ * @brief Niveau de la dernière mesure, inconnu si elle a plus de validiteMs.
+ */
+NiveauLien QualiteLien::niveau(unsigned long maintenant) const
+{
+    if (!config.actif || !mesure.valide || maintenant - mesureMs > config.validiteMs)
+        return LIEN_INCONNU;
+    return niveauMesure;
+}
+
+/**
+ * @brief Compte un envoi de octets selon le niveau du lien au moment de l'envoi.
+ */
+void QualiteLien::enregistrerEnvoi(size_t octets, unsigned long maintenant)
+{
+    NiveauLien n = niveau(maintenant);
+    stats.nbEnvois[n]++;
+    stats.octetsEnvoyes[n] += octets;
+    if (n == LIEN_INCONNU)
+        return;
+    if (stats.nbEnvoisMesures == 0 || mesure.rsrpDbm < stats.rsrpMinDbm)
+        stats.rsrpMinDbm = mesure.rsrpDbm;
+    stats.rsrpCumuleDbm += mesure.rsrpDbm;
+    stats.nbEnvoisMesures++;
+    Serial.println("[LIEN] envoi de " + String((unsigned long)octets) + " octets, RSRP " + String(mesure.rsrpDbm) +
+                   " dBm (" + nomNiveauLien(n) + ")");
+}
+
+/**
+ * @brief Options reçues du serveur : {"actif": bool, "seuilBonDbm": dBm, "seuilFaibleDbm": dBm, "hysteresisDb": dB, "validiteMs": ms}.
+ */
+void chargerOptionsQualiteLien(const json &options)
+{
+    ConfigQualiteLien &config = qualiteLien.config;
+    if (options.contains("actif"))
+        config.actif = options["actif"].get<bool>();
+    if (options.contains("seuilBonDbm"))
+        config.seuilBonDbm = options["seuilBonDbm"].get<int16_t>();
+    if (options.contains("seuilFaibleDbm"))
+        config.seuilFaibleDbm = options["seuilFaibleDbm"].get<int16_t>();
+    if (options.contains("hysteresisDb"))
+        config.hysteresisDb = options["hysteresisDb"].get<uint8_t>();
+    if (options.contains("validiteMs"))
+        config.validiteMs = options["validiteMs"].get<unsigned long>();
+}
+
+void afficherStatsQualiteLien()
+{
+    const StatsQualiteLien &s = qualiteLien.stats;
+    if (s.nbMesures == 0 && s.nbRequetes == 0)
+        return;
+    String ligne = "[LIEN] mesures : " + String(s.nbMesures) + " (AT+CPSI? : " + String(s.nbRequetes) + ") / envois";
+    for (int n = 0; n < NB_NIVEAUX_LIEN; ++n)
+        ligne += String(" ") + nomNiveauLien((NiveauLien)n) + " : " + String(s.nbEnvois[n]) + " (" + String((unsigned long)s.octetsEnvoyes[n]) + " o)";
+    Serial.println(ligne);
+    if (s.nbEnvoisMesures > 0)
+        Serial.println("[LIEN] RSRP des envois : moyen " + String(s.rsrpCumuleDbm / (int32_t)s.nbEnvoisMesures) +
+                       " dBm, min " + String(s.rsrpMinDbm) + " dBm");
+}
@@ -0,0 +1,199 @@
+/**
+ * @file REPRISE_ENVOI.cpp
+ * @brief Reprise d'un envoi échoué à l'étape en échec, escalade vers le pipeline global après des échecs répétés.
+ *
+ * Un échec du pipeline CBOR (AT+CASEND sans prompt, écriture fragmentée abandonnée, AT+CAOPEN refusé, pas de
+ * réponse du serveur TCP dans STEP_RECEIVE, échange CoAP ou publication MQTT sans acquittement) relançait le pipeline global : le message était effacé et une nouvelle
+ * fenêtre GNSS remplissait le tampon avant la tentative suivante, qui décimait au passage les fixes en attente
+ * (TAMPON_GNSS).
+ *
+ * - Le message CBOR encodé et le JSON du lot sont gardés : le pipeline repart de STEP_VERIFIER_CONNEXION, qui
+ *   rouvre le socket de l'envoi et renvoie AT+CASEND (ou repasse par CoAP et MQTT).
+ * - Chaque reprise attend config.delaiRepriseMs, doublé à chaque échec du même lot jusqu'à config.delaiMaxMs.
+ * - Après config.tentativesMax reprises sans succès, l'échec est escaladé : le pipeline global est relancé comme
+ *   auparavant et les fixes du lot repartent au cycle suivant avec ceux de la nouvelle fenêtre.
+ *
+ * simulerReprise() compare sur l'hôte, avec des échecs injectés par intermittence, le délai de livraison des fixes
+ * et la part des fixes gardés avec et sans reprise.
+ */
+
+#include "REPRISE_ENVOI.hpp"
+#include "TAMPON_GNSS.hpp"
+#include <vector>
+
+RepriseEnvoi repriseEnvoi; ///< Suite des échecs du pipeline CBOR, décidée par le callback d'erreur de STEP_INIT_CBOR.
+
+RepriseEnvoi::RepriseEnvoi()
+{
+    reinitialiser();
+}
+
+void RepriseEnvoi::reinitialiser()
+{
+    stats = StatsReprise();
+    echecs = 0;
+    premierEchecMs = 0;
+    repriseMs = 0;
+}
+
+/**
+ * @brief Enregistre l'échec du lot en cours et décide de sa suite : reprise après un délai, ou escalade.
+ */
+SuiteEchec RepriseEnvoi::echec(unsigned long maintenant)
+{
+    stats.nbEchecs++;
+    if (echecs == 0)
+        premierEchecMs = maintenant;
+    if (!config.actif || echecs >= config.tentativesMax)
+    {
+        stats.nbEscalades++;
+        echecs = 0;
+        return SUITE_ESCALADER;
+    }
+
+    unsigned long delai = config.delaiRepriseMs;
+    for (uint8_t i = 0; i < echecs && delai < config.delaiMaxMs; ++i)
+        delai *= 2;
+    if (delai > config.delaiMaxMs)
+        delai = config.delaiMaxMs;
+    echecs++;
+    stats.nbReprises++;
+    repriseMs = maintenant + delai;
+    return SUITE_REPRENDRE;
+}
+
+bool RepriseEnvoi::enAttente(unsigned long maintenant) const
+{
+    return echecs > 0 && (long)(maintenant - repriseMs) < 0;
+}
+
+/**
+ * @brief Lot acquitté (STEP_END) : le compte d'échecs repart de zéro.
+ */
+void RepriseEnvoi::envoiReussi(unsigned long maintenant)
+{
+    if (echecs > 0)
+    {
+        uint32_t delai = maintenant - premierEchecMs;
+        stats.nbLivresApresReprise++;
+        stats.delaiLivraisonCumuleMs += delai;
+        if (delai > stats.delaiLivraisonMaxMs)
+            stats.delaiLivraisonMaxMs = delai;
+    }
+    echecs = 0;
+}
+
+RapportReprise simulerReprise(const ScenarioReprise &scenario, const ConfigReprise &config)
+{
+    RapportReprise rapport;
+    RepriseEnvoi reprise;
+    reprise.config = config;
+    ConfigTampon tampon;
+    const size_t capacite = tampon.maxPoints < MAX_COORDS ? tampon.maxPoints : MAX_COORDS;
+    const size_t garde = capacite - tampon.placeCycle;
+    const unsigned long fin = scenario.dureeS * 1000UL;
+
+    uint32_t alea = scenario.graine;
+    auto echoue = [&]()
+    {
+        alea = alea * 1103515245UL + 12345UL;
+        return ((alea >> 16) % 100) < scenario.tauxEchecPct;
+    };
+
+    std::vector<unsigned long> attente; // instants d'acquisition des fixes non livrés
+    uint64_t delaiCumule = 0;
+    uint32_t nbLots = 0;
+    unsigned long pretMs = 0; // première composition du lot en attente
+    unsigned long t = 0;
+    while (t < fin)
+    {
+        // Fenêtre GNSS : des fixes attendent encore, le tampon est décimé pour laisser de la place aux nouveaux
+        bool nouveauLot = attente.empty();
+        if (attente.size() > garde)
+        {
+            size_t retires = attente.size() - garde;
+            attente.erase(attente.begin() + 1, attente.begin() + 1 + retires);
+            rapport.nbPerdus += retires;
+        }
+        rapport.nbFenetresGnss++;
+        t += scenario.demarrageGnssMs;
+        while (attente.size() < capacite)
+        {
+            attente.push_back(t);
+            rapport.nbFixes++;
+            t += scenario.intervalleFixS * 1000UL;
+        }
+        if (nouveauLot)
+            pretMs = t;
+
+        // Envoi du lot, repris à l'étape en échec jusqu'à l'escalade
+        bool livre = false;
+        while (true)
+        {
+            if (!echoue())
+            {
+                t += scenario.envoiMs;
+                livre = true;
+                break;
+            }
+            t += scenario.detectionEchecMs;
+            rapport.nbEchecs++;
+            if (reprise.echec(t) == SUITE_ESCALADER)
+                break;
+            while (reprise.enAttente(t))
+                t += 100;
+        }
+        if (!livre)
+            continue; // escalade : STEP_INIT_GLOBAL, nouvelle fenêtre GNSS sans attendre la période
+
+        reprise.envoiReussi(t);
+        uint32_t delai = t - pretMs;
+        delaiCumule += delai;
+        nbLots++;
+        if (delai > rapport.delaiLivraisonMaxMs)
+            rapport.delaiLivraisonMaxMs = delai;
+        rapport.nbLivres += attente.size();
+        attente.clear();
+        t += scenario.periodeS * 1000UL;
+    }
+
+    rapport.nbEscalades = reprise.stats.nbEscalades;
+    if (nbLots > 0)
+        rapport.delaiLivraisonMoyenMs = (uint32_t)(delaiCumule / nbLots);
+    if (rapport.nbFixes > 0)
+        rapport.donneesGardees = (float)(rapport.nbFixes - rapport.nbPerdus) / rapport.nbFixes;
+    return rapport;
+}
+
+/**
+ * @brief Options "reprise" : {"actif":true,"tentativesMax":3,"delaiRepriseMs":2000,"delaiMaxMs":30000,
+ *        "attenteReponseMs":8000}. tentativesMax est borné à [0, TENTATIVES_MAX_REPRISE].
+ */
+void chargerOptionsReprise(const json &options)
+{
+    ConfigReprise &config = repriseEnvoi.config;
+    if (options.contains("actif"))
+        config.actif = options["actif"].get<bool>();
+    if (options.contains("tentativesMax"))
+    {
+        long tentatives = options["tentativesMax"].get<long>();
+        config.tentativesMax = tentatives < 0 ? 0 : (tentatives > TENTATIVES_MAX_REPRISE ? TENTATIVES_MAX_REPRISE : tentatives);
+    }
+    if (options.contains("delaiRepriseMs"))
+        config.delaiRepriseMs = options["delaiRepriseMs"].get<unsigned long>();
+    if (options.contains("delaiMaxMs"))
+        config.delaiMaxMs = options["delaiMaxMs"].get<unsigned long>();
+    if (options.contains("attenteReponseMs"))
+        config.attenteReponseMs = options["attenteReponseMs"].get<unsigned long>();
+}
+
+void afficherStatsReprise()
+{
+    const StatsReprise &s = repriseEnvoi.stats;
+    if (s.nbEchecs == 0)
+        return;
+    uint32_t moyenne = s.nbLivresApresReprise ? (uint32_t)(s.delaiLivraisonCumuleMs / s.nbLivresApresReprise) : 0;
+    Serial.println("[REPRISE] echecs : " + String(s.nbEchecs) + " / reprises " + String(s.nbReprises) + " / escalades " +
+                   String(s.nbEscalades) + " / lots livres apres reprise " + String(s.nbLivresApresReprise) +
+                   " / delai de livraison (ms) moyen " + String(moyenne) + ", max " + String(s.delaiLivraisonMaxMs));
+}
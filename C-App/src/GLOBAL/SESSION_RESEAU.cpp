@@ -0,0 +1,343 @@
+/**
+ * @file SESSION_RESEAU.cpp
+ * @brief Suivi de la session réseau (enregistrement, contexte PDP, adresse IP) et reprise graduée après une perte.
+ *
+ * step_catm1_function() configure la liaison CAT-M1 une fois par démarrage, puis reste sur CATM1_DONE : une perte
+ * de cellule ou du contexte PDP n'était jamais détectée, et STEP_VERIFIER_CONNEXION se contentait de relire AT+CEREG?.
+ *
+ * L'état est tenu à jour par les URC du modem (+CEREG avec AT+CEREG=1, +APP PDP) lues au fil de l'eau, et par les
+ * réponses aux requêtes (AT+CEREG?, AT+CNACT?). verifier() ne relit l'état que s'il n'a pas été confirmé depuis
+ * validiteEtatMs (une URC a pu être manquée pendant le sommeil).
+ *
+ * Après une perte, reprendre() commence par l'action la moins coûteuse :
+ * - perte de cellule (recherche en cours) : aucune action pendant attenteReselectionMs, le modem cherche seul ;
+ * - contexte PDP tombé, modem enregistré : AT+CNACT=0,1 ;
+ * - puis ré-attachement (AT+CFUN=0 / AT+CFUN=1) sans toucher au profil ;
+ * - en dernier recours, reconfiguration complète par step_catm1_function().
+ * Chaque action reçoit attenteActionMs pour aboutir (URC attendue) ; l'état est relu avant de monter d'une marche.
+ *
+ * Le temps de reprise (de la détection de la perte au retour de la session) est mesuré par marche.
+ */
+
+#include "SESSION_RESEAU.hpp"
+#include "SIM7080G_DEMARRAGE.hpp"
+#include "MULTIPLEXEUR_SOCKETS.hpp"
+#include "AIGUILLAGE_URC.hpp"
+
+SessionReseau sessionReseau; ///< Session réseau utilisée par STEP_VERIFIER_CONNEXION.
+
+static const char *NOMS_ETAPES[NB_ETAPES_REPRISE] = {"reselection", "PDP", "enregistrement", "configuration"};
+
+const char *nomEtapeReprise(EtapeReprise etape)
+{
+    return etape < NB_ETAPES_REPRISE ? NOMS_ETAPES[etape] : "?";
+}
+
+SessionReseau::SessionReseau()
+{
+    reinitialiser();
+}
+
+void SessionReseau::reinitialiser()
+{
+    stats = StatsSessionReseau();
+    etat = ENREG_INCONNU;
+    pdp = false;
+    connu = false;
+    adresse[0] = '\0';
+    majMs = 0;
+    enPanne = false;
+    perteMs = 0;
+    marche = REPRISE_AUCUNE;
+    enCours = REPRISE_AUCUNE;
+    actionMs = 0;
+    nbPdp = 0;
+    nbEnregistrements = 0;
+    longueur = 0;
+}
+
+// L'état suivi n'est plus sûr (modem redémarré, URC perdues) : la prochaine vérification le relit
+void SessionReseau::invalider()
+{
+    connu = false;
+}
+
+/**
+ * @brief Met à jour l'état à partir d'une ligne reçue du modem (URC ou réponse).
+ *
+ * - "+CEREG: <stat>[,<tac>,...]" (URC) ou "+CEREG: <n>,<stat>[,...]" (réponse à AT+CEREG?)
+ * - "+APP PDP: 0,ACTIVE" / "+APP PDP: 0,DEACTIVE"
+ * - "+CNACT: 0,<statut>,\"<ip>\""
+ */
+void SessionReseau::traiterLigne(const char *texte, unsigned long maintenant)
+{
+    if (strncmp(texte, "+CEREG: ", 8) == 0)
+    {
+        const char *champs = texte + 8;
+        const char *virgule = strchr(champs, ',');
+        // Dans une réponse, le 2e champ est <stat> ; dans une URC (n=2), c'est le TAC entre guillemets
+        bool reponse = virgule != nullptr && isdigit((unsigned char)virgule[1]);
+        int stat = atoi(reponse ? virgule + 1 : champs);
+        if (!reponse)
+            stats.nbUrc++;
+        bool etaitEnregistre = connu && estEnregistre();
+        etat = (stat >= ENREG_NON && stat <= ENREG_ITINERANCE) ? (EtatEnregistrement)stat : ENREG_INCONNU;
+        if (etaitEnregistre && !estEnregistre())
+        {
+            stats.nbPertesEnregistrement++;
+            signalerPerte(maintenant);
+        }
+    }
+    else if (strncmp(texte, "+APP PDP: 0,", 12) == 0)
+    {
+        stats.nbUrc++;
+        bool actif = strncmp(texte + 12, "ACTIVE", 6) == 0;
+        if (connu && pdp && !actif)
+        {
+            stats.nbPertesPdp++;
+            signalerPerte(maintenant);
+        }
+        pdp = actif;
+        if (!actif)
+            adresse[0] = '\0';
+    }
+    else if (strncmp(texte, "+CNACT: 0,", 10) == 0)
+    {
+        String ip = parseIpCNACT(String(texte));
+        if (connu && pdp && ip.length() == 0)
+        {
+            stats.nbPertesPdp++;
+            signalerPerte(maintenant);
+        }
+        pdp = ip.length() > 0;
+        strncpy(adresse, ip.c_str(), sizeof(adresse) - 1);
+        adresse[sizeof(adresse) - 1] = '\0';
+    }
+    else
+    {
+        // Etat des connexions AT+CA* : suivi par canal dans MULTIPLEXEUR_SOCKETS
+        multiplexeurSockets.traiterLigne(texte);
+        return;
+    }
+
+    majMs = maintenant;
+    if (estPrete())
+        retablir(maintenant);
+}
+
+/**
+ * @brief Reçoit des octets du modem (URC) ; chaque ligne complète est traitée.
+ */
+void SessionReseau::traiter(const char *donnees, size_t taille, unsigned long maintenant)
+{
+    for (size_t i = 0; i < taille; ++i)
+    {
+        char c = donnees[i];
+        if (c == '\r' || c == '\n')
+        {
+            if (longueur > 0)
+            {
+                ligne[longueur] = '\0';
+                traiterLigne(ligne, maintenant);
+            }
+            longueur = 0;
+        }
+        else if (longueur < TAILLE_LIGNE_RESEAU - 1)
+            ligne[longueur++] = c; // une ligne trop longue est tronquée : seuls les premiers champs servent
+    }
+}
+
+/**
+ * @brief Traite une réponse complète à Send_AT(), sans toucher à la ligne d'URC en cours d'assemblage.
+ */
+void SessionReseau::traiter(const String &reponse, unsigned long maintenant)
+{
+    char texte[TAILLE_LIGNE_RESEAU];
+    size_t n = 0;
+    for (size_t i = 0; i <= reponse.length(); ++i)
+    {
+        char c = i < reponse.length() ? reponse[i] : '\n';
+        if (c == '\r' || c == '\n')
+        {
+            if (n > 0)
+            {
+                texte[n] = '\0';
+                traiterLigne(texte, maintenant);
+            }
+            n = 0;
+        }
+        else if (n < sizeof(texte) - 1)
+            texte[n++] = c;
+    }
+}
+
+/**
+ * @brief Lit les URC reçues depuis le dernier passage ; celles des autres modules (+SMSUB, +CADATAIND) leur sont
+ * remises par AIGUILLAGE_URC, qui rend les autres à traiterLigne().
+ * @return Le nombre d'octets lus.
+ */
+int SessionReseau::pomper(unsigned long maintenant)
+{
+    return aiguillageUrc.lire(maintenant);
+}
+
+// Relit l'enregistrement et le contexte PDP (requêtes)
+void SessionReseau::rafraichir(unsigned long maintenant)
+{
+    bool etaitEnregistre = connu && estEnregistre();
+    bool etaitActif = connu && pdp;
+    etat = ENREG_INCONNU; // un modem muet compte comme non enregistré
+    pdp = false;
+    adresse[0] = '\0';
+    stats.nbRequetes += 2;
+    traiter(Send_AT("AT+CEREG?", 1000), maintenant);
+    traiter(Send_AT("AT+CNACT?", 1000), maintenant);
+    connu = true;
+    majMs = maintenant;
+    if (etaitEnregistre && !estEnregistre())
+        stats.nbPertesEnregistrement++;
+    if (etaitActif && !pdp)
+        stats.nbPertesPdp++;
+}
+
+void SessionReseau::signalerPerte(unsigned long maintenant)
+{
+    if (enPanne)
+        return;
+    enPanne = true;
+    perteMs = maintenant;
+    marche = REPRISE_AUCUNE;
+    enCours = REPRISE_AUCUNE;
+    actionMs = maintenant;
+    nbPdp = 0;
+    nbEnregistrements = 0;
+}
+
+void SessionReseau::retablir(unsigned long maintenant)
+{
+    if (!enPanne)
+        return;
+    uint32_t duree = maintenant - perteMs;
+    stats.nbReprises[marche]++;
+    stats.repriseCumuleeMs += duree;
+    if (duree > stats.repriseMaxMs)
+        stats.repriseMaxMs = duree;
+    enPanne = false;
+    enCours = REPRISE_AUCUNE;
+    Serial.println("[RESEAU] session retablie (" + String(nomEtapeReprise(marche)) + ") en " + String(duree) + " ms");
+}
+
+/**
+ * @brief La session est-elle utilisable ? Sans commande AT si l'état suivi par URC est récent.
+ */
+bool SessionReseau::verifier(unsigned long maintenant)
+{
+    pomper(maintenant);
+    if (connu && (maintenant - majMs) < config.validiteEtatMs)
+        stats.nbVerificationsSansAT++;
+    else
+        rafraichir(maintenant);
+
+    if (estPrete())
+    {
+        retablir(maintenant);
+        return true;
+    }
+    signalerPerte(maintenant);
+    return false;
+}
+
+EtapeReprise SessionReseau::agir(EtapeReprise action, unsigned long maintenant)
+{
+    stats.nbActions[action]++;
+    if (action > marche)
+        marche = action;
+    enCours = action;
+    actionMs = maintenant;
+    Serial.println("[RESEAU] reprise : " + String(nomEtapeReprise(action)));
+    if (action == REPRISE_PDP)
+    {
+        nbPdp++;
+        traiter(Send_AT("AT+CNACT=0,1", 2000), maintenant);
+    }
+    else if (action == REPRISE_ENREGISTREMENT)
+    {
+        nbEnregistrements++;
+        nbPdp = 0; // nouvel attachement : le contexte PDP a droit à de nouvelles tentatives
+        Send_AT("AT+CFUN=0", 5000);
+        Send_AT("AT+CFUN=1", 5000);
+        etat = ENREG_RECHERCHE;
+        pdp = false;
+        adresse[0] = '\0';
+    }
+    return action;
+}
+
+/**
+ * @brief Fait avancer la reprise d'un pas (appelée tant que verifier() échoue).
+ * @return L'action lancée ; REPRISE_CONFIGURATION demande à l'appelant de relancer step_catm1_function().
+ */
+EtapeReprise SessionReseau::reprendre(unsigned long maintenant)
+{
+    signalerPerte(maintenant);
+    if (estPrete() || enCours == REPRISE_CONFIGURATION)
+        return REPRISE_AUCUNE;
+
+    // Laisser aboutir ce qui est en cours
+    if (enCours == REPRISE_AUCUNE && etat == ENREG_RECHERCHE && (maintenant - perteMs) < config.attenteReselectionMs)
+        return REPRISE_AUCUNE; // perte de cellule : le modem cherche seul une autre cellule
+    if (enCours == REPRISE_PDP && (maintenant - actionMs) < config.attenteActionMs)
+        return REPRISE_AUCUNE; // +APP PDP: 0,ACTIVE attendue
+    if (enCours == REPRISE_ENREGISTREMENT && !estEnregistre() && (maintenant - actionMs) < config.attenteActionMs)
+        return REPRISE_AUCUNE; // +CEREG attendue
+
+    // Rien appris depuis la dernière action : l'URC a pu être manquée, l'état est relu avant de monter d'une marche
+    if (majMs < actionMs || (enCours != REPRISE_AUCUNE && majMs == actionMs))
+    {
+        rafraichir(maintenant);
+        if (estPrete())
+        {
+            retablir(maintenant);
+            return REPRISE_AUCUNE;
+        }
+    }
+
+    if (estEnregistre() && nbPdp < config.tentativesPdp)
+        return agir(REPRISE_PDP, maintenant);
+    if (nbEnregistrements < config.tentativesEnregistrement)
+        return agir(REPRISE_ENREGISTREMENT, maintenant);
+    return agir(REPRISE_CONFIGURATION, maintenant);
+}
+
+/**
+ * @brief Fin de la reconfiguration complète (CATM1_INFO) : la reprise repart de la première marche si besoin.
+ */
+void SessionReseau::configurationTerminee(unsigned long maintenant)
+{
+    connu = true;
+    majMs = maintenant;
+    if (enCours != REPRISE_CONFIGURATION)
+        return;
+    enCours = REPRISE_AUCUNE;
+    actionMs = maintenant;
+    nbPdp = 0;
+    nbEnregistrements = 0;
+}
+
+void afficherStatsSessionReseau()
+{
+    const StatsSessionReseau &s = sessionReseau.stats;
+    if (s.nbUrc == 0 && s.nbRequetes == 0 && s.nbVerificationsSansAT == 0)
+        return;
+    uint32_t nbReprises = 0;
+    for (int i = 0; i < NB_ETAPES_REPRISE; ++i)
+        nbReprises += s.nbReprises[i];
+    uint32_t moyenne = nbReprises ? (uint32_t)(s.repriseCumuleeMs / nbReprises) : 0;
+    Serial.println("[RESEAU] URC : " + String(s.nbUrc) + " / requetes : " + String(s.nbRequetes) +
+                   " / verifications sans AT : " + String(s.nbVerificationsSansAT));
+    Serial.println("[RESEAU] pertes enregistrement : " + String(s.nbPertesEnregistrement) + ", PDP : " + String(s.nbPertesPdp) +
+                   " / actions PDP : " + String(s.nbActions[REPRISE_PDP]) + ", enregistrement : " +
+                   String(s.nbActions[REPRISE_ENREGISTREMENT]) + ", configuration : " + String(s.nbActions[REPRISE_CONFIGURATION]));
+    Serial.println("[RESEAU] reprises : " + String(nbReprises) + " (moyenne " + String(moyenne) + " ms, max " +
+                   String(s.repriseMaxMs) + " ms)");
+}
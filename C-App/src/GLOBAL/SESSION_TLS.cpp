@@ -0,0 +1,404 @@
+/**
+ * @file SESSION_TLS.cpp
+ * @brief TLS des sockets de l'envoi et du contrôle par le moteur SSL du SIM7080G (AT+CSSLCFG, AT+CASSLCFG).
+ *
+ * Les envois passaient en clair dans le tunnel public. Une poignée de main TLS complète (certificats, échange de
+ * clés) coûte deux allers-retours et plusieurs kilo-octets sur CAT-M1 : refaite à chaque AT+CAOPEN, elle
+ * dépasserait le coût de l'envoi lui-même.
+ *
+ * - Le contexte SSL (version, SNI, heure ignorée, CA) n'est écrit qu'une fois, AT+CASSLCFG une fois par cid. Ces
+ *   deux états survivent au sommeil du modem (ETAT_RTC).
+ * - Le serveur est authentifié par défaut : sans config.certificatCa, aucun cid n'est préparé. La CA est un fichier
+ *   que le firmware n'écrit pas : il doit avoir été chargé dans le modem (AT+CFSINIT, AT+CFSWFILE) à la mise en
+ *   service. Elle est convertie dans le contexte ("convert",2) ; chargerOptionsTls() refuse d'activer TLS (ou de
+ *   changer de CA) si cette conversion échoue, sinon tous les envois échoueraient, options du serveur comprises.
+ *   La validité des dates n'est pas vérifiée (ignorertctime) : l'heure du modem n'est pas réglée au premier envoi.
+ * - Le jeu de commandes du SIM7080G n'expose ni ticket ni reprise de session : chaque AT+CAOPEN refait une poignée
+ *   complète. Le gain vient du socket de l'envoi gardé ouvert après l'envoi (STEP_CLOSE_CONNEXION) : l'envoi
+ *   suivant, s'il arrive avant config.garderOuvertS et si AT+CASTATE? le donne encore connecté, ne refait aucune
+ *   poignée de main (STEP_OPEN_CONNEXION).
+ * - Le SNI est le nom du point d'accès (CACHE_DNS), même quand AT+CAOPEN vise son adresse IP.
+ *
+ * simulerTls() compare sur l'hôte, avec un serveur TLS local, les poignées de main, les octets et le temps par
+ * envoi en clair, en TLS avec un socket par envoi et en TLS avec socket gardé.
+ */
+
+#include "SESSION_TLS.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "CACHE_DNS.hpp"
+#include "MULTIPLEXEUR_SOCKETS.hpp"
+
+SessionTls sessionTls; ///< Contexte SSL des sockets AT+CA*, utilisé par STEP_OPEN_CONNEXION et MULTIPLEXEUR_SOCKETS.
+
+static const String REPONSE_OK = "\r\nOK\r\n";
+
+SessionTls::SessionTls()
+{
+    reinitialiser();
+}
+
+void SessionTls::reinitialiser()
+{
+    stats = StatsTls();
+    configure = false;
+    prepares = 0;
+    dernierEnvoiMs = 0;
+    socketGarde = false;
+    poignee = POIGNEE_AUCUNE;
+    hoteSni = "";
+}
+
+String SessionTls::repondre(const String &texte)
+{
+    stats.transactionsAT++;
+    return commande != nullptr ? commande(texte, 1000) : Send_AT(texte, 1000);
+}
+
+bool SessionTls::envoyer(const String &texte)
+{
+    String reponse = repondre(texte);
+    return reponse.indexOf("OK") != -1 && reponse.indexOf("ERROR") == -1;
+}
+
+/**
+ * @brief Convertit la CA (AT+CSSLCFG="convert") : échoue si son fichier n'a pas été chargé dans le modem.
+ * @return true si le serveur n'a pas à être authentifié, ou si la CA est utilisable.
+ */
+bool SessionTls::verifierCa()
+{
+    if (!config.authentification)
+        return true;
+    return config.certificatCa.length() > 0 && envoyer("AT+CSSLCFG=\"convert\",2,\"" + config.certificatCa + "\"");
+}
+
+/**
+ * @brief Configure le contexte SSL et le cid avant AT+CAOPEN, sans rien renvoyer de déjà appliqué.
+ * @return false si le modem refuse la configuration, ou si aucune CA n'est donnée alors que le serveur doit être
+ *         authentifié.
+ */
+bool SessionTls::preparer(uint8_t cid, unsigned long maintenant)
+{
+    (void)maintenant;
+    if (!config.actif)
+    {
+        // TLS désactivé depuis : le modem garde SSL sur le cid tant qu'il n'est pas remis à 0
+        if (cid < NB_CIDS_TLS && (prepares & (1 << cid)) != 0 && envoyer("AT+CASSLCFG=" + String(cid) + ",\"SSL\",0"))
+            prepares &= ~(1 << cid);
+        return true;
+    }
+    if (config.authentification && config.certificatCa.length() == 0)
+    {
+        stats.nbEchecs++;
+        Serial.println("[TLS] pas de CA : serveur non authentifie, connexion refusee");
+        return false;
+    }
+    String contexte = String(config.contexte);
+    String hote = String(cacheDns.hote());
+    if (hoteSni.length() > 0 && hoteSni != hote)
+        configure = false; // le SNI suit le point d'accès choisi
+    if (!configure)
+    {
+        bool ok = envoyer("AT+CSSLCFG=\"sslversion\"," + contexte + "," + String(config.versionTls)) &&
+                  envoyer("AT+CSSLCFG=\"ignorertctime\"," + contexte + ",1") &&
+                  envoyer("AT+CSSLCFG=\"sni\"," + contexte + ",\"" + hote + "\"") &&
+                  (!config.authentification ||
+                   envoyer("AT+CSSLCFG=\"convert\",2,\"" + config.certificatCa + "\""));
+        if (!ok)
+        {
+            stats.nbEchecs++;
+            Serial.println("[TLS] contexte SSL refuse par le modem");
+            return false;
+        }
+        configure = true;
+        hoteSni = hote;
+        prepares = 0; // CRINDEX et CACERT réappliqués avec le nouveau contexte
+        stats.nbConfigurations++;
+    }
+    if (cid >= NB_CIDS_TLS || (prepares & (1 << cid)) != 0)
+        return true;
+    String numero = String(cid);
+    bool ok = envoyer("AT+CASSLCFG=" + numero + ",\"SSL\",1") &&
+              envoyer("AT+CASSLCFG=" + numero + ",\"CRINDEX\"," + contexte) &&
+              (!config.authentification ||
+               envoyer("AT+CASSLCFG=" + numero + ",\"CACERT\",\"" + config.certificatCa + "\""));
+    if (!ok)
+    {
+        stats.nbEchecs++;
+        Serial.println("[TLS] SSL refuse sur le cid " + numero);
+        return false;
+    }
+    prepares |= 1 << cid;
+    return true;
+}
+
+/**
+ * @brief AT+CAOPEN réussi sur un cid préparé : poignée de main complète.
+ */
+void SessionTls::connexionOuverte(unsigned long debut, unsigned long maintenant)
+{
+    if (!config.actif)
+        return;
+    poignee = POIGNEE_COMPLETE;
+    stats.nbPoignees++;
+    stats.latenceCumuleeMs += maintenant - debut;
+}
+
+/**
+ * @brief Poignée de main refusée : le contexte est réécrit à la prochaine ouverture.
+ */
+void SessionTls::connexionEchouee()
+{
+    if (!config.actif)
+        return;
+    stats.nbEchecs++;
+    reconfigurer();
+}
+
+void SessionTls::reconfigurer()
+{
+    configure = false;
+    socketGarde = false;
+}
+
+/**
+ * @brief Le socket de l'envoi, resté ouvert, sert l'envoi suivant s'il n'a pas dépassé config.garderOuvertS et si
+ *        le modem le donne encore connecté (AT+CASTATE?) : une fermeture par le réseau peut avoir échappé aux URC.
+ */
+bool SessionTls::reutiliser(unsigned long maintenant)
+{
+    if (!config.actif || !socketGarde || config.garderOuvertS == 0 ||
+        maintenant - dernierEnvoiMs >= config.garderOuvertS * 1000UL)
+        return false;
+    if (repondre("AT+CASTATE?").indexOf("+CASTATE: " + String(CID_ENVOI) + ",1") == -1)
+    {
+        socketGarde = false;
+        stats.nbSocketsPerdus++;
+        Serial.println("[TLS] socket de l'envoi ferme par le reseau");
+        return false;
+    }
+    poignee = POIGNEE_AUCUNE;
+    stats.nbConnexionsGardees++;
+    return true;
+}
+
+/**
+ * @brief Fin d'un envoi.
+ * @return true si le socket de l'envoi doit rester ouvert pour le suivant.
+ */
+bool SessionTls::terminerEnvoi(unsigned long maintenant)
+{
+    dernierEnvoiMs = maintenant;
+    socketGarde = config.actif && config.garderOuvertS > 0;
+    return socketGarde;
+}
+
+/**
+ * @brief État relu de la mémoire RTC : le modem a gardé son contexte SSL pendant le sommeil, pas les sockets.
+ */
+void SessionTls::restaurer(bool configureModem, uint8_t cids)
+{
+    configure = configureModem;
+    prepares = configureModem ? cids : 0;
+    socketGarde = false;
+}
+
+/**
+ * @brief Commandes AT+CSSLCFG, AT+CASSLCFG, AT+CAOPEN, AT+CASTATE? et AT+CACLOSE reçues par le modem, vues côté
+ *        réseau.
+ */
+String ServeurTlsLocal::traiter(const String &commande, unsigned long maintenant)
+{
+    (void)maintenant;
+    if (commande.startsWith("AT+CSSLCFG=\"convert\","))
+        return caChargee ? REPONSE_OK : "\r\nERROR\r\n";
+    if (commande.startsWith("AT+CSSLCFG="))
+        return REPONSE_OK;
+    if (commande.startsWith("AT+CASSLCFG="))
+    {
+        int cid = commande.substring(12).toInt();
+        if (cid >= 0 && cid < NB_CIDS_TLS && commande.indexOf("\"SSL\",") != -1)
+            ssl[cid] = commande.endsWith("1");
+        if (cid >= 0 && cid < NB_CIDS_TLS && commande.indexOf("\"CACERT\",") != -1)
+            ca[cid] = true;
+        return REPONSE_OK;
+    }
+    if (commande.startsWith("AT+CASTATE?"))
+    {
+        String reponse = "\r\n";
+        for (int i = 0; i < NB_CIDS_TLS; ++i)
+            if (ouverts[i])
+                reponse += "+CASTATE: " + String(i) + ",1\r\n";
+        return reponse + REPONSE_OK;
+    }
+    if (commande.startsWith("AT+CAOPEN="))
+    {
+        int cid = commande.substring(10).toInt();
+        if (cid < 0 || cid >= NB_CIDS_TLS || ouverts[cid])
+            return "\r\nERROR\r\n";
+        ouverts[cid] = true;
+        if (!ssl[cid])
+        {
+            nbConnexionsClaires++;
+            derniere = POIGNEE_AUCUNE;
+        }
+        else
+        {
+            nbPoigneesCompletes++;
+            derniere = POIGNEE_COMPLETE;
+            if (!ca[cid])
+                nbConnexionsNonAuthentifiees++;
+        }
+        return "\r\n+CAOPEN: " + String(cid) + ",0\r\n\r\nOK\r\n";
+    }
+    if (commande.startsWith("AT+CACLOSE="))
+        couper(commande.substring(11).toInt());
+    if (commande.startsWith("AT+CASEND="))
+        return "\r\n>";
+    return REPONSE_OK;
+}
+
+// Le serveur ferme ses connexions
+void ServeurTlsLocal::redemarrer()
+{
+    for (int i = 0; i < NB_CIDS_TLS; ++i)
+        ouverts[i] = false;
+}
+
+void ServeurTlsLocal::couper(uint8_t cid)
+{
+    if (cid < NB_CIDS_TLS)
+        ouverts[cid] = false;
+}
+
+static ServeurTlsLocal *serveurSimule = nullptr;
+static unsigned long instantSimule = 0;
+
+static String commandeSimulee(const String &commande, long)
+{
+    return serveurSimule->traiter(commande, instantSimule);
+}
+
+/**
+ * @brief Banc d'essai : un envoi toutes les scenario.periodeS vers le serveur TLS local.
+ *
+ * Chaque ouverture coûte un aller-retour TCP, plus deux allers-retours de poignée complète ; les octets des
+ * poignées et des enregistrements passent au débit de la voie montante. Un socket gardé est vérifié par
+ * AT+CASTATE? avant d'être repris. L'envoi est un AT+CASEND et un AT+CARECV (un aller-retour). Le socket est coupé
+ * par le réseau un envoi sur coupureTous, et le serveur ferme ses connexions avant l'envoi redemarrageServeurA.
+ * config.actif à false : envois en clair (comportement précédent).
+ */
+RapportTls simulerTls(const ScenarioTls &scenario, const ConfigTls &config)
+{
+    RapportTls rapport;
+    ServeurTlsLocal serveur;
+    SessionTls session;
+    session.config = config;
+    session.commande = commandeSimulee;
+    serveurSimule = &serveur;
+    const unsigned long at = scenario.commandeAtMs;
+    uint64_t octets = 0;
+    uint64_t temps = 0;
+    uint32_t transactions = 0;
+
+    for (uint16_t k = 0; k < scenario.nbEnvois; ++k)
+    {
+        unsigned long t = (unsigned long)k * scenario.periodeS * 1000UL;
+        instantSimule = t;
+        if (scenario.redemarrageServeurA != 0 && k == scenario.redemarrageServeurA)
+            serveur.redemarrer();
+        unsigned long duree = 0;
+        uint32_t verification = session.stats.transactionsAT;
+        bool garde = session.reutiliser(t);
+        transactions += session.stats.transactionsAT - verification;
+        duree += (session.stats.transactionsAT - verification) * at;
+        if (!garde)
+        {
+            if (serveur.estOuvert(CID_ENVOI))
+            {
+                serveur.traiter("AT+CACLOSE=0", t);
+                transactions++;
+                duree += at;
+            }
+            uint32_t avant = session.stats.transactionsAT;
+            session.preparer(CID_ENVOI, t);
+            transactions += session.stats.transactionsAT - avant + 1;
+            duree += (session.stats.transactionsAT - avant) * at;
+            serveur.traiter("AT+CAOPEN=0,0,\"TCP\",serveur.local,443", t);
+            duree += at + scenario.rttMs;
+            uint16_t poignee = 0;
+            if (serveur.derniere == POIGNEE_COMPLETE)
+            {
+                poignee = scenario.octetsPoigneeComplete;
+                duree += 2 * scenario.rttMs;
+            }
+            duree += poignee * 1000UL / scenario.debitOctetsParS;
+            octets += poignee;
+            session.connexionOuverte(t, t + duree);
+        }
+        uint32_t enregistrement = scenario.tailleEnvoi + (config.actif ? 2 * scenario.surcoutEnregistrement : 0);
+        octets += enregistrement;
+        duree += 2 * at + scenario.rttMs + enregistrement * 1000UL / scenario.debitOctetsParS;
+        transactions += 2;
+        if (!session.terminerEnvoi(t + duree))
+        {
+            serveur.traiter("AT+CACLOSE=0", t + duree);
+            transactions++;
+            duree += at;
+        }
+        if (scenario.coupureTous != 0 && (k + 1) % scenario.coupureTous == 0)
+            serveur.couper(CID_ENVOI);
+        temps += duree;
+    }
+    serveurSimule = nullptr;
+
+    rapport.nbPoignees = serveur.nbPoigneesCompletes;
+    if (scenario.nbEnvois > 0)
+    {
+        rapport.octetsParEnvoi = (uint32_t)(octets / scenario.nbEnvois);
+        rapport.tempsParEnvoiMs = (uint32_t)(temps / scenario.nbEnvois);
+        rapport.transactionsParEnvoi = (float)transactions / scenario.nbEnvois;
+    }
+    return rapport;
+}
+
+/**
+ * @brief Options "tls" : {"actif":true,"garderOuvertS":600,"certificatCa":"ca.crt","authentification":true}.
+ *
+ * TLS n'est activé (ou sa CA changée) que si la CA est convertie par le modem : sinon les options sont ignorées et
+ * la configuration précédente reste en place.
+ */
+void chargerOptionsTls(const json &options)
+{
+    ConfigTls &config = sessionTls.config;
+    ConfigTls avant = config;
+    if (options.contains("actif"))
+        config.actif = options["actif"].get<bool>();
+    if (options.contains("garderOuvertS"))
+        config.garderOuvertS = options["garderOuvertS"].get<uint32_t>();
+    if (options.contains("certificatCa"))
+        config.certificatCa = String(options["certificatCa"].get<std::string>().c_str());
+    if (options.contains("authentification"))
+        config.authentification = options["authentification"].get<bool>();
+    bool changement = config.certificatCa != avant.certificatCa || config.versionTls != avant.versionTls ||
+                      config.authentification != avant.authentification;
+    if (config.actif && (!avant.actif || changement) && !sessionTls.verifierCa())
+    {
+        sessionTls.stats.nbEchecs++;
+        Serial.println("[TLS] CA \"" + config.certificatCa + "\" absente du modem : options TLS refusees");
+        config = avant;
+        return;
+    }
+    if (changement)
+        sessionTls.reconfigurer(); // contexte et cid réécrits à la prochaine ouverture
+}
+
+void afficherStatsTls()
+{
+    const StatsTls &s = sessionTls.stats;
+    if (s.nbPoignees == 0 && s.nbConnexionsGardees == 0 && s.nbEchecs == 0)
+        return;
+    uint32_t latence = s.nbPoignees ? (uint32_t)(s.latenceCumuleeMs / s.nbPoignees) : 0;
+    Serial.println("[TLS] poignees " + String(s.nbPoignees) + " (" + String(latence) + " ms) / sockets gardes " +
+                   String(s.nbConnexionsGardees) + ", perdus " + String(s.nbSocketsPerdus) + " / configurations " + String(s.nbConfigurations) + " / echecs " +
+                   String(s.nbEchecs) + " / AT " + String(s.transactionsAT));
+}
@@ -0,0 +1,198 @@
+/**
+ * @file SIM7080G_DEMARRAGE.cpp
+ * @brief Démarrage rapide du SIM7080G : sonde du modem et réutilisation de l'identité et de la configuration en cache.
+ *
+ * Un redémarrage systématique du modem (AT+CPOWD, impulsion PWRKEY) coûte plus de 5 s, auxquelles s'ajoutent
+ * la lecture de l'IMEI et la reconfiguration complète du réseau CAT-M1 par step_catm1_function().
+ *
+ * demarrerModem() commence donc par sonder le modem :
+ * - AT : le modem est-il alimenté et réactif ?
+ * - AT+CFUN? : la radio est-elle active ?
+ * - AT+CNACT? : le contexte PDP est-il actif avec une adresse IP ?
+ *
+ * Le modem n'est redémarré que s'il ne répond pas. L'IMEI et le CCID sont repris du cache EEPROM (CacheDemarrage),
+ * et la configuration réseau n'est refaite que si elle n'est pas connue ou si le contexte PDP est tombé.
+ * Le CCID de la carte en place (AT+CCID, lu sur la SIM sans échange réseau) est comparé à celui du cache : une SIM
+ * changée invalide le profil réseau mémorisé, qui est refait en entier par step_catm1_function().
+ * Chaque phase est chronométrée dans tempsDemarrage.
+ */
+
+#include "SIM7080G_DEMARRAGE.hpp"
+#include "SIM7080G_CATM1.hpp"
+#include "ASSISTANCE_GNSS.hpp"
+
+TempsDemarrage tempsDemarrage; ///< Décomposition du dernier démarrage.
+
+/**
+ * @brief Interroge le modem pour savoir s'il est déjà vivant et connecté.
+ */
+SondeModem sonderModem()
+{
+    SondeModem sonde;
+    String reponse = Send_AT("AT", 300);
+    if (reponse.indexOf("OK") == -1)
+        reponse = Send_AT("AT", 300); // le premier AT peut servir à caler l'autobaud
+    sonde.vivant = reponse.indexOf("OK") != -1;
+    if (!sonde.vivant)
+        return sonde;
+
+    sonde.cfunActif = Send_AT("AT+CFUN?", 500).indexOf("+CFUN: 1") != -1;
+    if (!sonde.cfunActif)
+        return sonde;
+
+    sonde.ip = parseIpCNACT(Send_AT("AT+CNACT?", 1000));
+    sonde.pdpActif = sonde.ip.length() > 0;
+    return sonde;
+}
+
+/**
+ * @brief Extrait l'adresse IP du contexte 0 de la réponse à AT+CNACT?.
+ * @param reponse Réponse brute, ex : "+CNACT: 0,1,\"10.52.3.4\"".
+ * @return L'adresse IP, ou une chaîne vide si le contexte est inactif.
+ */
+String parseIpCNACT(const String &reponse)
+{
+    int index = reponse.indexOf("+CNACT: 0,1,\"");
+    if (index == -1)
+        return "";
+    int debut = index + 13;
+    int fin = reponse.indexOf('"', debut);
+    if (fin == -1)
+        return "";
+    String ip = reponse.substring(debut, fin);
+    return ip == "0.0.0.0" ? "" : ip;
+}
+
+/**
+ * @brief Extrait le CCID (ICCID de la carte SIM) de la réponse à AT+CCID.
+ * @return Le CCID (19 ou 20 caractères), ou une chaîne vide.
+ */
+String parseCCID(const String &reponse)
+{
+    int start = 0;
+    int end = reponse.indexOf('\n');
+    while (start < (int)reponse.length())
+    {
+        String line = (end == -1) ? reponse.substring(start) : reponse.substring(start, end);
+        line.trim();
+        if ((line.length() == 19 || line.length() == 20) && line.startsWith("89"))
+            return line;
+        if (end == -1)
+            break;
+        start = end + 1;
+        end = reponse.indexOf('\n', start);
+    }
+    return "";
+}
+
+static void copierChaine(char *destination, size_t taille, const String &source)
+{
+    strncpy(destination, source.c_str(), taille - 1);
+    destination[taille - 1] = '\0';
+}
+
+/**
+ * @brief Séquence de démarrage du modem, appelée par setup().
+ *
+ * Ne redémarre le modem que s'il ne répond pas, reprend l'identité du cache EEPROM
+ * et indique à step_catm1_function() ce qui peut être sauté.
+ */
+void demarrerModem()
+{
+    tempsDemarrage = TempsDemarrage();
+    EEPROM.begin(EEPROM_SIZE);
+    Sim7080G.begin(Sim7080G_BAUDRATE, SERIAL_8N1, 20, 21);
+
+    SondeModem sonde = sonderModem();
+    tempsDemarrage.sondeMs = millis();
+
+    if (!sonde.vivant)
+    {
+        Serial.println("[DEMARRAGE] Modem muet : redemarrage");
+        reboot_SIM7080G();
+        tempsDemarrage.redemarrage = true;
+        oublierEphemerides();
+        sonde = SondeModem();
+    }
+    tempsDemarrage.redemarrageMs = millis();
+
+    CacheDemarrage cache;
+    bool cacheValide = lireCacheDemarrage(cache);
+    if (cacheValide && strlen(cache.imei) == 15)
+    {
+        imei = cache.imei;
+        tempsDemarrage.identiteEnCache = true;
+    }
+    else
+    {
+        memset(&cache, 0, sizeof(cache));
+        imei = getIMEI(Send_AT("AT+GSN"));
+        copierChaine(cache.imei, sizeof(cache.imei), imei);
+        copierChaine(cache.ccid, sizeof(cache.ccid), parseCCID(Send_AT("AT+CCID")));
+        if (imei.length() > 0)
+            ecrireCacheDemarrage(cache);
+    }
+    if (tempsDemarrage.identiteEnCache)
+    {
+        String ccid = parseCCID(Send_AT("AT+CCID"));
+        if (ccid.length() > 0 && strcmp(ccid.c_str(), cache.ccid) != 0)
+        {
+            Serial.println("[DEMARRAGE] SIM changee (CCID " + ccid + ") : profil reseau a refaire");
+            tempsDemarrage.simChangee = true;
+            copierChaine(cache.ccid, sizeof(cache.ccid), ccid);
+            cache.configReseau = false;
+            ecrireCacheDemarrage(cache);
+        }
+    }
+    tempsDemarrage.identiteMs = millis();
+
+    // Configuration réseau connue seulement si elle a été faite avec le même APN et que le modem n'a pas redémarré
+    tempsDemarrage.configConnue = cacheValide && cache.configReseau && strcmp(cache.apn, APN_RESEAU) == 0 && !tempsDemarrage.redemarrage;
+    tempsDemarrage.reseauPret = tempsDemarrage.configConnue && sonde.cfunActif && sonde.pdpActif;
+    if (tempsDemarrage.configConnue && sonde.cfunActif)
+        catm1DemarrageRapide(sonde.pdpActif);
+
+    tempsDemarrage.totalMs = millis();
+}
+
+/**
+ * @brief Mémorise en EEPROM que le profil réseau a été appliqué au modem (appelée en fin de step_catm1_function()).
+ */
+void memoriserConfigReseau()
+{
+    CacheDemarrage cache;
+    if (!lireCacheDemarrage(cache))
+    {
+        memset(&cache, 0, sizeof(cache));
+        copierChaine(cache.imei, sizeof(cache.imei), imei);
+    }
+    if (cache.configReseau && strcmp(cache.apn, APN_RESEAU) == 0)
+        return; // rien à écrire : on épargne l'EEPROM
+    cache.configReseau = true;
+    copierChaine(cache.apn, sizeof(cache.apn), APN_RESEAU);
+    ecrireCacheDemarrage(cache);
+}
+
+/**
+ * @brief Note l'instant du premier envoi réussi depuis le reset.
+ */
+void enregistrerPremierEnvoi()
+{
+    if (tempsDemarrage.premierEnvoiMs != 0)
+        return;
+    tempsDemarrage.premierEnvoiMs = millis();
+    afficherTempsDemarrage();
+}
+
+void afficherTempsDemarrage()
+{
+    Serial.println("[DEMARRAGE] sonde : " + String(tempsDemarrage.sondeMs) + " ms");
+    Serial.println("[DEMARRAGE] redemarrage modem : " + String(tempsDemarrage.redemarrageMs - tempsDemarrage.sondeMs) + " ms" +
+                   (tempsDemarrage.redemarrage ? "" : " (evite)"));
+    Serial.println("[DEMARRAGE] identite : " + String(tempsDemarrage.identiteMs - tempsDemarrage.redemarrageMs) + " ms" +
+                   (tempsDemarrage.identiteEnCache ? " (cache)" : "") + (tempsDemarrage.simChangee ? " (SIM changee)" : ""));
+    Serial.println("[DEMARRAGE] setup total : " + String(tempsDemarrage.totalMs) + " ms");
+    Serial.println("[DEMARRAGE] reseau : " + String(tempsDemarrage.reseauPret ? "pret" : (tempsDemarrage.configConnue ? "a reattacher" : "a configurer")));
+    if (tempsDemarrage.premierEnvoiMs > 0)
+        Serial.println("[DEMARRAGE] premier envoi : " + String(tempsDemarrage.premierEnvoiMs) + " ms");
+}
@@ -1,7 +1,12 @@
 #include "SIM7080G_SERIAL.hpp"
 
+uint32_t octetsUartEmis = 0;  ///< Octets envoyés au modem par Send_AT (commande + CRLF).
+uint32_t octetsUartRecus = 0; ///< Octets reçus du modem par Send_AT.
+uint32_t nbTransactionsAT = 0; ///< Nombre d'appels à Send_AT.
+
 #ifdef UNIT_TEST
 void (*SendATTestHook)(const String &, long) = nullptr;
+String (*SendATResponseHook)(const String &, long) = nullptr;
 #endif
 
 /**
@@ -9,7 +14,9 @@ void (*SendATTestHook)(const String &, long) = nullptr;
  *
  * Cette fonction envoie une commande AT sur le port série du module SIM7080G, puis lit la réponse jusqu'à obtenir "OK", "ACTIVE" ou jusqu'à expiration du délai.
  * Elle retourne la réponse complète reçue du module.
- * En mode test unitaire (UNIT_TEST), un hook peut être utilisé pour simuler l'envoi et la réception.
+ * En mode test unitaire (UNIT_TEST), un hook peut être utilisé pour observer l'envoi, et un second (SendATResponseHook)
+ * pour simuler la réponse du module.
+ * Les octets échangés et le nombre de transactions sont comptés (octetsUartEmis, octetsUartRecus, nbTransactionsAT).
  *
  * @param message La commande AT à envoyer.
  * @param delay Le délai maximal d'attente de la réponse (en millisecondes).
@@ -19,6 +26,8 @@ String Send_AT(String message, long delay)
 {
   unsigned long start_time = millis();
   Sim7080G.println(message);
+  nbTransactionsAT++;
+  octetsUartEmis += message.length() + 2;
   String uart_buffer = "";
   char tmp_char = 'A';
   while ((millis() - start_time < delay) && (uart_buffer.endsWith("OK") == false) && (uart_buffer.endsWith("ACTIVE") == false))
@@ -34,11 +43,19 @@ String Send_AT(String message, long delay)
 #ifdef UNIT_TEST
   if (SendATTestHook)
     SendATTestHook(message, delay);
+  // Réponse fournie par le simulateur de modem, si installé
+  if (SendATResponseHook && uart_buffer.length() == 0)
+  {
+    String reponse = SendATResponseHook(message, delay);
+    octetsUartRecus += reponse.length();
+    return reponse;
+  }
   // Retourne une valeur simulée pour les tests si rien n'a été reçu
   if (uart_buffer.length() == 0)
     return "MOCK_OK";
 #endif
 
   // Serial.println("millis fin de Send_AT : " + (String) millis());
+  octetsUartRecus += uart_buffer.length();
   return uart_buffer;
 }
\ No newline at end of file
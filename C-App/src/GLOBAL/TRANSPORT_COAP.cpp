@@ -0,0 +1,557 @@
+/**
+ * @file TRANSPORT_COAP.cpp
+ * @brief Transport des envois en CoAP confirmable sur le socket UDP du SIM7080G.
+ *
+ * Chaque envoi du pipeline TCP ouvre une connexion (SYN, SYN-ACK, ACK), envoie le message, lit la réponse puis ferme
+ * (FIN, ACK dans les deux sens) : trois allers-retours CAT-M1 et une dizaine de paquets pour quelques centaines
+ * d'octets. En CoAP, le message CBOR part dans une requête POST confirmable et la réponse du serveur revient dans
+ * l'acquittement : un aller-retour, deux datagrammes.
+ *
+ * - Le socket UDP (cid 2, MULTIPLEXEUR_SOCKETS) reste ouvert : AT+CAOPEN en UDP ne fait aucun échange réseau.
+ * - Le datagramme est écrit par un AT+CASEND unique (ENVOI_FRAGMENTE) ; un message trop grand pour un datagramme
+ *   (TAILLE_MAX_COAP) passe par le pipeline TCP.
+ * - L'acquittement est annoncé par +CADATAIND: 2 et lu par AT+CARECV ; sans acquittement avant l'échéance, le même
+ *   message (même Message ID, que le serveur reconnaît) est retransmis avec un délai doublé, jusqu'à
+ *   maxRetransmissions fois. Le délai initial est tiré au hasard (esp_random) entre ackTimeoutMs et
+ *   ackTimeoutMs × (1 + facteur), une fois par message : des traceurs réveillés ensemble ne retransmettent pas en
+ *   même temps.
+ * - Le serveur CoAP (config.hote, config.port) est distinct du serveur TCP : le tunnel Pinggy (PINGGY_LINK) ne
+ *   transporte que du TCP, et TCP-Server n'écoute pas en UDP. Sans hôte configuré, accepte() refuse et les envois
+ *   restent sur le pipeline TCP ; le transport s'active avec l'option {"coap": {"actif": true, "hote": ...}}.
+ * - Le Message ID est conservé en mémoire RTC (ETAT_RTC) : un identifiant réutilisé après un deep sleep serait pris
+ *   pour une retransmission par le serveur.
+ *
+ * simulerTransport() compare sur l'hôte, avec un serveur CoAP local, les allers-retours, les octets et le temps
+ * radio du pipeline TCP et de CoAP.
+ */
+
+#include "TRANSPORT_COAP.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "AIGUILLAGE_URC.hpp"
+#include "MULTIPLEXEUR_SOCKETS.hpp"
+#include "receiveCBOR.hpp"
+#ifndef UNIT_TEST
+#include <esp_system.h>
+#endif
+
+TransportCoap transportCoap; ///< Transport utilisé par STEP_ENVOI_COAP.
+
+// Générateur matériel de l'ESP32 (bruit RF) ; random() du simulateur sur l'hôte
+static uint32_t tirage()
+{
+#ifndef UNIT_TEST
+    return esp_random();
+#else
+    return (uint32_t)random(0x7FFFFFFF);
+#endif
+}
+
+// Option CoAP : delta et longueur sur 4 bits, étendus sur 1 ou 2 octets
+static void ecrireChampOption(uint16_t valeur, uint8_t &quartet, std::vector<uint8_t> &extension)
+{
+    if (valeur < 13)
+        quartet = valeur;
+    else if (valeur < 269)
+    {
+        quartet = 13;
+        extension.push_back(valeur - 13);
+    }
+    else
+    {
+        quartet = 14;
+        extension.push_back((valeur - 269) >> 8);
+        extension.push_back((valeur - 269) & 0xFF);
+    }
+}
+
+static void ecrireOption(uint16_t delta, const uint8_t *valeur, uint16_t longueur, std::vector<uint8_t> &sortie)
+{
+    uint8_t quartetDelta, quartetLongueur;
+    std::vector<uint8_t> extDelta, extLongueur;
+    ecrireChampOption(delta, quartetDelta, extDelta);
+    ecrireChampOption(longueur, quartetLongueur, extLongueur);
+    sortie.push_back((quartetDelta << 4) | quartetLongueur);
+    sortie.insert(sortie.end(), extDelta.begin(), extDelta.end());
+    sortie.insert(sortie.end(), extLongueur.begin(), extLongueur.end());
+    sortie.insert(sortie.end(), valeur, valeur + longueur);
+}
+
+/**
+ * @brief Datagramme CoAP : en-tête, token, options Uri-Path (11) et Content-Format (12) si une charge suit.
+ */
+void encoderCoap(const MessageCoap &message, const char *uriPath, std::vector<uint8_t> &datagramme)
+{
+    datagramme.clear();
+    datagramme.push_back(0x40 | (message.type << 4) | message.tkl); // version 1
+    datagramme.push_back(message.code);
+    datagramme.push_back(message.messageId >> 8);
+    datagramme.push_back(message.messageId & 0xFF);
+    datagramme.insert(datagramme.end(), message.token, message.token + message.tkl);
+
+    uint16_t numero = 0;
+    if (uriPath != nullptr && uriPath[0] != '\0')
+    {
+        ecrireOption(11 - numero, (const uint8_t *)uriPath, strlen(uriPath), datagramme);
+        numero = 11;
+    }
+    if (!message.charge.empty())
+    {
+        const uint8_t format = COAP_FORMAT_CBOR;
+        ecrireOption(12 - numero, &format, 1, datagramme);
+        datagramme.push_back(0xFF);
+        datagramme.insert(datagramme.end(), message.charge.begin(), message.charge.end());
+    }
+}
+
+// Champ étendu d'une option ; false si le datagramme est tronqué ou le quartet réservé (15)
+static bool lireChampOption(uint8_t quartet, const uint8_t *donnees, size_t n, size_t &i, uint16_t &valeur)
+{
+    if (quartet < 13)
+        valeur = quartet;
+    else if (quartet == 13 && i < n)
+        valeur = 13 + donnees[i++];
+    else if (quartet == 14 && i + 1 < n)
+    {
+        valeur = 269 + ((donnees[i] << 8) | donnees[i + 1]);
+        i += 2;
+    }
+    else
+        return false;
+    return true;
+}
+
+/**
+ * @brief Décode l'en-tête, le token et la charge d'un datagramme CoAP ; les options sont sautées.
+ */
+bool decoderCoap(const uint8_t *donnees, size_t n, MessageCoap &message)
+{
+    if (n < 4 || (donnees[0] >> 6) != 1)
+        return false;
+    message.type = (donnees[0] >> 4) & 0x03;
+    message.tkl = donnees[0] & 0x0F;
+    message.code = donnees[1];
+    message.messageId = (donnees[2] << 8) | donnees[3];
+    message.charge.clear();
+    if (message.tkl > 8 || 4u + message.tkl > n)
+        return false;
+    memcpy(message.token, donnees + 4, message.tkl);
+
+    size_t i = 4 + message.tkl;
+    while (i < n && donnees[i] != 0xFF)
+    {
+        uint8_t octet = donnees[i++];
+        uint16_t delta, longueur;
+        if (!lireChampOption(octet >> 4, donnees, n, i, delta) || !lireChampOption(octet & 0x0F, donnees, n, i, longueur))
+            return false;
+        if (i + longueur > n)
+            return false;
+        i += longueur;
+    }
+    if (i < n)
+    {
+        if (i + 1 == n)
+            return false; // marqueur sans charge
+        message.charge.assign(donnees + i + 1, donnees + n);
+    }
+    return true;
+}
+
+TransportCoap::TransportCoap()
+{
+    reinitialiser();
+    prochainId = (uint16_t)tirage(); // RFC 7252 §4.4 : premier identifiant tiré au hasard
+}
+
+void TransportCoap::reinitialiser()
+{
+    stats = StatsCoap();
+    etatCoap = COAP_INACTIF;
+    enEcriture = false;
+    annonce = false;
+    messageId = 0;
+    tentative = 0;
+    debutMs = 0;
+    delaiInitialMs = 0;
+    echeanceMs = 0;
+    longueur = 0;
+    reponseServeur = json();
+}
+
+bool TransportCoap::accepte(size_t taille) const
+{
+    // En-tête, token, options et marqueur : 4 + 2 + 4 + 2 + 1 octets
+    return config.actif && config.hote.length() > 0 && taille > 0 && taille + 13 <= TAILLE_MAX_COAP;
+}
+
+/**
+ * @brief Délai d'attente du premier acquittement (RFC 7252 §4.2) : tirage uniforme entre ackTimeoutMs et
+ * ackTimeoutMs × (1 + facteur). delaiAcquittement() le double à chaque retransmission.
+ */
+unsigned long TransportCoap::tirerDelaiInitial() const
+{
+    unsigned long marge = (unsigned long)((uint64_t)config.ackTimeoutMs * config.facteurAleatoirePct / 100);
+    return config.ackTimeoutMs + tirage() % (marge + 1);
+}
+
+void TransportCoap::commencer(const uint8_t *cbor, size_t taille, unsigned long maintenant)
+{
+    MessageCoap requete;
+    requete.type = COAP_CON;
+    requete.code = COAP_POST;
+    requete.messageId = prochainId++;
+    requete.tkl = 2;
+    requete.token[0] = requete.messageId >> 8;
+    requete.token[1] = (requete.messageId & 0xFF) ^ 0xA5;
+    requete.charge.assign(cbor, cbor + taille);
+    encoderCoap(requete, COAP_URI, datagramme);
+
+    messageId = requete.messageId;
+    tentative = 0;
+    debutMs = maintenant;
+    delaiInitialMs = tirerDelaiInitial();
+    reponseServeur = json();
+    etatCoap = COAP_EN_COURS;
+    stats.nbMessages++;
+    emettre(maintenant);
+}
+
+void TransportCoap::emettre(unsigned long maintenant)
+{
+    envoi.sortie = sortie;
+    envoi.cid = multiplexeurSockets.cid(CANAL_COAP);
+    envoi.config.tailleCible = TAILLE_MAX_CASEND;
+    envoi.commencer(datagramme.data(), datagramme.size(), maintenant);
+    enEcriture = true;
+    annonce = false;
+    longueur = 0;
+    stats.octetsEmis += datagramme.size();
+    echeanceMs = maintenant + delaiAcquittement(tentative);
+}
+
+void TransportCoap::terminer(EtatCoap fin, unsigned long maintenant)
+{
+    etatCoap = fin;
+    enEcriture = false;
+    if (fin == COAP_ECHEC)
+    {
+        stats.nbEchecs++;
+        return;
+    }
+    uint32_t rtt = maintenant - debutMs;
+    stats.rttCumuleMs += rtt;
+    if (rtt > stats.rttMaxMs)
+        stats.rttMaxMs = rtt;
+}
+
+/**
+ * @brief Flux du modem : prompt et OK de l'AT+CASEND en cours, puis +CADATAIND du socket UDP. Un acquittement rapide
+ * peut être annoncé dans le même bloc que le OK : la suite du bloc est lue comme des lignes.
+ */
+void TransportCoap::traiter(const char *donnees, size_t n, unsigned long maintenant)
+{
+    if (etatCoap != COAP_EN_COURS)
+        return;
+    if (enEcriture)
+    {
+        size_t lus = envoi.traiter(donnees, n, maintenant);
+        if (envoi.etat() != ENVOI_TERMINE)
+            return;
+        enEcriture = false;
+        donnees += lus;
+        n -= lus;
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        char c = donnees[i];
+        if (c == '\n')
+        {
+            ligne[longueur] = '\0';
+            if (strncmp(ligne, "+CADATAIND:", 11) == 0 && atoi(ligne + 11) == multiplexeurSockets.cid(CANAL_COAP))
+                annonce = true;
+            else if (longueur > 0)
+                aiguillageUrc.traiterLigne(ligne, maintenant);
+            longueur = 0;
+        }
+        else if (c != '\r' && longueur < TAILLE_LIGNE_COAP - 1)
+            ligne[longueur++] = c;
+    }
+}
+
+/**
+ * @brief Réponse à AT+CARECV : un acquittement (ou un RST) portant le Message ID attendu termine l'échange.
+ * @return true si l'échange est terminé.
+ */
+bool TransportCoap::recevoir(const String &reponse, unsigned long maintenant)
+{
+    std::vector<uint8_t> octets;
+    MessageCoap message;
+    if (etatCoap != COAP_EN_COURS || !extraireCARECV(reponse, octets) || !decoderCoap(octets.data(), octets.size(), message))
+        return false;
+    stats.octetsRecus += octets.size();
+    if (message.messageId != messageId)
+        return false; // acquittement tardif d'un échange précédent
+    if (message.type == COAP_RST)
+    {
+        stats.nbReset++;
+        terminer(COAP_ECHEC, maintenant);
+        return true;
+    }
+    if (message.type != COAP_ACK)
+        return false;
+    if ((message.code >> 5) != 2)
+    {
+        Serial.println("[COAP] reponse " + String(message.code >> 5) + "." + String(message.code & 0x1F));
+        terminer(COAP_ECHEC, maintenant);
+        return true;
+    }
+    if (!message.charge.empty())
+    {
+        json options = json::from_cbor(message.charge, true, false);
+        if (!options.is_discarded())
+            reponseServeur = options;
+    }
+    terminer(COAP_TERMINE, maintenant);
+    return true;
+}
+
+void TransportCoap::lire(unsigned long maintenant)
+{
+    annonce = false;
+    recevoir(Send_AT("AT+CARECV=" + String(multiplexeurSockets.cid(CANAL_COAP)) + "," + String(TAILLE_MAX_COAP), 2000),
+             maintenant);
+}
+
+EtatCoap TransportCoap::pomper(unsigned long maintenant)
+{
+    if (etatCoap != COAP_EN_COURS)
+        return etatCoap;
+    if (enEcriture)
+    {
+        EtatEnvoi e = envoi.pomper(maintenant);
+        if (e == ENVOI_ECHEC)
+        {
+            terminer(COAP_ECHEC, maintenant);
+            return etatCoap;
+        }
+        enEcriture = e == ENVOI_EN_COURS;
+        if (enEcriture)
+            return etatCoap;
+    }
+
+    char tampon[64];
+    while (etatCoap == COAP_EN_COURS && Sim7080G.available())
+    {
+        size_t n = 0;
+        while (n < sizeof(tampon) && Sim7080G.available())
+            tampon[n++] = (char)Sim7080G.read();
+        traiter(tampon, n, maintenant);
+    }
+    if (annonce)
+        lire(maintenant);
+    if (etatCoap != COAP_EN_COURS || (long)(maintenant - echeanceMs) < 0)
+        return etatCoap;
+
+    // Echéance : une lecture rattrape une annonce consommée par une autre commande AT avant de retransmettre
+    lire(maintenant);
+    if (etatCoap != COAP_EN_COURS)
+        return etatCoap;
+    if (tentative >= config.maxRetransmissions)
+    {
+        Serial.println("[COAP] pas d'acquittement apres " + String(tentative + 1) + " envois");
+        terminer(COAP_ECHEC, maintenant);
+        return etatCoap;
+    }
+    tentative++;
+    stats.nbRetransmissions++;
+    emettre(maintenant);
+    return etatCoap;
+}
+
+void TransportCoap::liberer()
+{
+    etatCoap = COAP_INACTIF;
+    enEcriture = false;
+}
+
+bool ServeurCoapLocal::perdu()
+{
+    if (perteTous == 0 || ++nbDatagrammes % perteTous != 0)
+        return false;
+    nbPertes++;
+    return true;
+}
+
+/**
+ * @brief Acquitte un POST confirmable (2.04, charge : options) ; une retransmission reçoit le même acquittement.
+ * @return false si la requête ou l'acquittement est perdu, ou si la requête est invalide.
+ */
+bool ServeurCoapLocal::repondre(const uint8_t *requete, size_t n, std::vector<uint8_t> &acquittement)
+{
+    MessageCoap message;
+    acquittement.clear();
+    if (perdu() || !decoderCoap(requete, n, message) || message.type != COAP_CON)
+        return false;
+    if (dejaVu && message.messageId == dernierId)
+        nbDoublons++;
+    else
+        nbRequetes++;
+    dejaVu = true;
+    dernierId = message.messageId;
+
+    MessageCoap ack;
+    ack.type = COAP_ACK;
+    ack.code = COAP_CHANGED;
+    ack.messageId = message.messageId;
+    ack.tkl = message.tkl;
+    memcpy(ack.token, message.token, message.tkl);
+    if (!options.is_null())
+        ack.charge = json::to_cbor(options);
+    encoderCoap(ack, nullptr, acquittement);
+    return !perdu();
+}
+
+/**
+ * @brief Allers-retours, octets et temps radio par envoi de scenario.nbEnvois messages.
+ *
+ * TCP (pipeline actuel) : AT+CAOPEN (SYN, SYN-ACK, ACK), AT+CASEND (données, ACK), réponse du serveur lue par
+ * AT+CARECV (données, ACK), AT+CACLOSE (FIN et ACK dans les deux sens) ; un paquet perdu coûte rtoTcpMs.
+ * CoAP : AT+CASEND du datagramme, acquittement lu par AT+CARECV ; les datagrammes réels passent par
+ * ServeurCoapLocal, une perte coûte le délai d'acquittement de TransportCoap.
+ */
+RapportTransport simulerTransport(const ScenarioTransport &scenario, const ConfigCoap &config)
+{
+    RapportTransport rapport;
+    const uint32_t IP_TCP = 40, IP_UDP = 28, OPTIONS_SYN = 20;
+    uint64_t octets = 0;
+    uint64_t tempsMs = 0;
+    uint32_t allersRetours = 0;
+    uint32_t compteurPertes = 0;
+    auto perdu = [&]() { return scenario.perteTous != 0 && ++compteurPertes % scenario.perteTous == 0; };
+
+    if (!config.actif)
+    {
+        // Paquets de chaque aller-retour : connexion, données et réponse, fermeture
+        const uint32_t paquets[3][4] = {
+            {IP_TCP + OPTIONS_SYN, IP_TCP + OPTIONS_SYN, IP_TCP, 0},
+            {IP_TCP + scenario.tailleCharge, IP_TCP + scenario.tailleReponse, IP_TCP, IP_TCP},
+            {IP_TCP, IP_TCP, IP_TCP, IP_TCP}};
+        for (uint16_t k = 0; k < scenario.nbEnvois; ++k)
+        {
+            tempsMs += 4 * scenario.commandeAtMs; // CAOPEN, CASEND, CARECV, CACLOSE
+            for (const auto &echange : paquets)
+            {
+                allersRetours++;
+                tempsMs += scenario.rttMs;
+                for (uint32_t taille : echange)
+                {
+                    if (taille == 0)
+                        continue;
+                    octets += taille;
+                    while (perdu())
+                    {
+                        rapport.nbRetransmissions++;
+                        octets += taille;
+                        tempsMs += scenario.rtoTcpMs;
+                    }
+                }
+            }
+        }
+    }
+    else
+    {
+        TransportCoap coap;
+        coap.config = config;
+        ServeurCoapLocal serveur;
+        serveur.perteTous = scenario.perteTous;
+        serveur.options = json::object();
+        std::vector<uint8_t> reponse(scenario.tailleReponse > 4 ? scenario.tailleReponse - 4 : 1, 'x');
+        serveur.options["r"] = std::string(reponse.begin(), reponse.end());
+        std::vector<uint8_t> datagramme, acquittement;
+        std::vector<uint8_t> charge(scenario.tailleCharge, 0xA5);
+
+        for (uint16_t k = 0; k < scenario.nbEnvois; ++k)
+        {
+            unsigned long delaiInitial = coap.tirerDelaiInitial();
+            MessageCoap requete;
+            requete.code = COAP_POST;
+            requete.messageId = k;
+            requete.tkl = 2;
+            requete.charge = charge;
+            encoderCoap(requete, COAP_URI, datagramme);
+
+            bool acquitte = false;
+            for (uint8_t tentative = 0; tentative <= config.maxRetransmissions && !acquitte; ++tentative)
+            {
+                if (tentative > 0)
+                    rapport.nbRetransmissions++;
+                allersRetours++;
+                tempsMs += 2 * scenario.commandeAtMs; // CASEND, CARECV
+                octets += IP_UDP + datagramme.size();
+                acquitte = serveur.repondre(datagramme.data(), datagramme.size(), acquittement);
+                if (acquitte)
+                {
+                    octets += IP_UDP + acquittement.size();
+                    tempsMs += scenario.rttMs;
+                }
+                else
+                {
+                    if (!acquittement.empty())
+                        octets += IP_UDP + acquittement.size(); // acquittement émis puis perdu
+                    tempsMs += delaiInitial << tentative;
+                }
+            }
+            if (!acquitte)
+                rapport.nbEchecs++;
+        }
+    }
+
+    if (scenario.nbEnvois > 0)
+    {
+        rapport.allersRetours = (float)allersRetours / scenario.nbEnvois;
+        rapport.octetsRadio = (uint32_t)(octets / scenario.nbEnvois);
+        rapport.tempsRadioMs = (uint32_t)(tempsMs / scenario.nbEnvois);
+    }
+    return rapport;
+}
+
+/**
+ * @brief Options reçues du serveur : {"actif": bool, "hote": "coap.exemple.fr", "port": 5683, "ackTimeoutMs": ms,
+ *        "facteurAleatoirePct": %, "maxRetransmissions": n}. Un changement d'hôte ou de port rouvre le socket UDP.
+ */
+void chargerOptionsCoap(const json &options)
+{
+    ConfigCoap &config = transportCoap.config;
+    if (options.contains("actif"))
+        config.actif = options["actif"].get<bool>();
+    if (options.contains("hote") || options.contains("port"))
+    {
+        String hote = options.contains("hote") ? String(options["hote"].get<std::string>().c_str()) : config.hote;
+        uint16_t port = options.contains("port") ? options["port"].get<uint16_t>() : config.port;
+        if (hote != config.hote || port != config.port)
+        {
+            config.hote = hote;
+            config.port = port;
+            if (multiplexeurSockets.estOuvert(CANAL_COAP))
+                multiplexeurSockets.fermer(CANAL_COAP);
+        }
+    }
+    if (options.contains("ackTimeoutMs"))
+        config.ackTimeoutMs = options["ackTimeoutMs"].get<unsigned long>();
+    if (options.contains("facteurAleatoirePct"))
+        config.facteurAleatoirePct = options["facteurAleatoirePct"].get<uint8_t>();
+    if (options.contains("maxRetransmissions"))
+        config.maxRetransmissions = options["maxRetransmissions"].get<uint8_t>();
+}
+
+void afficherStatsCoap()
+{
+    const StatsCoap &s = transportCoap.stats;
+    if (s.nbMessages == 0)
+        return;
+    uint32_t acquittes = s.nbMessages - s.nbEchecs;
+    uint32_t moyenne = acquittes ? (uint32_t)(s.rttCumuleMs / acquittes) : 0;
+    Serial.println("[COAP] messages : " + String(s.nbMessages) + " / retransmissions : " + String(s.nbRetransmissions) +
+                   " / echecs : " + String(s.nbEchecs) + " (RST " + String(s.nbReset) + ") / octets emis " +
+                   String((unsigned long)s.octetsEmis) + ", recus " + String((unsigned long)s.octetsRecus) +
+                   " / aller-retour (ms) moyen " + String(moyenne) + ", max " + String(s.rttMaxMs));
+}
@@ -0,0 +1,607 @@
+/**
+ * @file TRANSPORT_MQTT.cpp
+ * @brief Publication des envois par le client MQTT intégré du SIM7080G (AT+SMCONF, AT+SMCONN, AT+SMPUB, AT+SMSUB).
+ *
+ * Le serveur passe à une ingestion par broker : le lot de fixes (message CBOR du pipeline) est publié en QoS 1 sur
+ * gps/<imei> au lieu d'une connexion TCP ouverte et fermée à chaque envoi (AT+CAOPEN, AT+CASEND, AT+CARECV,
+ * AT+CACLOSE).
+ *
+ * - Le broker (config.hote, config.port) est distinct du serveur TCP : le tunnel Pinggy (PINGGY_LINK) ne mène qu'à
+ *   TCP-Server, qui ne parle pas MQTT. Sans hôte configuré, accepte() refuse et les envois restent sur le pipeline
+ *   TCP ; le transport s'active avec l'option {"mqtt": {"actif": true, "hote": ...}}.
+ * - La configuration (AT+SMCONF) n'est écrite qu'une fois : le modem la garde pendant son sommeil (ETAT_RTC).
+ * - La connexion reste ouverte d'un envoi à l'autre ; au réveil, AT+SMSTATE? évite un AT+SMCONN si elle a survécu.
+ *   Une coupure est signalée par l'URC +SMSTATE: 0.
+ * - Session persistante (CLEANSS 0) : l'abonnement au topic de commandes gps/<imei>/cmd n'est envoyé qu'une fois,
+ *   le broker garde les commandes QoS 1 publiées pendant une coupure et les livre à la reconnexion.
+ * - Les commandes arrivent par l'URC +SMSUB (contenu en hexadécimal, SUBHEX 1) pendant une publication ou entre deux
+ *   envois (servir, à chaque tranche de sommeil de STEP_END_GLOBAL) ; le message CBOR décodé est appliqué comme la
+ *   réponse à un envoi (appliquerOptionsRecues).
+ *
+ * simulerMqtt() compare sur l'hôte, avec un broker local, les commandes AT par fix publié et la latence des
+ * publications du pipeline TCP et du client MQTT.
+ */
+
+#include "TRANSPORT_MQTT.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "AIGUILLAGE_URC.hpp"
+#include "pipeline.hpp"
+
+TransportMqtt transportMqtt; ///< Client MQTT utilisé par STEP_ENVOI_MQTT et servi par STEP_END_GLOBAL.
+
+static const char HEXA[] = "0123456789ABCDEF";
+
+static int valeurHexa(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+TransportMqtt::TransportMqtt()
+{
+    reinitialiser();
+}
+
+void TransportMqtt::reinitialiser()
+{
+    stats = StatsMqtt();
+    etatMqtt = MQTT_INACTIF;
+    configure = false;
+    connecte = false;
+    abonne = false;
+    invite = false;
+    ecrit = false;
+    message = nullptr;
+    tailleMessage = 0;
+    nbFixesMessage = 0;
+    debutMs = 0;
+    evenementMs = 0;
+    longueur = 0;
+}
+
+bool TransportMqtt::accepte(size_t taille) const
+{
+    return config.actif && config.hote.length() > 0 && taille > 0 && taille <= TAILLE_MAX_MQTT;
+}
+
+String TransportMqtt::topicPublication() const
+{
+    return String(MQTT_RACINE_TOPIC) + imei;
+}
+
+String TransportMqtt::topicCommandes() const
+{
+    return topicPublication() + "/cmd";
+}
+
+// Commande AT de connexion : la réponse passe par traiter() pour les URC qu'elle contient (+SMSUB à la reconnexion)
+bool TransportMqtt::envoyer(const String &commande, long delai)
+{
+    String reponse = Send_AT(commande, delai);
+    stats.transactionsAT++;
+    traiter(reponse.c_str(), reponse.length(), millis());
+    return reponse.indexOf("OK") != -1 && reponse.indexOf("ERROR") == -1;
+}
+
+/**
+ * @brief Connexion au broker si elle n'est pas déjà ouverte ; marque le début de l'envoi pour sa latence.
+ * @return true si le client est connecté et abonné au topic de commandes.
+ */
+bool TransportMqtt::connecter(unsigned long maintenant)
+{
+    debutMs = maintenant;
+    if (connecte)
+        return true;
+
+    if (configure)
+    {
+        // La connexion a pu survivre au sommeil du modem
+        String etat = Send_AT("AT+SMSTATE?");
+        stats.transactionsAT++;
+        if (etat.indexOf("+SMSTATE: 1") != -1)
+        {
+            connecte = true;
+            stats.nbConnexionsReprises++;
+        }
+    }
+    else
+    {
+        bool ok = envoyer("AT+SMCONF=\"URL\",\"" + config.hote + "\"," + String(config.port)) &&
+                  envoyer("AT+SMCONF=\"CLIENTID\",\"" + imei + "\"") &&
+                  envoyer("AT+SMCONF=\"KEEPTIME\"," + String(config.keepAliveS)) &&
+                  envoyer("AT+SMCONF=\"CLEANSS\"," + String(config.sessionPersistante ? 0 : 1)) &&
+                  envoyer("AT+SMCONF=\"SUBHEX\",1");
+        if (!ok)
+        {
+            Serial.println("[MQTT] configuration refusee par le modem");
+            return false;
+        }
+        configure = true;
+    }
+
+    if (!connecte)
+    {
+        if (!envoyer("AT+SMCONN", 12000))
+        {
+            Serial.println("[MQTT] connexion au broker refusee");
+            return false;
+        }
+        connecte = true;
+        stats.nbConnexions++;
+        if (!config.sessionPersistante)
+            abonne = false; // session propre : le broker a oublié l'abonnement
+    }
+
+    if (!abonne)
+    {
+        if (!envoyer("AT+SMSUB=\"" + topicCommandes() + "\",1", 5000))
+        {
+            Serial.println("[MQTT] abonnement aux commandes refuse");
+            return true; // la publication reste possible
+        }
+        abonne = true;
+        stats.nbAbonnements++;
+    }
+    return true;
+}
+
+void TransportMqtt::deconnecter()
+{
+    if (!connecte)
+        return;
+    Send_AT("AT+SMDISC");
+    connecte = false;
+}
+
+void TransportMqtt::restaurerSession(bool configureModem, bool abonnement)
+{
+    configure = configureModem;
+    abonne = abonnement;
+    connecte = false;
+}
+
+void TransportMqtt::ecrire(const uint8_t *donnees, size_t n)
+{
+    if (sortie != nullptr)
+        sortie(donnees, n);
+    else
+        Sim7080G.write(donnees, n);
+    octetsUartEmis += n;
+}
+
+/**
+ * @brief Ecrit AT+SMPUB ; le contenu part au prompt ">", le OK suit le PUBACK du broker (QoS 1).
+ */
+void TransportMqtt::commencer(const uint8_t *cbor, size_t taille, uint16_t nbFixes, unsigned long maintenant)
+{
+    message = cbor;
+    tailleMessage = taille;
+    nbFixesMessage = nbFixes;
+    invite = true;
+    ecrit = false;
+    longueur = 0;
+    evenementMs = maintenant;
+    etatMqtt = MQTT_EN_COURS;
+
+    String entete = "AT+SMPUB=\"" + topicPublication() + "\"," + String((unsigned long)taille) + ",1,0\r\n";
+    ecrire((const uint8_t *)entete.c_str(), entete.length());
+    nbTransactionsAT++;
+    stats.transactionsAT++;
+}
+
+void TransportMqtt::terminer(EtatMqtt fin, unsigned long maintenant)
+{
+    etatMqtt = fin;
+    invite = false;
+    ecrit = false;
+    if (fin == MQTT_ECHEC)
+    {
+        stats.nbEchecs++;
+        return;
+    }
+    uint32_t latence = maintenant - debutMs;
+    stats.nbPublications++;
+    stats.nbFixesPublies += nbFixesMessage;
+    stats.latenceCumuleeMs += latence;
+    if (latence > stats.latenceMaxMs)
+        stats.latenceMaxMs = latence;
+}
+
+/**
+ * @brief URC +SMSUB: "<topic>","<hexadécimal>" : commande CBOR du serveur.
+ */
+void TransportMqtt::traiterCommande(const char *ligne, unsigned long maintenant)
+{
+    const char *debutTopic = strchr(ligne, '"');
+    const char *finTopic = debutTopic ? strchr(debutTopic + 1, '"') : nullptr;
+    const char *debutContenu = finTopic ? strchr(finTopic + 1, '"') : nullptr;
+    const char *finContenu = debutContenu ? strrchr(debutContenu + 1, '"') : nullptr;
+    if (finContenu == nullptr || finContenu <= debutContenu)
+        return;
+    String topic = topicCommandes();
+    if ((size_t)(finTopic - debutTopic - 1) != topic.length() || strncmp(debutTopic + 1, topic.c_str(), topic.length()) != 0)
+        return;
+
+    std::vector<uint8_t> octets;
+    for (const char *p = debutContenu + 1; p + 1 < finContenu; p += 2)
+    {
+        int fort = valeurHexa(p[0]), faible = valeurHexa(p[1]);
+        if (fort < 0 || faible < 0)
+            return;
+        octets.push_back((fort << 4) | faible);
+    }
+    json commande = json::from_cbor(octets, true, false);
+    if (commande.is_discarded())
+    {
+        Serial.println("[MQTT] CBOR invalide (" + String((unsigned long)octets.size()) + " octets)");
+        return;
+    }
+    lastReceivedCBOR = commande;
+    Serial.print("[MQTT] commande : ");
+    Serial.println(commande.dump().c_str());
+    if (appliquer != nullptr)
+        appliquer(commande);
+    else
+        appliquerOptionsRecues(commande);
+    stats.nbCommandes++;
+    (void)maintenant;
+}
+
+void TransportMqtt::traiterLigne(unsigned long maintenant)
+{
+    ligne[longueur] = '\0';
+    if (strcmp(ligne, "OK") == 0)
+    {
+        if (etatMqtt == MQTT_EN_COURS && ecrit)
+            terminer(MQTT_TERMINE, maintenant);
+    }
+    else if (strstr(ligne, "ERROR") != nullptr)
+    {
+        if (etatMqtt == MQTT_EN_COURS)
+            terminer(MQTT_ECHEC, maintenant);
+    }
+    else if (longueur > 0)
+        aiguillageUrc.traiterLigne(ligne, maintenant);
+}
+
+/**
+ * @brief URC du client MQTT : commande reçue (+SMSUB) ou connexion perdue (+SMSTATE: 0).
+ * @return false si la ligne n'est pas une URC MQTT.
+ */
+bool TransportMqtt::traiterUrc(const char *texte, unsigned long maintenant)
+{
+    if (strncmp(texte, "+SMSUB:", 7) == 0)
+        traiterCommande(texte, maintenant);
+    else if (strcmp(texte, "+SMSTATE: 0") == 0)
+    {
+        // Connexion perdue (keep-alive, réseau) : reprise au prochain envoi
+        connecte = false;
+        stats.nbDeconnexions++;
+        if (!config.sessionPersistante)
+            abonne = false;
+        if (etatMqtt == MQTT_EN_COURS)
+            terminer(MQTT_ECHEC, maintenant);
+    }
+    else
+        return strncmp(texte, "+SMSTATE:", 9) == 0;
+    return true;
+}
+
+/**
+ * @brief Flux du modem : prompt et OK de la publication en cours, URC +SMSUB et +SMSTATE.
+ */
+void TransportMqtt::traiter(const char *donnees, size_t n, unsigned long maintenant)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        char c = donnees[i];
+        if (c == '>' && longueur == 0 && invite)
+        {
+            ecrire(message, tailleMessage);
+            invite = false;
+            ecrit = true;
+            evenementMs = maintenant;
+        }
+        else if (c == '\n')
+        {
+            traiterLigne(maintenant);
+            longueur = 0;
+        }
+        else if (c != '\r' && !(c == ' ' && longueur == 0) && longueur < TAILLE_LIGNE_MQTT - 1)
+            ligne[longueur++] = c;
+    }
+}
+
+EtatMqtt TransportMqtt::pomper(unsigned long maintenant)
+{
+    if (etatMqtt != MQTT_EN_COURS)
+        return etatMqtt;
+    char tampon[64];
+    while (etatMqtt == MQTT_EN_COURS && Sim7080G.available())
+    {
+        size_t n = 0;
+        while (n < sizeof(tampon) && Sim7080G.available())
+            tampon[n++] = (char)Sim7080G.read();
+        traiter(tampon, n, maintenant);
+    }
+    if (etatMqtt == MQTT_EN_COURS && maintenant - evenementMs > config.delaiMs)
+    {
+        Serial.println(String("[MQTT] pas de ") + (invite ? "prompt" : "PUBACK") + " du modem");
+        terminer(MQTT_ECHEC, maintenant);
+    }
+    return etatMqtt;
+}
+
+void TransportMqtt::liberer()
+{
+    etatMqtt = MQTT_INACTIF;
+    invite = false;
+    ecrit = false;
+    message = nullptr;
+}
+
+/**
+ * @brief Réveil de STEP_END_GLOBAL : lit les URC reçues pendant le sommeil.
+ * @return true si une commande a été appliquée.
+ */
+bool TransportMqtt::servir(unsigned long maintenant)
+{
+    if (!connecte)
+        return false;
+    uint32_t avant = stats.nbCommandes;
+    aiguillageUrc.lire(maintenant);
+    return stats.nbCommandes != avant;
+}
+
+/**
+ * @brief Heure du prochain réveil : la tranche suivante tant que le client est abonné, sinon l'échéance demandée.
+ * Pendant ces tranches, ecouteUart() remplace le light sleep par une attente UART active (GESTION_PSM) : les premiers
+ * octets reçus au réveil d'un light sleep sont perdus, et une commande +SMSUB ne peut pas être relue au modem.
+ */
+unsigned long TransportMqtt::reveil(unsigned long maintenant, unsigned long echeance) const
+{
+    if (!config.actif || !connecte || !abonne)
+        return echeance;
+    unsigned long prochain = maintenant + config.trancheMs;
+    return (long)(echeance - prochain) < 0 ? echeance : prochain;
+}
+
+bool BrokerMqttLocal::abonne(const String &topic) const
+{
+    for (const String &a : abonnements)
+        if (a == topic)
+            return true;
+    return false;
+}
+
+String BrokerMqttLocal::urc(const String &topic, const std::vector<uint8_t> &contenu) const
+{
+    String ligne = "\r\n+SMSUB: \"" + topic + "\",\"";
+    for (uint8_t o : contenu)
+    {
+        ligne += HEXA[o >> 4];
+        ligne += HEXA[o & 0x0F];
+    }
+    return ligne + "\"\r\n";
+}
+
+/**
+ * @brief Réponse du modem à une commande AT+SM*, avec les commandes gardées par le broker livrées à la connexion.
+ */
+String BrokerMqttLocal::traiter(const String &commande)
+{
+    if (commande.startsWith("AT+SMCONF=\"CLEANSS\","))
+        sessionPropre = commande.endsWith("1");
+    else if (commande.startsWith("AT+SMCONN"))
+    {
+        if (connecte)
+            return "\r\nERROR\r\n";
+        connecte = true;
+        nbConnexions++;
+        if (sessionPropre)
+        {
+            abonnements.clear();
+            enAttente.clear();
+        }
+        String reponse = "\r\nOK\r\n";
+        for (const auto &c : enAttente)
+        {
+            reponse += urc(c.first, c.second);
+            nbCommandesLivrees++;
+        }
+        enAttente.clear();
+        return reponse;
+    }
+    else if (commande.startsWith("AT+SMSUB=\""))
+    {
+        if (!connecte)
+            return "\r\nERROR\r\n";
+        String topic = commande.substring(10, commande.indexOf("\"", 10));
+        if (!abonne(topic))
+            abonnements.push_back(topic);
+    }
+    else if (commande.startsWith("AT+SMSTATE?"))
+        return String("\r\n+SMSTATE: ") + (connecte ? "1" : "0") + "\r\n\r\nOK\r\n";
+    else if (commande.startsWith("AT+SMDISC"))
+        couper();
+    return "\r\nOK\r\n";
+}
+
+bool BrokerMqttLocal::publier(const String &topic, const uint8_t *contenu, size_t taille)
+{
+    if (!connecte)
+        return false;
+    publications.push_back(std::vector<uint8_t>(contenu, contenu + taille));
+    (void)topic;
+    return true;
+}
+
+/**
+ * @brief Commande QoS 1 du serveur : URC +SMSUB si le client est connecté, gardée si la session est persistante.
+ * @return l'URC livrée au modem, vide sinon.
+ */
+String BrokerMqttLocal::commander(const String &topic, const json &options)
+{
+    std::vector<uint8_t> contenu = json::to_cbor(options);
+    if (!abonne(topic))
+    {
+        nbCommandesPerdues++;
+        return "";
+    }
+    if (connecte)
+    {
+        nbCommandesLivrees++;
+        return urc(topic, contenu);
+    }
+    enAttente.push_back({topic, contenu});
+    return "";
+}
+
+void BrokerMqttLocal::couper()
+{
+    connecte = false;
+    if (!sessionPropre)
+        return;
+    nbCommandesPerdues += enAttente.size();
+    enAttente.clear();
+    abonnements.clear();
+}
+
+/**
+ * @brief Commandes AT par fix publié et latence des envois de scenario.nbCycles lots de fixes.
+ *
+ * TCP (pipeline actuel) : AT+CAOPEN (un aller-retour), AT+CASEND et AT+CARECV (un aller-retour), AT+CACLOSE ;
+ * une commande du serveur attend la réponse à l'envoi suivant.
+ * MQTT : AT+SMPUB (PUBLISH, PUBACK) sur la connexion ouverte ; après une coupure, AT+SMCONN (connexion TCP puis
+ * CONNECT, deux allers-retours) et, en session propre, AT+SMSUB (un aller-retour). Les commandes passent par
+ * BrokerMqttLocal.
+ */
+RapportMqtt simulerMqtt(const ScenarioMqtt &scenario, const ConfigMqtt &config)
+{
+    RapportMqtt rapport;
+    const unsigned long at = scenario.commandeAtMs;
+    const String topic = "gps/0/cmd";
+    BrokerMqttLocal broker;
+    uint64_t transactions = 0;
+    uint64_t cumul = 0;
+    bool configure = false, connecte = false, abonne = false;
+
+    for (uint16_t cycle = 1; cycle <= scenario.nbCycles; ++cycle)
+    {
+        unsigned long latence = 0;
+        if (!config.actif)
+        {
+            transactions += 4;
+            latence = 3 * at + 2 * scenario.rttMs;
+            rapport.nbConnexions++;
+        }
+        else
+        {
+            if (!configure)
+            {
+                transactions += 5;
+                latence += 5 * at;
+                broker.traiter(String("AT+SMCONF=\"CLEANSS\",") + (config.sessionPersistante ? "0" : "1"));
+                configure = true;
+            }
+            if (!connecte)
+            {
+                broker.traiter("AT+SMCONN");
+                transactions++;
+                latence += at + 2 * scenario.rttMs;
+                connecte = true;
+                if (!config.sessionPersistante)
+                    abonne = false;
+            }
+            if (!abonne)
+            {
+                broker.traiter("AT+SMSUB=\"" + topic + "\",1");
+                transactions++;
+                latence += at + scenario.rttMs;
+                abonne = true;
+            }
+            uint8_t lot[1] = {0};
+            broker.publier("gps/0", lot, sizeof(lot));
+            transactions++;
+            latence += at + scenario.rttMs;
+
+            if (scenario.coupureTous != 0 && cycle % scenario.coupureTous == 0)
+            {
+                broker.couper();
+                connecte = false;
+            }
+            if (scenario.commandeTous != 0 && cycle % scenario.commandeTous == 0)
+                broker.commander(topic, {{"periode", cycle}});
+        }
+        if (!config.actif && scenario.commandeTous != 0 && cycle % scenario.commandeTous == 0)
+            rapport.nbCommandesLivrees++; // lue avec la réponse à l'envoi suivant
+
+        cumul += latence;
+        if (latence > rapport.latencePublicationMaxMs)
+            rapport.latencePublicationMaxMs = latence;
+    }
+
+    if (config.actif)
+    {
+        rapport.nbConnexions = broker.nbConnexions;
+        rapport.nbCommandesLivrees = broker.nbCommandesLivrees;
+        rapport.nbCommandesPerdues = broker.nbCommandesPerdues;
+    }
+    if (scenario.nbCycles > 0)
+    {
+        rapport.latencePublicationMoyenneMs = (uint32_t)(cumul / scenario.nbCycles);
+        if (scenario.fixesParLot > 0)
+            rapport.transactionsParFix = (float)transactions / ((uint32_t)scenario.nbCycles * scenario.fixesParLot);
+    }
+    return rapport;
+}
+
+/**
+ * @brief Options reçues du serveur : {"actif": bool, "hote": "mqtt.exemple.fr", "port": 1883, "sessionPersistante": bool,
+ *        "keepAliveS": s, "delaiMs": ms}.
+ *
+ * Un nouveau broker, une nouvelle session ou un nouveau keep-alive s'applique à la connexion suivante : la connexion
+ * ouverte est fermée et AT+SMCONF est réécrit.
+ */
+void chargerOptionsMqtt(const json &options)
+{
+    ConfigMqtt &config = transportMqtt.config;
+    ConfigMqtt avant = config;
+    if (options.contains("actif"))
+        config.actif = options["actif"].get<bool>();
+    if (options.contains("hote"))
+        config.hote = String(options["hote"].get<std::string>().c_str());
+    if (options.contains("port"))
+        config.port = options["port"].get<uint16_t>();
+    if (options.contains("sessionPersistante"))
+        config.sessionPersistante = options["sessionPersistante"].get<bool>();
+    if (options.contains("keepAliveS"))
+        config.keepAliveS = options["keepAliveS"].get<uint16_t>();
+    if (options.contains("delaiMs"))
+        config.delaiMs = options["delaiMs"].get<unsigned long>();
+    if (config.hote != avant.hote || config.port != avant.port ||
+        config.sessionPersistante != avant.sessionPersistante || config.keepAliveS != avant.keepAliveS)
+    {
+        transportMqtt.deconnecter();
+        transportMqtt.reconfigurer();
+    }
+}
+
+void afficherStatsMqtt()
+{
+    const StatsMqtt &s = transportMqtt.stats;
+    if (s.nbPublications == 0 && s.nbEchecs == 0)
+        return;
+    uint32_t moyenne = s.nbPublications ? (uint32_t)(s.latenceCumuleeMs / s.nbPublications) : 0;
+    float parFix = s.nbFixesPublies ? (float)s.transactionsAT / s.nbFixesPublies : 0;
+    Serial.println("[MQTT] publications : " + String(s.nbPublications) + " (" + String(s.nbFixesPublies) + " fixes, " +
+                   String(s.nbEchecs) + " echecs) / connexions " + String(s.nbConnexions) + " (reprises " +
+                   String(s.nbConnexionsReprises) + ", coupures " + String(s.nbDeconnexions) + ") / commandes " +
+                   String(s.nbCommandes) + " / AT par fix " + String(parFix, 2) + " / latence (ms) moyenne " +
+                   String(moyenne) + ", max " + String(s.latenceMaxMs));
+}
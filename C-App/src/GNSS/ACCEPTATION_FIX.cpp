@@ -0,0 +1,247 @@
+/**
+ * @file ACCEPTATION_FIX.cpp
+ * @brief Acceptation des fixes GNSS sur critères de qualité, rejet des sauts et lissage optionnel.
+ *
+ * Jusqu'ici, getGNSSValid() acceptait tout fix dont la latitude et la longitude étaient non nulles :
+ * le contrôle du HDOP était commenté et l'option "precision" reçue du serveur n'était jamais appliquée.
+ *
+ * Chaque fix (mode sondage ou flux) passe maintenant par AcceptationFix::evaluer() :
+ * - position absente ou nulle : rejet,
+ * - HDOP au-dessus du seuil (gnssOptions.precision quand l'option est active, sinon hdopMaxDixiemes),
+ * - moins de satellitesMin satellites utilisés, C/N0 du meilleur satellite sous cn0Min,
+ * - saut impossible : distance au dernier fix accepté supérieure à vitesseMaxKmh x dt + margeSautM.
+ *   Après sautsAvantReprise sauts consécutifs qui concordent entre eux (chacun atteignable depuis le précédent),
+ *   la nouvelle position est acceptée (le récepteur avait raison) ; des aberrations dispersées ne se confirment pas.
+ * Un champ absent de la trame (-1) n'est pas contrôlé.
+ *
+ * Si config.lissage est actif, les fixes acceptés passent par un filtre alpha-beta en virgule fixe
+ * (plan tangent en mm, vitesse en mm/s) dont l'état tient en quelques entiers.
+ *
+ * Les compteurs (acceptés, rejetés par raison, reprises) sont affichés à la fin de chaque cycle.
+ */
+
+#include "ACCEPTATION_FIX.hpp"
+
+AcceptationFix acceptationFix; ///< Filtre appliqué à chaque fix avant l'échantillonneur.
+
+#define DT_MAX_FILTRE_MS 60000UL      // au-delà, l'état du filtre est trop ancien : il repart du fix mesuré
+#define RAYON_RECENTRAGE_MM 10000000L // 10 km : le plan tangent est recentré au-delà
+#define VITESSE_MAX_FILTRE_MMS 100000 // 360 km/h
+
+static int32_t borner(int64_t valeur, int32_t limite)
+{
+    if (valeur > limite)
+        return limite;
+    if (valeur < -limite)
+        return -limite;
+    return (int32_t)valeur;
+}
+
+FiltreAlphaBeta::FiltreAlphaBeta()
+{
+    reinitialiser();
+}
+
+void FiltreAlphaBeta::reinitialiser()
+{
+    initialise = false;
+    latRefE6 = lonRefE6 = 0;
+    xMm = yMm = 0;
+    vxMmS = vyMmS = 0;
+    tMs = 0;
+}
+
+/**
+ * @brief Met à jour le filtre avec un fix mesuré et remplace sa position par la position filtrée.
+ *
+ * Prédiction : p = x + v.dt ; correction : x = p + alpha.(m - p), v = v + beta.(m - p) / dt.
+ */
+void FiltreAlphaBeta::filtrer(Echantillon &e, uint8_t alphaQ8, uint8_t betaQ8)
+{
+    unsigned long dt = e.tMs - tMs;
+    if (!initialise || e.tMs < tMs || dt > DT_MAX_FILTRE_MS)
+    {
+        initialise = true;
+        latRefE6 = e.latE6;
+        lonRefE6 = e.lonE6;
+        xMm = yMm = 0;
+        vxMmS = vyMmS = 0;
+        tMs = e.tMs;
+        return;
+    }
+    if (dt == 0)
+        dt = 1;
+
+    int32_t mx, my;
+    projeterMm(latRefE6, lonRefE6, e.latE6, e.lonE6, mx, my);
+
+    int64_t px = xMm + (int64_t)vxMmS * (int64_t)dt / 1000;
+    int64_t py = yMm + (int64_t)vyMmS * (int64_t)dt / 1000;
+    int64_t rx = mx - px;
+    int64_t ry = my - py;
+    xMm = (int32_t)(px + rx * alphaQ8 / 256);
+    yMm = (int32_t)(py + ry * alphaQ8 / 256);
+    vxMmS = borner(vxMmS + rx * betaQ8 * 1000 / 256 / (int64_t)dt, VITESSE_MAX_FILTRE_MMS);
+    vyMmS = borner(vyMmS + ry * betaQ8 * 1000 / 256 / (int64_t)dt, VITESSE_MAX_FILTRE_MMS);
+    tMs = e.tMs;
+
+    int32_t lat, lon;
+    deprojeterE6(latRefE6, lonRefE6, xMm, yMm, lat, lon);
+    if (xMm > RAYON_RECENTRAGE_MM || xMm < -RAYON_RECENTRAGE_MM || yMm > RAYON_RECENTRAGE_MM || yMm < -RAYON_RECENTRAGE_MM)
+    {
+        latRefE6 = lat;
+        lonRefE6 = lon;
+        xMm = yMm = 0;
+    }
+    e.latE6 = lat;
+    e.lonE6 = lon;
+}
+
+AcceptationFix::AcceptationFix()
+{
+    reinitialiser();
+}
+
+void AcceptationFix::reinitialiser()
+{
+    stats = StatsAcceptation();
+    aDernier = false;
+    dernier = Echantillon();
+    saut = Echantillon();
+    nbSauts = 0;
+    filtre.reinitialiser();
+}
+
+/**
+ * @brief Seuil HDOP appliqué (x 10) : l'option "precision" du serveur l'emporte quand elle est active.
+ */
+int16_t AcceptationFix::hdopMaxDixiemes() const
+{
+    return gnssOptions.precisionActive ? (int16_t)(gnssOptions.precision * 10) : config.hdopMaxDixiemes;
+}
+
+RaisonRejet AcceptationFix::verifier(const Echantillon &e)
+{
+    if (e.latE6 == COORD_INVALIDE || e.lonE6 == COORD_INVALIDE || (e.latE6 == 0 && e.lonE6 == 0))
+        return REJET_POSITION;
+    if (e.hdopDixiemes >= 0 && e.hdopDixiemes >= hdopMaxDixiemes())
+        return REJET_HDOP;
+    if (e.satellites >= 0 && e.satellites < config.satellitesMin)
+        return REJET_SATELLITES;
+    if (e.cn0 >= 0 && e.cn0 < config.cn0Min)
+        return REJET_CN0;
+
+    // millis() repart de zéro après un deep sleep : pas de comparaison avec un fix d'un autre cycle
+    if (aDernier && e.tMs >= dernier.tMs && !atteignable(dernier, e))
+        return REJET_SAUT;
+    return FIX_ACCEPTE;
+}
+
+/**
+ * @brief e est-il à moins de vitesseMaxKmh x dt + margeSautM de depuis ? Un fix antérieur (autre cycle) ne l'est pas.
+ */
+bool AcceptationFix::atteignable(const Echantillon &depuis, const Echantillon &e) const
+{
+    if (e.tMs < depuis.tMs)
+        return false;
+    uint32_t atteignableM = (uint32_t)((uint64_t)config.vitesseMaxKmh * (e.tMs - depuis.tMs) / 3600) + config.margeSautM;
+    return distanceM(depuis.latE6, depuis.lonE6, e.latE6, e.lonE6) <= atteignableM;
+}
+
+/**
+ * @brief Décide si un fix est gardé ; si le lissage est actif, sa position est remplacée par la position filtrée.
+ * @return FIX_ACCEPTE ou la raison du rejet.
+ */
+RaisonRejet AcceptationFix::evaluer(Echantillon &e)
+{
+    stats.nbEvalues++;
+    if (!config.actif)
+    {
+        stats.nbAcceptes++;
+        return FIX_ACCEPTE;
+    }
+
+    RaisonRejet raison = verifier(e);
+    if (raison == REJET_SAUT)
+    {
+        // Un saut loin du précédent ne le confirme pas : la série repart de ce saut
+        nbSauts = (nbSauts > 0 && atteignable(saut, e)) ? nbSauts + 1 : 1;
+        saut = e;
+        if (nbSauts >= config.sautsAvantReprise)
+        {
+            // Plusieurs fixes concordent sur la nouvelle position : c'est l'ancienne qui était fausse
+            stats.nbReprises++;
+            filtre.reinitialiser();
+            raison = FIX_ACCEPTE;
+        }
+    }
+    if (raison != FIX_ACCEPTE)
+    {
+        stats.rejets[raison]++;
+        return raison;
+    }
+
+    nbSauts = 0;
+    dernier = e;
+    aDernier = true;
+    stats.nbAcceptes++;
+    if (config.lissage)
+        filtre.filtrer(e, config.alphaQ8, config.betaQ8);
+    return FIX_ACCEPTE;
+}
+
+/**
+ * @brief Applique l'acceptation à un fix complet (getGNSSValid ou flux) et y reporte la position lissée.
+ * @return true si le fix est gardé.
+ */
+bool accepterFix(Gnss &gnss, unsigned long tMs)
+{
+    Echantillon e = echantillonDepuisGnss(gnss, tMs);
+    int32_t latMesuree = e.latE6;
+    int32_t lonMesuree = e.lonE6;
+
+    RaisonRejet raison = acceptationFix.evaluer(e);
+    if (raison != FIX_ACCEPTE)
+    {
+        Serial.println(String("[GNSS] fix rejete : ") + nomRaisonRejet(raison));
+        return false;
+    }
+    if (e.latE6 != latMesuree || e.lonE6 != lonMesuree)
+    {
+        gnss.coordonnees.latitude = parseGNSS(e6VersDegres(e.latE6));
+        gnss.coordonnees.longitude = parseGNSS(e6VersDegres(e.lonE6));
+    }
+    return true;
+}
+
+const char *nomRaisonRejet(RaisonRejet raison)
+{
+    switch (raison)
+    {
+    case FIX_ACCEPTE:
+        return "accepte";
+    case REJET_POSITION:
+        return "position";
+    case REJET_HDOP:
+        return "hdop";
+    case REJET_SATELLITES:
+        return "satellites";
+    case REJET_CN0:
+        return "cn0";
+    case REJET_SAUT:
+        return "saut";
+    default:
+        return "?";
+    }
+}
+
+void afficherStatsAcceptation()
+{
+    const StatsAcceptation &s = acceptationFix.stats;
+    String rejets = "";
+    for (int i = REJET_POSITION; i < NB_RAISONS_REJET; ++i)
+        rejets += String(nomRaisonRejet((RaisonRejet)i)) + ":" + String(s.rejets[i]) + " ";
+    Serial.println("[GNSS] fixes acceptes : " + String(s.nbAcceptes) + " / " + String(s.nbEvalues) +
+                   " (reprises : " + String(s.nbReprises) + ")");
+    Serial.println("[GNSS] rejets " + rejets);
+}
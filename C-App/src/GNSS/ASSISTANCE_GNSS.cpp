@@ -0,0 +1,312 @@
+/**
+ * @file ASSISTANCE_GNSS.cpp
+ * @brief Gestion de l'acquisition GNSS : constellations, assistance XTRA, fenêtres de hot start et mesure du TTFF.
+ *
+ * Le GNSS est allumé au début de chaque cycle et éteint après MAX_COORDS fixes. Sans données d'assistance,
+ * chaque allumage risque un démarrage à froid (TTFF de plusieurs dizaines de secondes, GNSS allumé d'autant).
+ *
+ * Ce fichier garde les données d'assistance à jour d'un cycle à l'autre :
+ * - XTRA : éphémérides prédites téléchargées en LTE (AT+HTTPTOFS), copiées dans le récepteur (AT+CGNSCPY)
+ *   et activées (AT+CGNSXTRA=1). Le fichier est rafraîchi bien avant la fin de sa validité.
+ * - Fenêtres d'entretien : si le prochain cycle tombe après l'expiration des éphémérides diffusées,
+ *   le GNSS est rallumé brièvement juste avant pour les renouveler et garder un hot start. Un allumage refusé est
+ *   retenté avec un délai doublé, puis la fenêtre est abandonnée : le cycle suivant fera une acquisition normale.
+ * - Constellations : choisies avec AT+CGNSMOD, envoyé seulement quand la sélection change.
+ *
+ * Chaque acquisition est chronométrée : histogramme du TTFF, TTFF moyen par type de démarrage
+ * et temps d'allumage du GNSS par fix.
+ */
+
+#include "ASSISTANCE_GNSS.hpp"
+#include "GnssUtils.hpp"
+#include "ENERGIE.hpp"
+
+AssistanceGNSS assistanceGnss; ///< État de l'assistance et statistiques d'acquisition.
+
+/// Bornes supérieures des classes de l'histogramme TTFF (la dernière classe est ouverte).
+const unsigned long BORNES_TTFF_MS[NB_CLASSES_TTFF - 1] = {5000, 10000, 20000, 30000, 60000, 120000};
+
+String commandeConstellations(const Constellations &c)
+{
+    return String("AT+CGNSMOD=") + (c.gps ? "1" : "0") + "," + (c.glonass ? "1" : "0") + "," +
+           (c.beidou ? "1" : "0") + "," + (c.galileo ? "1" : "0") + "," + (c.qzss ? "1" : "0");
+}
+
+/**
+ * @brief Envoie AT+CGNSMOD seulement si la sélection de constellations a changé.
+ */
+void appliquerConstellations()
+{
+    String commande = commandeConstellations(assistanceGnss.constellations);
+    if (commande == assistanceGnss.constellationsAppliquees)
+        return;
+    if (Send_AT(commande, 1000).indexOf("OK") != -1)
+        assistanceGnss.constellationsAppliquees = commande;
+}
+
+bool xtraValide(unsigned long maintenant)
+{
+    return assistanceGnss.xtraDisponible && (maintenant - assistanceGnss.xtraTelechargeMs) < assistanceGnss.validiteXtraMs;
+}
+
+bool xtraAMettreAJour(unsigned long maintenant)
+{
+    return !assistanceGnss.xtraDisponible || (maintenant - assistanceGnss.xtraTelechargeMs) >= assistanceGnss.rafraichissementXtraMs;
+}
+
+/**
+ * @brief Extrait le résultat du téléchargement de l'URC "+HTTPTOFS: <statut>,<taille>".
+ * @return true si l'URC est présente.
+ */
+bool parseHttpToFs(const String &reponse, int &statut, long &taille)
+{
+    int index = reponse.indexOf("+HTTPTOFS: ");
+    if (index == -1)
+        return false;
+    int virgule = reponse.indexOf(',', index);
+    if (virgule == -1)
+        return false;
+    statut = reponse.substring(index + 11, virgule).toInt();
+    taille = reponse.substring(virgule + 1).toInt();
+    return true;
+}
+
+/**
+ * @brief Télécharge le fichier XTRA dans le système de fichiers du modem et l'injecte dans le récepteur GNSS.
+ *
+ * Nécessite un contexte PDP actif. Le téléchargement est suivi avec AT+HTTPTOFSRL? jusqu'à la fin du transfert.
+ * @return true si le fichier a été téléchargé et activé.
+ */
+bool telechargerXtra(unsigned long maintenant)
+{
+    Serial.println("[XTRA] Telechargement " + assistanceGnss.urlXtra);
+    String reponse = Send_AT("AT+HTTPTOFS=\"" + assistanceGnss.urlXtra + "\",\"" + assistanceGnss.fichierXtra + "\"", 2000);
+    if (reponse.indexOf("ERROR") != -1)
+    {
+        assistanceGnss.stats.nbEchecsXtra++;
+        return false;
+    }
+
+    int statut = 0;
+    long taille = 0;
+    bool termine = parseHttpToFs(reponse, statut, taille);
+    for (int i = 0; i < 30 && !termine; ++i)
+    {
+        String etat = Send_AT("AT+HTTPTOFSRL?", 1000);
+        termine = parseHttpToFs(etat, statut, taille);
+        if (!termine && etat.indexOf("+HTTPTOFSRL: 0") != -1)
+            break; // plus de transfert en cours et pas de résultat
+    }
+
+    if (!termine || statut != 200 || taille <= 0)
+    {
+        Serial.println("[XTRA] Echec (statut " + String(statut) + ")");
+        assistanceGnss.stats.nbEchecsXtra++;
+        return false;
+    }
+
+    if (Send_AT("AT+CGNSCPY", 5000).indexOf("OK") == -1 || Send_AT("AT+CGNSXTRA=1").indexOf("OK") == -1)
+    {
+        assistanceGnss.stats.nbEchecsXtra++;
+        return false;
+    }
+
+    assistanceGnss.xtraDisponible = true;
+    assistanceGnss.xtraTelechargeMs = maintenant;
+    assistanceGnss.stats.nbTelechargementsXtra++;
+    Serial.println("[XTRA] " + String(taille) + " octets actives");
+    return true;
+}
+
+/**
+ * @brief Rafraîchit le fichier XTRA s'il est absent ou trop ancien (appelée quand la liaison LTE est établie).
+ */
+void mettreAJourXtraSiNecessaire(unsigned long maintenant)
+{
+    if (xtraAMettreAJour(maintenant))
+        telechargerXtra(maintenant);
+}
+
+TypeDemarrageGnss typeDemarrageAttendu(unsigned long maintenant)
+{
+    if (assistanceGnss.ephemeridesConnues && (maintenant - assistanceGnss.derniereFixMs) < assistanceGnss.validiteEphemeridesMs)
+        return DEMARRAGE_HOT;
+    if (xtraValide(maintenant))
+        return DEMARRAGE_ASSISTE;
+    return DEMARRAGE_COLD;
+}
+
+/**
+ * @brief Début d'une acquisition : le GNSS vient d'être allumé.
+ */
+void debutAcquisition(unsigned long maintenant)
+{
+    assistanceGnss.acquisitionEnCours = true;
+    assistanceGnss.premierFixRecu = false;
+    assistanceGnss.typeAcquisition = typeDemarrageAttendu(maintenant);
+    assistanceGnss.debutAcquisitionMs = maintenant;
+}
+
+int classeTtff(unsigned long ttffMs)
+{
+    for (int i = 0; i < NB_CLASSES_TTFF - 1; ++i)
+        if (ttffMs < BORNES_TTFF_MS[i])
+            return i;
+    return NB_CLASSES_TTFF - 1;
+}
+
+/**
+ * @brief Enregistre un fix valide ; le premier de l'acquisition donne le TTFF.
+ */
+void enregistrerFixAcquisition(unsigned long maintenant)
+{
+    StatsAcquisition &stats = assistanceGnss.stats;
+    stats.nbFix++;
+    assistanceGnss.ephemeridesConnues = true;
+    assistanceGnss.derniereFixMs = maintenant;
+
+    if (!assistanceGnss.acquisitionEnCours || assistanceGnss.premierFixRecu)
+        return;
+    assistanceGnss.premierFixRecu = true;
+    unsigned long ttff = maintenant - assistanceGnss.debutAcquisitionMs;
+    stats.dernierTtffMs = ttff;
+    stats.histogrammeTtff[classeTtff(ttff)]++;
+    stats.nbAcquisitions[assistanceGnss.typeAcquisition]++;
+    stats.ttffCumuleMs[assistanceGnss.typeAcquisition] += ttff;
+}
+
+/**
+ * @brief Fin d'une acquisition : le GNSS vient d'être éteint.
+ */
+void finAcquisition(unsigned long maintenant)
+{
+    if (!assistanceGnss.acquisitionEnCours)
+        return;
+    assistanceGnss.stats.tempsAllumeMs += maintenant - assistanceGnss.debutAcquisitionMs;
+    if (!assistanceGnss.premierFixRecu)
+        assistanceGnss.stats.nbSansFix++;
+    assistanceGnss.acquisitionEnCours = false;
+}
+
+/**
+ * @brief Oublie les éphémérides diffusées (le modem a été redémarré).
+ */
+void oublierEphemerides()
+{
+    assistanceGnss.ephemeridesConnues = false;
+}
+
+/**
+ * @brief Temps moyen d'allumage du GNSS par fix (ms), fenêtres d'entretien comprises.
+ */
+unsigned long tempsGnssParFixMs()
+{
+    if (assistanceGnss.stats.nbFix == 0)
+        return 0;
+    return assistanceGnss.stats.tempsAllumeMs / assistanceGnss.stats.nbFix;
+}
+
+/**
+ * @brief Instant auquel se réveiller pour une fenêtre d'entretien, ou reveilCycleMs si aucune n'est utile.
+ *
+ * Une fenêtre n'est utile que si le prochain cycle démarrerait après l'expiration des éphémérides. Après un allumage
+ * refusé, elle n'est pas rouverte avant prochainEssaiMs.
+ */
+unsigned long echeanceEntretien(unsigned long maintenant, unsigned long reveilCycleMs)
+{
+    const AssistanceGNSS &a = assistanceGnss;
+    if (!a.fenetresEntretien || !a.ephemeridesConnues)
+        return reveilCycleMs;
+    unsigned long expiration = a.derniereFixMs + a.validiteEphemeridesMs;
+    if ((long)(reveilCycleMs - expiration) <= 0)
+        return reveilCycleMs; // le cycle arrive avant l'expiration : hot start de toute façon
+    unsigned long debutFenetre = expiration - a.dureeFenetreMs;
+    if (a.echecsAllumage > 0 && (long)(a.prochainEssaiMs - debutFenetre) > 0)
+        debutFenetre = a.prochainEssaiMs;
+    if ((long)(debutFenetre - maintenant) < 0)
+        return maintenant;
+    return debutFenetre;
+}
+
+/**
+ * @brief Fenêtre d'entretien des éphémérides, appelée pendant l'attente entre deux cycles.
+ *
+ * Allume le GNSS juste avant l'expiration des éphémérides, attend un fix (sondé toutes les 3 s)
+ * et le laisse allumé pendant dureeFenetreMs pour que le récepteur renouvelle ses éphémérides.
+ * Un AT+CGNSPWR=1 refusé est retenté après delaiReessaiMs, doublé à chaque échec ; après maxEchecsAllumage échecs,
+ * les éphémérides sont tenues pour perdues et plus aucune fenêtre n'est ouverte avant le prochain cycle.
+ *
+ * @param maintenant Instant courant (ms).
+ * @param reveilCycleMs Début du prochain cycle (ms).
+ * @return true tant que la fenêtre est en cours (l'appelant ne doit pas s'endormir).
+ */
+bool entretenirEphemerides(unsigned long maintenant, unsigned long reveilCycleMs)
+{
+    AssistanceGNSS &a = assistanceGnss;
+    if (!a.entretienEnCours)
+    {
+        if (echeanceEntretien(maintenant, reveilCycleMs) != maintenant)
+            return false;
+        if (Send_AT("AT+CGNSPWR=1", 2000).indexOf("OK") == -1)
+        {
+            a.stats.nbEchecsAllumage++;
+            if (++a.echecsAllumage >= a.maxEchecsAllumage)
+            {
+                Serial.println("[GNSS] Fenetre d'entretien abandonnee : GNSS non allume apres " + String(a.echecsAllumage) + " essais");
+                a.stats.nbEntretiensAbandonnes++;
+                a.echecsAllumage = 0;
+                a.ephemeridesConnues = false;
+                return false;
+            }
+            a.prochainEssaiMs = maintenant + (a.delaiReessaiMs << (a.echecsAllumage - 1));
+            return false;
+        }
+        Serial.println("[GNSS] Fenetre d'entretien des ephemerides");
+        a.echecsAllumage = 0;
+        energie.setEtatGnss(GNSS_ALLUME, maintenant);
+        a.entretienEnCours = true;
+        a.entretienFix = false;
+        a.debutEntretienMs = maintenant;
+        a.dernierSondageMs = maintenant;
+        return true;
+    }
+
+    if (!a.entretienFix && (maintenant - a.dernierSondageMs) >= 3000)
+    {
+        a.dernierSondageMs = maintenant;
+        a.entretienFix = getGNSSValid().isValid;
+    }
+
+    if ((maintenant - a.debutEntretienMs) < a.dureeFenetreMs)
+        return true;
+
+    Send_AT("AT+CGNSPWR=0", 2000);
+    energie.setEtatGnss(GNSS_ETEINT, maintenant);
+    a.entretienEnCours = false;
+    a.stats.tempsAllumeMs += maintenant - a.debutEntretienMs;
+    a.stats.nbFenetresEntretien++;
+    if (a.entretienFix)
+        a.derniereFixMs = maintenant;
+    else
+        a.ephemeridesConnues = false; // pas de ciel : inutile de réessayer avant le prochain cycle
+    return false;
+}
+
+void afficherStatsAcquisition()
+{
+    const StatsAcquisition &s = assistanceGnss.stats;
+    const char *noms[NB_TYPES_DEMARRAGE] = {"hot", "assiste", "cold"};
+    String histogramme = "";
+    for (int i = 0; i < NB_CLASSES_TTFF; ++i)
+    {
+        histogramme += (i < NB_CLASSES_TTFF - 1) ? "<" + String(BORNES_TTFF_MS[i] / 1000) + "s:" : ">=120s:";
+        histogramme += String(s.histogrammeTtff[i]) + " ";
+    }
+    Serial.println("[GNSS] TTFF " + histogramme);
+    for (int i = 0; i < NB_TYPES_DEMARRAGE; ++i)
+        if (s.nbAcquisitions[i] > 0)
+            Serial.println("[GNSS] TTFF moyen " + String(noms[i]) + " : " + String(s.ttffCumuleMs[i] / s.nbAcquisitions[i]) + " ms (" + String(s.nbAcquisitions[i]) + ")");
+    Serial.println("[GNSS] allume par fix : " + String(tempsGnssParFixMs()) + " ms, sans fix : " + String(s.nbSansFix) +
+                   ", fenetres : " + String(s.nbFenetresEntretien) + " (allumages refuses " + String(s.nbEchecsAllumage) +
+                   ", abandonnees " + String(s.nbEntretiensAbandonnes) + "), XTRA : " + String(s.nbTelechargementsXtra));
+}
@@ -0,0 +1,323 @@
+/**
+ * @file BASE_TEMPS.cpp
+ * @brief Base de temps UTC : analyse des horodatages sans allocation et horloge disciplinée par le GNSS et le réseau.
+ *
+ * Les horodatages du SIM7080G (CGNSINF, CLBS, CCLK) étaient découpés par six substring() chacun, le passage au mois
+ * suivant ne tenait pas compte de la longueur du mois, et les fixes partaient au serveur sans heure.
+ *
+ * - horodatageVersEpochMs() lit "yyyyMMddhhmmss.sss" directement dans le tampon et vérifie le calendrier
+ *   (mois de 28 à 31 jours, années bissextiles) ; le calcul des jours est constexpr (BASE_TEMPS.hpp).
+ * - BaseTemps ancre millis() sur la dernière heure sûre : chaque fix GNSS recale l'horloge, l'heure réseau
+ *   (AT+CCLK?, AT+CLBS) n'est retenue que si l'horloge est devenue moins précise qu'elle. L'incertitude croît avec
+ *   la dérive du quartz, et surtout avec celle de l'oscillateur RC qui compte le deep sleep : l'écart mesuré par le GNSS
+ *   au réveil calibre cette dérive. Une lecture de maintenantMs() ne recule jamais.
+ * - horodatageCourantMs() donne l'heure d'une position sans fix GNSS ; AT+CCLK? n'est envoyé que si l'horloge
+ *   ne suffit pas.
+ *
+ * L'heure est conservée en mémoire RTC (ETAT_RTC) pendant le deep sleep.
+ */
+
+#include "BASE_TEMPS.hpp"
+#include "SIM7080G_SERIAL.hpp"
+
+BaseTemps baseTemps; ///< Heure UTC des fixes, des événements de géofence et des positions de repli.
+
+// n chiffres décimaux, -1 si l'un des caractères n'en est pas un
+static int32_t lireChiffres(const char *texte, int n)
+{
+    int32_t valeur = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        if (texte[i] < '0' || texte[i] > '9')
+            return -1;
+        valeur = valeur * 10 + (texte[i] - '0');
+    }
+    return valeur;
+}
+
+// 0 si la date n'existe pas dans le calendrier
+static int64_t epochValide(int32_t annee, int32_t mois, int32_t jour, int32_t heure, int32_t minute, int32_t seconde, int32_t milli)
+{
+    if (annee < 1970 || mois < 1 || mois > 12 || jour < 1 || jour > joursDansMois(annee, mois) ||
+        heure < 0 || heure > 23 || minute < 0 || minute > 59 || seconde < 0 || seconde > 59 || milli < 0)
+        return 0;
+    return epochMs(annee, mois, jour, heure, minute, seconde, milli);
+}
+
+/**
+ * @brief Convertit un horodatage "yyyyMMddhhmmss[.sss]" (UTC) en millisecondes depuis le 01/01/1970.
+ * @return 0 si l'horodatage est absent, mal formé ou hors calendrier (ex : 20250431...).
+ */
+int64_t horodatageVersEpochMs(const char *texte, size_t longueur)
+{
+    if (texte == nullptr || longueur < 14)
+        return 0;
+    int32_t milli = 0;
+    if (longueur > 15 && texte[14] == '.')
+    {
+        int n = longueur - 15 > 3 ? 3 : (int)longueur - 15;
+        milli = lireChiffres(texte + 15, n);
+        for (int i = n; i < 3 && milli > 0; ++i)
+            milli *= 10;
+    }
+    return epochValide(lireChiffres(texte, 4), lireChiffres(texte + 4, 2), lireChiffres(texte + 6, 2),
+                       lireChiffres(texte + 8, 2), lireChiffres(texte + 10, 2), lireChiffres(texte + 12, 2), milli);
+}
+
+int64_t horodatageVersEpochMs(const String &texte)
+{
+    return horodatageVersEpochMs(texte.c_str(), texte.length());
+}
+
+/**
+ * @brief Opération inverse de horodatageVersEpochMs() : "yyyyMMddhhmmss.sss" (taille >= 19).
+ */
+void formaterHorodatage(int64_t epochMs, char *sortie, size_t taille)
+{
+    if (taille < 19)
+    {
+        if (taille > 0)
+            sortie[0] = '\0';
+        return;
+    }
+    DateUTC d = dateDepuisEpochMs(epochMs);
+    snprintf(sortie, taille, "%04ld%02u%02u%02u%02u%02u.%03u", (long)d.annee, d.mois, d.jour, d.heure, d.minute, d.seconde, d.milli);
+}
+
+/**
+ * @brief Horodatage texte d'une heure UTC (chaîne vide si l'heure est inconnue).
+ */
+String epochVersHorodatage(int64_t epochMs)
+{
+    if (epochMs == 0)
+        return "";
+    char texte[20];
+    formaterHorodatage(epochMs, texte, sizeof(texte));
+    return String(texte);
+}
+
+/**
+ * @brief Champ JSON de l'heure UTC d'un point (ms depuis le 01/01/1970), vide si l'heure est inconnue.
+ */
+String champHorodatageJSON(int64_t epochMs)
+{
+    if (epochMs == 0)
+        return "";
+    char texte[32];
+    snprintf(texte, sizeof(texte), ",\"horodatage\":%lld", (long long)epochMs);
+    return String(texte);
+}
+
+/**
+ * @brief Lit l'heure du modem (AT+CCLK?) : heure locale et fuseau en quarts d'heure.
+ *
+ * Ex : '+CCLK: "25/06/12,12:15:30+08"' -> 12/06/2025 10:15:30 UTC.
+ * @return ms depuis le 01/01/1970, 0 si l'heure est absente ou n'a jamais été réglée (modem : "80/01/06").
+ */
+int64_t epochDepuisCCLK(const char *reponse)
+{
+    const char *p = reponse ? strstr(reponse, "+CCLK: \"") : nullptr;
+    if (p == nullptr)
+        return 0;
+    p += 8;
+    if (strlen(p) < 17 || p[2] != '/' || p[5] != '/' || p[8] != ',' || p[11] != ':' || p[14] != ':')
+        return 0;
+    int32_t annee = lireChiffres(p, 2);
+    if (annee < 0)
+        return 0;
+    annee += annee >= 70 ? 1900 : 2000;
+    int64_t ms = epochValide(annee, lireChiffres(p + 3, 2), lireChiffres(p + 6, 2),
+                             lireChiffres(p + 9, 2), lireChiffres(p + 12, 2), lireChiffres(p + 15, 2), 0);
+    if ((p[17] == '+' || p[17] == '-') && lireChiffres(p + 18, 2) >= 0)
+    {
+        int64_t decalage = lireChiffres(p + 18, 2) * 900000LL;
+        ms += p[17] == '+' ? -decalage : decalage;
+    }
+    return ms >= EPOCH_MIN_MS ? ms : 0;
+}
+
+static uint32_t derive(uint64_t dureeMs, uint32_t ppm)
+{
+    return (uint32_t)(dureeMs * ppm / 1000000ULL);
+}
+
+static int32_t borner(int32_t valeur, int32_t max)
+{
+    return valeur > max ? max : valeur < -max ? -max : valeur;
+}
+
+BaseTemps::BaseTemps()
+{
+    reinitialiser();
+}
+
+void BaseTemps::reinitialiser()
+{
+    stats = StatsBaseTemps();
+    source = TEMPS_AUCUN;
+    ancreEpochMs = 0;
+    ancreMillis = 0;
+    incertitudeAncreMs = 0;
+    sommeilMs = 0;
+    correctionPpm = 0;
+    calibree = false;
+    dernierRenduMs = 0;
+}
+
+uint32_t BaseTemps::incertitudeEveilMs(unsigned long t) const
+{
+    return incertitudeAncreMs + derive(t - ancreMillis, config.deriveEveilPpm);
+}
+
+/**
+ * @brief Incertitude de l'heure à l'instant t : précision de la source, dérive du quartz, dérive de la RTC en deep sleep.
+ */
+uint32_t BaseTemps::incertitudeMs(unsigned long t) const
+{
+    if (!estSynchronisee())
+        return UINT32_MAX;
+    return incertitudeEveilMs(t) + derive(sommeilMs, calibree ? config.deriveSommeilCalibreePpm : config.deriveSommeilPpm);
+}
+
+/**
+ * @brief Heure UTC à l'instant millis() t, antérieur ou postérieur à la dernière synchronisation.
+ * @return ms depuis le 01/01/1970, 0 si l'horloge n'a jamais été synchronisée.
+ */
+int64_t BaseTemps::versEpochMs(unsigned long t) const
+{
+    if (!estSynchronisee())
+        return 0;
+    return ancreEpochMs + (int32_t)(t - ancreMillis);
+}
+
+/**
+ * @brief Heure UTC courante, jamais inférieure à une lecture précédente (un recalage en arrière est absorbé).
+ */
+int64_t BaseTemps::maintenantMs(unsigned long t)
+{
+    int64_t ms = versEpochMs(t);
+    if (ms != 0 && ms < dernierRenduMs)
+    {
+        stats.nbRetenues++;
+        return dernierRenduMs;
+    }
+    dernierRenduMs = ms;
+    return ms;
+}
+
+/**
+ * @brief Recale l'horloge sur une heure mesurée à l'instant millis() t.
+ *
+ * Une source moins précise que l'horloge (ex : AT+CCLK? juste après un fix GNSS) est ignorée.
+ * Après un deep sleep d'au moins sommeilMinCalibrationMs, l'écart mesuré par le GNSS corrige la dérive de la RTC.
+ * @return true si l'horloge a été recalée.
+ */
+bool BaseTemps::synchroniser(int64_t epochMs, unsigned long t, SourceTemps origine)
+{
+    if (epochMs < EPOCH_MIN_MS)
+    {
+        stats.nbRejets++;
+        return false;
+    }
+    uint32_t incertitude = origine == TEMPS_GNSS ? config.incertitudeGnssMs : config.incertitudeReseauMs;
+    if (estSynchronisee() && incertitude > incertitudeMs(t))
+    {
+        stats.nbIgnorees++;
+        return false;
+    }
+
+    if (estSynchronisee())
+    {
+        int64_t ecart = epochMs - versEpochMs(t);
+        uint64_t ecartAbsolu = ecart < 0 ? -ecart : ecart;
+        if (ecartAbsolu > stats.ecartMaxMs)
+            stats.ecartMaxMs = ecartAbsolu > UINT32_MAX ? UINT32_MAX : (uint32_t)ecartAbsolu;
+        if (origine == TEMPS_GNSS && sommeilMs >= config.sommeilMinCalibrationMs && incertitudeEveilMs(t) <= config.incertitudeReseauMs)
+        {
+            int32_t mesure = (int32_t)(ecart * 1000000LL / sommeilMs);
+            int32_t correction = correctionPpm + (calibree ? mesure / 2 : mesure);
+            correctionPpm = borner(correction, config.correctionSommeilMaxPpm);
+            calibree = true;
+            stats.nbCalibrations++;
+        }
+    }
+
+    source = origine;
+    ancreEpochMs = epochMs;
+    ancreMillis = t;
+    incertitudeAncreMs = incertitude;
+    sommeilMs = 0;
+    if (origine == TEMPS_GNSS)
+        stats.nbSynchroGnss++;
+    else
+        stats.nbSynchroReseau++;
+    return true;
+}
+
+EtatBaseTemps BaseTemps::sauvegarder(unsigned long t) const
+{
+    EtatBaseTemps etat;
+    memset(&etat, 0, sizeof(etat));
+    etat.epochMs = versEpochMs(t);
+    etat.incertitudeMs = estSynchronisee() ? incertitudeEveilMs(t) : 0;
+    etat.sommeilMs = sommeilMs;
+    etat.correctionPpm = correctionPpm;
+    etat.source = source;
+    etat.calibree = calibree;
+    return etat;
+}
+
+/**
+ * @brief Reprend l'heure au réveil : heure d'endormissement + durée du sommeil, corrigée de la dérive mesurée de la RTC.
+ */
+void BaseTemps::restaurer(const EtatBaseTemps &etat, uint32_t dureeSommeilMs, unsigned long t)
+{
+    correctionPpm = borner(etat.correctionPpm, config.correctionSommeilMaxPpm);
+    calibree = etat.calibree;
+    dernierRenduMs = 0;
+    if (etat.source == TEMPS_AUCUN || etat.source > TEMPS_GNSS || etat.epochMs < EPOCH_MIN_MS)
+    {
+        source = TEMPS_AUCUN;
+        return;
+    }
+    source = TEMPS_SOMMEIL;
+    ancreEpochMs = etat.epochMs + dureeSommeilMs + (int64_t)dureeSommeilMs * correctionPpm / 1000000;
+    ancreMillis = t;
+    incertitudeAncreMs = etat.incertitudeMs;
+    sommeilMs = etat.sommeilMs + dureeSommeilMs;
+}
+
+/**
+ * @brief Heure UTC courante : l'horloge si elle est assez précise, sinon l'heure réseau (AT+CCLK?), qui la recale.
+ * @return ms depuis le 01/01/1970, 0 si aucune heure n'est disponible.
+ */
+int64_t horodatageCourantMs()
+{
+    if (baseTemps.estPrecise(millis()))
+    {
+        baseTemps.stats.nbRequetesEvitees++;
+        return baseTemps.maintenantMs(millis());
+    }
+    baseTemps.stats.nbRequetesCclk++;
+    int64_t reseau = epochDepuisCCLK(Send_AT("AT+CCLK?", 1000).c_str());
+    if (reseau != 0)
+    {
+        baseTemps.synchroniser(reseau, millis(), TEMPS_RESEAU);
+        return reseau;
+    }
+    return baseTemps.maintenantMs(millis());
+}
+
+void afficherStatsBaseTemps()
+{
+    const StatsBaseTemps &s = baseTemps.stats;
+    static const char *NOMS_SOURCES[] = {"aucune", "sommeil", "reseau", "gnss"};
+    Serial.println("[TEMPS] source : " + String(NOMS_SOURCES[baseTemps.sourceCourante()]) +
+                   ", incertitude (ms) : " + (baseTemps.estSynchronisee() ? String(baseTemps.incertitudeMs(millis())) : String("-")) +
+                   ", derive RTC (ppm) : " + String(baseTemps.correctionSommeilPpm()));
+    Serial.println("[TEMPS] synchro GNSS / reseau : " + String(s.nbSynchroGnss) + " / " + String(s.nbSynchroReseau) +
+                   ", ignorees : " + String(s.nbIgnorees) + ", rejets : " + String(s.nbRejets) +
+                   ", ecart max (ms) : " + String(s.ecartMaxMs));
+    Serial.println("[TEMPS] AT+CCLK? : " + String(s.nbRequetesCclk) + ", evitees : " + String(s.nbRequetesEvitees) +
+                   ", calibrations RTC : " + String(s.nbCalibrations));
+}
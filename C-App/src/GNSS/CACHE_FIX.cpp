@@ -0,0 +1,117 @@
+/**
+ * @file CACHE_FIX.cpp
+ * @brief Cache de la dernière réponse AT+CGNSINF et rejet des fixes d'une époque GNSS déjà lue.
+ *
+ * En mode sondage, GNSS_INFO lisait AT+CGNSINF puis getGNSSValid() relisait aussitôt la même époque du récepteur :
+ * deux transactions UART pour un seul fix. Et comme le récepteur garde son dernier fix tant qu'il n'en calcule pas
+ * de nouveau, deux lectures à 3 s d'intervalle peuvent rendre le même horodatage UTC : le même point entrait deux fois
+ * dans dataGNSS.
+ *
+ * - lire() renvoie la réponse en mémoire si elle a moins de dureeEpoqueMs (une époque à 1 Hz), sinon interroge le modem.
+ * - nouvelleEpoque() compare l'horodatage UTC du fix (clé du cache) au dernier fix retenu : un doublon est écarté
+ *   avant l'acceptation (ACCEPTATION_FIX) et le tampon, en mode sondage comme en mode flux.
+ *
+ * Les requêtes évitées et les doublons écartés sont comptés et affichés en fin de cycle.
+ */
+
+#include "CACHE_FIX.hpp"
+#include "SIM7080G_SERIAL.hpp"
+
+CacheFix cacheFix; ///< Dernière réponse AT+CGNSINF, partagée par STEP_GNSS et getGnssResponse().
+
+/**
+ * @brief Extrait l'horodatage UTC (3e champ) d'une réponse "+CGNSINF: run,fix,yyyyMMddhhmmss.sss,..." sans allocation.
+ * @return false si le préfixe ou l'horodatage est absent.
+ */
+bool horodatageCGNSINF(const String &reponse, char *sortie, size_t taille)
+{
+    sortie[0] = '\0';
+    const char *p = strstr(reponse.c_str(), "+CGNSINF: ");
+    if (p == nullptr)
+        return false;
+    p += 10;
+    for (int virgules = 0; virgules < 2; ++p)
+    {
+        if (*p == '\0' || *p == '\r' || *p == '\n')
+            return false;
+        if (*p == ',')
+            virgules++;
+    }
+    size_t n = 0;
+    while (p[n] != ',' && p[n] != '\0' && p[n] != '\r' && n + 1 < taille)
+    {
+        sortie[n] = p[n];
+        n++;
+    }
+    sortie[n] = '\0';
+    return n > 0;
+}
+
+CacheFix::CacheFix()
+{
+    reinitialiser();
+}
+
+void CacheFix::reinitialiser()
+{
+    stats = StatsCacheFix();
+    invalider();
+    derniereEpoque[0] = '\0';
+}
+
+// Début ou fin d'une fenêtre GNSS : la prochaine lecture interroge le modem
+void CacheFix::invalider()
+{
+    reponse = "";
+    lectureMs = 0;
+    valide = false;
+    epoqueLue[0] = '\0';
+}
+
+/**
+ * @brief Réponse à AT+CGNSINF : depuis la mémoire si elle date de la même époque, sinon du modem.
+ */
+String CacheFix::lire(unsigned long maintenant, long delai)
+{
+    // Âge compté depuis l'arrivée de la réponse (la transaction peut durer jusqu'au délai d'attente)
+    if (config.actif && valide && (long)(maintenant - lectureMs) < (long)config.dureeEpoqueMs)
+    {
+        stats.nbRequetesEvitees++;
+        return reponse;
+    }
+    stats.nbRequetes++;
+    unsigned long debut = millis();
+    reponse = Send_AT("AT+CGNSINF", delai);
+    lectureMs = maintenant + (millis() - debut);
+    valide = true;
+    horodatageCGNSINF(reponse, epoqueLue, sizeof(epoqueLue));
+    return reponse;
+}
+
+/**
+ * @brief Retient l'époque d'un fix valide.
+ * @return false si le fix porte l'horodatage du dernier fix retenu (doublon) ; un fix sans horodatage est toujours nouveau.
+ */
+bool CacheFix::nouvelleEpoque(const String &horodatage)
+{
+    if (horodatage.length() == 0)
+        return true;
+    if (config.actif && strcmp(horodatage.c_str(), derniereEpoque) == 0)
+    {
+        stats.nbDoublons++;
+        return false;
+    }
+    strncpy(derniereEpoque, horodatage.c_str(), sizeof(derniereEpoque) - 1);
+    derniereEpoque[sizeof(derniereEpoque) - 1] = '\0';
+    stats.nbEpoques++;
+    return true;
+}
+
+void afficherStatsCacheFix()
+{
+    const StatsCacheFix &s = cacheFix.stats;
+    if (s.nbRequetes == 0 && s.nbDoublons == 0)
+        return;
+    Serial.println("[CACHE FIX] AT+CGNSINF : " + String(s.nbRequetes) + ", evitees : " + String(s.nbRequetesEvitees) +
+                   " / epoques : " + String(s.nbEpoques) + ", doublons ecartes : " + String(s.nbDoublons));
+}
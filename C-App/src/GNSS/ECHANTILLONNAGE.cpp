@@ -0,0 +1,301 @@
+/**
+ * @file ECHANTILLONNAGE.cpp
+ * @brief Échantillonnage GNSS adapté au mouvement : arrêt / déplacement avec hystérésis.
+ *
+ * Historiquement, un fix est pris toutes les 3 s jusqu'à MAX_COORDS, que l'objet roule ou soit garé :
+ * un objet immobile envoie 10 points identiques à chaque cycle.
+ *
+ * L'échantillonneur s'appuie sur la vitesse, le cap et le HDOP fournis par CGNSINF / +UGNSINF :
+ * - Arrêt : vitesse sous seuilArret et position dans rayonArretM pendant confirmationArretMs.
+ *   Un seul point "toujours là" (heartbeat) est gardé par cycle, puis l'acquisition s'arrête (GNSS éteint plus tôt).
+ * - Départ : vitesse au-dessus de seuilDepart sur plusieurs échantillons, ou sortie du rayon d'arrêt.
+ *   Les deux seuils différents forment l'hystérésis qui évite d'osciller autour d'une vitesse faible.
+ * - Déplacement : l'intervalle est calculé pour espacer les points d'environ distanceCibleM
+ *   (borné entre intervalleMinMs et intervalleMaxMs) et un virage est gardé immédiatement.
+ * Un échantillon dont le HDOP dépasse hdopMaxDixiemes ne fait jamais changer d'état.
+ *
+ * simulerEchantillonnage() rejoue une trace à 1 Hz avec et sans échantillonneur et rapporte
+ * les fixes, octets et temps GNSS économisés, ainsi que l'erreur de position de la trajectoire envoyée.
+ */
+
+#include "ECHANTILLONNAGE.hpp"
+
+EchantillonneurAdaptatif echantillonneur; ///< Échantillonneur utilisé par STEP_GNSS.
+
+// "12.34" -> 123 ; "" -> -1
+static int16_t texteEnDixiemes(const String &texte)
+{
+    if (texte.length() == 0)
+        return -1;
+    long entier = texte.toInt();
+    int point = texte.indexOf('.');
+    int decimale = (point != -1 && point + 1 < (int)texte.length() && texte[point + 1] >= '0' && texte[point + 1] <= '9') ? texte[point + 1] - '0' : 0;
+    return (int16_t)(entier * 10 + decimale);
+}
+
+/**
+ * @brief Construit un échantillon à partir d'un fix (mode sondage ou flux).
+ */
+Echantillon echantillonDepuisGnss(const Gnss &gnss, unsigned long tMs)
+{
+    Echantillon e;
+    e.latE6 = degresVersE6(gnss.coordonnees.latitude.full);
+    e.lonE6 = degresVersE6(gnss.coordonnees.longitude.full);
+    e.vitesseDixiemes = texteEnDixiemes(gnss.vitesse);
+    int16_t cap = texteEnDixiemes(gnss.cap);
+    e.capDegres = cap < 0 ? -1 : cap / 10;
+    e.hdopDixiemes = texteEnDixiemes(gnss.hdop.full);
+    e.satellites = gnss.satellites.length() > 0 ? (int8_t)gnss.satellites.toInt() : -1;
+    e.cn0 = gnss.cn0.length() > 0 ? (int8_t)gnss.cn0.toInt() : -1;
+    e.tMs = tMs;
+    return e;
+}
+
+EchantillonneurAdaptatif::EchantillonneurAdaptatif()
+{
+    reinitialiser();
+}
+
+void EchantillonneurAdaptatif::reinitialiser()
+{
+    stats = StatsEchantillonnage();
+    etatCourant = MOUVEMENT_INCONNU;
+    ancre = Echantillon();
+    dernier = Echantillon();
+    dernierGarde = Echantillon();
+    candidatArret = false;
+    nbRapides = 0;
+    vitesseCourante = -1;
+    debutCycle();
+}
+
+/**
+ * @brief Nouveau cycle d'acquisition : le premier point est toujours gardé, un heartbeat peut être émis.
+ */
+void EchantillonneurAdaptatif::debutCycle()
+{
+    premierDuCycle = true;
+    heartbeatEmis = false;
+    nbRapides = 0;
+}
+
+// Vitesse du fix, ou estimée à partir du déplacement depuis l'échantillon précédent
+int16_t EchantillonneurAdaptatif::vitesseEstimee(const Echantillon &e) const
+{
+    if (e.vitesseDixiemes >= 0)
+        return e.vitesseDixiemes;
+    if (dernier.latE6 == COORD_INVALIDE || e.tMs <= dernier.tMs)
+        return -1;
+    // mm/ms = m/s ; km/h x 10 = m/s x 36
+    uint32_t mm = distanceMm(dernier.latE6, dernier.lonE6, e.latE6, e.lonE6);
+    uint32_t vitesse = mm * 36 / (e.tMs - dernier.tMs);
+    return (int16_t)(vitesse > 32767 ? 32767 : vitesse);
+}
+
+DecisionEchantillon EchantillonneurAdaptatif::garder(const Echantillon &e, DecisionEchantillon decision)
+{
+    dernierGarde = e;
+    premierDuCycle = false;
+    if (decision == ECHANTILLON_HEARTBEAT)
+    {
+        heartbeatEmis = true;
+        stats.nbHeartbeats++;
+    }
+    else
+        stats.nbGardes++;
+    return decision;
+}
+
+/**
+ * @brief Décide si un fix doit être gardé, et met à jour l'état arrêt / déplacement.
+ */
+DecisionEchantillon EchantillonneurAdaptatif::evaluer(const Echantillon &e)
+{
+    stats.nbEvalues++;
+    if (!config.actif)
+        return garder(e, ECHANTILLON_GARDE);
+    if (e.latE6 == COORD_INVALIDE || e.lonE6 == COORD_INVALIDE)
+    {
+        stats.nbIgnores++;
+        return ECHANTILLON_IGNORE;
+    }
+
+    int16_t v = vitesseEstimee(e);
+    vitesseCourante = v;
+    bool fiable = e.hdopDixiemes < 0 || e.hdopDixiemes <= config.hdopMaxDixiemes;
+    dernier = e;
+
+    if (etatCourant == MOUVEMENT_ARRET)
+    {
+        bool horsRayon = fiable && distanceM(ancre.latE6, ancre.lonE6, e.latE6, e.lonE6) > config.rayonArretM;
+        nbRapides = (fiable && v > config.seuilDepartDixiemes) ? nbRapides + 1 : 0;
+        if (horsRayon || nbRapides >= config.confirmationsDepart)
+        {
+            etatCourant = MOUVEMENT_DEPLACEMENT;
+            candidatArret = false;
+            nbRapides = 0;
+            stats.nbDeparts++;
+            return garder(e, ECHANTILLON_GARDE);
+        }
+        // Un départ en cours de confirmation retarde le heartbeat (et donc l'arrêt du GNSS)
+        if (!heartbeatEmis && nbRapides == 0)
+            return garder(e, ECHANTILLON_HEARTBEAT);
+        stats.nbIgnores++;
+        return ECHANTILLON_IGNORE;
+    }
+
+    // Déplacement (ou état inconnu) : recherche d'un arrêt
+    if (fiable && v >= 0 && v < config.seuilArretDixiemes)
+    {
+        if (!candidatArret || distanceM(ancre.latE6, ancre.lonE6, e.latE6, e.lonE6) > config.rayonArretM)
+        {
+            candidatArret = true;
+            ancre = e;
+        }
+        else if (e.tMs - ancre.tMs >= config.confirmationArretMs)
+        {
+            etatCourant = MOUVEMENT_ARRET;
+            stats.nbArrets++;
+            return garder(e, ECHANTILLON_HEARTBEAT);
+        }
+    }
+    else if (fiable)
+        candidatArret = false;
+
+    if (etatCourant == MOUVEMENT_INCONNU && !candidatArret && fiable)
+        etatCourant = MOUVEMENT_DEPLACEMENT;
+
+    bool garde = premierDuCycle || dernierGarde.latE6 == COORD_INVALIDE ||
+                 (e.tMs - dernierGarde.tMs) + 100 >= intervalleMs() ||
+                 distanceM(dernierGarde.latE6, dernierGarde.lonE6, e.latE6, e.lonE6) >= config.distanceCibleM;
+    if (!garde && e.capDegres >= 0 && dernierGarde.capDegres >= 0 && v > config.seuilDepartDixiemes)
+        garde = ecartCapDegres(e.capDegres, dernierGarde.capDegres) >= config.seuilVirageDegres;
+    if (garde)
+        return garder(e, ECHANTILLON_GARDE);
+    stats.nbIgnores++;
+    return ECHANTILLON_IGNORE;
+}
+
+/**
+ * @brief Intervalle d'échantillonnage adapté à la vitesse courante.
+ */
+unsigned long EchantillonneurAdaptatif::intervalleMs() const
+{
+    if (!config.actif || vitesseCourante <= 0 || etatCourant == MOUVEMENT_ARRET)
+        return config.intervalleMaxMs;
+    // distance (m) / vitesse (km/h x 10) -> ms : d * 36000 / v
+    unsigned long intervalle = (unsigned long)config.distanceCibleM * 36000UL / (unsigned long)vitesseCourante;
+    if (intervalle < config.intervalleMinMs)
+        return config.intervalleMinMs;
+    if (intervalle > config.intervalleMaxMs)
+        return config.intervalleMaxMs;
+    return intervalle;
+}
+
+/**
+ * @brief Vrai quand l'objet est à l'arrêt et que le heartbeat du cycle a été émis : le GNSS peut être éteint.
+ */
+bool EchantillonneurAdaptatif::acquisitionTerminee() const
+{
+    return config.actif && etatCourant == MOUVEMENT_ARRET && heartbeatEmis;
+}
+
+// Position reconstruite à l'instant t à partir des points gardés (interpolation linéaire, maintien aux extrémités)
+static void reconstruire(const Echantillon *points, int n, unsigned long t, int32_t &lat, int32_t &lon)
+{
+    int i = 0;
+    while (i < n && points[i].tMs <= t)
+        i++;
+    if (i == 0 || i == n || points[i].tMs == points[i - 1].tMs)
+    {
+        const Echantillon &p = (i == 0) ? points[0] : points[i - 1];
+        lat = p.latE6;
+        lon = p.lonE6;
+        return;
+    }
+    const Echantillon &a = points[i - 1];
+    const Echantillon &b = points[i];
+    int64_t num = (int64_t)(t - a.tMs);
+    int64_t den = (int64_t)(b.tMs - a.tMs);
+    lat = a.latE6 + (int32_t)(((int64_t)b.latE6 - a.latE6) * num / den);
+    lon = a.lonE6 + (int32_t)(((int64_t)b.lonE6 - a.lonE6) * num / den);
+}
+
+/**
+ * @brief Rejoue une trace cycle par cycle, avec l'échantillonnage historique et avec l'échantillonneur adaptatif.
+ *
+ * Référence : pointsParCycle fixes espacés de intervalleBaseMs après le TTFF.
+ * Adaptatif : la trace est lue à 1 Hz (mode flux) jusqu'à pointsParCycle points gardés ou la fin de l'acquisition.
+ * L'erreur est mesurée sur chaque point de référence couvert par la trajectoire adaptative du cycle
+ * (ou sur tout le cycle quand l'objet est déclaré à l'arrêt).
+ *
+ * @param source Fonction donnant la position à un instant (ms) de la trace.
+ */
+RapportEchantillonnage simulerEchantillonnage(SourceTrace source, const ScenarioTrace &scenario, const ConfigEchantillonnage &config)
+{
+    RapportEchantillonnage rapport;
+    EchantillonneurAdaptatif ech;
+    ech.config = config;
+    uint64_t sommeErreur = 0;
+    uint32_t nbErreurs = 0;
+    const int capacite = MAX_COORDS;
+    int parCycle = scenario.pointsParCycle > capacite ? capacite : scenario.pointsParCycle;
+
+    for (unsigned long debut = 0; debut + scenario.ttffMs < scenario.dureeMs; debut += scenario.periodeCycleMs)
+    {
+        unsigned long t0 = debut + scenario.ttffMs;
+
+        // Adaptatif : flux à 1 Hz
+        Echantillon gardes[capacite];
+        int nbGardes = 0;
+        unsigned long t = t0;
+        ech.debutCycle();
+        while (t < debut + scenario.periodeCycleMs && t < scenario.dureeMs)
+        {
+            Echantillon e = source(t);
+            e.tMs = t;
+            if (ech.evaluer(e) != ECHANTILLON_IGNORE)
+                gardes[nbGardes++] = e;
+            if (nbGardes >= parCycle || ech.acquisitionTerminee())
+                break;
+            t += 1000;
+        }
+        rapport.fixesAdaptatif += nbGardes;
+        rapport.gnssAdaptatifMs += t - debut;
+        bool arret = ech.etat() == MOUVEMENT_ARRET;
+
+        // Référence et erreur de la trajectoire adaptative
+        for (int i = 0; i < parCycle; ++i)
+        {
+            unsigned long tr = t0 + i * scenario.intervalleBaseMs;
+            if (tr >= scenario.dureeMs)
+                break;
+            rapport.fixesReference++;
+            rapport.gnssReferenceMs = rapport.gnssReferenceMs + (i == 0 ? scenario.ttffMs : scenario.intervalleBaseMs);
+            if (nbGardes == 0 || (!arret && (tr < gardes[0].tMs || tr > gardes[nbGardes - 1].tMs)))
+                continue;
+            Echantillon vrai = source(tr);
+            int32_t lat, lon;
+            reconstruire(gardes, nbGardes, tr, lat, lon);
+            uint32_t erreur = distanceM(vrai.latE6, vrai.lonE6, lat, lon);
+            if (erreur > rapport.erreurMaxM)
+                rapport.erreurMaxM = erreur;
+            sommeErreur += erreur;
+            nbErreurs++;
+        }
+    }
+
+    if (rapport.fixesReference > rapport.fixesAdaptatif)
+        rapport.octetsEconomises = (rapport.fixesReference - rapport.fixesAdaptatif) * scenario.octetsParPoint;
+    if (nbErreurs > 0)
+        rapport.erreurMoyenneM = (uint32_t)(sommeErreur / nbErreurs);
+    return rapport;
+}
+
+void afficherRapportEchantillonnage(const RapportEchantillonnage &rapport)
+{
+    Serial.println("[ECHANTILLONNAGE] fixes : " + String(rapport.fixesAdaptatif) + " / " + String(rapport.fixesReference));
+    Serial.println("[ECHANTILLONNAGE] octets economises : " + String(rapport.octetsEconomises));
+    Serial.println("[ECHANTILLONNAGE] GNSS allume (ms) : " + String(rapport.gnssAdaptatifMs) + " / " + String(rapport.gnssReferenceMs));
+    Serial.println("[ECHANTILLONNAGE] erreur max / moyenne (m) : " + String(rapport.erreurMaxM) + " / " + String(rapport.erreurMoyenneM));
+}
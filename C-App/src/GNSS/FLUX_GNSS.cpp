@@ -0,0 +1,386 @@
+/**
+ * @file FLUX_GNSS.cpp
+ * @brief Acquisition GNSS en flux : URC +UGNSINF (AT+CGNSURC) ou phrases NMEA, parsées au fil de l'eau.
+ *
+ * En mode sondage, chaque échantillon coûte plusieurs allers-retours AT bloquants (AT+CGNSPWR?, AT+CGNSINF...)
+ * et le pipeline n'échantillonne qu'une fois toutes les 3 s.
+ *
+ * En mode flux, le modem envoie de lui-même une URC de navigation à chaque fix (AT+CGNSURC=1, soit 1 Hz).
+ * Le parseur incrémental ParseurFluxGnss consomme les octets reçus sur l'UART un par un, sans allocation,
+ * et chaque ligne complète (+UGNSINF ou $xxRMC) devient un fix poussé directement dans le tableau dataGNSS.
+ * Aucune commande n'est envoyée pendant l'acquisition. Les autres URC lues au passage (+CEREG, +SMSUB...) sont
+ * remises à leur destinataire par AIGUILLAGE_URC.
+ *
+ * Les deux modes sont comptabilisés (octets UART, transactions AT, fixes, durée) pour être comparés :
+ * échantillons par seconde et octets UART par fix.
+ */
+
+#include "FLUX_GNSS.hpp"
+#include "GnssUtils.hpp"
+#include "ASSISTANCE_GNSS.hpp"
+#include "ECHANTILLONNAGE.hpp"
+#include "ACCEPTATION_FIX.hpp"
+#include "TAMPON_GNSS.hpp"
+#include "ENERGIE.hpp"
+#include "CACHE_FIX.hpp"
+#include "AIGUILLAGE_URC.hpp"
+
+FluxGnss fluxGnss;               ///< Configuration et statistiques du mode d'acquisition.
+ParseurFluxGnss parseurFluxGnss; ///< Parseur du flux reçu sur l'UART du modem.
+
+// Découpe une ligne en champs séparés par des virgules (en place, champs vides conservés)
+static int decouper(char *texte, char **champs, int maxChamps)
+{
+    int n = 0;
+    champs[n++] = texte;
+    for (char *p = texte; *p && n < maxChamps; ++p)
+    {
+        if (*p == ',')
+        {
+            *p = '\0';
+            champs[n++] = p + 1;
+        }
+    }
+    return n;
+}
+
+// "1.27" -> 12 ; "" -> -1
+static int16_t dixiemes(const char *valeur)
+{
+    if (!valeur || !*valeur)
+        return -1;
+    long entier = atol(valeur);
+    const char *point = strchr(valeur, '.');
+    int decimale = (point && point[1] >= '0' && point[1] <= '9') ? point[1] - '0' : 0;
+    return (int16_t)(entier * 10 + decimale);
+}
+
+static int hexa(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+static void copier(char *destination, size_t taille, const char *source)
+{
+    strncpy(destination, source, taille - 1);
+    destination[taille - 1] = '\0';
+}
+
+/**
+ * @brief Convertit une coordonnée NMEA (ddmm.mmmm / dddmm.mmmm) en degrés décimaux, en arithmétique entière.
+ * @param valeur Champ NMEA, ex : "5038.06472".
+ * @param hemisphere 'N', 'S', 'E' ou 'W'.
+ * @param sortie Texte produit, ex : "50.634412".
+ * @return false si le champ est vide ou invalide.
+ */
+bool convertirNmeaEnDegres(const char *valeur, char hemisphere, char *sortie, size_t taille)
+{
+    const char *point = strchr(valeur, '.');
+    if (!*valeur || !point || point - valeur < 3)
+        return false;
+
+    long dddmm = atol(valeur);
+    long degres = dddmm / 100;
+    long minutes = dddmm % 100;
+
+    // Fraction des minutes sur 5 chiffres (1e-5 minute)
+    long fraction = 0;
+    int chiffres = 0;
+    for (const char *p = point + 1; *p >= '0' && *p <= '9' && chiffres < 5; ++p, ++chiffres)
+        fraction = fraction * 10 + (*p - '0');
+    for (; chiffres < 5; ++chiffres)
+        fraction *= 10;
+
+    // micro-degrés = minutes (1e-5) * 10 / 60, arrondi
+    long minutesE5 = minutes * 100000L + fraction;
+    long microDegres = degres * 1000000L + (minutesE5 * 10 + 30) / 60;
+    bool negatif = (hemisphere == 'S' || hemisphere == 'W');
+    snprintf(sortie, taille, "%s%ld.%06ld", negatif ? "-" : "", microDegres / 1000000L, microDegres % 1000000L);
+    return true;
+}
+
+ParseurFluxGnss::ParseurFluxGnss()
+{
+    reinitialiser();
+}
+
+void ParseurFluxGnss::reinitialiser()
+{
+    longueur = 0;
+    debordement = false;
+    nbLignes = 0;
+    nbPhrasesGnss = 0;
+    nbErreursChecksum = 0;
+    nbLignesTropLongues = 0;
+    dernierFix = FixFlux();
+}
+
+/**
+ * @brief Consomme un octet du flux.
+ * @return true si l'octet termine une ligne qui contenait un fix valide (disponible via fix()).
+ */
+bool ParseurFluxGnss::consommer(char c)
+{
+    if (c == '\r')
+        return false;
+    if (c != '\n')
+    {
+        if (longueur < TAILLE_LIGNE_FLUX - 1)
+            ligne[longueur++] = c;
+        else
+            debordement = true;
+        return false;
+    }
+
+    bool fixProduit = false;
+    if (debordement)
+        nbLignesTropLongues++;
+    else if (longueur > 0)
+    {
+        ligne[longueur] = '\0';
+        fixProduit = traiterLigne();
+    }
+    longueur = 0;
+    debordement = false;
+    return fixProduit;
+}
+
+bool ParseurFluxGnss::traiterLigne()
+{
+    nbLignes++;
+    if (strncmp(ligne, "+UGNSINF:", 9) == 0)
+    {
+        nbPhrasesGnss++;
+        char *champs = ligne + 9;
+        while (*champs == ' ')
+            champs++;
+        return traiterUGNSINF(champs);
+    }
+
+    if (ligne[0] != '$')
+        return false; // autre URC ou écho : ignoré
+
+    // Vérification du checksum NMEA : XOR des caractères entre '$' et '*'
+    char *etoile = strchr(ligne, '*');
+    if (!etoile || hexa(etoile[1]) < 0 || hexa(etoile[2]) < 0)
+    {
+        nbErreursChecksum++;
+        return false;
+    }
+    uint8_t somme = 0;
+    for (char *p = ligne + 1; p < etoile; ++p)
+        somme ^= (uint8_t)*p;
+    if (somme != (uint8_t)(hexa(etoile[1]) * 16 + hexa(etoile[2])))
+    {
+        nbErreursChecksum++;
+        return false;
+    }
+    *etoile = '\0';
+    nbPhrasesGnss++;
+
+    if (strlen(ligne) > 6 && strncmp(ligne + 3, "RMC,", 4) == 0)
+        return traiterRMC(ligne + 1);
+    return false;
+}
+
+// +UGNSINF: <run>,<fix>,<UTC>,<lat>,<lon>,<alt>,<vitesse>,<cap>,<mode>,,<HDOP>,<PDOP>,<VDOP>,,<vus>,<utilisés>,...
+bool ParseurFluxGnss::traiterUGNSINF(char *texte)
+{
+    char *champs[21];
+    int n = decouper(texte, champs, 21);
+    if (n < 16 || strcmp(champs[1], "1") != 0 || !*champs[3] || !*champs[4])
+        return false;
+
+    FixFlux fix;
+    copier(fix.horodatage, sizeof(fix.horodatage), champs[2]);
+    copier(fix.latitude, sizeof(fix.latitude), champs[3]);
+    copier(fix.longitude, sizeof(fix.longitude), champs[4]);
+    fix.vitesseKmhDixiemes = dixiemes(champs[6]);
+    fix.capDegres = *champs[7] ? (int16_t)atoi(champs[7]) : -1;
+    fix.hdopDixiemes = dixiemes(champs[10]);
+    fix.satellites = *champs[15] ? (int8_t)atoi(champs[15]) : -1;
+    fix.cn0 = (n > 18 && *champs[18]) ? (int8_t)atoi(champs[18]) : -1;
+    fix.valide = true;
+    dernierFix = fix;
+    return true;
+}
+
+// xxRMC,<hhmmss.ss>,<A|V>,<ddmm.mmmm>,<N|S>,<dddmm.mmmm>,<E|W>,<noeuds>,<cap>,<ddmmyy>,...
+bool ParseurFluxGnss::traiterRMC(char *texte)
+{
+    char *champs[13];
+    int n = decouper(texte, champs, 13);
+    if (n < 10 || champs[2][0] != 'A' || strlen(champs[1]) < 6 || strlen(champs[9]) != 6)
+        return false;
+
+    FixFlux fix;
+    if (!convertirNmeaEnDegres(champs[3], champs[4][0], fix.latitude, sizeof(fix.latitude)) ||
+        !convertirNmeaEnDegres(champs[5], champs[6][0], fix.longitude, sizeof(fix.longitude)))
+        return false;
+
+    // ddmmyy + hhmmss.ss -> yyyyMMddhhmmss.sss
+    const char *date = champs[9];
+    const char *heure = champs[1];
+    char millisecondes[4] = "000";
+    const char *point = strchr(heure, '.');
+    for (int i = 0; point && i < 3 && point[1 + i] >= '0' && point[1 + i] <= '9'; ++i)
+        millisecondes[i] = point[1 + i];
+    snprintf(fix.horodatage, sizeof(fix.horodatage), "20%.2s%.2s%.2s%.6s.%s", date + 4, date + 2, date, heure, millisecondes);
+
+    int16_t noeuds = dixiemes(champs[7]);
+    fix.vitesseKmhDixiemes = noeuds < 0 ? -1 : (int16_t)((long)noeuds * 1852 / 1000);
+    fix.capDegres = *champs[8] ? (int16_t)atoi(champs[8]) : -1;
+    fix.valide = true;
+    dernierFix = fix;
+    return true;
+}
+
+/**
+ * @brief Convertit un fix du flux dans la structure Gnss utilisée par le reste du pipeline.
+ */
+Gnss gnssDepuisFix(const FixFlux &fix)
+{
+    Gnss gnss;
+    gnss.runStatus = "1";
+    gnss.fixStatus = "1";
+    gnss.timeStamp = fix.horodatage;
+    gnss.coordonnees.latitude.full = fix.latitude;
+    gnss.coordonnees.latitude.ent = gnss.coordonnees.latitude.full.toInt();
+    gnss.coordonnees.latitude.dec = gnss.coordonnees.latitude.full.substring(gnss.coordonnees.latitude.full.indexOf('.') + 1);
+    gnss.coordonnees.longitude.full = fix.longitude;
+    gnss.coordonnees.longitude.ent = gnss.coordonnees.longitude.full.toInt();
+    gnss.coordonnees.longitude.dec = gnss.coordonnees.longitude.full.substring(gnss.coordonnees.longitude.full.indexOf('.') + 1);
+    if (fix.vitesseKmhDixiemes >= 0)
+        gnss.vitesse = String(fix.vitesseKmhDixiemes / 10) + "." + String(fix.vitesseKmhDixiemes % 10);
+    if (fix.capDegres >= 0)
+        gnss.cap = String(fix.capDegres);
+    if (fix.satellites >= 0)
+        gnss.satellites = String(fix.satellites);
+    if (fix.cn0 >= 0)
+        gnss.cn0 = String(fix.cn0);
+    if (fix.hdopDixiemes >= 0)
+    {
+        gnss.hdop.ent = fix.hdopDixiemes / 10;
+        gnss.hdop.dec = String(fix.hdopDixiemes % 10);
+        gnss.hdop.full = String(gnss.hdop.ent) + "." + gnss.hdop.dec;
+    }
+    gnss.isValid = fix.valide;
+    return gnss;
+}
+
+/**
+ * @brief Active l'URC de navigation (une URC tous les periodeUrc fixes).
+ * @return false si le modem refuse : l'acquisition repasse alors en mode sondage.
+ */
+bool activerFluxGnss()
+{
+    uint32_t octetsAvant = octetsUartEmis + octetsUartRecus;
+    String reponse = Send_AT("AT+CGNSURC=" + String(fluxGnss.periodeUrc), 1000);
+    fluxGnss.statsFlux.octets += octetsUartEmis + octetsUartRecus - octetsAvant;
+    fluxGnss.statsFlux.transactions++;
+    fluxGnss.actif = reponse.indexOf("OK") != -1;
+    fluxGnss.premierFix = true;
+    if (!fluxGnss.actif)
+    {
+        Serial.println("[GNSS] CGNSURC refuse : retour au sondage");
+        fluxGnss.mode = GNSS_MODE_SONDAGE;
+    }
+    return fluxGnss.actif;
+}
+
+void desactiverFluxGnss()
+{
+    if (!fluxGnss.actif)
+        return;
+    Send_AT("AT+CGNSURC=0", 1000);
+    fluxGnss.statsFlux.transactions++;
+    fluxGnss.actif = false;
+}
+
+/**
+ * @brief Passe un bloc d'octets reçus au parseur et range chaque fix valide dans dataGNSS.
+ * @return Le nombre de fixes ajoutés.
+ */
+int traiterFluxGnss(const char *donnees, size_t taille, unsigned long maintenant)
+{
+    int ajoutes = 0;
+    fluxGnss.statsFlux.octets += taille;
+    for (size_t i = 0; i < taille; ++i)
+    {
+        if (!parseurFluxGnss.consommer(donnees[i]) || tamponGnss.plein(nbCoordonnees))
+            continue;
+        if (!fluxGnss.premierFix && (maintenant - fluxGnss.dernierFixMs) < fluxGnss.intervalleFixMs)
+            continue;
+        Gnss gnss = gnssDepuisFix(parseurFluxGnss.fix());
+        if (!cacheFix.nouvelleEpoque(gnss.timeStamp) || !accepterFix(gnss, maintenant))
+            continue;
+        if (echantillonneur.evaluer(echantillonDepuisGnss(gnss, maintenant)) == ECHANTILLON_IGNORE)
+            continue;
+        fluxGnss.premierFix = false;
+        fluxGnss.dernierFixMs = maintenant;
+        addGNSSInDataGNSS(gnss);
+        energie.enregistrerFix();
+        enregistrerFixAcquisition(maintenant);
+        fluxGnss.statsFlux.nbFix++;
+        ajoutes++;
+    }
+    return ajoutes;
+}
+
+/**
+ * @brief Lit tout ce que le modem a envoyé depuis le dernier passage et le traite.
+ */
+int pomperFluxGnss(unsigned long maintenant)
+{
+    char tampon[64];
+    int ajoutes = 0;
+    while (Sim7080G.available())
+    {
+        size_t n = 0;
+        while (n < sizeof(tampon) && Sim7080G.available())
+            tampon[n++] = (char)Sim7080G.read();
+        ajoutes += traiterFluxGnss(tampon, n, maintenant);
+        aiguillageUrc.traiter(tampon, n, maintenant); // URC (+CEREG, +APP PDP, +SMSUB) mêlées au flux
+    }
+    return ajoutes;
+}
+
+void debutInfoGnss(unsigned long maintenant)
+{
+    fluxGnss.debutInfoMs = maintenant;
+}
+
+void finInfoGnss(unsigned long maintenant)
+{
+    StatsModeGnss &stats = (fluxGnss.mode == GNSS_MODE_FLUX) ? fluxGnss.statsFlux : fluxGnss.statsSondage;
+    stats.dureeMs += maintenant - fluxGnss.debutInfoMs;
+}
+
+float echantillonsParSeconde(const StatsModeGnss &stats)
+{
+    return stats.dureeMs > 0 ? stats.nbFix * 1000.0f / stats.dureeMs : 0;
+}
+
+float octetsParFix(const StatsModeGnss &stats)
+{
+    return stats.nbFix > 0 ? (float)stats.octets / stats.nbFix : 0;
+}
+
+void afficherStatsFluxGnss()
+{
+    const StatsModeGnss *modes[2] = {&fluxGnss.statsSondage, &fluxGnss.statsFlux};
+    const char *noms[2] = {"sondage", "flux"};
+    for (int i = 0; i < 2; ++i)
+    {
+        if (modes[i]->nbFix == 0)
+            continue;
+        Serial.println("[GNSS] " + String(noms[i]) + " : " + String(echantillonsParSeconde(*modes[i]), 2) + " ech/s, " +
+                       String(octetsParFix(*modes[i]), 1) + " octets/fix, " + String(modes[i]->transactions) + " transactions AT");
+    }
+}
@@ -0,0 +1,191 @@
+/**
+ * @file GEODESIE.cpp
+ * @brief Calculs de distance entre coordonnées GNSS en arithmétique entière.
+ *
+ * Les coordonnées sont manipulées en micro-degrés (int32_t) : "50.634412" devient 50634412.
+ * Les distances utilisent une projection équirectangulaire locale (plan tangent), avec un cosinus
+ * tabulé en Q15 : l'erreur reste inférieure au mètre pour des points distants de quelques kilomètres,
+ * ce qui suffit pour comparer des fixes successifs. Aucun calcul flottant n'est fait.
+ */
+
+#include "GEODESIE.hpp"
+
+#if defined(UNIT_TEST) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+// cos(d) en Q15 pour d = 0..90 degrés
+static const int16_t TABLE_COS_Q15[91] = {
+    32767, 32762, 32747, 32722, 32687, 32642, 32587, 32523, 32448, 32364, 32269, 32165, 32051, 31927, 31794, 31650,
+    31498, 31335, 31163, 30982, 30791, 30591, 30381, 30162, 29934, 29697, 29451, 29196, 28932, 28659, 28377, 28087,
+    27788, 27481, 27165, 26841, 26509, 26169, 25821, 25465, 25101, 24730, 24351, 23964, 23571, 23170, 22762, 22347,
+    21925, 21497, 21062, 20621, 20173, 19720, 19260, 18794, 18323, 17846, 17364, 16876, 16384, 15886, 15383, 14876,
+    14364, 13848, 13328, 12803, 12275, 11743, 11207, 10668, 10126, 9580, 9032, 8481, 7927, 7371, 6813, 6252,
+    5690, 5126, 4560, 3993, 3425, 2856, 2286, 1715, 1144, 572, 0};
+
+// Longueur d'un micro-degré de méridien : 111.195 mm (rayon terrestre moyen 6371 km)
+#define MM_PAR_E6_NUM 111195
+#define MM_PAR_E6_DEN 1000
+
+/**
+ * @brief Convertit un texte en degrés décimaux ("-3.048687") en micro-degrés, sans flottant.
+ * @return La valeur en micro-degrés, ou COORD_INVALIDE si le texte est vide ou invalide.
+ */
+int32_t degresVersE6(const char *texte)
+{
+    if (!texte)
+        return COORD_INVALIDE;
+    while (*texte == ' ')
+        texte++;
+    bool negatif = (*texte == '-');
+    if (*texte == '-' || *texte == '+')
+        texte++;
+    if (*texte < '0' || *texte > '9')
+        return COORD_INVALIDE;
+
+    int32_t entier = 0;
+    while (*texte >= '0' && *texte <= '9')
+        entier = entier * 10 + (*texte++ - '0');
+    int32_t fraction = 0;
+    int chiffres = 0;
+    if (*texte == '.')
+    {
+        texte++;
+        while (*texte >= '0' && *texte <= '9')
+        {
+            if (chiffres < 6)
+            {
+                fraction = fraction * 10 + (*texte - '0');
+                chiffres++;
+            }
+            texte++;
+        }
+    }
+    for (; chiffres < 6; ++chiffres)
+        fraction *= 10;
+    int32_t valeur = entier * 1000000 + fraction;
+    return negatif ? -valeur : valeur;
+}
+
+int32_t degresVersE6(const String &texte)
+{
+    return degresVersE6(texte.c_str());
+}
+
+/**
+ * @brief cos(latitude) en Q15, interpolé linéairement dans la table.
+ */
+int16_t cosQ15(int32_t latE6)
+{
+    if (latE6 < 0)
+        latE6 = -latE6;
+    if (latE6 >= 90000000)
+        return 0;
+    int32_t degre = latE6 / 1000000;
+    int32_t reste = latE6 % 1000000;
+    int32_t a = TABLE_COS_Q15[degre];
+    int32_t b = TABLE_COS_Q15[degre + 1];
+    return (int16_t)(a + (int32_t)(((int64_t)(b - a) * reste) / 1000000));
+}
+
+/**
+ * @brief Projette un point dans le plan tangent centré sur un point de référence.
+ * @param xMm Distance vers l'est (mm).
+ * @param yMm Distance vers le nord (mm).
+ */
+void projeterMm(int32_t latRefE6, int32_t lonRefE6, int32_t latE6, int32_t lonE6, int32_t &xMm, int32_t &yMm)
+{
+    int64_t dLat = (int64_t)latE6 - latRefE6;
+    int64_t dLon = (int64_t)lonE6 - lonRefE6;
+    if (dLon > 180000000)
+        dLon -= 360000000;
+    else if (dLon < -180000000)
+        dLon += 360000000;
+    int32_t cosLat = cosQ15((int32_t)(((int64_t)latRefE6 + latE6) / 2));
+    yMm = (int32_t)(dLat * MM_PAR_E6_NUM / MM_PAR_E6_DEN);
+    xMm = (int32_t)(((dLon * MM_PAR_E6_NUM / MM_PAR_E6_DEN) * cosLat) >> 15);
+}
+
+/**
+ * @brief Opération inverse de projeterMm() : point du plan tangent (mm) vers des micro-degrés.
+ *
+ * Le cosinus est pris à la latitude de référence : l'écart avec projeterMm() reste négligeable
+ * tant que le point est à quelques kilomètres de la référence.
+ */
+void deprojeterE6(int32_t latRefE6, int32_t lonRefE6, int32_t xMm, int32_t yMm, int32_t &latE6, int32_t &lonE6)
+{
+    int32_t cosLat = cosQ15(latRefE6);
+    latE6 = latRefE6 + (int32_t)((int64_t)yMm * MM_PAR_E6_DEN / MM_PAR_E6_NUM);
+    lonE6 = cosLat > 0 ? lonRefE6 + (int32_t)(((int64_t)xMm * MM_PAR_E6_DEN << 15) / ((int64_t)MM_PAR_E6_NUM * cosLat)) : lonRefE6;
+}
+
+/**
+ * @brief Micro-degrés vers texte en degrés décimaux (50634412 -> "50.634412").
+ */
+String e6VersDegres(int32_t e6)
+{
+    String signe = e6 < 0 ? "-" : "";
+    uint32_t absolu = e6 < 0 ? (uint32_t)(-(int64_t)e6) : (uint32_t)e6;
+    String fraction = String(absolu % 1000000);
+    while (fraction.length() < 6)
+        fraction = "0" + fraction;
+    return signe + String(absolu / 1000000) + "." + fraction;
+}
+
+/**
+ * @brief Racine carrée entière (méthode bit à bit).
+ */
+uint32_t racineEntiere(uint64_t valeur)
+{
+    uint64_t resultat = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > valeur)
+        bit >>= 2;
+    while (bit != 0)
+    {
+        if (valeur >= resultat + bit)
+        {
+            valeur -= resultat + bit;
+            resultat = (resultat >> 1) + bit;
+        }
+        else
+            resultat >>= 1;
+        bit >>= 2;
+    }
+    return (uint32_t)resultat;
+}
+
+uint32_t distanceMm(int32_t latAE6, int32_t lonAE6, int32_t latBE6, int32_t lonBE6)
+{
+    int32_t x, y;
+    projeterMm(latAE6, lonAE6, latBE6, lonBE6, x, y);
+    return racineEntiere((uint64_t)((int64_t)x * x) + (uint64_t)((int64_t)y * y));
+}
+
+uint32_t distanceM(int32_t latAE6, int32_t lonAE6, int32_t latBE6, int32_t lonBE6)
+{
+    return (distanceMm(latAE6, lonAE6, latBE6, lonBE6) + 500) / 1000;
+}
+
+/**
+ * @brief Écart absolu entre deux caps, ramené dans [0, 180] degrés.
+ */
+int16_t ecartCapDegres(int16_t capA, int16_t capB)
+{
+    int16_t ecart = (int16_t)abs((capA - capB) % 360);
+    return ecart > 180 ? 360 - ecart : ecart;
+}
+
+/**
+ * @brief Compteur de cycles du processeur, pour mesurer le coût des calculs (différences sur 32 bits).
+ */
+uint32_t compteurCycles()
+{
+#if !defined(UNIT_TEST)
+    return ESP.getCycleCount();
+#elif defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    return micros();
+#endif
+}
@@ -0,0 +1,442 @@
+/**
+ * @file GEOFENCE.cpp
+ * @brief Géofences embarquées : cercles et polygones, index spatial en grille, événements d'entrée / sortie.
+ *
+ * Jusqu'ici chaque fix était envoyé pour que le serveur détecte les entrées et sorties de zones.
+ * Le moteur fait ce travail sur l'ESP32 :
+ * - les zones (cercles ou polygones) arrivent par le downlink ("geofences") et sont écrites en flash,
+ * - chaque zone est rangée dans les cellules de 0.01° que couvre sa boîte englobante ; les cellules sont
+ *   réparties dans une table de hachage de NB_SEAUX_INDEX seaux. Un fix ne teste que les zones de sa cellule
+ *   (plus les rares zones trop étendues pour l'index), même avec des centaines de zones chargées,
+ * - un changement dedans / dehors produit un événement, ajouté au message envoyé au serveur avec son heure UTC
+ *   quand l'horloge est synchronisée (BASE_TEMPS).
+ *
+ * Avec l'option envoiSurEvenement, le lot n'est envoyé que s'il contient un événement, ou après
+ * periodeHeartbeatMs sans envoi ; sinon les fixes restent dans dataGNSS et l'envoi est différé.
+ * Les événements du message et l'heure du heartbeat ne sont acquittés qu'à la livraison (STEP_END) : un envoi
+ * échoué les renvoie au cycle suivant.
+ *
+ * Tous les calculs sont entiers : cercle comparé au carré du rayon dans le plan tangent (GEODESIE),
+ * polygone testé par lancer de rayon directement en micro-degrés (le test est invariant par mise à l'échelle
+ * d'un axe, la longitude n'a donc pas besoin d'être corrigée).
+ */
+
+#include "GEOFENCE.hpp"
+#include "BASE_TEMPS.hpp"
+
+#ifndef UNIT_TEST
+#include <Preferences.h>
+#endif
+
+MoteurGeofence geofences; ///< Zones chargées depuis le downlink.
+
+static int16_t cellule(int32_t e6)
+{
+    // Division arrondie vers -infini pour que les cellules négatives aient la même taille
+    return (int16_t)(e6 >= 0 ? e6 / TAILLE_CELLULE_E6 : -((-e6 + TAILLE_CELLULE_E6 - 1) / TAILLE_CELLULE_E6));
+}
+
+static uint16_t seau(int16_t latCellule, int16_t lonCellule)
+{
+    uint32_t h = (uint32_t)(uint16_t)latCellule * 73856093UL ^ (uint32_t)(uint16_t)lonCellule * 19349663UL;
+    return (uint16_t)(h & (NB_SEAUX_INDEX - 1));
+}
+
+MoteurGeofence::MoteurGeofence()
+{
+    vider();
+}
+
+void MoteurGeofence::vider()
+{
+    nb = 0;
+    nbSommets = 0;
+    nbEv = 0;
+    nbEvEnvoi = 0;
+    envoiFait = false;
+    dernierEnvoiMs = 0;
+    memset(dedans, 0, sizeof(dedans));
+    reconstruireIndex();
+}
+
+void MoteurGeofence::reconstruireIndex()
+{
+    nbEntrees = 0;
+    nbGrandes = 0;
+    for (uint16_t i = 0; i < NB_SEAUX_INDEX; ++i)
+        seaux[i] = AUCUNE_ENTREE;
+    for (uint16_t i = 0; i < nb; ++i)
+        indexer(i);
+}
+
+// Range la zone dans chaque cellule couverte par sa boîte englobante, ou dans la liste des grandes zones
+bool MoteurGeofence::indexer(uint16_t indice)
+{
+    const Geofence &g = zones[indice];
+    int16_t latMin = cellule(g.latMinE6), latMax = cellule(g.latMaxE6);
+    int16_t lonMin = cellule(g.lonMinE6), lonMax = cellule(g.lonMaxE6);
+    int32_t nbCellules = (int32_t)(latMax - latMin + 1) * (lonMax - lonMin + 1);
+    if (nbCellules > MAX_CELLULES_PAR_GEOFENCE || nbEntrees + nbCellules > MAX_ENTREES_INDEX)
+    {
+        grandes[nbGrandes++] = indice;
+        return false;
+    }
+    for (int16_t la = latMin; la <= latMax; ++la)
+        for (int16_t lo = lonMin; lo <= lonMax; ++lo)
+        {
+            EntreeIndex &e = entrees[nbEntrees];
+            e.latCellule = la;
+            e.lonCellule = lo;
+            e.geofence = indice;
+            uint16_t s = seau(la, lo);
+            e.suivante = seaux[s];
+            seaux[s] = nbEntrees++;
+        }
+    return true;
+}
+
+/**
+ * @brief Ajoute une zone circulaire.
+ * @return false si la table des zones est pleine.
+ */
+bool MoteurGeofence::ajouterCercle(uint16_t id, int32_t latE6, int32_t lonE6, uint32_t rayonM)
+{
+    if (nb >= MAX_GEOFENCES || latE6 == COORD_INVALIDE || lonE6 == COORD_INVALIDE)
+        return false;
+    Geofence &g = zones[nb];
+    g = Geofence();
+    g.id = id;
+    g.type = GEOFENCE_CERCLE;
+    g.latE6 = latE6;
+    g.lonE6 = lonE6;
+    g.rayonM = rayonM;
+    // 1 µdeg de latitude = 0.111195 m ; en longitude, divisé par cos(latitude)
+    int32_t dLat = (int32_t)((uint64_t)rayonM * 1000000ULL / 111195ULL) + 1;
+    int32_t cosLat = cosQ15(latE6 >= 0 ? latE6 + dLat : latE6 - dLat);
+    int32_t dLon = cosLat > 0 ? (int32_t)(((int64_t)dLat << 15) / cosLat) + 1 : 180000000;
+    g.latMinE6 = latE6 - dLat;
+    g.latMaxE6 = latE6 + dLat;
+    g.lonMinE6 = lonE6 - dLon;
+    g.lonMaxE6 = lonE6 + dLon;
+    indexer(nb++);
+    return true;
+}
+
+/**
+ * @brief Ajoute une zone polygonale (sommets {lat, lon} en micro-degrés, sans répéter le premier).
+ * @return false si le polygone est invalide ou si les tables sont pleines.
+ */
+bool MoteurGeofence::ajouterPolygone(uint16_t id, const int32_t points[][2], uint8_t n)
+{
+    if (nb >= MAX_GEOFENCES || n < 3 || n > MAX_SOMMETS_POLYGONE || nbSommets + n > MAX_SOMMETS_GEOFENCES)
+        return false;
+    Geofence &g = zones[nb];
+    g = Geofence();
+    g.id = id;
+    g.type = GEOFENCE_POLYGONE;
+    g.nbSommets = n;
+    g.premierSommet = nbSommets;
+    g.latMinE6 = g.latMaxE6 = points[0][0];
+    g.lonMinE6 = g.lonMaxE6 = points[0][1];
+    for (uint8_t i = 0; i < n; ++i)
+    {
+        sommets[nbSommets + i][0] = points[i][0];
+        sommets[nbSommets + i][1] = points[i][1];
+        if (points[i][0] < g.latMinE6)
+            g.latMinE6 = points[i][0];
+        if (points[i][0] > g.latMaxE6)
+            g.latMaxE6 = points[i][0];
+        if (points[i][1] < g.lonMinE6)
+            g.lonMinE6 = points[i][1];
+        if (points[i][1] > g.lonMaxE6)
+            g.lonMaxE6 = points[i][1];
+    }
+    nbSommets += n;
+    indexer(nb++);
+    return true;
+}
+
+bool MoteurGeofence::contient(const Geofence &g, int32_t latE6, int32_t lonE6) const
+{
+    if (latE6 < g.latMinE6 || latE6 > g.latMaxE6 || lonE6 < g.lonMinE6 || lonE6 > g.lonMaxE6)
+        return false;
+
+    if (g.type == GEOFENCE_CERCLE)
+    {
+        int32_t x, y;
+        projeterMm(g.latE6, g.lonE6, latE6, lonE6, x, y);
+        int64_t rayonMm = (int64_t)g.rayonM * 1000;
+        return (int64_t)x * x + (int64_t)y * y <= rayonMm * rayonMm;
+    }
+
+    // Lancer de rayon vers l'est : nombre impair de côtés traversés = dedans
+    bool interieur = false;
+    const int32_t(*p)[2] = sommets + g.premierSommet;
+    for (uint8_t i = 0, j = g.nbSommets - 1; i < g.nbSommets; j = i++)
+    {
+        int32_t yi = p[i][0], xi = p[i][1], yj = p[j][0], xj = p[j][1];
+        if ((yi > latE6) == (yj > latE6))
+            continue;
+        // lonE6 < xi + (xj - xi) * (latE6 - yi) / (yj - yi), sans division
+        int64_t gauche = ((int64_t)lonE6 - xi) * (yj - yi);
+        int64_t droite = ((int64_t)xj - xi) * ((int64_t)latE6 - yi);
+        if ((yj > yi) ? gauche < droite : gauche > droite)
+            interieur = !interieur;
+    }
+    return interieur;
+}
+
+void MoteurGeofence::emettre(uint16_t indice, bool entree, int32_t latE6, int32_t lonE6, unsigned long tMs)
+{
+    if (nbEv >= MAX_EVENEMENTS_GEOFENCE)
+    {
+        // File pleine : le plus ancien événement est perdu
+        for (uint8_t i = 1; i < nbEv; ++i)
+            evenements[i - 1] = evenements[i];
+        nbEv--;
+        if (nbEvEnvoi > 0)
+            nbEvEnvoi--;
+    }
+    EvenementGeofence &e = evenements[nbEv++];
+    e.id = zones[indice].id;
+    e.entree = entree;
+    e.latE6 = latE6;
+    e.lonE6 = lonE6;
+    e.tMs = tMs;
+    if (entree)
+        stats.nbEntrees++;
+    else
+        stats.nbSorties++;
+    Serial.println("[GEOFENCE] " + String(entree ? "entree" : "sortie") + " zone " + String(e.id));
+}
+
+/**
+ * @brief Évalue un fix : teste les zones de sa cellule et celles où l'objet se trouvait.
+ * @return Le nombre d'événements d'entrée / sortie produits.
+ */
+uint8_t MoteurGeofence::evaluer(int32_t latE6, int32_t lonE6, unsigned long tMs)
+{
+    if (nb == 0 || latE6 == COORD_INVALIDE || lonE6 == COORD_INVALIDE)
+        return 0;
+    stats.nbEvaluations++;
+    uint8_t testes[MAX_GEOFENCES / 8] = {0};
+    uint16_t nbTests = 0;
+    uint8_t produits = 0;
+
+    auto tester = [&](uint16_t i)
+    {
+        if (testes[i / 8] & (1 << (i % 8)))
+            return;
+        testes[i / 8] |= (1 << (i % 8));
+        nbTests++;
+        bool interieur = contient(zones[i], latE6, lonE6);
+        if (interieur != estDedans(i))
+        {
+            dedans[i / 8] ^= (1 << (i % 8));
+            emettre(i, interieur, latE6, lonE6, tMs);
+            produits++;
+        }
+    };
+
+    int16_t la = cellule(latE6), lo = cellule(lonE6);
+    for (uint16_t e = seaux[seau(la, lo)]; e != AUCUNE_ENTREE; e = entrees[e].suivante)
+        if (entrees[e].latCellule == la && entrees[e].lonCellule == lo)
+            tester(entrees[e].geofence);
+    for (uint16_t k = 0; k < nbGrandes; ++k)
+        tester(grandes[k]);
+
+    // Zones où l'objet était et qui ne couvrent pas sa nouvelle cellule : sortie
+    for (uint16_t octet = 0; octet < (nb + 7) / 8; ++octet)
+    {
+        uint8_t sorties = dedans[octet] & ~testes[octet];
+        for (uint8_t bit = 0; sorties; ++bit, sorties >>= 1)
+            if (sorties & 1)
+            {
+                dedans[octet] &= ~(1 << bit);
+                emettre(octet * 8 + bit, false, latE6, lonE6, tMs);
+                produits++;
+            }
+    }
+
+    stats.nbTests += nbTests;
+    if (nbTests > stats.nbTestsMax)
+        stats.nbTestsMax = nbTests;
+    return produits;
+}
+
+/**
+ * @brief Indique si le lot courant doit être envoyé (toujours, sauf option envoiSurEvenement).
+ */
+bool MoteurGeofence::envoiNecessaire(unsigned long maintenant) const
+{
+    return !config.envoiSurEvenement || nbEv > 0 || !envoiFait ||
+           (maintenant - dernierEnvoiMs) >= config.periodeHeartbeatMs;
+}
+
+void MoteurGeofence::enregistrerEnvoi(unsigned long maintenant)
+{
+    envoiFait = true;
+    dernierEnvoiMs = maintenant;
+}
+
+/**
+ * @brief Message livré : ses événements sont retirés de la file (ceux arrivés depuis restent), le heartbeat repart.
+ */
+void MoteurGeofence::envoiLivre(unsigned long maintenant)
+{
+    uint8_t n = nbEvEnvoi < nbEv ? nbEvEnvoi : nbEv;
+    for (uint8_t i = n; i < nbEv; ++i)
+        evenements[i - n] = evenements[i];
+    nbEv -= n;
+    nbEvEnvoi = 0;
+    enregistrerEnvoi(maintenant);
+}
+
+void MoteurGeofence::restaurerDedans(const uint8_t *bits)
+{
+    memcpy(dedans, bits, sizeof(dedans));
+}
+
+/**
+ * @brief Écrit les zones en flash (NVS) pour les retrouver après un redémarrage.
+ */
+void MoteurGeofence::sauvegarder() const
+{
+#ifndef UNIT_TEST
+    Preferences preferences;
+    preferences.begin("geofence", false);
+    preferences.putUShort("nb", nb);
+    preferences.putUShort("nbSommets", nbSommets);
+    preferences.putBytes("zones", zones, nb * sizeof(Geofence));
+    preferences.putBytes("sommets", sommets, nbSommets * sizeof(sommets[0]));
+    preferences.putBool("evenement", config.envoiSurEvenement);
+    preferences.putULong("heartbeat", config.periodeHeartbeatMs);
+    preferences.end();
+#endif
+}
+
+/**
+ * @brief Relit les zones écrites en flash et reconstruit l'index (l'état dedans / dehors n'est pas modifié).
+ */
+void MoteurGeofence::restaurer()
+{
+#ifndef UNIT_TEST
+    Preferences preferences;
+    preferences.begin("geofence", true);
+    uint16_t n = preferences.getUShort("nb", 0);
+    uint16_t s = preferences.getUShort("nbSommets", 0);
+    if (n <= MAX_GEOFENCES && s <= MAX_SOMMETS_GEOFENCES &&
+        preferences.getBytes("zones", zones, n * sizeof(Geofence)) == n * sizeof(Geofence) &&
+        preferences.getBytes("sommets", sommets, s * sizeof(sommets[0])) == s * sizeof(sommets[0]))
+    {
+        nb = n;
+        nbSommets = s;
+    }
+    config.envoiSurEvenement = preferences.getBool("evenement", config.envoiSurEvenement);
+    config.periodeHeartbeatMs = preferences.getULong("heartbeat", config.periodeHeartbeatMs);
+    preferences.end();
+#endif
+    reconstruireIndex();
+}
+
+/**
+ * @brief Convertit une coordonnée reçue en JSON (degrés décimaux) en micro-degrés.
+ */
+int32_t degresJsonVersE6(const json &valeur)
+{
+    if (valeur.is_number_integer())
+        return (int32_t)valeur.get<long long>() * 1000000;
+    if (!valeur.is_number())
+        return COORD_INVALIDE;
+    double degres = valeur.get<double>();
+    return (int32_t)(degres * 1000000.0 + (degres >= 0 ? 0.5 : -0.5));
+}
+
+/**
+ * @brief Remplace les zones par celles reçues du serveur, puis les écrit en flash.
+ *
+ * Format : [{"id":1,"lat":50.63,"lon":3.04,"rayon":150}, {"id":2,"polygone":[[50.63,3.04],[50.64,3.05],...]}]
+ *
+ * @return false si au moins une zone a été refusée.
+ */
+bool chargerGeofences(const json &liste)
+{
+    if (!liste.is_array())
+        return false;
+    bool toutes = true;
+    geofences.vider();
+    for (const json &zone : liste)
+    {
+        uint16_t id = zone.value("id", 0);
+        bool ok = false;
+        if (zone.contains("polygone") && zone["polygone"].is_array())
+        {
+            int32_t points[MAX_SOMMETS_POLYGONE][2];
+            uint8_t n = 0;
+            for (const json &p : zone["polygone"])
+            {
+                if (n >= MAX_SOMMETS_POLYGONE || !p.is_array() || p.size() < 2)
+                {
+                    n = 0;
+                    break;
+                }
+                points[n][0] = degresJsonVersE6(p[0]);
+                points[n][1] = degresJsonVersE6(p[1]);
+                n++;
+            }
+            ok = geofences.ajouterPolygone(id, points, n);
+        }
+        else if (zone.contains("lat") && zone.contains("lon") && zone.contains("rayon"))
+            ok = geofences.ajouterCercle(id, degresJsonVersE6(zone["lat"]), degresJsonVersE6(zone["lon"]), zone["rayon"].get<uint32_t>());
+        if (!ok)
+        {
+            Serial.println("[GEOFENCE] zone refusee : " + String(id));
+            toutes = false;
+        }
+    }
+    Serial.println("[GEOFENCE] " + String(geofences.nbGeofences()) + " zones chargees");
+    geofences.sauvegarder();
+    return toutes;
+}
+
+/**
+ * @brief Applique les options {"envoiSurEvenement":true,"heartbeat":3600000}.
+ */
+void chargerOptionsGeofence(const json &options)
+{
+    if (options.contains("envoiSurEvenement"))
+        geofences.config.envoiSurEvenement = options["envoiSurEvenement"].get<bool>();
+    if (options.contains("heartbeat"))
+        geofences.config.periodeHeartbeatMs = options["heartbeat"].get<unsigned long>();
+    geofences.sauvegarder();
+}
+
+/**
+ * @brief Événements en attente, au format des objets du tableau JSON envoyé (séparés par des virgules).
+ */
+String evenementsGeofenceJSON()
+{
+    String json = "";
+    for (uint8_t i = 0; i < geofences.nbEvenements(); ++i)
+    {
+        const EvenementGeofence &e = geofences.evenement(i);
+        if (i > 0)
+            json += ",";
+        json += String("{\"imei\":\"") + imei + "\",\"latitude\":" + e6VersDegres(e.latE6) +
+                ",\"longitude\":" + e6VersDegres(e.lonE6) + ",\"geofence\":" + String(e.id) +
+                ",\"evenement\":\"" + (e.entree ? "entree" : "sortie") + "\"" + champHorodatageJSON(baseTemps.versEpochMs(e.tMs)) + "}";
+    }
+    return json;
+}
+
+void afficherStatsGeofence()
+{
+    if (geofences.nbGeofences() == 0)
+        return;
+    const StatsGeofence &s = geofences.stats;
+    Serial.println("[GEOFENCE] zones : " + String(geofences.nbGeofences()) + ", evaluations : " + String(s.nbEvaluations));
+    Serial.println("[GEOFENCE] tests par fix (moyen / max) : " +
+                   String(s.nbEvaluations ? s.nbTests / s.nbEvaluations : 0) + " / " + String(s.nbTestsMax));
+    Serial.println("[GEOFENCE] entrees / sorties : " + String(s.nbEntrees) + " / " + String(s.nbSorties) +
+                   ", envois evites : " + String(s.nbEnvoisEvites));
+}
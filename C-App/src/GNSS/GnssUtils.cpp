@@ -8,13 +8,29 @@
  * La validité des coordonnées latitude et longitude est vérifiée : on considère qu'elles sont valides si elles sont différentes de 0.
  * (On peut aussi, comme montré en commentaire, vérifier qu'elles sont différentes de 47 et 4, qui sont des valeurs par défaut, afin d'attendre de vraies coordonnées GPS.)
  *
- * Une section (commentée) permettrait aussi de vérifier la précision HDOP, mais pour simplifier, ce critère est désactivé afin de toujours récupérer des coordonnées.
+ * Un fix dont l'horodatage UTC a déjà été lu (le récepteur n'a pas produit de nouvelle époque) est écarté (CACHE_FIX).
+ * Le fix passe ensuite par accepterFix() (ACCEPTATION_FIX) : HDOP (gnssOptions.precision quand l'option est active),
+ * satellites utilisés, C/N0, sauts impossibles, et lissage optionnel de la position.
  *
  * Les fonctions shiftLeftDataGNSS() et addGNSSInDataGNSS() servent à gérer un tableau de coordonnées GNSS :
  * - shiftLeftDataGNSS() décale toutes les coordonnées d'une case vers la gauche pour faire de la place.
- * - addGNSSInDataGNSS() ajoute une nouvelle coordonnée GNSS dans le tableau, en supprimant la plus ancienne si le tableau est plein.
+ * - addGNSSInDataGNSS() ajoute une nouvelle coordonnée GNSS dans le tableau via le tampon (TAMPON_GNSS) : si le tableau est plein,
+ *   le segment le plus ancien est décimé (ou, en mode historique, la plus ancienne coordonnée est supprimée).
+ *   Chaque nouvelle coordonnée GNSS est aussi évaluée par le moteur de géofences (GEOFENCE) ; toute position
+ *   est notée par la stratégie de positionnement (POSITION_CELLULE) pour le temps jusqu'à la première position,
+ *   horodatée (millis) pour la latence jusqu'au serveur et composée en JSON pendant l'acquisition.
+ *   L'heure d'un fix GNSS (ou d'une position AT+CLBS) recale l'horloge UTC (BASE_TEMPS) ; une position sans heure
+ *   reçoit celle de l'horloge.
  */
 #include "GnssUtils.hpp"
+#include "GEOFENCE.hpp"
+#include "ACCEPTATION_FIX.hpp"
+#include "TAMPON_GNSS.hpp"
+#include "POSITION_CELLULE.hpp"
+#include "ARBITRE_RADIO.hpp"
+#include "STEP_COMPOSE_JSON.hpp"
+#include "BASE_TEMPS.hpp"
+#include "CACHE_FIX.hpp"
 
 Gnss getGNSSValid()
 {
@@ -22,7 +38,6 @@ Gnss getGNSSValid()
 
     Float_gnss lat = responseGNSS.coordonnees.latitude;
     Float_gnss lng = responseGNSS.coordonnees.longitude;
-    // Float_gnss hdop = responseGNSS.hdop;
     String ts = responseGNSS.timeStamp;
 
     bool latValide = ((lat.ent != 0) || lat.dec != 0);
@@ -30,27 +45,15 @@ Gnss getGNSSValid()
     // bool latValide = ((lat.ent != 0) || lat.dec != 0) && (lat.ent != 47);
     // bool lngValide = ((lng.ent != 0) || lng.dec != 0) && (lng.ent != 4);
 
-    // Vérification de la précision HDOP seulement si l'option est active
-    bool hdopValide = true;
-    if (gnssOptions.precisionActive)
-    {
-        // hdopValide = (hdop.ent < gnssOptions.precision);
-    }
-
-    if (latValide && lngValide && hdopValide)
+    if (latValide && lngValide)
     {
+        if (!cacheFix.nouvelleEpoque(ts))
+            return responseGNSS; // même époque que le fix précédent : doublon
         responseGNSS.coordonnees.latitude.full = String(lat.ent) + "." + String(lat.dec);
         responseGNSS.coordonnees.longitude.full = String(lng.ent) + "." + String(lng.dec);
-        responseGNSS.isValid = true;
+        // Qualité (HDOP, satellites, C/N0) et cohérence avec le fix précédent
+        responseGNSS.isValid = accepterFix(responseGNSS, millis());
     }
-    // else if (gnssOptions.precisionActive && !hdopValide)
-    // {
-    //     Serial.print("[GNSS] Point ignoré : HDOP trop élevé (");
-    //     // Serial.print(hdop.full);
-    //     Serial.print(" >= ");
-    //     Serial.print(gnssOptions.precision);
-    //     Serial.println(")");
-    // }
 
     return responseGNSS;
 }
@@ -66,13 +69,20 @@ void shiftLeftDataGNSS(DataGNSS *array, int &nbCoordonnees)
 
 void addGNSSInDataGNSS(Gnss gnss)
 {
-    if (nbCoordonnees >= MAX_COORDS)
-    {
-        shiftLeftDataGNSS(dataGNSS, nbCoordonnees);
-    }
-    if (nbCoordonnees < MAX_COORDS)
-    {
-        dataGNSS[nbCoordonnees].gnss = gnss;
-        nbCoordonnees++;
-    }
+    int64_t heure = horodatageVersEpochMs(gnss.timeStamp);
+    if (heure != 0 && gnss.source != SOURCE_CELLULE)
+        baseTemps.synchroniser(heure, millis(), gnss.source == SOURCE_GNSS ? TEMPS_GNSS : TEMPS_RESEAU);
+    else if (gnss.timeStamp.length() == 0 && baseTemps.estSynchronisee())
+        gnss.timeStamp = epochVersHorodatage(baseTemps.maintenantMs(millis()));
+    strategiePosition.enregistrerPosition(gnss.source, millis());
+    // Une position réseau (rayon de plusieurs centaines de mètres) ne déclenche pas de transition de géofence
+    if (gnss.source == SOURCE_GNSS)
+        geofences.evaluer(degresVersE6(gnss.coordonnees.latitude.full), degresVersE6(gnss.coordonnees.longitude.full), millis());
+    if (!tamponGnss.ajouter(dataGNSS, nbCoordonnees, gnss))
+        return;
+    DataGNSS &ajoute = dataGNSS[nbCoordonnees - 1];
+    ajoute.tFixMs = millis();
+    // Composé pendant l'acquisition (ARBITRE_RADIO) : STEP_COMPOSE_JSON n'aura qu'à assembler
+    if (imei.length() > 0)
+        ajoute.fragment = fragmentJSON(gnss);
 }
@@ -1,64 +1,83 @@
 #include "PARSER_TIMESTAMP.hpp"
+#include "BASE_TEMPS.hpp"
 
-String convertTimestampToLocalTime(String utcTimestamp, int timeOffset)
+// Date et heure locales d'un horodatage UTC (yyyyMMddhhmmss.sss) ; false si l'horodatage est invalide
+static bool dateLocale(const String &utcTimestamp, int timeOffset, DateUTC &date, int32_t &jours)
 {
-    // Extract values from the timestamp (yyyyMMddhhmmss.sss)
-    int year = utcTimestamp.substring(0, 4).toInt();     // Year (e.g.: 2025)
-    int month = utcTimestamp.substring(4, 6).toInt();    // Month (e.g.: 03)
-    int day = utcTimestamp.substring(6, 8).toInt();      // Day (e.g.: 18)
-    int hour = utcTimestamp.substring(8, 10).toInt();    // UTC hour (e.g.: 15)
-    int minute = utcTimestamp.substring(10, 12).toInt(); // Minute (e.g.: 46)
-    int second = utcTimestamp.substring(12, 14).toInt(); // Second (e.g.: 53)
-
-    // Add the time offset
-    hour += timeOffset;
+    int64_t ms = horodatageVersEpochMs(utcTimestamp);
+    if (ms == 0)
+        return false;
+    ms += (int64_t)timeOffset * 3600000LL; // le calendrier gère les fins de mois et d'année
+    jours = joursDepuisEpochMs(ms);
+    date = dateDepuisEpochMs(ms);
+    return true;
+}
 
-    // Handle day overflow if hour exceeds 23:59
-    if (hour >= 24)
-    {
-        hour -= 24; // Go back to a valid hour
-        day += 1;   // Move to the next day
-    }
-    else if (hour < 0)
-    {
-        hour += 24; // Go back to a valid hour
-        day -= 1;   // Move to the previous day
-    }
+static tm versTm(const DateUTC &date, int32_t jours)
+{
+    tm timeStruct;
+    memset(&timeStruct, 0, sizeof(timeStruct));
+    timeStruct.tm_year = date.annee - 1900; // Year - 1900
+    timeStruct.tm_mon = date.mois - 1;      // Month - 1 (January = 0)
+    timeStruct.tm_mday = date.jour;
+    timeStruct.tm_hour = date.heure;
+    timeStruct.tm_min = date.minute;
+    timeStruct.tm_sec = date.seconde;
+    timeStruct.tm_wday = jourSemaine(jours);
+    timeStruct.tm_yday = jours - joursDepuisEpoque(date.annee, 1, 1);
+    return timeStruct;
+}
 
-    // Handle month overflow
-    if (day > 31)
-    { // This is not perfect (no check for months with 30 days)
-        day = 1;
-        month += 1;
-    }
-    if (month > 12)
-    {
-        month = 1;
-        year += 1;
-    }
+String convertTimestampToLocalTime(String utcTimestamp, int timeOffset)
+{
+    DateUTC date;
+    int32_t jours;
+    if (!dateLocale(utcTimestamp, timeOffset, date, jours))
+        return "";
 
     // Format the local date and time
-    String localTime = String(year) + "/" + (month < 10 ? "0" : "") + String(month) + "/" +
-                       (day < 10 ? "0" : "") + String(day) + " " +
-                       (hour < 10 ? "0" : "") + String(hour) + ":" +
-                       (minute < 10 ? "0" : "") + String(minute) + ":" +
-                       (second < 10 ? "0" : "") + String(second);
+    char localTime[24];
+    snprintf(localTime, sizeof(localTime), "%04ld/%02u/%02u %02u:%02u:%02u",
+             (long)date.annee, date.mois, date.jour, date.heure, date.minute, date.seconde);
+    return String(localTime);
+}
 
-    return localTime;
+tm convertTimestampToLocalTimeTm(String utcTimestamp, int timeOffset)
+{
+    DateUTC date;
+    int32_t jours;
+    if (!dateLocale(utcTimestamp, timeOffset, date, jours))
+    {
+        tm vide;
+        memset(&vide, 0, sizeof(vide));
+        return vide;
+    }
+    return versTm(date, jours);
 }
 
 tm parserTimeStamp(String utcTimestamp)
 {
+    return convertTimestampToLocalTimeTm(utcTimestamp, 0);
+}
 
-    struct tm timeStruct; // Create the tm struct
-
-    // Fill the tm struct with the values from the timestamp
-    timeStruct.tm_year = utcTimestamp.substring(0, 4).toInt() - 1900; // Year - 1900
-    timeStruct.tm_mon = utcTimestamp.substring(4, 6).toInt() - 1;     // Month - 1 (January = 0)
-    timeStruct.tm_mday = utcTimestamp.substring(6, 8).toInt();
-    timeStruct.tm_hour = utcTimestamp.substring(8, 10).toInt();
-    timeStruct.tm_min = utcTimestamp.substring(10, 12).toInt();
-    timeStruct.tm_sec = utcTimestamp.substring(12, 14).toInt();
+/**
+ * @brief Convertit un horodatage GNSS (yyyyMMddhhmmss.sss) en secondes depuis le 01/01/2000 00:00:00 UTC.
+ * @return Le nombre de secondes, ou 0 si l'horodatage est absent ou invalide.
+ */
+uint32_t horodatageVersSecondes(const String &utcTimestamp)
+{
+    int64_t ms = horodatageVersEpochMs(utcTimestamp);
+    if (ms < EPOCH_2000_MS)
+        return 0;
+    return (uint32_t)((ms - EPOCH_2000_MS) / 1000);
+}
 
-    return timeStruct;
+/**
+ * @brief Opération inverse de horodatageVersSecondes() (ex : 0 -> "20000101000000.000").
+ */
+String secondesVersHorodatage(uint32_t secondes)
+{
+    char texte[20];
+    formaterHorodatage(EPOCH_2000_MS + secondes * 1000LL, texte, sizeof(texte));
+    return String(texte);
 }
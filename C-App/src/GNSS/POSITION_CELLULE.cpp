@@ -0,0 +1,436 @@
+/**
+ * @file POSITION_CELLULE.cpp
+ * @brief Position de repli par le réseau cellulaire quand le GNSS n'a pas de fix dans le délai imparti.
+ *
+ * Jusqu'ici, un cycle sans fix GNSS (intérieur, démarrage à froid, canyon urbain) ne produisait aucune position
+ * avant l'extinction du GNSS. La stratégie de positionnement ajoute un repli, du moins coûteux au plus coûteux :
+ * - cellule servante (AT+CPSI?) déjà associée à une position : aucune requête réseau, horodatage par l'horloge UTC
+ *   (BASE_TEMPS, AT+CCLK? seulement si elle n'est pas assez précise),
+ * - localisation par le réseau (AT+CLBS=4) : quelques secondes et quelques centaines d'octets de données.
+ * Une position de repli porte sa source et son rayon d'incertitude jusque dans le JSON envoyé au serveur.
+ *
+ * Le SIM7080G partage sa chaîne radio entre le GNSS et le LTE : la position de repli termine donc l'acquisition
+ * du cycle, et le GNSS retente au cycle suivant avec un délai doublé (jusqu'à delaiMaxMs) tant qu'il n'obtient rien.
+ * AT+CLBS n'est lancé que si le contexte PDP est actif, une fois le GNSS éteint (AT+CGNSPWR=0, STEP_GNSS) ; sa réponse,
+ * jusqu'à TIMEOUT_CLBS_MS, est attendue par la machine d'état (taskCLBS) sans bloquer la boucle.
+ * Chaque fix GNSS obtenu associe la cellule servante à sa position (cache LRU de NB_CELLULES_CACHE cellules,
+ * conservé en mémoire RTC).
+ *
+ * Le temps jusqu'à la première position (TTFP) de chaque cycle est mesuré par source et affiché en fin de cycle.
+ */
+
+#include "POSITION_CELLULE.hpp"
+#include "GnssUtils.hpp"
+#include "BASE_TEMPS.hpp"
+#include "QUALITE_LIEN.hpp"
+#include "SESSION_RESEAU.hpp"
+
+StrategiePosition strategiePosition; ///< Repli réseau utilisé par STEP_GNSS.
+ATCommandTask taskCLBS("AT+CLBS=4,0", "+CLBS:", 0, TIMEOUT_CLBS_MS);
+static MachineEtat machineRepli;
+
+#define MAX_CHAMPS_CELLULE 8
+
+/**
+ * @brief Découpe la ligne qui suit un préfixe de réponse AT (ex : "+CPSI: ") en champs séparés par des virgules.
+ * @return Le nombre de champs lus, 0 si le préfixe est absent.
+ */
+static int decouperReponse(const String &reponse, const char *prefixe, String *champs, int max)
+{
+    int debut = reponse.indexOf(prefixe);
+    if (debut == -1)
+        return 0;
+    debut += strlen(prefixe);
+    int fin = debut;
+    while (fin < (int)reponse.length() && reponse[fin] != '\r' && reponse[fin] != '\n')
+        fin++;
+    String ligne = reponse.substring(debut, fin);
+    ligne.trim();
+
+    int n = 0;
+    int position = 0;
+    while (n < max)
+    {
+        int virgule = ligne.indexOf(',', position);
+        champs[n++] = virgule == -1 ? ligne.substring(position) : ligne.substring(position, virgule);
+        if (virgule == -1)
+            break;
+        position = virgule + 1;
+    }
+    return n;
+}
+
+// "yy/MM/dd" et "hh:mm:ss" -> "yyyyMMddhhmmss.000" (chaîne vide si le format ne correspond pas)
+static String horodatageDepuisDateHeure(const String &date, const String &heure)
+{
+    if (date.length() < 8 || heure.length() < 8 || date[2] != '/' || heure[2] != ':')
+        return "";
+    return "20" + date.substring(0, 2) + date.substring(3, 5) + date.substring(6, 8) +
+           heure.substring(0, 2) + heure.substring(3, 5) + heure.substring(6, 8) + ".000";
+}
+
+/**
+ * @brief Lit la cellule servante dans la réponse à AT+CPSI?.
+ *
+ * Ex : "+CPSI: LTE CAT-M1,Online,208-01,0x1A2B,12345678,..." (TAC en hexadécimal).
+ * @return false hors service ou si la réponse est incomplète.
+ */
+bool parserCPSI(const String &reponse, IdentiteCellule &id)
+{
+    id = IdentiteCellule();
+    String champs[MAX_CHAMPS_CELLULE];
+    if (decouperReponse(reponse, "+CPSI:", champs, MAX_CHAMPS_CELLULE) < 5 || champs[1] != "Online")
+        return false;
+
+    int tiret = champs[2].indexOf('-');
+    if (tiret == -1)
+        return false;
+    id.plmn = (uint32_t)champs[2].substring(0, tiret).toInt() * 1000 + (uint32_t)champs[2].substring(tiret + 1).toInt();
+    id.tac = strtoul(champs[3].c_str(), nullptr, 16);
+    id.cellId = strtoul(champs[4].c_str(), nullptr, 10);
+    id.valide = id.plmn != 0 && id.cellId != 0;
+    return id.valide;
+}
+
+/**
+ * @brief Lit la position renvoyée par AT+CLBS=4,0.
+ *
+ * Ex : "+CLBS: 0,3.048687,50.634412,550,25/06/12,10:15:30" (code, longitude, latitude, précision en m, date et heure UTC).
+ * @return false si le code de retour n'est pas 0 ou si la position est absente.
+ */
+bool parserCLBS(const String &reponse, int32_t &latE6, int32_t &lonE6, uint32_t &precisionM, String &horodatage)
+{
+    String champs[MAX_CHAMPS_CELLULE];
+    int n = decouperReponse(reponse, "+CLBS:", champs, MAX_CHAMPS_CELLULE);
+    if (n < 4 || champs[0] != "0")
+        return false;
+
+    lonE6 = degresVersE6(champs[1]);
+    latE6 = degresVersE6(champs[2]);
+    if (latE6 == COORD_INVALIDE || lonE6 == COORD_INVALIDE || (latE6 == 0 && lonE6 == 0))
+        return false;
+    precisionM = (uint32_t)champs[3].toInt();
+    horodatage = n >= 6 ? horodatageDepuisDateHeure(champs[4], champs[5]) : "";
+    return true;
+}
+
+/**
+ * @brief Convertit l'heure du modem (AT+CCLK?) en horodatage UTC.
+ *
+ * Ex : '+CCLK: "25/06/12,12:15:30+08"' : heure locale, fuseau en quarts d'heure -> "20250612101530.000".
+ * @return Chaîne vide si l'heure est absente ou invalide.
+ */
+String horodatageDepuisCCLK(const String &reponse)
+{
+    return epochVersHorodatage(epochDepuisCCLK(reponse.c_str()));
+}
+
+IdentiteCellule lireCelluleServante()
+{
+    IdentiteCellule id;
+    String reponse = Send_AT("AT+CPSI?", 1000);
+    parserCPSI(reponse, id);
+    qualiteLien.observer(reponse, millis()); // la même réponse donne la qualité de la cellule
+    return id;
+}
+
+StrategiePosition::StrategiePosition()
+{
+    reinitialiser();
+}
+
+void StrategiePosition::reinitialiser()
+{
+    stats = StatsPosition();
+    memset(cellules, 0, sizeof(cellules));
+    cycleEnCours = positionCycle = gnssCycle = repliTente = clbsEnCours = false;
+    celluleClbs = IdentiteCellule();
+    debutCycleMs = 0;
+    niveau = 0;
+    horloge = 0;
+}
+
+/**
+ * @brief Délai accordé au GNSS avant le repli : delaiGnssMs, doublé à chaque cycle précédent sans fix GNSS.
+ */
+unsigned long StrategiePosition::delaiCourantMs() const
+{
+    unsigned long delai = config.delaiGnssMs;
+    for (uint8_t i = 0; i < niveau && delai < config.delaiMaxMs; ++i)
+        delai *= 2;
+    return delai < config.delaiMaxMs ? delai : config.delaiMaxMs;
+}
+
+/**
+ * @brief Début d'un cycle d'acquisition (mise sous tension du GNSS).
+ */
+void StrategiePosition::debutCycle(unsigned long maintenant)
+{
+    finCycle();
+    cycleEnCours = true;
+    positionCycle = gnssCycle = repliTente = false;
+    debutCycleMs = maintenant;
+    stats.nbCycles++;
+}
+
+/**
+ * @brief Fin d'un cycle (GNSS éteint) : ajuste le délai du cycle suivant, avant la sauvegarde en mémoire RTC.
+ *
+ * Un fix GNSS ramène le délai à delaiGnssMs ; un cycle terminé par un repli le double.
+ */
+void StrategiePosition::finCycle()
+{
+    if (!cycleEnCours)
+        return;
+    cycleEnCours = false;
+    if (!positionCycle)
+        stats.nbSansPosition++;
+    if (gnssCycle)
+        niveau = 0;
+    else if (repliTente && delaiCourantMs() < config.delaiMaxMs)
+        niveau++;
+}
+
+/**
+ * @brief Note une position obtenue : la première du cycle fixe le TTFP de sa source.
+ */
+void StrategiePosition::enregistrerPosition(SourcePosition source, unsigned long maintenant)
+{
+    if (!cycleEnCours || source >= NB_SOURCES_POSITION)
+        return;
+    if (source == SOURCE_GNSS)
+        gnssCycle = true;
+    if (positionCycle)
+        return;
+    positionCycle = true;
+    stats.dernierTtfpMs = maintenant - debutCycleMs;
+    stats.nbParSource[source]++;
+    stats.ttfpCumuleMs[source] += stats.dernierTtfpMs;
+}
+
+/**
+ * @brief Vrai quand le GNSS n'a encore rien donné dans ce cycle et que son délai est écoulé (un seul repli par cycle).
+ */
+bool StrategiePosition::repliNecessaire(unsigned long maintenant) const
+{
+    return config.actif && cycleEnCours && !positionCycle && !repliTente &&
+           maintenant - debutCycleMs >= delaiCourantMs();
+}
+
+static void remplirPosition(Gnss &sortie, SourcePosition source, int32_t latE6, int32_t lonE6, uint32_t precisionM, const String &horodatage)
+{
+    sortie = Gnss();
+    sortie.coordonnees.latitude = parseGNSS(e6VersDegres(latE6));
+    sortie.coordonnees.longitude = parseGNSS(e6VersDegres(lonE6));
+    sortie.timeStamp = horodatage;
+    sortie.source = source;
+    sortie.precisionM = precisionM;
+    sortie.isValid = true;
+}
+
+/**
+ * @brief Cherche une position grossière : cellule servante connue, sinon lance AT+CLBS.
+ *
+ * AT+CLBS n'est lancé qu'avec un contexte PDP actif : repliEnCours() devient vrai, STEP_GNSS éteint le GNSS puis
+ * attend la réponse par poursuivreClbs().
+ * @return true si sortie contient une position de cellule connue (source et précision renseignées).
+ */
+bool StrategiePosition::positionDeRepli(Gnss &sortie, unsigned long maintenant)
+{
+    repliTente = true;
+    stats.nbReplis++;
+
+    IdentiteCellule id;
+    if (config.cacheCellules)
+    {
+        id = lireCelluleServante();
+        const CelluleConnue *cellule = id.valide ? chercherCellule(id) : nullptr;
+        if (cellule)
+        {
+            remplirPosition(sortie, SOURCE_CELLULE, cellule->latE6, cellule->lonE6, cellule->precisionM,
+                            epochVersHorodatage(horodatageCourantMs()));
+            stats.nbCellulesTrouvees++;
+            enregistrerPosition(SOURCE_CELLULE, maintenant);
+            return true;
+        }
+    }
+
+    if (config.clbs)
+    {
+        // Localisation par le serveur de l'opérateur : sans contexte PDP, la requête échouerait après son délai
+        if (!sessionReseau.estPdpActif())
+            sessionReseau.traiter(Send_AT("AT+CNACT?", 1000), maintenant);
+        if (!sessionReseau.estPdpActif())
+        {
+            stats.nbClbsSansPdp++;
+            return false;
+        }
+        celluleClbs = id;
+        taskCLBS.state = IDLE;
+        taskCLBS.isFinished = false;
+        clbsEnCours = true;
+    }
+    return false;
+}
+
+/**
+ * @brief Attend la réponse à AT+CLBS, GNSS éteint ; à appeler tant que repliEnCours().
+ * @return true si sortie contient la position réseau ; false en attente ou en échec (repliEnCours() faux).
+ */
+bool StrategiePosition::poursuivreClbs(Gnss &sortie, unsigned long maintenant)
+{
+    if (!clbsEnCours)
+        return false;
+    if (!machineRepli.updateATState(taskCLBS))
+    {
+        if (taskCLBS.state != ERROR)
+            return false;
+        // Pas de réponse : le GNSS retente au cycle suivant
+        clbsEnCours = false;
+        taskCLBS.state = IDLE;
+        taskCLBS.isFinished = false;
+        stats.nbEchecsClbs++;
+        return false;
+    }
+    clbsEnCours = false;
+    String reponse = taskCLBS.responseBuffer;
+    taskCLBS.state = IDLE;
+    taskCLBS.isFinished = false;
+
+    int32_t lat, lon;
+    uint32_t precision;
+    String horodatage;
+    if (!parserCLBS(reponse, lat, lon, precision, horodatage))
+    {
+        stats.nbEchecsClbs++;
+        return false;
+    }
+    remplirPosition(sortie, SOURCE_CLBS, lat, lon, precision, horodatage);
+    if (celluleClbs.valide)
+        apprendreCellule(celluleClbs, lat, lon, precision);
+    enregistrerPosition(SOURCE_CLBS, maintenant);
+    return true;
+}
+
+// Le cache peut avoir été restauré depuis la mémoire RTC : l'horloge LRU repart de la plus récente utilisation
+void StrategiePosition::synchroniserHorloge()
+{
+    for (int i = 0; i < NB_CELLULES_CACHE; ++i)
+        if (cellules[i].utilisation > horloge)
+            horloge = cellules[i].utilisation;
+}
+
+/**
+ * @brief Associe une position à une cellule ; une fois le cache plein, la cellule la moins récemment utilisée est remplacée.
+ */
+void StrategiePosition::apprendreCellule(const IdentiteCellule &id, int32_t latE6, int32_t lonE6, uint32_t precisionM)
+{
+    if (!id.valide)
+        return;
+    synchroniserHorloge();
+    int cible = 0;
+    for (int i = 0; i < NB_CELLULES_CACHE; ++i)
+    {
+        const CelluleConnue &c = cellules[i];
+        if (c.utilisation != 0 && c.plmn == id.plmn && c.tac == id.tac && c.cellId == id.cellId)
+        {
+            cible = i;
+            break;
+        }
+        if (c.utilisation < cellules[cible].utilisation)
+            cible = i;
+    }
+    CelluleConnue &c = cellules[cible];
+    c.plmn = id.plmn;
+    c.tac = id.tac;
+    c.cellId = id.cellId;
+    c.latE6 = latE6;
+    c.lonE6 = lonE6;
+    c.precisionM = precisionM;
+    c.utilisation = ++horloge;
+}
+
+const CelluleConnue *StrategiePosition::chercherCellule(const IdentiteCellule &id)
+{
+    synchroniserHorloge();
+    for (int i = 0; i < NB_CELLULES_CACHE; ++i)
+    {
+        CelluleConnue &c = cellules[i];
+        if (c.utilisation != 0 && c.plmn == id.plmn && c.tac == id.tac && c.cellId == id.cellId)
+        {
+            c.utilisation = ++horloge;
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Fin d'acquisition (GNSS_DONE) : si le cycle a eu un fix GNSS, la cellule servante est associée au dernier fix.
+ */
+void memoriserCelluleServante()
+{
+    if (!strategiePosition.config.actif || !strategiePosition.config.cacheCellules || !strategiePosition.fixGnssCycle())
+        return;
+    for (int i = nbCoordonnees - 1; i >= 0; --i)
+    {
+        const Gnss &gnss = dataGNSS[i].gnss;
+        if (gnss.source != SOURCE_GNSS)
+            continue;
+        IdentiteCellule id = lireCelluleServante();
+        strategiePosition.apprendreCellule(id, degresVersE6(gnss.coordonnees.latitude.full), degresVersE6(gnss.coordonnees.longitude.full),
+                                           strategiePosition.config.precisionCelluleM);
+        return;
+    }
+}
+
+/**
+ * @brief Options reçues du serveur : {"actif": bool, "delaiGnssMs": ms, "delaiMaxMs": ms, "clbs": bool, "cacheCellules": bool}.
+ */
+void chargerOptionsRepli(const json &options)
+{
+    ConfigRepli &config = strategiePosition.config;
+    if (options.contains("actif"))
+        config.actif = options["actif"].get<bool>();
+    if (options.contains("delaiGnssMs"))
+        config.delaiGnssMs = options["delaiGnssMs"].get<unsigned long>();
+    if (options.contains("delaiMaxMs"))
+        config.delaiMaxMs = options["delaiMaxMs"].get<unsigned long>();
+    if (options.contains("clbs"))
+        config.clbs = options["clbs"].get<bool>();
+    if (options.contains("cacheCellules"))
+        config.cacheCellules = options["cacheCellules"].get<bool>();
+}
+
+const char *nomSourcePosition(SourcePosition source)
+{
+    switch (source)
+    {
+    case SOURCE_GNSS:
+        return "gnss";
+    case SOURCE_CLBS:
+        return "clbs";
+    case SOURCE_CELLULE:
+        return "cellule";
+    default:
+        return "?";
+    }
+}
+
+void afficherStatsPosition()
+{
+    const StatsPosition &s = strategiePosition.stats;
+    if (s.nbCycles == 0)
+        return;
+    String ttfp = "";
+    for (int i = 0; i < NB_SOURCES_POSITION; ++i)
+    {
+        uint32_t moyenne = s.nbParSource[i] ? s.ttfpCumuleMs[i] / s.nbParSource[i] : 0;
+        ttfp += String(nomSourcePosition((SourcePosition)i)) + ":" + String(s.nbParSource[i]) + " (" + String(moyenne) + " ms) ";
+    }
+    Serial.println("[POSITION] premiere position par source " + ttfp + "/ sans position : " + String(s.nbSansPosition));
+    Serial.println("[POSITION] TTFP dernier cycle (ms) : " + String(s.dernierTtfpMs) + " / replis : " + String(s.nbReplis) +
+                   " (cellules connues : " + String(s.nbCellulesTrouvees) + ", echecs CLBS : " + String(s.nbEchecsClbs) +
+                   ", sans PDP : " + String(s.nbClbsSansPdp) + ")" +
+                   " / delai GNSS (ms) : " + String(strategiePosition.delaiCourantMs()));
+}
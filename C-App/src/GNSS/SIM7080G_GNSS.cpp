@@ -13,6 +13,7 @@
  * afin de pouvoir les réutiliser facilement dans le reste de l'application, comme vu dans les autres fichiers GNSS.
  */
 #include "SIM7080G_GNSS.hpp"
+#include "CACHE_FIX.hpp"
 
 DataGNSS dataGNSS[MAX_COORDS];
 String gnssTurnOn()
@@ -32,7 +33,7 @@ String check_GNSS_Status()
 
 String get_GNSS_Info()
 {
-    return Send_AT("AT+CGNSINF");
+    return cacheFix.lire(millis(), 1000); // même époque déjà lue : pas de nouvel AT+CGNSINF (CACHE_FIX)
 }
 String get_GNSS_Mode()
 {
@@ -156,7 +157,12 @@ Gnss getGnssResponse()
     gnss.timeStamp = getTimeStamp(gnssData);
     gnss.coordonnees = coord;
     gnss.altitude = getAltitude(gnssData);
-    // gnss.hdop = getHdopFromGnssData(gnssData);
+    gnss.vitesse = getValueOfGnssData(gnssData, 6);
+    gnss.cap = getValueOfGnssData(gnssData, 7);
+    if (getValueOfGnssData(gnssData, 10).length() > 0)
+        gnss.hdop = getHdopFromGnssData(gnssData);
+    gnss.satellites = getValueOfGnssData(gnssData, 15);
+    gnss.cn0 = getValueOfGnssData(gnssData, 18);
 
     return gnss;
 }
@@ -0,0 +1,234 @@
+/**
+ * @file SIMPLIFICATION.cpp
+ * @brief Simplification de trajectoire avant l'envoi : suppression des points quasi alignés.
+ *
+ * En déplacement, la plupart des points d'un lot sont presque alignés avec leurs voisins.
+ * Le simplificateur applique une variante en ligne de Douglas-Peucker (fenêtre glissante, "opening window") :
+ * - le dernier point gardé sert d'ancre ; les points suivants s'accumulent dans une fenêtre bornée,
+ * - à chaque nouveau point P, chaque point de la fenêtre est comparé au segment ancre -> P,
+ * - si l'un d'eux s'en écarte de plus de toleranceM (ou si la fenêtre est pleine), le point précédant P est gardé
+ *   et devient la nouvelle ancre.
+ * Les virages (changement de cap) et les débuts / fins d'arrêt sont toujours gardés, ainsi que le premier
+ * et le dernier point du lot.
+ *
+ * Les distances sont calculées dans le plan tangent de l'ancre (GEODESIE, en mm) et comparées sans racine
+ * ni division : |AQ x AP| > tolérance x |AP|. Une seule racine entière est calculée par point reçu.
+ *
+ * simplifierDataGNSS() compacte dataGNSS sur place entre l'acquisition GNSS et STEP_COMPOSE_JSON.
+ * mesurerSimplification() donne sur l'hôte le taux de compression, l'erreur maximale et le coût en cycles par point.
+ */
+
+#include "SIMPLIFICATION.hpp"
+
+SimplificateurTrajectoire simplificateur; ///< Simplificateur appliqué à chaque lot avant composition du message.
+
+SimplificateurTrajectoire::SimplificateurTrajectoire()
+{
+    reinitialiser();
+}
+
+void SimplificateurTrajectoire::reinitialiser()
+{
+    aAncre = false;
+    nbFenetre = 0;
+    arretPrecedent = false;
+}
+
+static bool estArrete(const Echantillon &e, int16_t seuil)
+{
+    return e.vitesseDixiemes >= 0 && e.vitesseDixiemes < seuil;
+}
+
+void SimplificateurTrajectoire::emettre(const PointTrajectoire &p, uint16_t *sortie, uint8_t &n)
+{
+    sortie[n++] = p.indice;
+    stats.nbSorties++;
+    ancre = p;
+    aAncre = true;
+    nbFenetre = 0;
+}
+
+// Vrai si un point de la fenêtre s'écarte de plus de toleranceM du segment ancre -> e
+bool SimplificateurTrajectoire::depasseTolerance(const Echantillon &e) const
+{
+    int32_t px, py;
+    projeterMm(ancre.e.latE6, ancre.e.lonE6, e.latE6, e.lonE6, px, py);
+    int64_t longueur2 = (int64_t)px * px + (int64_t)py * py;
+    int64_t tolerance = (int64_t)config.toleranceM * 1000;
+    int64_t seuil = tolerance * racineEntiere((uint64_t)longueur2);
+
+    for (uint8_t i = 0; i < nbFenetre; ++i)
+    {
+        int32_t qx, qy;
+        projeterMm(ancre.e.latE6, ancre.e.lonE6, fenetre[i].e.latE6, fenetre[i].e.lonE6, qx, qy);
+        int64_t produitScalaire = (int64_t)qx * px + (int64_t)qy * py;
+        if (produitScalaire <= 0 || produitScalaire >= longueur2)
+        {
+            // Projection hors du segment : distance à l'extrémité la plus proche
+            int64_t dx = produitScalaire <= 0 ? qx : (int64_t)qx - px;
+            int64_t dy = produitScalaire <= 0 ? qy : (int64_t)qy - py;
+            if (dx * dx + dy * dy > tolerance * tolerance)
+                return true;
+        }
+        else
+        {
+            int64_t produitVectoriel = (int64_t)qx * py - (int64_t)qy * px;
+            if (produitVectoriel < 0)
+                produitVectoriel = -produitVectoriel;
+            if (produitVectoriel > seuil)
+                return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Reçoit le point suivant de la trajectoire.
+ * @param indice Position du point dans le tableau d'origine.
+ * @param sortie Indices des points gardés par cet appel, dans l'ordre.
+ * @return Le nombre de points gardés (0 à 2).
+ */
+uint8_t SimplificateurTrajectoire::ajouter(const Echantillon &e, uint16_t indice, uint16_t sortie[2])
+{
+    uint8_t n = 0;
+    PointTrajectoire p;
+    p.e = e;
+    p.indice = indice;
+    stats.nbEntrees++;
+
+    bool arret = estArrete(e, config.seuilArretDixiemes);
+    if (!aAncre || !config.actif)
+    {
+        arretPrecedent = arret;
+        emettre(p, sortie, n);
+        return n;
+    }
+
+    uint8_t fenetreMax = config.fenetreMax > TAILLE_FENETRE_SIMPLIFICATION ? TAILLE_FENETRE_SIMPLIFICATION : config.fenetreMax;
+    if (nbFenetre > 0 && (nbFenetre >= fenetreMax || depasseTolerance(e)))
+        emettre(fenetre[nbFenetre - 1], sortie, n);
+
+    const PointTrajectoire &precedent = nbFenetre > 0 ? fenetre[nbFenetre - 1] : ancre;
+    bool virage = !arret && e.capDegres >= 0 && precedent.e.capDegres >= 0 &&
+                  ecartCapDegres(e.capDegres, precedent.e.capDegres) >= config.seuilVirageDegres;
+    bool transition = arret != arretPrecedent;
+    arretPrecedent = arret;
+    if (virage || transition)
+    {
+        if (virage)
+            stats.nbVirages++;
+        else
+            stats.nbArrets++;
+        emettre(p, sortie, n);
+        return n;
+    }
+
+    fenetre[nbFenetre++] = p;
+    return n;
+}
+
+/**
+ * @brief Fin du lot : le dernier point en attente est toujours gardé.
+ */
+uint8_t SimplificateurTrajectoire::terminer(uint16_t sortie[1])
+{
+    uint8_t n = 0;
+    if (nbFenetre > 0)
+        emettre(fenetre[nbFenetre - 1], sortie, n);
+    reinitialiser();
+    return n;
+}
+
+/**
+ * @brief Simplifie une trace complète.
+ * @param gardes Reçoit les indices des points gardés (nb entrées au plus).
+ * @return Le nombre de points gardés.
+ */
+int simplifierTrace(const Echantillon *trace, int nb, const ConfigSimplification &config, uint16_t *gardes)
+{
+    SimplificateurTrajectoire s;
+    s.config = config;
+    int n = 0;
+    for (int i = 0; i < nb; ++i)
+        n += s.ajouter(trace[i], (uint16_t)i, gardes + n);
+    n += s.terminer(gardes + n);
+    return n;
+}
+
+/**
+ * @brief Compacte dataGNSS sur place en ne gardant que les points utiles au tracé.
+ * @return Le nouveau nombre de coordonnées.
+ */
+int simplifierDataGNSS(DataGNSS *donnees, int nb)
+{
+    if (!simplificateur.config.actif || nb <= 2)
+        return nb;
+    simplificateur.reinitialiser();
+    int ecrits = 0;
+    uint16_t sortie[2];
+    // Les indices gardés sont croissants et jamais inférieurs à ecrits : la copie sur place est sûre
+    for (int i = 0; i < nb; ++i)
+    {
+        uint8_t n = simplificateur.ajouter(echantillonDepuisGnss(donnees[i].gnss, 0), (uint16_t)i, sortie);
+        for (uint8_t k = 0; k < n; ++k)
+            donnees[ecrits++] = donnees[sortie[k]];
+    }
+    uint8_t n = simplificateur.terminer(sortie);
+    for (uint8_t k = 0; k < n; ++k)
+        donnees[ecrits++] = donnees[sortie[k]];
+    return ecrits;
+}
+
+// Distance (mm) du point q au segment a -> b
+static uint32_t distanceSegmentMm(const Echantillon &a, const Echantillon &b, const Echantillon &q)
+{
+    int32_t px, py, qx, qy;
+    projeterMm(a.latE6, a.lonE6, b.latE6, b.lonE6, px, py);
+    projeterMm(a.latE6, a.lonE6, q.latE6, q.lonE6, qx, qy);
+    int64_t longueur2 = (int64_t)px * px + (int64_t)py * py;
+    int64_t produitScalaire = (int64_t)qx * px + (int64_t)qy * py;
+    if (longueur2 == 0 || produitScalaire <= 0)
+        return racineEntiere((uint64_t)((int64_t)qx * qx + (int64_t)qy * qy));
+    if (produitScalaire >= longueur2)
+        return racineEntiere((uint64_t)(((int64_t)qx - px) * (qx - px) + ((int64_t)qy - py) * (qy - py)));
+    int64_t produitVectoriel = (int64_t)qx * py - (int64_t)qy * px;
+    if (produitVectoriel < 0)
+        produitVectoriel = -produitVectoriel;
+    return (uint32_t)(produitVectoriel / racineEntiere((uint64_t)longueur2));
+}
+
+/**
+ * @brief Simplifie une trace et mesure le taux de compression, l'erreur maximale et le coût en cycles par point.
+ * @param gardes Tampon d'au moins nb indices.
+ */
+RapportSimplification mesurerSimplification(const Echantillon *trace, int nb, const ConfigSimplification &config, uint16_t *gardes)
+{
+    RapportSimplification rapport;
+    uint32_t debut = compteurCycles();
+    int n = simplifierTrace(trace, nb, config, gardes);
+    uint32_t cycles = compteurCycles() - debut;
+
+    rapport.nbEntrees = nb;
+    rapport.nbSorties = n;
+    if (n > 0)
+        rapport.ratioCentiemes = (uint32_t)nb * 100 / n;
+    if (nb > 0)
+        rapport.cyclesParPoint = cycles / nb;
+
+    for (int k = 0; k + 1 < n; ++k)
+        for (int i = gardes[k] + 1; i < gardes[k + 1]; ++i)
+        {
+            uint32_t erreur = (distanceSegmentMm(trace[gardes[k]], trace[gardes[k + 1]], trace[i]) + 500) / 1000;
+            if (erreur > rapport.erreurMaxM)
+                rapport.erreurMaxM = erreur;
+        }
+    return rapport;
+}
+
+void afficherRapportSimplification(const RapportSimplification &rapport)
+{
+    Serial.println("[SIMPLIFICATION] points : " + String(rapport.nbSorties) + " / " + String(rapport.nbEntrees));
+    Serial.println("[SIMPLIFICATION] compression (x100) : " + String(rapport.ratioCentiemes));
+    Serial.println("[SIMPLIFICATION] erreur max (m) : " + String(rapport.erreurMaxM));
+    Serial.println("[SIMPLIFICATION] cycles par point : " + String(rapport.cyclesParPoint));
+}
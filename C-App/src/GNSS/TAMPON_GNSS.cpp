@@ -0,0 +1,248 @@
+/**
+ * @file TAMPON_GNSS.cpp
+ * @brief Tampon des fixes en attente d'envoi, avec décimation progressive quand le lien montant est coupé.
+ *
+ * Historiquement, addGNSSInDataGNSS() écrase le plus ancien fix quand dataGNSS est plein, et l'acquisition d'un cycle
+ * s'arrête dès que le tableau est plein : pendant une coupure, le tableau reste figé sur un seul instant.
+ *
+ * En mode décimation, au début de chaque cycle (preparerCycle), si des fixes attendent encore leur envoi,
+ * placeCycle places sont libérées en fusionnant les points les plus rapprochés dans le temps : le point retiré est celui
+ * dont la disparition laisse le plus petit trou entre ses deux voisins (le plus ancien en cas d'égalité).
+ * Le premier et le dernier point sont toujours gardés : une coupure de plusieurs heures reste couverte de bout en bout,
+ * avec des points de plus en plus espacés mais répartis sur toute sa durée.
+ * - Mémoire constante : le tableau dataGNSS existant ; l'âge de chaque point vient de son horodatage,
+ *   ce qui reste juste après la simplification (SIMPLIFICATION) et la reprise depuis la mémoire RTC.
+ * - Coût : chaque point retiré demande un parcours du tampon, borné par maxPoints (<= MAX_COORDS),
+ *   soit O(1) par ajout.
+ * - Un fix plus proche du précédent que espacementMinS et espacementMinM est fusionné avec lui (non ajouté).
+ *
+ * simulerPanne() rejoue sur l'hôte une coupure de plusieurs heures et mesure la couverture obtenue.
+ */
+
+#include "TAMPON_GNSS.hpp"
+#include "GnssUtils.hpp"
+
+TamponGnss tamponGnss; ///< Politique appliquée à dataGNSS par addGNSSInDataGNSS().
+
+TamponGnss::TamponGnss()
+{
+    reinitialiser();
+}
+
+void TamponGnss::reinitialiser()
+{
+    stats = StatsTampon();
+}
+
+int TamponGnss::capacite() const
+{
+    int max = config.maxPoints;
+    if (max > MAX_COORDS)
+        max = MAX_COORDS;
+    return max < 1 ? 1 : max;
+}
+
+// Nombre de points au-delà duquel preparerCycle() décime
+int TamponGnss::cibleCycle() const
+{
+    int cible = capacite() - config.placeCycle;
+    return cible < 2 ? 2 : cible;
+}
+
+/**
+ * @brief Vrai si le lot doit partir avant le prochain cycle (sinon il serait décimé, ou écrasé en mode historique).
+ */
+bool TamponGnss::lotPret(int nb) const
+{
+    return config.decimation ? nb > cibleCycle() : plein(nb);
+}
+
+bool TamponGnss::tropProche(const Gnss &precedent, const Gnss &gnss) const
+{
+    if (config.espacementMinS == 0 && config.espacementMinM == 0)
+        return false;
+    if (config.espacementMinS > 0)
+    {
+        uint32_t a = horodatageVersSecondes(precedent.timeStamp);
+        uint32_t b = horodatageVersSecondes(gnss.timeStamp);
+        uint32_t ecart = a > b ? a - b : b - a;
+        if (a == 0 || b == 0 || ecart >= config.espacementMinS)
+            return false;
+    }
+    if (config.espacementMinM > 0)
+    {
+        uint32_t d = distanceM(degresVersE6(precedent.coordonnees.latitude.full), degresVersE6(precedent.coordonnees.longitude.full),
+                               degresVersE6(gnss.coordonnees.latitude.full), degresVersE6(gnss.coordonnees.longitude.full));
+        if (d >= config.espacementMinM)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Retire le point dont la disparition laisse le plus petit trou entre ses voisins (premier et dernier gardés).
+ *
+ * Sans horodatage exploitable, le plus ancien point après le premier est retiré.
+ */
+void TamponGnss::decimer(DataGNSS *donnees, int &nb)
+{
+    uint32_t t[MAX_COORDS];
+    bool horodate = true;
+    for (int i = 0; i < nb && i < MAX_COORDS; ++i)
+    {
+        t[i] = horodatageVersSecondes(donnees[i].gnss.timeStamp);
+        horodate = horodate && t[i] != 0;
+    }
+
+    int retire = 1;
+    if (horodate)
+    {
+        uint32_t plusPetitTrou = UINT32_MAX;
+        for (int i = 1; i < nb - 1; ++i)
+        {
+            uint32_t trou = t[i + 1] - t[i - 1];
+            if (trou < plusPetitTrou)
+            {
+                plusPetitTrou = trou;
+                retire = i;
+            }
+        }
+    }
+    for (int i = retire + 1; i < nb; ++i)
+        donnees[i - 1] = donnees[i];
+    nb--;
+    stats.nbSupprimes++;
+}
+
+/**
+ * @brief Ajoute un fix au tampon en appliquant la politique configurée.
+ * @return false si le fix a été fusionné avec le précédent (non ajouté).
+ */
+bool TamponGnss::ajouter(DataGNSS *donnees, int &nb, const Gnss &gnss)
+{
+    if (nb > 0 && tropProche(donnees[nb - 1].gnss, gnss))
+    {
+        stats.nbFusionnes++;
+        return false;
+    }
+    while (nb >= capacite())
+    {
+        if (config.decimation && nb >= 3)
+            decimer(donnees, nb);
+        else
+        {
+            shiftLeftDataGNSS(donnees, nb);
+            stats.nbEcrases++;
+        }
+    }
+    donnees[nb] = DataGNSS();
+    donnees[nb].gnss = gnss;
+    nb++;
+    stats.nbAjouts++;
+    return true;
+}
+
+/**
+ * @brief Début d'un cycle d'acquisition : libère placeCycle places si des fixes non envoyés remplissent le tampon.
+ */
+void TamponGnss::preparerCycle(DataGNSS *donnees, int &nb)
+{
+    int cible = cibleCycle();
+    if (!config.decimation || nb <= cible)
+        return;
+    while (nb > cible)
+        decimer(donnees, nb);
+    stats.nbDecimations++;
+}
+
+/**
+ * @brief Simule une coupure du lien montant : chaque cycle ajoute ses fixes sans qu'aucun envoi ne vide le tampon.
+ *
+ * Le coût mesuré (cycles par ajout) comprend la préparation de chaque cycle.
+ * Les fixes avancent vers le nord (36 km/h) ; seul l'horodatage sert aux mesures de couverture.
+ */
+RapportPanne simulerPanne(const ScenarioPanne &scenario, const ConfigTampon &config)
+{
+    RapportPanne rapport;
+    TamponGnss tampon;
+    tampon.config = config;
+    DataGNSS donnees[MAX_COORDS];
+    int nb = 0;
+    const uint32_t debut = horodatageVersSecondes("20250612000000.000");
+    uint64_t cycles = 0;
+
+    for (unsigned long cycle = 0; cycle < scenario.dureePanneS; cycle += scenario.periodeCycleS)
+    {
+        uint32_t avantCycle = compteurCycles();
+        tampon.preparerCycle(donnees, nb);
+        cycles += compteurCycles() - avantCycle;
+        // Comme STEP_GNSS : l'acquisition s'arrête quand le tampon est plein
+        for (uint8_t k = 0; k < scenario.pointsParCycle && !tampon.plein(nb); ++k)
+        {
+            unsigned long t = cycle + k * scenario.intervalleFixS;
+            if (t >= scenario.dureePanneS)
+                break;
+            Gnss gnss;
+            gnss.timeStamp = secondesVersHorodatage(debut + t);
+            gnss.coordonnees.latitude.full = e6VersDegres(50634412 + (int32_t)(t * 90));
+            gnss.coordonnees.longitude.full = e6VersDegres(3048687);
+            uint32_t avant = compteurCycles();
+            tampon.ajouter(donnees, nb, gnss);
+            cycles += compteurCycles() - avant;
+        }
+    }
+
+    rapport.nbAjouts = tampon.stats.nbAjouts;
+    rapport.nbPoints = nb;
+    if (rapport.nbAjouts > 0)
+        rapport.cyclesParAjout = (uint32_t)(cycles / rapport.nbAjouts);
+    if (nb == 0)
+        return rapport;
+
+    uint32_t precedent = debut;
+    for (int i = 0; i < nb; ++i)
+    {
+        uint32_t t = horodatageVersSecondes(donnees[i].gnss.timeStamp);
+        if (t - precedent > rapport.ecartMaxS)
+            rapport.ecartMaxS = t - precedent;
+        precedent = t;
+    }
+    if (debut + scenario.dureePanneS - precedent > rapport.ecartMaxS)
+        rapport.ecartMaxS = debut + scenario.dureePanneS - precedent;
+    rapport.couvertureS = horodatageVersSecondes(donnees[nb - 1].gnss.timeStamp) - horodatageVersSecondes(donnees[0].gnss.timeStamp);
+    return rapport;
+}
+
+/**
+ * @brief Options reçues du serveur : {"decimation": bool, "maxPoints": n, "placeCycle": n, "espacementMinS": s, "espacementMinM": m}.
+ */
+void chargerOptionsTampon(const json &options)
+{
+    if (options.contains("decimation"))
+        tamponGnss.config.decimation = options["decimation"].get<bool>();
+    if (options.contains("maxPoints"))
+        tamponGnss.config.maxPoints = options["maxPoints"].get<uint8_t>();
+    if (options.contains("placeCycle"))
+        tamponGnss.config.placeCycle = options["placeCycle"].get<uint8_t>();
+    if (options.contains("espacementMinS"))
+        tamponGnss.config.espacementMinS = options["espacementMinS"].get<uint32_t>();
+    if (options.contains("espacementMinM"))
+        tamponGnss.config.espacementMinM = options["espacementMinM"].get<uint32_t>();
+}
+
+void afficherRapportPanne(const RapportPanne &rapport)
+{
+    Serial.println("[TAMPON] points gardes : " + String(rapport.nbPoints) + " / " + String(rapport.nbAjouts));
+    Serial.println("[TAMPON] couverture (s) : " + String(rapport.couvertureS) + " / ecart max (s) : " + String(rapport.ecartMaxS));
+    Serial.println("[TAMPON] cycles par ajout : " + String(rapport.cyclesParAjout));
+}
+
+void afficherStatsTampon()
+{
+    const StatsTampon &s = tamponGnss.stats;
+    if (s.nbDecimations == 0 && s.nbEcrases == 0 && s.nbFusionnes == 0)
+        return;
+    Serial.println("[TAMPON] ajouts : " + String(s.nbAjouts) + " / fusionnes : " + String(s.nbFusionnes) +
+                   " / decimations : " + String(s.nbDecimations) + " (" + String(s.nbSupprimes) + " points)" +
+                   " / ecrases : " + String(s.nbEcrases));
+}
@@ -9,13 +9,21 @@
  * - Passage à l'étape suivante du pipeline une fois la connexion établie.
  *
  * Il permet ainsi de s'assurer que le module 4G est prêt à transmettre les données au serveur distant.
+ * Au démarrage, catm1DemarrageRapide() permet de sauter tout ou partie de cette configuration
+ * lorsque le modem est déjà configuré (voir SIM7080G_DEMARRAGE).
+ * Après une perte de session que ni le contexte PDP ni le ré-attachement n'ont rétablie, catm1Reconfigurer()
+ * relance la configuration complète (voir SESSION_RESEAU). Le format des +CEREG (n=1 pour le suivi de session)
+ * est ramené à n=0 le temps de l'attente de l'enregistrement, puis rétabli par negocierPSM().
  */
 
 #include "SIM7080G_CATM1.hpp"
 #include "SIM7080G_SERIAL.hpp"
+#include "SIM7080G_DEMARRAGE.hpp"
+#include "SESSION_RESEAU.hpp"
+#include "QUALITE_LIEN.hpp"
 
 ATCommandTask taskCATM1_CEREG("AT+CEREG?", "+CEREG: 0,5", 15, 100);
-ATCommandTask taskCATM1_CGDCONT("AT+CGDCONT=1,\"IP\",\"iot.1nce.net\"", "OK", 10, 100);
+ATCommandTask taskCATM1_CGDCONT("AT+CGDCONT=1,\"IP\",\"" APN_RESEAU "\"", "OK", 10, 100);
 MachineEtat machineCATM1;
 
 enum StepCATM1State
@@ -47,6 +55,25 @@ String findSelect(String data, String nameStart, int numberPassAfterNameStart, S
     return result;
 }
 
+/**
+ * @brief Reprend la configuration réseau sans la refaire entièrement.
+ * @param pdpActif true si le contexte PDP est déjà actif (configuration sautée),
+ *                 false pour reprendre à l'attachement (CEREG / CNACT) sans reconfigurer le profil.
+ */
+void catm1DemarrageRapide(bool pdpActif)
+{
+    currentStepCATM1 = pdpActif ? CATM1_DONE : CATM1_INFO;
+}
+
+/**
+ * @brief Dernière marche de la reprise réseau : configuration complète, puis retour au pipeline d'envoi.
+ */
+void catm1Reconfigurer()
+{
+    currentStepCATM1 = CATM1_POWER_ON;
+    currentStep4G = STEP_SETUP_CATM1;
+}
+
 void step_catm1_function()
 {
     switch (currentStepCATM1)
@@ -65,15 +92,23 @@ void step_catm1_function()
         if (machineCATM1.updateATState(taskCATM1_CGDCONT))
         {
             Send_AT("AT+CGNAPN");
-            Send_AT("AT+CNCFG=0,1,iot.1nce.net");
+            Send_AT("AT+CNCFG=0,1," APN_RESEAU);
             currentStepCATM1 = CATM1_INFO;
         }
         break;
 
     case CATM1_INFO:
         Serial.println("[CATM1_INFO]");
+        // taskCATM1_CEREG attend le format n=0 ("+CEREG: 0,5") : negocierPSM() a pu laisser n=1 (SESSION_RESEAU)
+        // lors d'un attachement précédent ; il le rétablit à la fin de cette étape
+        if (taskCATM1_CEREG.state == IDLE)
+            Send_AT("AT+CEREG=0");
         if (machineCATM1.updateATState(taskCATM1_CEREG))
         {
+            // Chaque reprise (catm1Reconfigurer, catm1DemarrageRapide) relit l'enregistrement
+            taskCATM1_CEREG.state = IDLE;
+            taskCATM1_CEREG.isFinished = false;
+
             String resultPDP = findSelect(Send_AT("AT+CNACT=0,1", 15000), "PDP", 4, ",", " ");
             if (resultPDP == "ACTIVE")
             {
@@ -81,17 +116,18 @@ void step_catm1_function()
             }
 
             Send_AT("AT+CGATT?");
-            Send_AT("AT+CNACT?", 3000);
+            sessionReseau.traiter(Send_AT("AT+CNACT?", 3000), millis());
             String resultCNACT = findSelect(Send_AT("AT+CNACT?", 3000), "+CNACT:", 12, "\"", ".");
             if (resultCNACT == "10")
             {
                 Serial.println("10 detecté");
             }
-            Send_AT("AT+GSN");
-            Send_AT("AT+CCID");
             Send_AT("AT+COPS?");
-            Send_AT("AT+CEREG?");
-            Send_AT("AT+CSQ");
+            sessionReseau.traiter(Send_AT("AT+CEREG?"), millis());
+            qualiteLien.observer(Send_AT("AT+CSQ"), millis());
+            negocierPSM(calculerConfigPSM(periodeAjustement));
+            memoriserConfigReseau();
+            sessionReseau.configurationTerminee(millis());
             currentStepCATM1 = CATM1_DONE;
         }
         break;
@@ -103,6 +139,7 @@ void step_catm1_function()
 
     case CATM1_DONE:
         Serial.println("[CATM1_DONE]");
+        mettreAJourXtraSiNecessaire(millis()); // profite de la liaison LTE pour l'assistance GNSS
         currentStep4G = STEP_SEND_CBOR;
         break;
     }
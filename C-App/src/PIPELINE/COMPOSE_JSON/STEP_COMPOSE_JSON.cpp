@@ -4,10 +4,32 @@
  *
  * Ce fichier est responsable de la création du tableau JSON contenant toutes les coordonnées GNSS à envoyer.
  * Pour chaque coordonnée, il construit une chaîne JSON avec l'IMEI, la latitude et la longitude, puis assemble toutes ces chaînes dans un tableau JSON global.
+ * Une position réseau (POSITION_CELLULE) porte en plus sa source ("clbs" ou "cellule") et son rayon d'incertitude ("precision", en m).
+ * Chaque point porte son heure UTC ("horodatage", en ms depuis le 01/01/1970, BASE_TEMPS) quand elle est connue.
+ * Chaque point est en général déjà composé (DataGNSS::fragment) : addGNSSInDataGNSS() le compose pendant l'acquisition,
+ * quand la radio est au GNSS et que le CPU attend les fixes. Seuls les points restaurés de la mémoire RTC sont composés ici.
+ * Les événements d'entrée / sortie de géofence en attente sont ajoutés au tableau, avec les champs "geofence" et "evenement" ;
+ * ils restent en file jusqu'à la livraison du message (STEP_END).
  * Ce tableau est ensuite prêt à être envoyé au serveur distant lors de l'étape suivante du pipeline.
  */
 
 #include "PIPELINE_GLOBAL.hpp"
+#include "BASE_TEMPS.hpp"
+
+/**
+ * @brief Compose le fragment JSON d'un point : IMEI, latitude, longitude, heure UTC (et source / précision d'une position réseau).
+ */
+String fragmentJSON(const Gnss &gnss)
+{
+    String fragment = String("{\"imei\":\"") + imei +
+                      "\",\"latitude\":" + gnss.coordonnees.latitude.full +
+                      ",\"longitude\":" + gnss.coordonnees.longitude.full;
+    if (gnss.source != SOURCE_GNSS)
+        fragment += String(",\"source\":\"") + nomSourcePosition(gnss.source) +
+                    "\",\"precision\":" + String(gnss.precisionM);
+    fragment += champHorodatageJSON(horodatageVersEpochMs(gnss.timeStamp));
+    return fragment + "}";
+}
 
 /**
  * @brief Compose le tableau JSON à partir des coordonnées GNSS.
@@ -19,12 +41,16 @@ void step_compose_json_function()
 {
     for (int i = 0; i < nbCoordonnees; ++i)
     {
-        String latitude = dataGNSS[i].gnss.coordonnees.latitude.full;
-        String longitude = dataGNSS[i].gnss.coordonnees.longitude.full;
-
-        listeCoordonnees[i].data = String("{\"imei\":\"") + imei +
-                                   "\",\"latitude\":" + latitude +
-                                   ",\"longitude\":" + longitude + "}";
+        if (dataGNSS[i].fragment.length() > 0)
+        {
+            listeCoordonnees[i].data = dataGNSS[i].fragment;
+            arbitreRadio.stats.nbFragmentsPrets++;
+        }
+        else
+        {
+            listeCoordonnees[i].data = fragmentJSON(dataGNSS[i].gnss);
+            arbitreRadio.stats.nbFragmentsComposes++;
+        }
     }
     tableauJSONString = "[";
     for (int i = 0; i < nbCoordonnees; ++i)
@@ -33,10 +59,19 @@ void step_compose_json_function()
         if (i < nbCoordonnees - 1)
             tableauJSONString += ",";
     }
+    String evenements = evenementsGeofenceJSON();
+    geofences.noterEvenementsEnvoyes(evenements.length() > 0 ? geofences.nbEvenements() : 0);
+    if (evenements.length() > 0)
+    {
+        if (nbCoordonnees > 0)
+            tableauJSONString += ",";
+        tableauJSONString += evenements;
+    }
     tableauJSONString += "]";
 
     Serial.println("Sending coordinates to the remote server +++++++++++++++++");
     Serial.println(tableauJSONString);
 
+    arbitreRadio.ouvrirFenetreLte(millis(), nbCoordonnees);
     currentStepGLOBAL = PipelineGLOBAL::STEP_SEND_4G;
 }
\ No newline at end of file
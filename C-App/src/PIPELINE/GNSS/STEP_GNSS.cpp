@@ -5,10 +5,31 @@
  * @brief Fonction principale de gestion du pipeline GNSS.
  *
  * Cette fonction implémente une machine d'états pour piloter le module GNSS :
- * - GNSS_POWER_ON : Active le module GNSS via une commande AT et gère les erreurs éventuelles.
- * - GNSS_INFO : Interroge le module pour récupérer les informations GNSS (mode, état, coordonnées). Si des coordonnées valides sont reçues, elles sont ajoutées à la liste.
- * - GNSS_POWER_OFF : Désactive le module GNSS proprement.
- * - GNSS_DONE : Passe à l'étape suivante du pipeline global (composition du JSON) et réinitialise l'automate GNSS.
+ * - GNSS_POWER_ON : Applique les constellations choisies, active le module GNSS via une commande AT et gère les erreurs éventuelles.
+ *   Si le GNSS est resté allumé depuis la fenêtre précédente, la fenêtre démarre sans commande.
+ * - GNSS_INFO : En mode flux (par défaut), lit les URC +UGNSINF envoyées à chaque fix (voir FLUX_GNSS).
+ *   En mode sondage, interroge le module (état, coordonnées). Si des coordonnées valides sont reçues, elles sont ajoutées à la liste.
+ *   La réponse AT+CGNSINF est gardée en cache pour l'époque en cours (CACHE_FIX) : getGNSSValid() la relit en mémoire,
+ *   et un fix dont l'horodatage UTC a déjà été lu est écarté.
+ * - GNSS_POWER_OFF : Désactive le module GNSS proprement. L'arbitre radio (ARBITRE_RADIO) peut garder le GNSS allumé
+ *   quand aucun envoi n'est nécessaire et que la prochaine fenêtre GNSS est proche : GNSS_POWER_OFF est alors sauté.
+ * - GNSS_REPLI_RESEAU : GNSS éteint, attend la réponse à AT+CLBS sans bloquer la boucle, puis termine la fenêtre.
+ * - GNSS_DONE : Simplifie le lot (SIMPLIFICATION), passe à l'étape suivante du pipeline global (composition du JSON)
+ *   et réinitialise l'automate GNSS. L'envoi n'a lieu que si l'arbitre radio a ouvert une fenêtre LTE (lot prêt,
+ *   latence maximale, événement de géofence) ; avec l'option géofence envoiSurEvenement, il est aussi sauté tant qu'aucun
+ *   événement n'est en attente et que le heartbeat n'est pas dû.
+ *
+ * Les fixes passent par l'échantillonneur adaptatif (ECHANTILLONNAGE) : à l'arrêt, un seul point "toujours là"
+ * est gardé et l'acquisition se termine aussitôt ; en déplacement, l'intervalle suit la vitesse.
+ *
+ * Quand des fixes attendent encore leur envoi (lien montant coupé), le tampon (TAMPON_GNSS) est décimé au début
+ * du cycle pour laisser de la place aux nouveaux fixes.
+ *
+ * Le TTFF de chaque acquisition est mesuré par ASSISTANCE_GNSS (debutAcquisition / enregistrerFixAcquisition / finAcquisition).
+ *
+ * Sans fix GNSS dans le délai de la stratégie de positionnement (POSITION_CELLULE), une position réseau grossière
+ * (cellule connue ou AT+CLBS) est ajoutée au lot et termine l'acquisition : le GNSS retente au cycle suivant.
+ * AT+CLBS partage la radio avec le GNSS : il n'est envoyé qu'après AT+CGNSPWR=0, et un échec termine aussi la fenêtre.
  *
  * Chaque état utilise la machine d'état pour valider l'exécution des commandes AT et gérer la transition vers l'état suivant.
  */
@@ -29,6 +50,47 @@ void gnssErrorPowerOn(ATCommandTask &task)
     Serial.println("[ERROR] Aucun gestionnaire d'erreur spécifique");
 }
 
+static void demarrerFenetreGnss()
+{
+    arbitreRadio.gnssAllume(millis());
+    debutAcquisition(millis());
+    debutInfoGnss(millis());
+    cacheFix.invalider();
+    echantillonneur.debutCycle();
+    tamponGnss.preparerCycle(dataGNSS, nbCoordonnees);
+    strategiePosition.debutCycle(millis());
+    gnssStepState = StepGNSSState::GNSS_INFO;
+}
+
+// Lot plein (tampon ou fragment AT+CASEND), arrêt détecté, ou plus ancien fix arrivé au bout de sa latence maximale
+static bool acquisitionTerminee()
+{
+    if (tamponGnss.plein(nbCoordonnees) || envoiFragmente.lotRempli(nbCoordonnees) || echantillonneur.acquisitionTerminee())
+        return true;
+    if (!arbitreRadio.envoiUrgent(ageAncienFix(dataGNSS, nbCoordonnees, millis())))
+        return false;
+    arbitreRadio.stats.nbFinsAnticipees++;
+    return true;
+}
+
+// Fin de la fenêtre GNSS : l'arbitre décide de l'envoi et de l'extinction du GNSS (déjà faite avant AT+CLBS)
+static void terminerFenetreGnss(bool gnssEteint = false)
+{
+    finInfoGnss(millis());
+    bool lotPret = tamponGnss.lotPret(nbCoordonnees) || envoiFragmente.lotRempli(nbCoordonnees);
+    DecisionRadio decision = arbitreRadio.decider(lotPret, geofences.nbEvenements() > 0,
+                                                  ageAncienFix(dataGNSS, nbCoordonnees, millis()), periodeAjustement, millis(),
+                                                  qualiteLien.niveau(millis()));
+    if (decision == RADIO_MAINTENIR_GNSS || gnssEteint)
+    {
+        finAcquisition(millis());
+        strategiePosition.finCycle();
+        gnssStepState = StepGNSSState::GNSS_DONE;
+    }
+    else
+        gnssStepState = StepGNSSState::GNSS_POWER_OFF;
+}
+
 void step_gnss_function()
 {
     Serial.println("[STEP_GNSS]");
@@ -38,36 +100,90 @@ void step_gnss_function()
     {
 
         Serial.println("------>GNSS_POWER_ON[START]");
+        if (arbitreRadio.estGnssAllume())
+        {
+            // Resté allumé depuis la fenêtre précédente (ARBITRE_RADIO) : pas d'AT+CGNSPWR=1
+            Serial.println("------>GNSS_POWER_ON[DEJA ALLUME]");
+            demarrerFenetreGnss();
+            break;
+        }
+        if (gnssPowerOnCommand.state == IDLE)
+            appliquerConstellations();
         gnssPowerOnCommand.onErrorCallback = gnssErrorPowerOn;
         if (machineGNSS.updateATState(gnssPowerOnCommand))
         {
             Serial.println("------>GNSS_POWER_ON[OK]");
             gnssPowerOnCommand.state = IDLE;
-            gnssStepState = StepGNSSState::GNSS_INFO;
+            energie.setEtatGnss(GNSS_ALLUME, millis());
+            demarrerFenetreGnss();
         }
     }
     break;
 
     case GNSS_INFO:
     {
+        if (strategiePosition.repliNecessaire(millis()))
+        {
+            Gnss position;
+            if (strategiePosition.positionDeRepli(position, millis()))
+            {
+                // Position grossière envoyée dans ce cycle ; le GNSS libère la radio et retentera au prochain
+                Serial.println(String("[POSITION] repli ") + nomSourcePosition(position.source) + " : " +
+                               position.coordonnees.latitude.full + ", " + position.coordonnees.longitude.full +
+                               " (" + String(position.precisionM) + " m)");
+                addGNSSInDataGNSS(position);
+                desactiverFluxGnss();
+                terminerFenetreGnss();
+                break;
+            }
+            if (strategiePosition.repliEnCours())
+            {
+                // AT+CLBS après l'extinction du GNSS (GNSS_POWER_OFF, puis GNSS_REPLI_RESEAU)
+                desactiverFluxGnss();
+                gnssStepState = StepGNSSState::GNSS_POWER_OFF;
+                break;
+            }
+        }
+        if (fluxGnss.mode == GNSS_MODE_FLUX && (fluxGnss.actif || activerFluxGnss()))
+        {
+            // Les fixes arrivent d'eux-mêmes (+UGNSINF) : aucune commande AT
+            pomperFluxGnss(millis());
+            if (acquisitionTerminee())
+            {
+                desactiverFluxGnss();
+                terminerFenetreGnss();
+            }
+            break;
+        }
 
-        Serial.println(Send_AT("AT+CGNSMOD?"));
+        uint32_t octetsAvant = octetsUartEmis + octetsUartRecus;
+        uint32_t transactionsAvant = nbTransactionsAT;
         Serial.println(Send_AT("AT+CGNSPWR?", 500));
-        String response = Send_AT("AT+CGNSINF", 2000);
+        cacheFix.lire(millis());
 
-        if (nbCoordonnees < MAX_COORDS && (millis() - periodGNSS) > 3000)
+        bool termine = acquisitionTerminee();
+        if (!termine && (millis() - periodGNSS) > echantillonneur.intervalleMs())
         {
             periodGNSS = millis();
             Gnss gnss = getGNSSValid();
-            if (gnss.isValid)
+            if (gnss.isValid && echantillonneur.evaluer(echantillonDepuisGnss(gnss, millis())) != ECHANTILLON_IGNORE)
             {
                 addGNSSInDataGNSS(gnss);
+                energie.enregistrerFix();
+                enregistrerFixAcquisition(millis());
+                fluxGnss.statsSondage.nbFix++;
             }
         }
-        else if (nbCoordonnees >= MAX_COORDS)
+        else if (termine)
+        {
+            terminerFenetreGnss();
+        }
+        else
         {
-            gnssStepState = StepGNSSState::GNSS_POWER_OFF;
+            dormirJusqua(periodGNSS + echantillonneur.intervalleMs());
         }
+        fluxGnss.statsSondage.octets += octetsUartEmis + octetsUartRecus - octetsAvant;
+        fluxGnss.statsSondage.transactions += nbTransactionsAT - transactionsAvant;
         break;
     }
 
@@ -78,14 +194,60 @@ void step_gnss_function()
         {
             Serial.print("-->GNSS_POWER_OFF[OK]");
             gnssPowerOffCommand.state = IDLE;
+            energie.setEtatGnss(GNSS_ETEINT, millis());
+            arbitreRadio.gnssEteint(millis());
+            if (strategiePosition.repliEnCours())
+            {
+                gnssStepState = StepGNSSState::GNSS_REPLI_RESEAU;
+                break;
+            }
+            finAcquisition(millis());
+            strategiePosition.finCycle();
             gnssStepState = StepGNSSState::GNSS_DONE;
         }
         break;
     }
 
+    case GNSS_REPLI_RESEAU:
+    {
+        Gnss position;
+        if (strategiePosition.poursuivreClbs(position, millis()))
+        {
+            Serial.println(String("[POSITION] repli clbs : ") + position.coordonnees.latitude.full + ", " +
+                           position.coordonnees.longitude.full + " (" + String(position.precisionM) + " m)");
+            addGNSSInDataGNSS(position);
+            terminerFenetreGnss(true);
+        }
+        else if (!strategiePosition.repliEnCours())
+        {
+            // Pas de position réseau : le GNSS retente au cycle suivant, avec un délai doublé
+            terminerFenetreGnss(true);
+        }
+        break;
+    }
+
     case GNSS_DONE:
     {
-        currentStepGLOBAL = PipelineGLOBAL::STEP_COMPOSE_JSON;
+        memoriserCelluleServante();
+        nbCoordonnees = simplifierDataGNSS(dataGNSS, nbCoordonnees);
+        bool fenetreLte = arbitreRadio.derniereDecision() == RADIO_FENETRE_LTE;
+        if (fenetreLte && geofences.envoiNecessaire(millis()))
+        {
+            currentStepGLOBAL = PipelineGLOBAL::STEP_COMPOSE_JSON;
+        }
+        else
+        {
+            // Les fixes restent dans dataGNSS, envoi différé
+            if (fenetreLte)
+            {
+                Serial.println("[GEOFENCE] aucun evenement : envoi differe");
+                geofences.stats.nbEnvoisEvites++;
+            }
+            else
+                Serial.println("[RADIO] envoi differe : " + String(nbCoordonnees) + " fixes en attente");
+            period10min = millis();
+            currentStepGLOBAL = PipelineGLOBAL::STEP_END_GLOBAL;
+        }
         gnssStepState = StepGNSSState::GNSS_POWER_ON;
         break;
     }
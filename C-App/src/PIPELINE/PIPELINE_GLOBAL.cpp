@@ -16,6 +16,38 @@ PipelineGLOBAL currentStepGLOBAL = PipelineGLOBAL::STEP_INIT_GLOBAL;
  * @brief Variable globale indiquant l'étape courante du pipeline global.
  */
 
+/**
+ * @brief Rapport énergétique et statistiques des modules, un cycle sur CYCLES_RAPPORT_STATS : une vingtaine de lignes
+ *        série à chaque cycle retarderaient la mise en sommeil. Le compte de cycles de la comptabilité énergétique
+ *        survit au deep sleep (ETAT_RTC).
+ */
+static void afficherRapportCycle()
+{
+  if (energie.cycles() % CYCLES_RAPPORT_STATS != 0)
+    return;
+  mesurerBatterie();
+  afficherRapportEnergie(energie.rapport(millis(), profilCourant));
+  afficherStatsAcquisition();
+  afficherStatsFluxGnss();
+  afficherStatsCacheFix();
+  afficherStatsAcceptation();
+  afficherStatsTampon();
+  afficherStatsGeofence();
+  afficherStatsPosition();
+  afficherStatsArbitre();
+  afficherStatsBaseTemps();
+  afficherStatsSessionReseau();
+  afficherStatsQualiteLien();
+  afficherStatsEnvoi();
+  afficherStatsEcoute();
+  afficherStatsSockets();
+  afficherStatsCoap();
+  afficherStatsMqtt();
+  afficherStatsDns();
+  afficherStatsTls();
+  afficherStatsReprise();
+}
+
 /**
  * @brief Fonction principale du pipeline global.
  *
@@ -24,7 +56,9 @@ PipelineGLOBAL currentStepGLOBAL = PipelineGLOBAL::STEP_INIT_GLOBAL;
  * - STEP_GNSS : Acquisition des données GNSS.
  * - STEP_COMPOSE_JSON : Composition du message JSON.
  * - STEP_SEND_4G : Envoi des données via 4G.
- * - STEP_END_GLOBAL : Fin du pipeline et attente avant redémarrage.
+ * - STEP_END_GLOBAL : Fin du pipeline (statistiques affichées un cycle sur CYCLES_RAPPORT_STATS) et attente (en sommeil
+ *   si possible) avant redémarrage,
+ *   interrompue si besoin par une fenêtre d'entretien des éphémérides GNSS (sauf si le GNSS est resté allumé).
  */
 void pipelineGlobal()
 {
@@ -34,6 +68,7 @@ void pipelineGlobal()
 
   case STEP_INIT_GLOBAL:
     Serial.println("---------------------- Lancement Pipelie GLOBAL -------------------------------");
+    reveillerModemSiPSM();
     currentStepGLOBAL = PipelineGLOBAL::STEP_GNSS;
     break;
 
@@ -57,6 +92,27 @@ void pipelineGlobal()
       currentStepGLOBAL = PipelineGLOBAL::STEP_INIT_GLOBAL;
       tableauJSONString = "";
       stepReceiveFunctionBoolean = true;
+
+      energie.enregistrerCycle();
+      enregistrerPremierEnvoi();
+      afficherRapportCycle();
+    }
+    else
+    {
+      // Socket en écoute (ECOUTE_DESCENDANTE) ou abonnement MQTT : commandes du serveur lues à chaque tranche de sommeil,
+      // URC aiguillées vers leur destinataire par le premier lecteur (AIGUILLAGE_URC)
+      ecouteDescendante.servir(millis());
+      transportMqtt.servir(millis());
+      gestionPSM.veilleUart = transportMqtt.ecouteUart();
+      if (arbitreRadio.estGnssAllume())
+      {
+        // GNSS gardé allumé jusqu'à la prochaine fenêtre (ARBITRE_RADIO) : pas de fenêtre d'entretien
+        dormirJusqua(transportMqtt.reveil(millis(), ecouteDescendante.reveil(millis(), period10min + periodeAjustement)));
+      }
+      else if (!entretenirEphemerides(millis(), period10min + periodeAjustement))
+      {
+        dormirJusqua(transportMqtt.reveil(millis(), ecouteDescendante.reveil(millis(), echeanceEntretien(millis(), period10min + periodeAjustement))));
+      }
     }
     break;
   }
@@ -0,0 +1,347 @@
+/**
+ * @file ECOUTE_DESCENDANTE.cpp
+ * @brief Ecoute des commandes du serveur entre deux envois, sur le socket resté ouvert.
+ *
+ * Le serveur ne pouvait répondre qu'à un envoi : receive() rouvrait le socket, lisait deux fois à 3 s d'intervalle,
+ * puis STEP_CLOSE_CONNEXION le fermait. Une commande émise entre deux cycles attendait l'envoi suivant.
+ *
+ * - Après l'envoi, le socket de contrôle (MULTIPLEXEUR_SOCKETS) reste ouvert : le modem, joignable à chaque occasion
+ *   de paging de son cycle eDRX, reçoit les données du serveur et les annonce par l'URC +CADATAIND: <cid>.
+ * - STEP_END_GLOBAL dort par tranches de trancheMs (reveil) et lit les URC à chaque réveil (servir) : une annonce
+ *   déclenche AT+CARECV, le message CBOR décodé est appliqué comme une réponse à un envoi (appliquerOptionsRecues).
+ *   L'UART est lue par AIGUILLAGE_URC, qui remet les URC MQTT et réseau à leurs destinataires.
+ * - L'UART ne reçoit pas pendant le light sleep : une URC réveille l'ESP32 (GESTION_PSM) mais ses premiers
+ *   caractères sont perdus. Un réveil par le modem, ou config.lectureMaxMs sans lecture, déclenche donc AT+CARECV
+ *   sans attendre l'annonce.
+ * - Modem en PSM : l'écoute est limitée au temps actif T3324, au-delà le modem n'est plus joignable.
+ * - Socket partagé avec l'envoi (cid 0) : STEP_OPEN_CONNEXION termine l'écoute (dernière lecture, AT+CACLOSE=0)
+ *   avant de rouvrir le socket de l'envoi ; sinon l'écoute continue pendant l'envoi.
+ *
+ * simulerCommandes() mesure sur l'hôte la latence des commandes d'un serveur local, du serveur à leur application.
+ */
+
+#include "ECOUTE_DESCENDANTE.hpp"
+#include "SIM7080G_SERIAL.hpp"
+#include "receiveCBOR.hpp"
+#include "pipeline.hpp"
+#include "MULTIPLEXEUR_SOCKETS.hpp"
+#include "GESTION_PSM.hpp"
+#include "AIGUILLAGE_URC.hpp"
+
+EcouteDescendante ecouteDescendante; ///< Ecoute ouverte par STEP_RECEIVE et servie par STEP_END_GLOBAL.
+
+EcouteDescendante::EcouteDescendante()
+{
+    reinitialiser();
+}
+
+void EcouteDescendante::reinitialiser()
+{
+    stats = StatsEcoute();
+    ouverte = false;
+    cid = CID_ENVOI;
+    annonce = false;
+    annonceMs = 0;
+    finMs = 0;
+    lectureMs = 0;
+    longueur = 0;
+}
+
+/**
+ * @brief Ecoute sur le socket de contrôle ouvert ; dureeMaxMs (0 : sans limite) limite l'attente.
+ *
+ * Une écoute déjà ouverte continue : une annonce a pu être lue par une autre commande AT pendant le cycle, une
+ * lecture est faite au premier réveil.
+ */
+void EcouteDescendante::ouvrir(unsigned long maintenant, unsigned long dureeMaxMs)
+{
+    finMs = dureeMaxMs ? maintenant + dureeMaxMs : 0;
+    lectureMs = maintenant;
+    uint8_t socket = multiplexeurSockets.cid(CANAL_CONTROLE);
+    if (ouverte && cid == socket)
+    {
+        if (!annonce)
+            annonceMs = maintenant;
+        annonce = true;
+        return;
+    }
+    ouverte = true;
+    cid = socket;
+    annonce = false;
+    longueur = 0;
+    stats.nbSessions++;
+}
+
+void EcouteDescendante::fermer()
+{
+    ouverte = false;
+    annonce = false;
+}
+
+/**
+ * @brief Dernière lecture des données en attente (une annonce a pu être lue par un autre Send_AT), puis fermeture.
+ */
+void EcouteDescendante::terminer(unsigned long maintenant)
+{
+    if (!ouverte)
+        return;
+    stats.nbLectures++;
+    recevoir(Send_AT("AT+CARECV=" + String(cid) + "," + String(config.tailleLecture), 2000), maintenant);
+    multiplexeurSockets.fermer(CANAL_CONTROLE);
+    fermer();
+}
+
+void EcouteDescendante::traiterLigne(const char *texte, unsigned long maintenant)
+{
+    if (strncmp(texte, "+CADATAIND:", 11) == 0)
+    {
+        if (atoi(texte + 11) != cid)
+            return;
+        stats.nbAnnonces++;
+        if (!annonce)
+            annonceMs = maintenant;
+        annonce = true;
+    }
+    else if (strncmp(texte, "+CASTATE:", 9) == 0)
+    {
+        // +CASTATE: <cid>,0 : socket fermé par le serveur ou le réseau
+        multiplexeurSockets.traiterLigne(texte);
+        const char *virgule = strchr(texte, ',');
+        if (atoi(texte + 9) == cid && virgule != nullptr && atoi(virgule + 1) == 0 && ouverte)
+        {
+            stats.nbFermeturesDistantes++;
+            fermer();
+        }
+    }
+    else
+        aiguillageUrc.traiterLigne(texte, maintenant);
+}
+
+void EcouteDescendante::traiter(const char *donnees, size_t n, unsigned long maintenant)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        char c = donnees[i];
+        if (c == '\n')
+        {
+            ligne[longueur] = '\0';
+            if (longueur > 0)
+                traiterLigne(ligne, maintenant);
+            longueur = 0;
+        }
+        else if (c != '\r' && longueur < TAILLE_LIGNE_ECOUTE - 1)
+            ligne[longueur++] = c;
+    }
+}
+
+/**
+ * @brief Décode la réponse à AT+CARECV et applique la commande reçue.
+ *
+ * Une lecture de tailleLecture octets pleine laisse des données en attente : l'annonce est conservée pour la
+ * lecture suivante.
+ * @return true si une commande a été appliquée.
+ */
+bool EcouteDescendante::recevoir(const String &reponse, unsigned long maintenant)
+{
+    std::vector<uint8_t> octets;
+    bool lu = extraireCARECV(reponse, octets);
+    annonce = lu && octets.size() >= config.tailleLecture;
+    if (!lu)
+        return false;
+
+    json message = json::from_cbor(octets, true, false);
+    if (message.is_discarded())
+    {
+        Serial.println("[ECOUTE] CBOR invalide (" + String((unsigned long)octets.size()) + " octets)");
+        return false;
+    }
+    lastReceivedCBOR = message;
+    Serial.print("[ECOUTE] commande : ");
+    Serial.println(message.dump().c_str());
+    if (appliquer != nullptr)
+        appliquer(message);
+    else
+        appliquerOptionsRecues(message);
+
+    uint32_t latence = maintenant - annonceMs;
+    stats.nbCommandes++;
+    stats.latenceCumuleeMs += latence;
+    if (latence > stats.latenceMaxMs)
+        stats.latenceMaxMs = latence;
+    return true;
+}
+
+/**
+ * @brief Réveil de STEP_END_GLOBAL : lit les URC reçues pendant le sommeil et les données annoncées.
+ * @return true si une commande a été appliquée.
+ */
+bool EcouteDescendante::servir(unsigned long maintenant)
+{
+    if (!ouverte)
+        return false;
+    aiguillageUrc.lire(maintenant);
+
+    // URC peut-être perdue pendant le sommeil : le modem est relu
+    bool relire = gestionPSM.reveilModem ||
+                  (config.lectureMaxMs != 0 && (long)(maintenant - lectureMs) >= (long)config.lectureMaxMs);
+    if (ouverte && !annonce && relire)
+    {
+        stats.nbLecturesSansAnnonce++;
+        annonce = true;
+        annonceMs = maintenant;
+    }
+    gestionPSM.reveilModem = false;
+
+    bool commande = false;
+    if (ouverte && annonce)
+    {
+        stats.nbLectures++;
+        lectureMs = maintenant;
+        String reponse = Send_AT("AT+CARECV=" + String(cid) + "," + String(config.tailleLecture), 2000);
+        commande = recevoir(reponse, millis());
+    }
+    if (ouverte && finMs != 0 && (long)(maintenant - finMs) >= 0)
+    {
+        Serial.println("[ECOUTE] fin du temps actif : socket ferme");
+        terminer(maintenant);
+    }
+    return commande;
+}
+
+/**
+ * @brief Heure du prochain réveil : la tranche suivante pendant l'écoute, sinon l'échéance demandée.
+ */
+unsigned long EcouteDescendante::reveil(unsigned long maintenant, unsigned long echeance) const
+{
+    if (!ouverte)
+        return echeance;
+    unsigned long prochain = maintenant + config.trancheMs;
+    if (finMs != 0 && (long)(finMs - prochain) < 0)
+        prochain = finMs;
+    return (long)(echeance - prochain) < 0 ? echeance : prochain;
+}
+
+// Simulation : la configuration de l'appareil n'est pas modifiée
+static void ignorerCommande(const json &)
+{
+}
+
+/**
+ * @brief Latence des commandes d'un serveur local pendant scenario.dureeS de cycles réguliers.
+ *
+ * Chaque cycle occupe la radio dureeCycleS (GNSS puis envoi), lit la réponse à l'envoi puis attend periodeS.
+ * Historique : une commande attend la lecture de la réponse à l'envoi suivant (socket fermé entre deux cycles).
+ * Ecoute : une commande émise pendant l'attente parvient au modem à sa prochaine occasion de paging eDRX, l'URC est
+ * lue au réveil suivant de l'ESP32 et la commande par AT+CARECV ; les URC et les lectures passent par une
+ * EcouteDescendante réelle. Une commande émise pendant la fenêtre radio est lue avec la réponse à l'envoi.
+ */
+RapportDescendant simulerCommandes(const ScenarioDescendant &scenario, const ConfigEcoute &config)
+{
+    RapportDescendant rapport;
+    EcouteDescendante ecoute;
+    ecoute.config = config;
+    ecoute.appliquer = ignorerCommande;
+
+    // Commande du serveur local : {"lissage": true}
+    std::vector<uint8_t> cbor = json::to_cbor(json{{"lissage", true}});
+    String reponse = "\r\n+CARECV: " + String((unsigned long)cbor.size()) + ",";
+    for (uint8_t o : cbor)
+        reponse += (char)o;
+    reponse += "\r\n\r\nOK\r\n";
+    String urc = "+CADATAIND: " + String(multiplexeurSockets.cid(CANAL_CONTROLE));
+
+    const unsigned long cycleMs = (scenario.dureeCycleS + scenario.periodeS) * 1000UL;
+    const unsigned long dureeMs = scenario.dureeS * 1000UL;
+    const unsigned long demiRtt = scenario.rttMs / 2;
+    unsigned long emission = scenario.intervalleCommandeS * 1000UL;
+    uint64_t cumul = 0;
+    uint64_t cumulEcoute = 0;
+    uint32_t reveils = 0;
+
+    auto livrer = [&](unsigned long application, bool parEcoute) {
+        uint32_t latence = application - emission;
+        rapport.nbCommandes++;
+        cumul += latence;
+        if (latence > rapport.latenceMaxMs)
+            rapport.latenceMaxMs = latence;
+        if (parEcoute)
+        {
+            rapport.nbCommandesEcoute++;
+            cumulEcoute += latence;
+        }
+        emission += scenario.intervalleCommandeS * 1000UL;
+    };
+
+    for (unsigned long debut = 0; debut + cycleMs <= dureeMs; debut += cycleMs)
+    {
+        unsigned long lecture = debut + scenario.dureeCycleS * 1000UL;
+        unsigned long suivant = debut + cycleMs;
+
+        // Lecture de la réponse à l'envoi : receive() lit pendant lectureHistoriqueMs, l'écoute une seule fois
+        unsigned long finLecture = config.actif ? lecture : lecture + scenario.lectureHistoriqueMs;
+        while (emission <= finLecture)
+            livrer((emission > lecture ? emission : lecture) + scenario.rttMs, false);
+        if (!config.actif)
+            continue;
+
+        ecoute.ouvrir(lecture);
+        unsigned long t = lecture;
+        while (true)
+        {
+            unsigned long prochain = ecoute.reveil(t, suivant);
+            if ((long)(prochain - suivant) >= 0)
+                break;
+            t = prochain;
+            reveils++;
+            // Données remises au modem à la première occasion de paging après l'émission
+            unsigned long paging = (emission + scenario.cycleEdrxMs - 1) / scenario.cycleEdrxMs * scenario.cycleEdrxMs;
+            unsigned long arrivee = paging + demiRtt;
+            if (arrivee <= t)
+            {
+                ecoute.traiterLigne(urc.c_str(), t);
+                if (ecoute.recevoir(reponse, t + scenario.rttMs))
+                    livrer(t + scenario.rttMs, true);
+            }
+        }
+        ecoute.fermer();
+    }
+
+    if (rapport.nbCommandes > 0)
+        rapport.latenceMoyenneMs = (uint32_t)(cumul / rapport.nbCommandes);
+    if (rapport.nbCommandesEcoute > 0)
+        rapport.latenceEcouteMoyenneMs = (uint32_t)(cumulEcoute / rapport.nbCommandesEcoute);
+    if (scenario.dureeS > 0)
+        rapport.reveilsParHeure = reveils * 3600.0f / scenario.dureeS;
+    return rapport;
+}
+
+/**
+ * @brief Options reçues du serveur : {"actif": bool, "trancheMs": ms, "tailleLecture": octets, "attenteMinMs": ms,
+ *        "lectureMaxMs": ms}.
+ */
+void chargerOptionsEcoute(const json &options)
+{
+    ConfigEcoute &config = ecouteDescendante.config;
+    if (options.contains("actif"))
+        config.actif = options["actif"].get<bool>();
+    if (options.contains("trancheMs"))
+        config.trancheMs = options["trancheMs"].get<unsigned long>();
+    if (options.contains("tailleLecture"))
+        config.tailleLecture = options["tailleLecture"].get<uint16_t>();
+    if (options.contains("attenteMinMs"))
+        config.attenteMinMs = options["attenteMinMs"].get<unsigned long>();
+    if (options.contains("lectureMaxMs"))
+        config.lectureMaxMs = options["lectureMaxMs"].get<unsigned long>();
+}
+
+void afficherStatsEcoute()
+{
+    const StatsEcoute &s = ecouteDescendante.stats;
+    if (s.nbSessions == 0)
+        return;
+    uint32_t moyenne = s.nbCommandes ? (uint32_t)(s.latenceCumuleeMs / s.nbCommandes) : 0;
+    Serial.println("[ECOUTE] sessions : " + String(s.nbSessions) + " / annonces : " + String(s.nbAnnonces) + " / AT+CARECV : " +
+                   String(s.nbLectures) + " (" + String(s.nbLecturesSansAnnonce) + " sans annonce) / commandes : " + String(s.nbCommandes) + " / fermetures distantes : " +
+                   String(s.nbFermeturesDistantes) + " / latence (ms) moyenne " + String(moyenne) + ", max " +
+                   String(s.latenceMaxMs));
+}
@@ -3,7 +3,7 @@
 void receive()
 {
   Serial.println("----- je suis dans le receive() -----");
-  Send_AT("AT+CAOPEN=0,0,\"TCP\"," + (String)PINGGY_LINK + "," + (String)PINGGY_PORT); // Remplace par le port réel affiché
+  multiplexeurSockets.ouvrir(CANAL_ENVOI); // pas de second AT+CAOPEN=0 si le pipeline l'a déjà ouvert
   // Lire 100 octets depuis la connexion
   Send_AT("AT+CARECV=0,100");
 
@@ -2,6 +2,46 @@
 using json = nlohmann::json;
 
 bool START_PIPELINE = false;
+
+static const char *REFUS_SERVEUR = "Decoding or format error"; // réponse du serveur TCP à un lot illisible
+
+/**
+ * @brief Extrait les octets de la dernière ligne "+CARECV: <longueur>,<données>" d'une réponse à AT+CARECV.
+ *
+ * La longueur annoncée délimite les données : un octet CBOR égal à '\n' ne coupe pas le message.
+ * @return false si la ligne est absente, vide ou sans virgule.
+ */
+bool extraireCARECV(const String &reponse, std::vector<uint8_t> &octets)
+{
+    octets.clear();
+    int debut = reponse.lastIndexOf("+CARECV:");
+    if (debut == -1)
+        return false;
+    int virgule = reponse.indexOf(',', debut);
+    int finLigne = reponse.indexOf('\n', debut);
+    if (virgule == -1 || (finLigne != -1 && finLigne < virgule))
+        return false;
+    long longueur = reponse.substring(debut + 8, virgule).toInt();
+    if (longueur <= 0)
+        return false;
+    for (int i = virgule + 1; i < (int)reponse.length() && (long)octets.size() < longueur; ++i)
+        octets.push_back((uint8_t)reponse[i]);
+    return true;
+}
+
+/**
+ * @brief Décode le message CBOR contenu dans une réponse à AT+CARECV.
+ * @return false si aucune donnée n'a été reçue ou si le CBOR est invalide.
+ */
+bool decoderCARECV(const String &reponse, json &message)
+{
+    std::vector<uint8_t> octets;
+    if (!extraireCARECV(reponse, octets))
+        return false;
+    message = json::from_cbor(octets, true, false);
+    return !message.is_discarded();
+}
+
 void lireEtDecoderCBOR()
 {
     String reponse = Send_AT("AT+CARECV=0,100", 3000);
@@ -26,33 +66,18 @@ void lireEtDecoderCBOR()
         return;
     }
 
-    int commaIndex = carecvLine.indexOf(',');
-    if (commaIndex == -1)
+    std::vector<uint8_t> buffer;
+    if (!extraireCARECV(reponse, buffer))
     {
         Serial.println("Missing comma");
         return;
     }
-
-    String brut = carecvLine.substring(commaIndex + 1);
-    brut.trim();
-    Serial.println("Raw binary data: " + brut);
-
-    std::vector<uint8_t> buffer;
-    Serial.println("Affichage des octets reçus :");
-    for (int i = 0; i < brut.length(); i++)
-    {
-        uint8_t val = (uint8_t)brut[i];
-        Serial.print("Index ");
-        Serial.print(i);
-        Serial.print(" : ");
-        Serial.print(val);
-        Serial.print(" (0x");
-        if (val < 16)
-            Serial.print("0");
-        Serial.print(val, HEX);
-        Serial.println(")");
-        buffer.push_back(val);
-    }
+    // Toute réponse acquitte l'envoi, sauf le refus du lot par le serveur
+    size_t refus = strlen(REFUS_SERVEUR);
+    if (buffer.size() >= refus && memcmp(buffer.data(), REFUS_SERVEUR, refus) == 0)
+        Serial.println("Batch rejected by the server");
+    else
+        reponseServeur = true;
 
     Serial.print("Buffer size: ");
     Serial.println(buffer.size());
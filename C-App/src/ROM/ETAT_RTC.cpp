@@ -0,0 +1,250 @@
+/**
+ * @file ETAT_RTC.cpp
+ * @brief Conservation de l'état du firmware en mémoire RTC pour une reprise rapide après deep sleep.
+ *
+ * Un deep sleep redémarre setup() : sans état conservé, le firmware redémarrerait le SIM7080G (plus de 5 s de délais),
+ * relirait l'IMEI et recommencerait la collecte GNSS depuis zéro.
+ *
+ * Ce fichier sauvegarde avant l'endormissement, dans une structure placée en mémoire RTC (RTC_DATA_ATTR) :
+ * - le curseur des pipelines (global, GNSS, 4G, CBOR),
+ * - le lot de fixes GNSS en attente d'envoi,
+ * - les informations de session réseau (IMEI, timers PSM / eDRX accordés),
+ * - l'âge des timers et la durée du sommeil,
+ * - l'âge des données d'assistance GNSS (XTRA, éphémérides) et les statistiques d'acquisition,
+ * - l'état dedans / dehors de chaque géofence et l'âge du dernier envoi,
+ * - les cellules associées à une position (repli réseau) et le délai accordé au GNSS,
+ * - l'état de l'arbitre radio (GNSS resté allumé, âge de la dernière fenêtre LTE et de chaque fix en attente),
+ * - le prochain Message ID CoAP (TRANSPORT_COAP),
+ * - l'état de la session MQTT (TRANSPORT_MQTT) : configuration du modem et abonnement aux commandes,
+ * - le contexte SSL et les cid configurés dans le modem (SESSION_TLS),
+ * - l'heure UTC (BASE_TEMPS), vieillie au réveil de la durée du sommeil corrigée de la dérive mesurée de la RTC,
+ * - la comptabilité énergétique.
+ *
+ * Au réveil par le timer, la structure est vérifiée (magic, version, taille, CRC32) puis réappliquée :
+ * le pipeline reprend là où il s'était arrêté, sans aucun délai bloquant.
+ */
+
+#include "ETAT_RTC.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include <esp_sleep.h>
+#ifndef UNIT_TEST
+#include <driver/gpio.h>
+#endif
+
+RTC_DATA_ATTR EtatRetenu etatRTC;  ///< État conservé pendant le deep sleep.
+unsigned long latenceRepriseUs = 0; ///< Temps entre le démarrage et la reprise du pipeline (µs).
+
+/**
+ * @brief CRC32 (polynôme 0xEDB88320) calculé bit à bit, sans table pour économiser la mémoire.
+ */
+uint32_t crc32Etat(const uint8_t *data, size_t taille)
+{
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (size_t i = 0; i < taille; ++i)
+    {
+        crc ^= data[i];
+        for (int b = 0; b < 8; ++b)
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static uint32_t crcEtatRTC()
+{
+    return crc32Etat((const uint8_t *)&etatRTC, offsetof(EtatRetenu, crc));
+}
+
+static void copierChaine(char *destination, size_t taille, const String &source)
+{
+    strncpy(destination, source.c_str(), taille - 1);
+    destination[taille - 1] = '\0';
+}
+
+/**
+ * @brief Sauvegarde l'état courant du firmware en mémoire RTC, juste avant un deep sleep.
+ * @param dureeSommeilMs Durée prévue du sommeil (ms), utilisée pour vieillir les timers au réveil.
+ */
+void sauvegarderEtatRTC(unsigned long dureeSommeilMs)
+{
+    unsigned long maintenant = millis();
+    uint32_t nbReveils = (etatRTC.magic == ETAT_RTC_MAGIC) ? etatRTC.nbReveils : 0;
+
+    memset(&etatRTC, 0, sizeof(etatRTC));
+    etatRTC.magic = ETAT_RTC_MAGIC;
+    etatRTC.version = ETAT_RTC_VERSION;
+    etatRTC.taille = sizeof(EtatRetenu);
+    etatRTC.nbReveils = nbReveils;
+
+    etatRTC.stepGlobal = currentStepGLOBAL;
+    etatRTC.stepGnss = gnssStepState;
+    etatRTC.step4G = currentStep4G;
+    etatRTC.stepCBOR = currentStepCBOR;
+
+    etatRTC.nbFix = nbCoordonnees > MAX_COORDS ? MAX_COORDS : nbCoordonnees;
+    for (int i = 0; i < etatRTC.nbFix; ++i)
+    {
+        copierChaine(etatRTC.fixes[i].latitude, sizeof(etatRTC.fixes[i].latitude), dataGNSS[i].gnss.coordonnees.latitude.full);
+        copierChaine(etatRTC.fixes[i].longitude, sizeof(etatRTC.fixes[i].longitude), dataGNSS[i].gnss.coordonnees.longitude.full);
+        copierChaine(etatRTC.fixes[i].timeStamp, sizeof(etatRTC.fixes[i].timeStamp), dataGNSS[i].gnss.timeStamp);
+        etatRTC.fixes[i].source = dataGNSS[i].gnss.source;
+        etatRTC.fixes[i].precisionM = dataGNSS[i].gnss.precisionM;
+        etatRTC.fixes[i].ageMs = dataGNSS[i].tFixMs != 0 ? maintenant - dataGNSS[i].tFixMs : 0;
+    }
+
+    copierChaine(etatRTC.imei, sizeof(etatRTC.imei), imei);
+    etatRTC.psmAccorde = gestionPSM.accorde.psmAccorde;
+    etatRTC.tauS = gestionPSM.accorde.tauS;
+    etatRTC.actifS = gestionPSM.accorde.actifS;
+    etatRTC.edrxAccorde = gestionPSM.accorde.edrxAccorde;
+    etatRTC.edrxMs = gestionPSM.accorde.edrxMs;
+
+    etatRTC.periodeAjustement = periodeAjustement;
+    etatRTC.agePeriod10min = maintenant - period10min;
+    etatRTC.agePeriodGNSS = maintenant - periodGNSS;
+    etatRTC.dureeSommeilMs = dureeSommeilMs;
+
+    etatRTC.precisionActive = gnssOptions.precisionActive;
+    etatRTC.precision = gnssOptions.precision;
+
+    etatRTC.xtraDisponible = assistanceGnss.xtraDisponible;
+    etatRTC.ephemeridesConnues = assistanceGnss.ephemeridesConnues;
+    etatRTC.ageXtraMs = maintenant - assistanceGnss.xtraTelechargeMs;
+    etatRTC.ageDerniereFixMs = maintenant - assistanceGnss.derniereFixMs;
+    copierChaine(etatRTC.constellationsAppliquees, sizeof(etatRTC.constellationsAppliquees), assistanceGnss.constellationsAppliquees);
+    memcpy(etatRTC.statsGnss, &assistanceGnss.stats, sizeof(StatsAcquisition));
+
+    memcpy(etatRTC.geofencesDedans, geofences.etatDedans(), sizeof(etatRTC.geofencesDedans));
+    etatRTC.envoiGeofenceFait = geofences.envoiFait;
+    etatRTC.ageEnvoiGeofenceMs = maintenant - geofences.dernierEnvoiMs;
+
+    memcpy(etatRTC.cellules, strategiePosition.cellules, sizeof(etatRTC.cellules));
+    etatRTC.niveauDelaiRepli = strategiePosition.niveauDelai();
+
+    etatRTC.gnssMaintenuAllume = arbitreRadio.estGnssAllume();
+    etatRTC.fenetreLteFaite = arbitreRadio.fenetreLteFaite;
+    etatRTC.ageFenetreLteMs = maintenant - arbitreRadio.derniereFenetreLteMs;
+    etatRTC.coapMessageId = transportCoap.prochainMessageId();
+    etatRTC.mqttConfigure = transportMqtt.estConfigure();
+    etatRTC.mqttAbonne = transportMqtt.estAbonne();
+    etatRTC.tlsConfigure = sessionTls.estConfigure();
+    etatRTC.tlsCids = sessionTls.cidsPrepares();
+    etatRTC.temps = baseTemps.sauvegarder(maintenant);
+
+    energie.cloturer(maintenant);
+    memcpy(etatRTC.energie, &energie, sizeof(ComptabiliteEnergie));
+
+    etatRTC.crc = crcEtatRTC();
+}
+
+/**
+ * @brief Vérifie que la mémoire RTC contient un état complet et cohérent.
+ */
+bool etatRTCValide()
+{
+    return etatRTC.magic == ETAT_RTC_MAGIC &&
+           etatRTC.version == ETAT_RTC_VERSION &&
+           etatRTC.taille == sizeof(EtatRetenu) &&
+           etatRTC.nbFix <= MAX_COORDS &&
+           etatRTC.crc == crcEtatRTC();
+}
+
+/**
+ * @brief Réapplique l'état sauvegardé aux variables globales du firmware.
+ *
+ * Les timers sont recalés sur le nouveau millis() (qui repart de zéro) en ajoutant la durée du sommeil à leur âge.
+ */
+void appliquerEtatRTC()
+{
+    unsigned long maintenant = millis();
+
+    currentStepGLOBAL = (PipelineGLOBAL)etatRTC.stepGlobal;
+    gnssStepState = (StepGNSSState)etatRTC.stepGnss;
+    currentStep4G = (StepSend4GState)etatRTC.step4G;
+    currentStepCBOR = (PipelineCBOR)etatRTC.stepCBOR;
+
+    nbCoordonnees = etatRTC.nbFix;
+    for (int i = 0; i < etatRTC.nbFix; ++i)
+    {
+        Gnss gnss;
+        gnss.coordonnees.latitude.full = etatRTC.fixes[i].latitude;
+        gnss.coordonnees.latitude.ent = gnss.coordonnees.latitude.full.toInt();
+        gnss.coordonnees.longitude.full = etatRTC.fixes[i].longitude;
+        gnss.coordonnees.longitude.ent = gnss.coordonnees.longitude.full.toInt();
+        gnss.timeStamp = etatRTC.fixes[i].timeStamp;
+        gnss.source = etatRTC.fixes[i].source < NB_SOURCES_POSITION ? (SourcePosition)etatRTC.fixes[i].source : SOURCE_GNSS;
+        gnss.precisionM = etatRTC.fixes[i].precisionM;
+        gnss.isValid = true;
+        dataGNSS[i] = DataGNSS();
+        dataGNSS[i].gnss = gnss;
+        if (etatRTC.fixes[i].ageMs != 0)
+            dataGNSS[i].tFixMs = maintenant - (etatRTC.fixes[i].ageMs + etatRTC.dureeSommeilMs);
+    }
+
+    imei = etatRTC.imei;
+    gestionPSM.accorde.psmAccorde = etatRTC.psmAccorde;
+    gestionPSM.accorde.tauS = etatRTC.tauS;
+    gestionPSM.accorde.actifS = etatRTC.actifS;
+    gestionPSM.accorde.edrxAccorde = etatRTC.edrxAccorde;
+    gestionPSM.accorde.edrxMs = etatRTC.edrxMs;
+
+    periodeAjustement = etatRTC.periodeAjustement;
+    period10min = maintenant - (etatRTC.agePeriod10min + etatRTC.dureeSommeilMs);
+    periodGNSS = maintenant - (etatRTC.agePeriodGNSS + etatRTC.dureeSommeilMs);
+    periodEveryX = maintenant;
+
+    gnssOptions.precisionActive = etatRTC.precisionActive;
+    gnssOptions.precision = etatRTC.precision;
+
+    assistanceGnss.xtraDisponible = etatRTC.xtraDisponible;
+    assistanceGnss.ephemeridesConnues = etatRTC.ephemeridesConnues;
+    assistanceGnss.xtraTelechargeMs = maintenant - (etatRTC.ageXtraMs + etatRTC.dureeSommeilMs);
+    assistanceGnss.derniereFixMs = maintenant - (etatRTC.ageDerniereFixMs + etatRTC.dureeSommeilMs);
+    assistanceGnss.constellationsAppliquees = etatRTC.constellationsAppliquees;
+    memcpy(&assistanceGnss.stats, etatRTC.statsGnss, sizeof(StatsAcquisition));
+
+    geofences.restaurerDedans(etatRTC.geofencesDedans);
+    geofences.envoiFait = etatRTC.envoiGeofenceFait;
+    geofences.dernierEnvoiMs = maintenant - (etatRTC.ageEnvoiGeofenceMs + etatRTC.dureeSommeilMs);
+
+    memcpy(strategiePosition.cellules, etatRTC.cellules, sizeof(etatRTC.cellules));
+    strategiePosition.restaurerNiveauDelai(etatRTC.niveauDelaiRepli);
+
+    arbitreRadio.restaurerGnssAllume(etatRTC.gnssMaintenuAllume);
+    arbitreRadio.fenetreLteFaite = etatRTC.fenetreLteFaite;
+    arbitreRadio.derniereFenetreLteMs = maintenant - (etatRTC.ageFenetreLteMs + etatRTC.dureeSommeilMs);
+    transportCoap.restaurerMessageId(etatRTC.coapMessageId);
+    transportMqtt.restaurerSession(etatRTC.mqttConfigure, etatRTC.mqttAbonne);
+    sessionTls.restaurer(etatRTC.tlsConfigure, etatRTC.tlsCids);
+    baseTemps.restaurer(etatRTC.temps, etatRTC.dureeSommeilMs, maintenant);
+
+    memcpy(&energie, etatRTC.energie, sizeof(ComptabiliteEnergie));
+    energie.reprendre(etatRTC.dureeSommeilMs, maintenant);
+    energie.setEtatCpu(CPU_ACTIF, maintenant);
+
+    etatRTC.nbReveils++;
+    etatRTC.crc = crcEtatRTC();
+}
+
+/**
+ * @brief Restaure l'état si le démarrage est un réveil de deep sleep par le timer et que l'état est valide.
+ * @return true si le firmware reprend là où il s'était arrêté, false pour un démarrage complet.
+ */
+bool restaurerEtatRTC()
+{
+    if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER || !etatRTCValide())
+    {
+        invaliderEtatRTC();
+        return false;
+    }
+#ifndef UNIT_TEST
+    gpio_hold_dis((gpio_num_t)PIN_PWRKEY);
+#endif
+    appliquerEtatRTC();
+    Serial.println("[RTC] Reprise apres deep sleep n." + String(etatRTC.nbReveils));
+    return true;
+}
+
+void invaliderEtatRTC()
+{
+    etatRTC.magic = 0;
+}
@@ -9,6 +9,7 @@
  */
 
 #include "ROM.hpp"
+#include "ETAT_RTC.hpp"
 // Function to manually write a uint32_t
 void writeUInt32(int addr, uint32_t val)
 {
@@ -240,3 +241,39 @@ String getCoordonneesDepuisEEPROM()
 
   return result;
 }
+
+static uint32_t crcCacheDemarrage(const CacheDemarrage &cache)
+{
+  return crc32Etat((const uint8_t *)&cache, offsetof(CacheDemarrage, crc));
+}
+
+/**
+ * @brief Lit le cache de démarrage (IMEI, CCID, configuration réseau) depuis l'EEPROM.
+ * @param cache Structure remplie avec le contenu de l'EEPROM.
+ * @return true si le cache est présent et intègre (magic et CRC).
+ */
+bool lireCacheDemarrage(CacheDemarrage &cache)
+{
+  EEPROM.get(ADDR_CACHE_DEMARRAGE, cache);
+  return cache.magic == CACHE_DEMARRAGE_MAGIC && cache.crc == crcCacheDemarrage(cache);
+}
+
+/**
+ * @brief Écrit le cache de démarrage en EEPROM (magic et CRC calculés ici).
+ */
+void ecrireCacheDemarrage(CacheDemarrage &cache)
+{
+  cache.magic = CACHE_DEMARRAGE_MAGIC;
+  cache.imei[sizeof(cache.imei) - 1] = '\0';
+  cache.ccid[sizeof(cache.ccid) - 1] = '\0';
+  cache.apn[sizeof(cache.apn) - 1] = '\0';
+  cache.crc = crcCacheDemarrage(cache);
+  EEPROM.put(ADDR_CACHE_DEMARRAGE, cache);
+  EEPROM.commit();
+}
+
+void effacerCacheDemarrage()
+{
+  EEPROM.write(ADDR_CACHE_DEMARRAGE, 0);
+  EEPROM.commit();
+}
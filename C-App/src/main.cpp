@@ -19,8 +19,9 @@
 #include "receiveCBOR.hpp"
 #include "RECEIVE.hpp"
 #include "GLOBALS.hpp"
-
-#define EEPROM_SIZE 256
+#include "ENERGIE.hpp"
+#include "ETAT_RTC.hpp"
+#include "SIM7080G_DEMARRAGE.hpp"
 
 /**
  * @brief Fonction exécutée périodiquement pour lancer le pipeline global.
@@ -34,7 +35,7 @@ void everyX();
  * @brief Fonction d'initialisation Arduino.
  *
  * Configure la broche d'alimentation du SIM7080G, initialise la liaison série,
- * redémarre le module SIM7080G, affiche un message de bienvenue et récupère l'IMEI.
+ * sonde le module SIM7080G (redémarré seulement si nécessaire), affiche un message de bienvenue et récupère l'IMEI.
  */
 void setup();
 
@@ -66,17 +67,37 @@ void everyX()
  * @brief Initialise le matériel et les variables globales.
  *
  * Configure la broche d'alimentation, initialise la communication série,
- * redémarre le module SIM7080G, affiche un message de bienvenue et récupère l'IMEI.
+ * sonde le module SIM7080G (redémarré seulement s'il ne répond pas), affiche un message de bienvenue
+ * et récupère l'IMEI (depuis le cache EEPROM si possible).
+ * Au réveil d'un deep sleep, l'état conservé en mémoire RTC est restauré et le pipeline reprend
+ * sans redémarrer le modem.
  */
 void setup()
 {
-  pinMode(PIN_PWRKEY, OUTPUT);
+  unsigned long debutSetup = micros();
   Serial.begin(115200); // init port uart // on a aussi un port uart qui pointe vers notre pc
-  reboot_SIM7080G();
+  if (restaurerEtatRTC())
+  {
+    // Le modem est resté alimenté (PSM) : pas de reboot, pas de relecture de l'IMEI
+    pinMode(PIN_PWRKEY, OUTPUT);
+    digitalWrite(PIN_PWRKEY, OUTPUT_OPEN_DRAIN);
+    Sim7080G.begin(Sim7080G_BAUDRATE, SERIAL_8N1, 20, 21);
+    catm1DemarrageRapide(true); // contexte PDP conservé par le modem en PSM
+    geofences.restaurer();
+    latenceRepriseUs = micros() - debutSetup;
+    Serial.println("[RTC] Reprise en " + String(latenceRepriseUs) + " us");
+    return;
+  }
+
+  pinMode(PIN_PWRKEY, OUTPUT);
+  digitalWrite(PIN_PWRKEY, OUTPUT_OPEN_DRAIN);
+  energie.reinitialiser(millis());
+  demarrerModem(); // ne redémarre le modem que s'il ne répond pas
+  energie.setEtatLte(LTE_IDLE, millis());
   Serial.println("Around the World"); // CTRL + ALT + S
+  afficherTempsDemarrage();
+  geofences.restaurer(); // zones reçues avant le redémarrage
 
-  String gsnRaw = Send_AT("AT+GSN");
-  imei = getIMEI(gsnRaw);
   period10min = millis();
   periodEveryX = millis();
 }
@@ -0,0 +1,92 @@
+#ifndef SIMULATEUR_SIM7080G_HPP
+#define SIMULATEUR_SIM7080G_HPP
+
+// Simulateur de modem SIM7080G pour les tests unitaires.
+// Il se branche sur SendATResponseHook : chaque commande envoyée par Send_AT est journalisée
+// et reçoit la réponse scriptée dont le préfixe correspond (la plus récente l'emporte).
+
+#include <Arduino.h>
+#include <vector>
+#include "SIM7080G_SERIAL.hpp"
+
+struct ReponseSimulee
+{
+    String prefixe;
+    String reponse;
+    int restantes; // -1 = permanente
+};
+
+class SimulateurSIM7080G
+{
+public:
+    std::vector<String> commandes;
+    std::vector<ReponseSimulee> reponses;
+    String reponseParDefaut = "\r\nOK\r\n";
+
+    // Ajoute une réponse pour les commandes commençant par prefixe (fois = -1 : toujours)
+    void repondre(const String &prefixe, const String &reponse, int fois = -1)
+    {
+        reponses.push_back({prefixe, reponse, fois});
+    }
+
+    String traiter(const String &commande)
+    {
+        commandes.push_back(commande);
+        for (int i = (int)reponses.size() - 1; i >= 0; --i)
+        {
+            ReponseSimulee &r = reponses[i];
+            if (r.restantes != 0 && commande.startsWith(r.prefixe))
+            {
+                if (r.restantes > 0)
+                    r.restantes--;
+                return r.reponse;
+            }
+        }
+        return reponseParDefaut;
+    }
+
+    int compter(const String &prefixe) const
+    {
+        int n = 0;
+        for (const String &c : commandes)
+            if (c.startsWith(prefixe))
+                n++;
+        return n;
+    }
+
+    bool aRecu(const String &prefixe) const
+    {
+        return compter(prefixe) > 0;
+    }
+
+    void reinitialiser()
+    {
+        commandes.clear();
+        reponses.clear();
+    }
+
+    void installer()
+    {
+        instance() = this;
+        SendATResponseHook = &SimulateurSIM7080G::hook;
+    }
+
+    void desinstaller()
+    {
+        SendATResponseHook = nullptr;
+        instance() = nullptr;
+    }
+
+    static SimulateurSIM7080G *&instance()
+    {
+        static SimulateurSIM7080G *courant = nullptr;
+        return courant;
+    }
+
+    static String hook(const String &commande, long)
+    {
+        return instance() ? instance()->traiter(commande) : String("");
+    }
+};
+
+#endif // SIMULATEUR_SIM7080G_HPP
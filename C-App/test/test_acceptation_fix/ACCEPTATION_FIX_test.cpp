@@ -0,0 +1,208 @@
+#include <unity.h>
+#include "ACCEPTATION_FIX.hpp"
+
+#define LAT_BASE 50634412
+#define LON_BASE 3048687
+
+// Aucune trace enregistrée n'est fournie avec le dépôt : les traces sont synthétiques (bruit déterministe)
+static uint32_t graine = 12345;
+
+void setUp(void)
+{
+    acceptationFix.reinitialiser();
+    acceptationFix.config = ConfigAcceptation();
+    gnssOptions = GnssOptions();
+    graine = 12345;
+}
+
+void tearDown(void) {}
+
+// Bruit pseudo-aléatoire uniforme dans [-amplitude, amplitude]
+static int32_t bruitMm(int32_t amplitude)
+{
+    graine = graine * 1103515245UL + 12345UL;
+    return (int32_t)((graine >> 8) % (uint32_t)(2 * amplitude + 1)) - amplitude;
+}
+
+// Fix de bonne qualité à x, y (mm) du point de base
+static Echantillon fixA(int32_t xMm, int32_t yMm, unsigned long tMs)
+{
+    Echantillon e;
+    deprojeterE6(LAT_BASE, LON_BASE, xMm, yMm, e.latE6, e.lonE6);
+    e.hdopDixiemes = 9;
+    e.satellites = 9;
+    e.cn0 = 38;
+    e.tMs = tMs;
+    return e;
+}
+
+void test_acceptation_criteres_qualite()
+{
+    Echantillon e = fixA(0, 0, 0);
+    TEST_ASSERT_EQUAL_INT(FIX_ACCEPTE, acceptationFix.evaluer(e));
+
+    e = fixA(0, 0, 1000);
+    e.hdopDixiemes = 120;
+    TEST_ASSERT_EQUAL_INT(REJET_HDOP, acceptationFix.evaluer(e));
+    e = fixA(0, 0, 2000);
+    e.satellites = 3;
+    TEST_ASSERT_EQUAL_INT(REJET_SATELLITES, acceptationFix.evaluer(e));
+    e = fixA(0, 0, 3000);
+    e.cn0 = 15;
+    TEST_ASSERT_EQUAL_INT(REJET_CN0, acceptationFix.evaluer(e));
+    e = Echantillon();
+    TEST_ASSERT_EQUAL_INT(REJET_POSITION, acceptationFix.evaluer(e));
+
+    // Champs absents de la trame : pas de contrôle
+    e = fixA(1000, 0, 4000);
+    e.hdopDixiemes = -1;
+    e.satellites = -1;
+    e.cn0 = -1;
+    TEST_ASSERT_EQUAL_INT(FIX_ACCEPTE, acceptationFix.evaluer(e));
+
+    const StatsAcceptation &s = acceptationFix.stats;
+    TEST_ASSERT_EQUAL_UINT32(6, s.nbEvalues);
+    TEST_ASSERT_EQUAL_UINT32(2, s.nbAcceptes);
+    TEST_ASSERT_EQUAL_UINT32(1, s.rejets[REJET_HDOP]);
+    TEST_ASSERT_EQUAL_UINT32(1, s.rejets[REJET_SATELLITES]);
+    TEST_ASSERT_EQUAL_UINT32(1, s.rejets[REJET_CN0]);
+    TEST_ASSERT_EQUAL_UINT32(1, s.rejets[REJET_POSITION]);
+}
+
+void test_acceptation_precision_serveur()
+{
+    Echantillon e = fixA(0, 0, 0);
+    e.hdopDixiemes = 25;
+    TEST_ASSERT_EQUAL_INT(FIX_ACCEPTE, acceptationFix.evaluer(e));
+
+    // Option "precision" reçue du serveur : HDOP < 2 exigé
+    gnssOptions.precisionActive = true;
+    gnssOptions.precision = 2;
+    TEST_ASSERT_EQUAL_INT(20, acceptationFix.hdopMaxDixiemes());
+    e = fixA(0, 0, 1000);
+    e.hdopDixiemes = 25;
+    TEST_ASSERT_EQUAL_INT(REJET_HDOP, acceptationFix.evaluer(e));
+    e = fixA(0, 0, 2000);
+    e.hdopDixiemes = 15;
+    TEST_ASSERT_EQUAL_INT(FIX_ACCEPTE, acceptationFix.evaluer(e));
+}
+
+void test_acceptation_saut_rejete_puis_repris()
+{
+    // 36 km/h vers le nord, un fix par seconde, bruit de +/- 5 m, aberrations isolées à 1,5 km à l'est
+    int injectees = 0, rejetees = 0;
+    for (int i = 0; i < 120; ++i)
+    {
+        Echantillon e = fixA(bruitMm(5000), i * 10000 + bruitMm(5000), (unsigned long)i * 1000);
+        if (i % 17 == 8)
+        {
+            e = fixA(1500000, i * 10000, (unsigned long)i * 1000);
+            injectees++;
+        }
+        if (acceptationFix.evaluer(e) == REJET_SAUT)
+            rejetees++;
+    }
+    TEST_ASSERT_EQUAL_INT(7, injectees);
+    TEST_ASSERT_EQUAL_INT(injectees, rejetees);
+    TEST_ASSERT_EQUAL_UINT32(0, acceptationFix.stats.nbReprises);
+
+    // Le récepteur corrige sa position de 2 km : deux rejets, puis la nouvelle position est reprise
+    for (int i = 120; i < 123; ++i)
+    {
+        Echantillon e = fixA(2000000, i * 10000, (unsigned long)i * 1000);
+        TEST_ASSERT_EQUAL_INT(i < 122 ? REJET_SAUT : FIX_ACCEPTE, acceptationFix.evaluer(e));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, acceptationFix.stats.nbReprises);
+    Echantillon suivant = fixA(2000000, 123 * 10000, 123000);
+    TEST_ASSERT_EQUAL_INT(FIX_ACCEPTE, acceptationFix.evaluer(suivant));
+
+    // Après un deep sleep, millis() repart de zéro : pas de saut détecté avec le cycle précédent
+    Echantillon reveil = fixA(0, 0, 500);
+    TEST_ASSERT_EQUAL_INT(FIX_ACCEPTE, acceptationFix.evaluer(reveil));
+}
+
+// Sauts consécutifs dispersés (multitrajets) : aucun ne confirme le précédent, la position n'est jamais reprise
+void test_acceptation_sauts_discordants()
+{
+    for (int i = 0; i < 10; ++i)
+    {
+        Echantillon e = fixA(0, i * 10000, (unsigned long)i * 1000);
+        TEST_ASSERT_EQUAL_INT(FIX_ACCEPTE, acceptationFix.evaluer(e));
+    }
+
+    const int32_t sautsMm[][2] = {{2000000, 0}, {-3000000, 0}, {0, 2500000}, {1500000, -1500000}, {-2000000, 2000000}};
+    for (int k = 0; k < 5; ++k)
+    {
+        unsigned long t = (unsigned long)(10 + k) * 1000;
+        Echantillon e = fixA(sautsMm[k][0], sautsMm[k][1], t);
+        TEST_ASSERT_EQUAL_INT(REJET_SAUT, acceptationFix.evaluer(e));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, acceptationFix.stats.nbReprises);
+
+    // Trois sauts proches les uns des autres : reprise au troisième, même après une série discordante
+    for (int i = 15; i < 18; ++i)
+    {
+        Echantillon e = fixA(2000000, i * 10000, (unsigned long)i * 1000);
+        TEST_ASSERT_EQUAL_INT(i < 17 ? REJET_SAUT : FIX_ACCEPTE, acceptationFix.evaluer(e));
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, acceptationFix.stats.nbReprises);
+}
+
+// Écart quadratique moyen (mm) d'une trace bruitée, avec ou sans lissage
+static uint32_t erreurRmsMm(bool lissage)
+{
+    setUp();
+    acceptationFix.config.lissage = lissage;
+    uint64_t somme = 0;
+    int n = 0;
+    for (int i = 0; i < 600; ++i)
+    {
+        // 36 km/h vers le nord-est, bruit de +/- 8 m
+        int32_t x = i * 7071, y = i * 7071;
+        Echantillon e = fixA(x + bruitMm(8000), y + bruitMm(8000), (unsigned long)i * 1000);
+        TEST_ASSERT_EQUAL_INT(FIX_ACCEPTE, acceptationFix.evaluer(e));
+        if (i < 20)
+            continue; // convergence du filtre
+        int32_t latVraie, lonVraie;
+        deprojeterE6(LAT_BASE, LON_BASE, x, y, latVraie, lonVraie);
+        uint64_t d = distanceMm(latVraie, lonVraie, e.latE6, e.lonE6);
+        somme += d * d;
+        n++;
+    }
+    return racineEntiere(somme / n);
+}
+
+void test_acceptation_lissage_reduit_erreur()
+{
+    uint32_t brut = erreurRmsMm(false);
+    uint32_t lisse = erreurRmsMm(true);
+
+    char message[96];
+    snprintf(message, sizeof(message), "erreur RMS brute %lu mm, lissee %lu mm", (unsigned long)brut, (unsigned long)lisse);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_GREATER_THAN_UINT32(4000, brut);
+    TEST_ASSERT_LESS_THAN_UINT32(brut * 80 / 100, lisse);
+}
+
+void test_acceptation_gnss_position_lissee()
+{
+    Gnss gnss;
+    gnss.coordonnees.latitude = parseGNSS("50.634412");
+    gnss.coordonnees.longitude = parseGNSS("3.048687");
+    gnss.satellites = "3";
+    TEST_ASSERT_FALSE(accepterFix(gnss, 0));
+
+    gnss.satellites = "8";
+    gnss.cn0 = "40";
+    TEST_ASSERT_TRUE(accepterFix(gnss, 1000));
+    TEST_ASSERT_EQUAL_STRING("50.634412", gnss.coordonnees.latitude.full.c_str());
+
+    // Lissage actif : le deuxième fix est rapproché de la position prédite
+    acceptationFix.config.lissage = true;
+    TEST_ASSERT_TRUE(accepterFix(gnss, 2000));
+    gnss.coordonnees.latitude = parseGNSS("50.634512");
+    TEST_ASSERT_TRUE(accepterFix(gnss, 3000));
+    TEST_ASSERT_UINT32_WITHIN(1, 50634462, (uint32_t)degresVersE6(gnss.coordonnees.latitude.full));
+    TEST_ASSERT_EQUAL_UINT32(1, acceptationFix.stats.rejets[REJET_SATELLITES]);
+}
@@ -0,0 +1,26 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_acceptation_criteres_qualite();
+void test_acceptation_precision_serveur();
+void test_acceptation_saut_rejete_puis_repris();
+void test_acceptation_sauts_discordants();
+void test_acceptation_lissage_reduit_erreur();
+void test_acceptation_gnss_position_lissee();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_acceptation_criteres_qualite);
+    RUN_TEST(test_acceptation_precision_serveur);
+    RUN_TEST(test_acceptation_saut_rejete_puis_repris);
+    RUN_TEST(test_acceptation_sauts_discordants);
+    RUN_TEST(test_acceptation_lissage_reduit_erreur);
+    RUN_TEST(test_acceptation_gnss_position_lissee);
+    UNITY_END();
+}
+
+void loop() {}
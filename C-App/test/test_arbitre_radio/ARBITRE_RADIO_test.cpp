@@ -0,0 +1,197 @@
+#include <unity.h>
+#include "ARBITRE_RADIO.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+// Véhicule garé : vitesse nulle, bonne qualité
+static const char *CGNSINF_ARRET = "\r\n+CGNSINF: 1,1,20250612101530.000,50.634412,3.048687,35.2,0.00,0.0,1,,1.2,1.5,0.9,,8,6,,,42,,\r\n\r\nOK\r\n";
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    arbitreRadio.reinitialiser();
+    arbitreRadio.config = ConfigArbitre();
+    nbCoordonnees = 0;
+    // Véhicule garé à horodatage constant : le cache et le rejet des doublons sont couverts par test_cache_fix
+    cacheFix.reinitialiser();
+    cacheFix.config.actif = false;
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+}
+
+void test_arbitre_decision_fenetre_lte()
+{
+    ArbitreRadio &a = arbitreRadio;
+    // Première fenêtre après le démarrage : envoi (les options du serveur arrivent avec la réponse)
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(false, false, 0, 30000, 1000));
+    a.ouvrirFenetreLte(1000, 0);
+
+    TEST_ASSERT_EQUAL(RADIO_MAINTENIR_GNSS, a.decider(false, false, 0, 30000, 40000));
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(true, false, 0, 30000, 40000));  // lot prêt
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(false, true, 0, 30000, 40000));  // événement de géofence
+
+    // Latence : le plus ancien fix ne peut pas attendre la prochaine fenêtre GNSS
+    TEST_ASSERT_EQUAL(RADIO_MAINTENIR_GNSS, a.decider(false, false, 250000, 30000, 40000));
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(false, false, 260001, 30000, 40000));
+
+    // Aucune fenêtre LTE depuis intervalleLteMaxMs
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(false, false, 0, 30000, 1000 + 870000));
+
+    TEST_ASSERT_FALSE(a.envoiUrgent(0));
+    TEST_ASSERT_FALSE(a.envoiUrgent(289999));
+    TEST_ASSERT_TRUE(a.envoiUrgent(290000));
+
+    // Comportement historique
+    json options = json::parse("{\"actif\": false}");
+    chargerOptionsArbitre(options);
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(false, false, 0, 30000, 40000));
+    TEST_ASSERT_FALSE(a.envoiUrgent(290000));
+}
+
+void test_arbitre_maintien_gnss()
+{
+    ArbitreRadio &a = arbitreRadio;
+    a.ouvrirFenetreLte(1000, 0);
+    TEST_ASSERT_EQUAL(RADIO_LTE, a.proprietaire());
+
+    a.gnssAllume(2000);
+    TEST_ASSERT_EQUAL(RADIO_MAINTENIR_GNSS, a.decider(false, false, 0, 30000, 20000));
+    a.gnssAllume(50000); // fenêtre suivante : déjà allumé
+    TEST_ASSERT_EQUAL(RADIO_DIFFERER, a.decider(false, false, 0, 120000, 60000));
+    a.gnssEteint(60000);
+    a.gnssAllume(180000);
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(true, false, 0, 120000, 200000));
+    a.gnssEteint(200000);
+    a.ouvrirFenetreLte(200000, 0);
+
+    const StatsArbitre &s = a.stats;
+    TEST_ASSERT_EQUAL_UINT32(2, s.nbAllumagesGnss);
+    TEST_ASSERT_EQUAL_UINT32(2, s.nbExtinctionsGnss);
+    TEST_ASSERT_EQUAL_UINT32(1, s.nbMaintiensGnss);
+    TEST_ASSERT_EQUAL_UINT32(2, s.nbEnvoisDifferes);
+    TEST_ASSERT_EQUAL_UINT32(2, s.nbBasculements); // LTE -> GNSS -> LTE
+    TEST_ASSERT_EQUAL_UINT32(2, s.nbFenetresLte);
+}
+
+void test_arbitre_envoi_termine_latence()
+{
+    for (int i = 0; i < 5; ++i)
+    {
+        dataGNSS[i] = DataGNSS();
+        dataGNSS[i].gnss.timeStamp = String(i);
+        dataGNSS[i].tFixMs = 10000 + 1000 * i;
+    }
+    dataGNSS[0].tFixMs = 0; // restauré sans âge connu
+    nbCoordonnees = 4;
+    TEST_ASSERT_EQUAL_UINT32(12000, ageAncienFix(dataGNSS, nbCoordonnees, 23000));
+
+    // Message composé avec 4 points ; un cinquième arrive avant la fin de l'envoi
+    arbitreRadio.ouvrirFenetreLte(20000, nbCoordonnees);
+    nbCoordonnees = 5;
+    arbitreRadio.envoiTermine(dataGNSS, nbCoordonnees, 30000);
+
+    TEST_ASSERT_EQUAL(1, nbCoordonnees);
+    TEST_ASSERT_EQUAL_STRING("4", dataGNSS[0].gnss.timeStamp.c_str());
+    const StatsArbitre &s = arbitreRadio.stats;
+    TEST_ASSERT_EQUAL_UINT32(3, s.nbPointsLivres);
+    TEST_ASSERT_EQUAL_UINT32(19000, s.latenceMaxMs);
+    TEST_ASSERT_EQUAL_UINT32(18000 * 3, (uint32_t)s.latenceCumuleeMs);
+}
+
+// Fenêtre GNSS pilotée par step_gnss_function, réponses CGNSINF du simulateur
+static void fenetreGnss()
+{
+    gnssStepState = GNSS_POWER_ON;
+    gnssPowerOnCommand.state = END;
+    step_gnss_function();
+    TEST_ASSERT_EQUAL(GNSS_INFO, gnssStepState);
+    for (int i = 0; i < 200 && gnssStepState == GNSS_INFO; ++i)
+    {
+        step_gnss_function();
+        delay(1000);
+    }
+}
+
+// Véhicule garé, cycles de 30 s : après le premier lot, le GNSS reste allumé et l'envoi est différé
+void test_arbitre_step_gnss_garde_le_gnss_allume()
+{
+    simulateur.repondre("AT+CGNSPWR?", "\r\n+CGNSPWR: 1\r\n\r\nOK\r\n");
+    simulateur.repondre("AT+CGNSINF", CGNSINF_ARRET);
+    imei = "123456789012345";
+    periodeAjustement = 30000;
+    fluxGnss = FluxGnss();
+    fluxGnss.mode = GNSS_MODE_SONDAGE;
+    echantillonneur.reinitialiser();
+    acceptationFix.reinitialiser();
+    arbitreRadio.ouvrirFenetreLte(millis(), 0);
+
+    // Confirmation de l'arrêt : plusieurs points, le lot est prêt et part
+    fenetreGnss();
+    TEST_ASSERT_EQUAL(GNSS_POWER_OFF, gnssStepState);
+    TEST_ASSERT_TRUE(tamponGnss.lotPret(nbCoordonnees));
+    gnssPowerOffCommand.state = END;
+    step_gnss_function();
+    step_gnss_function();
+    TEST_ASSERT_EQUAL(STEP_COMPOSE_JSON, currentStepGLOBAL);
+    int lot = nbCoordonnees; // après simplification du lot
+    TEST_ASSERT_TRUE(dataGNSS[0].fragment.indexOf("\"latitude\":50.634412") != -1); // composé pendant l'acquisition
+    step_compose_json_function();
+    TEST_ASSERT_EQUAL_UINT32(lot, arbitreRadio.stats.nbFragmentsPrets);
+    TEST_ASSERT_EQUAL_UINT32(0, arbitreRadio.stats.nbFragmentsComposes);
+    TEST_ASSERT_EQUAL(RADIO_LTE, arbitreRadio.proprietaire());
+    endCBOR = true;
+    STEP_END_FUNCTION();
+    TEST_ASSERT_EQUAL(0, nbCoordonnees);
+    TEST_ASSERT_EQUAL_UINT32(lot, arbitreRadio.stats.nbPointsLivres);
+
+    // Arrêt confirmé : un point par cycle, GNSS_POWER_OFF sauté, pas d'envoi
+    for (int cycle = 0; cycle < 2; ++cycle)
+    {
+        fenetreGnss();
+        TEST_ASSERT_EQUAL(GNSS_DONE, gnssStepState);
+        TEST_ASSERT_TRUE(arbitreRadio.estGnssAllume());
+        step_gnss_function();
+        TEST_ASSERT_EQUAL(STEP_END_GLOBAL, currentStepGLOBAL);
+    }
+    TEST_ASSERT_EQUAL(2, nbCoordonnees);
+    TEST_ASSERT_EQUAL_UINT32(2, arbitreRadio.stats.nbAllumagesGnss);
+    TEST_ASSERT_EQUAL_UINT32(1, arbitreRadio.stats.nbExtinctionsGnss);
+    TEST_ASSERT_EQUAL_UINT32(2, arbitreRadio.stats.nbMaintiensGnss);
+    TEST_ASSERT_EQUAL_UINT32(3, arbitreRadio.stats.nbBasculements); // LTE -> GNSS -> LTE -> GNSS
+}
+
+void test_arbitre_benchmark_ordonnancement()
+{
+    ScenarioRadio scenario;
+    ConfigArbitre historique;
+    historique.actif = false;
+    ConfigArbitre arbitre;
+
+    RapportRadio avant = simulerOrdonnancement(scenario, historique);
+    RapportRadio apres = simulerOrdonnancement(scenario, arbitre);
+
+    char message[160];
+    const RapportRadio *rapports[] = {&avant, &apres};
+    const char *noms[] = {"Historique", "Arbitre   "};
+    for (int i = 0; i < 2; ++i)
+    {
+        snprintf(message, sizeof(message), "%s : %.1f basculements/h, %.1f CGNSPWR/h, %.1f fenetres LTE/h, latence moy %lu s max %lu s, GNSS %lu pour mille",
+                 noms[i], rapports[i]->basculementsParHeure, rapports[i]->commandesGnssParHeure, rapports[i]->fenetresLteParHeure,
+                 (unsigned long)rapports[i]->latenceMoyenneS, (unsigned long)rapports[i]->latenceMaxS, (unsigned long)rapports[i]->gnssAllumePourMille);
+        TEST_MESSAGE(message);
+    }
+
+    // En déplacement, chaque cycle remplit le lot : seuls les cycles à l'arrêt sont regroupés
+    TEST_ASSERT_TRUE(apres.basculementsParHeure * 3 < avant.basculementsParHeure * 2);
+    TEST_ASSERT_TRUE(apres.commandesGnssParHeure * 3 < avant.commandesGnssParHeure * 2);
+    // Latence bornée par latenceMaxMs
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(arbitre.latenceMaxMs / 1000, apres.latenceMaxS);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, apres.nbPointsLivres);
+}
@@ -0,0 +1,24 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_arbitre_decision_fenetre_lte();
+void test_arbitre_maintien_gnss();
+void test_arbitre_envoi_termine_latence();
+void test_arbitre_step_gnss_garde_le_gnss_allume();
+void test_arbitre_benchmark_ordonnancement();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_arbitre_decision_fenetre_lte);
+    RUN_TEST(test_arbitre_maintien_gnss);
+    RUN_TEST(test_arbitre_envoi_termine_latence);
+    RUN_TEST(test_arbitre_step_gnss_garde_le_gnss_allume);
+    RUN_TEST(test_arbitre_benchmark_ordonnancement);
+    UNITY_END();
+}
+
+void loop() {}
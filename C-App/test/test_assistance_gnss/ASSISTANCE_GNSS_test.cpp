@@ -0,0 +1,171 @@
+#include <unity.h>
+#include "ASSISTANCE_GNSS.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+// Serveur XTRA local : l'URL pointe vers un substitut, le simulateur renvoie la taille de ce fichier
+#define URL_XTRA_LOCAL "http://127.0.0.1:8080/xtra3gr_72h.bin"
+static const long TAILLE_XTRA_LOCAL = 36352;
+
+static const char *REPONSE_FIX = "\r\n+CGNSINF: 1,1,20250612101530.000,50.634412,3.048687,35.2,0.00,0.0,1,,1.2,1.5,0.9,,8,6,,,42,,\r\n\r\nOK\r\n";
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    assistanceGnss = AssistanceGNSS();
+    assistanceGnss.urlXtra = URL_XTRA_LOCAL;
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+}
+
+void test_assistance_constellations()
+{
+    TEST_ASSERT_EQUAL_STRING("AT+CGNSMOD=1,0,0,1,0", commandeConstellations(assistanceGnss.constellations).c_str());
+
+    appliquerConstellations();
+    appliquerConstellations();
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CGNSMOD="));
+
+    // Nouvelle sélection : renvoyée une seule fois
+    assistanceGnss.constellations.beidou = true;
+    appliquerConstellations();
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CGNSMOD=1,0,1,1,0"));
+    TEST_ASSERT_EQUAL(2, simulateur.compter("AT+CGNSMOD="));
+}
+
+void test_assistance_telechargement_xtra()
+{
+    simulateur.repondre("AT+HTTPTOFSRL?", "\r\n+HTTPTOFSRL: 1\r\n\r\nOK\r\n", 2);
+    simulateur.repondre("AT+HTTPTOFSRL?", "\r\n+HTTPTOFS: 200," + String(TAILLE_XTRA_LOCAL) + "\r\n\r\n+HTTPTOFSRL: 0\r\n\r\nOK\r\n");
+
+    TEST_ASSERT_TRUE(xtraAMettreAJour(0));
+    mettreAJourXtraSiNecessaire(1000);
+
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+HTTPTOFS=\"" URL_XTRA_LOCAL "\",\"" FICHIER_XTRA "\""));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CGNSCPY"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CGNSXTRA=1"));
+    TEST_ASSERT_TRUE(xtraValide(1000 + 3600000UL));
+    TEST_ASSERT_EQUAL(1, assistanceGnss.stats.nbTelechargementsXtra);
+
+    // Pas de nouveau téléchargement avant 24 h, puis rafraîchissement bien avant les 72 h de validité
+    mettreAJourXtraSiNecessaire(1000 + 3600000UL);
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+HTTPTOFS="));
+    TEST_ASSERT_TRUE(xtraAMettreAJour(1000 + 24UL * 3600000UL));
+    TEST_ASSERT_FALSE(xtraValide(1000 + 72UL * 3600000UL));
+
+    // Démarrage assisté quand les éphémérides diffusées sont périmées
+    TEST_ASSERT_EQUAL(DEMARRAGE_ASSISTE, typeDemarrageAttendu(2000));
+}
+
+void test_assistance_echec_xtra()
+{
+    simulateur.repondre("AT+HTTPTOFSRL?", "\r\n+HTTPTOFS: 404,0\r\n\r\n+HTTPTOFSRL: 0\r\n\r\nOK\r\n");
+
+    TEST_ASSERT_FALSE(telechargerXtra(0));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CGNSCPY"));
+    TEST_ASSERT_FALSE(assistanceGnss.xtraDisponible);
+    TEST_ASSERT_EQUAL(1, assistanceGnss.stats.nbEchecsXtra);
+    TEST_ASSERT_EQUAL(DEMARRAGE_COLD, typeDemarrageAttendu(0));
+}
+
+void test_assistance_ttff_histogramme()
+{
+    // Démarrage à froid : premier fix en 42 s
+    debutAcquisition(10000);
+    TEST_ASSERT_EQUAL(DEMARRAGE_COLD, assistanceGnss.typeAcquisition);
+    enregistrerFixAcquisition(52000);
+    enregistrerFixAcquisition(55000);
+    finAcquisition(58000);
+
+    // Cycle suivant 10 min plus tard : hot start, premier fix en 2 s
+    debutAcquisition(658000);
+    TEST_ASSERT_EQUAL(DEMARRAGE_HOT, assistanceGnss.typeAcquisition);
+    enregistrerFixAcquisition(660000);
+    finAcquisition(661000);
+
+    // Acquisition sans fix
+    debutAcquisition(700000);
+    finAcquisition(710000);
+
+    const StatsAcquisition &s = assistanceGnss.stats;
+    TEST_ASSERT_EQUAL(1, s.histogrammeTtff[classeTtff(42000)]);
+    TEST_ASSERT_EQUAL(1, s.histogrammeTtff[0]);
+    TEST_ASSERT_EQUAL(4, classeTtff(42000));
+    TEST_ASSERT_EQUAL(NB_CLASSES_TTFF - 1, classeTtff(300000));
+    TEST_ASSERT_EQUAL(42000, s.ttffCumuleMs[DEMARRAGE_COLD]);
+    TEST_ASSERT_EQUAL(2000, s.dernierTtffMs);
+    TEST_ASSERT_EQUAL(1, s.nbSansFix);
+    // GNSS allumé 48 s + 3 s + 10 s pour 3 fix
+    TEST_ASSERT_EQUAL(61000, s.tempsAllumeMs);
+    TEST_ASSERT_EQUAL(61000 / 3, tempsGnssParFixMs());
+}
+
+void test_assistance_fenetre_entretien()
+{
+    const unsigned long H = 3600000UL;
+    assistanceGnss.ephemeridesConnues = true;
+    assistanceGnss.derniereFixMs = 0;
+
+    // Cycle avant l'expiration des éphémérides : pas de fenêtre
+    TEST_ASSERT_EQUAL(H, echeanceEntretien(1000, H));
+    // Cycle dans 3 h : réveil juste avant l'expiration (2 h)
+    unsigned long echeance = echeanceEntretien(1000, 3 * H);
+    TEST_ASSERT_EQUAL(2 * H - assistanceGnss.dureeFenetreMs, echeance);
+    TEST_ASSERT_FALSE(entretenirEphemerides(1000, 3 * H));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CGNSPWR=1"));
+
+    // A l'échéance : GNSS allumé, fix, puis extinction après la durée de la fenêtre
+    simulateur.repondre("AT+CGNSINF", REPONSE_FIX);
+    unsigned long t = echeance;
+    TEST_ASSERT_TRUE(entretenirEphemerides(t, 3 * H));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CGNSPWR=1"));
+    while (entretenirEphemerides(t, 3 * H))
+        t += 500;
+
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CGNSPWR=0"));
+    TEST_ASSERT_EQUAL(1, assistanceGnss.stats.nbFenetresEntretien);
+    TEST_ASSERT_EQUAL(t, assistanceGnss.derniereFixMs);
+    // Le prochain cycle démarre donc en hot start
+    TEST_ASSERT_EQUAL(DEMARRAGE_HOT, typeDemarrageAttendu(3 * H));
+}
+
+// AT+CGNSPWR=1 refusé : nouvel essai après un délai doublé, puis abandon de la fenêtre jusqu'au prochain cycle
+void test_assistance_entretien_allumage_refuse()
+{
+    const unsigned long H = 3600000UL;
+    assistanceGnss.ephemeridesConnues = true;
+    assistanceGnss.derniereFixMs = 0;
+    simulateur.repondre("AT+CGNSPWR=1", "\r\nERROR\r\n");
+
+    unsigned long t = echeanceEntretien(1000, 3 * H);
+    TEST_ASSERT_FALSE(entretenirEphemerides(t, 3 * H));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CGNSPWR=1"));
+
+    // Pas de nouvel essai avant le délai : l'appelant dort jusqu'à l'échéance décalée
+    TEST_ASSERT_EQUAL(t + 2000, echeanceEntretien(t + 500, 3 * H));
+    TEST_ASSERT_FALSE(entretenirEphemerides(t + 500, 3 * H));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CGNSPWR=1"));
+
+    // Essais à +2 s, +4 s, +8 s : le quatrième refus abandonne la fenêtre
+    t += 2000;
+    TEST_ASSERT_FALSE(entretenirEphemerides(t, 3 * H));
+    TEST_ASSERT_EQUAL(t + 4000, echeanceEntretien(t, 3 * H));
+    t += 4000;
+    TEST_ASSERT_FALSE(entretenirEphemerides(t, 3 * H));
+    t += 8000;
+    TEST_ASSERT_FALSE(entretenirEphemerides(t, 3 * H));
+    TEST_ASSERT_EQUAL(4, simulateur.compter("AT+CGNSPWR=1"));
+    TEST_ASSERT_EQUAL(4, assistanceGnss.stats.nbEchecsAllumage);
+    TEST_ASSERT_EQUAL(1, assistanceGnss.stats.nbEntretiensAbandonnes);
+
+    // Plus de fenêtre avant le cycle, qui fera une acquisition normale
+    TEST_ASSERT_EQUAL(3 * H, echeanceEntretien(t + 500, 3 * H));
+    TEST_ASSERT_FALSE(entretenirEphemerides(t + 500, 3 * H));
+    TEST_ASSERT_EQUAL(4, simulateur.compter("AT+CGNSPWR=1"));
+    TEST_ASSERT_FALSE(assistanceGnss.entretienEnCours);
+}
@@ -0,0 +1,26 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_assistance_constellations();
+void test_assistance_telechargement_xtra();
+void test_assistance_echec_xtra();
+void test_assistance_ttff_histogramme();
+void test_assistance_fenetre_entretien();
+void test_assistance_entretien_allumage_refuse();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_assistance_constellations);
+    RUN_TEST(test_assistance_telechargement_xtra);
+    RUN_TEST(test_assistance_echec_xtra);
+    RUN_TEST(test_assistance_ttff_histogramme);
+    RUN_TEST(test_assistance_fenetre_entretien);
+    RUN_TEST(test_assistance_entretien_allumage_refuse);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,252 @@
+#include <unity.h>
+#include "BASE_TEMPS.hpp"
+#include "PARSER_TIMESTAMP.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+// 12/06/2025 10:15:30 UTC
+static const int64_t T_FIX = 1749723330000LL;
+
+// Le calendrier est vérifié à la compilation
+static_assert(joursDepuisEpoque(1970, 1, 1) == 0, "epoch");
+static_assert(joursDepuisEpoque(2000, 3, 1) == 11017, "lendemain du 29/02/2000");
+static_assert(epochMs(2025, 6, 12, 10, 15, 30, 0) == T_FIX, "fix de référence");
+static_assert(epochMs(2038, 1, 19, 3, 14, 8, 0) == 2147483648000LL, "après 2038");
+static_assert(epochMs(2100, 3, 1, 0, 0, 0, 0) == 4107542400000LL, "2100 n'est pas bissextile");
+static_assert(dateDepuisEpochMs(1709251199000LL).jour == 29 && dateDepuisEpochMs(1709251199000LL).mois == 2, "29/02/2024");
+static_assert(dateDepuisEpochMs(1709251200000LL).jour == 1 && dateDepuisEpochMs(1709251200000LL).mois == 3, "01/03/2024");
+static_assert(dateDepuisEpochMs(-1).annee == 1969 && dateDepuisEpochMs(-1).milli == 999, "avant l'epoch");
+static_assert(!estBissextile(1900) && estBissextile(2000) && joursDansMois(2100, 2) == 28 && joursDansMois(2025, 4) == 30, "bissextiles");
+static_assert(jourSemaine(0) == 4 && jourSemaine(joursDepuisEpoque(2025, 6, 12)) == 4, "jeudis");
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    baseTemps.reinitialiser();
+    baseTemps.config = ConfigBaseTemps();
+    nbCoordonnees = 0;
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+}
+
+// Chaque jour de 1970 à 2199 contre un comptage naïf mois par mois
+void test_base_temps_calendrier()
+{
+    int32_t jours = 0;
+    for (int32_t annee = 1970; annee < 2200; ++annee)
+        for (uint32_t mois = 1; mois <= 12; ++mois)
+            for (uint32_t jour = 1; jour <= joursDansMois(annee, mois); ++jour, ++jours)
+            {
+                if (joursDepuisEpoque(annee, mois, jour) != jours)
+                    TEST_FAIL_MESSAGE(("jours " + String(annee) + "/" + String(mois) + "/" + String(jour)).c_str());
+                DateUTC d = dateDepuisEpochMs((int64_t)jours * MS_PAR_JOUR + 45296789); // 12:34:56.789
+                if (d.annee != annee || d.mois != mois || d.jour != jour || d.heure != 12 || d.minute != 34 ||
+                    d.seconde != 56 || d.milli != 789)
+                    TEST_FAIL_MESSAGE(("date " + String(annee) + "/" + String(mois) + "/" + String(jour)).c_str());
+            }
+    TEST_ASSERT_EQUAL_INT32(84006, jours);
+}
+
+void test_base_temps_analyse_horodatage()
+{
+    TEST_ASSERT_TRUE(T_FIX == horodatageVersEpochMs("20250612101530.000"));
+    TEST_ASSERT_TRUE(T_FIX == horodatageVersEpochMs("20250612101530"));
+    TEST_ASSERT_TRUE(T_FIX + 500 == horodatageVersEpochMs("20250612101530.5"));
+    TEST_ASSERT_TRUE(T_FIX + 123 == horodatageVersEpochMs("20250612101530.123"));
+    TEST_ASSERT_TRUE(1709251199000LL == horodatageVersEpochMs("20240229235959.000"));
+
+    // Dates hors calendrier ou mal formées
+    TEST_ASSERT_TRUE(0 == horodatageVersEpochMs("20230229120000.000"));
+    TEST_ASSERT_TRUE(0 == horodatageVersEpochMs("20250431120000.000"));
+    TEST_ASSERT_TRUE(0 == horodatageVersEpochMs("20251301120000.000"));
+    TEST_ASSERT_TRUE(0 == horodatageVersEpochMs("20250612241530.000"));
+    TEST_ASSERT_TRUE(0 == horodatageVersEpochMs("2025061210153"));
+    TEST_ASSERT_TRUE(0 == horodatageVersEpochMs("2025-06-12 10:15"));
+    TEST_ASSERT_TRUE(0 == horodatageVersEpochMs(""));
+
+    char texte[20];
+    formaterHorodatage(T_FIX + 42, texte, sizeof(texte));
+    TEST_ASSERT_EQUAL_STRING("20250612101530.042", texte);
+    formaterHorodatage(T_FIX, texte, 10);
+    TEST_ASSERT_EQUAL_STRING("", texte);
+
+    // Heure réseau : fuseau en quarts d'heure, heure par défaut d'un modem jamais réglé
+    TEST_ASSERT_TRUE(T_FIX == epochDepuisCCLK("\r\n+CCLK: \"25/06/12,12:15:30+08\"\r\n\r\nOK\r\n"));
+    TEST_ASSERT_TRUE(epochMs(2025, 6, 30, 23, 0, 0, 0) == epochDepuisCCLK("+CCLK: \"25/07/01,01:00:00+08\""));
+    TEST_ASSERT_TRUE(0 == epochDepuisCCLK("+CCLK: \"80/01/06,00:00:00+00\""));
+    TEST_ASSERT_TRUE(0 == epochDepuisCCLK("+CCLK: \"25/02/30,00:00:00+00\""));
+    TEST_ASSERT_TRUE(0 == epochDepuisCCLK("\r\nERROR\r\n"));
+}
+
+// Le jour suivant dépend de la longueur du mois
+void test_base_temps_heure_locale_fin_de_mois()
+{
+    TEST_ASSERT_EQUAL_STRING("2025/05/01 01:00:00", convertTimestampToLocalTime("20250430230000.000", 2).c_str());
+    TEST_ASSERT_EQUAL_STRING("2025/03/01 00:30:00", convertTimestampToLocalTime("20250228233000.000", 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("2024/02/29 23:30:00", convertTimestampToLocalTime("20240301003000.000", -1).c_str());
+    TEST_ASSERT_EQUAL_STRING("2025/01/01 00:00:00", convertTimestampToLocalTime("20241231230000.000", 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("2025/06/12 12:15:30", convertTimestampToLocalTime("20250612101530.000", 2).c_str());
+    TEST_ASSERT_EQUAL_STRING("", convertTimestampToLocalTime("", 2).c_str());
+
+    tm t = parserTimeStamp("20250612101530.000");
+    TEST_ASSERT_EQUAL(125, t.tm_year);
+    TEST_ASSERT_EQUAL(5, t.tm_mon);
+    TEST_ASSERT_EQUAL(12, t.tm_mday);
+    TEST_ASSERT_EQUAL(10, t.tm_hour);
+    TEST_ASSERT_EQUAL(15, t.tm_min);
+    TEST_ASSERT_EQUAL(30, t.tm_sec);
+    TEST_ASSERT_EQUAL(4, t.tm_wday);
+    TEST_ASSERT_EQUAL(162, t.tm_yday);
+    tm local = convertTimestampToLocalTimeTm("20251231233000.000", 1);
+    TEST_ASSERT_EQUAL(126, local.tm_year);
+    TEST_ASSERT_EQUAL(0, local.tm_yday);
+}
+
+void test_base_temps_discipline()
+{
+    BaseTemps &h = baseTemps;
+    TEST_ASSERT_FALSE(h.estSynchronisee());
+    TEST_ASSERT_TRUE(0 == h.maintenantMs(1000));
+    TEST_ASSERT_FALSE(h.estPrecise(1000));
+
+    // Heure réseau, puis le premier fix GNSS : le réseau avait 700 ms de retard
+    TEST_ASSERT_TRUE(h.synchroniser(T_FIX - 4000, 1000, TEMPS_RESEAU));
+    TEST_ASSERT_TRUE(h.estPrecise(1000));
+    TEST_ASSERT_TRUE(h.synchroniser(T_FIX + 700, 5000, TEMPS_GNSS));
+    TEST_ASSERT_EQUAL_UINT32(700, h.stats.ecartMaxMs);
+    TEST_ASSERT_EQUAL(TEMPS_GNSS, h.sourceCourante());
+
+    // AT+CCLK? est moins précis que l'horloge disciplinée ; une heure non réglée est refusée
+    TEST_ASSERT_FALSE(h.synchroniser(T_FIX + 2000, 6000, TEMPS_RESEAU));
+    TEST_ASSERT_EQUAL_UINT32(1, h.stats.nbIgnorees);
+    TEST_ASSERT_FALSE(h.synchroniser(315964800000LL, 6000, TEMPS_GNSS));
+    TEST_ASSERT_EQUAL_UINT32(1, h.stats.nbRejets);
+
+    // Recalage en arrière : l'heure lue ne recule pas
+    int64_t avant = h.maintenantMs(6999);
+    TEST_ASSERT_TRUE(T_FIX + 2699 == avant);
+    TEST_ASSERT_TRUE(h.synchroniser(T_FIX + 2400, 7000, TEMPS_GNSS));
+    TEST_ASSERT_TRUE(avant == h.maintenantMs(7000));
+    TEST_ASSERT_TRUE(avant == h.maintenantMs(7299));
+    TEST_ASSERT_TRUE(avant + 1 == h.maintenantMs(7300));
+    TEST_ASSERT_EQUAL_UINT32(1, h.stats.nbRetenues);
+    TEST_ASSERT_TRUE(T_FIX + 2400 - 1000 == h.versEpochMs(6000)); // instant antérieur (événement)
+
+    // L'incertitude croît avec la dérive du quartz
+    TEST_ASSERT_EQUAL_UINT32(500, h.incertitudeMs(7000));
+    TEST_ASSERT_EQUAL_UINT32(608, h.incertitudeMs(7000 + 3600000));
+}
+
+// La RTC compte le deep sleep 3 % trop court : le GNSS mesure l'écart au réveil et la dérive est corrigée
+void test_base_temps_sommeil_calibration()
+{
+    BaseTemps &h = baseTemps;
+    const uint32_t sommeil = 900000;
+    const uint32_t sommeilReel = 927000;
+    h.synchroniser(T_FIX, 1000, TEMPS_GNSS);
+    int64_t vrai = T_FIX + 1000; // heure vraie à l'endormissement (t = 2000)
+    EtatBaseTemps etat = h.sauvegarder(2000);
+    TEST_ASSERT_TRUE(vrai == etat.epochMs);
+
+    h.restaurer(etat, sommeil, 100);
+    TEST_ASSERT_EQUAL(TEMPS_SOMMEIL, h.sourceCourante());
+    TEST_ASSERT_EQUAL_UINT32(500 + 18000, h.incertitudeMs(100));
+    TEST_ASSERT_FALSE(h.estPrecise(100));
+    vrai += sommeilReel;
+    TEST_ASSERT_TRUE(h.synchroniser(vrai + 100, 200, TEMPS_GNSS));
+    TEST_ASSERT_EQUAL_UINT32(1, h.stats.nbCalibrations);
+    TEST_ASSERT_UINT32_WITHIN(100, 30000, (uint32_t)h.correctionSommeilPpm());
+
+    // Sommeil suivant : l'heure estimée au réveil est juste à la résolution près
+    vrai += 100 + 1000; // synchronisé à t = 200, endormi à t = 1200
+    etat = h.sauvegarder(1200);
+    h.restaurer(etat, sommeil, 50);
+    vrai += sommeilReel;
+    TEST_ASSERT_UINT32_WITHIN(50, 0, (uint32_t)llabs(h.versEpochMs(50) - vrai));
+    TEST_ASSERT_EQUAL_UINT32(500 + 1800, h.incertitudeMs(50));
+    TEST_ASSERT_TRUE(h.synchroniser(vrai + 10, 60, TEMPS_GNSS));
+    TEST_ASSERT_UINT32_WITHIN(100, 30000, (uint32_t)h.correctionSommeilPpm());
+
+    // Horloge jamais synchronisée : rien à restaurer
+    h.reinitialiser();
+    h.restaurer(h.sauvegarder(0), sommeil, 0);
+    TEST_ASSERT_FALSE(h.estSynchronisee());
+}
+
+// Fixes, positions de repli et événements portent l'heure UTC sans requête AT+CCLK? supplémentaire
+void test_base_temps_horodatage_des_points()
+{
+    simulateur.repondre("AT+CCLK?", "\r\n+CCLK: \"25/06/12,12:20:00+08\"\r\n\r\nOK\r\n");
+    imei = "123456789012345";
+
+    // Sans heure : une position réseau demande AT+CCLK?, qui recale l'horloge
+    TEST_ASSERT_TRUE(T_FIX + 270000 == horodatageCourantMs());
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CCLK?"));
+    TEST_ASSERT_EQUAL(TEMPS_RESEAU, baseTemps.sourceCourante());
+
+    // Un fix GNSS recale l'horloge
+    Gnss gnss;
+    gnss.coordonnees.latitude = parseGNSS("50.634412");
+    gnss.coordonnees.longitude = parseGNSS("3.048687");
+    gnss.timeStamp = "20250612102500.000";
+    gnss.isValid = true;
+    addGNSSInDataGNSS(gnss);
+    TEST_ASSERT_EQUAL(TEMPS_GNSS, baseTemps.sourceCourante());
+    TEST_ASSERT_TRUE(dataGNSS[nbCoordonnees - 1].fragment.indexOf(",\"horodatage\":1749723900000}") != -1);
+
+    // Les positions suivantes sont horodatées par l'horloge
+    int64_t heure = horodatageCourantMs();
+    TEST_ASSERT_TRUE(heure >= 1749723900000LL && heure < 1749723900000LL + 1000);
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CCLK?"));
+    TEST_ASSERT_EQUAL_UINT32(1, baseTemps.stats.nbRequetesEvitees);
+
+    Gnss sansHeure = gnss;
+    sansHeure.timeStamp = "";
+    addGNSSInDataGNSS(sansHeure);
+    TEST_ASSERT_TRUE(horodatageVersEpochMs(dataGNSS[nbCoordonnees - 1].gnss.timeStamp) >= heure);
+    TEST_ASSERT_TRUE(dataGNSS[nbCoordonnees - 1].fragment.indexOf("\"horodatage\":17497239") != -1);
+}
+
+// Analyse d'un horodatage : six substring() historiques contre la lecture directe du tampon
+static int64_t horodatageHistorique(String utcTimestamp)
+{
+    int year = utcTimestamp.substring(0, 4).toInt();
+    int month = utcTimestamp.substring(4, 6).toInt();
+    int day = utcTimestamp.substring(6, 8).toInt();
+    int hour = utcTimestamp.substring(8, 10).toInt();
+    int minute = utcTimestamp.substring(10, 12).toInt();
+    int second = utcTimestamp.substring(12, 14).toInt();
+    return epochMs(year, month, day, hour, minute, second, 0);
+}
+
+void test_base_temps_benchmark_analyse()
+{
+    const int nb = 2000;
+    static String horodatages[nb];
+    for (int i = 0; i < nb; ++i)
+        horodatages[i] = epochVersHorodatage(T_FIX + (int64_t)i * 86399000LL);
+
+    uint32_t cyclesHistorique = 0, cycles = 0;
+    for (int i = 0; i < nb; ++i)
+    {
+        uint32_t debut = compteurCycles();
+        int64_t attendu = horodatageHistorique(horodatages[i]);
+        cyclesHistorique += compteurCycles() - debut;
+        debut = compteurCycles();
+        int64_t lu = horodatageVersEpochMs(horodatages[i]);
+        cycles += compteurCycles() - debut;
+        if (lu != attendu)
+            TEST_FAIL_MESSAGE(horodatages[i].c_str());
+    }
+
+    TEST_MESSAGE(("Analyse d'un horodatage : " + String(cyclesHistorique / nb) + " cycles (substring) -> " +
+                  String(cycles / nb) + " cycles (sans allocation)")
+                     .c_str());
+    TEST_ASSERT_LESS_THAN_UINT32(cyclesHistorique, cycles);
+}
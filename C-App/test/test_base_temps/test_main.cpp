@@ -0,0 +1,28 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_base_temps_calendrier();
+void test_base_temps_analyse_horodatage();
+void test_base_temps_heure_locale_fin_de_mois();
+void test_base_temps_discipline();
+void test_base_temps_sommeil_calibration();
+void test_base_temps_horodatage_des_points();
+void test_base_temps_benchmark_analyse();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_base_temps_calendrier);
+    RUN_TEST(test_base_temps_analyse_horodatage);
+    RUN_TEST(test_base_temps_heure_locale_fin_de_mois);
+    RUN_TEST(test_base_temps_discipline);
+    RUN_TEST(test_base_temps_sommeil_calibration);
+    RUN_TEST(test_base_temps_horodatage_des_points);
+    RUN_TEST(test_base_temps_benchmark_analyse);
+    UNITY_END();
+}
+
+void loop() {}
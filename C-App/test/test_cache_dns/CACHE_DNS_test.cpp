@@ -0,0 +1,214 @@
+#include <unity.h>
+#include "CACHE_DNS.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+#include "ROM.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+extern ATCommandTask taskCBOR_OPEN_CONNEXION;
+
+#define IP_SERVEUR "203.0.113.7"
+#define REPONSE_CDNSGIP "\r\nOK\r\n\r\n+CDNSGIP: 1,\"" PINGGY_LINK "\",\"" IP_SERVEUR "\"\r\n"
+
+static uint32_t nbResolutionsLocales = 0;
+
+// Résolveur local : un serveur par nom, sans passer par le modem
+static bool resoudreLocal(const char *hote, String &ip, unsigned long)
+{
+    nbResolutionsLocales++;
+    ip = strcmp(hote, "a.local") == 0 ? "10.0.0.1" : "10.0.0.2";
+    return true;
+}
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    simulateur.repondre("AT+CASEND=1,", "\r\n>"); // identification du canal de contrôle
+    EEPROM.write(ADDR_CACHE_DNS, 0); // pas de cache d'un test précédent
+    cacheDns.config = ConfigDns();
+    cacheDns.config.actif = true;
+    cacheDns.resoudre = nullptr;
+    cacheDns.reinitialiser();
+    multiplexeurSockets.reinitialiser();
+    multiplexeurSockets.config = ConfigSockets();
+    nbResolutionsLocales = 0;
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+    cacheDns.config = ConfigDns();
+    cacheDns.resoudre = nullptr;
+    cacheDns.reinitialiser();
+}
+
+// Une résolution, puis l'adresse en cache sert les ouvertures suivantes
+void test_dns_resolution_unique()
+{
+    simulateur.repondre("AT+CDNSGIP", REPONSE_CDNSGIP);
+    unsigned long t = millis();
+    TEST_ASSERT_TRUE(cacheDns.entretenir(t));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CDNSGIP=\"" PINGGY_LINK "\""));
+    TEST_ASSERT_TRUE(cacheDns.entretenir(t + 1000));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CDNSGIP"));
+    TEST_ASSERT_EQUAL_STRING(IP_SERVEUR, cacheDns.adresse().c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, cacheDns.stats.nbResolutions);
+    TEST_ASSERT_EQUAL_UINT32(1, cacheDns.stats.nbResolutionsEvitees);
+
+    simulateur.repondre("AT+CAOPEN=1", "\r\n+CAOPEN: 1,0\r\n\r\nOK\r\n");
+    TEST_ASSERT_TRUE(multiplexeurSockets.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CAOPEN=1,0,\"TCP\"," IP_SERVEUR "," + String(PINGGY_PORT)));
+    TEST_ASSERT_EQUAL_UINT32(1, cacheDns.stats.nbConnexions);
+    TEST_ASSERT_EQUAL(1, cacheDns.point(0).nbConnexions);
+}
+
+// Sans TTL dans AT+CDNSGIP, l'adresse expire après config.ttlS
+void test_dns_expiration()
+{
+    simulateur.repondre("AT+CDNSGIP", REPONSE_CDNSGIP);
+    cacheDns.config.ttlS = 60;
+    unsigned long t = millis();
+    cacheDns.entretenir(t);
+    cacheDns.entretenir(t + 59000);
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CDNSGIP"));
+    cacheDns.entretenir(t + 61000);
+    TEST_ASSERT_EQUAL(2, simulateur.compter("AT+CDNSGIP"));
+
+    // Désactivé : pas de résolution, AT+CAOPEN au nom d'hôte (comportement précédent)
+    cacheDns.config.actif = false;
+    TEST_ASSERT_FALSE(cacheDns.entretenir(t + 200000));
+    TEST_ASSERT_EQUAL(2, simulateur.compter("AT+CDNSGIP"));
+    TEST_ASSERT_EQUAL_STRING(PINGGY_LINK, cacheDns.adresse().c_str());
+}
+
+// Résolution refusée : nom d'hôte, et pas de nouvel essai avant config.nouvelEssaiS
+void test_dns_echec_resolution()
+{
+    simulateur.repondre("AT+CDNSGIP", "\r\nOK\r\n\r\n+CDNSGIP: 0,8\r\n");
+    unsigned long t = millis();
+    TEST_ASSERT_FALSE(cacheDns.entretenir(t));
+    TEST_ASSERT_EQUAL_STRING(PINGGY_LINK, cacheDns.adresse().c_str());
+    TEST_ASSERT_FALSE(cacheDns.entretenir(t + 1000));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CDNSGIP"));
+    TEST_ASSERT_EQUAL_UINT32(1, cacheDns.stats.nbEchecsResolution);
+
+    simulateur.repondre("AT+CDNSGIP", REPONSE_CDNSGIP);
+    TEST_ASSERT_TRUE(cacheDns.entretenir(t + cacheDns.config.nouvelEssaiS * 1000UL + 1));
+    TEST_ASSERT_EQUAL_STRING(IP_SERVEUR, cacheDns.adresse().c_str());
+}
+
+// L'adresse relue de l'EEPROM au démarrage sert jusqu'au premier échec de connexion
+void test_dns_persistance()
+{
+    simulateur.repondre("AT+CDNSGIP", REPONSE_CDNSGIP);
+    cacheDns.entretenir(millis());
+
+    cacheDns.reinitialiser(); // redémarrage : RAM perdue
+    simulateur.commandes.clear();
+    TEST_ASSERT_TRUE(cacheDns.entretenir(millis()));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CDNSGIP"));
+    TEST_ASSERT_EQUAL_STRING(IP_SERVEUR, cacheDns.adresse().c_str());
+
+    cacheDns.connexionEchouee(millis());
+    TEST_ASSERT_EQUAL_STRING(PINGGY_LINK, cacheDns.adresse().c_str());
+    TEST_ASSERT_TRUE(cacheDns.entretenir(millis()));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CDNSGIP"));
+
+    // Cache corrompu : ignoré
+    EEPROM.write(ADDR_CACHE_DNS + 8, EEPROM.read(ADDR_CACHE_DNS + 8) ^ 0xFF);
+    cacheDns.reinitialiser();
+    TEST_ASSERT_FALSE(cacheDns.charger());
+}
+
+// Le point d'accès le plus rapide est choisi ; deux échecs d'affilée le font écarter pendant config.retourS
+void test_dns_bascule_latence()
+{
+    cacheDns.config.persistant = false;
+    cacheDns.resoudre = resoudreLocal;
+    cacheDns.definirPoints({{"a.local", 1}, {"b.local", 2}});
+    unsigned long t = 1000;
+
+    cacheDns.entretenir(t);
+    TEST_ASSERT_EQUAL(0, cacheDns.pointCourant());
+    cacheDns.debutConnexion(t);
+    cacheDns.connexionReussie(t + 800);
+    t += 60000;
+    cacheDns.entretenir(t); // b jamais mesuré : essayé
+    TEST_ASSERT_EQUAL(1, cacheDns.pointCourant());
+    TEST_ASSERT_EQUAL_STRING("10.0.0.2", cacheDns.adresse().c_str());
+    cacheDns.debutConnexion(t);
+    cacheDns.connexionReussie(t + 300);
+    t += 60000;
+    cacheDns.entretenir(t);
+    TEST_ASSERT_EQUAL(1, cacheDns.pointCourant());
+    TEST_ASSERT_EQUAL(2, cacheDns.point(1).port);
+    TEST_ASSERT_EQUAL_UINT32(2, nbResolutionsLocales);
+
+    cacheDns.connexionEchouee(t);
+    TEST_ASSERT_EQUAL(1, cacheDns.pointCourant()); // un échec : nouvelle résolution du même point
+    cacheDns.entretenir(t);
+    TEST_ASSERT_EQUAL_UINT32(3, nbResolutionsLocales);
+    cacheDns.connexionEchouee(t + 8000);
+    TEST_ASSERT_EQUAL(0, cacheDns.pointCourant());
+    TEST_ASSERT_EQUAL_UINT32(1, cacheDns.stats.nbBasculements);
+    TEST_ASSERT_EQUAL_STRING("10.0.0.1", cacheDns.adresse().c_str());
+
+    cacheDns.entretenir(t + 60000);
+    TEST_ASSERT_EQUAL(0, cacheDns.pointCourant());
+    cacheDns.entretenir(t + 8000 + cacheDns.config.retourS * 1000UL);
+    TEST_ASSERT_EQUAL(1, cacheDns.pointCourant());
+    TEST_ASSERT_EQUAL_UINT32(800, cacheDns.point(0).latenceMoyenneMs);
+    TEST_ASSERT_EQUAL_UINT32(300, cacheDns.point(1).latenceMoyenneMs);
+}
+
+// STEP_OPEN_CONNEXION et le multiplexeur ouvrent vers l'adresse en cache ; un refus l'efface
+void test_dns_ouverture_connexion()
+{
+    simulateur.repondre("AT+CDNSGIP", REPONSE_CDNSGIP);
+    cacheDns.entretenir(millis());
+
+    taskCBOR_OPEN_CONNEXION.state = IDLE;
+    taskCBOR_OPEN_CONNEXION.isFinished = false;
+    currentStepCBOR = STEP_OPEN_CONNEXION;
+    PERIODE_CBOR = millis();
+    delay(200);
+    STEP_OPEN_CONNEXION_FUNCTION();
+    TEST_ASSERT_EQUAL_STRING("AT+CAOPEN=0,0,\"TCP\"," IP_SERVEUR ",41533", taskCBOR_OPEN_CONNEXION.command.c_str());
+    taskCBOR_OPEN_CONNEXION.state = IDLE;
+
+    simulateur.repondre("AT+CAOPEN=1", "\r\n+CAOPEN: 1,3\r\n\r\nOK\r\n", 1);
+    TEST_ASSERT_FALSE(multiplexeurSockets.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_EQUAL_UINT32(1, cacheDns.stats.nbEchecsConnexion);
+    TEST_ASSERT_EQUAL_STRING(PINGGY_LINK, cacheDns.adresse().c_str());
+
+    cacheDns.entretenir(millis());
+    simulateur.repondre("AT+CAOPEN=1", "\r\n+CAOPEN: 1,0\r\n\r\nOK\r\n");
+    TEST_ASSERT_TRUE(multiplexeurSockets.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_EQUAL(2, simulateur.compter("AT+CDNSGIP"));
+    TEST_ASSERT_EQUAL_UINT32(1, cacheDns.stats.nbConnexions);
+    TEST_ASSERT_TRUE(cacheDns.stats.latenceMaxMs > 0);
+}
+
+// Banc d'essai : résolutions, échecs et temps d'ouverture avec le cache et au nom d'hôte
+void test_dns_benchmark_par_nom()
+{
+    ScenarioDns scenario;
+    ConfigDns config;
+    char message[200];
+
+    RapportDns avant = simulerDns(scenario, config, true);
+    RapportDns apres = simulerDns(scenario, config, false);
+    snprintf(message, sizeof(message),
+             "par nom : %lu resolutions, %lu echecs, ouverture %lu ms (max %lu) / cache : %lu resolutions, %lu echecs, %lu basculements, ouverture %lu ms (max %lu)",
+             (unsigned long)avant.nbResolutions, (unsigned long)avant.nbEchecs, (unsigned long)avant.latenceMoyenneMs,
+             (unsigned long)avant.latenceMaxMs, (unsigned long)apres.nbResolutions, (unsigned long)apres.nbEchecs,
+             (unsigned long)apres.nbBasculements, (unsigned long)apres.latenceMoyenneMs, (unsigned long)apres.latenceMaxMs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(apres.nbResolutions * 10 < avant.nbResolutions);
+    TEST_ASSERT_TRUE(apres.latenceMoyenneMs * 3 < avant.latenceMoyenneMs * 2);
+    TEST_ASSERT_TRUE(apres.nbEchecs * 4 < avant.nbEchecs);
+    TEST_ASSERT_TRUE(apres.nbBasculements >= 1);
+}
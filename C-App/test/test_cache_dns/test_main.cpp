@@ -0,0 +1,28 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_dns_resolution_unique();
+void test_dns_expiration();
+void test_dns_echec_resolution();
+void test_dns_persistance();
+void test_dns_bascule_latence();
+void test_dns_ouverture_connexion();
+void test_dns_benchmark_par_nom();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_dns_resolution_unique);
+    RUN_TEST(test_dns_expiration);
+    RUN_TEST(test_dns_echec_resolution);
+    RUN_TEST(test_dns_persistance);
+    RUN_TEST(test_dns_bascule_latence);
+    RUN_TEST(test_dns_ouverture_connexion);
+    RUN_TEST(test_dns_benchmark_par_nom);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,193 @@
+#include <unity.h>
+#include "CACHE_FIX.hpp"
+#include "FLUX_GNSS.hpp"
+#include "PARSER_TIMESTAMP.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+static const char *CGNSINF_1530 = "\r\n+CGNSINF: 1,1,20250612101530.000,50.634412,3.048687,35.2,0.00,0.0,1,,1.2,1.5,0.9,,8,6,,,42,,\r\n\r\nOK\r\n";
+static const char *CGNSINF_1531 = "\r\n+CGNSINF: 1,1,20250612101531.000,50.634412,3.048687,35.2,0.00,0.0,1,,1.2,1.5,0.9,,8,6,,,42,,\r\n\r\nOK\r\n";
+static const char *URC_1530 = "\r\n+UGNSINF: 1,1,20250612101530.000,50.634412,3.048687,35.2,0.00,0.0,1,,1.2,1.5,0.9,,8,6,,,42,,\r\n";
+static const char *URC_1531 = "\r\n+UGNSINF: 1,1,20250612101531.000,50.634412,3.048687,35.2,0.00,0.0,1,,1.2,1.5,0.9,,8,6,,,42,,\r\n";
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    cacheFix.reinitialiser();
+    cacheFix.config = ConfigCacheFix();
+    acceptationFix.reinitialiser();
+    parseurFluxGnss.reinitialiser();
+    fluxGnss = FluxGnss();
+    nbCoordonnees = 0;
+    gnssStepState = GNSS_INFO;
+    // Débit brut : l'échantillonnage adaptatif est couvert par test_echantillonnage
+    echantillonneur.reinitialiser();
+    echantillonneur.config.actif = false;
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+}
+
+// Récepteur à 1 Hz qui perd son fix 8 s sur 10 (canyon urbain) : il répète alors son dernier fix
+static String reponseRecepteur(unsigned long maintenant)
+{
+    uint32_t s = maintenant / 1000;
+    if (s % 10 >= 2)
+        s = s - s % 10 + 1;
+    return "\r\n+CGNSINF: 1,1," + secondesVersHorodatage(803038530UL + s) +
+           ",50.634412,3.048687,35.2,0.00,0.0,1,,1.2,1.5,0.9,,8,6,,,42,,\r\n\r\nOK\r\n";
+}
+
+static int doublonsStockes()
+{
+    int doublons = 0;
+    for (int i = 1; i < nbCoordonnees; ++i)
+        if (dataGNSS[i].gnss.timeStamp == dataGNSS[i - 1].gnss.timeStamp)
+            doublons++;
+    return doublons;
+}
+
+void test_cache_fix_horodatage_cgnsinf()
+{
+    char horodatage[20];
+    TEST_ASSERT_TRUE(horodatageCGNSINF(CGNSINF_1530, horodatage, sizeof(horodatage)));
+    TEST_ASSERT_EQUAL_STRING("20250612101530.000", horodatage);
+
+    // Sans fix : run,fix présents mais horodatage vide
+    TEST_ASSERT_FALSE(horodatageCGNSINF("\r\n+CGNSINF: 1,0,,,,,,\r\n\r\nOK\r\n", horodatage, sizeof(horodatage)));
+    TEST_ASSERT_EQUAL_STRING("", horodatage);
+    TEST_ASSERT_FALSE(horodatageCGNSINF("\r\n+CGNSINF: 0\r\n\r\nOK\r\n", horodatage, sizeof(horodatage)));
+    TEST_ASSERT_FALSE(horodatageCGNSINF("\r\nERROR\r\n", horodatage, sizeof(horodatage)));
+
+    // Tampon trop court : tronqué sans débordement
+    char court[8];
+    TEST_ASSERT_TRUE(horodatageCGNSINF(CGNSINF_1530, court, sizeof(court)));
+    TEST_ASSERT_EQUAL_STRING("2025061", court);
+}
+
+void test_cache_fix_lecture_par_epoque()
+{
+    simulateur.repondre("AT+CGNSINF", CGNSINF_1530);
+
+    TEST_ASSERT_TRUE(cacheFix.lire(millis()).indexOf("20250612101530.000") >= 0);
+    TEST_ASSERT_EQUAL_STRING("20250612101530.000", cacheFix.epoque());
+    TEST_ASSERT_TRUE(cacheFix.lire(millis()).indexOf("20250612101530.000") >= 0);
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CGNSINF"));
+    TEST_ASSERT_EQUAL(1, cacheFix.stats.nbRequetesEvitees);
+
+    // Une époque plus tard, le modem est de nouveau interrogé
+    simulateur.repondre("AT+CGNSINF", CGNSINF_1531);
+    delay(1000);
+    TEST_ASSERT_TRUE(cacheFix.lire(millis()).indexOf("20250612101531.000") >= 0);
+    TEST_ASSERT_EQUAL(2, simulateur.compter("AT+CGNSINF"));
+
+    // Nouvelle fenêtre GNSS : rien n'est resservi
+    cacheFix.invalider();
+    cacheFix.lire(millis());
+    TEST_ASSERT_EQUAL(3, simulateur.compter("AT+CGNSINF"));
+
+    // Comportement historique
+    cacheFix.config.actif = false;
+    cacheFix.lire(millis());
+    cacheFix.lire(millis());
+    TEST_ASSERT_EQUAL(5, simulateur.compter("AT+CGNSINF"));
+    TEST_ASSERT_EQUAL(5, cacheFix.stats.nbRequetes);
+    TEST_ASSERT_EQUAL(1, cacheFix.stats.nbRequetesEvitees);
+}
+
+// Sondage : le même fix relu après 3 s (le récepteur n'a rien calculé de neuf) n'est pas retenu deux fois
+void test_cache_fix_doublon_sondage()
+{
+    simulateur.repondre("AT+CGNSINF", CGNSINF_1530);
+    TEST_ASSERT_TRUE(getGNSSValid().isValid);
+
+    cacheFix.invalider();
+    TEST_ASSERT_FALSE(getGNSSValid().isValid);
+    TEST_ASSERT_EQUAL(1, cacheFix.stats.nbDoublons);
+
+    simulateur.repondre("AT+CGNSINF", CGNSINF_1531);
+    cacheFix.invalider();
+    Gnss gnss = getGNSSValid();
+    TEST_ASSERT_TRUE(gnss.isValid);
+    TEST_ASSERT_EQUAL_STRING("20250612101531.000", gnss.timeStamp.c_str());
+    TEST_ASSERT_EQUAL(2, cacheFix.stats.nbEpoques);
+    TEST_ASSERT_EQUAL(1, cacheFix.stats.nbDoublons);
+}
+
+// Flux : une URC répétée (même époque) est écartée avant le tampon
+void test_cache_fix_doublon_flux()
+{
+    step_gnss_function(); // AT+CGNSURC=1
+    traiterFluxGnss(URC_1530, strlen(URC_1530), 1000);
+    step_gnss_function();
+    traiterFluxGnss(URC_1530, strlen(URC_1530), 2000);
+    step_gnss_function();
+    TEST_ASSERT_EQUAL(1, nbCoordonnees);
+    TEST_ASSERT_EQUAL(1, cacheFix.stats.nbDoublons);
+
+    traiterFluxGnss(URC_1531, strlen(URC_1531), 3000);
+    step_gnss_function();
+    TEST_ASSERT_EQUAL(2, nbCoordonnees);
+    TEST_ASSERT_EQUAL(0, doublonsStockes());
+}
+
+// Collecte de MAX_COORDS fixes en sondage (tick toutes les 500 ms), avec et sans cache
+static void collecterSondage()
+{
+    nbCoordonnees = 0;
+    gnssStepState = GNSS_INFO;
+    fluxGnss = FluxGnss();
+    fluxGnss.mode = GNSS_MODE_SONDAGE;
+    simulateur.reinitialiser();
+    simulateur.repondre("AT+CGNSPWR?", "\r\n+CGNSPWR: 1\r\n\r\nOK\r\n");
+    periodGNSS = millis();
+    debutInfoGnss(millis());
+    cacheFix.invalider();
+    while (gnssStepState == GNSS_INFO)
+    {
+        simulateur.repondre("AT+CGNSINF", reponseRecepteur(millis()), 2);
+        step_gnss_function();
+        delay(500);
+    }
+}
+
+void test_cache_fix_benchmark_sondage()
+{
+    cacheFix.config.actif = false;
+    collecterSondage();
+    int requetesAvant = simulateur.compter("AT+CGNSINF");
+    int transactionsAvant = fluxGnss.statsSondage.transactions;
+    int doublonsAvant = doublonsStockes();
+    int distinctsAvant = nbCoordonnees - doublonsAvant;
+
+    cacheFix.reinitialiser();
+    cacheFix.config.actif = true;
+    collecterSondage();
+    int requetesApres = simulateur.compter("AT+CGNSINF");
+    int transactionsApres = fluxGnss.statsSondage.transactions;
+    int doublonsApres = doublonsStockes();
+
+    TEST_MESSAGE(("Sans cache : " + String(requetesAvant) + " AT+CGNSINF, " + String(transactionsAvant) +
+                  " transactions, " + String(doublonsAvant) + " doublons stockes, " +
+                  String((float)requetesAvant / distinctsAvant, 1) + " AT+CGNSINF par fix distinct")
+                     .c_str());
+    TEST_MESSAGE(("Avec cache : " + String(requetesApres) + " AT+CGNSINF, " + String(transactionsApres) +
+                  " transactions, " + String(doublonsApres) + " doublons stockes, " +
+                  String(cacheFix.stats.nbDoublons) + " ecartes, " +
+                  String((float)requetesApres / nbCoordonnees, 1) + " AT+CGNSINF par fix distinct")
+                     .c_str());
+
+    TEST_ASSERT_EQUAL(MAX_COORDS, nbCoordonnees);
+    TEST_ASSERT_TRUE(doublonsAvant > 0);
+    TEST_ASSERT_EQUAL(0, doublonsApres);
+    TEST_ASSERT_TRUE(cacheFix.stats.nbDoublons > 0);
+    TEST_ASSERT_TRUE((float)requetesApres / nbCoordonnees < (float)requetesAvant / distinctsAvant);
+    // Chaque sondage relisait AT+CGNSINF : la relecture est servie depuis la mémoire
+    TEST_ASSERT_EQUAL(cacheFix.stats.nbEpoques + cacheFix.stats.nbDoublons, cacheFix.stats.nbRequetesEvitees);
+    TEST_ASSERT_EQUAL(cacheFix.stats.nbRequetes, requetesApres);
+}
@@ -0,0 +1,24 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_cache_fix_horodatage_cgnsinf();
+void test_cache_fix_lecture_par_epoque();
+void test_cache_fix_doublon_sondage();
+void test_cache_fix_doublon_flux();
+void test_cache_fix_benchmark_sondage();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_cache_fix_horodatage_cgnsinf);
+    RUN_TEST(test_cache_fix_lecture_par_epoque);
+    RUN_TEST(test_cache_fix_doublon_sondage);
+    RUN_TEST(test_cache_fix_doublon_flux);
+    RUN_TEST(test_cache_fix_benchmark_sondage);
+    UNITY_END();
+}
+
+void loop() {}
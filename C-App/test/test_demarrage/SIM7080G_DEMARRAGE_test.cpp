@@ -0,0 +1,138 @@
+#include <unity.h>
+#include "SIM7080G_DEMARRAGE.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+static const char *REPONSE_CCID = "\r\n89882280666012345678\r\n\r\nOK\r\n";
+static const char *REPONSE_CNACT_ACTIF = "\r\n+CNACT: 0,1,\"10.52.3.4\"\r\n+CNACT: 1,0,\"0.0.0.0\"\r\n\r\nOK\r\n";
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    effacerCacheDemarrage();
+    imei = "";
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+}
+
+// Cache d'un démarrage précédent : identité connue et profil réseau déjà appliqué
+static void preparerCache()
+{
+    CacheDemarrage cache;
+    memset(&cache, 0, sizeof(cache));
+    strcpy(cache.imei, "869951030012345");
+    strcpy(cache.ccid, "89882280666012345678");
+    strcpy(cache.apn, APN_RESEAU);
+    cache.configReseau = true;
+    ecrireCacheDemarrage(cache);
+}
+
+void test_demarrage_parse_reponses()
+{
+    TEST_ASSERT_EQUAL_STRING("10.52.3.4", parseIpCNACT(REPONSE_CNACT_ACTIF).c_str());
+    TEST_ASSERT_EQUAL_STRING("", parseIpCNACT("\r\n+CNACT: 0,0,\"0.0.0.0\"\r\n\r\nOK\r\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("89882280666012345678", parseCCID("\r\n89882280666012345678\r\n\r\nOK\r\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("", parseCCID("\r\nERROR\r\n").c_str());
+}
+
+// Modem déjà enregistré avec un contexte PDP actif : ni redémarrage, ni lecture de l'IMEI, ni reconfiguration
+void test_demarrage_modem_pret_sans_redemarrage()
+{
+    preparerCache();
+    simulateur.repondre("AT+CFUN?", "\r\n+CFUN: 1\r\n\r\nOK\r\n");
+    simulateur.repondre("AT+CNACT?", REPONSE_CNACT_ACTIF);
+    simulateur.repondre("AT+CCID", REPONSE_CCID);
+
+    demarrerModem();
+
+    TEST_ASSERT_FALSE(tempsDemarrage.redemarrage);
+    TEST_ASSERT_TRUE(tempsDemarrage.identiteEnCache);
+    TEST_ASSERT_FALSE(tempsDemarrage.simChangee);
+    TEST_ASSERT_TRUE(tempsDemarrage.reseauPret);
+    TEST_ASSERT_EQUAL_STRING("869951030012345", imei.c_str());
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+GSN"));
+    TEST_ASSERT_EQUAL(4, (int)simulateur.commandes.size()); // AT, CFUN?, CNACT?, CCID
+
+    // La configuration réseau est sautée : CATM1 passe directement à l'envoi
+    currentStep4G = STEP_SETUP_CATM1;
+    step_catm1_function();
+    TEST_ASSERT_EQUAL(STEP_SEND_CBOR, currentStep4G);
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CNMP"));
+
+    TEST_MESSAGE(("Sonde : " + String(tempsDemarrage.sondeMs) + " ms, setup : " + String(tempsDemarrage.totalMs) + " ms").c_str());
+}
+
+// Radio active mais contexte PDP tombé : on se réattache sans refaire le profil
+void test_demarrage_pdp_tombe_reattache()
+{
+    preparerCache();
+    simulateur.repondre("AT+CFUN?", "\r\n+CFUN: 1\r\n\r\nOK\r\n");
+    simulateur.repondre("AT+CNACT?", "\r\n+CNACT: 0,0,\"0.0.0.0\"\r\n\r\nOK\r\n");
+    simulateur.repondre("AT+CCID", REPONSE_CCID);
+
+    demarrerModem();
+
+    TEST_ASSERT_FALSE(tempsDemarrage.redemarrage);
+    TEST_ASSERT_TRUE(tempsDemarrage.configConnue);
+    TEST_ASSERT_FALSE(tempsDemarrage.reseauPret);
+}
+
+// SIM remplacée depuis la mise en cache : le profil réseau de l'ancienne carte n'est pas réutilisé
+void test_demarrage_sim_changee()
+{
+    preparerCache();
+    simulateur.repondre("AT+CFUN?", "\r\n+CFUN: 1\r\n\r\nOK\r\n");
+    simulateur.repondre("AT+CNACT?", REPONSE_CNACT_ACTIF);
+    simulateur.repondre("AT+CCID", "\r\n89882280666000000002\r\n\r\nOK\r\n");
+
+    demarrerModem();
+
+    TEST_ASSERT_TRUE(tempsDemarrage.identiteEnCache);
+    TEST_ASSERT_TRUE(tempsDemarrage.simChangee);
+    TEST_ASSERT_FALSE(tempsDemarrage.configConnue);
+    TEST_ASSERT_FALSE(tempsDemarrage.reseauPret);
+    CacheDemarrage cache;
+    TEST_ASSERT_TRUE(lireCacheDemarrage(cache));
+    TEST_ASSERT_EQUAL_STRING("89882280666000000002", cache.ccid);
+    TEST_ASSERT_FALSE(cache.configReseau);
+
+    // Profil refait par step_catm1_function(), puis démarrage suivant avec la même carte : chemin rapide
+    memoriserConfigReseau();
+    simulateur.commandes.clear();
+    demarrerModem();
+    TEST_ASSERT_FALSE(tempsDemarrage.simChangee);
+    TEST_ASSERT_TRUE(tempsDemarrage.reseauPret);
+}
+
+// Modem muet : redémarrage, puis identité lue sur le modem et mise en cache
+void test_demarrage_modem_muet_redemarre()
+{
+    simulateur.repondre("AT", "");
+    simulateur.repondre("AT+GSN", "\r\n869951030099999\r\n\r\nOK\r\n");
+    simulateur.repondre("AT+CCID", "\r\n89882280666000000001\r\n\r\nOK\r\n");
+
+    demarrerModem();
+
+    TEST_ASSERT_TRUE(tempsDemarrage.redemarrage);
+    TEST_ASSERT_FALSE(tempsDemarrage.identiteEnCache);
+    TEST_ASSERT_FALSE(tempsDemarrage.configConnue);
+    TEST_ASSERT_EQUAL_STRING("869951030099999", imei.c_str());
+
+    CacheDemarrage cache;
+    TEST_ASSERT_TRUE(lireCacheDemarrage(cache));
+    TEST_ASSERT_EQUAL_STRING("869951030099999", cache.imei);
+    TEST_ASSERT_EQUAL_STRING("89882280666000000001", cache.ccid);
+    TEST_ASSERT_FALSE(cache.configReseau);
+
+    // Le profil réseau est mémorisé une fois step_catm1_function() terminée
+    memoriserConfigReseau();
+    TEST_ASSERT_TRUE(lireCacheDemarrage(cache));
+    TEST_ASSERT_TRUE(cache.configReseau);
+    TEST_ASSERT_EQUAL_STRING(APN_RESEAU, cache.apn);
+}
@@ -0,0 +1,24 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_demarrage_parse_reponses();
+void test_demarrage_modem_pret_sans_redemarrage();
+void test_demarrage_pdp_tombe_reattache();
+void test_demarrage_sim_changee();
+void test_demarrage_modem_muet_redemarre();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_demarrage_parse_reponses);
+    RUN_TEST(test_demarrage_modem_pret_sans_redemarrage);
+    RUN_TEST(test_demarrage_pdp_tombe_reattache);
+    RUN_TEST(test_demarrage_sim_changee);
+    RUN_TEST(test_demarrage_modem_muet_redemarre);
+    UNITY_END();
+}
+
+void loop() {}
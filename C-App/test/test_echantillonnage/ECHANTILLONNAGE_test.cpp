@@ -0,0 +1,134 @@
+#include <unity.h>
+#include "ECHANTILLONNAGE.hpp"
+
+#define LAT_BASE 50634412
+#define LON_BASE 3048687
+
+void setUp(void)
+{
+    echantillonneur.reinitialiser();
+    echantillonneur.config = ConfigEchantillonnage();
+}
+
+void tearDown(void) {}
+
+static Echantillon echantillon(int32_t lat, int32_t lon, int16_t vitesse, int16_t cap, unsigned long t)
+{
+    Echantillon e;
+    e.latE6 = lat;
+    e.lonE6 = lon;
+    e.vitesseDixiemes = vitesse;
+    e.capDegres = cap;
+    e.hdopDixiemes = 9;
+    e.tMs = t;
+    return e;
+}
+
+// Trace d'une heure : garé 20 min, 20 min de route à 36 km/h (virage toutes les 2 min), garé 20 min
+static Echantillon trace(unsigned long t)
+{
+    const unsigned long debutRoute = 1200000UL, finRoute = 2400000UL;
+    unsigned long s = ((t < debutRoute ? debutRoute : (t > finRoute ? finRoute : t)) - debutRoute) / 1000;
+    // 10 m/s : 90 µdeg/s vers le nord, 141 µdeg/s vers l'est à cette latitude
+    unsigned long segments = s / 120, reste = s % 120;
+    int32_t lat = LAT_BASE + (int32_t)((segments + 1) / 2 * 120 * 90);
+    int32_t lon = LON_BASE + (int32_t)(segments / 2 * 120 * 141);
+    bool versNord = (segments % 2) == 0;
+    if (versNord)
+        lat += (int32_t)(reste * 90);
+    else
+        lon += (int32_t)(reste * 141);
+
+    bool roule = t >= debutRoute && t < finRoute;
+    // bruit déterministe de +/- 1 m
+    int32_t bruit = (int32_t)((t / 1000 * 7919) % 19) - 9;
+    return echantillon(lat + bruit, lon - bruit, roule ? 360 : 3, roule ? (versNord ? 0 : 90) : -1, t);
+}
+
+void test_geodesie_distance()
+{
+    TEST_ASSERT_EQUAL_INT32(50634412, degresVersE6("50.634412"));
+    TEST_ASSERT_EQUAL_INT32(-3500000, degresVersE6("-3.5"));
+    TEST_ASSERT_EQUAL_INT32(COORD_INVALIDE, degresVersE6(""));
+    // 0.001° de latitude = 111 m ; 0.001° de longitude à 50.6° = 70.6 m
+    TEST_ASSERT_UINT32_WITHIN(1, 111, distanceM(LAT_BASE, LON_BASE, LAT_BASE + 1000, LON_BASE));
+    TEST_ASSERT_UINT32_WITHIN(1, 71, distanceM(LAT_BASE, LON_BASE, LAT_BASE, LON_BASE + 1000));
+    TEST_ASSERT_EQUAL_INT(20, ecartCapDegres(350, 10));
+}
+
+void test_echantillonnage_hysteresis_arret_depart()
+{
+    unsigned long t = 0;
+    for (; t <= 20000; t += 1000)
+        echantillonneur.evaluer(echantillon(LAT_BASE, LON_BASE, 5, -1, t));
+    TEST_ASSERT_EQUAL(MOUVEMENT_ARRET, echantillonneur.etat());
+
+    // 4 km/h : entre les deux seuils, l'objet reste à l'arrêt
+    echantillonneur.evaluer(echantillon(LAT_BASE, LON_BASE, 40, -1, t += 1000));
+    TEST_ASSERT_EQUAL(MOUVEMENT_ARRET, echantillonneur.etat());
+    // HDOP dégradé : un échantillon rapide mais peu fiable ne compte pas
+    Echantillon douteux = echantillon(LAT_BASE, LON_BASE, 80, -1, t += 1000);
+    douteux.hdopDixiemes = 90;
+    echantillonneur.evaluer(douteux);
+    echantillonneur.evaluer(douteux);
+    TEST_ASSERT_EQUAL(MOUVEMENT_ARRET, echantillonneur.etat());
+
+    // Deux échantillons au-dessus de 6 km/h : départ
+    echantillonneur.evaluer(echantillon(LAT_BASE, LON_BASE, 80, 0, t += 1000));
+    TEST_ASSERT_EQUAL(MOUVEMENT_ARRET, echantillonneur.etat());
+    TEST_ASSERT_EQUAL(ECHANTILLON_GARDE, echantillonneur.evaluer(echantillon(LAT_BASE + 20, LON_BASE, 80, 0, t += 1000)));
+    TEST_ASSERT_EQUAL(MOUVEMENT_DEPLACEMENT, echantillonneur.etat());
+
+    // 4 km/h en déplacement : au-dessus du seuil d'arrêt, l'objet reste en déplacement
+    echantillonneur.evaluer(echantillon(LAT_BASE + 30, LON_BASE, 40, 0, t += 1000));
+    TEST_ASSERT_EQUAL(MOUVEMENT_DEPLACEMENT, echantillonneur.etat());
+    TEST_ASSERT_EQUAL_UINT32(1, echantillonneur.stats.nbArrets);
+    TEST_ASSERT_EQUAL_UINT32(1, echantillonneur.stats.nbDeparts);
+}
+
+void test_echantillonnage_heartbeat_unique_et_intervalle()
+{
+    unsigned long t = 0;
+    for (; t <= 20000; t += 1000)
+        echantillonneur.evaluer(echantillon(LAT_BASE, LON_BASE, 0, -1, t));
+    TEST_ASSERT_TRUE(echantillonneur.acquisitionTerminee());
+
+    // Cycle suivant à l'arrêt : un seul point "toujours là", puis plus rien
+    echantillonneur.debutCycle();
+    TEST_ASSERT_FALSE(echantillonneur.acquisitionTerminee());
+    TEST_ASSERT_EQUAL(ECHANTILLON_HEARTBEAT, echantillonneur.evaluer(echantillon(LAT_BASE + 5, LON_BASE, 2, -1, t += 60000)));
+    TEST_ASSERT_EQUAL(ECHANTILLON_IGNORE, echantillonneur.evaluer(echantillon(LAT_BASE - 5, LON_BASE, 2, -1, t += 1000)));
+    TEST_ASSERT_TRUE(echantillonneur.acquisitionTerminee());
+    TEST_ASSERT_EQUAL_UINT32(echantillonneur.config.intervalleMaxMs, echantillonneur.intervalleMs());
+
+    // En déplacement, l'intervalle vise distanceCibleM : 72 km/h -> 40 m toutes les 2 s
+    echantillonneur.reinitialiser();
+    echantillonneur.evaluer(echantillon(LAT_BASE, LON_BASE, 720, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(2000, echantillonneur.intervalleMs());
+    echantillonneur.evaluer(echantillon(LAT_BASE + 180, LON_BASE, 1800, 0, 1000));
+    TEST_ASSERT_EQUAL_UINT32(echantillonneur.config.intervalleMinMs, echantillonneur.intervalleMs());
+    // Un virage est gardé sans attendre l'intervalle
+    TEST_ASSERT_EQUAL(ECHANTILLON_GARDE, echantillonneur.evaluer(echantillon(LAT_BASE + 180, LON_BASE + 5, 700, 90, 1500)));
+}
+
+void test_echantillonnage_simulation_trace()
+{
+    ScenarioTrace scenario;
+    RapportEchantillonnage rapport = simulerEchantillonnage(trace, scenario, ConfigEchantillonnage());
+    afficherRapportEchantillonnage(rapport);
+
+    TEST_ASSERT_EQUAL_UINT32(600, rapport.fixesReference);
+    // Deux tiers du temps à l'arrêt : un point par cycle au lieu de dix
+    TEST_ASSERT_LESS_THAN_UINT32(rapport.fixesReference / 2, rapport.fixesAdaptatif);
+    TEST_ASSERT_GREATER_THAN_UINT32(250 * scenario.octetsParPoint, rapport.octetsEconomises);
+    TEST_ASSERT_LESS_THAN_UINT32(rapport.gnssReferenceMs / 2, rapport.gnssAdaptatifMs);
+    // Trajectoire envoyée fidèle à la référence
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(30, rapport.erreurMaxM);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(5, rapport.erreurMoyenneM);
+
+    // Sans échantillonnage adaptatif, le résultat est celui de la référence (au TTFF près)
+    ConfigEchantillonnage inactif;
+    inactif.actif = false;
+    rapport = simulerEchantillonnage(trace, scenario, inactif);
+    TEST_ASSERT_EQUAL_UINT32(600, rapport.fixesAdaptatif);
+}
@@ -0,0 +1,22 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_geodesie_distance();
+void test_echantillonnage_hysteresis_arret_depart();
+void test_echantillonnage_heartbeat_unique_et_intervalle();
+void test_echantillonnage_simulation_trace();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_geodesie_distance);
+    RUN_TEST(test_echantillonnage_hysteresis_arret_depart);
+    RUN_TEST(test_echantillonnage_heartbeat_unique_et_intervalle);
+    RUN_TEST(test_echantillonnage_simulation_trace);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,225 @@
+#include <unity.h>
+#include "ECOUTE_DESCENDANTE.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+// {"periode": 10} en CBOR : le dernier octet (0x0A) est un '\n'
+static const uint8_t CBOR_PERIODE[] = {0xA1, 0x67, 'p', 'e', 'r', 'i', 'o', 'd', 'e', 0x0A};
+
+static String reponseCARECV(const uint8_t *octets, size_t n)
+{
+    String reponse = "\r\n+CARECV: " + String((unsigned long)n) + ",";
+    for (size_t i = 0; i < n; ++i)
+        reponse += (char)octets[i];
+    return reponse + "\r\n\r\nOK\r\n";
+}
+
+static void urc(const char *texte, unsigned long maintenant)
+{
+    ecouteDescendante.traiter(texte, strlen(texte), maintenant);
+}
+
+static unsigned long periodeInitiale;
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    ecouteDescendante.reinitialiser();
+    ecouteDescendante.config = ConfigEcoute();
+    ecouteDescendante.appliquer = nullptr;
+    sessionReseau.reinitialiser();
+    multiplexeurSockets.reinitialiser();
+    multiplexeurSockets.config = ConfigSockets();
+    gestionPSM.accorde = EtatPSMReseau();
+    periodeInitiale = periodeAjustement;
+}
+
+void tearDown(void)
+{
+    periodeAjustement = periodeInitiale;
+    simulateur.desinstaller();
+}
+
+void test_ecoute_urc()
+{
+    EcouteDescendante &e = ecouteDescendante;
+    e.ouvrir(1000);
+    TEST_ASSERT_TRUE(e.estOuverte());
+
+    TEST_ASSERT_EQUAL(CID_CONTROLE, e.socket());
+
+    // Annonce du socket de l'envoi ignorée, URC réseau transmise au suivi de session
+    urc("\r\n+CADATAIND: 0\r\n\r\n+CEREG: 5\r\n", 1100);
+    TEST_ASSERT_FALSE(e.donneesAnnoncees());
+    TEST_ASSERT_EQUAL(ENREG_ITINERANCE, sessionReseau.enregistrement());
+
+    // URC découpée entre deux lectures de l'UART
+    urc("\r\n+CADATA", 1200);
+    urc("IND: 1\r\n", 1210);
+    TEST_ASSERT_TRUE(e.donneesAnnoncees());
+    TEST_ASSERT_EQUAL_UINT32(1, e.stats.nbAnnonces);
+
+    // Fermeture par le serveur
+    urc("\r\n+CASTATE: 1,0\r\n", 1300);
+    TEST_ASSERT_FALSE(e.estOuverte());
+    TEST_ASSERT_FALSE(e.donneesAnnoncees());
+    TEST_ASSERT_EQUAL_UINT32(1, e.stats.nbFermeturesDistantes);
+}
+
+void test_ecoute_decodage_carecv()
+{
+    json message;
+    TEST_ASSERT_TRUE(decoderCARECV(reponseCARECV(CBOR_PERIODE, sizeof(CBOR_PERIODE)), message));
+    TEST_ASSERT_EQUAL(10, message["periode"].get<int>());
+
+    // La longueur annoncée délimite les données, même suivies d'autres octets
+    std::vector<uint8_t> octets;
+    TEST_ASSERT_TRUE(extraireCARECV(reponseCARECV(CBOR_PERIODE, sizeof(CBOR_PERIODE)), octets));
+    TEST_ASSERT_EQUAL(sizeof(CBOR_PERIODE), octets.size());
+
+    TEST_ASSERT_FALSE(decoderCARECV("\r\n+CARECV: 0\r\n\r\nOK\r\n", message));
+    TEST_ASSERT_FALSE(decoderCARECV("\r\nERROR\r\n", message));
+    const uint8_t tronque[] = {0xA1, 0x67, 'p', 'e'};
+    TEST_ASSERT_FALSE(decoderCARECV(reponseCARECV(tronque, sizeof(tronque)), message));
+}
+
+// Une annonce lue au réveil déclenche AT+CARECV et la commande est appliquée comme une réponse à un envoi
+void test_ecoute_commande_appliquee()
+{
+    EcouteDescendante &e = ecouteDescendante;
+    simulateur.repondre("AT+CARECV", reponseCARECV(CBOR_PERIODE, sizeof(CBOR_PERIODE)));
+
+    e.ouvrir(millis());
+    TEST_ASSERT_FALSE(e.servir(millis()));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CARECV"));
+
+    urc("\r\n+CADATAIND: 1\r\n", millis());
+    TEST_ASSERT_TRUE(e.servir(millis()));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CARECV=1,256"));
+    TEST_ASSERT_EQUAL(10, periodeAjustement);
+    TEST_ASSERT_EQUAL(10, lastReceivedCBOR["periode"].get<int>());
+    TEST_ASSERT_FALSE(e.donneesAnnoncees());
+    TEST_ASSERT_TRUE(e.estOuverte());
+    TEST_ASSERT_EQUAL_UINT32(1, e.stats.nbCommandes);
+    TEST_ASSERT_EQUAL_UINT32(1, e.stats.nbLectures);
+
+    // Lecture pleine : des données restent en attente, l'annonce est conservée
+    e.config.tailleLecture = sizeof(CBOR_PERIODE);
+    urc("\r\n+CADATAIND: 1\r\n", millis());
+    TEST_ASSERT_TRUE(e.servir(millis()));
+    TEST_ASSERT_TRUE(e.donneesAnnoncees());
+}
+
+// URC arrivée pendant le light sleep : ses premiers caractères sont perdus, le réveil par le modem suffit à relire
+void test_ecoute_urc_perdue_au_sommeil()
+{
+    EcouteDescendante &e = ecouteDescendante;
+    simulateur.repondre("AT+CARECV", reponseCARECV(CBOR_PERIODE, sizeof(CBOR_PERIODE)));
+    e.ouvrir(1000);
+
+    urc("DATAIND: 1\r\n", 2000); // "\r\n+CA" perdus
+    TEST_ASSERT_FALSE(e.donneesAnnoncees());
+    gestionPSM.reveilModem = true;
+    TEST_ASSERT_TRUE(e.servir(2000));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CARECV=1"));
+    TEST_ASSERT_EQUAL_UINT32(1, e.stats.nbLecturesSansAnnonce);
+    TEST_ASSERT_FALSE(gestionPSM.reveilModem);
+
+    // Réveil par le minuteur, sans annonce : pas de lecture avant lectureMaxMs
+    TEST_ASSERT_FALSE(e.servir(3000));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CARECV=1"));
+    e.servir(2000 + e.config.lectureMaxMs);
+    TEST_ASSERT_EQUAL(2, simulateur.compter("AT+CARECV=1"));
+    TEST_ASSERT_EQUAL_UINT32(2, e.stats.nbLecturesSansAnnonce);
+
+    chargerOptionsEcoute({{"lectureMaxMs", 0}});
+    e.servir(2000 + 10 * e.config.trancheMs + 1000000);
+    TEST_ASSERT_EQUAL(2, simulateur.compter("AT+CARECV=1"));
+}
+
+void test_ecoute_reveil_et_temps_actif()
+{
+    EcouteDescendante &e = ecouteDescendante;
+    TEST_ASSERT_EQUAL_UINT32(50000, e.reveil(1000, 50000));
+
+    // Sans PSM : tranches de trancheMs jusqu'à l'échéance du cycle
+    e.ouvrir(1000);
+    TEST_ASSERT_EQUAL_UINT32(2000, e.reveil(1000, 50000));
+    TEST_ASSERT_EQUAL_UINT32(50000, e.reveil(49500, 50000));
+
+    // Temps actif de 2,5 s : le dernier réveil tombe sur la fin de l'écoute, qui lit puis ferme le socket
+    e.ouvrir(1000, 2500);
+    TEST_ASSERT_EQUAL_UINT32(3500, e.reveil(3000, 50000));
+    TEST_ASSERT_FALSE(e.servir(3400));
+    TEST_ASSERT_TRUE(e.estOuverte());
+    e.servir(3500);
+    TEST_ASSERT_FALSE(e.estOuverte());
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CARECV"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CACLOSE=1"));
+    TEST_ASSERT_EQUAL_UINT32(50000, e.reveil(3500, 50000));
+}
+
+// Socket partagé : STEP_RECEIVE garde le socket de l'envoi, STEP_CLOSE_CONNEXION ne le ferme pas, STEP_OPEN_CONNEXION
+// le ferme (sockets séparés : test_multiplexeur_sockets)
+void test_ecoute_pipeline_socket_garde()
+{
+    multiplexeurSockets.config.actif = false;
+    multiplexeurSockets.marquer(CANAL_ENVOI, true); // ouvert par STEP_OPEN_CONNEXION
+    simulateur.repondre("AT+CARECV=0", "\r\n+CARECV: 25,Batch received and saved\n\r\n\r\nOK\r\n"); // envoi acquitté
+    gestionPSM.accorde.psmAccorde = true;
+    gestionPSM.accorde.actifS = 10;
+    stepReceiveFunctionBoolean = true;
+    currentStepCBOR = STEP_RECEIVE;
+    STEP_RECEIVE_FUNCTION();
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CAOPEN"));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CARECV"));
+    TEST_ASSERT_TRUE(ecouteDescendante.estOuverte());
+    unsigned long t = millis();
+    TEST_ASSERT_TRUE(ecouteDescendante.reveil(t, t + 60000) < t + 60000);
+
+    STEP_RECEIVE_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_CLOSE_CONNEXION, currentStepCBOR);
+    STEP_CLOSE_CONNEXION_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_END, currentStepCBOR);
+    TEST_ASSERT_TRUE(ecouteDescendante.estOuverte());
+
+    simulateur.commandes.clear();
+    currentStepCBOR = STEP_OPEN_CONNEXION;
+    STEP_OPEN_CONNEXION_FUNCTION();
+    TEST_ASSERT_FALSE(ecouteDescendante.estOuverte());
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CACLOSE=0"));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CARECV"));
+    currentStepCBOR = STEP_INIT_CBOR;
+}
+
+void test_ecoute_benchmark_latence()
+{
+    ScenarioDescendant scenario;
+    ConfigEcoute historique;
+    historique.actif = false;
+    ConfigEcoute ecoute;
+
+    RapportDescendant avant = simulerCommandes(scenario, historique);
+    RapportDescendant apres = simulerCommandes(scenario, ecoute);
+    char message[200];
+    snprintf(message, sizeof(message), "%lu commandes : historique %lu ms moyenne, %lu ms max / ecoute %lu ms moyenne, %lu ms max, "
+             "%lu pendant l'ecoute (%lu ms moyenne), %.0f reveils/h",
+             (unsigned long)avant.nbCommandes, (unsigned long)avant.latenceMoyenneMs, (unsigned long)avant.latenceMaxMs,
+             (unsigned long)apres.latenceMoyenneMs, (unsigned long)apres.latenceMaxMs, (unsigned long)apres.nbCommandesEcoute,
+             (unsigned long)apres.latenceEcouteMoyenneMs, apres.reveilsParHeure);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_EQUAL_UINT32(avant.nbCommandes, apres.nbCommandes);
+    TEST_ASSERT_EQUAL_UINT32(0, avant.nbCommandesEcoute);
+    TEST_ASSERT_TRUE(apres.nbCommandesEcoute > 0);
+    // Les commandes émises pendant la fenêtre radio (40 s sur 70) attendent toujours la lecture de l'envoi
+    TEST_ASSERT_TRUE(apres.latenceMoyenneMs * 3 < avant.latenceMoyenneMs * 2);
+    TEST_ASSERT_TRUE(apres.latenceMaxMs <= avant.latenceMaxMs);
+    // Pendant l'écoute : au plus un cycle eDRX, une tranche de sommeil et un aller-retour
+    TEST_ASSERT_TRUE(apres.latenceEcouteMoyenneMs <= scenario.cycleEdrxMs + ecoute.trancheMs + scenario.rttMs);
+    TEST_ASSERT_EQUAL_FLOAT(0, avant.reveilsParHeure);
+}
@@ -0,0 +1,28 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_ecoute_urc();
+void test_ecoute_decodage_carecv();
+void test_ecoute_commande_appliquee();
+void test_ecoute_urc_perdue_au_sommeil();
+void test_ecoute_reveil_et_temps_actif();
+void test_ecoute_pipeline_socket_garde();
+void test_ecoute_benchmark_latence();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ecoute_urc);
+    RUN_TEST(test_ecoute_decodage_carecv);
+    RUN_TEST(test_ecoute_commande_appliquee);
+    RUN_TEST(test_ecoute_urc_perdue_au_sommeil);
+    RUN_TEST(test_ecoute_reveil_et_temps_actif);
+    RUN_TEST(test_ecoute_pipeline_socket_garde);
+    RUN_TEST(test_ecoute_benchmark_latence);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,85 @@
+#include <unity.h>
+#include "ENERGIE.hpp"
+
+// Durées cumulées par état avec une horloge explicite
+void test_energie_durees_par_etat()
+{
+    ComptabiliteEnergie compta;
+    compta.reinitialiser(1000);
+    compta.setEtatGnss(GNSS_ALLUME, 1000);
+    compta.setEtatLte(LTE_IDLE, 1000);
+    compta.setEtatGnss(GNSS_ETEINT, 31000);
+    compta.setEtatLte(LTE_CONNECTE, 31000);
+    compta.setEtatLte(LTE_TX, 35000);
+    compta.setEtatLte(LTE_IDLE, 36000);
+    compta.setEtatCpu(CPU_IDLE, 40000);
+
+    TEST_ASSERT_EQUAL(30000, compta.tempsGnss(GNSS_ALLUME, 50000));
+    TEST_ASSERT_EQUAL(19000, compta.tempsGnss(GNSS_ETEINT, 50000));
+    TEST_ASSERT_EQUAL(4000, compta.tempsLte(LTE_CONNECTE, 50000));
+    TEST_ASSERT_EQUAL(1000, compta.tempsLte(LTE_TX, 50000));
+    TEST_ASSERT_EQUAL(30000 + 14000, compta.tempsLte(LTE_IDLE, 50000));
+    TEST_ASSERT_EQUAL(39000, compta.tempsCpu(CPU_ACTIF, 50000));
+    TEST_ASSERT_EQUAL(10000, compta.tempsCpu(CPU_IDLE, 50000));
+}
+
+// Conversion en charge : 1 h à 1000 µA = 1 mAh
+void test_energie_conversion_mAh()
+{
+    ProfilCourant profil;
+    for (int i = 0; i < NB_ETATS_CPU; ++i)
+        profil.cpu_uA[i] = 0;
+    for (int i = 0; i < NB_ETATS_LTE; ++i)
+        profil.lte_uA[i] = 0;
+    profil.gnss_uA[GNSS_ETEINT] = 0;
+    profil.gnss_uA[GNSS_ALLUME] = 1000;
+
+    ComptabiliteEnergie compta;
+    compta.reinitialiser(0);
+    compta.setEtatGnss(GNSS_ALLUME, 0);
+    compta.enregistrerFix();
+    compta.enregistrerFix();
+    RapportEnergie r = compta.rapport(3600000UL, profil);
+
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0, r.mAhTotal);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.5, r.mAhParFix);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 24.0, r.mAhParJour);
+}
+
+void test_energie_parse_cbc()
+{
+    TEST_ASSERT_EQUAL(3999, parseBatteryVoltage("AT+CBC\r\n+CBC: 0,85,3999\r\n\r\nOK"));
+    TEST_ASSERT_EQUAL(-1, parseBatteryVoltage("ERROR"));
+}
+
+// Simulation 24 h du pipeline actuel : nombre de cycles et de fix cohérents avec la durée d'un cycle
+void test_energie_simulation_24h_pipeline_actuel()
+{
+    ScenarioCycle scenario;
+    RapportEnergie r = simulerEnergie(scenario, profilCourant);
+
+    unsigned long dureeCycle = scenario.ttffMs + (scenario.nbFixParCycle - 1) * scenario.intervalleFixMs +
+                               scenario.lteConnexionMs + scenario.lteTxMs + scenario.lteReceptionMs + scenario.periodeMs;
+    TEST_ASSERT_EQUAL(86400000UL, r.dureeMs);
+    TEST_ASSERT_INT_WITHIN(1, 86400000UL / dureeCycle, r.nbCycles);
+    TEST_ASSERT_TRUE(r.nbFix >= r.nbCycles * scenario.nbFixParCycle);
+    TEST_ASSERT_TRUE(r.mAhParJour > 0);
+    TEST_ASSERT_TRUE(r.mAhParFix > 0);
+    afficherRapportEnergie(r);
+}
+
+// Un ordonnancement qui met le modem en PSM et l'ESP32 en sommeil entre les cycles doit consommer moins
+void test_energie_simulation_compare_ordonnancements()
+{
+    ScenarioCycle actuel;
+    ScenarioCycle economie;
+    economie.periodeMs = 600000UL;
+    economie.lteEntreCycles = LTE_PSM;
+    economie.cpuEntreCycles = CPU_DEEP_SLEEP;
+
+    RapportEnergie rActuel = simulerEnergie(actuel, profilCourant);
+    RapportEnergie rEconomie = simulerEnergie(economie, profilCourant);
+
+    TEST_ASSERT_TRUE(rEconomie.mAhParJour < rActuel.mAhParJour);
+    TEST_ASSERT_TRUE(rEconomie.autonomieJours > rActuel.autonomieJours);
+}
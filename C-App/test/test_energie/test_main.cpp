@@ -0,0 +1,21 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void test_energie_durees_par_etat();
+void test_energie_conversion_mAh();
+void test_energie_parse_cbc();
+void test_energie_simulation_24h_pipeline_actuel();
+void test_energie_simulation_compare_ordonnancements();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_energie_durees_par_etat);
+    RUN_TEST(test_energie_conversion_mAh);
+    RUN_TEST(test_energie_parse_cbc);
+    RUN_TEST(test_energie_simulation_24h_pipeline_actuel);
+    RUN_TEST(test_energie_simulation_compare_ordonnancements);
+    UNITY_END();
+}
+
+void loop() {}
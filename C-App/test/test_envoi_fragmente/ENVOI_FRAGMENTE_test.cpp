@@ -0,0 +1,251 @@
+#include <unity.h>
+#include <string>
+#include "ENVOI_FRAGMENTE.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+#include "TRANSPORT_MQTT.hpp"
+
+// Octets écrits vers le modem (en-têtes AT+CASEND et données)
+static std::string ecrit;
+
+static size_t capturer(const uint8_t *donnees, size_t taille)
+{
+    ecrit.append((const char *)donnees, taille);
+    return taille;
+}
+
+static void recevoir(const char *texte, unsigned long maintenant)
+{
+    envoiFragmente.traiter(texte, strlen(texte), maintenant);
+}
+
+void setUp(void)
+{
+    ecrit.clear();
+    envoiFragmente.reinitialiser();
+    envoiFragmente.config = ConfigEnvoi();
+    envoiFragmente.sortie = capturer;
+    sessionReseau.reinitialiser();
+}
+
+void tearDown(void)
+{
+    envoiFragmente.sortie = nullptr;
+}
+
+void test_envoi_decoupage()
+{
+    EnvoiFragmente &e = envoiFragmente;
+    e.config.tailleCible = 1000;
+    TEST_ASSERT_EQUAL(0, e.nbFragments(0));
+    TEST_ASSERT_EQUAL(1, e.nbFragments(1));
+    TEST_ASSERT_EQUAL(1, e.nbFragments(1000));
+    TEST_ASSERT_EQUAL(3, e.nbFragments(2500));
+    TEST_ASSERT_EQUAL_UINT32(1000, e.tailleFragment(2500, 0));
+    TEST_ASSERT_EQUAL_UINT32(500, e.tailleFragment(2500, 2));
+    TEST_ASSERT_EQUAL_UINT32(0, e.tailleFragment(2500, 3));
+
+    // Cible au-delà de la limite du modem : bornée à 1460 octets
+    e.config.tailleCible = 4000;
+    TEST_ASSERT_EQUAL(2, e.nbFragments(2000));
+    TEST_ASSERT_EQUAL_UINT32(TAILLE_MAX_CASEND, e.tailleFragment(2000, 0));
+}
+
+// Le lot est prêt dès que sa taille estimée remplit un fragment, avant que le tampon de fixes soit plein
+void test_envoi_regroupement_lot()
+{
+    EnvoiFragmente &e = envoiFragmente;
+    e.config.tailleCible = 320;
+    TEST_ASSERT_FALSE(e.lotRempli(0));
+    TEST_ASSERT_FALSE(e.lotRempli(4));
+    TEST_ASSERT_TRUE(e.lotRempli(5)); // 120 + 5 x 40 octets estimés
+
+    // Lot précédent de 3 fixes en 270 octets : 50 octets par fix, le fragment est rempli à 4 fixes
+    e.mesurerLot(270, 3);
+    TEST_ASSERT_EQUAL_UINT32(320, e.tailleEstimee(4));
+    TEST_ASSERT_FALSE(e.lotRempli(3));
+    TEST_ASSERT_TRUE(e.lotRempli(4));
+    e.mesurerLot(100, 0);
+    e.mesurerLot(100, 1); // plus petit que l'en-tête estimé : ignoré
+    TEST_ASSERT_EQUAL_UINT32(320, e.tailleEstimee(4));
+
+    // Fragment par défaut : le tampon de MAX_COORDS fixes est plein avant ; historique : pas de regroupement
+    e.config.tailleCible = ConfigEnvoi().tailleCible;
+    TEST_ASSERT_FALSE(e.lotRempli(MAX_COORDS));
+    e.config.tailleCible = 320;
+    e.config.actif = false;
+    TEST_ASSERT_FALSE(e.lotRempli(MAX_COORDS));
+}
+
+// Chaque prompt fait écrire un fragment ; l'en-tête du suivant n'attend plus que le OK du fragment écrit
+void test_envoi_prompts_en_pipeline()
+{
+    EnvoiFragmente &e = envoiFragmente;
+    e.config.tailleCible = 4;
+    const uint8_t message[] = {'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j'};
+
+    e.commencer(message, sizeof(message), 1000);
+    TEST_ASSERT_EQUAL_STRING("AT+CASEND=0,4\r\n", ecrit.c_str());
+    TEST_ASSERT_EQUAL(ENVOI_EN_COURS, e.pomper(1000));
+
+    ecrit.clear();
+    recevoir("\r\n> ", 1010);
+    TEST_ASSERT_EQUAL_STRING("abcd", ecrit.c_str());
+
+    ecrit.clear();
+    recevoir("\r\nOK\r\n", 1020);
+    TEST_ASSERT_EQUAL_STRING("AT+CASEND=0,4\r\n", ecrit.c_str());
+    TEST_ASSERT_EQUAL(1, e.fragmentsAcquittes());
+
+    // URC au milieu du flux : transmise au suivi de session
+    ecrit.clear();
+    recevoir("\r\n> ", 1025);
+    recevoir("\r\n+CEREG: 5\r\n\r\nOK\r\n> ", 1030);
+    TEST_ASSERT_EQUAL_STRING("efghAT+CASEND=0,2\r\nij", ecrit.c_str());
+    TEST_ASSERT_EQUAL(ENREG_ITINERANCE, sessionReseau.enregistrement());
+    TEST_ASSERT_EQUAL(ENVOI_EN_COURS, e.etat());
+
+    // Ce qui suit le dernier OK dans le même bloc n'est pas consommé
+    const char *fin = "\r\nOK\r\n+CADATAIND: 0\r\n";
+    size_t lus = envoiFragmente.traiter(fin, strlen(fin), 1040);
+    TEST_ASSERT_EQUAL(ENVOI_TERMINE, e.etat());
+    TEST_ASSERT_EQUAL(3, e.fragmentsAcquittes());
+    TEST_ASSERT_EQUAL_STRING("+CADATAIND: 0\r\n", fin + lus);
+
+    const StatsEnvoi &s = e.stats;
+    TEST_ASSERT_EQUAL_UINT32(1, s.nbMessages);
+    TEST_ASSERT_EQUAL_UINT32(3, s.nbFragments);
+    TEST_ASSERT_EQUAL_UINT32(10, (uint32_t)s.octets);
+    TEST_ASSERT_EQUAL_UINT32(40, s.dureeMaxMs);
+}
+
+static json commandeRecue;
+
+static void capturerCommande(const json &message)
+{
+    commandeRecue = message;
+}
+
+// Commande MQTT (+SMSUB) arrivée entre deux fragments : remise au client MQTT, l'envoi continue
+void test_envoi_commande_mqtt_pendant_envoi()
+{
+    EnvoiFragmente &e = envoiFragmente;
+    e.config.tailleCible = 4;
+    const uint8_t message[] = {'a', 'b', 'c', 'd', 'e', 'f'};
+    String imeiInitial = imei;
+    imei = "861234";
+    commandeRecue = json();
+    transportMqtt.reinitialiser();
+    transportMqtt.appliquer = capturerCommande;
+
+    // Commande CBOR en hexadécimal : la ligne dépasse largement un en-tête de fragment
+    json options = {{"periode", 30}, {"geofence", std::string(120, 'z')}};
+    std::vector<uint8_t> cbor = json::to_cbor(options);
+    std::string urc = "\r\n+SMSUB: \"gps/861234/cmd\",\"";
+    const char *hexa = "0123456789ABCDEF";
+    for (uint8_t o : cbor)
+    {
+        urc += hexa[o >> 4];
+        urc += hexa[o & 0x0F];
+    }
+    urc += "\"\r\n";
+
+    e.commencer(message, sizeof(message), 1000);
+    recevoir("\r\n> ", 1010);
+    recevoir("\r\nOK\r\n", 1020);
+    recevoir(urc.c_str(), 1030);
+    ecrit.clear();
+    recevoir("\r\n> ", 1040);
+    TEST_ASSERT_EQUAL_STRING("ef", ecrit.c_str());
+    recevoir("\r\nOK\r\n", 1050);
+
+    TEST_ASSERT_EQUAL(ENVOI_TERMINE, e.etat());
+    TEST_ASSERT_EQUAL_UINT32(1, transportMqtt.stats.nbCommandes);
+    TEST_ASSERT_EQUAL(30, commandeRecue["periode"].get<int>());
+    TEST_ASSERT_EQUAL(120, commandeRecue["geofence"].get<std::string>().size());
+
+    transportMqtt.appliquer = nullptr;
+    imei = imeiInitial;
+}
+
+void test_envoi_erreur_et_delai()
+{
+    EnvoiFragmente &e = envoiFragmente;
+    e.config.tailleCible = 4;
+    const uint8_t message[] = {1, 2, 3, 4, 5, 6};
+
+    // Fragment refusé par le modem
+    e.commencer(message, sizeof(message), 1000);
+    recevoir("\r\n> ", 1010);
+    recevoir("\r\nERROR\r\n", 1020);
+    TEST_ASSERT_EQUAL(ENVOI_ECHEC, e.etat());
+    TEST_ASSERT_EQUAL(0, e.fragmentsAcquittes());
+
+    // Un OK sans fragment écrit ne compte pas ; sans prompt pendant delaiMs, l'envoi est abandonné
+    e.commencer(message, sizeof(message), 2000);
+    recevoir("\r\nOK\r\n", 2010);
+    TEST_ASSERT_EQUAL(0, e.fragmentsAcquittes());
+    TEST_ASSERT_EQUAL(ENVOI_EN_COURS, e.pomper(2000 + e.config.delaiMs));
+    TEST_ASSERT_EQUAL(ENVOI_ECHEC, e.pomper(2011 + e.config.delaiMs));
+    TEST_ASSERT_EQUAL_UINT32(2, e.stats.nbEchecs);
+
+    // Message vide : rien à écrire
+    ecrit.clear();
+    e.commencer(message, 0, 3000);
+    TEST_ASSERT_EQUAL(ENVOI_TERMINE, e.etat());
+    TEST_ASSERT_EQUAL_UINT32(0, ecrit.size());
+}
+
+// STEP_DEFINE_BYTE écrit le premier en-tête sans attendre le chrono, STEP_WRITE passe à STEP_RECEIVE au dernier OK
+void test_envoi_step_write()
+{
+    cborDataPipeline.assign(3000, 0xA5);
+    envoiFragmente.config.tailleCible = 1400;
+    currentStepCBOR = STEP_DEFINE_BYTE;
+    PERIODE_CBOR = millis();
+    STEP_DEFINE_BYTE_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_WRITE, currentStepCBOR);
+    TEST_ASSERT_EQUAL_STRING("AT+CASEND=0,1400\r\n", ecrit.c_str());
+
+    recevoir("\r\n> ", millis());
+    recevoir("\r\nOK\r\n> ", millis());
+    STEP_WRITE_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_WRITE, currentStepCBOR);
+    recevoir("\r\nOK\r\n> ", millis());
+    recevoir("\r\nOK\r\n", millis());
+    STEP_WRITE_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_RECEIVE, currentStepCBOR);
+    TEST_ASSERT_EQUAL_UINT32(3000 + 3 * strlen("AT+CASEND=0,1400\r\n") - 1, ecrit.size()); // dernier en-tête : AT+CASEND=0,200
+    cborDataPipeline.clear();
+}
+
+void test_envoi_benchmark_debit()
+{
+    ConfigEnvoi historique;
+    historique.actif = false;
+    ConfigEnvoi fragmente;
+    const uint16_t points[] = {1, MAX_COORDS, 60, 200};
+
+    char message[200];
+    for (uint16_t nb : points)
+    {
+        ScenarioEnvoi scenario;
+        scenario.nbPoints = nb;
+        RapportEnvoi avant = simulerEnvoi(scenario, historique);
+        RapportEnvoi apres = simulerEnvoi(scenario, fragmente);
+        snprintf(message, sizeof(message), "%u points (%lu o) : historique %s%lu ms, %lu o/s, %.2f CASEND/fix / fragmente %lu ms, %lu o/s, %.2f CASEND/fix",
+                 nb, (unsigned long)apres.octets, avant.echec ? "REFUSE, " : "", (unsigned long)avant.dureeMs,
+                 (unsigned long)avant.debitOctetsParS, avant.casendParFix, (unsigned long)apres.dureeMs,
+                 (unsigned long)apres.debitOctetsParS, apres.casendParFix);
+        TEST_MESSAGE(message);
+
+        TEST_ASSERT_FALSE(apres.echec);
+        TEST_ASSERT_TRUE(apres.dureeMs < avant.dureeMs);
+        TEST_ASSERT_EQUAL_UINT32((apres.octets + fragmente.tailleCible - 1) / fragmente.tailleCible, apres.nbCasend);
+    }
+
+    // Au-delà de 1460 octets, un seul AT+CASEND est refusé par le modem
+    ScenarioEnvoi grand;
+    grand.nbPoints = 60;
+    TEST_ASSERT_TRUE(simulerEnvoi(grand, historique).echec);
+}
@@ -0,0 +1,28 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_envoi_decoupage();
+void test_envoi_regroupement_lot();
+void test_envoi_prompts_en_pipeline();
+void test_envoi_commande_mqtt_pendant_envoi();
+void test_envoi_erreur_et_delai();
+void test_envoi_step_write();
+void test_envoi_benchmark_debit();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_envoi_decoupage);
+    RUN_TEST(test_envoi_regroupement_lot);
+    RUN_TEST(test_envoi_prompts_en_pipeline);
+    RUN_TEST(test_envoi_commande_mqtt_pendant_envoi);
+    RUN_TEST(test_envoi_erreur_et_delai);
+    RUN_TEST(test_envoi_step_write);
+    RUN_TEST(test_envoi_benchmark_debit);
+    UNITY_END();
+}
+
+void loop() {}
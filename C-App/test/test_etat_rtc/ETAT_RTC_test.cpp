@@ -0,0 +1,121 @@
+#include <unity.h>
+#include "ETAT_RTC.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+
+extern EtatRetenu etatRTC;
+
+void setUp(void)
+{
+    invaliderEtatRTC();
+    energie.reinitialiser(millis());
+    gestionPSM = GestionPSM();
+}
+
+void tearDown(void) {}
+
+static void preparerEtat()
+{
+    currentStepGLOBAL = STEP_GNSS;
+    gnssStepState = GNSS_INFO;
+    nbCoordonnees = 2;
+    dataGNSS[0].gnss.coordonnees.latitude.full = "50.634412";
+    dataGNSS[0].gnss.coordonnees.longitude.full = "3.048687";
+    dataGNSS[0].gnss.timeStamp = "20250612101530.000";
+    dataGNSS[1].gnss.coordonnees.latitude.full = "50.634520";
+    dataGNSS[1].gnss.coordonnees.longitude.full = "3.048712";
+    dataGNSS[1].gnss.timeStamp = "20250612101533.000";
+    imei = "869951030012345";
+    gestionPSM.accorde.psmAccorde = true;
+    gestionPSM.accorde.tauS = 3600;
+    periodeAjustement = 600000;
+    period10min = millis() - 1000;
+    periodGNSS = millis() - 500;
+    gnssOptions.precisionActive = true;
+    gnssOptions.precision = 2;
+    energie.enregistrerFix();
+    energie.enregistrerFix();
+}
+
+static void effacerEtat()
+{
+    currentStepGLOBAL = STEP_INIT_GLOBAL;
+    gnssStepState = GNSS_POWER_ON;
+    nbCoordonnees = 0;
+    dataGNSS[0].gnss = Gnss();
+    dataGNSS[1].gnss = Gnss();
+    imei = "";
+    gestionPSM = GestionPSM();
+    periodeAjustement = 30000;
+    gnssOptions = GnssOptions();
+    energie.reinitialiser(millis());
+}
+
+// Le lot de fixes, le curseur du pipeline, la session réseau et les timers survivent au deep sleep
+void test_etat_rtc_sauvegarde_restauration()
+{
+    preparerEtat();
+    sauvegarderEtatRTC(120000);
+    effacerEtat();
+
+    TEST_ASSERT_TRUE(etatRTCValide());
+    appliquerEtatRTC();
+
+    TEST_ASSERT_EQUAL(STEP_GNSS, currentStepGLOBAL);
+    TEST_ASSERT_EQUAL(GNSS_INFO, gnssStepState);
+    TEST_ASSERT_EQUAL(2, nbCoordonnees);
+    TEST_ASSERT_EQUAL_STRING("50.634520", dataGNSS[1].gnss.coordonnees.latitude.full.c_str());
+    TEST_ASSERT_EQUAL_STRING("3.048687", dataGNSS[0].gnss.coordonnees.longitude.full.c_str());
+    TEST_ASSERT_EQUAL_STRING("20250612101533.000", dataGNSS[1].gnss.timeStamp.c_str());
+    TEST_ASSERT_TRUE(dataGNSS[0].gnss.isValid);
+    TEST_ASSERT_EQUAL_STRING("869951030012345", imei.c_str());
+    TEST_ASSERT_TRUE(gestionPSM.accorde.psmAccorde);
+    TEST_ASSERT_EQUAL(3600, gestionPSM.accorde.tauS);
+    TEST_ASSERT_EQUAL(600000, periodeAjustement);
+    TEST_ASSERT_TRUE(gnssOptions.precisionActive);
+    TEST_ASSERT_EQUAL(2, gnssOptions.precision);
+
+    // Les timers ont vieilli de la durée du sommeil
+    TEST_ASSERT_UINT32_WITHIN(50, 121000, millis() - period10min);
+    TEST_ASSERT_UINT32_WITHIN(50, 120500, millis() - periodGNSS);
+
+    // La comptabilité énergétique continue sur la même période de mesure
+    RapportEnergie r = energie.rapport(millis(), profilCourant);
+    TEST_ASSERT_EQUAL(2, r.nbFix);
+    TEST_ASSERT_TRUE(r.dureeMs >= 120000);
+}
+
+void test_etat_rtc_corruption_detectee()
+{
+    preparerEtat();
+    sauvegarderEtatRTC(60000);
+    TEST_ASSERT_TRUE(etatRTCValide());
+
+    etatRTC.fixes[0].latitude[0] ^= 0x01;
+    TEST_ASSERT_FALSE(etatRTCValide());
+
+    sauvegarderEtatRTC(60000);
+    invaliderEtatRTC();
+    TEST_ASSERT_FALSE(etatRTCValide());
+
+    // Démarrage à froid (pas un réveil timer) : aucune reprise
+    sauvegarderEtatRTC(60000);
+    TEST_ASSERT_FALSE(restaurerEtatRTC());
+}
+
+// La reprise doit se faire en moins de 100 ms
+void test_etat_rtc_reprise_rapide()
+{
+    preparerEtat();
+    nbCoordonnees = MAX_COORDS;
+    sauvegarderEtatRTC(300000);
+    effacerEtat();
+
+    unsigned long debut = micros();
+    TEST_ASSERT_TRUE(etatRTCValide());
+    appliquerEtatRTC();
+    unsigned long duree = micros() - debut;
+
+    TEST_MESSAGE(("Reprise : " + String(duree) + " us").c_str());
+    TEST_ASSERT_LESS_THAN(100000UL, duree);
+    TEST_ASSERT_EQUAL(MAX_COORDS, nbCoordonnees);
+}
@@ -0,0 +1,20 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_etat_rtc_sauvegarde_restauration();
+void test_etat_rtc_corruption_detectee();
+void test_etat_rtc_reprise_rapide();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_etat_rtc_sauvegarde_restauration);
+    RUN_TEST(test_etat_rtc_corruption_detectee);
+    RUN_TEST(test_etat_rtc_reprise_rapide);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,160 @@
+#include <unity.h>
+#include "FLUX_GNSS.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+static const char *URC_FIX = "\r\n+UGNSINF: 1,1,20250612101530.000,50.634412,3.048687,35.2,1.85,12.0,1,,1.2,1.5,0.9,,8,6,,,42,,\r\n";
+static const char *URC_SANS_FIX = "\r\n+UGNSINF: 1,0,20250612101529.000,,,,,,0,,,,,,8,0,,,,,\r\n";
+static const char *RMC = "$GNRMC,101530.00,A,5038.06472,N,00302.92122,E,0.52,,120625,,,A*5F\r\n";
+
+static void pousser(const char *texte, unsigned long maintenant)
+{
+    traiterFluxGnss(texte, strlen(texte), maintenant);
+}
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    parseurFluxGnss.reinitialiser();
+    fluxGnss = FluxGnss();
+    nbCoordonnees = 0;
+    gnssStepState = GNSS_INFO;
+    // Débit brut du flux : l'échantillonnage adaptatif est couvert par test_echantillonnage
+    echantillonneur.reinitialiser();
+    echantillonneur.config.actif = false;
+    // Fixtures à horodatage constant : le cache et le rejet des doublons sont couverts par test_cache_fix
+    cacheFix.reinitialiser();
+    cacheFix.config.actif = false;
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+}
+
+void test_flux_parseur_ugnsinf_incremental()
+{
+    ParseurFluxGnss parseur;
+    int fixes = 0;
+    // Octet par octet, comme reçu sur l'UART
+    for (const char *p = URC_SANS_FIX; *p; ++p)
+        fixes += parseur.consommer(*p);
+    TEST_ASSERT_EQUAL(0, fixes);
+
+    for (const char *p = URC_FIX; *p; ++p)
+        fixes += parseur.consommer(*p);
+    TEST_ASSERT_EQUAL(1, fixes);
+    TEST_ASSERT_EQUAL(2, parseur.nbPhrasesGnss);
+
+    const FixFlux &fix = parseur.fix();
+    TEST_ASSERT_TRUE(fix.valide);
+    TEST_ASSERT_EQUAL_STRING("20250612101530.000", fix.horodatage);
+    TEST_ASSERT_EQUAL_STRING("50.634412", fix.latitude);
+    TEST_ASSERT_EQUAL_STRING("3.048687", fix.longitude);
+    TEST_ASSERT_EQUAL(12, fix.hdopDixiemes);
+    TEST_ASSERT_EQUAL(18, fix.vitesseKmhDixiemes);
+    TEST_ASSERT_EQUAL(6, fix.satellites);
+
+    // Ligne trop longue : ignorée sans déborder
+    for (int i = 0; i < 300; ++i)
+        parseur.consommer('x');
+    TEST_ASSERT_FALSE(parseur.consommer('\n'));
+    TEST_ASSERT_EQUAL(1, parseur.nbLignesTropLongues);
+}
+
+void test_flux_parseur_nmea_rmc()
+{
+    char degres[16];
+    TEST_ASSERT_TRUE(convertirNmeaEnDegres("5038.06472", 'N', degres, sizeof(degres)));
+    TEST_ASSERT_EQUAL_STRING("50.634412", degres);
+    TEST_ASSERT_TRUE(convertirNmeaEnDegres("00302.92122", 'W', degres, sizeof(degres)));
+    TEST_ASSERT_EQUAL_STRING("-3.048687", degres);
+    TEST_ASSERT_FALSE(convertirNmeaEnDegres("", 'N', degres, sizeof(degres)));
+
+    ParseurFluxGnss parseur;
+    int fixes = 0;
+    for (const char *p = RMC; *p; ++p)
+        fixes += parseur.consommer(*p);
+    TEST_ASSERT_EQUAL(1, fixes);
+    TEST_ASSERT_EQUAL_STRING("20250612101530.000", parseur.fix().horodatage);
+    TEST_ASSERT_EQUAL_STRING("50.634412", parseur.fix().latitude);
+    TEST_ASSERT_EQUAL_STRING("3.048687", parseur.fix().longitude);
+    TEST_ASSERT_EQUAL(9, parseur.fix().vitesseKmhDixiemes); // 0.5 noeud
+
+    // Checksum faux : phrase rejetée
+    const char *corrompue = "$GNRMC,101530.00,A,5038.06472,N,00302.92122,E,0.52,,120625,,,A*00\r\n";
+    for (const char *p = corrompue; *p; ++p)
+        fixes += parseur.consommer(*p);
+    TEST_ASSERT_EQUAL(1, fixes);
+    TEST_ASSERT_EQUAL(1, parseur.nbErreursChecksum);
+}
+
+// En mode flux, GNSS_INFO n'envoie que AT+CGNSURC=1 puis se contente de lire les URC
+void test_flux_step_gnss_sans_commande()
+{
+    step_gnss_function();
+    TEST_ASSERT_TRUE(fluxGnss.actif);
+    TEST_ASSERT_EQUAL(1, (int)simulateur.commandes.size());
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CGNSURC=1"));
+
+    for (int i = 0; i < MAX_COORDS; ++i)
+    {
+        pousser(URC_FIX, 1000UL * i);
+        step_gnss_function();
+    }
+    TEST_ASSERT_EQUAL(MAX_COORDS, nbCoordonnees);
+    TEST_ASSERT_EQUAL_STRING("50.634412", dataGNSS[0].gnss.coordonnees.latitude.full.c_str());
+    TEST_ASSERT_EQUAL(GNSS_POWER_OFF, gnssStepState);
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CGNSURC=0"));
+    TEST_ASSERT_EQUAL(2, (int)simulateur.commandes.size());
+}
+
+// Même collecte de MAX_COORDS fixes, tick du pipeline toutes les 500 ms, URC à 1 Hz
+void test_flux_benchmark_sondage_contre_flux()
+{
+    simulateur.repondre("AT+CGNSPWR?", "\r\n+CGNSPWR: 1\r\n\r\nOK\r\n");
+    simulateur.repondre("AT+CGNSINF", "\r\n+CGNSINF: 1,1,20250612101530.000,50.634412,3.048687,35.2,1.85,12.0,1,,1.2,1.5,0.9,,8,6,,,42,,\r\n\r\nOK\r\n");
+
+    // Sondage
+    fluxGnss.mode = GNSS_MODE_SONDAGE;
+    periodGNSS = millis();
+    debutInfoGnss(millis());
+    while (gnssStepState == GNSS_INFO)
+    {
+        step_gnss_function();
+        delay(500);
+    }
+    StatsModeGnss sondage = fluxGnss.statsSondage;
+
+    // Flux
+    nbCoordonnees = 0;
+    gnssStepState = GNSS_INFO;
+    fluxGnss.mode = GNSS_MODE_FLUX;
+    debutInfoGnss(millis());
+    for (int tick = 0; gnssStepState == GNSS_INFO; ++tick)
+    {
+        if (tick % 2 == 1)
+            pousser(URC_FIX, millis());
+        step_gnss_function();
+        delay(500);
+    }
+    StatsModeGnss flux = fluxGnss.statsFlux;
+
+    TEST_MESSAGE(("Sondage : " + String(echantillonsParSeconde(sondage), 2) + " ech/s, " + String(octetsParFix(sondage), 0) +
+                  " octets/fix, " + String(sondage.transactions) + " transactions")
+                     .c_str());
+    TEST_MESSAGE(("Flux    : " + String(echantillonsParSeconde(flux), 2) + " ech/s, " + String(octetsParFix(flux), 0) +
+                  " octets/fix, " + String(flux.transactions) + " transactions")
+                     .c_str());
+
+    TEST_ASSERT_EQUAL(MAX_COORDS, sondage.nbFix);
+    TEST_ASSERT_EQUAL(MAX_COORDS, flux.nbFix);
+    // URC à 1 Hz : le débit mesuré inclut l'activation (AT+CGNSURC=1) et l'attente de la première URC
+    TEST_ASSERT_TRUE(echantillonsParSeconde(flux) >= 0.8f);
+    TEST_ASSERT_TRUE(echantillonsParSeconde(flux) > 2 * echantillonsParSeconde(sondage));
+    TEST_ASSERT_TRUE(octetsParFix(flux) < octetsParFix(sondage) / 2);
+    TEST_ASSERT_EQUAL(2, flux.transactions);
+}
@@ -0,0 +1,22 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_flux_parseur_ugnsinf_incremental();
+void test_flux_parseur_nmea_rmc();
+void test_flux_step_gnss_sans_commande();
+void test_flux_benchmark_sondage_contre_flux();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_flux_parseur_ugnsinf_incremental);
+    RUN_TEST(test_flux_parseur_nmea_rmc);
+    RUN_TEST(test_flux_step_gnss_sans_commande);
+    RUN_TEST(test_flux_benchmark_sondage_contre_flux);
+    UNITY_END();
+}
+
+void loop() {}
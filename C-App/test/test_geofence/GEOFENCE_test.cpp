@@ -0,0 +1,161 @@
+#include <unity.h>
+#include "GEOFENCE.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+
+#define LAT_BASE 50634412
+#define LON_BASE 3048687
+
+void setUp(void)
+{
+    geofences.vider();
+    geofences.config = ConfigGeofence();
+    geofences.stats = StatsGeofence();
+}
+
+void tearDown(void) {}
+
+void test_geofence_cercle_entree_sortie()
+{
+    TEST_ASSERT_TRUE(geofences.ajouterCercle(7, LAT_BASE, LON_BASE, 100));
+    // 900 µdeg de latitude = 100 m
+    TEST_ASSERT_EQUAL(0, geofences.evaluer(LAT_BASE + 1000, LON_BASE, 0));
+    TEST_ASSERT_EQUAL(1, geofences.evaluer(LAT_BASE + 800, LON_BASE, 1000));
+    TEST_ASSERT_TRUE(geofences.estDedans(0));
+    TEST_ASSERT_EQUAL(0, geofences.evaluer(LAT_BASE, LON_BASE + 500, 2000));
+    TEST_ASSERT_EQUAL(1, geofences.evaluer(LAT_BASE, LON_BASE + 1500, 3000));
+
+    TEST_ASSERT_EQUAL(2, geofences.nbEvenements());
+    TEST_ASSERT_TRUE(geofences.evenement(0).entree);
+    TEST_ASSERT_FALSE(geofences.evenement(1).entree);
+    TEST_ASSERT_EQUAL(7, geofences.evenement(1).id);
+}
+
+void test_geofence_polygone_concave()
+{
+    // L : carré de 2 km dont le quart nord-est est retiré
+    const int32_t l[6][2] = {
+        {LAT_BASE, LON_BASE},
+        {LAT_BASE, LON_BASE + 28000},
+        {LAT_BASE + 9000, LON_BASE + 28000},
+        {LAT_BASE + 9000, LON_BASE + 14000},
+        {LAT_BASE + 18000, LON_BASE + 14000},
+        {LAT_BASE + 18000, LON_BASE}};
+    TEST_ASSERT_TRUE(geofences.ajouterPolygone(3, l, 6));
+
+    geofences.evaluer(LAT_BASE + 4000, LON_BASE + 20000, 0); // branche sud
+    TEST_ASSERT_TRUE(geofences.estDedans(0));
+    geofences.evaluer(LAT_BASE + 14000, LON_BASE + 7000, 0); // branche ouest
+    TEST_ASSERT_TRUE(geofences.estDedans(0));
+    geofences.evaluer(LAT_BASE + 14000, LON_BASE + 21000, 0); // quart retiré
+    TEST_ASSERT_FALSE(geofences.estDedans(0));
+    geofences.evaluer(LAT_BASE - 10, LON_BASE + 7000, 0); // juste au sud
+    TEST_ASSERT_FALSE(geofences.estDedans(0));
+
+    const int32_t degenere[2][2] = {{LAT_BASE, LON_BASE}, {LAT_BASE + 10, LON_BASE}};
+    TEST_ASSERT_FALSE(geofences.ajouterPolygone(4, degenere, 2));
+}
+
+void test_geofence_sortie_hors_cellule()
+{
+    geofences.ajouterCercle(1, LAT_BASE, LON_BASE, 50);
+    geofences.evaluer(LAT_BASE, LON_BASE, 0);
+    TEST_ASSERT_TRUE(geofences.estDedans(0));
+    // 10 km plus loin : la cellule ne contient pas la zone, la sortie est quand même détectée
+    TEST_ASSERT_EQUAL(1, geofences.evaluer(LAT_BASE + 90000, LON_BASE, 1000));
+    TEST_ASSERT_FALSE(geofences.estDedans(0));
+}
+
+void test_geofence_downlink_et_envoi_sur_evenement()
+{
+    json config = json::parse(R"([
+        {"id": 10, "lat": 50.634412, "lon": 3.048687, "rayon": 200},
+        {"id": 11, "polygone": [[50.60, 3.00], [50.60, 3.01], [50.61, 3.01], [50.61, 3.00]]},
+        {"id": 12, "polygone": [[50.60, 3.00]]}
+    ])");
+    TEST_ASSERT_FALSE(chargerGeofences(config)); // la zone 12 est refusée
+    TEST_ASSERT_EQUAL(2, geofences.nbGeofences());
+    TEST_ASSERT_EQUAL(GEOFENCE_POLYGONE, geofences.geofence(1).type);
+    TEST_ASSERT_EQUAL_INT32(50600000, geofences.geofence(1).latMinE6);
+
+    chargerOptionsGeofence(json::parse(R"({"envoiSurEvenement": true, "heartbeat": 600000})"));
+    TEST_ASSERT_TRUE(geofences.envoiNecessaire(0)); // premier envoi
+    geofences.enregistrerEnvoi(0);
+    TEST_ASSERT_FALSE(geofences.envoiNecessaire(60000));
+    TEST_ASSERT_TRUE(geofences.envoiNecessaire(600000)); // heartbeat
+
+    imei = "123456789012345";
+    geofences.evaluer(LAT_BASE, LON_BASE, 61000);
+    TEST_ASSERT_TRUE(geofences.envoiNecessaire(61000));
+    String json = evenementsGeofenceJSON();
+    TEST_ASSERT_EQUAL_STRING("{\"imei\":\"123456789012345\",\"latitude\":50.634412,\"longitude\":3.048687,"
+                             "\"geofence\":10,\"evenement\":\"entree\"}",
+                             json.c_str());
+    geofences.acquitterEvenements();
+    TEST_ASSERT_FALSE(geofences.envoiNecessaire(62000));
+}
+
+// Evénements acquittés à la livraison du message seulement : un envoi échoué les renvoie avec le lot suivant
+void test_geofence_evenements_acquittes_a_la_livraison()
+{
+    TEST_ASSERT_TRUE(geofences.ajouterCercle(7, LAT_BASE, LON_BASE, 100));
+    chargerOptionsGeofence(json::parse(R"({"envoiSurEvenement": true, "heartbeat": 600000})"));
+    imei = "123456789012345";
+    nbCoordonnees = 0;
+    geofences.evaluer(LAT_BASE, LON_BASE, 1000);
+    step_compose_json_function();
+    TEST_ASSERT_TRUE(tableauJSONString.indexOf("\"evenement\":\"entree\"") != -1);
+    TEST_ASSERT_EQUAL(1, geofences.nbEvenements());
+    TEST_ASSERT_FALSE(geofences.envoiFait);
+
+    // Envoi abandonné, nouveau lot : l'entrée repart avec la sortie
+    geofences.evaluer(LAT_BASE, LON_BASE + 1500, 2000);
+    step_compose_json_function();
+    TEST_ASSERT_TRUE(tableauJSONString.indexOf("\"evenement\":\"entree\"") != -1);
+    TEST_ASSERT_TRUE(tableauJSONString.indexOf("\"evenement\":\"sortie\"") != -1);
+
+    // Livraison : les événements du message sont retirés, celui arrivé pendant l'envoi reste
+    geofences.evaluer(LAT_BASE, LON_BASE, 3000);
+    endCBOR = true;
+    STEP_END_FUNCTION();
+    TEST_ASSERT_EQUAL(1, geofences.nbEvenements());
+    TEST_ASSERT_TRUE(geofences.evenement(0).entree);
+    TEST_ASSERT_EQUAL_UINT32(3000, geofences.evenement(0).tMs);
+    TEST_ASSERT_TRUE(geofences.envoiFait);
+    tableauJSONString = "";
+    currentStepGLOBAL = STEP_INIT_GLOBAL;
+}
+
+void test_geofence_index_et_cout_par_fix()
+{
+    // MAX_GEOFENCES cercles de 300 m répartis sur une grille de 16 x 16 km
+    for (int i = 0; i < MAX_GEOFENCES; ++i)
+        TEST_ASSERT_TRUE(geofences.ajouterCercle(i, LAT_BASE + (i / 16) * 9000, LON_BASE + (i % 16) * 14000, 300));
+    TEST_ASSERT_FALSE(geofences.ajouterCercle(999, LAT_BASE, LON_BASE, 300));
+
+    uint32_t cycles = 0;
+    const int nbFix = 1500;
+    for (int k = 0; k < nbFix; ++k)
+    {
+        // Diagonale de la grille, un point tous les ~14 m
+        int32_t lat = LAT_BASE + k * 90, lon = LON_BASE + k * 141 + (k % 7) * 50;
+        uint32_t debut = compteurCycles();
+        geofences.evaluer(lat, lon, k * 1000UL);
+        cycles += compteurCycles() - debut;
+
+        // L'index donne le même résultat qu'un test exhaustif
+        for (uint16_t i = 0; i < geofences.nbGeofences(); ++i)
+        {
+            const Geofence &g = geofences.geofence(i);
+            bool attendu = distanceMm(g.latE6, g.lonE6, lat, lon) <= g.rayonM * 1000;
+            if (attendu != geofences.estDedans(i))
+                TEST_FAIL_MESSAGE(("zone " + String(i) + " fix " + String(k)).c_str());
+        }
+    }
+
+    TEST_MESSAGE(("Zones : " + String(geofences.nbGeofences()) + ", tests par fix (max) : " + String(geofences.stats.nbTestsMax) +
+                  ", " + String(cycles / nbFix) + " cycles/fix")
+                     .c_str());
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(8, geofences.stats.nbTestsMax);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(15, geofences.stats.nbEntrees);
+}
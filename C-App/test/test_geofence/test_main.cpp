@@ -0,0 +1,26 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_geofence_cercle_entree_sortie();
+void test_geofence_polygone_concave();
+void test_geofence_sortie_hors_cellule();
+void test_geofence_downlink_et_envoi_sur_evenement();
+void test_geofence_evenements_acquittes_a_la_livraison();
+void test_geofence_index_et_cout_par_fix();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_geofence_cercle_entree_sortie);
+    RUN_TEST(test_geofence_polygone_concave);
+    RUN_TEST(test_geofence_sortie_hors_cellule);
+    RUN_TEST(test_geofence_downlink_et_envoi_sur_evenement);
+    RUN_TEST(test_geofence_evenements_acquittes_a_la_livraison);
+    RUN_TEST(test_geofence_index_et_cout_par_fix);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,197 @@
+#include <unity.h>
+#include "MULTIPLEXEUR_SOCKETS.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    simulateur.repondre("AT+CASEND=1,", "\r\n>"); // identification du canal de contrôle
+    multiplexeurSockets.reinitialiser();
+    multiplexeurSockets.config = ConfigSockets();
+    ecouteDescendante.reinitialiser();
+    ecouteDescendante.config = ConfigEcoute();
+    sessionReseau.reinitialiser();
+    gestionPSM.accorde = EtatPSMReseau();
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+}
+
+void test_sockets_canaux()
+{
+    MultiplexeurSockets &m = multiplexeurSockets;
+    TEST_ASSERT_EQUAL(CID_ENVOI, m.cid(CANAL_ENVOI));
+    TEST_ASSERT_EQUAL(CID_CONTROLE, m.cid(CANAL_CONTROLE));
+    m.marquer(CANAL_ENVOI, true);
+    TEST_ASSERT_TRUE(m.estOuvert(CANAL_ENVOI));
+    TEST_ASSERT_FALSE(m.estOuvert(CANAL_CONTROLE));
+
+    // Socket partagé : le contrôle passe par le cid 0 et suit son état
+    m.config.actif = false;
+    TEST_ASSERT_EQUAL(CID_ENVOI, m.cid(CANAL_CONTROLE));
+    TEST_ASSERT_TRUE(m.estOuvert(CANAL_CONTROLE));
+}
+
+void test_sockets_ouverture_unique()
+{
+    MultiplexeurSockets &m = multiplexeurSockets;
+    simulateur.repondre("AT+CAOPEN=1", "\r\n+CAOPEN: 1,0\r\n\r\nOK\r\n");
+    TEST_ASSERT_TRUE(m.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_TRUE(m.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CAOPEN"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CAOPEN=1,0,\"TCP\""));
+    TEST_ASSERT_EQUAL_UINT32(1, m.stats[CANAL_CONTROLE].nbOuvertures);
+    TEST_ASSERT_EQUAL_UINT32(1, m.stats[CANAL_CONTROLE].nbOuverturesEvitees);
+
+    // Connexion refusée par le serveur : <résultat> non nul
+    simulateur.repondre("AT+CAOPEN=0", "\r\n+CAOPEN: 0,1\r\n\r\nOK\r\n");
+    TEST_ASSERT_FALSE(m.ouvrir(CANAL_ENVOI));
+    TEST_ASSERT_FALSE(m.estOuvert(CANAL_ENVOI));
+    TEST_ASSERT_EQUAL_UINT32(1, m.stats[CANAL_ENVOI].nbEchecsOuverture);
+
+    m.fermer(CANAL_CONTROLE);
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CACLOSE=1"));
+    TEST_ASSERT_FALSE(m.estOuvert(CANAL_CONTROLE));
+    TEST_ASSERT_EQUAL_UINT32(1, m.stats[CANAL_CONTROLE].nbFermetures);
+}
+
+// Le socket ouvert par STEP_OPEN_CONNEXION n'est pas rouvert par receive()
+// Canal de contrôle identifié auprès du serveur à chaque ouverture ; sans OK, il est refermé
+void test_sockets_identification_controle()
+{
+    MultiplexeurSockets &m = multiplexeurSockets;
+    String imeiInitial = imei;
+    imei = "861234";
+    TEST_ASSERT_TRUE(m.ouvrir(CANAL_CONTROLE));
+    std::vector<uint8_t> trame = json::to_cbor(json{{"name", "861234"}, {"controle", true}});
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CASEND=1," + String((unsigned long)trame.size())));
+    const String &contenu = simulateur.commandes.back();
+    TEST_ASSERT_EQUAL(trame.size(), contenu.length());
+    json identification = json::from_cbor(std::vector<uint8_t>(contenu.c_str(), contenu.c_str() + contenu.length()));
+    TEST_ASSERT_EQUAL_STRING("861234", identification["name"].get<std::string>().c_str());
+    TEST_ASSERT_TRUE(identification["controle"].get<bool>());
+
+    // Le canal d'envoi ne s'identifie pas : ses lots portent l'IMEI
+    simulateur.commandes.clear();
+    TEST_ASSERT_TRUE(m.ouvrir(CANAL_ENVOI));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CASEND"));
+
+    // Pas de prompt : socket refermé, rouvert au cycle suivant
+    m.fermer(CANAL_CONTROLE);
+    simulateur.repondre("AT+CASEND=1,", "\r\nERROR\r\n");
+    TEST_ASSERT_FALSE(m.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_FALSE(m.estOuvert(CANAL_CONTROLE));
+    TEST_ASSERT_EQUAL_UINT32(1, m.stats[CANAL_CONTROLE].nbEchecsOuverture);
+    imei = imeiInitial;
+}
+
+void test_sockets_receive_sans_double_caopen()
+{
+    multiplexeurSockets.marquer(CANAL_ENVOI, true);
+    receive();
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CAOPEN"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CARECV=0"));
+    TEST_ASSERT_EQUAL_UINT32(1, multiplexeurSockets.stats[CANAL_ENVOI].nbOuverturesEvitees);
+}
+
+void test_sockets_fermeture_distante()
+{
+    MultiplexeurSockets &m = multiplexeurSockets;
+    m.marquer(CANAL_ENVOI, true);
+    m.marquer(CANAL_CONTROLE, true);
+
+    // URC lue par le suivi de session (pendant un envoi fragmenté par exemple)
+    const char *urc = "\r\n+CASTATE: 1,0\r\n";
+    sessionReseau.traiter(urc, strlen(urc), 1000);
+    TEST_ASSERT_FALSE(m.estOuvert(CANAL_CONTROLE));
+    TEST_ASSERT_TRUE(m.estOuvert(CANAL_ENVOI));
+    TEST_ASSERT_EQUAL_UINT32(1, m.stats[CANAL_CONTROLE].nbFermeturesDistantes);
+    TEST_ASSERT_EQUAL_UINT32(0, m.stats[CANAL_ENVOI].nbFermeturesDistantes);
+
+    // Ouverture (+CASTATE: 0,1) ignorée, le pipeline marque lui-même le socket de l'envoi
+    m.traiterLigne("+CASTATE: 0,1");
+    TEST_ASSERT_TRUE(m.estOuvert(CANAL_ENVOI));
+}
+
+// Le socket de contrôle ouvert au premier cycle reste ouvert pendant l'envoi suivant et après son échec
+void test_sockets_controle_garde_pendant_envoi()
+{
+    simulateur.repondre("AT+CAOPEN=1", "\r\n+CAOPEN: 1,0\r\n\r\nOK\r\n");
+    multiplexeurSockets.marquer(CANAL_ENVOI, true);
+    stepReceiveFunctionBoolean = true;
+    currentStepCBOR = STEP_RECEIVE;
+    STEP_RECEIVE_FUNCTION();
+    TEST_ASSERT_TRUE(ecouteDescendante.estOuverte());
+    TEST_ASSERT_EQUAL(CID_CONTROLE, ecouteDescendante.socket());
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CARECV=0")); // réponse à l'envoi, sur son socket
+
+    // Envoi suivant : le socket de contrôle n'est ni lu ni fermé par STEP_OPEN_CONNEXION
+    multiplexeurSockets.marquer(CANAL_ENVOI, false);
+    simulateur.commandes.clear();
+    currentStepCBOR = STEP_OPEN_CONNEXION;
+    STEP_OPEN_CONNEXION_FUNCTION();
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CACLOSE=1"));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CARECV=1"));
+    TEST_ASSERT_TRUE(ecouteDescendante.estOuverte());
+
+    // Envoi échoué : seul le socket de l'envoi est fermé
+    multiplexeurSockets.marquer(CANAL_ENVOI, true);
+    PERIODE_CBOR = millis() - 1000;
+    STEP_INIT_CBOR_FUNCTION("{\"a\":1}");
+    taskCBOR_CASEND->onErrorCallback(*taskCBOR_CASEND);
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CACLOSE=0"));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CACLOSE=1"));
+    TEST_ASSERT_TRUE(multiplexeurSockets.estOuvert(CANAL_CONTROLE));
+    TEST_ASSERT_TRUE(ecouteDescendante.estOuverte());
+
+    // Cycle suivant : pas de nouvel AT+CAOPEN=1, une lecture rattrape une annonce consommée par une autre commande
+    simulateur.commandes.clear();
+    stepReceiveFunctionBoolean = true;
+    STEP_RECEIVE_FUNCTION();
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CAOPEN=1"));
+    TEST_ASSERT_TRUE(ecouteDescendante.donneesAnnoncees());
+    TEST_ASSERT_EQUAL_UINT32(1, ecouteDescendante.stats.nbSessions);
+
+    currentStepCBOR = STEP_INIT_CBOR;
+    currentStepGLOBAL = STEP_INIT_GLOBAL;
+    endCBOR = false;
+    cborDataPipeline.clear();
+}
+
+void test_sockets_benchmark_charge_mixte()
+{
+    ScenarioMultiplexage scenario;
+    ConfigSockets partage;
+    partage.actif = false;
+    ConfigSockets separe;
+
+    RapportMultiplexage avant = simulerMultiplexage(scenario, partage);
+    RapportMultiplexage apres = simulerMultiplexage(scenario, separe);
+    char message[220];
+    snprintf(message, sizeof(message),
+             "%lu envois (%lu echoues), %lu commandes : partage %lu o/s, %lu ms moyenne, %lu ms max, %lu retardees / "
+             "separe %lu o/s, %lu ms moyenne, %lu ms max, %lu retardees",
+             (unsigned long)avant.nbEnvois, (unsigned long)avant.nbEnvoisEchoues, (unsigned long)avant.nbControles,
+             (unsigned long)avant.debitEnvoiOctetsParS, (unsigned long)avant.latenceControleMoyenneMs,
+             (unsigned long)avant.latenceControleMaxMs, (unsigned long)avant.nbControlesRetardes,
+             (unsigned long)apres.debitEnvoiOctetsParS, (unsigned long)apres.latenceControleMoyenneMs,
+             (unsigned long)apres.latenceControleMaxMs, (unsigned long)apres.nbControlesRetardes);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_EQUAL_UINT32(avant.nbControles + avant.nbControlesEnAttente, apres.nbControles);
+    TEST_ASSERT_EQUAL_UINT32(0, apres.nbControlesEnAttente);
+    TEST_ASSERT_EQUAL_UINT32(0, apres.nbControlesRetardes);
+    TEST_ASSERT_TRUE(avant.nbControlesRetardes > 0);
+    // Sans attente d'un envoi : au plus un fragment sur l'UART, un aller-retour et une lecture
+    TEST_ASSERT_TRUE(apres.latenceControleMaxMs < scenario.rttMs + scenario.lectureControleMs + 200);
+    TEST_ASSERT_TRUE(avant.latenceControleMaxMs > scenario.periodeEnvoiS * 1000UL);
+    // Les lectures de contrôle prennent l'UART de l'envoi : moins de 2 % de débit en moins
+    TEST_ASSERT_TRUE(apres.debitEnvoiOctetsParS * 100 >= avant.debitEnvoiOctetsParS * 98);
+}
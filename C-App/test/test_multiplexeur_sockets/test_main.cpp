@@ -0,0 +1,28 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_sockets_canaux();
+void test_sockets_ouverture_unique();
+void test_sockets_identification_controle();
+void test_sockets_receive_sans_double_caopen();
+void test_sockets_fermeture_distante();
+void test_sockets_controle_garde_pendant_envoi();
+void test_sockets_benchmark_charge_mixte();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sockets_canaux);
+    RUN_TEST(test_sockets_ouverture_unique);
+    RUN_TEST(test_sockets_identification_controle);
+    RUN_TEST(test_sockets_receive_sans_double_caopen);
+    RUN_TEST(test_sockets_fermeture_distante);
+    RUN_TEST(test_sockets_controle_garde_pendant_envoi);
+    RUN_TEST(test_sockets_benchmark_charge_mixte);
+    UNITY_END();
+}
+
+void loop() {}
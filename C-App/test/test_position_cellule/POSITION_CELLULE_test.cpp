@@ -0,0 +1,342 @@
+#include <unity.h>
+#include "POSITION_CELLULE.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+static const char *CPSI = "\r\n+CPSI: LTE CAT-M1,Online,208-01,0x1A2B,12345678,262,EUTRAN-BAND20,6300,3,3,-10,-95,-65,15\r\n\r\nOK\r\n";
+static const char *CPSI_AUTRE = "\r\n+CPSI: LTE CAT-M1,Online,208-01,0x1A2B,12345679,263,EUTRAN-BAND20,6300,3,3,-10,-95,-65,15\r\n\r\nOK\r\n";
+static const char *CLBS = "\r\n+CLBS: 0,3.048687,50.634412,550,25/06/12,10:15:30\r\n\r\nOK\r\n";
+static const char *CLBS_ECHEC = "\r\n+CLBS: 1\r\n\r\nOK\r\n";
+static const char *CCLK = "\r\n+CCLK: \"25/06/12,12:20:00+08\"\r\n\r\nOK\r\n";
+static const char *CNACT = "\r\n+CNACT: 0,1,\"10.94.12.7\"\r\n\r\nOK\r\n";
+
+extern ATCommandTask taskCLBS;
+
+// Réponse à AT+CLBS lue par la machine d'état (le SIM7080G n'est pas branché sur l'UART des tests)
+static bool repondreClbs(const char *reponse, Gnss &position, unsigned long maintenant)
+{
+    TEST_ASSERT_TRUE(strategiePosition.repliEnCours());
+    taskCLBS.responseBuffer = reponse;
+    taskCLBS.state = END;
+    taskCLBS.isFinished = true;
+    return strategiePosition.poursuivreClbs(position, maintenant);
+}
+
+// Repli sans cellule connue : AT+CLBS lancé, puis sa réponse
+static bool replierParClbs(const char *reponse, Gnss &position, unsigned long maintenant)
+{
+    TEST_ASSERT_FALSE(strategiePosition.positionDeRepli(position, maintenant));
+    return repondreClbs(reponse, position, maintenant);
+}
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    strategiePosition.reinitialiser();
+    strategiePosition.config = ConfigRepli();
+    baseTemps.reinitialiser();
+    sessionReseau.reinitialiser();
+    simulateur.repondre("AT+CNACT?", CNACT);
+    taskCLBS.state = IDLE;
+    taskCLBS.isFinished = false;
+    nbCoordonnees = 0;
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+}
+
+void test_position_parser_cpsi()
+{
+    IdentiteCellule id;
+    TEST_ASSERT_TRUE(parserCPSI(CPSI, id));
+    TEST_ASSERT_EQUAL_UINT32(208001, id.plmn);
+    TEST_ASSERT_EQUAL_UINT32(0x1A2B, id.tac);
+    TEST_ASSERT_EQUAL_UINT32(12345678, id.cellId);
+
+    // Hors service ou réponse absente : pas de cellule
+    TEST_ASSERT_FALSE(parserCPSI("\r\n+CPSI: NO SERVICE,Online\r\n\r\nOK\r\n", id));
+    TEST_ASSERT_FALSE(parserCPSI("\r\n+CPSI: LTE CAT-M1,Offline,208-01,0x1A2B,12345678\r\n", id));
+    TEST_ASSERT_FALSE(parserCPSI("\r\nERROR\r\n", id));
+    TEST_ASSERT_FALSE(id.valide);
+}
+
+void test_position_parser_clbs_et_cclk()
+{
+    int32_t lat, lon;
+    uint32_t precision;
+    String horodatage;
+    TEST_ASSERT_TRUE(parserCLBS(CLBS, lat, lon, precision, horodatage));
+    TEST_ASSERT_EQUAL_INT32(50634412, lat);
+    TEST_ASSERT_EQUAL_INT32(3048687, lon);
+    TEST_ASSERT_EQUAL_UINT32(550, precision);
+    TEST_ASSERT_EQUAL_STRING("20250612101530.000", horodatage.c_str());
+    TEST_ASSERT_FALSE(parserCLBS(CLBS_ECHEC, lat, lon, precision, horodatage));
+    TEST_ASSERT_FALSE(parserCLBS("\r\n+CLBS: 0,0.000000,0.000000,0\r\n", lat, lon, precision, horodatage));
+
+    // Heure locale du modem, fuseau en quarts d'heure : converti en UTC
+    TEST_ASSERT_EQUAL_STRING("20250612102000.000", horodatageDepuisCCLK(CCLK).c_str());
+    TEST_ASSERT_EQUAL_STRING("20250612101530.000", horodatageDepuisCCLK("+CCLK: \"25/06/12,05:15:30-20\"").c_str());
+    TEST_ASSERT_EQUAL_STRING("20250630230000.000", horodatageDepuisCCLK("+CCLK: \"25/07/01,01:00:00+08\"").c_str());
+    TEST_ASSERT_EQUAL_STRING("", horodatageDepuisCCLK("\r\nERROR\r\n").c_str());
+}
+
+void test_position_ttfp_par_source()
+{
+    strategiePosition.debutCycle(1000);
+    strategiePosition.enregistrerPosition(SOURCE_GNSS, 13000);
+    strategiePosition.enregistrerPosition(SOURCE_GNSS, 14000);
+    strategiePosition.finCycle();
+
+    strategiePosition.debutCycle(100000);
+    strategiePosition.enregistrerPosition(SOURCE_GNSS, 108000);
+    strategiePosition.finCycle();
+
+    // Cycle sans aucune position
+    strategiePosition.debutCycle(200000);
+    strategiePosition.finCycle();
+
+    const StatsPosition &s = strategiePosition.stats;
+    TEST_ASSERT_EQUAL_UINT32(3, s.nbCycles);
+    TEST_ASSERT_EQUAL_UINT32(2, s.nbParSource[SOURCE_GNSS]);
+    TEST_ASSERT_EQUAL_UINT32(20000, s.ttfpCumuleMs[SOURCE_GNSS]);
+    TEST_ASSERT_EQUAL_UINT32(8000, s.dernierTtfpMs);
+    TEST_ASSERT_EQUAL_UINT32(1, s.nbSansPosition);
+    TEST_ASSERT_EQUAL_UINT32(0, s.nbReplis);
+}
+
+void test_position_delai_double_sans_fix_gnss()
+{
+    Gnss position;
+
+    strategiePosition.debutCycle(0);
+    TEST_ASSERT_FALSE(strategiePosition.repliNecessaire(89999));
+    TEST_ASSERT_TRUE(strategiePosition.repliNecessaire(90000));
+    TEST_ASSERT_TRUE(replierParClbs(CLBS, position, 90000));
+    TEST_ASSERT_FALSE(strategiePosition.repliNecessaire(120000)); // un seul repli par cycle
+    strategiePosition.finCycle();
+
+    // Chaque cycle terminé par un repli double le délai, jusqu'à delaiMaxMs
+    const unsigned long attendus[] = {180000, 360000, 600000, 600000};
+    for (int i = 0; i < 4; ++i)
+    {
+        TEST_ASSERT_EQUAL_UINT32(attendus[i], strategiePosition.delaiCourantMs());
+        strategiePosition.debutCycle(0);
+        TEST_ASSERT_FALSE(strategiePosition.repliNecessaire(attendus[i] - 1));
+        TEST_ASSERT_TRUE(strategiePosition.repliNecessaire(attendus[i]));
+        replierParClbs(CLBS, position, attendus[i]);
+        strategiePosition.finCycle();
+    }
+
+    // Un fix GNSS ramène le délai à sa valeur de base
+    strategiePosition.debutCycle(0);
+    strategiePosition.enregistrerPosition(SOURCE_GNSS, 30000);
+    TEST_ASSERT_FALSE(strategiePosition.repliNecessaire(700000));
+    strategiePosition.finCycle();
+    TEST_ASSERT_EQUAL_UINT32(90000, strategiePosition.delaiCourantMs());
+    TEST_ASSERT_EQUAL_UINT32(5, strategiePosition.stats.nbParSource[SOURCE_CLBS]);
+
+    // Repli désactivé par le serveur
+    json options = json::parse("{\"actif\": false, \"delaiGnssMs\": 60000}");
+    chargerOptionsRepli(options);
+    strategiePosition.debutCycle(0);
+    TEST_ASSERT_FALSE(strategiePosition.repliNecessaire(600000));
+    TEST_ASSERT_EQUAL_UINT32(60000, strategiePosition.delaiCourantMs());
+}
+
+void test_position_repli_clbs_apprend_la_cellule()
+{
+    simulateur.repondre("AT+CPSI?", CPSI);
+    Gnss position;
+
+    // Cellule inconnue et localisation réseau indisponible : pas de position
+    strategiePosition.debutCycle(0);
+    TEST_ASSERT_FALSE(replierParClbs(CLBS_ECHEC, position, 90000));
+    TEST_ASSERT_FALSE(strategiePosition.repliEnCours());
+    TEST_ASSERT_EQUAL_UINT32(1, strategiePosition.stats.nbEchecsClbs);
+    strategiePosition.finCycle();
+
+    strategiePosition.debutCycle(0);
+    TEST_ASSERT_TRUE(replierParClbs(CLBS, position, 180000));
+    TEST_ASSERT_EQUAL(SOURCE_CLBS, position.source);
+    TEST_ASSERT_EQUAL_UINT32(550, position.precisionM);
+    TEST_ASSERT_TRUE(position.isValid);
+    TEST_ASSERT_EQUAL_STRING("50.634412", position.coordonnees.latitude.full.c_str());
+    TEST_ASSERT_EQUAL_STRING("3.048687", position.coordonnees.longitude.full.c_str());
+    TEST_ASSERT_EQUAL_STRING("20250612101530.000", position.timeStamp.c_str());
+    TEST_ASSERT_EQUAL_UINT32(180000, strategiePosition.stats.dernierTtfpMs);
+
+    // La cellule servante est associée à la position réseau
+    IdentiteCellule id;
+    parserCPSI(CPSI, id);
+    const CelluleConnue *cellule = strategiePosition.chercherCellule(id);
+    TEST_ASSERT_NOT_NULL(cellule);
+    TEST_ASSERT_EQUAL_INT32(50634412, cellule->latE6);
+    TEST_ASSERT_EQUAL_UINT32(550, cellule->precisionM);
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CLBS")); // jamais par Send_AT : la boucle n'attend pas la réponse
+}
+
+// Sans contexte PDP, AT+CLBS échouerait après son délai : il n'est pas lancé
+void test_position_clbs_sans_pdp()
+{
+    simulateur.repondre("AT+CNACT?", "\r\n+CNACT: 0,0,\"0.0.0.0\"\r\n\r\nOK\r\n");
+    Gnss position;
+    strategiePosition.debutCycle(0);
+    TEST_ASSERT_FALSE(strategiePosition.positionDeRepli(position, 90000));
+    TEST_ASSERT_FALSE(strategiePosition.repliEnCours());
+    TEST_ASSERT_EQUAL_UINT32(1, strategiePosition.stats.nbClbsSansPdp);
+
+    // Contexte actif : AT+CLBS lancé, sans réponse après TIMEOUT_CLBS_MS il est abandonné
+    simulateur.repondre("AT+CNACT?", CNACT);
+    strategiePosition.debutCycle(0);
+    TEST_ASSERT_FALSE(strategiePosition.positionDeRepli(position, 90000));
+    TEST_ASSERT_TRUE(strategiePosition.repliEnCours());
+    TEST_ASSERT_FALSE(strategiePosition.poursuivreClbs(position, millis())); // AT+CLBS écrit
+    TEST_ASSERT_FALSE(strategiePosition.poursuivreClbs(position, millis()));
+    TEST_ASSERT_TRUE(strategiePosition.repliEnCours());
+    delay(TIMEOUT_CLBS_MS + 1);
+    for (int i = 0; i < 3 && strategiePosition.repliEnCours(); ++i)
+        strategiePosition.poursuivreClbs(position, millis());
+    TEST_ASSERT_FALSE(strategiePosition.repliEnCours());
+    TEST_ASSERT_EQUAL_UINT32(1, strategiePosition.stats.nbEchecsClbs);
+}
+
+void test_position_cellule_connue_sans_clbs()
+{
+    IdentiteCellule id;
+    parserCPSI(CPSI, id);
+    strategiePosition.apprendreCellule(id, 50630000, 3050000, 1000);
+    simulateur.repondre("AT+CPSI?", CPSI);
+    simulateur.repondre("AT+CCLK?", CCLK);
+
+    Gnss position;
+    strategiePosition.debutCycle(0);
+    TEST_ASSERT_TRUE(strategiePosition.positionDeRepli(position, 90000));
+    TEST_ASSERT_EQUAL(SOURCE_CELLULE, position.source);
+    TEST_ASSERT_EQUAL_UINT32(1000, position.precisionM);
+    TEST_ASSERT_EQUAL_STRING("50.630000", position.coordonnees.latitude.full.c_str());
+    TEST_ASSERT_EQUAL_STRING("20250612102000.000", position.timeStamp.c_str());
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CLBS"));
+    TEST_ASSERT_EQUAL_UINT32(1, strategiePosition.stats.nbCellulesTrouvees);
+    TEST_ASSERT_EQUAL_UINT32(1, strategiePosition.stats.nbParSource[SOURCE_CELLULE]);
+
+    // Autre cellule servante : localisation réseau
+    simulateur.repondre("AT+CPSI?", CPSI_AUTRE);
+    strategiePosition.debutCycle(0);
+    TEST_ASSERT_TRUE(replierParClbs(CLBS, position, 90000));
+    TEST_ASSERT_EQUAL(SOURCE_CLBS, position.source);
+}
+
+void test_position_cache_lru()
+{
+    IdentiteCellule id;
+    id.plmn = 208001;
+    id.tac = 1;
+    id.valide = true;
+    for (uint32_t i = 1; i <= NB_CELLULES_CACHE; ++i)
+    {
+        id.cellId = i;
+        strategiePosition.apprendreCellule(id, (int32_t)i, (int32_t)i, 1000);
+    }
+    // La cellule 1 est relue : la cellule 2 devient la moins récemment utilisée
+    id.cellId = 1;
+    TEST_ASSERT_NOT_NULL(strategiePosition.chercherCellule(id));
+    id.cellId = 100;
+    strategiePosition.apprendreCellule(id, 100, 100, 1000);
+
+    id.cellId = 2;
+    TEST_ASSERT_NULL(strategiePosition.chercherCellule(id));
+    for (uint32_t c : {1u, 3u, 8u, 100u})
+    {
+        id.cellId = c;
+        TEST_ASSERT_NOT_NULL(strategiePosition.chercherCellule(id));
+    }
+
+    // Une cellule déjà connue est mise à jour sur place
+    id.cellId = 3;
+    strategiePosition.apprendreCellule(id, 33, 33, 500);
+    TEST_ASSERT_EQUAL_INT32(33, strategiePosition.chercherCellule(id)->latE6);
+    int occurrences = 0;
+    for (int i = 0; i < NB_CELLULES_CACHE; ++i)
+        occurrences += strategiePosition.cellules[i].cellId == 3;
+    TEST_ASSERT_EQUAL(1, occurrences);
+}
+
+void test_position_memoriser_cellule_apres_fix_gnss()
+{
+    simulateur.repondre("AT+CPSI?", CPSI);
+    Gnss gnss;
+    gnss.coordonnees.latitude = parseGNSS("50.634412");
+    gnss.coordonnees.longitude = parseGNSS("3.048687");
+    gnss.isValid = true;
+    dataGNSS[0].gnss = gnss;
+    nbCoordonnees = 1;
+
+    // Cycle sans fix GNSS : aucune commande
+    strategiePosition.debutCycle(0);
+    memoriserCelluleServante();
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CPSI?"));
+
+    strategiePosition.enregistrerPosition(SOURCE_GNSS, 20000);
+    memoriserCelluleServante();
+    IdentiteCellule id;
+    parserCPSI(CPSI, id);
+    const CelluleConnue *cellule = strategiePosition.chercherCellule(id);
+    TEST_ASSERT_NOT_NULL(cellule);
+    TEST_ASSERT_EQUAL_INT32(50634412, cellule->latE6);
+    TEST_ASSERT_EQUAL_INT32(3048687, cellule->lonE6);
+    TEST_ASSERT_EQUAL_UINT32(1000, cellule->precisionM);
+}
+
+// Cycle complet sans aucun fix GNSS : au bout du délai, une position réseau est ajoutée et l'acquisition se termine
+void test_position_step_gnss_repli_apres_delai()
+{
+    simulateur.repondre("AT+CPSI?", CPSI);
+    fluxGnss = FluxGnss();
+    echantillonneur.reinitialiser();
+    gnssStepState = GNSS_POWER_ON;
+    gnssPowerOnCommand.state = END;
+    step_gnss_function();
+    TEST_ASSERT_EQUAL(GNSS_INFO, gnssStepState);
+
+    // Aucune URC de fix : le GNSS cherche
+    step_gnss_function();
+    delay(30000);
+    step_gnss_function();
+    TEST_ASSERT_EQUAL(GNSS_INFO, gnssStepState);
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CLBS"));
+
+    // Délai écoulé : GNSS éteint avant AT+CLBS, qui partage sa radio
+    delay(61000);
+    step_gnss_function();
+    TEST_ASSERT_EQUAL(GNSS_POWER_OFF, gnssStepState);
+    TEST_ASSERT_TRUE(strategiePosition.repliEnCours());
+    TEST_ASSERT_EQUAL(0, nbCoordonnees);
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CGNSURC=0"));
+    gnssPowerOffCommand.state = END;
+    step_gnss_function();
+    TEST_ASSERT_EQUAL(GNSS_REPLI_RESEAU, gnssStepState);
+
+    // Réponse attendue sans bloquer la boucle
+    step_gnss_function();
+    step_gnss_function();
+    TEST_ASSERT_EQUAL(GNSS_REPLI_RESEAU, gnssStepState);
+    taskCLBS.responseBuffer = CLBS;
+    taskCLBS.state = END;
+    step_gnss_function();
+    TEST_ASSERT_EQUAL(1, nbCoordonnees);
+    TEST_ASSERT_EQUAL(SOURCE_CLBS, dataGNSS[0].gnss.source);
+    TEST_ASSERT_EQUAL(GNSS_DONE, gnssStepState);
+    TEST_ASSERT_EQUAL_UINT32(180000, strategiePosition.delaiCourantMs());
+
+    // Le point porte sa source et sa précision dans le message
+    imei = "123456789012345";
+    step_compose_json_function();
+    TEST_ASSERT_TRUE(tableauJSONString.indexOf("\"source\":\"clbs\",\"precision\":550") != -1);
+    TEST_ASSERT_EQUAL_UINT32(1, strategiePosition.stats.nbParSource[SOURCE_CLBS]);
+    TEST_ASSERT_TRUE(strategiePosition.stats.dernierTtfpMs >= 90000);
+}
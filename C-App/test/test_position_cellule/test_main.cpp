@@ -0,0 +1,34 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_position_parser_cpsi();
+void test_position_parser_clbs_et_cclk();
+void test_position_ttfp_par_source();
+void test_position_delai_double_sans_fix_gnss();
+void test_position_repli_clbs_apprend_la_cellule();
+void test_position_clbs_sans_pdp();
+void test_position_cellule_connue_sans_clbs();
+void test_position_cache_lru();
+void test_position_memoriser_cellule_apres_fix_gnss();
+void test_position_step_gnss_repli_apres_delai();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_position_parser_cpsi);
+    RUN_TEST(test_position_parser_clbs_et_cclk);
+    RUN_TEST(test_position_ttfp_par_source);
+    RUN_TEST(test_position_delai_double_sans_fix_gnss);
+    RUN_TEST(test_position_repli_clbs_apprend_la_cellule);
+    RUN_TEST(test_position_clbs_sans_pdp);
+    RUN_TEST(test_position_cellule_connue_sans_clbs);
+    RUN_TEST(test_position_cache_lru);
+    RUN_TEST(test_position_memoriser_cellule_apres_fix_gnss);
+    RUN_TEST(test_position_step_gnss_repli_apres_delai);
+    UNITY_END();
+}
+
+void loop() {}
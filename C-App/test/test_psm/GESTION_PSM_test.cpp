@@ -0,0 +1,134 @@
+#include <unity.h>
+#include "GESTION_PSM.hpp"
+#include "SESSION_RESEAU.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    gestionPSM = GestionPSM();
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+}
+
+void test_psm_codage_timers()
+{
+    // 30 min = 30 x 1 min (plus petite unité possible)
+    TEST_ASSERT_EQUAL_STRING("10111110", encoderT3412(1800).c_str());
+    TEST_ASSERT_EQUAL(1800, decoderT3412("10111110"));
+    // 3 h = 18 x 10 min
+    TEST_ASSERT_EQUAL_STRING("00010010", encoderT3412(10800).c_str());
+    // 10 s = 5 x 2 s
+    TEST_ASSERT_EQUAL_STRING("00000101", encoderT3324(10).c_str());
+    TEST_ASSERT_EQUAL(10, decoderT3324("00000101"));
+    // Arrondi supérieur : 100 s -> 2 min
+    TEST_ASSERT_EQUAL(120, decoderT3324(encoderT3324(100)));
+    // Timer désactivé
+    TEST_ASSERT_EQUAL(0, decoderT3324("11100000"));
+    // eDRX : plus long cycle <= 15 s
+    TEST_ASSERT_EQUAL_STRING("0001", encoderCycleEdrx(15000).c_str());
+    TEST_ASSERT_EQUAL(10240, decoderCycleEdrx("0001"));
+}
+
+void test_psm_config_selon_periode()
+{
+    ConfigPSM courte = calculerConfigPSM(10000);
+    TEST_ASSERT_EQUAL(ECONOMIE_AUCUNE, courte.mode);
+
+    ConfigPSM moyenne = calculerConfigPSM(30000);
+    TEST_ASSERT_EQUAL(ECONOMIE_EDRX, moyenne.mode);
+    TEST_ASSERT_TRUE(moyenne.edrxMs <= 15000);
+
+    ConfigPSM longue = calculerConfigPSM(600000);
+    TEST_ASSERT_EQUAL(ECONOMIE_PSM, longue.mode);
+    TEST_ASSERT_TRUE(longue.tauS >= 3 * 600);
+    TEST_ASSERT_EQUAL(10, longue.actifS);
+}
+
+// Le réseau accorde d'autres valeurs que celles demandées : ce sont elles qui doivent être retenues
+void test_psm_negociation_valeurs_accordees()
+{
+    simulateur.repondre("AT+CEREG?", "\r\n+CEREG: 4,5,\"1A2B\",\"01A2B3C4\",7,,,\"00000110\",\"00100110\"\r\n\r\nOK\r\n");
+
+    negocierPSM(calculerConfigPSM(600000));
+
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CPSMS=1,,,\""));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CEDRXS=0"));
+    // Le format +CEREG attendu par le pipeline est rétabli : URC pour le suivi de session (SESSION_RESEAU)
+    TEST_ASSERT_EQUAL_STRING("AT+CEREG=1", simulateur.commandes.back().c_str());
+    TEST_ASSERT_TRUE(gestionPSM.accorde.psmAccorde);
+    TEST_ASSERT_EQUAL(12, gestionPSM.accorde.actifS);
+    TEST_ASSERT_EQUAL(6 * 3600, gestionPSM.accorde.tauS);
+
+    // Sans suivi de session, STEP_VERIFIER_CONNEXION attend "+CEREG: 0,5"
+    sessionReseau.config.actif = false;
+    negocierPSM(calculerConfigPSM(600000));
+    TEST_ASSERT_EQUAL_STRING("AT+CEREG=0", simulateur.commandes.back().c_str());
+    sessionReseau.config = ConfigSessionReseau();
+}
+
+void test_psm_negociation_edrx()
+{
+    simulateur.repondre("AT+CEREG?", "\r\n+CEREG: 4,5,\"1A2B\",\"01A2B3C4\",7\r\n\r\nOK\r\n");
+    simulateur.repondre("AT+CEDRXRDP", "\r\n+CEDRXRDP: 4,\"0001\",\"0010\",\"0011\"\r\n\r\nOK\r\n");
+
+    negocierPSM(calculerConfigPSM(30000));
+
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CPSMS=0"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CEDRXS=1,4,\"0001\""));
+    TEST_ASSERT_FALSE(gestionPSM.accorde.psmAccorde);
+    TEST_ASSERT_TRUE(gestionPSM.accorde.edrxAccorde);
+    TEST_ASSERT_EQUAL(20480, gestionPSM.accorde.edrxMs);
+    TEST_ASSERT_EQUAL(4 * 1280, gestionPSM.accorde.ptwMs);
+}
+
+void test_psm_planification_sommeil()
+{
+    // Écart trop court : pas de sommeil
+    TEST_ASSERT_EQUAL(SOMMEIL_AUCUN, planifierSommeil(10000, 10500).mode);
+
+    // Échantillon GNSS dans 3 s : light sleep jusqu'à la marge de réveil
+    PlanSommeil gnss = planifierSommeil(10000, 13000);
+    TEST_ASSERT_EQUAL(SOMMEIL_LEGER, gnss.mode);
+    TEST_ASSERT_EQUAL(3000 - gestionPSM.margeReveilMs, gnss.dureeMs);
+
+    // Envoi dans 10 min, PSM non accordé : light sleep seulement
+    gestionPSM.deepSleepAutorise = true;
+    TEST_ASSERT_EQUAL(SOMMEIL_LEGER, planifierSommeil(0, 600000).mode);
+
+    // PSM accordé : deep sleep en phase avec le modem
+    gestionPSM.accorde.psmAccorde = true;
+    TEST_ASSERT_EQUAL(SOMMEIL_PROFOND, planifierSommeil(0, 600000).mode);
+
+    // Deep sleep interdit : retour au light sleep
+    gestionPSM.deepSleepAutorise = false;
+    TEST_ASSERT_EQUAL(SOMMEIL_LEGER, planifierSommeil(0, 600000).mode);
+
+    // Réveil déjà dépassé
+    TEST_ASSERT_EQUAL(SOMMEIL_AUCUN, planifierSommeil(700000, 600000).mode);
+}
+
+// Client MQTT abonné : pas de light sleep (caractères perdus au réveil), attente avec l'UART active
+void test_psm_veille_uart()
+{
+    PlanSommeil plan;
+    plan.mode = SOMMEIL_LEGER;
+    plan.dureeMs = 50;
+    gestionPSM.veilleUart = true;
+    unsigned long debut = millis();
+    appliquerSommeil(plan);
+    TEST_ASSERT_TRUE(millis() - debut >= 50);
+    TEST_ASSERT_EQUAL_UINT32(1, gestionPSM.nbVeillesUart);
+    TEST_ASSERT_EQUAL_UINT32(0, gestionPSM.nbSommeilsLegers);
+    TEST_ASSERT_FALSE(gestionPSM.reveilModem);
+
+    gestionPSM.veilleUart = false;
+    appliquerSommeil(plan);
+    TEST_ASSERT_EQUAL_UINT32(1, gestionPSM.nbSommeilsLegers);
+}
@@ -0,0 +1,26 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_psm_codage_timers();
+void test_psm_config_selon_periode();
+void test_psm_negociation_valeurs_accordees();
+void test_psm_negociation_edrx();
+void test_psm_planification_sommeil();
+void test_psm_veille_uart();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_psm_codage_timers);
+    RUN_TEST(test_psm_config_selon_periode);
+    RUN_TEST(test_psm_negociation_valeurs_accordees);
+    RUN_TEST(test_psm_negociation_edrx);
+    RUN_TEST(test_psm_planification_sommeil);
+    RUN_TEST(test_psm_veille_uart);
+    UNITY_END();
+}
+
+void loop() {}
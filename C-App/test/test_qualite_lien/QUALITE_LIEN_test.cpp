@@ -0,0 +1,201 @@
+#include <unity.h>
+#include "QUALITE_LIEN.hpp"
+#include "ARBITRE_RADIO.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+static const char *CPSI_BON = "\r\n+CPSI: LTE CAT-M1,Online,208-01,0x1A2B,12345678,262,EUTRAN-BAND20,6300,3,3,-10,-95,-65,15\r\n\r\nOK\r\n";
+static const char *CPSI_FAIBLE = "\r\n+CPSI: LTE CAT-M1,Online,208-01,0x1A2B,12345678,262,EUTRAN-BAND20,6300,3,3,-18,-121,-92,-3\r\n\r\nOK\r\n";
+static const char *CPSI_HORS_SERVICE = "\r\n+CPSI: NO SERVICE,Online\r\n\r\nOK\r\n";
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    qualiteLien.reinitialiser();
+    qualiteLien.config = ConfigQualiteLien();
+    arbitreRadio.reinitialiser();
+    arbitreRadio.config = ConfigArbitre();
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+}
+
+static MesureLien mesureRsrp(int16_t rsrpDbm)
+{
+    MesureLien m;
+    m.rsrpDbm = rsrpDbm;
+    m.valide = true;
+    return m;
+}
+
+void test_lien_parser_cpsi_csq()
+{
+    MesureLien m;
+    TEST_ASSERT_TRUE(parserQualiteCPSI(CPSI_BON, m));
+    TEST_ASSERT_EQUAL_INT(-10, m.rsrqDb);
+    TEST_ASSERT_EQUAL_INT(-95, m.rsrpDbm);
+    TEST_ASSERT_EQUAL_INT(-65, m.rssiDbm);
+    TEST_ASSERT_EQUAL_INT(15, m.snrDb);
+    TEST_ASSERT_TRUE(parserQualiteCPSI(CPSI_FAIBLE, m));
+    TEST_ASSERT_EQUAL_INT(-121, m.rsrpDbm);
+    TEST_ASSERT_EQUAL_INT(-3, m.snrDb);
+    TEST_ASSERT_FALSE(parserQualiteCPSI(CPSI_HORS_SERVICE, m));
+    TEST_ASSERT_FALSE(m.valide);
+    TEST_ASSERT_FALSE(parserQualiteCPSI("\r\n+CPSI: LTE CAT-M1,Online,208-01,0x1A2B,12345678\r\n", m));
+    TEST_ASSERT_FALSE(parserQualiteCPSI("", m));
+
+    TEST_ASSERT_TRUE(parserCSQ("\r\n+CSQ: 20,99\r\n\r\nOK\r\n", m));
+    TEST_ASSERT_EQUAL_INT(-73, m.rssiDbm);
+    TEST_ASSERT_EQUAL_INT(-92, m.rsrpDbm);
+    TEST_ASSERT_FALSE(parserCSQ("\r\n+CSQ: 99,99\r\n\r\nOK\r\n", m)); // niveau inconnu
+    TEST_ASSERT_FALSE(parserCSQ("\r\nERROR\r\n", m));
+
+    TEST_ASSERT_EQUAL_UINT16(1, repetitionsCE(-95));
+    TEST_ASSERT_EQUAL_UINT16(32, repetitionsCE(-118));
+}
+
+void test_lien_niveau_hysteresis_et_validite()
+{
+    QualiteLien &q = qualiteLien;
+    TEST_ASSERT_EQUAL(LIEN_INCONNU, q.niveau(1000));
+
+    q.noter(mesureRsrp(-95), 1000);
+    TEST_ASSERT_EQUAL(LIEN_BON, q.niveau(1000));
+    q.noter(mesureRsrp(-108), 2000);
+    TEST_ASSERT_EQUAL(LIEN_MOYEN, q.niveau(2000));
+    q.noter(mesureRsrp(-118), 3000);
+    TEST_ASSERT_EQUAL(LIEN_FAIBLE, q.niveau(3000));
+    // Hystérésis : -113 dBm ne suffit pas à sortir du lien faible, -110 dBm oui
+    q.noter(mesureRsrp(-113), 4000);
+    TEST_ASSERT_EQUAL(LIEN_FAIBLE, q.niveau(4000));
+    q.noter(mesureRsrp(-110), 5000);
+    TEST_ASSERT_EQUAL(LIEN_MOYEN, q.niveau(5000));
+    q.noter(mesureRsrp(-113), 6000);
+    TEST_ASSERT_EQUAL(LIEN_MOYEN, q.niveau(6000));
+
+    // Mesure expirée : niveau inconnu
+    TEST_ASSERT_EQUAL(LIEN_MOYEN, q.niveau(6000 + q.config.validiteMs));
+    TEST_ASSERT_EQUAL(LIEN_INCONNU, q.niveau(6001 + q.config.validiteMs));
+
+    // Comportement historique
+    json options = json::parse("{\"actif\": false}");
+    chargerOptionsQualiteLien(options);
+    TEST_ASSERT_EQUAL(LIEN_INCONNU, q.niveau(6000));
+    TEST_ASSERT_FALSE(q.observer(CPSI_BON, 7000));
+}
+
+void test_lien_mesure_seulement_si_expiree()
+{
+    QualiteLien &q = qualiteLien;
+    simulateur.repondre("AT+CPSI?", CPSI_FAIBLE);
+    TEST_ASSERT_EQUAL(LIEN_FAIBLE, q.mesurer(1000));
+    TEST_ASSERT_EQUAL(LIEN_FAIBLE, q.mesurer(60000)); // mesure encore valide : pas de requête
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CPSI?"));
+
+    // La réponse à AT+CPSI? du repli réseau sert aussi de mesure
+    simulateur.repondre("AT+CPSI?", CPSI_BON);
+    lireCelluleServante();
+    TEST_ASSERT_EQUAL_INT(-95, q.derniereMesure().rsrpDbm);
+    TEST_ASSERT_EQUAL(LIEN_BON, q.niveau(millis()));
+
+    // Réponse illisible : niveau inconnu, l'envoi n'est pas bloqué
+    q.reinitialiser();
+    simulateur.repondre("AT+CPSI?", "\r\nERROR\r\n");
+    TEST_ASSERT_EQUAL(LIEN_INCONNU, q.mesurer(millis()));
+    TEST_ASSERT_EQUAL_UINT32(1, q.stats.nbRequetes);
+    TEST_ASSERT_EQUAL_UINT32(0, q.stats.nbMesures);
+}
+
+void test_lien_arbitre_differe_sur_lien_faible()
+{
+    ArbitreRadio &a = arbitreRadio;
+    a.ouvrirFenetreLte(1000, 0);
+
+    // Lot prêt : envoi sur un lien bon, moyen ou inconnu ; différé sur un lien faible
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(true, false, 20000, 30000, 40000, LIEN_BON));
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(true, false, 20000, 30000, 40000, LIEN_MOYEN));
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(true, false, 20000, 30000, 40000, LIEN_INCONNU));
+    TEST_ASSERT_EQUAL(RADIO_MAINTENIR_GNSS, a.decider(true, false, 20000, 30000, 40000, LIEN_FAIBLE));
+    // Aucune fenêtre depuis intervalleLteMaxMs : différé aussi
+    TEST_ASSERT_EQUAL(RADIO_MAINTENIR_GNSS, a.decider(false, false, 20000, 30000, 1000 + 870000, LIEN_FAIBLE));
+    TEST_ASSERT_EQUAL_UINT32(2, a.stats.nbReportsLienFaible);
+
+    // Un événement de géofence et la latence maximale passent avant la qualité du lien
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(true, true, 20000, 30000, 40000, LIEN_FAIBLE));
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(true, false, 260001, 30000, 40000, LIEN_FAIBLE));
+    TEST_ASSERT_EQUAL_UINT32(2, a.stats.nbReportsLienFaible);
+
+    // Première fenêtre après le démarrage
+    a.reinitialiser();
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(true, false, 0, 30000, 1000, LIEN_FAIBLE));
+
+    // Comportement historique de l'arbitre : envoi à chaque cycle
+    a.config.actif = false;
+    a.ouvrirFenetreLte(1000, 0);
+    TEST_ASSERT_EQUAL(RADIO_FENETRE_LTE, a.decider(false, false, 0, 30000, 40000, LIEN_FAIBLE));
+}
+
+void test_lien_enregistrement_par_envoi()
+{
+    QualiteLien &q = qualiteLien;
+    q.enregistrerEnvoi(200, 1000); // aucune mesure
+    q.noter(mesureRsrp(-95), 2000);
+    q.enregistrerEnvoi(300, 2000);
+    q.noter(mesureRsrp(-121), 3000);
+    q.enregistrerEnvoi(500, 3000);
+    q.enregistrerEnvoi(100, 3000);
+
+    const StatsQualiteLien &s = q.stats;
+    TEST_ASSERT_EQUAL_UINT32(1, s.nbEnvois[LIEN_INCONNU]);
+    TEST_ASSERT_EQUAL_UINT32(1, s.nbEnvois[LIEN_BON]);
+    TEST_ASSERT_EQUAL_UINT32(2, s.nbEnvois[LIEN_FAIBLE]);
+    TEST_ASSERT_EQUAL_UINT32(600, (uint32_t)s.octetsEnvoyes[LIEN_FAIBLE]);
+    TEST_ASSERT_EQUAL_UINT32(3, s.nbEnvoisMesures);
+    TEST_ASSERT_EQUAL_INT32(-95 - 121 - 121, s.rsrpCumuleDbm);
+    TEST_ASSERT_EQUAL_INT(-121, s.rsrpMinDbm);
+
+    // Mesure relevée par AT+CSQ pendant la configuration
+    TEST_ASSERT_TRUE(q.observer("\r\n+CSQ: 5,99\r\n\r\nOK\r\n", 4000));
+    TEST_ASSERT_EQUAL(LIEN_FAIBLE, q.niveau(4000)); // -103 dBm de RSSI, environ -122 dBm de RSRP
+}
+
+void test_lien_benchmark_energie_par_octet()
+{
+    // Trajet alternant 20 min de bonne couverture et 10 min de couverture faible (sous-sol, zone rurale)
+    ScenarioRadio scenario;
+    scenario.lienBonS = 1200;
+    scenario.lienFaibleS = 600;
+    ConfigArbitre arbitre;
+    ConfigQualiteLien sansQualite;
+    sansQualite.actif = false;
+    ConfigQualiteLien avecQualite;
+
+    RapportRadio avant = simulerOrdonnancement(scenario, arbitre, sansQualite);
+    RapportRadio apres = simulerOrdonnancement(scenario, arbitre, avecQualite);
+
+    char message[200];
+    const RapportRadio *rapports[] = {&avant, &apres};
+    const char *noms[] = {"Sans qualite", "Avec qualite"};
+    for (int i = 0; i < 2; ++i)
+    {
+        snprintf(message, sizeof(message), "%s : %.1f fenetres LTE/h, %lu envois sur lien faible, %lu octets, antenne %.3f ms/octet, LTE %.4f uAh/octet, latence max %lu s, %lu points livres, %lu decimes",
+                 noms[i], rapports[i]->fenetresLteParHeure, (unsigned long)rapports[i]->nbEnvoisLienFaible, (unsigned long)rapports[i]->octetsEnvoyes,
+                 rapports[i]->tempsAntenneMsParOctet, rapports[i]->energie_uAhParOctet, (unsigned long)rapports[i]->latenceMaxS,
+                 (unsigned long)rapports[i]->nbPointsLivres, (unsigned long)rapports[i]->nbPointsDecimes);
+        TEST_MESSAGE(message);
+    }
+
+    // Moins d'envois sous couverture faible, moins d'antenne et d'énergie par octet, latence toujours bornée
+    // (une mesure expirée laisse repartir un envoi, qui sert de nouvelle mesure)
+    TEST_ASSERT_TRUE(apres.nbEnvoisLienFaible * 3 < avant.nbEnvoisLienFaible * 2);
+    TEST_ASSERT_TRUE(apres.tempsAntenneMsParOctet * 5 < avant.tempsAntenneMsParOctet * 4);
+    TEST_ASSERT_TRUE(apres.energie_uAhParOctet < avant.energie_uAhParOctet);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(arbitre.latenceMaxMs / 1000, apres.latenceMaxS);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, apres.nbPointsLivres);
+}
@@ -0,0 +1,26 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_lien_parser_cpsi_csq();
+void test_lien_niveau_hysteresis_et_validite();
+void test_lien_mesure_seulement_si_expiree();
+void test_lien_arbitre_differe_sur_lien_faible();
+void test_lien_enregistrement_par_envoi();
+void test_lien_benchmark_energie_par_octet();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_lien_parser_cpsi_csq);
+    RUN_TEST(test_lien_niveau_hysteresis_et_validite);
+    RUN_TEST(test_lien_mesure_seulement_si_expiree);
+    RUN_TEST(test_lien_arbitre_differe_sur_lien_faible);
+    RUN_TEST(test_lien_enregistrement_par_envoi);
+    RUN_TEST(test_lien_benchmark_energie_par_octet);
+    UNITY_END();
+}
+
+void loop() {}
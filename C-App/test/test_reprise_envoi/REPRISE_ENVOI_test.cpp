@@ -0,0 +1,246 @@
+#include <unity.h>
+#include "REPRISE_ENVOI.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+extern ATCommandTask taskCBOR_OPEN_CONNEXION;
+
+static const char *MESSAGE = "[{\"lat\":50.63,\"lon\":3.06}]";
+
+// Lot composé et encodé, envoi en cours sur le socket de l'envoi
+static void preparerEnvoi()
+{
+    tableauJSONString = MESSAGE;
+    currentStepGLOBAL = STEP_SEND_4G;
+    endCBOR = true;
+    PERIODE_CBOR = millis() - 1000;
+    STEP_INIT_CBOR_FUNCTION(tableauJSONString.c_str());
+    multiplexeurSockets.marquer(CANAL_ENVOI, true);
+    currentStepCBOR = STEP_DEFINE_BYTE;
+}
+
+static void echouer()
+{
+    taskCBOR_CASEND->onErrorCallback(*taskCBOR_CASEND);
+}
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    repriseEnvoi.config = ConfigReprise();
+    repriseEnvoi.reinitialiser();
+    multiplexeurSockets.reinitialiser();
+    multiplexeurSockets.config = ConfigSockets();
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+    repriseEnvoi.config = ConfigReprise();
+    repriseEnvoi.reinitialiser();
+    multiplexeurSockets.reinitialiser();
+    currentStepCBOR = STEP_INIT_CBOR;
+    currentStepGLOBAL = STEP_INIT_GLOBAL;
+    cborDataPipeline.clear();
+    tableauJSONString = "";
+}
+
+// AT+CASEND en échec : message gardé, socket de l'envoi fermé, retour à la vérification de la connexion
+void test_reprise_garde_le_lot()
+{
+    preparerEnvoi();
+    std::vector<uint8_t> encode = cborDataPipeline;
+    taskCBOR_CASEND->state = ERROR;
+    taskCBOR_CASEND->isFinished = true;
+    echouer();
+
+    TEST_ASSERT_EQUAL(STEP_VERIFIER_CONNEXION, currentStepCBOR);
+    TEST_ASSERT_EQUAL(STEP_SEND_4G, currentStepGLOBAL);
+    TEST_ASSERT_TRUE(endCBOR);
+    TEST_ASSERT_EQUAL_STRING(MESSAGE, tableauJSONString.c_str());
+    TEST_ASSERT_TRUE(encode == cborDataPipeline);
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CACLOSE=0"));
+    TEST_ASSERT_FALSE(multiplexeurSockets.estOuvert(CANAL_ENVOI));
+    TEST_ASSERT_EQUAL(IDLE, taskCBOR_CASEND->state); // AT+CASEND renvoyé par STEP_DEFINE_BYTE
+    TEST_ASSERT_FALSE(taskCBOR_CASEND->isFinished);
+    TEST_ASSERT_EQUAL(1, repriseEnvoi.echecsConsecutifs());
+    TEST_ASSERT_EQUAL_UINT32(1, repriseEnvoi.stats.nbReprises);
+}
+
+// Pas de commande pendant le délai de reprise, doublé à chaque échec du même lot
+void test_reprise_delai()
+{
+    preparerEnvoi();
+    unsigned long t = millis();
+    TEST_ASSERT_EQUAL(SUITE_REPRENDRE, repriseEnvoi.echec(t));
+    TEST_ASSERT_TRUE(repriseEnvoi.enAttente(t + repriseEnvoi.config.delaiRepriseMs - 1));
+    TEST_ASSERT_FALSE(repriseEnvoi.enAttente(t + repriseEnvoi.config.delaiRepriseMs));
+    TEST_ASSERT_EQUAL(SUITE_REPRENDRE, repriseEnvoi.echec(t));
+    TEST_ASSERT_TRUE(repriseEnvoi.enAttente(t + 2 * repriseEnvoi.config.delaiRepriseMs - 1));
+    TEST_ASSERT_FALSE(repriseEnvoi.enAttente(t + 2 * repriseEnvoi.config.delaiRepriseMs));
+
+    currentStepCBOR = STEP_VERIFIER_CONNEXION;
+    simulateur.commandes.clear();
+    STEP_VERIFIER_CONNEXION_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_VERIFIER_CONNEXION, currentStepCBOR);
+    TEST_ASSERT_EQUAL(0, (int)simulateur.commandes.size());
+
+    // Plafond : config.delaiMaxMs
+    repriseEnvoi.config.tentativesMax = 20;
+    for (int i = 0; i < 10; ++i)
+        repriseEnvoi.echec(t);
+    TEST_ASSERT_FALSE(repriseEnvoi.enAttente(t + repriseEnvoi.config.delaiMaxMs));
+}
+
+// Après tentativesMax reprises sans succès : pipeline global relancé, le lot repart de l'encodage au cycle suivant
+void test_reprise_escalade()
+{
+    preparerEnvoi();
+    for (int i = 0; i < repriseEnvoi.config.tentativesMax; ++i)
+    {
+        echouer();
+        TEST_ASSERT_EQUAL(STEP_VERIFIER_CONNEXION, currentStepCBOR);
+        TEST_ASSERT_EQUAL(STEP_SEND_4G, currentStepGLOBAL);
+    }
+    echouer();
+    TEST_ASSERT_EQUAL(STEP_INIT_GLOBAL, currentStepGLOBAL);
+    TEST_ASSERT_EQUAL(STEP_INIT_CBOR, currentStepCBOR);
+    TEST_ASSERT_TRUE(endCBOR);
+    TEST_ASSERT_EQUAL(0, (int)tableauJSONString.length());
+    TEST_ASSERT_EQUAL(0, (int)cborDataPipeline.size());
+    TEST_ASSERT_EQUAL_UINT32(1, repriseEnvoi.stats.nbEscalades);
+    TEST_ASSERT_EQUAL(0, repriseEnvoi.echecsConsecutifs());
+}
+
+// Reprise désactivée : pipeline global relancé dès le premier échec (comportement précédent)
+void test_reprise_inactive()
+{
+    chargerOptionsReprise({{"actif", false}});
+    preparerEnvoi();
+    echouer();
+    TEST_ASSERT_EQUAL(STEP_INIT_GLOBAL, currentStepGLOBAL);
+    TEST_ASSERT_EQUAL(0, (int)tableauJSONString.length());
+    TEST_ASSERT_EQUAL_UINT32(0, repriseEnvoi.stats.nbReprises);
+
+    chargerOptionsReprise({{"actif", true}, {"tentativesMax", 5}, {"delaiRepriseMs", 500}, {"delaiMaxMs", 4000}});
+    TEST_ASSERT_TRUE(repriseEnvoi.config.actif);
+    TEST_ASSERT_EQUAL(5, repriseEnvoi.config.tentativesMax);
+    TEST_ASSERT_EQUAL_UINT32(500, repriseEnvoi.config.delaiRepriseMs);
+    TEST_ASSERT_EQUAL_UINT32(4000, repriseEnvoi.config.delaiMaxMs);
+
+    // tentativesMax borné au lieu d'être tronqué sur 8 bits (256 -> 0)
+    chargerOptionsReprise({{"tentativesMax", 256}});
+    TEST_ASSERT_EQUAL(TENTATIVES_MAX_REPRISE, repriseEnvoi.config.tentativesMax);
+    chargerOptionsReprise({{"tentativesMax", -1}});
+    TEST_ASSERT_EQUAL(0, repriseEnvoi.config.tentativesMax);
+}
+
+// AT+CAOPEN sans réponse après toutes ses tentatives : pas de AT+CASEND sur un socket fermé
+void test_reprise_ouverture_echouee()
+{
+    preparerEnvoi();
+    currentStepCBOR = STEP_OPEN_CONNEXION;
+    multiplexeurSockets.marquer(CANAL_ENVOI, false);
+    taskCBOR_OPEN_CONNEXION.state = ERROR;
+    taskCBOR_OPEN_CONNEXION.isFinished = true;
+    PERIODE_CBOR = millis() - 1000;
+    STEP_OPEN_CONNEXION_FUNCTION();
+
+    TEST_ASSERT_EQUAL(STEP_VERIFIER_CONNEXION, currentStepCBOR);
+    TEST_ASSERT_EQUAL(STEP_SEND_4G, currentStepGLOBAL);
+    TEST_ASSERT_FALSE(multiplexeurSockets.estOuvert(CANAL_ENVOI));
+    TEST_ASSERT_EQUAL(IDLE, taskCBOR_OPEN_CONNEXION.state);
+    TEST_ASSERT_FALSE(taskCBOR_OPEN_CONNEXION.isFinished);
+    TEST_ASSERT_EQUAL(1, repriseEnvoi.echecsConsecutifs());
+}
+
+// Pas de réponse du serveur, ou lot refusé : l'envoi n'est pas compté comme livré, il est repris
+void test_reprise_sans_reponse()
+{
+    ecouteDescendante.config.actif = false;
+    preparerEnvoi();
+    for (int essai = 0; essai < 3; ++essai)
+    {
+        if (essai == 1)
+            simulateur.repondre("AT+CARECV=0", "\r\n+CARECV: 25,Decoding or format error\n\r\n\r\nOK\r\n");
+        if (essai == 2)
+            simulateur.repondre("AT+CARECV=0", "\r\n+CARECV: 25,Batch received and saved\n\r\n\r\nOK\r\n");
+        multiplexeurSockets.marquer(CANAL_ENVOI, true);
+        stepReceiveFunctionBoolean = true;
+        currentStepCBOR = STEP_RECEIVE;
+        for (int i = 0; i < 200 && currentStepCBOR == STEP_RECEIVE; ++i)
+        {
+            STEP_RECEIVE_FUNCTION();
+            delay(100);
+        }
+        if (essai < 2)
+        {
+            TEST_ASSERT_EQUAL(STEP_VERIFIER_CONNEXION, currentStepCBOR);
+            TEST_ASSERT_EQUAL(essai + 1, repriseEnvoi.echecsConsecutifs());
+            TEST_ASSERT_TRUE(stepReceiveFunctionBoolean);
+        }
+    }
+    TEST_ASSERT_EQUAL(STEP_CLOSE_CONNEXION, currentStepCBOR);
+    TEST_ASSERT_EQUAL(2, repriseEnvoi.echecsConsecutifs());
+    TEST_ASSERT_EQUAL_STRING(MESSAGE, tableauJSONString.c_str());
+    ecouteDescendante.config = ConfigEcoute();
+}
+
+// Lot livré après une reprise : compte remis à zéro, délai depuis le premier échec mesuré
+void test_reprise_livraison()
+{
+    preparerEnvoi();
+    echouer();
+    delay(3000);
+    currentStepCBOR = STEP_END;
+    STEP_END_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_INIT_CBOR, currentStepCBOR);
+    TEST_ASSERT_EQUAL(0, repriseEnvoi.echecsConsecutifs());
+    TEST_ASSERT_EQUAL_UINT32(1, repriseEnvoi.stats.nbLivresApresReprise);
+    TEST_ASSERT_TRUE(repriseEnvoi.stats.delaiLivraisonMaxMs >= 3000);
+    TEST_ASSERT_FALSE(repriseEnvoi.enAttente(millis()));
+}
+
+// Banc d'essai : échecs injectés par intermittence, délai de livraison et fixes gardés avec et sans reprise
+void test_reprise_benchmark_echecs()
+{
+    ScenarioReprise scenario;
+    ConfigReprise historique;
+    historique.actif = false;
+    ConfigReprise reprise;
+    char message[220];
+
+    const uint8_t taux[3] = {10, 30, 50};
+    for (uint8_t taux : taux)
+    {
+        scenario.tauxEchecPct = taux;
+        RapportReprise r[2] = {simulerReprise(scenario, historique), simulerReprise(scenario, reprise)};
+        const char *noms[2] = {"relance globale", "reprise"};
+        for (int i = 0; i < 2; ++i)
+        {
+            snprintf(message, sizeof(message),
+                     "%u%% d'echecs, %s : %lu fixes, %lu livres, %lu perdus (%.1f%% gardes), delai moyen %lu ms, max %lu ms, %lu fenetres GNSS, %lu escalades",
+                     taux, noms[i], (unsigned long)r[i].nbFixes, (unsigned long)r[i].nbLivres, (unsigned long)r[i].nbPerdus,
+                     100.0f * r[i].donneesGardees, (unsigned long)r[i].delaiLivraisonMoyenMs, (unsigned long)r[i].delaiLivraisonMaxMs,
+                     (unsigned long)r[i].nbFenetresGnss, (unsigned long)r[i].nbEscalades);
+            TEST_MESSAGE(message);
+        }
+        TEST_ASSERT_TRUE(r[0].nbPerdus > 0);
+        TEST_ASSERT_TRUE(r[1].nbPerdus * 4 < r[0].nbPerdus);
+        TEST_ASSERT_TRUE(r[1].donneesGardees > r[0].donneesGardees);
+        TEST_ASSERT_TRUE(r[1].delaiLivraisonMoyenMs < r[0].delaiLivraisonMoyenMs);
+        TEST_ASSERT_TRUE(r[1].nbEscalades < r[0].nbEscalades);
+    }
+
+    // Sans échec, les deux stratégies sont identiques
+    scenario.tauxEchecPct = 0;
+    RapportReprise a = simulerReprise(scenario, historique);
+    RapportReprise b = simulerReprise(scenario, reprise);
+    TEST_ASSERT_EQUAL_UINT32(0, a.nbPerdus);
+    TEST_ASSERT_EQUAL_UINT32(a.nbLivres, b.nbLivres);
+    TEST_ASSERT_EQUAL_UINT32(a.delaiLivraisonMoyenMs, b.delaiLivraisonMoyenMs);
+}
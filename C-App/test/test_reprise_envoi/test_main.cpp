@@ -0,0 +1,30 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_reprise_garde_le_lot();
+void test_reprise_delai();
+void test_reprise_escalade();
+void test_reprise_inactive();
+void test_reprise_ouverture_echouee();
+void test_reprise_sans_reponse();
+void test_reprise_livraison();
+void test_reprise_benchmark_echecs();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_reprise_garde_le_lot);
+    RUN_TEST(test_reprise_delai);
+    RUN_TEST(test_reprise_escalade);
+    RUN_TEST(test_reprise_inactive);
+    RUN_TEST(test_reprise_ouverture_echouee);
+    RUN_TEST(test_reprise_sans_reponse);
+    RUN_TEST(test_reprise_livraison);
+    RUN_TEST(test_reprise_benchmark_echecs);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,261 @@
+#include <unity.h>
+#include "SESSION_RESEAU.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+extern ATCommandTask taskCATM1_CEREG;
+
+static const char *CEREG_ENREGISTRE = "\r\n+CEREG: 1,5\r\n\r\nOK\r\n";
+static const char *CEREG_RECHERCHE = "\r\n+CEREG: 1,2\r\n\r\nOK\r\n";
+static const char *CNACT_ACTIF = "\r\n+CNACT: 0,1,\"10.52.3.4\"\r\n+CNACT: 1,0,\"0.0.0.0\"\r\n\r\nOK\r\n";
+static const char *CNACT_INACTIF = "\r\n+CNACT: 0,0,\"0.0.0.0\"\r\n+CNACT: 1,0,\"0.0.0.0\"\r\n\r\nOK\r\n";
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    sessionReseau.reinitialiser();
+    sessionReseau.config = ConfigSessionReseau();
+    // La mesure du lien (AT+CPSI?) à la connexion confirmée est couverte par test_qualite_lien
+    qualiteLien.reinitialiser();
+    qualiteLien.config.actif = false;
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+}
+
+static void urc(const char *texte, unsigned long maintenant)
+{
+    sessionReseau.traiter(texte, strlen(texte), maintenant);
+}
+
+// Session établie à t = 1000 ms, état relu par requêtes
+static void etablir()
+{
+    simulateur.repondre("AT+CEREG?", CEREG_ENREGISTRE);
+    simulateur.repondre("AT+CNACT?", CNACT_ACTIF);
+    TEST_ASSERT_TRUE(sessionReseau.verifier(1000));
+    simulateur.commandes.clear();
+}
+
+static void rapporter(const char *scenario)
+{
+    const StatsSessionReseau &s = sessionReseau.stats;
+    TEST_MESSAGE((String(scenario) + " : reprise (" + nomEtapeReprise(sessionReseau.marcheAtteinte()) + ") en " +
+                  String(s.repriseMaxMs) + " ms, " + String((int)simulateur.commandes.size()) + " commandes AT")
+                     .c_str());
+}
+
+void test_session_lecture_urc_et_reponses()
+{
+    // URC découpée entre deux lectures de l'UART
+    urc("\r\n+CER", 0);
+    TEST_ASSERT_EQUAL(ENREG_INCONNU, sessionReseau.enregistrement());
+    urc("EG: 5\r\n", 0);
+    TEST_ASSERT_EQUAL(ENREG_ITINERANCE, sessionReseau.enregistrement());
+    TEST_ASSERT_EQUAL(1, sessionReseau.stats.nbUrc);
+
+    // URC au format n=2 : le 2e champ est le TAC
+    urc("\r\n+CEREG: 1,\"1A2B\",\"01A2B3C4\",7\r\n", 0);
+    TEST_ASSERT_EQUAL(ENREG_MAISON, sessionReseau.enregistrement());
+    TEST_ASSERT_EQUAL(2, sessionReseau.stats.nbUrc);
+
+    // Réponses à AT+CEREG? : <n>,<stat>
+    sessionReseau.traiter(String(CEREG_RECHERCHE), 0);
+    TEST_ASSERT_EQUAL(ENREG_RECHERCHE, sessionReseau.enregistrement());
+    sessionReseau.traiter(String("\r\n+CEREG: 4,5,\"1A2B\",\"01A2B3C4\",7,,,\"00000110\",\"00100110\"\r\n\r\nOK\r\n"), 0);
+    TEST_ASSERT_TRUE(sessionReseau.estEnregistre());
+    TEST_ASSERT_EQUAL(2, sessionReseau.stats.nbUrc);
+
+    // Contexte PDP : seul le contexte 0 compte
+    urc("\r\n+APP PDP: 0,ACTIVE\r\n", 0);
+    TEST_ASSERT_TRUE(sessionReseau.estPdpActif());
+    urc("\r\n+APP PDP: 1,DEACTIVE\r\n", 0);
+    TEST_ASSERT_TRUE(sessionReseau.estPdpActif());
+    urc("\r\n+APP PDP: 0,DEACTIVE\r\n", 0);
+    TEST_ASSERT_FALSE(sessionReseau.estPdpActif());
+
+    sessionReseau.traiter(String(CNACT_ACTIF), 0);
+    TEST_ASSERT_TRUE(sessionReseau.estPdpActif());
+    TEST_ASSERT_EQUAL_STRING("10.52.3.4", sessionReseau.ip());
+}
+
+// Etat suivi par URC : la vérification avant envoi ne coûte aucune commande tant qu'il est récent
+void test_session_verification_sans_commande()
+{
+    etablir();
+    TEST_ASSERT_TRUE(sessionReseau.estPrete());
+
+    TEST_ASSERT_TRUE(sessionReseau.verifier(31000));
+    TEST_ASSERT_TRUE(sessionReseau.verifier(61000));
+    TEST_ASSERT_EQUAL(0, (int)simulateur.commandes.size());
+    TEST_ASSERT_EQUAL(2, sessionReseau.stats.nbVerificationsSansAT);
+
+    // Une URC confirme l'état : sa validité repart
+    urc("\r\n+CEREG: 5\r\n", 100000);
+    TEST_ASSERT_TRUE(sessionReseau.verifier(200000));
+    TEST_ASSERT_EQUAL(0, (int)simulateur.commandes.size());
+
+    // Sans nouvelle depuis validiteEtatMs (URC manquée pendant le sommeil ?) : l'état est relu
+    TEST_ASSERT_TRUE(sessionReseau.verifier(100000 + sessionReseau.config.validiteEtatMs));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CEREG?"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CNACT?"));
+    TEST_ASSERT_EQUAL(4, sessionReseau.stats.nbRequetes);
+}
+
+// Contexte PDP tombé, modem toujours enregistré : AT+CNACT=0,1 suffit
+void test_session_perte_pdp()
+{
+    etablir();
+    simulateur.repondre("AT+CNACT=0,1", "\r\nOK\r\n\r\n+APP PDP: 0,ACTIVE\r\n");
+
+    urc("\r\n+APP PDP: 0,DEACTIVE\r\n", 10000);
+    TEST_ASSERT_EQUAL(1, sessionReseau.stats.nbPertesPdp);
+    TEST_ASSERT_TRUE(sessionReseau.estEnPanne());
+
+    TEST_ASSERT_FALSE(sessionReseau.verifier(12000));
+    TEST_ASSERT_EQUAL(REPRISE_PDP, sessionReseau.reprendre(12000));
+    TEST_ASSERT_TRUE(sessionReseau.verifier(12100));
+    rapporter("Perte PDP");
+
+    TEST_ASSERT_EQUAL(1, (int)simulateur.commandes.size());
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CFUN"));
+    TEST_ASSERT_EQUAL(1, sessionReseau.stats.nbReprises[REPRISE_PDP]);
+    TEST_ASSERT_EQUAL_UINT32(2000, sessionReseau.stats.repriseMaxMs);
+    TEST_ASSERT_FALSE(sessionReseau.estEnPanne());
+}
+
+// Le contexte refuse de remonter : deux essais AT+CNACT=0,1, puis ré-attachement
+void test_session_pdp_refuse_puis_reattachement()
+{
+    etablir();
+    simulateur.repondre("AT+CNACT=0,1", "\r\nERROR\r\n");
+    simulateur.repondre("AT+CNACT?", CNACT_INACTIF);
+    ConfigSessionReseau &c = sessionReseau.config;
+
+    urc("\r\n+APP PDP: 0,DEACTIVE\r\n", 10000);
+    unsigned long t = 10000;
+    TEST_ASSERT_EQUAL(REPRISE_PDP, sessionReseau.reprendre(t));
+    TEST_ASSERT_EQUAL(REPRISE_AUCUNE, sessionReseau.reprendre(t + 1000)); // +APP PDP attendue
+    t += c.attenteActionMs;
+    TEST_ASSERT_EQUAL(REPRISE_PDP, sessionReseau.reprendre(t));
+    t += c.attenteActionMs;
+    TEST_ASSERT_EQUAL(REPRISE_ENREGISTREMENT, sessionReseau.reprendre(t));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CFUN=0"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CFUN=1"));
+
+    // Ré-enregistré (URC) : le contexte PDP est réactivé aussitôt
+    simulateur.repondre("AT+CNACT=0,1", "\r\nOK\r\n\r\n+APP PDP: 0,ACTIVE\r\n");
+    urc("\r\n+CEREG: 5\r\n", t + 3000);
+    TEST_ASSERT_EQUAL(REPRISE_PDP, sessionReseau.reprendre(t + 3000));
+    TEST_ASSERT_TRUE(sessionReseau.verifier(t + 3100));
+    rapporter("PDP refuse");
+
+    TEST_ASSERT_EQUAL(1, sessionReseau.stats.nbReprises[REPRISE_ENREGISTREMENT]);
+    TEST_ASSERT_EQUAL(3, sessionReseau.stats.nbActions[REPRISE_PDP]);
+    TEST_ASSERT_EQUAL(1, sessionReseau.stats.nbActions[REPRISE_ENREGISTREMENT]);
+    TEST_ASSERT_EQUAL(0, sessionReseau.stats.nbActions[REPRISE_CONFIGURATION]);
+}
+
+// Perte de cellule : le modem retrouve seul une cellule, aucune commande n'est envoyée
+void test_session_perte_cellule_reselection()
+{
+    etablir();
+
+    urc("\r\n+CEREG: 2\r\n", 10000);
+    TEST_ASSERT_EQUAL(1, sessionReseau.stats.nbPertesEnregistrement);
+    TEST_ASSERT_FALSE(sessionReseau.verifier(11000));
+    TEST_ASSERT_EQUAL(REPRISE_AUCUNE, sessionReseau.reprendre(11000));
+    TEST_ASSERT_EQUAL(REPRISE_AUCUNE, sessionReseau.reprendre(15000));
+
+    urc("\r\n+CEREG: 5\r\n", 18000);
+    TEST_ASSERT_TRUE(sessionReseau.verifier(18100));
+    rapporter("Perte de cellule");
+
+    TEST_ASSERT_EQUAL(0, (int)simulateur.commandes.size());
+    TEST_ASSERT_EQUAL(1, sessionReseau.stats.nbReprises[REPRISE_AUCUNE]);
+    TEST_ASSERT_EQUAL_UINT32(8000, sessionReseau.stats.repriseMaxMs);
+}
+
+// Aucune cellule retrouvée : ré-attachement, puis reconfiguration complète par step_catm1_function()
+void test_session_perte_cellule_jusqua_reconfiguration()
+{
+    etablir();
+    simulateur.repondre("AT+CEREG?", CEREG_RECHERCHE);
+    ConfigSessionReseau &c = sessionReseau.config;
+
+    urc("\r\n+CEREG: 2\r\n", 10000);
+    unsigned long t = 10000 + c.attenteReselectionMs;
+    TEST_ASSERT_EQUAL(REPRISE_ENREGISTREMENT, sessionReseau.reprendre(t));
+    TEST_ASSERT_EQUAL(REPRISE_AUCUNE, sessionReseau.reprendre(t + 1000)); // +CEREG attendue
+    t += c.attenteActionMs;
+    TEST_ASSERT_EQUAL(REPRISE_CONFIGURATION, sessionReseau.reprendre(t));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CEREG?")); // état relu avant de monter d'une marche
+    TEST_ASSERT_EQUAL(REPRISE_AUCUNE, sessionReseau.reprendre(t + 1000));
+
+    // Reconfiguration terminée (CATM1_INFO) : la session est de nouveau active
+    sessionReseau.traiter(String(CEREG_ENREGISTRE), t + 30000);
+    sessionReseau.traiter(String(CNACT_ACTIF), t + 30000);
+    sessionReseau.configurationTerminee(t + 30000);
+    TEST_ASSERT_TRUE(sessionReseau.verifier(t + 30100));
+    rapporter("Cellule perdue");
+    TEST_ASSERT_EQUAL(1, sessionReseau.stats.nbReprises[REPRISE_CONFIGURATION]);
+    TEST_ASSERT_EQUAL_UINT32(t + 30000 - 10000, sessionReseau.stats.repriseMaxMs);
+}
+
+// STEP_VERIFIER_CONNEXION : session prête -> ouverture ; dernière marche -> retour à step_catm1_function()
+void test_session_step_verifier_connexion()
+{
+    etablir();
+    currentStepCBOR = STEP_VERIFIER_CONNEXION;
+    PERIODE_CBOR = millis();
+    delay(200);
+    STEP_VERIFIER_CONNEXION_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_OPEN_CONNEXION, currentStepCBOR);
+    TEST_ASSERT_EQUAL(0, (int)simulateur.commandes.size());
+
+    // Accès refusé par le réseau, aucune tentative intermédiaire autorisée
+    sessionReseau.config.tentativesEnregistrement = 0;
+    sessionReseau.traiter(String("\r\n+CEREG: 1,3\r\n\r\nOK\r\n"), millis());
+    currentStepCBOR = STEP_VERIFIER_CONNEXION;
+    currentStep4G = STEP_SEND_CBOR;
+    delay(200);
+    STEP_VERIFIER_CONNEXION_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_VERIFIER_CONNEXION, currentStepCBOR);
+    TEST_ASSERT_EQUAL(STEP_SETUP_CATM1, currentStep4G);
+    step_catm1_function();
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CNMP=38"));
+    TEST_ASSERT_EQUAL(1, sessionReseau.stats.nbActions[REPRISE_CONFIGURATION]);
+}
+
+// Attachement repris après une première session : n=1 (URC) laissé par negocierPSM n'empêche pas CATM1_INFO
+// de reconnaître "+CEREG: 0,5", et n=1 est rétabli ensuite
+void test_session_catm1_format_cereg()
+{
+    for (int attachement = 0; attachement < 2; ++attachement)
+    {
+        simulateur.commandes.clear();
+        catm1DemarrageRapide(false);
+        currentStep4G = STEP_SETUP_CATM1;
+        step_catm1_function();
+        TEST_ASSERT_TRUE(simulateur.aRecu("AT+CEREG=0"));
+        TEST_ASSERT_EQUAL(SENDING, taskCATM1_CEREG.state);
+
+        taskCATM1_CEREG.state = END; // "+CEREG: 0,5" lue par la machine d'état
+        step_catm1_function();
+        String dernier;
+        for (const String &c : simulateur.commandes)
+            if (c.startsWith("AT+CEREG=") && c != "AT+CEREG=4")
+                dernier = c;
+        TEST_ASSERT_EQUAL_STRING("AT+CEREG=1", dernier.c_str());
+        TEST_ASSERT_EQUAL(IDLE, taskCATM1_CEREG.state);
+        TEST_ASSERT_FALSE(taskCATM1_CEREG.isFinished);
+        step_catm1_function();
+        TEST_ASSERT_EQUAL(STEP_SEND_CBOR, currentStep4G);
+    }
+}
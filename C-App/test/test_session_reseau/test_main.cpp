@@ -0,0 +1,30 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_session_lecture_urc_et_reponses();
+void test_session_verification_sans_commande();
+void test_session_perte_pdp();
+void test_session_pdp_refuse_puis_reattachement();
+void test_session_perte_cellule_reselection();
+void test_session_perte_cellule_jusqua_reconfiguration();
+void test_session_step_verifier_connexion();
+void test_session_catm1_format_cereg();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_session_lecture_urc_et_reponses);
+    RUN_TEST(test_session_verification_sans_commande);
+    RUN_TEST(test_session_perte_pdp);
+    RUN_TEST(test_session_pdp_refuse_puis_reattachement);
+    RUN_TEST(test_session_perte_cellule_reselection);
+    RUN_TEST(test_session_perte_cellule_jusqua_reconfiguration);
+    RUN_TEST(test_session_step_verifier_connexion);
+    RUN_TEST(test_session_catm1_format_cereg);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,253 @@
+#include <unity.h>
+#include "SESSION_TLS.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+static ServeurTlsLocal serveur;
+
+extern ATCommandTask taskCBOR_OPEN_CONNEXION;
+
+// Les commandes AT sont journalisées par le simulateur et traitées par le serveur TLS local
+static String repondreServeur(const String &commande, long)
+{
+    simulateur.commandes.push_back(commande);
+    return serveur.traiter(commande, millis());
+}
+
+void setUp(void)
+{
+    simulateur.reinitialiser();
+    simulateur.installer();
+    SendATResponseHook = repondreServeur;
+    serveur = ServeurTlsLocal();
+    sessionTls.config = ConfigTls();
+    sessionTls.config.actif = true;
+    sessionTls.commande = nullptr;
+    sessionTls.reinitialiser();
+    multiplexeurSockets.reinitialiser();
+    multiplexeurSockets.config = ConfigSockets();
+    cacheDns.reinitialiser();
+}
+
+void tearDown(void)
+{
+    simulateur.desinstaller();
+    sessionTls.config = ConfigTls();
+    sessionTls.reinitialiser();
+    multiplexeurSockets.reinitialiser();
+}
+
+// Contexte SSL écrit une fois, AT+CASSLCFG une fois par cid ; le SNI est le nom du serveur, la CA est vérifiée
+void test_tls_configuration_unique()
+{
+    TEST_ASSERT_TRUE(sessionTls.preparer(CID_ENVOI, millis()));
+    TEST_ASSERT_TRUE(sessionTls.preparer(CID_ENVOI, millis()));
+    TEST_ASSERT_EQUAL(4, simulateur.compter("AT+CSSLCFG"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CSSLCFG=\"sslversion\",1,3"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CSSLCFG=\"sni\",1,\"" PINGGY_LINK "\""));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CSSLCFG=\"convert\",2,\"ca.crt\""));
+    TEST_ASSERT_EQUAL(3, simulateur.compter("AT+CASSLCFG=0"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CASSLCFG=0,\"SSL\",1"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CASSLCFG=0,\"CACERT\",\"ca.crt\""));
+
+    TEST_ASSERT_TRUE(sessionTls.preparer(CID_CONTROLE, millis()));
+    TEST_ASSERT_EQUAL(4, simulateur.compter("AT+CSSLCFG"));
+    TEST_ASSERT_EQUAL(3, simulateur.compter("AT+CASSLCFG=1"));
+    TEST_ASSERT_EQUAL_UINT32(1, sessionTls.stats.nbConfigurations);
+
+    // Inactif : aucune commande (comportement précédent)
+    sessionTls.config.actif = false;
+    sessionTls.reinitialiser();
+    simulateur.commandes.clear();
+    TEST_ASSERT_TRUE(sessionTls.preparer(CID_ENVOI, millis()));
+    TEST_ASSERT_EQUAL(0, (int)simulateur.commandes.size());
+}
+
+// Pas de reprise de session exposée par le modem : chaque AT+CAOPEN est une poignée complète, authentifiée
+void test_tls_poignee_a_chaque_ouverture()
+{
+    TEST_ASSERT_TRUE(multiplexeurSockets.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_EQUAL(POIGNEE_COMPLETE, serveur.derniere);
+    TEST_ASSERT_EQUAL(POIGNEE_COMPLETE, sessionTls.dernierePoignee());
+    multiplexeurSockets.fermer(CANAL_CONTROLE);
+
+    TEST_ASSERT_TRUE(multiplexeurSockets.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_EQUAL_UINT32(2, serveur.nbPoigneesCompletes);
+    TEST_ASSERT_EQUAL_UINT32(2, sessionTls.stats.nbPoignees);
+    TEST_ASSERT_EQUAL(3, simulateur.compter("AT+CASSLCFG"));
+    TEST_ASSERT_EQUAL(4, simulateur.compter("AT+CSSLCFG"));
+    TEST_ASSERT_EQUAL_UINT32(0, serveur.nbConnexionsClaires);
+    TEST_ASSERT_EQUAL_UINT32(0, serveur.nbConnexionsNonAuthentifiees);
+}
+
+// Sans CA, le serveur n'est pas authentifié : aucune ouverture, ni chiffrée ni en clair, sauf authentification coupée
+void test_tls_ca_requise()
+{
+    sessionTls.config.certificatCa = "";
+    TEST_ASSERT_FALSE(sessionTls.preparer(CID_ENVOI, millis()));
+    TEST_ASSERT_FALSE(multiplexeurSockets.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CAOPEN"));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CSSLCFG"));
+
+    // STEP_OPEN_CONNEXION : l'envoi échoue au lieu de partir en clair
+    tableauJSONString = "[{\"lat\":50.63}]";
+    endCBOR = true;
+    PERIODE_CBOR = millis() - 1000;
+    STEP_INIT_CBOR_FUNCTION(tableauJSONString.c_str());
+    taskCBOR_OPEN_CONNEXION.state = IDLE;
+    taskCBOR_OPEN_CONNEXION.isFinished = false;
+    currentStepCBOR = STEP_OPEN_CONNEXION;
+    PERIODE_CBOR = millis();
+    delay(200);
+    STEP_OPEN_CONNEXION_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_VERIFIER_CONNEXION, currentStepCBOR);
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CAOPEN"));
+    TEST_ASSERT_EQUAL(IDLE, taskCBOR_OPEN_CONNEXION.state);
+
+    chargerOptionsTls({{"authentification", false}});
+    TEST_ASSERT_TRUE(multiplexeurSockets.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_FALSE(simulateur.aRecu("CACERT"));
+    TEST_ASSERT_EQUAL_UINT32(1, serveur.nbConnexionsNonAuthentifiees);
+
+    repriseEnvoi.reinitialiser();
+    currentStepCBOR = STEP_INIT_CBOR;
+    cborDataPipeline.clear();
+    tableauJSONString = "";
+}
+
+// TLS activé par le serveur seulement si la CA est convertie par le modem : sinon, les envois restent possibles
+void test_tls_activation_sans_ca()
+{
+    sessionTls.config.actif = false;
+    serveur.caChargee = false;
+    chargerOptionsTls({{"actif", true}, {"garderOuvertS", 30}});
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CSSLCFG=\"convert\",2,\"ca.crt\""));
+    TEST_ASSERT_FALSE(sessionTls.config.actif);
+    TEST_ASSERT_EQUAL_UINT32(600, sessionTls.config.garderOuvertS);
+    TEST_ASSERT_EQUAL_UINT32(1, sessionTls.stats.nbEchecs);
+    TEST_ASSERT_TRUE(multiplexeurSockets.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_EQUAL_UINT32(1, serveur.nbConnexionsClaires);
+    multiplexeurSockets.fermer(CANAL_CONTROLE);
+
+    serveur.caChargee = true;
+    chargerOptionsTls({{"actif", true}});
+    TEST_ASSERT_TRUE(sessionTls.config.actif);
+
+    // Nouvelle CA absente : l'ancienne reste en place
+    serveur.caChargee = false;
+    chargerOptionsTls({{"certificatCa", "autre.crt"}});
+    TEST_ASSERT_TRUE(sessionTls.config.actif);
+    TEST_ASSERT_EQUAL_STRING("ca.crt", sessionTls.config.certificatCa.c_str());
+    TEST_ASSERT_EQUAL_UINT32(2, sessionTls.stats.nbEchecs);
+}
+
+// STEP_CLOSE_CONNEXION laisse le socket TLS ouvert, STEP_OPEN_CONNEXION le reprend sans AT+CAOPEN
+void test_tls_socket_garde()
+{
+    serveur.traiter("AT+CAOPEN=0,0,\"TCP\",serveur.local,443", millis());
+    multiplexeurSockets.marquer(CANAL_ENVOI, true);
+    currentStepCBOR = STEP_CLOSE_CONNEXION;
+    STEP_CLOSE_CONNEXION_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_END, currentStepCBOR);
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CACLOSE"));
+    TEST_ASSERT_TRUE(multiplexeurSockets.estOuvert(CANAL_ENVOI));
+
+    taskCBOR_OPEN_CONNEXION.state = IDLE;
+    taskCBOR_OPEN_CONNEXION.isFinished = false;
+    currentStepCBOR = STEP_OPEN_CONNEXION;
+    PERIODE_CBOR = millis();
+    delay(200);
+    STEP_OPEN_CONNEXION_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_DEFINE_BYTE, currentStepCBOR);
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CASTATE?"));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CAOPEN"));
+    TEST_ASSERT_EQUAL_UINT32(1, sessionTls.stats.nbConnexionsGardees);
+
+    // Au-delà de garderOuvertS : socket fermé, cid configuré, AT+CAOPEN préparé
+    sessionTls.config.garderOuvertS = 1;
+    sessionTls.terminerEnvoi(millis());
+    currentStepCBOR = STEP_OPEN_CONNEXION;
+    PERIODE_CBOR = millis();
+    delay(1200);
+    STEP_OPEN_CONNEXION_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_OPEN_CONNEXION, currentStepCBOR);
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CACLOSE=0"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CASSLCFG=0,\"SSL\",1"));
+    TEST_ASSERT_TRUE(taskCBOR_OPEN_CONNEXION.command.startsWith("AT+CAOPEN=0,0,\"TCP\","));
+    taskCBOR_OPEN_CONNEXION.state = IDLE;
+
+    // Socket coupé par le réseau sans URC lue : AT+CASTATE? le donne fermé, il est rouvert
+    sessionTls.config.garderOuvertS = 600;
+    multiplexeurSockets.marquer(CANAL_ENVOI, true);
+    sessionTls.terminerEnvoi(millis());
+    simulateur.commandes.clear();
+    currentStepCBOR = STEP_OPEN_CONNEXION;
+    PERIODE_CBOR = millis();
+    delay(200);
+    STEP_OPEN_CONNEXION_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_OPEN_CONNEXION, currentStepCBOR);
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CASTATE?"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CACLOSE=0"));
+    TEST_ASSERT_EQUAL_UINT32(1, sessionTls.stats.nbSocketsPerdus);
+    TEST_ASSERT_EQUAL_UINT32(1, sessionTls.stats.nbConnexionsGardees);
+    taskCBOR_OPEN_CONNEXION.state = IDLE;
+}
+
+// Le contexte et les cid configurés survivent au sommeil du modem (ETAT_RTC) ; un modem redémarré est reconfiguré
+void test_tls_contexte_apres_sommeil()
+{
+    unsigned long t = millis();
+    sessionTls.preparer(CID_ENVOI, t);
+
+    sessionTls.restaurer(sessionTls.estConfigure(), sessionTls.cidsPrepares());
+    simulateur.commandes.clear();
+    TEST_ASSERT_TRUE(sessionTls.preparer(CID_ENVOI, t + 600000));
+    TEST_ASSERT_EQUAL(0, (int)simulateur.commandes.size());
+
+    sessionTls.restaurer(false, 0);
+    TEST_ASSERT_TRUE(sessionTls.preparer(CID_ENVOI, t + 800000));
+    TEST_ASSERT_EQUAL(7, (int)simulateur.commandes.size());
+}
+
+// TLS désactivé par le serveur : SSL remis à 0 sur le cid avant sa prochaine ouverture
+void test_tls_desactivation()
+{
+    TEST_ASSERT_TRUE(multiplexeurSockets.ouvrir(CANAL_CONTROLE));
+    multiplexeurSockets.fermer(CANAL_CONTROLE);
+    chargerOptionsTls({{"actif", false}});
+    TEST_ASSERT_TRUE(multiplexeurSockets.ouvrir(CANAL_CONTROLE));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CASSLCFG=1,\"SSL\",0"));
+    TEST_ASSERT_EQUAL_UINT32(1, serveur.nbConnexionsClaires);
+    TEST_ASSERT_EQUAL_UINT32(0, sessionTls.cidsPrepares());
+}
+
+// Banc d'essai : poignées, octets et temps par envoi en clair, en TLS avec un socket par envoi, en TLS socket gardé
+void test_tls_benchmark_poignees()
+{
+    ScenarioTls scenario;
+    ConfigTls clair;
+    ConfigTls naif;
+    naif.actif = true;
+    naif.garderOuvertS = 0;
+    ConfigTls garde = naif;
+    garde.garderOuvertS = ConfigTls().garderOuvertS;
+    char message[200];
+
+    RapportTls r[3] = {simulerTls(scenario, clair), simulerTls(scenario, naif), simulerTls(scenario, garde)};
+    const char *noms[3] = {"clair", "TLS, un socket par envoi", "TLS, socket garde"};
+    for (int i = 0; i < 3; ++i)
+    {
+        snprintf(message, sizeof(message), "%s : %lu poignees, %lu o/envoi, %lu ms/envoi, %.2f AT/envoi",
+                 noms[i], (unsigned long)r[i].nbPoignees, (unsigned long)r[i].octetsParEnvoi,
+                 (unsigned long)r[i].tempsParEnvoiMs, r[i].transactionsParEnvoi);
+        TEST_MESSAGE(message);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, r[0].nbPoignees);
+    TEST_ASSERT_EQUAL_UINT32(scenario.nbEnvois, r[1].nbPoignees);
+    TEST_ASSERT_TRUE(r[2].nbPoignees <= scenario.nbEnvois / scenario.coupureTous + 2);
+    TEST_ASSERT_TRUE(r[2].octetsParEnvoi * 4 < r[1].octetsParEnvoi);
+    TEST_ASSERT_TRUE(r[2].tempsParEnvoiMs < r[1].tempsParEnvoiMs);
+    TEST_ASSERT_TRUE(r[2].tempsParEnvoiMs < r[0].tempsParEnvoiMs);
+}
@@ -0,0 +1,30 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_tls_configuration_unique();
+void test_tls_poignee_a_chaque_ouverture();
+void test_tls_ca_requise();
+void test_tls_activation_sans_ca();
+void test_tls_socket_garde();
+void test_tls_contexte_apres_sommeil();
+void test_tls_desactivation();
+void test_tls_benchmark_poignees();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tls_configuration_unique);
+    RUN_TEST(test_tls_poignee_a_chaque_ouverture);
+    RUN_TEST(test_tls_ca_requise);
+    RUN_TEST(test_tls_activation_sans_ca);
+    RUN_TEST(test_tls_socket_garde);
+    RUN_TEST(test_tls_contexte_apres_sommeil);
+    RUN_TEST(test_tls_desactivation);
+    RUN_TEST(test_tls_benchmark_poignees);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,143 @@
+#include <unity.h>
+#include "SIMPLIFICATION.hpp"
+#include "GnssUtils.hpp"
+
+#define LAT_BASE 50634412
+#define LON_BASE 3048687
+#define TAILLE_TRACE 900
+
+static Echantillon trace[TAILLE_TRACE];
+static uint16_t gardes[TAILLE_TRACE];
+
+void setUp(void)
+{
+    simplificateur.reinitialiser();
+    simplificateur.config = ConfigSimplification();
+    nbCoordonnees = 0;
+}
+
+void tearDown(void) {}
+
+// bruit déterministe de +/- 1 m
+static int32_t bruit(int i)
+{
+    return (int32_t)((i * 7919) % 19) - 9;
+}
+
+static Echantillon point(int32_t lat, int32_t lon, int16_t vitesse, int16_t cap, int i)
+{
+    Echantillon e;
+    e.latE6 = lat + bruit(i);
+    e.lonE6 = lon - bruit(i + 3);
+    e.vitesseDixiemes = vitesse;
+    e.capDegres = cap;
+    e.tMs = (unsigned long)i * 1000;
+    return e;
+}
+
+// Autoroute : 600 s à 108 km/h vers le nord, courbe douce (64 m d'écart latéral sur 18 km)
+static int traceAutoroute()
+{
+    for (int i = 0; i < 600; ++i)
+        trace[i] = point(LAT_BASE + i * 270, LON_BASE + (i * i) / 400, 1080, 0, i);
+    return 600;
+}
+
+// Ville : 900 s à 36 km/h, îlots de 600 m, arrêt de 20 s à un carrefour sur deux
+static int traceVille()
+{
+    int32_t lat = LAT_BASE, lon = LON_BASE;
+    int i = 0, troncon = 0;
+    while (i < TAILLE_TRACE)
+    {
+        bool nord = (troncon % 2) == 0;
+        for (int s = 0; s < 60 && i < TAILLE_TRACE; ++s, ++i)
+        {
+            trace[i] = point(lat, lon, 360, nord ? 0 : 90, i);
+            if (nord)
+                lat += 90;
+            else
+                lon += 141;
+        }
+        if (troncon % 2 == 1)
+            for (int s = 0; s < 20 && i < TAILLE_TRACE; ++s, ++i)
+                trace[i] = point(lat, lon, 0, -1, i);
+        troncon++;
+    }
+    return TAILLE_TRACE;
+}
+
+static bool estGarde(int indice, int n)
+{
+    for (int k = 0; k < n; ++k)
+        if (gardes[k] == indice)
+            return true;
+    return false;
+}
+
+void test_simplification_points_alignes()
+{
+    // Dix points alignés sur dataGNSS : seuls le premier et le dernier restent, dans l'ordre
+    for (int i = 0; i < MAX_COORDS; ++i)
+    {
+        Gnss gnss;
+        gnss.coordonnees.latitude.full = String("50.") + String(634412 + i * 100);
+        gnss.coordonnees.longitude.full = "3.048687";
+        gnss.timeStamp = String(i);
+        addGNSSInDataGNSS(gnss);
+    }
+    nbCoordonnees = simplifierDataGNSS(dataGNSS, nbCoordonnees);
+    TEST_ASSERT_EQUAL(2, nbCoordonnees);
+    TEST_ASSERT_EQUAL_STRING("0", dataGNSS[0].gnss.timeStamp.c_str());
+    TEST_ASSERT_EQUAL_STRING("9", dataGNSS[1].gnss.timeStamp.c_str());
+}
+
+void test_simplification_virages_et_arrets_gardes()
+{
+    int nb = traceVille();
+    int n = simplifierTrace(trace, nb, ConfigSimplification(), gardes);
+    TEST_ASSERT_TRUE(estGarde(0, n));
+    TEST_ASSERT_TRUE(estGarde(nb - 1, n));
+    // Premier virage (nord -> est) et premier arrêt, fin d'arrêt
+    TEST_ASSERT_TRUE(estGarde(60, n));
+    TEST_ASSERT_TRUE(estGarde(120, n));
+    TEST_ASSERT_TRUE(estGarde(140, n));
+    for (int k = 1; k < n; ++k)
+        TEST_ASSERT_TRUE(gardes[k] > gardes[k - 1]);
+}
+
+void test_simplification_erreur_bornee()
+{
+    ConfigSimplification config;
+    int nb = traceVille();
+    RapportSimplification rapport = mesurerSimplification(trace, nb, config, gardes);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(config.toleranceM, rapport.erreurMaxM);
+
+    // Une fenêtre d'un seul point garde tout
+    config.fenetreMax = 1;
+    rapport = mesurerSimplification(trace, nb, config, gardes);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(nb / 2, rapport.nbSorties);
+}
+
+void test_simplification_benchmark()
+{
+    ConfigSimplification config;
+    int nb = traceAutoroute();
+    RapportSimplification autoroute = mesurerSimplification(trace, nb, config, gardes);
+    nb = traceVille();
+    RapportSimplification ville = mesurerSimplification(trace, nb, config, gardes);
+
+    TEST_MESSAGE(("Autoroute : " + String(autoroute.nbSorties) + "/" + String(autoroute.nbEntrees) + " points, x" +
+                  String(autoroute.ratioCentiemes / 100.0f, 1) + ", erreur max " + String(autoroute.erreurMaxM) + " m, " +
+                  String(autoroute.cyclesParPoint) + " cycles/point")
+                     .c_str());
+    TEST_MESSAGE(("Ville     : " + String(ville.nbSorties) + "/" + String(ville.nbEntrees) + " points, x" +
+                  String(ville.ratioCentiemes / 100.0f, 1) + ", erreur max " + String(ville.erreurMaxM) + " m, " +
+                  String(ville.cyclesParPoint) + " cycles/point")
+                     .c_str());
+
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1000, autoroute.ratioCentiemes);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(300, ville.ratioCentiemes);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(config.toleranceM, autoroute.erreurMaxM);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, autoroute.cyclesParPoint);
+}
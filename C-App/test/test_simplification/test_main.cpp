@@ -0,0 +1,22 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_simplification_points_alignes();
+void test_simplification_virages_et_arrets_gardes();
+void test_simplification_erreur_bornee();
+void test_simplification_benchmark();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_simplification_points_alignes);
+    RUN_TEST(test_simplification_virages_et_arrets_gardes);
+    RUN_TEST(test_simplification_erreur_bornee);
+    RUN_TEST(test_simplification_benchmark);
+    UNITY_END();
+}
+
+void loop() {}
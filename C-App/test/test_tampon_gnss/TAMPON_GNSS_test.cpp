@@ -0,0 +1,148 @@
+#include <unity.h>
+#include "TAMPON_GNSS.hpp"
+#include "GnssUtils.hpp"
+
+#define DEBUT_S 803001600UL // 12/06/2025 00:00:00 UTC
+
+void setUp(void)
+{
+    tamponGnss.reinitialiser();
+    tamponGnss.config = ConfigTampon();
+    nbCoordonnees = 0;
+}
+
+void tearDown(void) {}
+
+// Fix numéro n : horodatage DEBUT_S + n x pasS, n x pasE6 micro-degrés au nord
+static Gnss fixNumero(int n, uint32_t pasS = 3, int32_t pasE6 = 270)
+{
+    Gnss gnss;
+    gnss.timeStamp = secondesVersHorodatage(DEBUT_S + n * pasS);
+    gnss.coordonnees.latitude.full = e6VersDegres(50634412 + n * pasE6);
+    gnss.coordonnees.longitude.full = e6VersDegres(3048687);
+    return gnss;
+}
+
+static uint32_t secondes(int i)
+{
+    return horodatageVersSecondes(dataGNSS[i].gnss.timeStamp) - DEBUT_S;
+}
+
+void test_tampon_historique_ecrase_le_plus_ancien()
+{
+    tamponGnss.config.decimation = false;
+    for (int n = 0; n < 12; ++n)
+        addGNSSInDataGNSS(fixNumero(n));
+    TEST_ASSERT_EQUAL(MAX_COORDS, nbCoordonnees);
+    TEST_ASSERT_EQUAL_UINT32(6, secondes(0)); // fix n°2
+    TEST_ASSERT_EQUAL_UINT32(2, tamponGnss.stats.nbEcrases);
+}
+
+void test_tampon_decimation_fusionne_les_plus_proches()
+{
+    for (int n = 0; n < 11; ++n)
+        addGNSSInDataGNSS(fixNumero(n));
+    // Points équidistants : le plus ancien après le premier est fusionné avec ses voisins
+    TEST_ASSERT_EQUAL(MAX_COORDS, nbCoordonnees);
+    TEST_ASSERT_EQUAL_UINT32(0, secondes(0));
+    TEST_ASSERT_EQUAL_UINT32(6, secondes(1));
+    TEST_ASSERT_EQUAL_UINT32(30, secondes(nbCoordonnees - 1));
+    TEST_ASSERT_EQUAL_UINT32(1, tamponGnss.stats.nbSupprimes);
+
+    // Rafale rapprochée au milieu : c'est elle qui est décimée, pas les points anciens
+    setUp();
+    for (int n = 0; n < 5; ++n)
+        addGNSSInDataGNSS(fixNumero(n, 600));
+    for (int n = 0; n < 5; ++n)
+        addGNSSInDataGNSS(fixNumero(1000 + n));
+    addGNSSInDataGNSS(fixNumero(2000));
+    TEST_ASSERT_EQUAL_UINT32(600, secondes(1));
+    TEST_ASSERT_EQUAL_UINT32(2400, secondes(4));
+    TEST_ASSERT_EQUAL_UINT32(3000, secondes(5));
+    TEST_ASSERT_EQUAL_UINT32(3006, secondes(6));
+
+    // Capacité réduite par le serveur
+    tamponGnss.config.maxPoints = 4;
+    addGNSSInDataGNSS(fixNumero(3000));
+    TEST_ASSERT_EQUAL(4, nbCoordonnees);
+    TEST_ASSERT_EQUAL_UINT32(0, secondes(0));
+    TEST_ASSERT_EQUAL_UINT32(9000, secondes(3));
+}
+
+void test_tampon_espacement_min_fusionne()
+{
+    tamponGnss.config.espacementMinS = 10;
+    tamponGnss.config.espacementMinM = 20;
+    addGNSSInDataGNSS(fixNumero(0, 5, 45));
+    addGNSSInDataGNSS(fixNumero(1, 5, 45)); // 5 s, 5 m : fusionné
+    TEST_ASSERT_EQUAL(1, nbCoordonnees);
+    addGNSSInDataGNSS(fixNumero(3, 5, 45)); // 15 s, 15 m : gardé (temps)
+    TEST_ASSERT_EQUAL(2, nbCoordonnees);
+    addGNSSInDataGNSS(fixNumero(4, 5, 900)); // 5 s mais 100 m : gardé (distance)
+    TEST_ASSERT_EQUAL(3, nbCoordonnees);
+    TEST_ASSERT_EQUAL_UINT32(1, tamponGnss.stats.nbFusionnes);
+}
+
+void test_tampon_preparer_cycle()
+{
+    for (int n = 0; n < MAX_COORDS; ++n)
+        addGNSSInDataGNSS(fixNumero(n));
+    TEST_ASSERT_TRUE(tamponGnss.plein(nbCoordonnees));
+
+    // Cycle suivant sans envoi : de la place est faite pour les nouveaux fixes, extrémités gardées
+    tamponGnss.preparerCycle(dataGNSS, nbCoordonnees);
+    TEST_ASSERT_EQUAL(MAX_COORDS - MAX_COORDS / 2, nbCoordonnees);
+    TEST_ASSERT_FALSE(tamponGnss.plein(nbCoordonnees));
+    TEST_ASSERT_EQUAL_UINT32(0, secondes(0));
+    TEST_ASSERT_EQUAL_UINT32(27, secondes(nbCoordonnees - 1));
+    for (int i = 1; i < nbCoordonnees; ++i)
+        TEST_ASSERT_GREATER_THAN_UINT32(secondes(i - 1), secondes(i));
+    TEST_ASSERT_EQUAL_UINT32(1, tamponGnss.stats.nbDecimations);
+
+    // Tampon à moitié vide : rien à faire
+    tamponGnss.preparerCycle(dataGNSS, nbCoordonnees);
+    TEST_ASSERT_EQUAL(MAX_COORDS - MAX_COORDS / 2, nbCoordonnees);
+
+    // Mode historique : le tampon reste plein et l'acquisition du cycle s'arrête aussitôt
+    tamponGnss.config.decimation = false;
+    nbCoordonnees = MAX_COORDS;
+    tamponGnss.preparerCycle(dataGNSS, nbCoordonnees);
+    TEST_ASSERT_TRUE(tamponGnss.plein(nbCoordonnees));
+}
+
+void test_tampon_horodatage_aller_retour()
+{
+    TEST_ASSERT_EQUAL_UINT32(0, horodatageVersSecondes("20000101000000.000"));
+    TEST_ASSERT_EQUAL_UINT32(DEBUT_S, horodatageVersSecondes("20250612000000.000"));
+    TEST_ASSERT_EQUAL_UINT32(0, horodatageVersSecondes(""));
+    TEST_ASSERT_EQUAL_STRING("20240229235959.000", secondesVersHorodatage(horodatageVersSecondes("20240229235959.000")).c_str());
+    TEST_ASSERT_EQUAL_STRING("20240301000000.000", secondesVersHorodatage(horodatageVersSecondes("20240229235959.000") + 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("20260101000000.000", secondesVersHorodatage(horodatageVersSecondes("20251231235959.000") + 1).c_str());
+}
+
+void test_tampon_benchmark_panne()
+{
+    const unsigned long durees[3] = {2UL * 3600, 6UL * 3600, 24UL * 3600};
+    for (int i = 0; i < 3; ++i)
+    {
+        ScenarioPanne scenario;
+        scenario.dureePanneS = durees[i];
+        ConfigTampon historique;
+        historique.decimation = false;
+        RapportPanne ref = simulerPanne(scenario, historique);
+        RapportPanne dec = simulerPanne(scenario, ConfigTampon());
+
+        char message[160];
+        snprintf(message, sizeof(message), "Panne %lu h : couverture %lu s (historique %lu s), ecart max %lu s, %lu points, %lu cycles/ajout",
+                 durees[i] / 3600, (unsigned long)dec.couvertureS, (unsigned long)ref.couvertureS,
+                 (unsigned long)dec.ecartMaxS, (unsigned long)dec.nbPoints, (unsigned long)dec.cyclesParAjout);
+        TEST_MESSAGE(message);
+
+                TEST_ASSERT_LESS_OR_EQUAL(MAX_COORDS, dec.nbPoints);
+        // Historique : tampon figé sur le premier cycle ; décimation : la coupure est couverte de bout en bout
+        TEST_ASSERT_LESS_THAN_UINT32(scenario.periodeCycleS, ref.couvertureS);
+        TEST_ASSERT_GREATER_OR_EQUAL_UINT32(durees[i] * 95 / 100, dec.couvertureS);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(durees[i] / 2, dec.ecartMaxS);
+        TEST_ASSERT_GREATER_THAN_UINT32(durees[i] * 9 / 10, ref.ecartMaxS);
+    }
+}
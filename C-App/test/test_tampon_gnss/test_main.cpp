@@ -0,0 +1,26 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_tampon_historique_ecrase_le_plus_ancien();
+void test_tampon_decimation_fusionne_les_plus_proches();
+void test_tampon_espacement_min_fusionne();
+void test_tampon_preparer_cycle();
+void test_tampon_horodatage_aller_retour();
+void test_tampon_benchmark_panne();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tampon_historique_ecrase_le_plus_ancien);
+    RUN_TEST(test_tampon_decimation_fusionne_les_plus_proches);
+    RUN_TEST(test_tampon_espacement_min_fusionne);
+    RUN_TEST(test_tampon_preparer_cycle);
+    RUN_TEST(test_tampon_horodatage_aller_retour);
+    RUN_TEST(test_tampon_benchmark_panne);
+    UNITY_END();
+}
+
+void loop() {}
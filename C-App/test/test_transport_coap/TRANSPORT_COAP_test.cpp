@@ -0,0 +1,386 @@
+#include <unity.h>
+#include <string>
+#include "TRANSPORT_COAP.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+
+// Octets écrits vers le modem (en-têtes AT+CASEND et datagrammes)
+static std::string ecrit;
+
+static size_t capturer(const uint8_t *donnees, size_t taille)
+{
+    ecrit.append((const char *)donnees, taille);
+    return taille;
+}
+
+static void recevoir(const char *texte, unsigned long maintenant)
+{
+    transportCoap.traiter(texte, strlen(texte), maintenant);
+}
+
+// Datagramme écrit après le prompt, sans l'en-tête "AT+CASEND=2,<n>\r\n"
+static std::vector<uint8_t> ecrireDatagramme(unsigned long maintenant)
+{
+    ecrit.clear();
+    recevoir("\r\n> ", maintenant);
+    std::vector<uint8_t> datagramme(ecrit.begin(), ecrit.end());
+    recevoir("\r\nOK\r\n", maintenant);
+    transportCoap.pomper(maintenant);
+    return datagramme;
+}
+
+static String reponseCARECV(const std::vector<uint8_t> &octets)
+{
+    String reponse = "\r\n+CARECV: " + String((unsigned long)octets.size()) + ",";
+    for (uint8_t o : octets)
+        reponse += (char)o;
+    return reponse + "\r\n\r\nOK\r\n";
+}
+
+static const uint8_t CBOR_MESSAGE[] = {0xA1, 0x61, 'a', 0x01}; // {"a": 1}
+
+void setUp(void)
+{
+    ecrit.clear();
+    simulateur.reinitialiser();
+    simulateur.installer();
+    simulateur.repondre("AT+CARECV=2", "\r\n+CARECV: 0\r\n\r\nOK\r\n");
+    transportCoap.reinitialiser();
+    transportCoap.config = ConfigCoap();
+    transportCoap.config.actif = true;
+    transportCoap.config.hote = "coap.local";
+    transportCoap.sortie = capturer;
+    multiplexeurSockets.reinitialiser();
+    multiplexeurSockets.config = ConfigSockets();
+    sessionReseau.reinitialiser();
+}
+
+void tearDown(void)
+{
+    transportCoap.sortie = nullptr;
+    transportCoap.config = ConfigCoap();
+    simulateur.desinstaller();
+}
+
+void test_coap_encodage()
+{
+    MessageCoap requete;
+    requete.type = COAP_CON;
+    requete.code = COAP_POST;
+    requete.messageId = 0x1234;
+    requete.tkl = 2;
+    requete.token[0] = 0xAB;
+    requete.token[1] = 0xCD;
+    requete.charge.assign(CBOR_MESSAGE, CBOR_MESSAGE + sizeof(CBOR_MESSAGE));
+    std::vector<uint8_t> d;
+    encoderCoap(requete, COAP_URI, d);
+
+    // En-tête, token, Uri-Path "gps" (11), Content-Format CBOR (12 = 11 + 1), marqueur, charge
+    const uint8_t attendu[] = {0x42, 0x02, 0x12, 0x34, 0xAB, 0xCD, 0xB3, 'g', 'p', 's', 0x11, 60, 0xFF,
+                               0xA1, 0x61, 'a', 0x01};
+    TEST_ASSERT_EQUAL(sizeof(attendu), d.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(attendu, d.data(), sizeof(attendu));
+
+    MessageCoap lu;
+    TEST_ASSERT_TRUE(decoderCoap(d.data(), d.size(), lu));
+    TEST_ASSERT_EQUAL(COAP_CON, lu.type);
+    TEST_ASSERT_EQUAL_HEX8(COAP_POST, lu.code);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, lu.messageId);
+    TEST_ASSERT_EQUAL(2, lu.tkl);
+    TEST_ASSERT_EQUAL_HEX8(0xCD, lu.token[1]);
+    TEST_ASSERT_EQUAL(sizeof(CBOR_MESSAGE), lu.charge.size());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(CBOR_MESSAGE, lu.charge.data(), sizeof(CBOR_MESSAGE));
+
+    // Acquittement vide, option à delta étendu (Size1, 60 = 13 + 47) sautée
+    const uint8_t ack[] = {0x60, 0x44, 0x12, 0x34, 0xD1, 47, 0x05, 0xFF, 0x80};
+    TEST_ASSERT_TRUE(decoderCoap(ack, sizeof(ack), lu));
+    TEST_ASSERT_EQUAL(COAP_ACK, lu.type);
+    TEST_ASSERT_EQUAL(0, lu.tkl);
+    TEST_ASSERT_EQUAL(1, lu.charge.size());
+
+    // Version 2, token de 9 octets, option tronquée, marqueur sans charge
+    const uint8_t version[] = {0x80, 0x44, 0x00, 0x01};
+    const uint8_t token[] = {0x49, 0x44, 0x00, 0x01};
+    const uint8_t tronquee[] = {0x60, 0x44, 0x00, 0x01, 0xB3, 'g'};
+    const uint8_t marqueur[] = {0x60, 0x44, 0x00, 0x01, 0xFF};
+    TEST_ASSERT_FALSE(decoderCoap(version, sizeof(version), lu));
+    TEST_ASSERT_FALSE(decoderCoap(token, sizeof(token), lu));
+    TEST_ASSERT_FALSE(decoderCoap(tronquee, sizeof(tronquee), lu));
+    TEST_ASSERT_FALSE(decoderCoap(marqueur, sizeof(marqueur), lu));
+}
+
+// Requête écrite par un AT+CASEND sur le cid 2, réponse du serveur lue dans l'acquittement annoncé par +CADATAIND
+void test_coap_echange_acquitte()
+{
+    TransportCoap &t = transportCoap;
+    TEST_ASSERT_TRUE(t.accepte(sizeof(CBOR_MESSAGE)));
+    TEST_ASSERT_FALSE(t.accepte(TAILLE_MAX_COAP));
+    t.config.hote = "";
+    TEST_ASSERT_FALSE(t.accepte(sizeof(CBOR_MESSAGE))); // pas de serveur CoAP : pipeline TCP
+    t.config.hote = "coap.local";
+
+    uint16_t id = t.prochainMessageId();
+    t.commencer(CBOR_MESSAGE, sizeof(CBOR_MESSAGE), 1000);
+    TEST_ASSERT_EQUAL_STRING("AT+CASEND=2,17\r\n", ecrit.c_str());
+    TEST_ASSERT_EQUAL(COAP_EN_COURS, t.etat());
+    std::vector<uint8_t> requete = ecrireDatagramme(1010);
+    TEST_ASSERT_EQUAL(17, requete.size());
+    TEST_ASSERT_EQUAL((uint16_t)(id + 1), t.prochainMessageId());
+
+    ServeurCoapLocal serveur;
+    serveur.options = {{"lissage", true}};
+    std::vector<uint8_t> ack;
+    TEST_ASSERT_TRUE(serveur.repondre(requete.data(), requete.size(), ack));
+    simulateur.repondre("AT+CARECV=2", reponseCARECV(ack), 1);
+
+    // Rien n'est lu avant l'annonce ; une annonce du socket de contrôle est ignorée
+    TEST_ASSERT_EQUAL(COAP_EN_COURS, t.pomper(1100));
+    recevoir("\r\n+CADATAIND: 1\r\n", 1150);
+    TEST_ASSERT_EQUAL(COAP_EN_COURS, t.pomper(1150));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CARECV"));
+
+    recevoir("\r\n+CADATAIND: 2\r\n", 1600);
+    TEST_ASSERT_EQUAL(COAP_TERMINE, t.pomper(1600));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CARECV=2,1152"));
+    TEST_ASSERT_TRUE(t.reponse()["lissage"].get<bool>());
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats.nbMessages);
+    TEST_ASSERT_EQUAL_UINT32(0, t.stats.nbRetransmissions);
+    TEST_ASSERT_EQUAL_UINT32(600, t.stats.rttMaxMs);
+    TEST_ASSERT_EQUAL_UINT32(17, (uint32_t)t.stats.octetsEmis);
+    TEST_ASSERT_EQUAL_UINT32(ack.size(), (uint32_t)t.stats.octetsRecus);
+}
+
+// Sans acquittement : même datagramme (même Message ID) retransmis avec un délai doublé, puis abandon
+void test_coap_retransmission()
+{
+    TransportCoap &t = transportCoap;
+    t.config.maxRetransmissions = 2;
+    t.commencer(CBOR_MESSAGE, sizeof(CBOR_MESSAGE), 0);
+    unsigned long delai = t.delaiAcquittement(0);
+    TEST_ASSERT_TRUE(delai >= t.config.ackTimeoutMs && delai <= t.config.ackTimeoutMs * 3 / 2);
+    TEST_ASSERT_EQUAL_UINT32(delai * 2, t.delaiAcquittement(1));
+    std::vector<uint8_t> premier = ecrireDatagramme(10);
+
+    TEST_ASSERT_EQUAL(COAP_EN_COURS, t.pomper(delai - 1));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CARECV"));
+
+    // Echéance : une lecture pour une annonce perdue, puis retransmission
+    ecrit.clear();
+    TEST_ASSERT_EQUAL(COAP_EN_COURS, t.pomper(delai));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CARECV=2"));
+    TEST_ASSERT_EQUAL_STRING("AT+CASEND=2,17\r\n", ecrit.c_str());
+    std::vector<uint8_t> second = ecrireDatagramme(delai + 10);
+    TEST_ASSERT_TRUE(premier == second);
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats.nbRetransmissions);
+
+    // Délai doublé avant la deuxième retransmission
+    TEST_ASSERT_EQUAL(COAP_EN_COURS, t.pomper(delai + 2 * delai - 1));
+    TEST_ASSERT_EQUAL(COAP_EN_COURS, t.pomper(delai + 2 * delai));
+    ecrireDatagramme(3 * delai + 10);
+    TEST_ASSERT_EQUAL_UINT32(2, t.stats.nbRetransmissions);
+
+    TEST_ASSERT_EQUAL(COAP_ECHEC, t.pomper(3 * delai + 4 * delai));
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats.nbEchecs);
+    TEST_ASSERT_EQUAL(3, simulateur.compter("AT+CARECV=2"));
+}
+
+// Délai initial tiré au hasard dans [ackTimeoutMs, ackTimeoutMs × 1,5], indépendamment du Message ID
+void test_coap_delai_aleatoire()
+{
+    TransportCoap &t = transportCoap;
+    unsigned long mini = ~0UL, maxi = 0;
+    for (int i = 0; i < 200; ++i)
+    {
+        unsigned long delai = t.tirerDelaiInitial();
+        TEST_ASSERT_TRUE(delai >= t.config.ackTimeoutMs && delai <= t.config.ackTimeoutMs * 3 / 2);
+        mini = delai < mini ? delai : mini;
+        maxi = delai > maxi ? delai : maxi;
+    }
+    TEST_ASSERT_TRUE(maxi - mini > t.config.ackTimeoutMs / 4);
+
+    // Même Message ID (restauré après un deep sleep sur deux traceurs) : délais différents
+    unsigned long delais[8];
+    bool differents = false;
+    for (int i = 0; i < 8; ++i)
+    {
+        t.liberer();
+        t.restaurerMessageId(0x0042);
+        t.commencer(CBOR_MESSAGE, sizeof(CBOR_MESSAGE), 0);
+        delais[i] = t.delaiAcquittement(0);
+        differents = differents || delais[i] != delais[0];
+    }
+    TEST_ASSERT_TRUE(differents);
+
+    t.config.facteurAleatoirePct = 0;
+    TEST_ASSERT_EQUAL_UINT32(t.config.ackTimeoutMs, t.tirerDelaiInitial());
+}
+
+// +CADATAIND lu dans le même bloc que le OK de l'AT+CASEND : l'acquittement n'est pas perdu
+void test_coap_annonce_avec_ok()
+{
+    TransportCoap &t = transportCoap;
+    t.commencer(CBOR_MESSAGE, sizeof(CBOR_MESSAGE), 0);
+    ecrit.clear();
+    recevoir("\r\n> ", 10);
+    std::vector<uint8_t> requete(ecrit.begin(), ecrit.end());
+
+    ServeurCoapLocal serveur;
+    std::vector<uint8_t> ack;
+    serveur.repondre(requete.data(), requete.size(), ack);
+    simulateur.repondre("AT+CARECV=2", reponseCARECV(ack), 1);
+
+    recevoir("\r\nOK\r\n\r\n+CADATAIND: 2\r\n", 300);
+    TEST_ASSERT_EQUAL(COAP_TERMINE, t.pomper(300));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+CARECV=2"));
+    TEST_ASSERT_EQUAL_UINT32(0, t.stats.nbRetransmissions);
+}
+
+// Acquittement d'un échange précédent ignoré, RST et réponse d'erreur terminent l'échange en échec
+void test_coap_acquittement_ancien_et_rst()
+{
+    TransportCoap &t = transportCoap;
+    t.restaurerMessageId(0x00FF);
+    t.commencer(CBOR_MESSAGE, sizeof(CBOR_MESSAGE), 0);
+    ecrireDatagramme(10);
+
+    const uint8_t ancien[] = {0x60, 0x44, 0x00, 0xFE};
+    TEST_ASSERT_FALSE(t.recevoir(reponseCARECV(std::vector<uint8_t>(ancien, ancien + sizeof(ancien))), 100));
+    TEST_ASSERT_EQUAL(COAP_EN_COURS, t.etat());
+
+    const uint8_t rst[] = {0x70, 0x00, 0x00, 0xFF};
+    TEST_ASSERT_TRUE(t.recevoir(reponseCARECV(std::vector<uint8_t>(rst, rst + sizeof(rst))), 200));
+    TEST_ASSERT_EQUAL(COAP_ECHEC, t.etat());
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats.nbReset);
+
+    // 4.04 dans l'acquittement
+    t.liberer();
+    TEST_ASSERT_EQUAL_HEX16(0x0100, t.prochainMessageId());
+    t.commencer(CBOR_MESSAGE, sizeof(CBOR_MESSAGE), 300);
+    ecrireDatagramme(310);
+    const uint8_t introuvable[] = {0x60, 0x84, 0x01, 0x00};
+    TEST_ASSERT_TRUE(t.recevoir(reponseCARECV(std::vector<uint8_t>(introuvable, introuvable + sizeof(introuvable))), 400));
+    TEST_ASSERT_EQUAL(COAP_ECHEC, t.etat());
+    TEST_ASSERT_EQUAL_UINT32(2, t.stats.nbEchecs);
+}
+
+// Le serveur local acquitte une retransmission sans la compter comme une nouvelle requête
+void test_coap_serveur_doublons()
+{
+    ServeurCoapLocal serveur;
+    serveur.perteTous = 3; // la première retransmission est perdue
+    MessageCoap requete;
+    requete.messageId = 7;
+    requete.tkl = 1;
+    requete.token[0] = 0x42;
+    requete.charge.assign(CBOR_MESSAGE, CBOR_MESSAGE + sizeof(CBOR_MESSAGE));
+    std::vector<uint8_t> d, ack;
+    encoderCoap(requete, COAP_URI, d);
+
+    TEST_ASSERT_TRUE(serveur.repondre(d.data(), d.size(), ack));
+    TEST_ASSERT_FALSE(serveur.repondre(d.data(), d.size(), ack));
+    TEST_ASSERT_TRUE(ack.empty());
+    TEST_ASSERT_TRUE(serveur.repondre(d.data(), d.size(), ack));
+    TEST_ASSERT_EQUAL_UINT32(1, serveur.nbRequetes);
+    TEST_ASSERT_EQUAL_UINT32(1, serveur.nbDoublons);
+    TEST_ASSERT_EQUAL_UINT32(1, serveur.nbPertes);
+
+    MessageCoap lu;
+    TEST_ASSERT_TRUE(decoderCoap(ack.data(), ack.size(), lu));
+    TEST_ASSERT_EQUAL(COAP_ACK, lu.type);
+    TEST_ASSERT_EQUAL_HEX8(COAP_CHANGED, lu.code);
+    TEST_ASSERT_EQUAL(7, lu.messageId);
+    TEST_ASSERT_EQUAL_HEX8(0x42, lu.token[0]);
+    TEST_ASSERT_TRUE(lu.charge.empty());
+}
+
+// STEP_ENVOI_COAP : socket UDP ouvert une fois, options de l'acquittement appliquées, fin du pipeline sans AT+CACLOSE
+void test_coap_pipeline()
+{
+    bool lissageInitial = acceptationFix.config.lissage;
+    acceptationFix.config.lissage = false;
+    simulateur.repondre("AT+CAOPEN=2", "\r\n+CAOPEN: 2,0\r\n\r\nOK\r\n");
+    cborDataPipeline.assign(CBOR_MESSAGE, CBOR_MESSAGE + sizeof(CBOR_MESSAGE));
+    currentStepCBOR = STEP_ENVOI_COAP;
+
+    STEP_ENVOI_COAP_FUNCTION();
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CAOPEN=2,0,\"UDP\",coap.local,5683"));
+    TEST_ASSERT_TRUE(multiplexeurSockets.estOuvert(CANAL_COAP));
+    std::vector<uint8_t> requete = ecrireDatagramme(millis());
+
+    ServeurCoapLocal serveur;
+    serveur.options = {{"lissage", true}};
+    std::vector<uint8_t> ack;
+    serveur.repondre(requete.data(), requete.size(), ack);
+    simulateur.repondre("AT+CARECV=2", reponseCARECV(ack), 1);
+    recevoir("\r\n+CADATAIND: 2\r\n", millis());
+    STEP_ENVOI_COAP_FUNCTION();
+
+    TEST_ASSERT_EQUAL(STEP_END, currentStepCBOR);
+    TEST_ASSERT_EQUAL(COAP_INACTIF, transportCoap.etat());
+    TEST_ASSERT_TRUE(acceptationFix.config.lissage);
+    TEST_ASSERT_TRUE(lastReceivedCBOR["lissage"].get<bool>());
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CACLOSE"));
+
+    // Envoi suivant : pas de nouvel AT+CAOPEN
+    simulateur.commandes.clear();
+    STEP_ENVOI_COAP_FUNCTION();
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+CAOPEN"));
+    TEST_ASSERT_EQUAL_UINT32(1, multiplexeurSockets.stats[CANAL_COAP].nbOuverturesEvitees);
+
+    // Nouveau port du serveur CoAP : le socket UDP est fermé puis rouvert vers la nouvelle adresse
+    transportCoap.liberer();
+    chargerOptionsCoap({{"port", 5684}});
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CACLOSE=2"));
+    TEST_ASSERT_FALSE(multiplexeurSockets.estOuvert(CANAL_COAP));
+    STEP_ENVOI_COAP_FUNCTION();
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+CAOPEN=2,0,\"UDP\",coap.local,5684"));
+
+    // Socket UDP refusé : le message repart par le pipeline TCP
+    transportCoap.liberer();
+    multiplexeurSockets.reinitialiser();
+    simulateur.repondre("AT+CAOPEN=2", "\r\nERROR\r\n");
+    currentStepCBOR = STEP_ENVOI_COAP;
+    STEP_ENVOI_COAP_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_OPEN_CONNEXION, currentStepCBOR);
+
+    acceptationFix.config.lissage = lissageInitial;
+    currentStepCBOR = STEP_INIT_CBOR;
+    cborDataPipeline.clear();
+}
+
+void test_coap_benchmark_tcp()
+{
+    ScenarioTransport scenario;
+    ConfigCoap tcp;
+    ConfigCoap coap;
+    coap.actif = true;
+    coap.hote = "coap.local";
+    char message[200];
+
+    RapportTransport avant = simulerTransport(scenario, tcp);
+    RapportTransport apres = simulerTransport(scenario, coap);
+    snprintf(message, sizeof(message), "%u o : TCP %.1f allers-retours, %lu o radio, %lu ms / CoAP %.1f, %lu o, %lu ms",
+             scenario.tailleCharge, avant.allersRetours, (unsigned long)avant.octetsRadio, (unsigned long)avant.tempsRadioMs,
+             apres.allersRetours, (unsigned long)apres.octetsRadio, (unsigned long)apres.tempsRadioMs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, avant.allersRetours);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, apres.allersRetours);
+    TEST_ASSERT_TRUE(apres.octetsRadio * 2 < avant.octetsRadio);
+    TEST_ASSERT_TRUE(apres.tempsRadioMs * 2 < avant.tempsRadioMs);
+
+    // Un paquet sur 10 perdu : le délai d'acquittement CoAP dépasse le RTO TCP, mais CoAP échange moins de paquets
+    scenario.perteTous = 10;
+    avant = simulerTransport(scenario, tcp);
+    apres = simulerTransport(scenario, coap);
+    snprintf(message, sizeof(message), "perte 1/10 : TCP %lu o, %lu ms, %lu retransmissions / CoAP %lu o, %lu ms, %lu retransmissions, %lu echecs",
+             (unsigned long)avant.octetsRadio, (unsigned long)avant.tempsRadioMs, (unsigned long)avant.nbRetransmissions,
+             (unsigned long)apres.octetsRadio, (unsigned long)apres.tempsRadioMs, (unsigned long)apres.nbRetransmissions,
+             (unsigned long)apres.nbEchecs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_UINT32(0, apres.nbEchecs);
+    TEST_ASSERT_TRUE(apres.nbRetransmissions > 0);
+    TEST_ASSERT_TRUE(apres.octetsRadio < avant.octetsRadio);
+}
@@ -0,0 +1,32 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_coap_encodage();
+void test_coap_echange_acquitte();
+void test_coap_retransmission();
+void test_coap_delai_aleatoire();
+void test_coap_annonce_avec_ok();
+void test_coap_acquittement_ancien_et_rst();
+void test_coap_serveur_doublons();
+void test_coap_pipeline();
+void test_coap_benchmark_tcp();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_coap_encodage);
+    RUN_TEST(test_coap_echange_acquitte);
+    RUN_TEST(test_coap_retransmission);
+    RUN_TEST(test_coap_delai_aleatoire);
+    RUN_TEST(test_coap_annonce_avec_ok);
+    RUN_TEST(test_coap_acquittement_ancien_et_rst);
+    RUN_TEST(test_coap_serveur_doublons);
+    RUN_TEST(test_coap_pipeline);
+    RUN_TEST(test_coap_benchmark_tcp);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,347 @@
+#include <unity.h>
+#include <string>
+#include "TRANSPORT_MQTT.hpp"
+#include "PIPELINE_GLOBAL.hpp"
+#include "pipeline.hpp"
+#include "SIMULATEUR_SIM7080G.hpp"
+
+SimulateurSIM7080G simulateur;
+BrokerMqttLocal broker;
+
+// Octets écrits vers le modem par la publication (en-tête AT+SMPUB et contenu)
+static std::string ecrit;
+
+static size_t capturer(const uint8_t *donnees, size_t taille)
+{
+    ecrit.append((const char *)donnees, taille);
+    return taille;
+}
+
+// Commandes AT+SM* servies par le broker local, les autres par le simulateur ; toutes journalisées
+static String repondre(const String &commande, long)
+{
+    if (!commande.startsWith("AT+SM"))
+        return simulateur.traiter(commande);
+    simulateur.commandes.push_back(commande);
+    return broker.traiter(commande);
+}
+
+static std::vector<json> commandes;
+
+static void capturerCommande(const json &message)
+{
+    commandes.push_back(message);
+}
+
+static void recevoir(const String &texte, unsigned long maintenant)
+{
+    transportMqtt.traiter(texte.c_str(), texte.length(), maintenant);
+}
+
+// Prompt, contenu remis au broker, puis OK du PUBACK
+static EtatMqtt publier(unsigned long maintenant)
+{
+    ecrit.clear();
+    recevoir("\r\n>", maintenant);
+    broker.publier(transportMqtt.topicPublication(), (const uint8_t *)ecrit.data(), ecrit.size());
+    recevoir("\r\nOK\r\n", maintenant);
+    return transportMqtt.pomper(maintenant);
+}
+
+static const uint8_t CBOR_LOT[] = {0xA1, 0x61, 'a', 0x01}; // {"a": 1}
+static String imeiInitial;
+
+void setUp(void)
+{
+    ecrit.clear();
+    commandes.clear();
+    broker = BrokerMqttLocal();
+    simulateur.reinitialiser();
+    simulateur.installer();
+    SendATResponseHook = repondre;
+    transportMqtt.reinitialiser();
+    transportMqtt.config = ConfigMqtt();
+    transportMqtt.config.actif = true;
+    transportMqtt.config.hote = "mqtt.local";
+    transportMqtt.sortie = capturer;
+    transportMqtt.appliquer = capturerCommande;
+    sessionReseau.reinitialiser();
+    imeiInitial = imei;
+    imei = "861234";
+}
+
+void tearDown(void)
+{
+    imei = imeiInitial;
+    transportMqtt.sortie = nullptr;
+    transportMqtt.appliquer = nullptr;
+    transportMqtt.config = ConfigMqtt();
+    simulateur.desinstaller();
+}
+
+// Configuration et abonnement au premier envoi seulement
+void test_mqtt_connexion_unique()
+{
+    TransportMqtt &t = transportMqtt;
+    TEST_ASSERT_TRUE(t.connecter(1000));
+    TEST_ASSERT_EQUAL(5, simulateur.compter("AT+SMCONF="));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMCONF=\"URL\",\"mqtt.local\",1883"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMCONF=\"CLIENTID\",\"861234\""));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMCONF=\"CLEANSS\",0"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMCONF=\"SUBHEX\",1"));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+SMCONN"));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMSUB=\"gps/861234/cmd\",1"));
+    TEST_ASSERT_TRUE(t.estConnecte());
+    TEST_ASSERT_TRUE(t.estAbonne());
+    TEST_ASSERT_TRUE(t.ecouteUart());
+    TEST_ASSERT_TRUE(broker.connecte);
+    TEST_ASSERT_EQUAL(1, broker.abonnements.size());
+
+    simulateur.commandes.clear();
+    TEST_ASSERT_TRUE(t.connecter(2000));
+    TEST_ASSERT_EQUAL(0, simulateur.commandes.size());
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats.nbConnexions);
+    TEST_ASSERT_EQUAL_UINT32(7, t.stats.transactionsAT);
+
+    TEST_ASSERT_TRUE(t.accepte(TAILLE_MAX_MQTT));
+    TEST_ASSERT_FALSE(t.accepte(TAILLE_MAX_MQTT + 1));
+}
+
+// AT+SMPUB, contenu au prompt, OK après le PUBACK ; une commande reçue pendant la publication est appliquée
+void test_mqtt_publication()
+{
+    TransportMqtt &t = transportMqtt;
+    t.connecter(1000);
+    t.commencer(CBOR_LOT, sizeof(CBOR_LOT), 10, 1000);
+    TEST_ASSERT_EQUAL_STRING("AT+SMPUB=\"gps/861234\",4,1,0\r\n", ecrit.c_str());
+    TEST_ASSERT_EQUAL(MQTT_EN_COURS, t.pomper(1100));
+
+    recevoir(broker.commander(t.topicCommandes(), {{"periode", 30}}), 1150);
+    TEST_ASSERT_EQUAL(MQTT_TERMINE, publier(1400));
+    TEST_ASSERT_EQUAL(1, broker.publications.size());
+    TEST_ASSERT_EQUAL(sizeof(CBOR_LOT), broker.publications[0].size());
+    TEST_ASSERT_EQUAL(1, commandes.size());
+    TEST_ASSERT_EQUAL(30, commandes[0]["periode"].get<int>());
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats.nbPublications);
+    TEST_ASSERT_EQUAL_UINT32(10, t.stats.nbFixesPublies);
+    TEST_ASSERT_EQUAL_UINT32(400, t.stats.latenceMaxMs);
+
+    // Ni prompt ni OK : publication abandonnée après delaiMs
+    t.liberer();
+    t.connecter(2000);
+    t.commencer(CBOR_LOT, sizeof(CBOR_LOT), 10, 2000);
+    TEST_ASSERT_EQUAL(MQTT_EN_COURS, t.pomper(2000 + t.config.delaiMs));
+    TEST_ASSERT_EQUAL(MQTT_ECHEC, t.pomper(2001 + t.config.delaiMs));
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats.nbEchecs);
+}
+
+void test_mqtt_commandes_filtrees()
+{
+    TransportMqtt &t = transportMqtt;
+    t.connecter(1000);
+    // Commande entre deux envois, lue par servir() (AIGUILLAGE_URC)
+    recevoir("\r\n+SMSUB: \"gps/861234/cmd\",\"A167706572696F646509\"\r\n", 2000);
+    TEST_ASSERT_EQUAL(1, commandes.size());
+    TEST_ASSERT_EQUAL(9, commandes[0]["periode"].get<int>());
+
+    // Autre topic, hexadécimal invalide, CBOR invalide : ignorés
+    recevoir("\r\n+SMSUB: \"gps/999/cmd\",\"A167706572696F646509\"\r\n", 2100);
+    recevoir("\r\n+SMSUB: \"gps/861234/cmd\",\"A1ZZ\"\r\n", 2200);
+    recevoir("\r\n+SMSUB: \"gps/861234/cmd\",\"FF\"\r\n", 2300);
+    TEST_ASSERT_EQUAL(1, commandes.size());
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats.nbCommandes);
+
+    // Sans fonction de test : appliquée comme la réponse à un envoi
+    bool lissageInitial = acceptationFix.config.lissage;
+    acceptationFix.config.lissage = false;
+    t.appliquer = nullptr;
+    recevoir(broker.commander(t.topicCommandes(), {{"lissage", true}}), 2400);
+    TEST_ASSERT_TRUE(acceptationFix.config.lissage);
+    TEST_ASSERT_TRUE(lastReceivedCBOR["lissage"].get<bool>());
+    acceptationFix.config.lissage = lissageInitial;
+}
+
+// Session persistante : reconnexion sans abonnement, commande publiée pendant la coupure livrée à la reconnexion
+// Ecoute TCP et abonnement MQTT ouverts ensemble : chaque URC parvient à son destinataire, quel que soit le lecteur
+void test_mqtt_urc_aiguillees()
+{
+    TransportMqtt &t = transportMqtt;
+    t.connecter(1000);
+    multiplexeurSockets.reinitialiser();
+    ecouteDescendante.reinitialiser();
+    ecouteDescendante.ouvrir(1000);
+    String commande = broker.commander(t.topicCommandes(), {{"periode", 9}});
+    String annonce = "\r\n+CADATAIND: " + String(ecouteDescendante.socket()) + "\r\n";
+
+    // Une seule lecture de l'UART, URC mêlées dans le même bloc
+    String flux = annonce + commande + "\r\n+CEREG: 5\r\n";
+    aiguillageUrc.traiter(flux.c_str(), flux.length(), 2000);
+    TEST_ASSERT_EQUAL(1, commandes.size());
+    TEST_ASSERT_EQUAL(9, commandes[0]["periode"].get<int>());
+    TEST_ASSERT_TRUE(ecouteDescendante.donneesAnnoncees());
+    TEST_ASSERT_TRUE(sessionReseau.estEnregistre());
+
+    // +SMSUB lu par l'écoute, +CADATAIND par le client MQTT : remis à leur destinataire
+    ecouteDescendante.reinitialiser();
+    ecouteDescendante.ouvrir(3000);
+    ecouteDescendante.traiter(commande.c_str(), commande.length(), 3000);
+    TEST_ASSERT_EQUAL(2, commandes.size());
+    recevoir(annonce, 3100);
+    TEST_ASSERT_TRUE(ecouteDescendante.donneesAnnoncees());
+
+    recevoir("\r\n+SMSTATE: 0\r\n", 3200);
+    TEST_ASSERT_FALSE(t.estConnecte());
+    ecouteDescendante.reinitialiser();
+}
+
+void test_mqtt_session_persistante()
+{
+    TransportMqtt &t = transportMqtt;
+    t.connecter(1000);
+    broker.couper();
+    recevoir("\r\n+SMSTATE: 0\r\n", 1500);
+    TEST_ASSERT_FALSE(t.estConnecte());
+    TEST_ASSERT_TRUE(t.estAbonne());
+    TEST_ASSERT_FALSE(t.ecouteUart());
+    TEST_ASSERT_EQUAL_STRING("", broker.commander(t.topicCommandes(), {{"periode", 45}}).c_str());
+
+    simulateur.commandes.clear();
+    TEST_ASSERT_TRUE(t.connecter(2000));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+SMCONN"));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+SMSUB"));
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+SMCONF"));
+    TEST_ASSERT_EQUAL(1, commandes.size());
+    TEST_ASSERT_EQUAL(45, commandes[0]["periode"].get<int>());
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats.nbDeconnexions);
+
+    // Session propre : l'abonnement est repris, la commande de la coupure est perdue
+    chargerOptionsMqtt({{"sessionPersistante", false}});
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMDISC"));
+    TEST_ASSERT_TRUE(t.connecter(3000));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMCONF=\"CLEANSS\",1"));
+    broker.couper();
+    recevoir("\r\n+SMSTATE: 0\r\n", 3500);
+    TEST_ASSERT_FALSE(t.estAbonne());
+    broker.commander(t.topicCommandes(), {{"periode", 60}});
+    simulateur.commandes.clear();
+    t.connecter(4000);
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMSUB"));
+    TEST_ASSERT_EQUAL(1, commandes.size());
+    TEST_ASSERT_EQUAL_UINT32(1, broker.nbCommandesPerdues);
+}
+
+// Sans broker configuré, les envois restent sur TCP ; un nouveau broker réécrit AT+SMCONF à la connexion suivante
+void test_mqtt_broker_configure()
+{
+    TransportMqtt &t = transportMqtt;
+    t.config.hote = "";
+    TEST_ASSERT_FALSE(t.accepte(sizeof(CBOR_LOT)));
+    chargerOptionsMqtt({{"hote", "mqtt.local"}});
+    TEST_ASSERT_TRUE(t.accepte(sizeof(CBOR_LOT)));
+
+    TEST_ASSERT_TRUE(t.connecter(1000));
+    simulateur.commandes.clear();
+    chargerOptionsMqtt({{"hote", "mqtt.local"}, {"port", 1883}});
+    TEST_ASSERT_TRUE(t.estConfigure());
+    TEST_ASSERT_FALSE(simulateur.aRecu("AT+SMDISC"));
+
+    chargerOptionsMqtt({{"hote", "broker.exemple.fr"}, {"port", 8883}});
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMDISC"));
+    TEST_ASSERT_FALSE(t.estConfigure());
+    TEST_ASSERT_TRUE(t.connecter(2000));
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMCONF=\"URL\",\"broker.exemple.fr\",8883"));
+    TEST_ASSERT_EQUAL(1, simulateur.compter("AT+SMCONN"));
+}
+
+// Après un deep sleep (ETAT_RTC), la connexion encore ouverte est reprise par AT+SMSTATE?
+void test_mqtt_reprise_apres_sommeil()
+{
+    TransportMqtt &t = transportMqtt;
+    t.connecter(1000);
+    t.restaurerSession(true, true);
+    TEST_ASSERT_FALSE(t.estConnecte());
+
+    simulateur.commandes.clear();
+    TEST_ASSERT_TRUE(t.connecter(2000));
+    TEST_ASSERT_EQUAL(1, simulateur.commandes.size());
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMSTATE?"));
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats.nbConnexionsReprises);
+
+    // Connexion fermée pendant le sommeil : AT+SMCONN, sans configuration ni abonnement
+    broker.couper();
+    t.restaurerSession(true, true);
+    simulateur.commandes.clear();
+    TEST_ASSERT_TRUE(t.connecter(3000));
+    TEST_ASSERT_EQUAL(2, simulateur.commandes.size());
+    TEST_ASSERT_TRUE(simulateur.aRecu("AT+SMCONN"));
+}
+
+// STEP_ENVOI_MQTT : une seule commande AT par lot une fois connecté, pas de AT+CAOPEN ni de AT+CACLOSE
+void test_mqtt_pipeline()
+{
+    cborDataPipeline.assign(CBOR_LOT, CBOR_LOT + sizeof(CBOR_LOT));
+    uint16_t nbInitial = nbCoordonnees;
+    nbCoordonnees = 10;
+
+    for (int envoi = 0; envoi < 2; ++envoi)
+    {
+        uint32_t transactions = nbTransactionsAT;
+        simulateur.commandes.clear();
+        currentStepCBOR = STEP_ENVOI_MQTT;
+        STEP_ENVOI_MQTT_FUNCTION();
+        TEST_ASSERT_EQUAL(STEP_ENVOI_MQTT, currentStepCBOR);
+        publier(millis());
+        STEP_ENVOI_MQTT_FUNCTION();
+        TEST_ASSERT_EQUAL(STEP_END, currentStepCBOR);
+        TEST_ASSERT_EQUAL(MQTT_INACTIF, transportMqtt.etat());
+        TEST_ASSERT_FALSE(simulateur.aRecu("AT+CA"));
+        if (envoi == 1)
+            TEST_ASSERT_EQUAL_UINT32(1, nbTransactionsAT - transactions);
+    }
+    TEST_ASSERT_EQUAL(2, broker.publications.size());
+    TEST_ASSERT_EQUAL_UINT32(20, transportMqtt.stats.nbFixesPublies);
+
+    // Broker injoignable : le lot repart par le pipeline TCP
+    transportMqtt.reinitialiser();
+    broker.connecte = true; // AT+SMCONN répond ERROR
+    currentStepCBOR = STEP_ENVOI_MQTT;
+    STEP_ENVOI_MQTT_FUNCTION();
+    TEST_ASSERT_EQUAL(STEP_OPEN_CONNEXION, currentStepCBOR);
+
+    nbCoordonnees = nbInitial;
+    currentStepCBOR = STEP_INIT_CBOR;
+    cborDataPipeline.clear();
+}
+
+void test_mqtt_benchmark_tcp()
+{
+    ScenarioMqtt scenario;
+    ConfigMqtt tcp;
+    ConfigMqtt mqtt;
+    mqtt.actif = true;
+    ConfigMqtt propre = mqtt;
+    propre.sessionPersistante = false;
+
+    RapportMqtt avant = simulerMqtt(scenario, tcp);
+    RapportMqtt apres = simulerMqtt(scenario, mqtt);
+    RapportMqtt sansSession = simulerMqtt(scenario, propre);
+    char message[240];
+    snprintf(message, sizeof(message),
+             "%u lots de %u fixes : TCP %.2f AT/fix, %lu ms moyenne, %lu ms max / MQTT %.2f AT/fix, %lu ms, %lu ms max, "
+             "%lu connexions / session propre %lu commandes perdues",
+             scenario.nbCycles, scenario.fixesParLot, avant.transactionsParFix, (unsigned long)avant.latencePublicationMoyenneMs,
+             (unsigned long)avant.latencePublicationMaxMs, apres.transactionsParFix,
+             (unsigned long)apres.latencePublicationMoyenneMs, (unsigned long)apres.latencePublicationMaxMs,
+             (unsigned long)apres.nbConnexions, (unsigned long)sansSession.nbCommandesPerdues);
+    TEST_MESSAGE(message);
+
+    TEST_ASSERT_EQUAL_FLOAT(0.4f, avant.transactionsParFix);
+    TEST_ASSERT_TRUE(apres.transactionsParFix * 2 < avant.transactionsParFix);
+    // Un aller-retour au lieu de deux, sauf aux reconnexions
+    TEST_ASSERT_TRUE(apres.latencePublicationMoyenneMs * 3 < avant.latencePublicationMoyenneMs * 2);
+    TEST_ASSERT_EQUAL_UINT32(scenario.nbCycles / scenario.coupureTous, apres.nbConnexions);
+    // Session persistante : aucune commande perdue pendant les coupures
+    TEST_ASSERT_EQUAL_UINT32(0, apres.nbCommandesPerdues);
+    TEST_ASSERT_EQUAL_UINT32(scenario.nbCycles / scenario.commandeTous, apres.nbCommandesLivrees);
+    TEST_ASSERT_TRUE(sansSession.nbCommandesPerdues > 0);
+}
@@ -0,0 +1,32 @@
+#include <Arduino.h>
+#include <unity.h>
+
+void setUp(void);
+void tearDown(void);
+
+void test_mqtt_connexion_unique();
+void test_mqtt_publication();
+void test_mqtt_commandes_filtrees();
+void test_mqtt_urc_aiguillees();
+void test_mqtt_session_persistante();
+void test_mqtt_broker_configure();
+void test_mqtt_reprise_apres_sommeil();
+void test_mqtt_pipeline();
+void test_mqtt_benchmark_tcp();
+
+void setup()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_mqtt_connexion_unique);
+    RUN_TEST(test_mqtt_publication);
+    RUN_TEST(test_mqtt_commandes_filtrees);
+    RUN_TEST(test_mqtt_urc_aiguillees);
+    RUN_TEST(test_mqtt_session_persistante);
+    RUN_TEST(test_mqtt_broker_configure);
+    RUN_TEST(test_mqtt_reprise_apres_sommeil);
+    RUN_TEST(test_mqtt_pipeline);
+    RUN_TEST(test_mqtt_benchmark_tcp);
+    UNITY_END();
+}
+
+void loop() {}
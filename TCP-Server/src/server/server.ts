@@ -66,6 +66,18 @@ async function startServer() {
                     return;
                 }
 
+                if (parsed.controle === true) {
+                    // Control socket of the SIM7080G (cid 1): kept open between uploads, commands are routed to it
+                    console.log("Control socket identified:", parsed.name);
+                    simSocket = socket;
+                    if (pendingMessage) {
+                        socket.write(encode(pendingMessage));
+                        console.log("Pending message transmitted to SIM7080G:", pendingMessage);
+                        pendingMessage = null;
+                    }
+                    return; // no acknowledgement: any data wakes the modem
+                }
+
                 if (Array.isArray(parsed)) {
                     // Batch of objects
                     const dataPoints: DataPoint[] = parsed.map((item: any) => ({
@@ -79,8 +91,10 @@ async function startServer() {
                     console.log("Batch inserted:", result.insertedIds);
                     socket.write("Batch received and saved\n");
                 } else if (parsed.name && parsed.position) {
-                    // Single object
-                    simSocket = socket;
+                    // Single object: upload socket, used for commands until a control socket identifies itself
+                    if (!simSocket) {
+                        simSocket = socket;
+                    }
                     const data: DataPoint = {
                         imei: parsed.name,
                         latitude: parseFloat(parsed.position.latitude),
@@ -101,6 +115,11 @@ async function startServer() {
             }
         });
 
+        socket.on('close', () => {
+            if (socket === simSocket) {
+                simSocket = null;
+            }
+        });
         socket.on('end', () => console.log("Client disconnected"));
         socket.on('error', (err) => console.error("Socket error:", err.message));
     });